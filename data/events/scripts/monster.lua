@@ -20,9 +20,10 @@ function Monster:onDropLoot(corpse)
 			end
 		end
 
+		local isBoosted = self:getName():lower() == Game.getBoostedCreature():lower()
 		for i = 1, #monsterLoot do
 			local item = corpse:createLootItem(monsterLoot[i], charmBonus, preyChanceBoost)
-			if self:getName():lower() == Game.getBoostedCreature():lower() then
+			if isBoosted then
 				local itemBoosted = corpse:createLootItem(monsterLoot[i], charmBonus, preyChanceBoost)
 				if not itemBoosted then
 					Spdlog.warn(string.format("[Monster:onDropLoot] - Could not add loot item to boosted monster: %s, from corpse id: %d.", self:getName(), corpse:getId()))
@@ -319,13 +319,8 @@ function Player:onGainExperience(target, exp, rawExp)
 		self:addCondition(soulCondition)
 	end
 
-	-- Experience Stage Multiplier
-	local expStage = getRateFromTable(experienceStages, self:getLevel(), configManager.getNumber(configKeys.RATE_EXPERIENCE))
-
-	-- Event scheduler
-	if SCHEDULE_EXP_RATE ~= 100 then
-		expStage = math.max(0, (expStage * SCHEDULE_EXP_RATE)/100)
-	end
+	-- Experience Stage Multiplier, with the event scheduler rate
+	local expStage = Game.getExperienceStage(self:getLevel())
 
 	-- Store Bonus
 	useStaminaXpBoost(self) -- Use store boost stamina
@@ -0,0 +1,73 @@
+--[[
+Coroutine helpers for scripts that wait on the database or on time.
+
+Async.run starts a function as a coroutine. Inside it the Async functions
+suspend the script until the result is back and return it, while the
+dispatcher keeps running the game in the meantime.
+
+Async.run(function(playerId)
+	local resultId = Async.storeQuery("SELECT `name` FROM `players` WHERE `id` = 1")
+	if resultId then
+		local name = result.getString(resultId, "name")
+		result.free(resultId)
+	end
+
+	Async.sleep(2000)
+	-- creatures may be gone after waiting, fetch them again by id
+	local player = Player(playerId)
+	if player then
+		player:say("Done!")
+	end
+end, player:getId())
+
+Read query results before the next Async call, they do not outlive the event
+that resumed the coroutine.
+Errors inside the coroutine are logged with their traceback.
+]]
+Async = {}
+
+local function resume(co, ...)
+	local ok, err = coroutine.resume(co, ...)
+	if not ok then
+		Spdlog.error("[Async.run] " .. debug.traceback(co, tostring(err)))
+	end
+end
+
+local function running(name)
+	local co, isMain = coroutine.running()
+	if not co or isMain then
+		error(name .. " must be called from a function started with Async.run", 3)
+	end
+	return co
+end
+
+function Async.run(func, ...)
+	resume(coroutine.create(func), ...)
+end
+
+-- Async.sleep(delay), delay in milliseconds, at least 100 as addEvent
+function Async.sleep(delay)
+	local co = running("Async.sleep")
+	addEvent(function()
+		resume(co)
+	end, delay)
+	return coroutine.yield()
+end
+
+-- Async.query(query), returns whether the query succeeded
+function Async.query(query)
+	local co = running("Async.query")
+	db.asyncQuery(query, function(success)
+		resume(co, success)
+	end)
+	return coroutine.yield()
+end
+
+-- Async.storeQuery(query), returns a result id or false like db.storeQuery
+function Async.storeQuery(query)
+	local co = running("Async.storeQuery")
+	db.asyncStoreQuery(query, function(resultId)
+		resume(co, resultId)
+	end)
+	return coroutine.yield()
+end
@@ -324,6 +324,10 @@ function indexToStr(i, v, buffer)
 			insertIndex(i, buffer)
 			serializeTable(v, buffer)
 			table.insert(buffer, ",")
+		elseif getmetatable(v) == Position then
+			insertIndex(i, buffer)
+			serializeTable({x = v.x, y = v.y, z = v.z}, buffer)
+			table.insert(buffer, ",")
 		elseif tp == "number" then
 			insertIndex(i, buffer)
 			table.insert(buffer, tostring(v))
@@ -363,6 +367,8 @@ function table.copy(t, out)
 		if type(x) == "table" then
 			out[i] = {}
 			table.copy(t[i], out[i])
+		elseif getmetatable(x) == Position then
+			out[i] = Position(x)
 		else
 			out[i] = x
 		end
@@ -1,4 +1,5 @@
 -- Functions
+dofile('data/lib/core/functions/async.lua')
 dofile('data/lib/core/functions/combat.lua')
 dofile('data/lib/core/functions/container.lua')
 dofile('data/lib/core/functions/creature.lua')
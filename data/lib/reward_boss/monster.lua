@@ -34,26 +34,28 @@ function MonsterType.createLootItem(self, lootBlock, chance, lootTable)
 	if lootTable == nil then
 		lootTable = {}
 	end
+	-- lootBlock comes from the shared MonsterType:getLoot() table, it must not be modified
+	local itemId = lootBlock.itemId
 	local itemCount = 0
 	local randvalue = math.random(0, 100000) / (configManager.getNumber(configKeys.RATE_LOOT) * chance)
 	if randvalue < lootBlock.chance then
-		if (ItemType(lootBlock.itemId):isStackable()) then
+		if (ItemType(itemId):isStackable()) then
 			itemCount = randvalue % lootBlock.maxCount + 1
 		else
 			itemCount = 1
 		end
 	end
 
-	local itemType = ItemType(lootBlock.itemId)
+	local itemType = ItemType(itemId)
 	local decayTo = itemType:getDecayId()
 	local decayTime = itemType:getDecayTime()
 	if decayTo and decayTo >= 0 and decayTime and decayTime ~= 0 then
 		local transformDeEquipId = itemType:getTransformDeEquipId()
 		if transformDeEquipId and transformDeEquipId > 0 then
-			Spdlog.warn("[MonsterType.createLootItem] - Convert boss '" .. self:name() .. "' reward ID '" .. lootBlock.itemId .. "' to ID " .. transformDeEquipId .. ".")
-			lootBlock.itemId = transformDeEquipId
+			Spdlog.warn("[MonsterType.createLootItem] - Convert boss '" .. self:name() .. "' reward ID '" .. itemId .. "' to ID " .. transformDeEquipId .. ".")
+			itemId = transformDeEquipId
 		else
-			Spdlog.error("[MonsterType.createLootItem] Cannot add item " .. lootBlock.itemId .. " as boss " .. self:name() .. " reward. It has decay.")
+			Spdlog.error("[MonsterType.createLootItem] Cannot add item " .. itemId .. " as boss " .. self:name() .. " reward. It has decay.")
 			return lootTable
 		end
 	end
@@ -68,16 +70,17 @@ function MonsterType.createLootItem(self, lootBlock, chance, lootTable)
 			itemCount = itemCount - n
 		end
 
-		table.insert(lootTable, {lootBlock.itemId, n})
+		table.insert(lootTable, {itemId, n})
 	end
 
 	return lootTable
 end
 
-function MonsterType.getBossReward(self, lootFactor, topScore)
+-- loot is the table of self:getLoot(), read once for all contributors of a kill
+function MonsterType.getBossReward(self, lootFactor, topScore, loot)
 	local result = {}
 	if configManager.getNumber(configKeys.RATE_LOOT) > 0 then
-		local loot = self:getLoot() or {}
+		loot = loot or self:getLoot() or {}
 		for i = #loot, 0, -1 do
 			local lootBlock = loot[i]
 			if lootBlock then
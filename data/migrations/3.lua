@@ -1,5 +1,24 @@
--- return true = There are others migrations file
--- return false = This is the last migration file
 function onUpdateDatabase()
-    return false
+	Spdlog.info("Updating database to version 4 (Market statistics summary table)")
+	db.query([[
+		CREATE TABLE IF NOT EXISTS `market_statistics` (
+			`sale` tinyint(1) NOT NULL DEFAULT '0',
+			`itemtype` int(10) UNSIGNED NOT NULL,
+			`tier` tinyint UNSIGNED NOT NULL DEFAULT '0',
+			`day` int(10) UNSIGNED NOT NULL,
+			`num` int(10) UNSIGNED NOT NULL DEFAULT '0',
+			`min` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+			`max` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+			`sum` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+			CONSTRAINT `market_statistics_pk` PRIMARY KEY (`sale`, `itemtype`, `tier`, `day`)
+		) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+	]])
+	-- the history is aggregated this one time, the server keeps the table up to date from now on
+	db.query([[
+		INSERT INTO `market_statistics` (`sale`, `itemtype`, `tier`, `day`, `num`, `min`, `max`, `sum`)
+			SELECT `sale`, `itemtype`, `tier`, FLOOR(`inserted` / 86400), COUNT(`price`), MIN(`price`), MAX(`price`), SUM(`price`)
+			FROM `market_history` WHERE `state` = 3
+			GROUP BY `sale`, `itemtype`, `tier`, FLOOR(`inserted` / 86400);
+	]])
+	return true
 end
@@ -0,0 +1,15 @@
+function onUpdateDatabase()
+	Spdlog.info("Updating database to version 5 (Binary player state table)")
+	db.query([[
+		CREATE TABLE IF NOT EXISTS `player_state` (
+			`player_id` int(11) NOT NULL,
+			`component` tinyint(3) UNSIGNED NOT NULL,
+			`data` longblob NOT NULL,
+			CONSTRAINT `player_state_pk` PRIMARY KEY (`player_id`, `component`),
+			CONSTRAINT `player_state_players_fk`
+				FOREIGN KEY (`player_id`) REFERENCES `players` (`id`)
+				ON DELETE CASCADE
+		) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+	]])
+	return true
+end
@@ -0,0 +1,5 @@
+-- return true = There are others migrations file
+-- return false = This is the last migration file
+function onUpdateDatabase()
+    return false
+end
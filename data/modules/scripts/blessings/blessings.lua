@@ -346,7 +346,8 @@ Blessings.PlayerDeath = function(player, corpse, killer)
 		local equipLoss = Blessings.LossPercent[#curBless].item
 		Blessings.DropLoot(player, corpse, equipLoss)
 	elseif #curBless < 5 and hasAol and not hasToF then
-		player:removeItem(ITEM_AMULETOFLOSS, 1, -1, false)
+		-- hasAol already found it in the necklace slot, no need to search the whole inventory
+		player:getSlotItem(CONST_SLOT_NECKLACE):remove(1)
 	end
 	--Blessings.ClearBless(player, killer, curBless) IMPLEMENTED IN SOURCE BECAUSE THIS WAS HAPPENING BEFORE SKILL/EXP CALCULATIONS
 
@@ -94,6 +94,9 @@ registerNpcType.flags = function(npcType, mask)
 		if mask.flags.pushable ~= nil then
 			npcType:isPushable(mask.flags.pushable)
 		end
+		if mask.flags.alwaysThink ~= nil then
+			npcType:alwaysThink(mask.flags.alwaysThink)
+		end
 	end
 end
 
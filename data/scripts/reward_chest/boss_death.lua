@@ -57,6 +57,7 @@ function bossDeath.onDeath(creature, corpse, killer, mostDamageKiller, lastHitUn
 		table.sort(scores, function(a, b) return a.score > b.score end)
 
 		local expectedScore = 1 / participants
+		local loot = monsterType:getLoot() or {}
 
 		for _, con in ipairs(scores) do
 			-- Ignoring stamina for now because I heard you get receive rewards even when it's depleted
@@ -75,7 +76,7 @@ function bossDeath.onDeath(creature, corpse, killer, mostDamageKiller, lastHitUn
 				lootFactor = lootFactor / participants ^ (1 / 3)
 				-- Increase the loot multiplicatively by how many times the player surpassed the expected score
 				lootFactor = lootFactor * (1 + lootFactor) ^ (con.score / expectedScore)
-				playerLoot = monsterType:getBossReward(lootFactor, _ == 1)
+				playerLoot = monsterType:getBossReward(lootFactor, _ == 1, loot)
 
 				if con.player then
 					for _, p in ipairs(playerLoot) do
@@ -0,0 +1,24 @@
+local databaseStats = TalkAction("/dbstats")
+
+function databaseStats.onSay(player, words, param)
+	if not player:getGroup():getAccess() or player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return true
+	end
+
+	param = param:lower()
+	if param == "on" or param == "off" then
+		Game.setDatabaseStats(param == "on")
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Database statistics " .. (param == "on" and "enabled." or "disabled."))
+		return false
+	end
+
+	if Game.reportDatabaseStats(param == "reset") then
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Database statistics logged to the console.")
+	else
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Database statistics are disabled, use /dbstats on.")
+	end
+	return false
+end
+
+databaseStats:separator(" ")
+databaseStats:register()
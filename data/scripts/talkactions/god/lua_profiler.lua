@@ -0,0 +1,32 @@
+local luaProfiler = TalkAction("/luaprofiler")
+
+-- written next to the server binary, feed it to flamegraph.pl
+local foldedStacksFile = "lua_profiler.folded"
+
+function luaProfiler.onSay(player, words, param)
+	if not player:getGroup():getAccess() or player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return true
+	end
+
+	param = param:lower()
+	if param == "on" or param == "off" then
+		Game.setLuaProfiler(param == "on")
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Lua profiler " .. (param == "on" and "enabled." or "disabled."))
+		return false
+	end
+
+	local enabled = Game.reportLuaProfiler(param == "dump" and foldedStacksFile or "", param == "reset")
+	if enabled == nil then
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Could not write " .. foldedStacksFile .. ", check the console.")
+	elseif param == "dump" then
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Lua profile logged to the console and written to " .. foldedStacksFile .. ".")
+	elseif enabled then
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Lua profile logged to the console.")
+	else
+		player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Lua profiler is disabled, use /luaprofiler on.")
+	end
+	return false
+end
+
+luaProfiler:separator(" ")
+luaProfiler:register()
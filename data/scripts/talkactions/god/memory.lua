@@ -0,0 +1,13 @@
+local memory = TalkAction("/memory")
+
+function memory.onSay(player, words, param)
+	if not player:getGroup():getAccess() or player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return true
+	end
+
+	Game.reportMemory()
+	player:sendTextMessage(MESSAGE_EVENT_ADVANCE, "Memory by subsystem logged to the console.")
+	return false
+end
+
+memory:register()
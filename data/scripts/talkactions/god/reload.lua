@@ -30,6 +30,7 @@ local reloadTypes = {
 	["raids"] = RELOAD_TYPE_RAIDS,
 
 	["scripts"] = RELOAD_TYPE_SCRIPTS,
+	["changedscripts"] = RELOAD_TYPE_CHANGED_SCRIPTS,
 
 	["libs"] = RELOAD_TYPE_GLOBAL,
 
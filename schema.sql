@@ -7,7 +7,7 @@ CREATE TABLE IF NOT EXISTS `server_config` (
     CONSTRAINT `server_config_pk` PRIMARY KEY (`config`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
-INSERT INTO `server_config` (`config`, `value`) VALUES ('db_version', '3'), ('motd_hash', ''), ('motd_num', '0'), ('players_record', '0');
+INSERT INTO `server_config` (`config`, `value`) VALUES ('db_version', '5'), ('motd_hash', ''), ('motd_num', '0'), ('players_record', '0');
 
 -- Table structure `accounts`
 CREATE TABLE IF NOT EXISTS `accounts` (
@@ -435,6 +435,19 @@ CREATE TABLE IF NOT EXISTS `market_history` (
         ON DELETE CASCADE
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
+-- Table structure `market_statistics`
+CREATE TABLE IF NOT EXISTS `market_statistics` (
+    `sale` tinyint(1) NOT NULL DEFAULT '0',
+    `itemtype` int(10) UNSIGNED NOT NULL,
+    `tier` tinyint UNSIGNED NOT NULL DEFAULT '0',
+    `day` int(10) UNSIGNED NOT NULL,
+    `num` int(10) UNSIGNED NOT NULL DEFAULT '0',
+    `min` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+    `max` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+    `sum` bigint(20) UNSIGNED NOT NULL DEFAULT '0',
+    CONSTRAINT `market_statistics_pk` PRIMARY KEY (`sale`, `itemtype`, `tier`, `day`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
 -- Table structure `market_offers`
 CREATE TABLE IF NOT EXISTS `market_offers` (
     `id` int(11) NOT NULL AUTO_INCREMENT,
@@ -664,6 +677,18 @@ CREATE TABLE IF NOT EXISTS `player_stash` (
     `item_count` INT(32) NOT NULL
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
+-- Table structure `player_state`
+-- the items, depot, inbox, rewards, stash and storage of a player as compressed blobs, when playerBinaryState is on
+CREATE TABLE IF NOT EXISTS `player_state` (
+    `player_id` int(11) NOT NULL,
+    `component` tinyint(3) UNSIGNED NOT NULL,
+    `data` longblob NOT NULL,
+    CONSTRAINT `player_state_pk` PRIMARY KEY (`player_id`, `component`),
+    CONSTRAINT `player_state_players_fk`
+        FOREIGN KEY (`player_id`) REFERENCES `players` (`id`)
+        ON DELETE CASCADE
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
 -- Table structure `player_storage`
 CREATE TABLE IF NOT EXISTS `player_storage` (
     `player_id` int(11) NOT NULL DEFAULT '0',
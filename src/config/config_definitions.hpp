@@ -65,6 +65,7 @@ enum booleanConfig_t {
 	SORT_LOOT_BY_CHANCE,
 	TOGGLE_SAVE_INTERVAL,
 	TOGGLE_SAVE_INTERVAL_CLEAN_MAP,
+	FORKED_SERVER_SAVE,
 	PREY_ENABLED,
 	PREY_FREE_THIRD_SLOT,
 	TASK_HUNTING_ENABLED,
@@ -77,6 +78,27 @@ enum booleanConfig_t {
 	INVENTORY_GLOW,
 	TELEPORT_SUMMONS,
 	TOGGLE_DOWNLOAD_MAP,
+	DISPATCHER_PROFILER,
+	DISPATCHER_WATCHDOG,
+	THREAD_TOPOLOGY,
+	PARALLEL_CREATURE_THINK,
+	SLEEP_MONSTERS_WITHOUT_PLAYERS,
+	SLEEP_NPCS_WITHOUT_PLAYERS,
+	FLOW_FIELD_PATHFINDING,
+	HIERARCHICAL_PATHFINDING,
+	FOLLOW_TRAIL_PATHFINDING,
+	MAP_FLAT_LEAF_INDEX,
+	PARALLEL_MAP_LOADING,
+	ADAPTIVE_COMPRESSION,
+	DATABASE_STATS,
+	COMBAT_FORMULA_CACHE,
+	LUA_PROFILER,
+	LUA_BYTECODE_CACHE,
+	MONSTER_TYPE_CACHE,
+	ASYNC_LOGGING,
+	PLAYER_BINARY_STATE,
+	LAZY_DEPOT_LOADING,
+	MAP_STREAMING,
 
 	LAST_BOOLEAN_CONFIG
 	};
@@ -106,6 +128,18 @@ enum stringConfig_t {
 	DISCORD_WEBHOOK_URL,
 	SAVE_INTERVAL_TYPE,
 	GLOBAL_SERVER_SAVE_TIME,
+	METRICS_IP,
+	MYSQL_REPLICA_HOST,
+	MYSQL_REPLICA_USER,
+	MYSQL_REPLICA_PASS,
+	INPUT_TRACE_FILE,
+	DISPATCHER_WATCHDOG_FILE,
+	DISPATCHER_THREAD_CPUS,
+	SCHEDULER_THREAD_CPUS,
+	NETWORK_THREAD_CPUS,
+	DATABASE_THREAD_CPUS,
+	WORKER_THREAD_CPUS,
+	CACHE_DIRECTORY,
 
 	LAST_STRING_CONFIG
 	};
@@ -134,6 +168,7 @@ enum integerConfig_t {
 	GAME_PORT,
 	LOGIN_PORT,
 	STATUS_PORT,
+	METRICS_PORT,
 	STAIRHOP_DELAY,
 	MAX_CONTAINER,
 	MAX_ITEM,
@@ -143,6 +178,7 @@ enum integerConfig_t {
 	PREMIUM_DEPOT_LIMIT,
 	CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES,
 	MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER,
+	MARKET_STATISTICS_DAYS,
 	EXP_FROM_PLAYERS_LEVEL_RANGE,
 	MAX_PACKETS_PER_SECOND,
 	COMPRESSION_LEVEL,
@@ -180,6 +216,41 @@ enum integerConfig_t {
 	CRITICALCHANCE,
 	ADVENTURERSBLESSING_LEVEL,
 	MAX_ITEM_FORGE_TIER,
+	DISPATCHER_PROFILER_INTERVAL,
+	DISPATCHER_PROFILER_TOP_COUNT,
+	DISPATCHER_BUSY_LAG,
+	DISPATCHER_OVERLOAD_LAG,
+	MAX_MESSAGES_PER_WRITE,
+	NETWORK_THREADS,
+	NETWORK_RECEIVE_BUFFER,
+	OUTPUT_QUEUE_DEGRADE_BYTES,
+	OUTPUT_QUEUE_MAX_BYTES,
+	SESSION_RESUME_TIME,
+	RSA_WORKERS,
+	RSA_QUEUE_SIZE,
+	DATABASE_WORKERS,
+	LOGIN_CACHE_TIME,
+	PLAYER_STORAGE_FLUSH_INTERVAL,
+	HIGHSCORES_REFRESH_INTERVAL,
+	DATABASE_SLOW_QUERY_THRESHOLD,
+	RANDOM_SEED,
+	LUA_GC_IDLE_BUDGET,
+	LUA_WORKERS,
+	LUA_WORKER_QUEUE_SIZE,
+	LUA_WORKER_TIMEOUT,
+	ASYNC_LOGGING_QUEUE_SIZE,
+	MYSQL_REPLICA_PORT,
+	MYSQL_REPLICA_CONSISTENCY_TIME,
+	GUILD_CACHE_TIME,
+	MAP_STREAMING_UNLOAD_TIME,
+	INPUT_TRACE_MAX_SIZE,
+	DISPATCHER_WATCHDOG_TASK_THRESHOLD,
+	DISPATCHER_WATCHDOG_CYCLE_THRESHOLD,
+	DISPATCHER_THREAD_NUMA_NODE,
+	SCHEDULER_THREAD_NUMA_NODE,
+	NETWORK_THREAD_NUMA_NODE,
+	DATABASE_THREAD_NUMA_NODE,
+	WORKER_THREAD_NUMA_NODE,
 
 	LAST_INTEGER_CONFIG
 };
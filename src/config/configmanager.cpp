@@ -112,6 +112,15 @@ bool ConfigManager::load()
 		boolean[TOGGLE_MAP_CUSTOM] = getGlobalBoolean(L, "toggleMapCustom", true);
 
 		string[IP] = getGlobalString(L, "ip", "127.0.0.1");
+		string[METRICS_IP] = getGlobalString(L, "metricsIp", "127.0.0.1");
+		string[INPUT_TRACE_FILE] = getGlobalString(L, "inputTraceFile", "");
+		string[DISPATCHER_WATCHDOG_FILE] = getGlobalString(L, "dispatcherWatchdogFile", "dispatcher_stalls.log");
+		string[DISPATCHER_THREAD_CPUS] = getGlobalString(L, "dispatcherThreadCpus", "");
+		string[SCHEDULER_THREAD_CPUS] = getGlobalString(L, "schedulerThreadCpus", "");
+		string[NETWORK_THREAD_CPUS] = getGlobalString(L, "networkThreadCpus", "");
+		string[DATABASE_THREAD_CPUS] = getGlobalString(L, "databaseThreadCpus", "");
+		string[WORKER_THREAD_CPUS] = getGlobalString(L, "workerThreadCpus", "");
+		string[CACHE_DIRECTORY] = getGlobalString(L, "cacheDirectory", "");
 		string[MAP_NAME] = getGlobalString(L, "mapName", "canary");
 		string[MAP_DOWNLOAD_URL] = getGlobalString(L, "mapDownloadUrl", "");
 		string[MAP_AUTHOR] = getGlobalString(L, "mapAuthor", "Eduardo Dantas");
@@ -125,11 +134,16 @@ bool ConfigManager::load()
 		string[MYSQL_PASS] = getGlobalString(L, "mysqlPass", "");
 		string[MYSQL_DB] = getGlobalString(L, "mysqlDatabase", "canary");
 		string[MYSQL_SOCK] = getGlobalString(L, "mysqlSock", "");
+		string[MYSQL_REPLICA_HOST] = getGlobalString(L, "mysqlReplicaHost", "");
+		string[MYSQL_REPLICA_USER] = getGlobalString(L, "mysqlReplicaUser", "");
+		string[MYSQL_REPLICA_PASS] = getGlobalString(L, "mysqlReplicaPass", "");
 
 		integer[SQL_PORT] = getGlobalNumber(L, "mysqlPort", 3306);
+		integer[MYSQL_REPLICA_PORT] = getGlobalNumber(L, "mysqlReplicaPort", 3306);
 		integer[GAME_PORT] = getGlobalNumber(L, "gameProtocolPort", 7172);
 		integer[LOGIN_PORT] = getGlobalNumber(L, "loginProtocolPort", 7171);
 		integer[STATUS_PORT] = getGlobalNumber(L, "statusProtocolPort", 7171);
+		integer[METRICS_PORT] = getGlobalNumber(L, "metricsPort", 0);
 
 		integer[MARKET_OFFER_DURATION] = getGlobalNumber(L, "marketOfferDuration", 30 * 24 * 60 * 60);
 
@@ -181,6 +195,7 @@ bool ConfigManager::load()
 	boolean[STAMINA_PZ] = getGlobalBoolean(L, "staminaPz", false);
 	boolean[SORT_LOOT_BY_CHANCE] = getGlobalBoolean(L, "sortLootByChance", false);
 	boolean[TOGGLE_SAVE_INTERVAL] = getGlobalBoolean(L, "toggleSaveInterval", false);
+	boolean[FORKED_SERVER_SAVE] = getGlobalBoolean(L, "forkedServerSave", false);
 	boolean[TOGGLE_SAVE_INTERVAL_CLEAN_MAP] = getGlobalBoolean(L, "toggleSaveIntervalCleanMap", false);
 	boolean[TELEPORT_SUMMONS] = getGlobalBoolean(L, "teleportSummons", false);
 
@@ -189,6 +204,27 @@ bool ConfigManager::load()
 	boolean[TOGGLE_IMBUEMENT_SHRINE_STORAGE] = getGlobalBoolean(L, "toggleImbuementShrineStorage", true);
 
 	boolean[TOGGLE_DOWNLOAD_MAP] = getGlobalBoolean(L, "toggleDownloadMap", false);
+	boolean[DISPATCHER_PROFILER] = getGlobalBoolean(L, "dispatcherProfiler", false);
+	boolean[DISPATCHER_WATCHDOG] = getGlobalBoolean(L, "dispatcherWatchdog", false);
+	boolean[THREAD_TOPOLOGY] = getGlobalBoolean(L, "threadTopology", false);
+	boolean[PARALLEL_CREATURE_THINK] = getGlobalBoolean(L, "parallelCreatureThink", false);
+	boolean[SLEEP_MONSTERS_WITHOUT_PLAYERS] = getGlobalBoolean(L, "sleepMonstersWithoutPlayers", true);
+	boolean[SLEEP_NPCS_WITHOUT_PLAYERS] = getGlobalBoolean(L, "sleepNpcsWithoutPlayers", true);
+	boolean[FLOW_FIELD_PATHFINDING] = getGlobalBoolean(L, "flowFieldPathfinding", false);
+	boolean[HIERARCHICAL_PATHFINDING] = getGlobalBoolean(L, "hierarchicalPathfinding", false);
+	boolean[FOLLOW_TRAIL_PATHFINDING] = getGlobalBoolean(L, "followTrailPathfinding", false);
+	boolean[MAP_FLAT_LEAF_INDEX] = getGlobalBoolean(L, "mapFlatLeafIndex", true);
+	boolean[PARALLEL_MAP_LOADING] = getGlobalBoolean(L, "parallelMapLoading", true);
+	boolean[MAP_STREAMING] = getGlobalBoolean(L, "mapStreaming", false);
+	boolean[ADAPTIVE_COMPRESSION] = getGlobalBoolean(L, "packetCompressionAdaptive", true);
+	boolean[DATABASE_STATS] = getGlobalBoolean(L, "databaseStats", false);
+	boolean[COMBAT_FORMULA_CACHE] = getGlobalBoolean(L, "combatFormulaCache", false);
+	boolean[LUA_PROFILER] = getGlobalBoolean(L, "luaProfiler", false);
+	boolean[LUA_BYTECODE_CACHE] = getGlobalBoolean(L, "luaBytecodeCache", false);
+	boolean[MONSTER_TYPE_CACHE] = getGlobalBoolean(L, "monsterTypeCache", false);
+	boolean[ASYNC_LOGGING] = getGlobalBoolean(L, "asyncLogging", false);
+	boolean[PLAYER_BINARY_STATE] = getGlobalBoolean(L, "playerBinaryState", false);
+	boolean[LAZY_DEPOT_LOADING] = getGlobalBoolean(L, "lazyDepotLoading", true);
 
 	string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	string[SERVER_NAME] = getGlobalString(L, "serverName", "");
@@ -228,6 +264,7 @@ bool ConfigManager::load()
 	integer[EXP_FROM_PLAYERS_LEVEL_RANGE] = getGlobalNumber(L, "expFromPlayersLevelRange", 75);
 	integer[CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES] = getGlobalNumber(L, "checkExpiredMarketOffersEachMinutes", 60);
 	integer[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
+	integer[MARKET_STATISTICS_DAYS] = getGlobalNumber(L, "marketStatisticsDays", 0);
 	integer[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
 	integer[COMPRESSION_LEVEL] = getGlobalNumber(L, "packetCompressionLevel", 6);
 	integer[STORE_COIN_PACKET] = getGlobalNumber(L, "coinPacketSize", 25);
@@ -258,6 +295,40 @@ bool ConfigManager::load()
 	boolean[INVENTORY_GLOW] = getGlobalBoolean(L, "inventoryGlowOnFiveBless", false);
 	integer[ADVENTURERSBLESSING_LEVEL] = getGlobalNumber(L, "adventurersBlessingLevel", 21);
 	integer[MAX_ITEM_FORGE_TIER] = getGlobalNumber(L, "forgeMaxItemTier", 10);
+	integer[DISPATCHER_PROFILER_INTERVAL] = getGlobalNumber(L, "dispatcherProfilerInterval", 60);
+	integer[DISPATCHER_PROFILER_TOP_COUNT] = getGlobalNumber(L, "dispatcherProfilerTopCount", 10);
+	integer[DISPATCHER_BUSY_LAG] = getGlobalNumber(L, "dispatcherBusyLag", 50);
+	integer[DISPATCHER_OVERLOAD_LAG] = getGlobalNumber(L, "dispatcherOverloadLag", 250);
+	integer[MAX_MESSAGES_PER_WRITE] = getGlobalNumber(L, "maxMessagesPerWrite", 64);
+	integer[NETWORK_RECEIVE_BUFFER] = getGlobalNumber(L, "networkReceiveBuffer", 0);
+	integer[NETWORK_THREADS] = getGlobalNumber(L, "networkThreads", 1);
+	integer[SESSION_RESUME_TIME] = getGlobalNumber(L, "sessionResumeTime", 60);
+	integer[OUTPUT_QUEUE_DEGRADE_BYTES] = getGlobalNumber(L, "outputQueueDegradeBytes", 256 * 1024);
+	integer[OUTPUT_QUEUE_MAX_BYTES] = getGlobalNumber(L, "outputQueueMaxBytes", 8 * 1024 * 1024);
+	integer[RSA_WORKERS] = getGlobalNumber(L, "rsaWorkers", 2);
+	integer[RSA_QUEUE_SIZE] = getGlobalNumber(L, "rsaQueueSize", 512);
+	integer[DATABASE_WORKERS] = getGlobalNumber(L, "databaseWorkers", 2);
+	integer[LOGIN_CACHE_TIME] = getGlobalNumber(L, "loginCacheTime", 10);
+	integer[PLAYER_STORAGE_FLUSH_INTERVAL] = getGlobalNumber(L, "playerStorageFlushInterval", 60);
+	integer[HIGHSCORES_REFRESH_INTERVAL] = getGlobalNumber(L, "highscoresRefreshInterval", 600);
+	integer[DATABASE_SLOW_QUERY_THRESHOLD] = getGlobalNumber(L, "databaseSlowQueryThreshold", 100);
+	integer[RANDOM_SEED] = getGlobalNumber(L, "randomSeed", 0);
+	integer[INPUT_TRACE_MAX_SIZE] = getGlobalNumber(L, "inputTraceMaxSize", 1024);
+	integer[DISPATCHER_WATCHDOG_TASK_THRESHOLD] = getGlobalNumber(L, "dispatcherWatchdogTaskThreshold", 250);
+	integer[DISPATCHER_WATCHDOG_CYCLE_THRESHOLD] = getGlobalNumber(L, "dispatcherWatchdogCycleThreshold", 1000);
+	integer[DISPATCHER_THREAD_NUMA_NODE] = getGlobalNumber(L, "dispatcherThreadNumaNode", -1);
+	integer[SCHEDULER_THREAD_NUMA_NODE] = getGlobalNumber(L, "schedulerThreadNumaNode", -1);
+	integer[NETWORK_THREAD_NUMA_NODE] = getGlobalNumber(L, "networkThreadNumaNode", -1);
+	integer[DATABASE_THREAD_NUMA_NODE] = getGlobalNumber(L, "databaseThreadNumaNode", -1);
+	integer[WORKER_THREAD_NUMA_NODE] = getGlobalNumber(L, "workerThreadNumaNode", -1);
+	integer[LUA_GC_IDLE_BUDGET] = getGlobalNumber(L, "luaGcIdleBudget", 1000);
+	integer[LUA_WORKERS] = getGlobalNumber(L, "luaWorkers", 2);
+	integer[LUA_WORKER_QUEUE_SIZE] = getGlobalNumber(L, "luaWorkerQueueSize", 1024);
+	integer[LUA_WORKER_TIMEOUT] = getGlobalNumber(L, "luaWorkerTimeout", 1000);
+	integer[ASYNC_LOGGING_QUEUE_SIZE] = getGlobalNumber(L, "asyncLoggingQueueSize", 8192);
+	integer[MYSQL_REPLICA_CONSISTENCY_TIME] = getGlobalNumber(L, "mysqlReplicaConsistencyTime", 10);
+	integer[GUILD_CACHE_TIME] = getGlobalNumber(L, "guildCacheTime", 60);
+	integer[MAP_STREAMING_UNLOAD_TIME] = getGlobalNumber(L, "mapStreamingUnloadTime", 600);
 
 	floating[RATE_HEALTH_REGEN] = getGlobalFloat(L, "rateHealthRegen", 1.0);
 	floating[RATE_HEALTH_REGEN_SPEED] = getGlobalFloat(L, "rateHealthRegenSpeed", 1.0);
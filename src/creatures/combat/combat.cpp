@@ -28,6 +28,45 @@
 #include "creatures/monsters/monsters.h"
 #include "items/weapons/weapons.h"
 
+namespace {
+
+/**
+ * Tile buffer of one CombatFunc call, reused by later casts instead of
+ * allocating a list per tile. Combat callbacks may cast again from inside
+ * CombatFunc, so there is one buffer per nesting level (dispatcher thread only).
+ */
+class CombatTileList
+{
+	public:
+		CombatTileList() {
+			if (depth == buffers.size()) {
+				buffers.emplace_back();
+			}
+			list = &buffers[depth++];
+			list->clear();
+		}
+		~CombatTileList() {
+			--depth;
+		}
+
+		// non-copyable
+		CombatTileList(const CombatTileList&) = delete;
+		CombatTileList& operator=(const CombatTileList&) = delete;
+
+		std::vector<Tile*>& get() {
+			return *list;
+		}
+
+	private:
+		// a deque keeps the outer levels' buffers in place when a level is added
+		static inline std::deque<std::vector<Tile*>> buffers;
+		static inline size_t depth = 0;
+
+		std::vector<Tile*>* list;
+};
+
+}  // namespace
+
 CombatDamage Combat::getCombatDamage(Creature* creature, Creature* target) const
 {
 	CombatDamage damage;
@@ -80,7 +119,7 @@ CombatDamage Combat::getCombatDamage(Creature* creature, Creature* target) const
 	return damage;
 }
 
-void Combat::getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::forward_list<Tile*>& list)
+void Combat::getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::vector<Tile*>& list)
 {
 	if (targetPos.z >= MAP_MAX_LAYERS) {
 		return;
@@ -94,7 +133,7 @@ void Combat::getCombatArea(const Position& centerPos, const Position& targetPos,
 			tile = new StaticTile(targetPos.x, targetPos.y, targetPos.z);
 			g_game().map.setTile(targetPos, tile);
 		}
-		list.push_front(tile);
+		list.push_back(tile);
 	}
 }
 
@@ -261,6 +300,9 @@ ReturnValue Combat::canDoCombat(Creature* caster, Tile* tile, bool aggressive)
 		return RETURNVALUE_ACTIONNOTPERMITTEDINPROTECTIONZONE;
 	}
 
+	if (!g_events().hasListener(EVENT_HOOK_CREATURE_ON_AREA_COMBAT)) {
+		return RETURNVALUE_NOERROR;
+	}
 	return g_events().eventCreatureOnAreaCombat(caster, tile, aggressive);
 }
 
@@ -818,7 +860,8 @@ void Combat::doCombat(Creature* caster, const Position& position) const
 
 void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat* area, const CombatParams& params, CombatFunction func, CombatDamage* data)
 {
-	std::forward_list<Tile*> tileList;
+	CombatTileList combatTiles;
+	std::vector<Tile*>& tileList = combatTiles.get();
 
 	if (caster) {
 		getCombatArea(caster->getPosition(), pos, area, tileList);
@@ -826,34 +869,23 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 		getCombatArea(pos, pos, area, tileList);
 	}
 
-	SpectatorHashSet spectators;
 	uint32_t maxX = 0;
 	uint32_t maxY = 0;
+	int affected = 0;
 
-	//calculate the max viewable range
-	for (Tile* tile : tileList) {
+	// one pass: the max viewable range covers every tile, then only the tiles
+	// that allow combat are kept and their targets counted
+	size_t combatTileCount = 0;
+	for (size_t i = 0, size = tileList.size(); i < size; ++i) {
+		Tile* tile = tileList[i];
 		const Position& tilePos = tile->getPosition();
+		maxX = std::max<uint32_t>(maxX, Position::getDistanceX(tilePos, pos));
+		maxY = std::max<uint32_t>(maxY, Position::getDistanceY(tilePos, pos));
 
-		uint32_t diff = Position::getDistanceX(tilePos, pos);
-		if (diff > maxX) {
-			maxX = diff;
-		}
-
-		diff = Position::getDistanceY(tilePos, pos);
-		if (diff > maxY) {
-			maxY = diff;
-		}
-	}
-
-	const int32_t rangeX = maxX + Map::maxViewportX;
-	const int32_t rangeY = maxY + Map::maxViewportY;
-	g_game().map.getSpectators(spectators, pos, true, true, rangeX, rangeX, rangeY, rangeY);
-
-	int affected = 0;
-	for (Tile* tile : tileList) {
 		if (canDoCombat(caster, tile, params.aggressive) != RETURNVALUE_NOERROR) {
 			continue;
 		}
+		tileList[combatTileCount++] = tile;
 
 		if (CreatureVector* creatures = tile->getCreatures()) {
 			const Creature* topCreature = tile->getTopCreature();
@@ -874,7 +906,13 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 			}
 		}
 	}
-	//
+	tileList.resize(combatTileCount);
+
+	SpectatorHashSet spectators;
+	const int32_t rangeX = maxX + Map::maxViewportX;
+	const int32_t rangeY = maxY + Map::maxViewportY;
+	g_game().map.getSpectators(spectators, pos, true, true, rangeX, rangeX, rangeY, rangeY);
+
 	CombatDamage tmpDamage;
 	if (data) {
 		tmpDamage.origin = data->origin;
@@ -887,11 +925,12 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 	}
 
 	tmpDamage.affected = affected;
-	for (Tile* tile : tileList) {
-		if (canDoCombat(caster, tile, params.aggressive) != RETURNVALUE_NOERROR) {
-			continue;
-		}
 
+	// every hit and tile effect queries the spectators of its own position; the
+	// targets of a big area share leaves, so those are read once per leaf and floor
+	bool spectatorBatch = tileList.size() >= COMBAT_SPECTATOR_BATCH_TILES;
+	bool previousBatch = spectatorBatch && g_game().map.setSpectatorBatch(true);
+	for (Tile* tile : tileList) {
 		if (CreatureVector* creatures = tile->getCreatures()) {
 			const Creature* topCreature = tile->getTopCreature();
 			for (Creature* creature : *creatures) {
@@ -920,6 +959,10 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 		combatTileEffects(spectators, caster, tile, params);
 	}
 
+	if (spectatorBatch) {
+		g_game().map.setSpectatorBatch(previousBatch);
+	}
+
 	postCombatEffects(caster, pos, params);
 }
 
@@ -1137,43 +1180,19 @@ void Combat::doCombatDefault(Creature* caster, Creature* target, const CombatPar
 
 void ValueCallback::getMinMaxValues(Player* player, CombatDamage& damage, bool useCharges) const
 {
-	//onGetPlayerMinMaxValues(...)
-	if (!scriptInterface->reserveScriptEnv()) {
-		SPDLOG_ERROR("[ValueCallback::getMinMaxValues - Player {} formula {}] "
-                     "Call stack overflow. Too many lua script calls being nested.",
-                     player->getName(), type);
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface->getScriptEnv();
-	if (!env->setCallbackId(scriptId, scriptInterface)) {
-		scriptInterface->resetScriptEnv();
-		return;
-	}
-
-	lua_State* L = scriptInterface->getLuaState();
-
-	scriptInterface->pushFunction(scriptId);
-
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
 	int16_t elementAttack = 0; // To calculate elemental damage after executing spell script and get real damage.
 	int32_t attackValue = 7; // default start attack value
-	int parameters = 1;
+	float attackFactor = 0;
 	bool shouldCalculateSecondaryDamage = false;
+	FormulaCacheKey key;
 
 	switch (type) {
 		case COMBAT_FORMULA_LEVELMAGIC: {
-			//onGetPlayerMinMaxValues(player, level, maglevel)
-			lua_pushnumber(L, player->getLevel());
-			lua_pushnumber(L, player->getMagicLevel());
-			parameters += 2;
+			key = {player->getLevel(), player->getMagicLevel(), 0};
 			break;
 		}
 
 		case COMBAT_FORMULA_SKILL: {
-			//onGetPlayerMinMaxValues(player, attackSkill, attackValue, attackFactor)
 			Item* tool = player->getWeapon();
 			const Weapon* weapon = g_weapons().getWeapon(tool);
 			Item* item = nullptr;
@@ -1209,44 +1228,98 @@ void ValueCallback::getMinMaxValues(Player* player, CombatDamage& damage, bool u
 				}
 			}
 
-			lua_pushnumber(L, player->getWeaponSkill(item ? item : tool));
-			lua_pushnumber(L, attackValue);
-			lua_pushnumber(L, player->getAttackFactor());
-			parameters += 3;
+			attackFactor = player->getAttackFactor();
+			uint32_t attackFactorBits;
+			std::memcpy(&attackFactorBits, &attackFactor, sizeof(attackFactorBits));
+			key = {static_cast<uint32_t>(player->getWeaponSkill(item ? item : tool)), static_cast<uint32_t>(attackValue), attackFactorBits};
 			break;
 		}
 
 		default: {
 			SPDLOG_WARN("[ValueCallback::getMinMaxValues] - Unknown callback type");
-			scriptInterface->resetScriptEnv();
 			return;
 		}
 	}
 
-	int size0 = lua_gettop(L);
-	if (lua_pcall(L, parameters, 2, 0) != 0) {
-		LuaScriptInterface::reportError(nullptr, LuaScriptInterface::popString(L));
+	int32_t min;
+	int32_t max;
+	if (!g_configManager().getBoolean(COMBAT_FORMULA_CACHE)) {
+		if (!callFormula(player, key, attackFactor, min, max)) {
+			return;
+		}
+	} else if (auto it = formulaCache.find(key); it != formulaCache.end()) {
+		std::tie(min, max) = it->second;
+	} else {
+		if (!callFormula(player, key, attackFactor, min, max)) {
+			return;
+		}
+
+		if (formulaCache.size() >= FORMULA_CACHE_MAX_ENTRIES) {
+			formulaCache.clear();
+		}
+		formulaCache.emplace(key, std::make_pair(min, max));
 	}
-	else {
 
-		int32_t defaultDmg = normal_random(
-			LuaScriptInterface::getNumber<int32_t>(L, -2),
-			LuaScriptInterface::getNumber<int32_t>(L, -1)
-		);
+	int32_t defaultDmg = normal_random(min, max);
+	if (shouldCalculateSecondaryDamage) {
+		double factor = (double)elementAttack / (double)attackValue; //attack value here is phys dmg + element dmg
+		int32_t elementDamage = std::round(defaultDmg * factor);
+		int32_t physDmg = std::round(defaultDmg * (1.0 - factor));
+		damage.primary.value = physDmg;
+		damage.secondary.value = elementDamage;
 
-		if (shouldCalculateSecondaryDamage) {
-			double factor = (double)elementAttack / (double)attackValue; //attack value here is phys dmg + element dmg
-			int32_t elementDamage = std::round(defaultDmg * factor);
-			int32_t physDmg = std::round(defaultDmg * (1.0 - factor));
-			damage.primary.value = physDmg;
-			damage.secondary.value = elementDamage;
+	} else {
+		damage.primary.value = defaultDmg;
+		damage.secondary.type = COMBAT_NONE;
+		damage.secondary.value = 0;
+	}
+}
 
-		} else {
-			damage.primary.value = defaultDmg;
-			damage.secondary.type = COMBAT_NONE;
-			damage.secondary.value = 0;
-		}
+bool ValueCallback::callFormula(Player* player, const FormulaCacheKey& key, float attackFactor, int32_t& min, int32_t& max) const
+{
+	//onGetPlayerMinMaxValues(...)
+	if (!scriptInterface->reserveScriptEnv()) {
+		SPDLOG_ERROR("[ValueCallback::getMinMaxValues - Player {} formula {}] "
+                     "Call stack overflow. Too many lua script calls being nested.",
+                     player->getName(), type);
+		return false;
+	}
 
+	ScriptEnvironment* env = scriptInterface->getScriptEnv();
+	if (!env->setCallbackId(scriptId, scriptInterface)) {
+		scriptInterface->resetScriptEnv();
+		return false;
+	}
+
+	lua_State* L = scriptInterface->getLuaState();
+
+	scriptInterface->pushFunction(scriptId);
+
+	LuaScriptInterface::pushUserdata<Player>(L, player);
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
+
+	int parameters = 1;
+	if (type == COMBAT_FORMULA_LEVELMAGIC) {
+		//onGetPlayerMinMaxValues(player, level, maglevel)
+		lua_pushnumber(L, key.first);
+		lua_pushnumber(L, key.second);
+		parameters += 2;
+	} else {
+		//onGetPlayerMinMaxValues(player, attackSkill, attackValue, attackFactor)
+		lua_pushnumber(L, key.first);
+		lua_pushnumber(L, static_cast<int32_t>(key.second));
+		lua_pushnumber(L, attackFactor);
+		parameters += 3;
+	}
+
+	bool result = false;
+	int size0 = lua_gettop(L);
+	if (lua_pcall(L, parameters, 2, 0) != 0) {
+		LuaScriptInterface::reportError(nullptr, LuaScriptInterface::popString(L));
+	} else {
+		min = LuaScriptInterface::getNumber<int32_t>(L, -2);
+		max = LuaScriptInterface::getNumber<int32_t>(L, -1);
+		result = true;
 		lua_pop(L, 2);
 	}
 
@@ -1255,6 +1328,7 @@ void ValueCallback::getMinMaxValues(Player* player, CombatDamage& damage, bool u
 	}
 
 	scriptInterface->resetScriptEnv();
+	return result;
 }
 
 //**********************************************************//
@@ -1349,6 +1423,10 @@ void AreaCombat::clear()
 		delete it.second;
 	}
 	areas.clear();
+
+	for (auto& areaOffsets : offsets) {
+		areaOffsets.clear();
+	}
 }
 
 AreaCombat::AreaCombat(const AreaCombat& rhs)
@@ -1357,34 +1435,44 @@ AreaCombat::AreaCombat(const AreaCombat& rhs)
 	for (const auto& it : rhs.areas) {
 		areas[it.first] = new MatrixArea(*it.second);
 	}
+	offsets = rhs.offsets;
 }
 
-void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::forward_list<Tile*>& list) const
+void AreaCombat::setArea(Direction dir, MatrixArea* area)
 {
-	const MatrixArea* area = getArea(centerPos, targetPos);
-	if (!area) {
-		return;
-	}
+	areas[dir] = area;
 
 	uint32_t centerY, centerX;
 	area->getCenter(centerY, centerX);
 
-	Position tmpPos(targetPos.x - centerX, targetPos.y - centerY, targetPos.z);
-	uint32_t cols = area->getCols();
+	std::vector<AreaOffset>& areaOffsets = offsets[dir];
+	areaOffsets.clear();
 	for (uint32_t y = 0, rows = area->getRows(); y < rows; ++y) {
-		for (uint32_t x = 0; x < cols; ++x) {
-			if (area->getValue(y, x) != 0 && g_game().isSightClear(targetPos, tmpPos, true)) {
-				Tile* tile = g_game().map.getTile(tmpPos);
-				if (!tile) {
-					tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
-					g_game().map.setTile(tmpPos, tile);
-				}
-				list.push_front(tile);
+		for (uint32_t x = 0, cols = area->getCols(); x < cols; ++x) {
+			if (area->getValue(y, x)) {
+				areaOffsets.push_back({static_cast<int32_t>(x - centerX), static_cast<int32_t>(y - centerY)});
 			}
-			tmpPos.x++;
 		}
-		tmpPos.x -= cols;
-		tmpPos.y++;
+	}
+	areaOffsets.shrink_to_fit();
+}
+
+void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const
+{
+	const std::vector<AreaOffset>& areaOffsets = offsets[getDirection(centerPos, targetPos)];
+	list.reserve(list.size() + areaOffsets.size());
+	for (const AreaOffset& offset : areaOffsets) {
+		Position tmpPos(targetPos.x + offset.x, targetPos.y + offset.y, targetPos.z);
+		if (!g_game().isSightClear(targetPos, tmpPos, true)) {
+			continue;
+		}
+
+		Tile* tile = g_game().map.getTile(tmpPos);
+		if (!tile) {
+			tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
+			g_game().map.setTile(tmpPos, tile);
+		}
+		list.push_back(tile);
 	}
 }
 
@@ -1508,24 +1596,24 @@ void AreaCombat::setupArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* area = createArea(list, rows);
 
 	//NORTH
-	areas[DIRECTION_NORTH] = area;
+	setArea(DIRECTION_NORTH, area);
 
 	uint32_t maxOutput = std::max<uint32_t>(area->getCols(), area->getRows()) * 2;
 
 	//SOUTH
 	MatrixArea* southArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, southArea, MATRIXOPERATION_ROTATE180);
-	areas[DIRECTION_SOUTH] = southArea;
+	setArea(DIRECTION_SOUTH, southArea);
 
 	//EAST
 	MatrixArea* eastArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, eastArea, MATRIXOPERATION_ROTATE90);
-	areas[DIRECTION_EAST] = eastArea;
+	setArea(DIRECTION_EAST, eastArea);
 
 	//WEST
 	MatrixArea* westArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, westArea, MATRIXOPERATION_ROTATE270);
-	areas[DIRECTION_WEST] = westArea;
+	setArea(DIRECTION_WEST, westArea);
 }
 
 void AreaCombat::setupArea(int32_t length, int32_t spread)
@@ -1608,24 +1696,24 @@ void AreaCombat::setupExtArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* area = createArea(list, rows);
 
 	//NORTH-WEST
-	areas[DIRECTION_NORTHWEST] = area;
+	setArea(DIRECTION_NORTHWEST, area);
 
 	uint32_t maxOutput = std::max<uint32_t>(area->getCols(), area->getRows()) * 2;
 
 	//NORTH-EAST
 	MatrixArea* neArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, neArea, MATRIXOPERATION_MIRROR);
-	areas[DIRECTION_NORTHEAST] = neArea;
+	setArea(DIRECTION_NORTHEAST, neArea);
 
 	//SOUTH-WEST
 	MatrixArea* swArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, swArea, MATRIXOPERATION_FLIP);
-	areas[DIRECTION_SOUTHWEST] = swArea;
+	setArea(DIRECTION_SOUTHWEST, swArea);
 
 	//SOUTH-EAST
 	MatrixArea* seArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(swArea, seArea, MATRIXOPERATION_MIRROR);
-	areas[DIRECTION_SOUTHEAST] = seArea;
+	setArea(DIRECTION_SOUTHEAST, seArea);
 }
 
 //**********************************************************//
@@ -30,6 +30,28 @@ class Creature;
 class Item;
 
 //for luascript callback
+// the formula inputs: level and magic level, or skill, attack value and attack factor
+struct FormulaCacheKey {
+	uint32_t first;
+	uint32_t second;
+	uint32_t third;
+
+	bool operator==(const FormulaCacheKey& other) const {
+		return first == other.first && second == other.second && third == other.third;
+	}
+};
+
+struct FormulaCacheKeyHash {
+	size_t operator()(const FormulaCacheKey& key) const {
+		uint64_t hash = (static_cast<uint64_t>(key.first) << 32) | key.second;
+		hash = hash * 31 + key.third;
+		return std::hash<uint64_t>()(hash);
+	}
+};
+
+// the cache of a formula is dropped as a whole when it grows past this many entries
+static constexpr size_t FORMULA_CACHE_MAX_ENTRIES = 4096;
+
 class ValueCallback final : public CallBack
 {
 	public:
@@ -37,7 +59,15 @@ class ValueCallback final : public CallBack
 		void getMinMaxValues(Player* player, CombatDamage& damage, bool useCharges) const;
 
 	private:
+		// runs the formula script, returns false if it failed
+		bool callFormula(Player* player, const FormulaCacheKey& key, float attackFactor, int32_t& min, int32_t& max) const;
+
 		formulaType_t type;
+		/**
+		 * Min and max results by formula inputs, when combatFormulaCache is set.
+		 * Lives as long as the callback, so reloading the scripts drops it.
+		 */
+		mutable phmap::flat_hash_map<FormulaCacheKey, std::pair<int32_t, int32_t>, FormulaCacheKeyHash> formulaCache;
 };
 
 class TileCallback final : public CallBack
@@ -81,6 +111,9 @@ struct CombatParams {
 	bool useCharges = false;
 };
 
+// below this many tiles in one cast the spectators of each target are looked up on their own
+static constexpr size_t COMBAT_SPECTATOR_BATCH_TILES = 16;
+
 using CombatFunction = std::function<void(Creature*, Creature*, const CombatParams&, CombatDamage*)>;
 
 class MatrixArea
@@ -178,7 +211,7 @@ class AreaCombat
 		// non-assignable
 		AreaCombat& operator=(const AreaCombat&) = delete;
 
-		void getList(const Position& centerPos, const Position& targetPos, std::forward_list<Tile*>& list) const;
+		void getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const;
 
 		void setupArea(const std::list<uint32_t>& list, uint32_t rows);
 		void setupArea(int32_t length, int32_t spread);
@@ -187,10 +220,18 @@ class AreaCombat
 		void clear();
 
 	private:
+		// position of an area tile relative to the target position
+		struct AreaOffset {
+			int32_t x;
+			int32_t y;
+		};
+
 		MatrixArea* createArea(const std::list<uint32_t>& list, uint32_t rows);
 		void copyArea(const MatrixArea* input, MatrixArea* output, MatrixOperation_t op) const;
+		// stores the matrix of a direction and compiles its tile offsets
+		void setArea(Direction dir, MatrixArea* area);
 
-		MatrixArea* getArea(const Position& centerPos, const Position& targetPos) const {
+		Direction getDirection(const Position& centerPos, const Position& targetPos) const {
 			int32_t dx = Position::getOffsetX(targetPos, centerPos);
 			int32_t dy = Position::getOffsetY(targetPos, centerPos);
 
@@ -216,15 +257,12 @@ class AreaCombat
 					dir = DIRECTION_SOUTHEAST;
 				}
 			}
-
-			auto it = areas.find(dir);
-			if (it == areas.end()) {
-				return nullptr;
-			}
-			return it->second;
+			return dir;
 		}
 
 		std::map<Direction, MatrixArea*> areas;
+		// the set cells of each matrix, walked on every cast instead of the matrix
+		std::array<std::vector<AreaOffset>, DIRECTION_LAST + 1> offsets;
 		bool hasExtArea = false;
 };
 
@@ -249,7 +287,7 @@ class Combat
 		static void doCombatDispel(Creature* caster, Creature* target, const CombatParams& params);
 		static void doCombatDispel(Creature* caster, const Position& position, const AreaCombat* area, const CombatParams& params);
 
-		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::forward_list<Tile*>& list);
+		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::vector<Tile*>& list);
 
 		static bool isInPvpZone(const Creature* attacker, const Creature* target);
 		static bool isProtected(const Player* attacker, const Player* target);
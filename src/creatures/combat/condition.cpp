@@ -1306,14 +1306,23 @@ bool ConditionDamage::getNextDamage(int32_t& damage)
 
 bool ConditionDamage::doDamage(Creature* creature, int32_t healthChange)
 {
-	if (creature->isSuppress(getType())) {
+	// the field ticks of a creature check round are dealt together at its end
+	if (field && g_game().addFieldDamage(creature, owner, conditionType, healthChange)) {
+		return true;
+	}
+	return dealDamage(creature, owner, conditionType, field, healthChange);
+}
+
+bool ConditionDamage::dealDamage(Creature* creature, uint32_t owner, ConditionType_t type, bool field, int32_t healthChange)
+{
+	if (creature->isSuppress(type)) {
 		return true;
 	}
 
 	CombatDamage damage;
 	damage.origin = ORIGIN_CONDITION;
 	damage.primary.value = healthChange;
-	damage.primary.type = Combat::ConditionToDamageType(conditionType);
+	damage.primary.type = Combat::ConditionToDamageType(type);
 
 	Creature* attacker = g_game().getCreatureByID(owner);
 	if (field && creature->getPlayer() && attacker && attacker->getPlayer()) {
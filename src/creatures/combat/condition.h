@@ -267,6 +267,11 @@ class ConditionDamage final : public Condition
 			return forceUpdate;
 		}
 		int32_t getTotalDamage() const;
+		// one round of damage of a condition of this type and owner, field halves it between players
+		static bool dealDamage(Creature* creature, uint32_t owner, ConditionType_t type, bool field, int32_t healthChange);
+		const std::deque<IntervalInfo>& getDamageList() const {
+			return damageList;
+		}
 
 		//serialization
 		void serialize(PropWriteStream& propWriteStream) override;
@@ -287,7 +292,8 @@ class ConditionDamage final : public Condition
 
 		bool init();
 
-		std::list<IntervalInfo> damageList;
+		// consumed from the front, a deque keeps it in blocks instead of a node per round
+		std::deque<IntervalInfo> damageList;
 
 		bool getNextDamage(int32_t& damage);
 		bool doDamage(Creature* creature, int32_t healthChange);
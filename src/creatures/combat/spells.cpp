@@ -100,6 +100,11 @@ void Spells::clearMaps(bool fromLua)
 		}
 	}
 
+	instantWords.clear();
+	for (auto& [words, instant] : instants) {
+		instantWords.insert(instant.getWords(), &instant);
+	}
+
 	for (auto rune = runes.begin(); rune != runes.end(); ) {
 		if (fromLua == rune->second.fromLua) {
 			rune = runes.erase(rune);
@@ -116,6 +121,18 @@ void Spells::clear(bool fromLua)
 	reInitState(fromLua);
 }
 
+size_t Spells::clearFile(const std::string& file)
+{
+	size_t count = clearFileMap(instants, file);
+	if (count != 0) {
+		instantWords.clear();
+		for (auto& [words, instant] : instants) {
+			instantWords.insert(instant.getWords(), &instant);
+		}
+	}
+	return count + clearFileMap(runes, file);
+}
+
 LuaScriptInterface& Spells::getScriptInterface()
 {
 	return scriptInterface;
@@ -146,12 +163,21 @@ bool Spells::hasInstantSpell(const std::string& word) const
 	return false;
 }
 
+void Spells::setInstantSpell(const std::string &word, InstantSpell& instant)
+{
+	if (auto [it, inserted] = instants.try_emplace(word, instant); inserted) {
+		instantWords.insert(it->second.getWords(), &it->second);
+	}
+}
+
 bool Spells::registerEvent(Event_ptr event, const pugi::xml_node&)
 {
 	InstantSpell* instant = dynamic_cast<InstantSpell*>(event.get());
 	if (instant) {
 		auto result = instants.emplace(instant->getWords(), std::move(*instant));
-		if (!result.second) {
+		if (result.second) {
+			instantWords.insert(result.first->second.getWords(), &result.first->second);
+		} else {
 			SPDLOG_WARN("[Spells::registerEvent] - "
                         "Duplicate registered instant spell with words: {}",
                         instant->getWords());
@@ -271,18 +297,15 @@ InstantSpell* Spells::getInstantSpell(const std::string& words)
 {
 	InstantSpell* result = nullptr;
 
-	for (auto& it : instants) {
-		const std::string& instantSpellWords = it.second.getWords();
-		size_t spellLen = instantSpellWords.length();
-		if (strncasecmp(instantSpellWords.c_str(), words.c_str(), spellLen) == 0) {
-			if (!result || spellLen > result->getWords().length()) {
-				result = &it.second;
-				if (words.length() == spellLen) {
-					break;
-				}
-			}
+	// the longest words win, the first registered one among equal words
+	size_t resultLength = 0;
+	instantWords.forEachPrefix(words, [&](size_t spellLen, InstantSpell* instant) {
+		if (!result || spellLen > resultLength) {
+			result = instant;
+			resultLength = spellLen;
 		}
-	}
+		return false;
+	});
 
 	if (result) {
 		const std::string& resultWords = result->getWords();
@@ -648,7 +671,7 @@ bool Spell::playerSpellCheck(Player* player) const
 		return false;
 	}
 
-	if (player->hasCondition(CONDITION_SPELLGROUPCOOLDOWN, group) || player->hasCondition(CONDITION_SPELLCOOLDOWN, spellId) || (secondaryGroup != SPELLGROUP_NONE && player->hasCondition(CONDITION_SPELLGROUPCOOLDOWN, secondaryGroup))) {
+	if (player->hasSpellGroupCooldown(group) || player->hasSpellCooldown(spellId) || (secondaryGroup != SPELLGROUP_NONE && player->hasSpellGroupCooldown(secondaryGroup))) {
 		player->sendCancelMessage(RETURNVALUE_YOUAREEXHAUSTED);
 
 		if (isInstant()) {
@@ -834,19 +857,17 @@ bool Spell::playerRuneSpellCheck(Player* player, const Position& toPos)
 
 void Spell::applyCooldownConditions(Player* player) const
 {
+	float rateCooldown = g_configManager().getFloat(RATE_SPELL_COOLDOWN);
 	if (cooldown > 0) {
-		Condition* condition = Condition::createCondition(CONDITIONID_DEFAULT, CONDITION_SPELLCOOLDOWN, cooldown / g_configManager().getFloat(RATE_SPELL_COOLDOWN), 0, false, spellId);
-		player->addCondition(condition);
+		player->addSpellCooldown(spellId, static_cast<uint32_t>(cooldown / rateCooldown));
 	}
 
 	if (groupCooldown > 0) {
-		Condition* condition = Condition::createCondition(CONDITIONID_DEFAULT, CONDITION_SPELLGROUPCOOLDOWN, groupCooldown / g_configManager().getFloat(RATE_SPELL_COOLDOWN), 0, false, group);
-		player->addCondition(condition);
+		player->addSpellGroupCooldown(group, static_cast<uint32_t>(groupCooldown / rateCooldown));
 	}
 
 	if (secondaryGroupCooldown > 0) {
-		Condition* condition = Condition::createCondition(CONDITIONID_DEFAULT, CONDITION_SPELLGROUPCOOLDOWN, secondaryGroupCooldown / g_configManager().getFloat(RATE_SPELL_COOLDOWN), 0, false, secondaryGroup);
-		player->addCondition(condition);
+		player->addSpellGroupCooldown(secondaryGroup, static_cast<uint32_t>(secondaryGroupCooldown / rateCooldown));
 	}
 }
 
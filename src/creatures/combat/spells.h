@@ -25,6 +25,7 @@
 #include "lua/creature/actions.h"
 #include "lua/creature/talkaction.h"
 #include "lua/global/baseevents.h"
+#include "utils/word_trie.hpp"
 
 class InstantSpell;
 class RuneSpell;
@@ -75,11 +76,10 @@ class Spells final : public BaseEvents
 
 		bool hasInstantSpell(const std::string& word) const;
 
-		void setInstantSpell(const std::string &word, InstantSpell& instant) {
-			instants.try_emplace(word, instant);
-		}
+		void setInstantSpell(const std::string &word, InstantSpell& instant);
 
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 		bool registerInstantLuaEvent(InstantSpell* event);
 		bool registerRuneLuaEvent(RuneSpell* event);
 
@@ -90,6 +90,8 @@ class Spells final : public BaseEvents
 
 		std::map<uint16_t, RuneSpell> runes;
 		std::map<std::string, InstantSpell> instants;
+		// words of instants, pointing into the map
+		WordTrie<InstantSpell*> instantWords;
 
 		friend class CombatSpell;
 		LuaScriptInterface scriptInterface { "Spell Interface" };
@@ -84,6 +84,9 @@ bool Creature::canSeeCreature(const Creature* creature) const
 void Creature::setSkull(Skulls_t newSkull)
 {
 	skull = newSkull;
+	if (getPlayer()) {
+		g_game().invalidatePlayerRelations();
+	}
 	g_game().updateCreatureSkull(this);
 }
 
@@ -280,15 +283,13 @@ void Creature::addEventWalk(bool firstStep)
 		g_game().checkCreatureWalk(getID());
 	}
 
-	eventWalk = g_scheduler().addEvent(createSchedulerTask(static_cast<uint32_t>(ticks), std::bind(&Game::checkCreatureWalk, &g_game(), getID())));
+	eventWalk = g_game().scheduleCreatureWalk(getID(), static_cast<uint32_t>(ticks));
 }
 
 void Creature::stopEventWalk()
 {
-	if (eventWalk != 0) {
-		g_scheduler().stopEvent(eventWalk);
-		eventWalk = 0;
-	}
+	// the queued step is dropped when its bucket comes up and the ticket no longer matches
+	eventWalk = 0;
 }
 
 void Creature::updateMapCache()
@@ -483,6 +484,28 @@ void Creature::checkSummonMove(const Position& newPos, bool teleportSummon) cons
 	}
 }
 
+bool Creature::isInterestedInMove(const Creature* creature) const
+{
+	if (creature == this || creature == followCreature || creature == attackedCreature || creature == master) {
+		return true;
+	}
+
+	CreatureMoveInterest_t interest = getMoveInterest();
+	if (interest == MOVE_INTEREST_ALL) {
+		return true;
+	}
+
+	if (creature->getPlayer() || (creature->getMaster() && creature->getMaster()->getPlayer())) {
+		return true;
+	}
+
+	if (interest == MOVE_INTEREST_HOSTILE) {
+		const Monster* monster = getMonster();
+		return creature->getFaction() == FACTION_PLAYER || (monster && monster->isEnemyFaction(creature->getFaction()));
+	}
+	return false;
+}
+
 void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos,
                               const Tile* oldTile, const Position& oldPos, bool teleport)
 {
@@ -502,6 +525,12 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 			stopEventWalk();
 		}
 
+		if (summons.empty() || teleport) {
+			followTrail.clear();
+		} else {
+			followTrail.add(newPos);
+		}
+
 		checkSummonMove(newPos, g_configManager().getBoolean(TELEPORT_SUMMONS));
 
 		if (Player* player = creature->getPlayer()) {
@@ -968,8 +997,7 @@ void Creature::goToFollowCreature()
 			} else { //maxTargetDist > 1
 				if (!monster->getDistanceStep(followCreature->getPosition(), dir)) {
 					// if we can't get anything then let the A* calculate
-					listWalkDir.clear();
-					if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+					if (getFollowPath(fpp)) {
 						hasFollowPath = true;
 						startAutoWalk(listWalkDir);
 					} else {
@@ -987,8 +1015,7 @@ void Creature::goToFollowCreature()
 				startAutoWalk(listWalkDir);
 			}
 		} else {
-			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+			if (getFollowPath(fpp)) {
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			} else {
@@ -1000,6 +1027,141 @@ void Creature::goToFollowCreature()
 	onFollowCreatureComplete(followCreature);
 }
 
+bool Creature::getFollowPath(const FindPathParams& fpp)
+{
+	listWalkDir.clear();
+
+	if (plannedFollowPath.valid) {
+		plannedFollowPath.valid = false;
+		if (plannedFollowPath.target == followCreature && plannedFollowPath.fromPos == getPosition() &&
+				plannedFollowPath.toPos == followCreature->getPosition() && plannedFollowPath.fpp == fpp) {
+			listWalkDir = std::move(plannedFollowPath.dirList);
+			return plannedFollowPath.found || getLongFollowPath(fpp);
+		}
+	}
+
+	if (canFollowByFlowField(fpp) && g_game().map.getFlowField(*followCreature).getPath(g_game().map, *this, listWalkDir)) {
+		return true;
+	}
+
+	if (canFollowByTrail(fpp) && getTrailFollowPath(fpp)) {
+		return true;
+	}
+
+	return getPathTo(followCreature->getPosition(), listWalkDir, fpp) || getLongFollowPath(fpp);
+}
+
+bool Creature::getLongFollowPath(const FindPathParams& fpp)
+{
+	// summons left far behind walk back to their master around whatever is in between
+	const Monster* monster = getMonster();
+	if (!monster || monster->getMaster() != followCreature) {
+		return false;
+	}
+	return g_game().map.getLongPathMatching(getPosition(), listWalkDir, followCreature->getPosition(), fpp);
+}
+
+bool Creature::canFollowByFlowField(const FindPathParams& fpp) const
+{
+	if (!g_configManager().getBoolean(FLOW_FIELD_PATHFINDING)) {
+		return false;
+	}
+
+	// melee chasers only, everything else needs the path conditions of the A*
+	const Monster* monster = getMonster();
+	return monster && !monster->getMaster() && fpp.maxTargetDist <= 1 && !fpp.keepDistance &&
+		followCreature->getPosition().z == getPosition().z;
+}
+
+bool Creature::canFollowByTrail(const FindPathParams& fpp) const
+{
+	if (!g_configManager().getBoolean(FOLLOW_TRAIL_PATHFINDING)) {
+		return false;
+	}
+
+	const Monster* monster = getMonster();
+	return monster && monster->getMaster() == followCreature && !fpp.keepDistance;
+}
+
+bool Creature::getTrailFollowPath(const FindPathParams& fpp)
+{
+	const FollowTrail& trail = followCreature->followTrail;
+	const Position& targetPos = followCreature->getPosition();
+	Position pos = getPosition();
+
+	// newest step of the master the summon stands on or next to
+	size_t index = 0;
+	while (index < trail.size() && (trail[index].z != pos.z || std::max<int32_t>(Position::getDistanceX(pos, trail[index]), Position::getDistanceY(pos, trail[index])) > 1)) {
+		++index;
+	}
+	if (index == trail.size()) {
+		return false;
+	}
+
+	auto tail = listWalkDir.before_begin();
+	while (pos.z != targetPos.z || std::max<int32_t>(Position::getDistanceX(pos, targetPos), Position::getDistanceY(pos, targetPos)) > fpp.maxTargetDist) {
+		const Position& next = trail[index];
+		if (next != pos) {
+			// floor changes and pushes leave gaps in the trail, the A* takes over there
+			if (next.z != pos.z || std::max<int32_t>(Position::getDistanceX(pos, next), Position::getDistanceY(pos, next)) > 1 || !g_game().map.canWalkTo(*this, next)) {
+				listWalkDir.clear();
+				return false;
+			}
+
+			tail = listWalkDir.insert_after(tail, getDirectionTo(pos, next));
+			pos = next;
+		}
+
+		if (index == 0) {
+			break;
+		}
+		--index;
+	}
+	return !listWalkDir.empty();
+}
+
+bool Creature::isFollowPathDue(uint32_t interval) const
+{
+	if (!isMapLoaded && useCacheMap()) {
+		return false;
+	}
+
+	if (isUpdatingPath) {
+		return true;
+	}
+	return followCreature && (forceUpdateFollowPath || walkUpdateTicks + interval >= 2000);
+}
+
+void Creature::planFollowPath()
+{
+	plannedFollowPath.valid = false;
+	if (!followCreature) {
+		return;
+	}
+
+	FindPathParams fpp;
+	getPathSearchParams(followCreature, fpp);
+
+	const Monster* monster = getMonster();
+	if (monster && !monster->getMaster() && (monster->isFleeing() || fpp.maxTargetDist > 1)) {
+		// distance steps are cheap and not read only, leave them to onThink
+		return;
+	}
+
+	if (canFollowByFlowField(fpp) || canFollowByTrail(fpp)) {
+		// the shared flow field is built on the dispatcher thread, trails are cheap enough to walk there
+		return;
+	}
+
+	plannedFollowPath.dirList.clear();
+	plannedFollowPath.fpp = fpp;
+	plannedFollowPath.fromPos = getPosition();
+	plannedFollowPath.toPos = followCreature->getPosition();
+	plannedFollowPath.target = followCreature;
+	plannedFollowPath.found = getPathTo(plannedFollowPath.toPos, plannedFollowPath.dirList, fpp);
+	plannedFollowPath.valid = true;
+}
+
 bool Creature::setFollowCreature(Creature* creature)
 {
 	if (creature) {
@@ -1241,6 +1403,14 @@ bool Creature::addCondition(Condition* condition)
 		return false;
 	}
 
+	if (condition->getType() == CONDITION_SPELLCOOLDOWN || condition->getType() == CONDITION_SPELLGROUPCOOLDOWN) {
+		if (Player* player = getPlayer()) {
+			player->addCooldownCondition(condition);
+			delete condition;
+			return true;
+		}
+	}
+
 	Condition* prevCond = getCondition(condition->getType(), condition->getId(), condition->getSubId());
 	if (prevCond) {
 		prevCond->addCondition(this, condition);
@@ -1273,15 +1443,15 @@ bool Creature::addCombatCondition(Condition* condition)
 
 void Creature::removeCondition(ConditionType_t type)
 {
-	auto it = conditions.begin(), end = conditions.end();
-	while (it != end) {
-		Condition* condition = *it;
+	size_t index = 0;
+	while (index < conditions.size()) {
+		Condition* condition = conditions[index];
 		if (condition->getType() != type) {
-			++it;
+			++index;
 			continue;
 		}
 
-		it = conditions.erase(it);
+		conditions.erase(conditions.begin() + index);
 
 		condition->endCondition(this);
 		delete condition;
@@ -1292,11 +1462,11 @@ void Creature::removeCondition(ConditionType_t type)
 
 void Creature::removeCondition(ConditionType_t conditionType, ConditionId_t conditionId, bool force/* = false*/)
 {
-	auto it = conditions.begin(), end = conditions.end();
-	while (it != end) {
-		Condition* condition = *it;
+	size_t index = 0;
+	while (index < conditions.size()) {
+		Condition* condition = conditions[index];
 		if (condition->getType() != conditionType || condition->getId() != conditionId) {
-			++it;
+			++index;
 			continue;
 		}
 
@@ -1308,7 +1478,7 @@ void Creature::removeCondition(ConditionType_t conditionType, ConditionId_t cond
 			}
 		}
 
-		it = conditions.erase(it);
+		conditions.erase(conditions.begin() + index);
 
 		condition->endCondition(this);
 		delete condition;
@@ -1367,21 +1537,30 @@ Condition* Creature::getCondition(ConditionType_t type, ConditionId_t conditionI
 
 void Creature::executeConditions(uint32_t interval)
 {
-	auto it = conditions.begin(), end = conditions.end();
-	while (it != end) {
-		Condition* condition = *it;
-		if (!condition->executeCondition(this, interval)) {
-			ConditionType_t type = condition->getType();
+	size_t index = 0;
+	while (index < conditions.size()) {
+		Condition* condition = conditions[index];
+		if (condition->executeCondition(this, interval)) {
+			++index;
+			continue;
+		}
 
-			it = conditions.erase(it);
+		// the damage of the condition may have run scripts that changed the list
+		if (conditions[index] != condition) {
+			auto it = std::find(conditions.begin(), conditions.end(), condition);
+			if (it == conditions.end()) {
+				continue;
+			}
+			index = static_cast<size_t>(it - conditions.begin());
+		}
 
-			condition->endCondition(this);
-			delete condition;
+		ConditionType_t type = condition->getType();
+		conditions.erase(conditions.begin() + index);
 
-			onEndCondition(type);
-		} else {
-			++it;
-		}
+		condition->endCondition(this);
+		delete condition;
+
+		onEndCondition(type);
 	}
 }
 
@@ -1391,6 +1570,15 @@ bool Creature::hasCondition(ConditionType_t type, uint32_t subId/* = 0*/) const
 		return false;
 	}
 
+	if (type == CONDITION_SPELLCOOLDOWN || type == CONDITION_SPELLGROUPCOOLDOWN) {
+		if (const Player* player = getPlayer()) {
+			if (subId > std::numeric_limits<uint8_t>::max()) {
+				return false;
+			}
+			return type == CONDITION_SPELLCOOLDOWN ? player->hasSpellCooldown(static_cast<uint8_t>(subId)) : player->hasSpellGroupCooldown(static_cast<SpellGroup_t>(subId));
+		}
+	}
+
 	int64_t timeNow = OTSYS_TIME();
 	for (Condition* condition : conditions) {
 		if (condition->getType() != type || condition->getSubId() != subId) {
@@ -1441,8 +1629,8 @@ int64_t Creature::getStepDuration() const
 	uint32_t groundSpeed = 150;
 	if (tile && tile->getGround()) {
 		Item* ground = tile->getGround();
-		const ItemType& it = Item::items[ground->getID()];
-		groundSpeed = it.speed > 0 ? it.speed : groundSpeed;
+		const uint16_t speed = Item::items.getHotData(ground->getID()).speed;
+		groundSpeed = speed > 0 ? speed : groundSpeed;
 	}
 
 	double duration = std::floor(1000 * groundSpeed / calculatedStepSpeed);
@@ -22,13 +22,16 @@
 
 #include "declarations.hpp"
 #include "creatures/combat/condition.h"
+#include "creatures/follow_trail.hpp"
 #include "utils/utils_definitions.hpp"
 #include "lua/creature/creatureevent.h"
 #include "map/map.h"
 #include "game/movement/position.h"
 #include "items/tile.h"
 
-using ConditionList = std::list<Condition*>;
+// contiguous, the list is walked on every think of every creature; the erase
+// loops work by index since condition callbacks may add conditions meanwhile
+using ConditionList = std::vector<Condition*>;
 using CreatureEventList = std::list<CreatureEvent*>;
 
 class Map;
@@ -43,6 +46,9 @@ class Tile;
 static constexpr int32_t EVENT_CREATURECOUNT = 10;
 static constexpr int32_t EVENT_CREATURE_THINK_INTERVAL = 1000;
 static constexpr int32_t EVENT_CHECK_CREATURE_INTERVAL = (EVENT_CREATURE_THINK_INTERVAL / EVENT_CREATURECOUNT);
+// walk steps due in the same slice of this many milliseconds are processed together
+static constexpr int32_t EVENT_WALK_BUCKET_INTERVAL = 10;
+static constexpr size_t EVENT_WALK_BUCKET_COUNT = 512;
 
 class FrozenPathingConditionCall
 {
@@ -263,6 +269,15 @@ class Creature : virtual public Thing
 		void stopEventWalk();
 		virtual void goToFollowCreature();
 
+		/**
+		 * Parallel think support: tells whether the next onThink is going to
+		 * search a new follow path, and searches it ahead of time.
+		 * planFollowPath only reads the map and writes this creature's
+		 * planned path, so several creatures may plan at the same time.
+		 */
+		bool isFollowPathDue(uint32_t interval) const;
+		void planFollowPath();
+
 		//walk events
 		virtual void onWalk(Direction& dir);
 		virtual void onWalkAborted() {}
@@ -423,6 +438,15 @@ class Creature : virtual public Thing
 		 * @return false 
 		 */
 		void checkSummonMove(const Position& newPos, bool teleportSummon = false) const;
+		/**
+		 * Subscription filter of onCreatureMove, so that crowded spawns do not notify
+		 * every monster of every other monster's step. Moves of the creature itself,
+		 * of its master and of its follow or attack target are always delivered.
+		 */
+		virtual CreatureMoveInterest_t getMoveInterest() const {
+			return MOVE_INTEREST_ALL;
+		}
+		bool isInterestedInMove(const Creature* creature) const;
 		virtual void onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos,
                                    const Tile* oldTile, const Position& oldPos, bool teleport);
 
@@ -538,6 +562,21 @@ class Creature : virtual public Thing
 
 		std::forward_list<Direction> listWalkDir;
 
+		// follow path searched by planFollowPath, only used while source, target and params still match
+		struct PlannedFollowPath {
+			std::forward_list<Direction> dirList;
+			FindPathParams fpp;
+			Position fromPos;
+			Position toPos;
+			const Creature* target = nullptr;
+			bool found = false;
+			bool valid = false;
+		};
+		PlannedFollowPath plannedFollowPath;
+
+		// own recent steps, only kept while there are summons to follow them
+		FollowTrail followTrail;
+
 		Tile* tile = nullptr;
 		Creature* attackedCreature = nullptr;
 		Creature* master = nullptr;
@@ -557,6 +596,7 @@ class Creature : virtual public Thing
 		uint32_t referenceCounter = 0;
 		uint32_t id = 0;
 		uint32_t scriptEventsBitField = 0;
+		// ticket of the pending walk step in Game's walk buckets, 0 if none
 		uint32_t eventWalk = 0;
 		uint32_t walkUpdateTicks = 0;
 		uint32_t lastHitCreatureId = 0;
@@ -604,6 +644,14 @@ class Creature : virtual public Thing
 		}
 		CreatureEventList getCreatureEvents(CreatureEventType_t type);
 
+		bool getFollowPath(const FindPathParams& fpp);
+		bool canFollowByFlowField(const FindPathParams& fpp) const;
+		// summons walking back to their master over the master's trail
+		bool canFollowByTrail(const FindPathParams& fpp) const;
+		bool getTrailFollowPath(const FindPathParams& fpp);
+		// the follow path of a summon over the sector hierarchy, once the A* gave up
+		bool getLongFollowPath(const FindPathParams& fpp);
+
 		void updateMapCache();
 		void updateTileCache(const Tile* tile, int32_t dx, int32_t dy);
 		void updateTileCache(const Tile* tile, const Position& pos);
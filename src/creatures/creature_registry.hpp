@@ -0,0 +1,174 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_CREATURES_CREATURE_REGISTRY_HPP_
+#define SRC_CREATURES_CREATURE_REGISTRY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+// first id of each creature kind, getCreatureByID tells them apart by range
+static constexpr uint32_t PLAYER_ID_BASE = 0x10000000;
+static constexpr uint32_t MONSTER_ID_BASE = 0x40000000;
+static constexpr uint32_t NPC_ID_BASE = 0x80000000;
+
+/**
+ * Generational slot map of the creatures of one kind, by id.
+ * An id is BASE + (generation << SLOT_BITS | slot), so a lookup is one index
+ * into the slot vector plus a generation check: the id of a destroyed
+ * creature never resolves to the one that got its slot afterwards.
+ *
+ * The slot is taken when the creature gets its id and given back when it is
+ * destroyed, so the id stays the same while the creature is removed from the
+ * game and placed again, as before. Only listed creatures resolve.
+ *
+ * Freed slots are reused oldest first, and only once MIN_FREE_SLOTS of them are
+ * waiting, so a slot is handed out again at least MIN_FREE_SLOTS creations after
+ * it was freed. An id comes back after GENERATION_BITS worth of such reuses,
+ * at the earliest MIN_FREE_SLOTS << GENERATION_BITS (~67 million) creations
+ * later; ids held by scheduled events and the known creatures of the clients
+ * are long gone by then.
+ *
+ * The listed creatures are also kept in a dense vector for iteration; its
+ * order is not the order of the ids.
+ */
+template <typename T, uint32_t BASE>
+class CreatureRegistry
+{
+	public:
+		static constexpr uint32_t SLOT_BITS = 20;
+		static constexpr uint32_t GENERATION_BITS = 10;
+		static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+		static constexpr uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+		// new slots are added until this many freed ones wait, about 1 MiB of slots
+		static constexpr size_t MIN_FREE_SLOTS = 1 << 16;
+
+		// id for a new creature, 0 when every slot is taken
+		uint32_t acquire(T* creature) {
+			uint32_t index;
+			if (freeSlots.size() < MIN_FREE_SLOTS && slots.size() <= SLOT_MASK) {
+				index = static_cast<uint32_t>(slots.size());
+				slots.emplace_back();
+			} else if (!freeSlots.empty()) {
+				// every slot is taken or enough of them wait, the oldest freed one is the furthest from its last id
+				index = freeSlots.front();
+				freeSlots.pop_front();
+			} else {
+				return 0;
+			}
+
+			Slot& slot = slots[index];
+			slot.creature = creature;
+			return BASE + (slot.generation << SLOT_BITS | index);
+		}
+
+		// the creature is destroyed, its id stops resolving for good
+		void release(uint32_t id) {
+			Slot* slot = find(id);
+			if (!slot) {
+				return;
+			}
+
+			if (slot->denseIndex != UNLISTED) {
+				remove(slot->creature);
+			}
+			slot->creature = nullptr;
+			slot->generation = (slot->generation + 1) & GENERATION_MASK;
+			freeSlots.push_back(id & SLOT_MASK);
+		}
+
+		void add(T* creature) {
+			Slot* slot = find(creature->getID());
+			if (!slot || slot->denseIndex != UNLISTED) {
+				return;
+			}
+
+			slot->denseIndex = static_cast<uint32_t>(list.size());
+			list.push_back(creature);
+		}
+
+		void remove(T* creature) {
+			Slot* slot = find(creature->getID());
+			if (!slot || slot->denseIndex == UNLISTED) {
+				return;
+			}
+
+			T* last = list.back();
+			list[slot->denseIndex] = last;
+			slots[last->getID() & SLOT_MASK].denseIndex = slot->denseIndex;
+			list.pop_back();
+			slot->denseIndex = UNLISTED;
+		}
+
+		// the listed creature with this id
+		T* get(uint32_t id) const {
+			const Slot* slot = find(id);
+			if (!slot || slot->denseIndex == UNLISTED) {
+				return nullptr;
+			}
+			return slot->creature;
+		}
+
+		const std::vector<T*>& getList() const {
+			return list;
+		}
+		size_t size() const {
+			return list.size();
+		}
+
+	private:
+		static constexpr uint32_t UNLISTED = std::numeric_limits<uint32_t>::max();
+
+		struct Slot {
+			T* creature = nullptr;
+			uint32_t generation = 0;
+			uint32_t denseIndex = UNLISTED;
+		};
+
+		Slot* find(uint32_t id) {
+			return const_cast<Slot*>(static_cast<const CreatureRegistry*>(this)->find(id));
+		}
+		const Slot* find(uint32_t id) const {
+			if (id < BASE) {
+				return nullptr;
+			}
+
+			uint32_t key = id - BASE;
+			uint32_t index = key & SLOT_MASK;
+			if ((key >> SLOT_BITS) > GENERATION_MASK || index >= slots.size()) {
+				return nullptr;
+			}
+
+			const Slot& slot = slots[index];
+			if (!slot.creature || slot.generation != key >> SLOT_BITS) {
+				return nullptr;
+			}
+			return &slot;
+		}
+
+		std::vector<Slot> slots;
+		std::deque<uint32_t> freeSlots;
+		std::vector<T*> list;
+};
+
+#endif  // SRC_CREATURES_CREATURE_REGISTRY_HPP_
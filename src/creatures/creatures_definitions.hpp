@@ -360,6 +360,23 @@ enum PlayerSex_t : uint8_t {
 	PLAYERSEX_LAST = PLAYERSEX_MALE
 };
 
+// tables of a player save that are only written again when their rows change
+enum PlayerSaveSection_t : uint8_t {
+	PLAYER_SAVE_STASH = 0,
+	PLAYER_SAVE_SPELLS,
+	PLAYER_SAVE_KILLS,
+	PLAYER_SAVE_ITEMS,
+	PLAYER_SAVE_DEPOT,
+	PLAYER_SAVE_REWARDS,
+	PLAYER_SAVE_INBOX,
+	PLAYER_SAVE_PREY,
+	PLAYER_SAVE_TASKHUNT,
+	// only used with the binary player state, the rows are written by their changes
+	PLAYER_SAVE_STORAGE,
+
+	PLAYER_SAVE_LAST = PLAYER_SAVE_STORAGE
+};
+
 enum skills_t : uint8_t {
 	SKILL_FIST = 0,
 	SKILL_CLUB = 1,
@@ -391,6 +408,15 @@ enum CreatureType_t : uint8_t {
 	CREATURETYPE_HIDDEN = 5,
 };
 
+// which moves of other creatures a spectator's onCreatureMove is called for
+enum CreatureMoveInterest_t : uint8_t {
+	MOVE_INTEREST_ALL = 0,
+	// players and their summons
+	MOVE_INTEREST_PLAYERS = 1,
+	// players, their summons and creatures of an enemy faction
+	MOVE_INTEREST_HOSTILE = 2,
+};
+
 enum SpellType_t : uint8_t {
 	SPELL_UNDEFINED = 0,
 	SPELL_INSTANT = 1,
@@ -650,6 +676,13 @@ struct FindPathParams {
 	int32_t maxSearchDist = 0;
 	int32_t minTargetDist = -1;
 	int32_t maxTargetDist = -1;
+
+	bool operator==(const FindPathParams& other) const {
+		return fullPathSearch == other.fullPathSearch && clearSight == other.clearSight &&
+			allowDiagonal == other.allowDiagonal && keepDistance == other.keepDistance &&
+			maxSearchDist == other.maxSearchDist && minTargetDist == other.minTargetDist &&
+			maxTargetDist == other.maxTargetDist;
+	}
 };
 
 struct RecentDeathEntry {
@@ -684,6 +717,7 @@ struct MarketOffer {
 
 struct MarketOfferEx {
 	MarketOfferEx() = default;
+	MarketOfferEx(const MarketOfferEx&) = default;
 	MarketOfferEx(MarketOfferEx&& other) :
         id(other.id),
         playerId(other.playerId),
@@ -855,6 +889,12 @@ struct ShopBlock {
 		: itemId(newItemId), itemSubType(newSubType), itemBuyPrice(newBuyPrice), itemSellPrice(newSellPrice), itemStorageKey(newStorageKey), itemStorageValue(newStorageValue), itemName(std::move(newName)) {}
 };
 
+// the prices an npc trades an item id at, 0 when it does not buy or sell it
+struct ShopItemPrices {
+	uint32_t buyPrice = 0;
+	uint32_t sellPrice = 0;
+};
+
 struct summonBlock_t {
 	std::string name;
 	uint32_t chance;
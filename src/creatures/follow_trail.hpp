@@ -0,0 +1,66 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_CREATURES_FOLLOW_TRAIL_HPP_
+#define SRC_CREATURES_FOLLOW_TRAIL_HPP_
+
+#include <array>
+
+#include "game/movement/position.h"
+
+// steps kept, a summon further behind than this searches its own path
+static constexpr size_t FOLLOW_TRAIL_SIZE = 16;
+
+/**
+ * Ring buffer of the last positions a creature with summons stepped on,
+ * newest first. The summons following it walk the trail back to it instead
+ * of running an A* search toward a target that keeps moving.
+ */
+class FollowTrail
+{
+	public:
+		void add(const Position& pos) {
+			head = (head + 1) % FOLLOW_TRAIL_SIZE;
+			positions[head] = pos;
+			if (count < FOLLOW_TRAIL_SIZE) {
+				++count;
+			}
+		}
+
+		void clear() {
+			count = 0;
+		}
+
+		size_t size() const {
+			return count;
+		}
+
+		// 0 is the newest position
+		const Position& operator[](size_t index) const {
+			return positions[(head + FOLLOW_TRAIL_SIZE - index) % FOLLOW_TRAIL_SIZE];
+		}
+
+	private:
+		std::array<Position, FOLLOW_TRAIL_SIZE> positions;
+		size_t head = 0;
+		size_t count = 0;
+};
+
+#endif  // SRC_CREATURES_FOLLOW_TRAIL_HPP_
@@ -52,8 +52,8 @@ void PrivateChatChannel::invitePlayer(const Player& player, Player& invitePlayer
 	ss << invitePlayer.getName() << " has been invited.";
 	player.sendTextMessage(MESSAGE_PARTY_MANAGEMENT, ss.str());
 
-	for (const auto& it : users) {
-		it.second->sendChannelEvent(id, invitePlayer.getName(), CHANNELEVENT_INVITE);
+	for (Player* user : users) {
+		user->sendChannelEvent(id, invitePlayer.getName(), CHANNELEVENT_INVITE);
 	}
 }
 
@@ -71,21 +71,21 @@ void PrivateChatChannel::excludePlayer(const Player& player, Player& excludePlay
 
 	excludePlayer.sendClosePrivate(id);
 
-	for (const auto& it : users) {
-		it.second->sendChannelEvent(id, excludePlayer.getName(), CHANNELEVENT_EXCLUDE);
+	for (Player* user : users) {
+		user->sendChannelEvent(id, excludePlayer.getName(), CHANNELEVENT_EXCLUDE);
 	}
 }
 
 void PrivateChatChannel::closeChannel() const
 {
-	for (const auto& it : users) {
-		it.second->sendClosePrivate(id);
+	for (Player* user : users) {
+		user->sendClosePrivate(id);
 	}
 }
 
 bool ChatChannel::addUser(Player& player)
 {
-	if (users.find(player.getID()) != users.end()) {
+	if (userIds.find(player.getID()) != userIds.end()) {
 		return false;
 	}
 
@@ -102,27 +102,27 @@ bool ChatChannel::addUser(Player& player)
 	}
 
 	if (!publicChannel) {
-		for (const auto& it : users) {
-			it.second->sendChannelEvent(id, player.getName(), CHANNELEVENT_JOIN);
+		for (Player* user : users) {
+			user->sendChannelEvent(id, player.getName(), CHANNELEVENT_JOIN);
 		}
 	}
 
-	users[player.getID()] = &player;
+	users.push_back(&player);
+	userIds.insert(player.getID());
 	return true;
 }
 
 bool ChatChannel::removeUser(const Player& player)
 {
-	auto iter = users.find(player.getID());
-	if (iter == users.end()) {
+	if (userIds.erase(player.getID()) == 0) {
 		return false;
 	}
 
-	users.erase(iter);
+	users.erase(std::find(users.begin(), users.end(), &player));
 
 	if (!publicChannel) {
-		for (const auto& it : users) {
-			it.second->sendChannelEvent(id, player.getName(), CHANNELEVENT_LEAVE);
+		for (Player* user : users) {
+			user->sendChannelEvent(id, player.getName(), CHANNELEVENT_LEAVE);
 		}
 	}
 
@@ -131,24 +131,29 @@ bool ChatChannel::removeUser(const Player& player)
 }
 
 bool ChatChannel::hasUser(const Player& player) {
-	return users.find(player.getID()) != users.end();
+	return userIds.find(player.getID()) != userIds.end();
 }
 
 void ChatChannel::sendToAll(const std::string& message, SpeakClasses type) const
 {
-	for (const auto& it : users) {
-		it.second->sendChannelMessage("", message, type, id);
+	NetworkMessage msg;
+	ProtocolGame::AddChannelMessage(msg, "", message, type, id);
+	for (Player* user : users) {
+		user->sendToChannel(msg);
 	}
 }
 
 bool ChatChannel::talk(const Player& fromPlayer, SpeakClasses type, const std::string& text)
 {
-	if (users.find(fromPlayer.getID()) == users.end()) {
+	if (userIds.find(fromPlayer.getID()) == userIds.end()) {
 		return false;
 	}
 
-	for (const auto& it : users) {
-		it.second->sendToChannel(&fromPlayer, type, text, id);
+	// one statement id for every listener
+	NetworkMessage msg;
+	ProtocolGame::AddToChannel(msg, &fromPlayer, type, text, id);
+	for (Player* user : users) {
+		user->sendToChannel(msg);
 	}
 	return true;
 }
@@ -175,7 +180,7 @@ bool ChatChannel::executeCanJoinEvent(const Player& player)
 
 	scriptInterface->pushFunction(canJoinEvent);
 	LuaScriptInterface::pushUserdata(L, &player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -202,7 +207,7 @@ bool ChatChannel::executeOnJoinEvent(const Player& player)
 
 	scriptInterface->pushFunction(onJoinEvent);
 	LuaScriptInterface::pushUserdata(L, &player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -229,7 +234,7 @@ bool ChatChannel::executeOnLeaveEvent(const Player& player)
 
 	scriptInterface->pushFunction(onLeaveEvent);
 	LuaScriptInterface::pushUserdata(L, &player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -256,7 +261,7 @@ bool ChatChannel::executeOnSpeakEvent(const Player& player, SpeakClasses& type,
 
 	scriptInterface->pushFunction(onSpeakEvent);
 	LuaScriptInterface::pushUserdata(L, &player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, type);
 	LuaScriptInterface::pushString(L, message);
@@ -324,8 +329,10 @@ bool Chat::load()
 			}
 
 			UsersMap tempUserMap = std::move(channel.users);
-			for (const auto& pair : tempUserMap) {
-				channel.addUser(*pair.second);
+			channel.users.clear();
+			channel.userIds.clear();
+			for (Player* user : tempUserMap) {
+				channel.addUser(*user);
 			}
 			continue;
 		}
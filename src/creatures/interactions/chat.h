@@ -26,7 +26,8 @@
 class Party;
 class Player;
 
-using UsersMap = std::map<uint32_t, Player*>;
+// in joining order, contiguous for the message fan-out
+using UsersMap = std::vector<Player*>;
 using InvitedMap = std::map<uint32_t, const Player*>;
 
 class ChatChannel
@@ -72,6 +73,8 @@ class ChatChannel
 
 	protected:
 		UsersMap users;
+		// ids of users, for the membership checks
+		phmap::flat_hash_set<uint32_t> userIds;
 
 		std::string name;
 
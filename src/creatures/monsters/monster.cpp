@@ -24,13 +24,26 @@
 #include "creatures/monsters/monster.h"
 #include "creatures/combat/spells.h"
 #include "game/game.h"
+#include "game/scheduling/dispatcher_governor.hpp"
 #include "game/scheduling/tasks.h"
 #include "lua/creature/events.h"
 
 int32_t Monster::despawnRange;
 int32_t Monster::despawnRadius;
 
-uint32_t Monster::monsterAutoID = 0x40000000;
+
+namespace {
+
+// chance is a percentage, most spells use 100 or 0 and need no random number
+bool rollSpellChance(uint32_t chance)
+{
+	if (chance >= 100) {
+		return true;
+	}
+	return chance != 0 && chance >= static_cast<uint32_t>(uniform_random(1, 100));
+}
+
+}  // namespace
 
 Monster* Monster::createMonster(const std::string& name)
 {
@@ -70,6 +83,16 @@ Monster::~Monster()
 {
 	clearTargetList();
 	clearFriendList();
+	if (id != 0) {
+		g_game().releaseMonsterID(id);
+	}
+}
+
+void Monster::setID()
+{
+	if (id == 0) {
+		id = g_game().acquireMonsterID(this);
+	}
 }
 
 void Monster::addList()
@@ -144,7 +167,7 @@ void Monster::onCreatureAppear(Creature* creature, bool isLogin)
 		scriptInterface->pushFunction(mType->info.creatureAppearEvent);
 
 		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -188,7 +211,7 @@ void Monster::onRemoveCreature(Creature* creature, bool isLogout)
 		scriptInterface->pushFunction(mType->info.creatureDisappearEvent);
 
 		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -209,6 +232,15 @@ void Monster::onRemoveCreature(Creature* creature, bool isLogout)
 	}
 }
 
+CreatureMoveInterest_t Monster::getMoveInterest() const
+{
+	// scripts and summons see everything, wild monsters only react to what they can target
+	if (mType->info.creatureMoveEvent != -1 || isSummon()) {
+		return MOVE_INTEREST_ALL;
+	}
+	return getFaction() != FACTION_DEFAULT ? MOVE_INTEREST_HOSTILE : MOVE_INTEREST_PLAYERS;
+}
+
 void Monster::onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos,
                               const Tile* oldTile, const Position& oldPos, bool teleport)
 {
@@ -231,7 +263,7 @@ void Monster::onCreatureMove(Creature* creature, const Tile* newTile, const Posi
 		scriptInterface->pushFunction(mType->info.creatureMoveEvent);
 
 		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -314,7 +346,7 @@ void Monster::onCreatureSay(Creature* creature, SpeakClasses type, const std::st
 		scriptInterface->pushFunction(mType->info.creatureSayEvent);
 
 		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -400,13 +432,25 @@ void Monster::updateTargetList()
 		}
 	}
 
-	SpectatorHashSet spectators;
-	g_game().map.getSpectators(spectators, position, true);
-	spectators.erase(this);
-	for (Creature* spectator : spectators) {
-		if (canSee(spectator->getPosition())) {
-			onCreatureFound(spectator);
+	// same as onCreatureFound for every spectator, but the idle status (which
+	// looks for players in range) is updated once at the end instead of per creature
+	bool found = false;
+	g_game().map.forEachSpectator(position, true, false, [this, &found](Creature* spectator) {
+		if (spectator == this || !canSee(spectator->getPosition())) {
+			return;
 		}
+
+		if (isFriend(spectator)) {
+			addFriend(spectator);
+		}
+		if (isOpponent(spectator)) {
+			addTarget(spectator);
+		}
+		found = true;
+	});
+
+	if (found) {
+		updateIdleStatus();
 	}
 }
 
@@ -538,7 +582,8 @@ bool Monster::searchTarget(TargetSearchType_t searchType /*= TARGETSEARCH_DEFAUL
 		}
 	}
 
-	std::list<Creature*> resultList;
+	std::vector<Creature*> resultList;
+	resultList.reserve(targetList.size());
 	const Position& myPos = getPosition();
 
 	for (Creature* creature : targetList) {
@@ -772,6 +817,11 @@ void Monster::updateIdleStatus()
 		}
 	}
 
+	// nobody around to see it, park it until a player comes into view
+	if (!idle && !isSummon() && g_configManager().getBoolean(SLEEP_MONSTERS_WITHOUT_PLAYERS) && !g_game().map.hasPlayersInRange(getPosition())) {
+		idle = true;
+	}
+
 	setIdle(idle);
 }
 
@@ -815,7 +865,7 @@ void Monster::onThink(uint32_t interval)
 		scriptInterface->pushFunction(mType->info.thinkEvent);
 
 		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 		lua_pushnumber(L, interval);
 
@@ -890,6 +940,7 @@ void Monster::doAttacking(uint32_t interval)
 
 	const Position& myPos = getPosition();
 	const Position& targetPos = attackedCreature->getPosition();
+	const int64_t timeNow = OTSYS_TIME();
 
 	for (const spellBlock_t& spellBlock : mType->info.attackSpells) {
 		bool inRange = false;
@@ -902,8 +953,8 @@ void Monster::doAttacking(uint32_t interval)
 			continue;
 		}
 
-		if (canUseSpell(myPos, targetPos, spellBlock, interval, inRange, resetTicks)) {
-			if (spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100))) {
+		if (canUseSpell(myPos, targetPos, spellBlock, interval, timeNow, inRange, resetTicks)) {
+			if (rollSpellChance(spellBlock.chance)) {
 				if (updateLook) {
 					updateLookDirection();
 					updateLook = false;
@@ -957,7 +1008,7 @@ bool Monster::canUseAttack(const Position& pos, const Creature* target) const
 }
 
 bool Monster::canUseSpell(const Position& pos, const Position& targetPos,
-                           const spellBlock_t& sb, uint32_t interval, bool& inRange, bool& resetTicks)
+                           const spellBlock_t& sb, uint32_t interval, int64_t timeNow, bool& inRange, bool& resetTicks)
 {
 	inRange = true;
 
@@ -966,8 +1017,8 @@ bool Monster::canUseSpell(const Position& pos, const Position& targetPos,
 	}
 
 	if (extraMeleeAttack) {
-		lastMeleeAttack = OTSYS_TIME();
-	} else if (sb.isMelee && (OTSYS_TIME() - lastMeleeAttack) < 1500) {
+		lastMeleeAttack = timeNow;
+	} else if (sb.isMelee && (timeNow - lastMeleeAttack) < 1500) {
 		return false;
 	}
 
@@ -1051,7 +1102,7 @@ void Monster::onThinkDefense(uint32_t interval)
 			continue;
 		}
 
-		if ((spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100)))) {
+		if (rollSpellChance(spellBlock.chance)) {
 			minCombatValue = spellBlock.minCombatValue;
 			maxCombatValue = spellBlock.maxCombatValue;
 			spellBlock.spell->castSpell(this, this);
@@ -1085,7 +1136,7 @@ void Monster::onThinkDefense(uint32_t interval)
 				continue;
 			}
 
-			if (summonBlock.chance < static_cast<uint32_t>(uniform_random(1, 100))) {
+			if (!rollSpellChance(summonBlock.chance)) {
 				continue;
 			}
 
@@ -1117,6 +1168,10 @@ void Monster::onThinkYell(uint32_t interval)
 	if (yellTicks >= mType->info.yellSpeedTicks) {
 		yellTicks = 0;
 
+		if (g_dispatcherGovernor().shouldShedCosmetic()) {
+			return;
+		}
+
 		if (!mType->info.voiceVector.empty() && (mType->info.yellChance >= static_cast<uint32_t>(uniform_random(1, 100)))) {
 			uint32_t index = uniform_random(0, mType->info.voiceVector.size() - 1);
 			const voiceBlock_t& vb = mType->info.voiceVector[index];
@@ -45,6 +45,15 @@ class Monster final : public Creature
 		Monster(const Monster&) = delete;
 		Monster& operator=(const Monster&) = delete;
 
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_MONSTER, size);
+			return ::operator new(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_MONSTER, size);
+			::operator delete(p);
+		}
+
 		Monster* getMonster() override {
 			return this;
 		}
@@ -52,11 +61,7 @@ class Monster final : public Creature
 			return this;
 		}
 
-		void setID() override {
-			if (id == 0) {
-				id = monsterAutoID++;
-			}
-		}
+		void setID() override;
 
 		void removeList() override;
 		void addList() override;
@@ -148,6 +153,7 @@ class Monster final : public Creature
 
 		void onCreatureAppear(Creature* creature, bool isLogin) override;
 		void onRemoveCreature(Creature* creature, bool isLogout) override;
+		CreatureMoveInterest_t getMoveInterest() const override;
 		void onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos, const Tile* oldTile, const Position& oldPos, bool teleport) override;
 		void onCreatureSay(Creature* creature, SpeakClasses type, const std::string& text) override;
 
@@ -219,7 +225,6 @@ class Monster final : public Creature
 		BlockType_t blockHit(Creature* attacker, CombatType_t combatType, int32_t& damage,
                               bool checkDefense = false, bool checkArmor = false, bool field = false) override;
 
-		static uint32_t monsterAutoID;
 
 	private:
 		CreatureHashSet friendList;
@@ -283,7 +288,7 @@ class Monster final : public Creature
 
 		bool canUseAttack(const Position& pos, const Creature* target) const;
 		bool canUseSpell(const Position& pos, const Position& targetPos,
-                         const spellBlock_t& sb, uint32_t interval, bool& inRange, bool& resetTicks);
+                         const spellBlock_t& sb, uint32_t interval, int64_t timeNow, bool& inRange, bool& resetTicks);
 		bool getRandomStep(const Position& creaturePos, Direction& direction) const;
 		bool getDanceStep(const Position& creaturePos, Direction& direction,
                            bool keepAttack = true, bool keepDistance = true);
@@ -0,0 +1,663 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "creatures/monsters/monster_type_cache.hpp"
+#include "creatures/monsters/monsters.h"
+#include "game/game.h"
+#include "io/fileloader.h"
+#include "lua/scripts/luajit_sync.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+constexpr std::array<char, 4> MONSTER_TYPE_CACHE_IDENTIFIER = {{'C', 'M', 'O', 'N'}};
+
+#pragma pack(1)
+
+struct MonsterTypeCacheHeader {
+	std::array<char, 4> identifier;
+	uint32_t version;
+	uint32_t dependencyChecksum;
+	uint64_t payloadSize;
+	uint32_t payloadChecksum;
+};
+
+#pragma pack()
+
+boost::filesystem::path getCacheFileName()
+{
+	return getCachePath("monsters.bin", (boost::filesystem::current_path() / "cache" / "monsters.bin").string());
+}
+
+// the same field list reads and writes a monster type
+struct CacheWriter {
+	static constexpr bool READING = false;
+
+	PropWriteStream& stream;
+	bool good = true;
+
+	template <typename T>
+	void operator()(T& value) {
+		static_assert(std::is_trivially_copyable_v<T>, "stored as is");
+		stream.write<T>(value);
+	}
+	void operator()(std::string& value) {
+		stream.writeString(value);
+	}
+};
+
+struct CacheReader {
+	static constexpr bool READING = true;
+
+	PropStream& stream;
+	bool good = true;
+
+	template <typename T>
+	void operator()(T& value) {
+		static_assert(std::is_trivially_copyable_v<T>, "stored as is");
+		good = good && stream.read<T>(value);
+	}
+	void operator()(std::string& value) {
+		good = good && stream.readString(value);
+	}
+};
+
+template <typename Archive, typename T, typename Transfer>
+void transferVector(Archive& archive, std::vector<T>& list, Transfer&& transferElement)
+{
+	auto count = static_cast<uint32_t>(list.size());
+	archive(count);
+	if constexpr (Archive::READING) {
+		// every element takes at least a byte
+		if (!archive.good || count > archive.stream.size()) {
+			archive.good = false;
+			return;
+		}
+		list.clear();
+		list.resize(count);
+	}
+
+	for (T& element : list) {
+		transferElement(archive, element);
+	}
+}
+
+template <typename Archive>
+void transferCombatMap(Archive& archive, std::map<CombatType_t, int32_t>& map)
+{
+	auto count = static_cast<uint32_t>(map.size());
+	archive(count);
+	if constexpr (Archive::READING) {
+		map.clear();
+		for (uint32_t i = 0; i < count && archive.good; ++i) {
+			CombatType_t type;
+			int32_t value;
+			archive(type);
+			archive(value);
+			map[type] = value;
+		}
+	} else {
+		for (auto& [type, value] : map) {
+			CombatType_t key = type;
+			archive(key);
+			archive(value);
+		}
+	}
+}
+
+template <typename Archive>
+void transferFactions(Archive& archive, phmap::flat_hash_set<Faction_t>& factions)
+{
+	auto count = static_cast<uint32_t>(factions.size());
+	archive(count);
+	if constexpr (Archive::READING) {
+		factions.clear();
+		for (uint32_t i = 0; i < count && archive.good; ++i) {
+			Faction_t faction;
+			archive(faction);
+			factions.insert(faction);
+		}
+	} else {
+		for (Faction_t faction : factions) {
+			archive(faction);
+		}
+	}
+}
+
+template <typename Archive>
+void transferLoot(Archive& archive, LootBlock& loot)
+{
+	archive(loot.id);
+	archive(loot.countmax);
+	archive(loot.countmin);
+	archive(loot.chance);
+	archive(loot.subType);
+	archive(loot.actionId);
+	archive(loot.text);
+	archive(loot.name);
+	archive(loot.article);
+	archive(loot.attack);
+	archive(loot.defense);
+	archive(loot.extraDefense);
+	archive(loot.armor);
+	archive(loot.shootRange);
+	archive(loot.hitChance);
+	archive(loot.unique);
+	transferVector(archive, loot.childLoot, [](Archive& childArchive, LootBlock& child) {
+		transferLoot(childArchive, child);
+	});
+}
+
+template <typename Archive>
+void transferSpell(Archive& archive, MonsterSpell& spell)
+{
+	archive(spell.name);
+	archive(spell.scriptName);
+	archive(spell.chance);
+	archive(spell.range);
+	archive(spell.interval);
+	archive(spell.minCombatValue);
+	archive(spell.maxCombatValue);
+	archive(spell.attack);
+	archive(spell.skill);
+	archive(spell.length);
+	archive(spell.spread);
+	archive(spell.radius);
+	archive(spell.conditionMinDamage);
+	archive(spell.conditionMaxDamage);
+	archive(spell.conditionStartDamage);
+	archive(spell.tickInterval);
+	archive(spell.speedChange);
+	archive(spell.duration);
+	archive(spell.isScripted);
+	archive(spell.needTarget);
+	archive(spell.needDirection);
+	archive(spell.combatSpell);
+	archive(spell.isMelee);
+	archive(spell.outfit);
+	archive(spell.outfitMonster);
+	archive(spell.outfitItem);
+	archive(spell.shoot);
+	archive(spell.effect);
+	archive(spell.conditionType);
+	archive(spell.combatType);
+}
+
+// everything but the spells, which hold combat objects, and the callbacks, which a cached file has none of
+template <typename Archive>
+void transferType(Archive& archive, MonsterType& monsterType)
+{
+	archive(monsterType.name);
+	archive(monsterType.typeName);
+	archive(monsterType.nameDescription);
+
+	auto& info = monsterType.info;
+	transferCombatMap(archive, info.elementMap);
+	transferCombatMap(archive, info.reflectMap);
+	transferCombatMap(archive, info.healingMap);
+	transferVector(archive, info.voiceVector, [](Archive& voiceArchive, voiceBlock_t& voice) {
+		voiceArchive(voice.text);
+		voiceArchive(voice.yellText);
+	});
+	transferVector(archive, info.lootItems, [](Archive& lootArchive, LootBlock& loot) {
+		transferLoot(lootArchive, loot);
+	});
+	transferVector(archive, info.scripts, [](Archive& scriptArchive, std::string& script) {
+		scriptArchive(script);
+	});
+	transferVector(archive, info.summons, [](Archive& summonArchive, summonBlock_t& summon) {
+		summonArchive(summon.name);
+		summonArchive(summon.chance);
+		summonArchive(summon.speed);
+		summonArchive(summon.count);
+		summonArchive(summon.force);
+	});
+
+	archive(info.skull);
+	archive(info.outfit);
+	archive(info.race);
+	archive(info.respawnType);
+	archive(info.light);
+	archive(info.lookcorpse);
+	archive(info.experience);
+
+	archive(info.manaCost);
+	archive(info.yellChance);
+	archive(info.yellSpeedTicks);
+	archive(info.staticAttackChance);
+	archive(info.maxSummons);
+	archive(info.changeTargetSpeed);
+	archive(info.conditionImmunities);
+	archive(info.damageImmunities);
+	archive(info.baseSpeed);
+
+	archive(info.bestiaryOccurrence);
+	archive(info.bestiaryStars);
+	archive(info.bestiaryToUnlock);
+	archive(info.bestiaryFirstUnlock);
+	archive(info.bestiarySecondUnlock);
+	archive(info.bestiaryCharmsPoints);
+	archive(info.raceid);
+	archive(info.bestiaryLocations);
+	archive(info.bestiaryClass);
+	archive(info.bestiaryRace);
+
+	archive(info.targetDistance);
+	archive(info.runAwayHealth);
+	archive(info.health);
+	archive(info.healthMax);
+	archive(info.changeTargetChance);
+	archive(info.defense);
+	archive(info.armor);
+	archive(info.strategiesTargetNearest);
+	archive(info.strategiesTargetHealth);
+	archive(info.strategiesTargetDamage);
+	archive(info.strategiesTargetRandom);
+	archive(info.targetPreferPlayer);
+	archive(info.targetPreferMaster);
+
+	archive(info.faction);
+	transferFactions(archive, info.enemyFactions);
+
+	archive(info.canPushItems);
+	archive(info.canPushCreatures);
+	archive(info.pushable);
+	archive(info.isSummonable);
+	archive(info.isIllusionable);
+	archive(info.isConvinceable);
+	archive(info.isAttackable);
+	archive(info.isHostile);
+	archive(info.hiddenHealth);
+	archive(info.isBlockable);
+	archive(info.isFamiliar);
+	archive(info.isRewardBoss);
+	archive(info.canWalkOnEnergy);
+	archive(info.canWalkOnFire);
+	archive(info.canWalkOnPoison);
+	archive(info.eventType);
+}
+
+void addDependency(uint32_t& checksum, const boost::filesystem::path& path)
+{
+	uint64_t size = 0;
+	uint32_t fileChecksum = 0;
+	boost::system::error_code error;
+	if (boost::filesystem::is_regular_file(path, error)) {
+		getFileChecksum(path.string(), size, fileChecksum);
+	}
+
+	const std::string name = path.string();
+	checksum = updateCrc32(checksum, name.data(), name.size());
+	checksum = updateCrc32(checksum, reinterpret_cast<const char*>(&size), sizeof(size));
+	checksum = updateCrc32(checksum, reinterpret_cast<const char*>(&fileChecksum), sizeof(fileChecksum));
+}
+
+}  // namespace
+
+bool MonsterTypeCache::open()
+{
+	namespace fs = boost::filesystem;
+
+	entries.clear();
+	changed = false;
+	enabled = g_configManager().getBoolean(MONSTER_TYPE_CACHE);
+	if (!enabled) {
+		return false;
+	}
+
+	dependencyChecksum = getDependencyChecksum();
+
+	std::ifstream file(getCacheFileName().string(), std::ios::binary);
+	if (!file) {
+		return true;
+	}
+
+	std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	MonsterTypeCacheHeader header;
+	if (contents.size() < sizeof(header)) {
+		return true;
+	}
+
+	std::memcpy(&header, contents.data(), sizeof(header));
+	const char* payload = contents.data() + sizeof(header);
+	if (header.identifier != MONSTER_TYPE_CACHE_IDENTIFIER || header.version != VERSION || header.dependencyChecksum != dependencyChecksum) {
+		SPDLOG_INFO("[MonsterTypeCache::open] - The script libraries changed, the monster types are built again");
+		return true;
+	}
+
+	if (header.payloadSize != contents.size() - sizeof(header) || updateCrc32(0, payload, header.payloadSize) != header.payloadChecksum) {
+		SPDLOG_WARN("[MonsterTypeCache::open] - {} is damaged, the monster types are built again", getCacheFileName().string());
+		return true;
+	}
+
+	PropStream stream;
+	stream.init(payload, header.payloadSize);
+	std::string name;
+	while (stream.readString(name)) {
+		Entry entry;
+		uint32_t dataSize;
+		if (!stream.read<uint64_t>(entry.sourceSize) || !stream.read<uint32_t>(entry.sourceChecksum) || !stream.read<uint32_t>(dataSize) || stream.size() < dataSize) {
+			entries.clear();
+			break;
+		}
+		entry.data.assign(stream.data(), dataSize);
+		stream.skip(dataSize);
+		entries[name] = std::move(entry);
+	}
+	return true;
+}
+
+void MonsterTypeCache::close()
+{
+	namespace fs = boost::filesystem;
+
+	if (enabled && changed) {
+		PropWriteStream stream;
+		for (auto& [name, entry] : entries) {
+			// files that were removed or no longer cacheable are dropped
+			if (!entry.valid) {
+				continue;
+			}
+			std::string fileName = name;
+			stream.writeString(fileName);
+			stream.write<uint64_t>(entry.sourceSize);
+			stream.write<uint32_t>(entry.sourceChecksum);
+			stream.write<uint32_t>(static_cast<uint32_t>(entry.data.size()));
+			stream.writeBytes(entry.data.data(), entry.data.size());
+		}
+
+		size_t payloadSize;
+		const char* payload = stream.getStream(payloadSize);
+		MonsterTypeCacheHeader header;
+		header.identifier = MONSTER_TYPE_CACHE_IDENTIFIER;
+		header.version = VERSION;
+		header.dependencyChecksum = dependencyChecksum;
+		header.payloadSize = payloadSize;
+		header.payloadChecksum = updateCrc32(0, payload, payloadSize);
+
+		// write through a temporary name, a half written cache must never be picked up
+		const fs::path fileName = getCacheFileName();
+		const fs::path temporaryName = getCacheTempFileName(fileName.string());
+		boost::system::error_code error;
+		fs::create_directories(fileName.parent_path(), error);
+		std::ofstream file(temporaryName.string(), std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(payload, payloadSize);
+		file.close();
+		if (file.fail()) {
+			SPDLOG_ERROR("[MonsterTypeCache::close] - Could not write {}", temporaryName.string());
+			fs::remove(temporaryName, error);
+		} else {
+			fs::rename(temporaryName, fileName, error);
+		}
+	}
+
+	entries.clear();
+	recordedTypes.clear();
+	recording = false;
+	enabled = false;
+	changed = false;
+}
+
+bool MonsterTypeCache::isCached(const std::string& file)
+{
+	if (!enabled) {
+		return false;
+	}
+
+	auto it = entries.find(file);
+	if (it == entries.end()) {
+		return false;
+	}
+
+	Entry& entry = it->second;
+	if (!entry.verified) {
+		entry.verified = true;
+		uint64_t size;
+		uint32_t checksum;
+		entry.valid = getFileChecksum(file, size, checksum) && size == entry.sourceSize && checksum == entry.sourceChecksum;
+		if (!entry.valid) {
+			changed = true;
+		}
+	}
+	return entry.valid;
+}
+
+bool MonsterTypeCache::load(const std::string& file)
+{
+	if (!isCached(file)) {
+		return false;
+	}
+
+	Entry& entry = entries[file];
+	PropStream stream;
+	stream.init(entry.data.data(), entry.data.size());
+
+	uint16_t typeCount;
+	if (!stream.read<uint16_t>(typeCount)) {
+		entry.valid = false;
+		changed = true;
+		return false;
+	}
+
+	// nothing is registered before the whole entry read fine, a broken one runs from Lua instead
+	std::vector<std::pair<std::string, MonsterType*>> types;
+	for (uint16_t i = 0; i < typeCount; ++i) {
+		std::string name;
+		MonsterType* monsterType = readType(stream, name);
+		if (!monsterType) {
+			for (auto& [typeName, loadedType] : types) {
+				delete loadedType;
+			}
+			entry.valid = false;
+			changed = true;
+			return false;
+		}
+		types.emplace_back(std::move(name), monsterType);
+	}
+
+	for (auto& [name, monsterType] : types) {
+		g_monsters().addMonsterType(name, monsterType);
+		if (monsterType->info.raceid != 0) {
+			g_game().addBestiaryList(monsterType->info.raceid, monsterType->name);
+		}
+	}
+	return true;
+}
+
+void MonsterTypeCache::beginFile(lua_State* L, const std::string& file, int32_t nextEventId)
+{
+	recording = enabled;
+	if (!recording) {
+		return;
+	}
+
+	recordingFile = file;
+	recordingGlobals = countGlobals(L);
+	recordingEventId = nextEventId;
+	recordedTypes.clear();
+}
+
+void MonsterTypeCache::endFile(lua_State* L, bool success, int32_t nextEventId)
+{
+	if (!recording) {
+		return;
+	}
+	recording = false;
+
+	// any stored callback or new global is state the native load would not restore
+	Entry entry;
+	if (success && !recordedTypes.empty() && nextEventId == recordingEventId && countGlobals(L) == recordingGlobals
+			&& recordedTypes.size() <= std::numeric_limits<uint16_t>::max()
+			&& getFileChecksum(recordingFile, entry.sourceSize, entry.sourceChecksum)) {
+		PropWriteStream stream;
+		stream.write<uint16_t>(static_cast<uint16_t>(recordedTypes.size()));
+		for (const RecordedType& recorded : recordedTypes) {
+			writeType(stream, recorded);
+		}
+
+		size_t size;
+		const char* data = stream.getStream(size);
+		entry.data.assign(data, size);
+		entry.verified = true;
+		entry.valid = true;
+	}
+
+	auto it = entries.find(recordingFile);
+	if (entry.valid || it != entries.end()) {
+		entries[recordingFile] = std::move(entry);
+		changed = true;
+	}
+	recordedTypes.clear();
+}
+
+void MonsterTypeCache::onCreateMonsterType(const std::string& name, MonsterType* monsterType)
+{
+	if (recording) {
+		recordedTypes.push_back({name, monsterType, {}, {}});
+	}
+}
+
+void MonsterTypeCache::onAddSpell(const MonsterType* monsterType, const MonsterSpell& spell, bool attack)
+{
+	if (!recording) {
+		return;
+	}
+
+	for (RecordedType& recorded : recordedTypes) {
+		if (recorded.monsterType == monsterType) {
+			PropWriteStream stream;
+			writeSpell(stream, spell);
+			size_t size;
+			const char* data = stream.getStream(size);
+			(attack ? recorded.attacks : recorded.defenses).emplace_back(data, size);
+			return;
+		}
+	}
+
+	// the file changes a type of another file, it has to keep running from Lua
+	recording = false;
+	recordedTypes.clear();
+}
+
+uint32_t MonsterTypeCache::getDependencyChecksum()
+{
+	namespace fs = boost::filesystem;
+
+	// what the monster files call into: the libraries, and the item names loot may be given by
+	std::vector<fs::path> files = {fs::path("data") / "global.lua", fs::path("data") / "items" / "items.xml"};
+	for (const fs::path& dir : {fs::path("data") / "lib", fs::path("data") / "scripts" / "lib"}) {
+		boost::system::error_code error;
+		if (!fs::is_directory(dir, error)) {
+			continue;
+		}
+		for (fs::recursive_directory_iterator it(dir, error), end; it != end; it.increment(error)) {
+			if (fs::is_regular_file(it->path(), error) && it->path().extension() == ".lua") {
+				files.push_back(it->path());
+			}
+		}
+	}
+	std::sort(files.begin() + 2, files.end());
+
+	uint32_t checksum = VERSION;
+	for (const fs::path& file : files) {
+		addDependency(checksum, file);
+	}
+	return checksum;
+}
+
+size_t MonsterTypeCache::countGlobals(lua_State* L)
+{
+	size_t count = 0;
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	lua_pushnil(L);
+	while (lua_next(L, -2) != 0) {
+		++count;
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+	return count;
+}
+
+void MonsterTypeCache::writeSpell(PropWriteStream& stream, const MonsterSpell& spell)
+{
+	CacheWriter writer {stream};
+	transferSpell(writer, const_cast<MonsterSpell&>(spell));
+}
+
+bool MonsterTypeCache::readSpell(PropStream& stream, MonsterSpell& spell)
+{
+	CacheReader reader {stream};
+	transferSpell(reader, spell);
+	return reader.good;
+}
+
+void MonsterTypeCache::writeType(PropWriteStream& stream, const RecordedType& recorded)
+{
+	std::string name = recorded.name;
+	stream.writeString(name);
+
+	CacheWriter writer {stream};
+	transferType(writer, *recorded.monsterType);
+
+	for (const auto* spells : {&recorded.attacks, &recorded.defenses}) {
+		stream.write<uint32_t>(static_cast<uint32_t>(spells->size()));
+		for (const std::string& spell : *spells) {
+			stream.writeBytes(spell.data(), spell.size());
+		}
+	}
+}
+
+MonsterType* MonsterTypeCache::readType(PropStream& stream, std::string& name)
+{
+	if (!stream.readString(name)) {
+		return nullptr;
+	}
+
+	auto monsterType = std::make_unique<MonsterType>(name);
+	CacheReader reader {stream};
+	transferType(reader, *monsterType);
+	if (!reader.good) {
+		return nullptr;
+	}
+
+	for (auto* spells : {&monsterType->info.attackSpells, &monsterType->info.defenseSpells}) {
+		uint32_t count;
+		if (!stream.read<uint32_t>(count)) {
+			return nullptr;
+		}
+
+		for (uint32_t i = 0; i < count; ++i) {
+			MonsterSpell spell;
+			if (!readSpell(stream, spell)) {
+				return nullptr;
+			}
+
+			spellBlock_t sb;
+			if (g_monsters().deserializeSpell(&spell, sb, monsterType->name)) {
+				spells->push_back(std::move(sb));
+			}
+		}
+	}
+	return monsterType.release();
+}
@@ -0,0 +1,120 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_CREATURES_MONSTERS_MONSTER_TYPE_CACHE_HPP_
+#define SRC_CREATURES_MONSTERS_MONSTER_TYPE_CACHE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+class MonsterSpell;
+class MonsterType;
+class PropStream;
+class PropWriteStream;
+struct lua_State;
+
+/**
+ * The monster types built by the files of data/monster, kept in cache/monsters.bin.
+ * A file is cached after it ran from Lua when all it did was create monster types:
+ * no callback was stored (onThink and friends, or any other event) and no global
+ * was added. Its monster types are then built natively on the next load, as long as
+ * the file, the script libraries and items.xml did not change, so only the files
+ * with callbacks still run in the interpreter. Spells are kept as the MonsterSpell
+ * Lua filled, and deserialized again as on a Lua load.
+ * Records are stored in the byte order of the machine that wrote them.
+ */
+class MonsterTypeCache
+{
+	public:
+		MonsterTypeCache() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		MonsterTypeCache(const MonsterTypeCache&) = delete;
+		MonsterTypeCache& operator=(const MonsterTypeCache&) = delete;
+
+		static MonsterTypeCache& getInstance() {
+			// Guaranteed to be destroyed
+			static MonsterTypeCache instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// reads the cache before the folder loads, false when monsterTypeCache is off
+		bool open();
+		// writes back what changed and frees the cache
+		void close();
+
+		// the file is unchanged since its monster types were cached
+		bool isCached(const std::string& file);
+		// builds the cached monster types of the file
+		bool load(const std::string& file);
+
+		// around running an uncached file from Lua
+		void beginFile(lua_State* L, const std::string& file, int32_t nextEventId);
+		void endFile(lua_State* L, bool success, int32_t nextEventId);
+
+		// from the bindings, while a file runs
+		void onCreateMonsterType(const std::string& name, MonsterType* monsterType);
+		void onAddSpell(const MonsterType* monsterType, const MonsterSpell& spell, bool attack);
+
+	private:
+		static constexpr uint32_t VERSION = 1;
+
+		struct Entry {
+			uint64_t sourceSize = 0;
+			uint32_t sourceChecksum = 0;
+			// checked against the file once per load
+			bool verified = false;
+			bool valid = false;
+			std::string data;
+		};
+
+		struct RecordedType {
+			std::string name;
+			MonsterType* monsterType;
+			std::vector<std::string> attacks;
+			std::vector<std::string> defenses;
+		};
+
+		static uint32_t getDependencyChecksum();
+		static size_t countGlobals(lua_State* L);
+		static void writeSpell(PropWriteStream& stream, const MonsterSpell& spell);
+		static bool readSpell(PropStream& stream, MonsterSpell& spell);
+		static void writeType(PropWriteStream& stream, const RecordedType& recorded);
+		static MonsterType* readType(PropStream& stream, std::string& name);
+
+		phmap::flat_hash_map<std::string, Entry> entries;
+		uint32_t dependencyChecksum = 0;
+		bool enabled = false;
+		bool changed = false;
+
+		// the file running from Lua
+		bool recording = false;
+		std::string recordingFile;
+		size_t recordingGlobals = 0;
+		int32_t recordingEventId = 0;
+		std::vector<RecordedType> recordedTypes;
+};
+
+constexpr auto g_monsterTypeCache = &MonsterTypeCache::getInstance;
+
+#endif  // SRC_CREATURES_MONSTERS_MONSTER_TYPE_CACHE_HPP_
@@ -24,6 +24,7 @@
 #include "creatures/combat/combat.h"
 #include "game/game.h"
 #include "items/weapons/weapons.h"
+#include "lua/scripts/lua_environment.hpp"
 #include "utils/pugicast.h"
 
 spellBlock_t::~spellBlock_t()
@@ -33,8 +34,21 @@ spellBlock_t::~spellBlock_t()
 	}
 }
 
+void MonsterType::releaseLootTable()
+{
+	if (info.lootTableRef == -1) {
+		return;
+	}
+
+	if (lua_State* L = g_luaEnvironment.getLuaState()) {
+		luaL_unref(L, LUA_REGISTRYINDEX, info.lootTableRef);
+	}
+	info.lootTableRef = -1;
+}
+
 void MonsterType::loadLoot(MonsterType* monsterType, LootBlock lootBlock)
 {
+	monsterType->releaseLootTable();
 	if (lootBlock.childLoot.empty()) {
 		bool isContainer = Item::items[lootBlock.id].isContainer();
 		if (isContainer) {
@@ -758,6 +772,7 @@ MonsterType* Monsters::loadMonster(const std::string& file, const std::string& m
 		auto it = monsters.find(asLowerCaseString(monsterName));
 		if (it != monsters.end()) {
 			mType = it->second;
+			mType->releaseLootTable();
 			mType->info = {};
 		}
 	}
@@ -1334,9 +1349,9 @@ bool Monsters::loadLootItem(const pugi::xml_node& node, LootBlock& lootBlock)
 		lootBlock.id = pugi::cast<int32_t>(attr.value());
 	} else if ((attr = node.attribute("name"))) {
 		auto name = attr.as_string();
-		auto ids = Item::items.nameToItems.equal_range(asLowerCaseString(name));
+		auto ids = Item::items.getItemIdsByName(name);
 
-		if (ids.first == Item::items.nameToItems.cend()) {
+		if (ids.first == ids.second) {
 			SPDLOG_WARN("[Monsters::loadMonster] - "
                         "Unknown loot item {}", name);
 			return false;
@@ -74,6 +74,8 @@ class MonsterType
 		std::vector<voiceBlock_t> voiceVector;
 
 		std::vector<LootBlock> lootItems;
+		// registry reference of the table returned by MonsterType:getLoot(), built on first use
+		int32_t lootTableRef = -1;
 		std::vector<std::string> scripts;
 		std::vector<spellBlock_t> attackSpells;
 		std::vector<spellBlock_t> defenseSpells;
@@ -169,6 +171,8 @@ class MonsterType
 		MonsterInfo info;
 
 		void loadLoot(MonsterType* monsterType, LootBlock lootblock);
+		// drops the cached loot table, it is rebuilt by the next MonsterType:getLoot()
+		void releaseLootTable();
 
 		bool canSpawn(const Position& pos);
 };
@@ -29,6 +29,8 @@
 
 static constexpr int32_t MONSTER_MINSPAWN_INTERVAL = 1000; // 1 second
 static constexpr int32_t MONSTER_MAXSPAWN_INTERVAL = 86400000; // 1 day
+// below this many monsters per thread the startup construction is not worth a thread
+static constexpr size_t MONSTER_STARTUP_PER_THREAD = 1024;
 
 bool SpawnsMonster::loadFromXML(const std::string& filemonstername)
 {
@@ -122,8 +124,46 @@ void SpawnsMonster::startup()
 		return;
 	}
 
+	struct StartupBlock {
+		SpawnMonster* spawnMonster;
+		uint32_t spawnMonsterId;
+		const spawnBlock_t* block;
+	};
+
+	std::vector<StartupBlock> blocks;
+	std::vector<Position> positions;
 	for (SpawnMonster& spawnMonster : spawnMonsterList) {
-		spawnMonster.startup();
+		for (const auto& [spawnMonsterId, sb] : spawnMonster.spawnMonsterMap) {
+			blocks.push_back({&spawnMonster, spawnMonsterId, &sb});
+			positions.push_back(sb.pos);
+		}
+	}
+
+	// the constructors only read the monster types, the config and the creature events
+	std::vector<std::unique_ptr<Monster>> monsters(blocks.size());
+	std::atomic<size_t> next {0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < blocks.size(); i = next++) {
+			monsters[i].reset(new Monster(blocks[i].block->monsterType));
+		}
+	};
+
+	size_t threadCount = std::min<size_t>(std::max<unsigned int>(1, std::thread::hardware_concurrency()), blocks.size() / MONSTER_STARTUP_PER_THREAD);
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	g_game().map.reserveCreatures(positions);
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		const StartupBlock& startupBlock = blocks[i];
+		const spawnBlock_t& sb = *startupBlock.block;
+		startupBlock.spawnMonster->spawnMonster(startupBlock.spawnMonsterId, std::move(monsters[i]), sb.pos, sb.direction, true);
 	}
 
 	started = true;
@@ -151,15 +191,65 @@ bool SpawnsMonster::isInZone(const Position& centerPos, int32_t radius, const Po
             (pos.getY() >= centerPos.getY() - radius) && (pos.getY() <= centerPos.getY() + radius));
 }
 
+SpawnMonsterCheckList::iterator SpawnMonsterChecks::queue(SpawnMonster* spawnMonster, int64_t time)
+{
+	auto it = checks.emplace(time, spawnMonster);
+	scheduleEvent();
+	return it;
+}
+
+void SpawnMonsterChecks::unqueue(SpawnMonsterCheckList::iterator it)
+{
+	// the event is left alone, it finds nothing due and is moved to the next check
+	checks.erase(it);
+}
+
+void SpawnMonsterChecks::scheduleEvent()
+{
+	if (checks.empty()) {
+		return;
+	}
+
+	int64_t nextCheck = checks.begin()->first;
+	if (checkEvent != 0) {
+		if (checkEventTime <= nextCheck) {
+			return;
+		}
+		g_scheduler().stopEvent(checkEvent);
+	}
+
+	checkEventTime = nextCheck;
+	uint32_t delay = static_cast<uint32_t>(std::max<int64_t>(SCHEDULER_MINTICKS, nextCheck - OTSYS_TIME()));
+	checkEvent = g_scheduler().addEvent(createSchedulerTask(delay, std::bind(&SpawnMonsterChecks::runChecks, this)));
+}
+
+void SpawnMonsterChecks::runChecks()
+{
+	checkEvent = 0;
+
+	// one at a time through the list, a check may queue, unqueue or destroy other spawns
+	int64_t now = OTSYS_TIME();
+	while (!checks.empty() && checks.begin()->first <= now) {
+		SpawnMonster* spawnMonster = checks.begin()->second;
+		checks.erase(checks.begin());
+		spawnMonster->checkQueued = false;
+		spawnMonster->checkSpawnMonster();
+	}
+
+	scheduleEvent();
+}
+
 void SpawnMonster::startSpawnMonsterCheck()
 {
-	if (checkSpawnMonsterEvent == 0) {
-		checkSpawnMonsterEvent = g_scheduler().addEvent(createSchedulerTask(getInterval(), std::bind(&SpawnMonster::checkSpawnMonster, this)));
+	if (!checkQueued) {
+		checkIterator = g_spawnMonsterChecks().queue(this, OTSYS_TIME() + getInterval());
+		checkQueued = true;
 	}
 }
 
 SpawnMonster::~SpawnMonster()
 {
+	stopEvent();
 	for (const auto& it : spawnedMonsterMap) {
 		Monster* monster = it.second;
 		monster->setSpawnMonster(nullptr);
@@ -169,6 +259,11 @@ SpawnMonster::~SpawnMonster()
 
 bool SpawnMonster::findPlayer(const Position& pos)
 {
+	// the leaf player lists answer the common case of nobody around without a spectator set
+	if (!g_game().map.hasPlayersInRange(pos, false)) {
+		return false;
+	}
+
 	SpectatorHashSet spectators;
 	g_game().map.getSpectators(spectators, pos, false, true);
 	for (Creature* spectator : spectators) {
@@ -186,7 +281,11 @@ bool SpawnMonster::isInSpawnMonsterZone(const Position& pos)
 
 bool SpawnMonster::spawnMonster(uint32_t spawnMonsterId, MonsterType* monsterType, const Position& pos, Direction dir, bool startup /*= false*/)
 {
-	std::unique_ptr<Monster> monster_ptr(new Monster(monsterType));
+	return spawnMonster(spawnMonsterId, std::unique_ptr<Monster>(new Monster(monsterType)), pos, dir, startup);
+}
+
+bool SpawnMonster::spawnMonster(uint32_t spawnMonsterId, std::unique_ptr<Monster> monster_ptr, const Position& pos, Direction dir, bool startup)
+{
 	if (startup) {
 		//No need to send out events to the surrounding since there is no one out there to listen!
 		if (!g_game().internalPlaceCreature(monster_ptr.get(), pos, true)) {
@@ -210,19 +309,8 @@ bool SpawnMonster::spawnMonster(uint32_t spawnMonsterId, MonsterType* monsterTyp
 	return true;
 }
 
-void SpawnMonster::startup()
-{
-	for (const auto& it : spawnMonsterMap) {
-		uint32_t spawnMonsterId = it.first;
-		const spawnBlock_t& sb = it.second;
-		spawnMonster(spawnMonsterId, sb.monsterType, sb.pos, sb.direction, true);
-	}
-}
-
 void SpawnMonster::checkSpawnMonster()
 {
-	checkSpawnMonsterEvent = 0;
-
 	cleanup();
 
 	uint32_t spawnMonsterCount = 0;
@@ -258,7 +346,7 @@ void SpawnMonster::checkSpawnMonster()
 	}
 
 	if (spawnedMonsterMap.size() < spawnMonsterMap.size()) {
-		checkSpawnMonsterEvent = g_scheduler().addEvent(createSchedulerTask(getInterval(), std::bind(&SpawnMonster::checkSpawnMonster, this)));
+		startSpawnMonsterCheck();
 	}
 }
 
@@ -323,8 +411,8 @@ void SpawnMonster::removeMonster(Monster* monster)
 
 void SpawnMonster::stopEvent()
 {
-	if (checkSpawnMonsterEvent != 0) {
-		g_scheduler().stopEvent(checkSpawnMonsterEvent);
-		checkSpawnMonsterEvent = 0;
+	if (checkQueued) {
+		g_spawnMonsterChecks().unqueue(checkIterator);
+		checkQueued = false;
 	}
 }
@@ -25,6 +25,10 @@
 
 class Monster;
 class MonsterType;
+class SpawnMonster;
+
+// respawn checks waiting to run, by the time they are due at
+using SpawnMonsterCheckList = std::multimap<int64_t, SpawnMonster*>;
 
 struct spawnBlock_t {
 	Position pos;
@@ -50,7 +54,6 @@ class SpawnMonster
 		uint32_t getInterval() const {
 			return interval;
 		}
-		void startup();
 
 		void startSpawnMonsterCheck();
 		void stopEvent();
@@ -71,20 +74,66 @@ class SpawnMonster
 		int32_t radius;
 
 		uint32_t interval = 30000;
-		uint32_t checkSpawnMonsterEvent = 0;
+		bool checkQueued = false;
+		SpawnMonsterCheckList::iterator checkIterator;
 
 		static bool findPlayer(const Position& pos);
 		bool spawnMonster(uint32_t spawnMonsterId, MonsterType* monsterType, const Position& pos, Direction dir, bool startup = false);
+		bool spawnMonster(uint32_t spawnMonsterId, std::unique_ptr<Monster> monster_ptr, const Position& pos, Direction dir, bool startup);
 		void checkSpawnMonster();
 		void scheduleSpawn(uint32_t spawnMonsterId, spawnBlock_t& sb, uint16_t interval);
+
+		friend class SpawnMonsterChecks;
+		friend class SpawnsMonster;
 };
 
+/**
+ * Runs the respawn checks of every spawn from a single scheduler event.
+ * Spawns queue the time of their next check and each time the event fires
+ * it runs all the checks that are due, so 20k spawns cost one pending event
+ * instead of one each.
+ */
+class SpawnMonsterChecks
+{
+	public:
+		SpawnMonsterChecks() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		SpawnMonsterChecks(const SpawnMonsterChecks&) = delete;
+		SpawnMonsterChecks& operator=(const SpawnMonsterChecks&) = delete;
+
+		static SpawnMonsterChecks& getInstance() {
+			// Guaranteed to be destroyed
+			static SpawnMonsterChecks instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		SpawnMonsterCheckList::iterator queue(SpawnMonster* spawnMonster, int64_t time);
+		void unqueue(SpawnMonsterCheckList::iterator it);
+
+	private:
+		void scheduleEvent();
+		void runChecks();
+
+		SpawnMonsterCheckList checks;
+		uint32_t checkEvent = 0;
+		int64_t checkEventTime = 0;
+};
+
+constexpr auto g_spawnMonsterChecks = &SpawnMonsterChecks::getInstance;
+
 class SpawnsMonster
 {
 	public:
 		static bool isInZone(const Position& centerPos, int32_t radius, const Position& pos);
 
 		bool loadFromXML(const std::string& filemonstername);
+		/**
+		 * Places every monster of every spawn. Nobody is online yet, so the
+		 * monsters are constructed on all cores first and only the placement,
+		 * which touches the map and the game lists, runs on this thread.
+		 */
 		void startup();
 		void clear();
 
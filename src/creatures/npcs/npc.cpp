@@ -23,13 +23,12 @@
 #include "creatures/npcs/npcs.h"
 #include "declarations.hpp"
 #include "game/game.h"
+#include "game/scheduling/dispatcher_governor.hpp"
 #include "lua/callbacks/creaturecallback.h"
 
 int32_t Npc::despawnRange;
 int32_t Npc::despawnRadius;
 
-uint32_t Npc::npcAutoID = 0x80000000;
-
 Npc* Npc::createNpc(const std::string& name)
 {
 	NpcType* npcType = g_npcs().getNpcType(name);
@@ -62,13 +61,23 @@ Npc::Npc(NpcType* npcType) :
 }
 
 Npc::~Npc() {
+	if (id != 0) {
+		g_game().releaseNpcID(id);
+	}
+}
+
+void Npc::setID()
+{
+	if (id == 0) {
+		id = g_game().acquireNpcID(this);
+	}
 }
 
 void Npc::reset() const
 {
 	g_npcs().reset();
 	// Close shop window from all npcs and reset the shopPlayerSet
-	for (const auto& [npcId, npc] : g_game().getNpcs()) {
+	for (Npc* npc : g_game().getNpcs()) {
 		npc->closeAllShopWindows();
 		npc->resetPlayerInteractions();
 	}
@@ -96,6 +105,10 @@ void Npc::onCreatureAppear(Creature* creature, bool isLogin)
 {
 	Creature::onCreatureAppear(creature, isLogin);
 
+	if (isIdle && creature->getPlayer()) {
+		setIdle(false);
+	}
+
 	// onCreatureAppear(self, creature)
 	CreatureCallback callback = CreatureCallback(npcType->info.scriptInterface, this);
 	if (callback.startScriptInterface(npcType->info.creatureAppearEvent)) {
@@ -140,6 +153,10 @@ void Npc::onCreatureMove(Creature* creature, const Tile* newTile, const Position
 {
 	Creature::onCreatureMove(creature, newTile, newPos, oldTile, oldPos, teleport);
 
+	if (isIdle && creature->getPlayer()) {
+		setIdle(false);
+	}
+
 	// onCreatureMove(self, creature, oldPosition, newPosition)
 	CreatureCallback callback = CreatureCallback(npcType->info.scriptInterface, this);
 	if (callback.startScriptInterface(npcType->info.creatureMoveEvent)) {
@@ -192,6 +209,11 @@ void Npc::onThink(uint32_t interval)
 {
 	Creature::onThink(interval);
 
+	updateIdleStatus();
+	if (isIdle) {
+		return;
+	}
+
 	// onThink(self, interval)
 	CreatureCallback callback = CreatureCallback(npcType->info.scriptInterface, this);
 	if (callback.startScriptInterface(npcType->info.thinkEvent)) {
@@ -248,13 +270,7 @@ void Npc::onPlayerBuyItem(Player* player, uint16_t itemId,
 		}
 	}
 
-	uint32_t buyPrice = 0;
-	const std::vector<ShopBlock> &shopVector = getShopItemVector();
-	for (ShopBlock shopBlock : shopVector) {
-		if (itemType.id == shopBlock.itemId && shopBlock.itemBuyPrice != 0) {
-			buyPrice = shopBlock.itemBuyPrice;
-		}
-	}
+	uint32_t buyPrice = getShopItemPrices(itemType.id).buyPrice;
 
 	uint32_t totalCost = buyPrice * amount;
 	uint32_t bagsCost = 0;
@@ -299,15 +315,14 @@ void Npc::onPlayerSellItem(Player* player, uint16_t itemId,
 		return;
 	}
 
-	uint32_t sellPrice = 0;
 	const ItemType& itemType = Item::items[itemId];
-	const std::vector<ShopBlock> &shopVector = getShopItemVector();
-	for (ShopBlock shopBlock : shopVector)
-	{
-		if (itemType.id == shopBlock.itemId && shopBlock.itemSellPrice != 0)
-		{
-			sellPrice = shopBlock.itemSellPrice;
-		}
+	uint32_t sellPrice = getShopItemPrices(itemType.id).sellPrice;
+
+	// the sale counts already tell whether there is anything to look for
+	const auto& saleItemCounts = player->getSaleItemCounts();
+	if (saleItemCounts.find(itemId) == saleItemCounts.end()) {
+		SPDLOG_ERROR("[Npc::onPlayerSellItem] - Player {} have a problem for remove items from id {} on shop for npc {}", player->getName(), itemId, getName());
+		return;
 	}
 
 	auto removeAmount = amount;
@@ -421,6 +436,10 @@ void Npc::onThinkYell(uint32_t interval)
 	if (yellTicks >= npcType->info.yellSpeedTicks) {
 		yellTicks = 0;
 
+		if (g_dispatcherGovernor().shouldShedCosmetic()) {
+			return;
+		}
+
 		if (!npcType->info.voiceVector.empty() && (npcType->info.yellChance >= static_cast<uint32_t>(uniform_random(1, 100)))) {
 			uint32_t index = uniform_random(0, npcType->info.voiceVector.size() - 1);
 			const voiceBlock_t& vb = npcType->info.voiceVector[index];
@@ -466,6 +485,29 @@ void Npc::onPlacedCreature()
 	addEventWalk();
 }
 
+void Npc::setIdle(bool idle)
+{
+	if (isRemoved() || idle == isIdle) {
+		return;
+	}
+
+	isIdle = idle;
+
+	if (!isIdle) {
+		g_game().addCreatureCheck(this);
+	} else {
+		Game::removeCreatureCheck(this);
+	}
+}
+
+void Npc::updateIdleStatus()
+{
+	// nobody to talk to, so nothing to yell, walk or script until a player comes into view
+	bool idle = g_configManager().getBoolean(SLEEP_NPCS_WITHOUT_PLAYERS) && !npcType->info.alwaysThink
+		&& playerInteractions.empty() && shopPlayerSet.empty() && !g_game().map.hasPlayersInRange(getPosition());
+	setIdle(idle);
+}
+
 bool Npc::isInSpawnRange(const Position& pos) const
 {
 	if (!spawnNpc) {
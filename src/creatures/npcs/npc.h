@@ -43,6 +43,15 @@ class Npc final : public Creature
 		Npc(Npc const&) = delete;
 		void operator=(Npc const&) = delete;
 
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_NPC, size);
+			return ::operator new(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_NPC, size);
+			::operator delete(p);
+		}
+
 		static Npc& getInstance() {
 			// Guaranteed to be destroyed
 			static Npc instance;
@@ -57,11 +66,7 @@ class Npc final : public Creature
 			return this;
 		}
 
-		void setID() override {
-			if (id == 0) {
-				id = npcAutoID++;
-			}
-		}
+		void setID() override;
 
 		void reset() const;
 
@@ -111,9 +116,16 @@ class Npc final : public Creature
 			npcType->info.currencyId = currency;
 		}
 
-		std::vector<ShopBlock> getShopItemVector() {
+		const std::vector<ShopBlock>& getShopItemVector() const {
 			return npcType->info.shopItemVector;
 		}
+		const std::vector<uint16_t>& getShopSellItemIds() const {
+			return npcType->info.shopSellItemIds;
+		}
+		ShopItemPrices getShopItemPrices(uint16_t itemId) const {
+			auto it = npcType->info.shopItemPrices.find(itemId);
+			return it != npcType->info.shopItemPrices.end() ? it->second : ShopItemPrices();
+		}
 
 		bool isPushable() const override {
 			return npcType->info.pushable;
@@ -156,6 +168,10 @@ class Npc final : public Creature
 
 		void onCreatureAppear(Creature* creature, bool isLogin) override;
 		void onRemoveCreature(Creature* creature, bool isLogout) override;
+		CreatureMoveInterest_t getMoveInterest() const override {
+			// without a script only players matter (idle wake up and shop windows)
+			return npcType->info.creatureMoveEvent != -1 ? MOVE_INTEREST_ALL : MOVE_INTEREST_PLAYERS;
+		}
 		void onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos, const Tile* oldTile, const Position& oldPos, bool teleport) override;
 		void onCreatureSay(Creature* creature, SpeakClasses type, const std::string& text) override;
 		void onThink(uint32_t interval) override;
@@ -178,7 +194,6 @@ class Npc final : public Creature
 		void addShopPlayer(Player* player);
 		void removeShopPlayer(Player* player);
 
-		static uint32_t npcAutoID;
 
 	private:
 		void closeAllShopWindows();
@@ -187,6 +202,10 @@ class Npc final : public Creature
 
 		bool isInSpawnRange(const Position& pos) const;
 
+		// like the monsters, sleeping npcs leave the creature checks until a player shows up
+		void setIdle(bool idle);
+		void updateIdleStatus();
+
 		std::string strDescription;
 
 		std::map<uint32_t, uint16_t> playerInteractions;
@@ -202,6 +221,7 @@ class Npc final : public Creature
 		uint32_t walkTicks = 0;
 
 		bool ignoreHeight;
+		bool isIdle = false;
 
 		Position masterPos;
 
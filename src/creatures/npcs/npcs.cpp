@@ -95,6 +95,18 @@ void NpcType::loadShop(NpcType* npcType, ShopBlock shopBlock)
 	if (shopBlock.itemBuyPrice > iType.buyPrice) {
 		iType.buyPrice = shopBlock.itemBuyPrice;
 	}
+
+	// as the trades did when scanning the shop, the last block with a price wins
+	ShopItemPrices& prices = npcType->info.shopItemPrices[shopBlock.itemId];
+	if (shopBlock.itemBuyPrice != 0) {
+		prices.buyPrice = shopBlock.itemBuyPrice;
+	}
+	if (shopBlock.itemSellPrice != 0) {
+		if (prices.sellPrice == 0) {
+			npcType->info.shopSellItemIds.push_back(shopBlock.itemId);
+		}
+		prices.sellPrice = shopBlock.itemSellPrice;
+	}
 	
 	if (shopBlock.childShop.empty()) {
 		bool isContainer = iType.isContainer();
@@ -71,10 +71,16 @@ class NpcType
 		bool canPushCreatures = false;
 		bool pushable = false;
 		bool floorChange = false;
+		// keeps thinking with no player in view, for npcs whose onThink script must always run
+		bool alwaysThink = false;
 
 		std::vector<voiceBlock_t> voiceVector;
 		std::vector<std::string> scripts;
 		std::vector<ShopBlock> shopItemVector;
+		// shopItemVector compiled by item id, filled by NpcType::loadShop
+		phmap::flat_hash_map<uint16_t, ShopItemPrices> shopItemPrices;
+		// ids the npc buys, once each and in shop order, for the sale list
+		std::vector<uint16_t> shopSellItemIds;
 
 		NpcsEvent_t eventType = NPCS_EVENT_NONE;
 	};
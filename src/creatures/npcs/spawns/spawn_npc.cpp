@@ -111,6 +111,12 @@ void SpawnsNpc::startup()
 		return;
 	}
 
+	std::vector<Position> positions;
+	for (const SpawnNpc& spawnNpc : spawnNpcList) {
+		spawnNpc.getStartupPositions(positions);
+	}
+	g_game().map.reserveCreatures(positions);
+
 	for (SpawnNpc& spawnNpc : spawnNpcList) {
 		spawnNpc.startup();
 	}
@@ -208,6 +214,13 @@ void SpawnNpc::startup()
 	}
 }
 
+void SpawnNpc::getStartupPositions(std::vector<Position>& positions) const
+{
+	for (const auto& it : spawnNpcMap) {
+		positions.push_back(it.second.pos);
+	}
+}
+
 void SpawnNpc::checkSpawnNpc()
 {
 	checkSpawnNpcEvent = 0;
@@ -51,6 +51,8 @@ class SpawnNpc
 			return interval;
 		}
 		void startup();
+		// positions startup() places its npcs at, to pre-size the map leaves
+		void getStartupPositions(std::vector<Position>& positions) const;
 
 		void startSpawnNpcCheck();
 		void stopEvent();
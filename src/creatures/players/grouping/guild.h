@@ -59,7 +59,17 @@ class Guild
       return bankBalance;
     }
     void setBankBalance(uint64_t balance) {
-      bankBalance = balance;
+      if (balance != bankBalance) {
+        bankBalance = balance;
+        bankBalanceChanged = true;
+      }
+    }
+    // changed since the guild was loaded or its balance was last written
+    bool hasBankBalanceChanged() const {
+      return bankBalanceChanged;
+    }
+    void setBankBalanceChanged(bool changed) {
+      bankBalanceChanged = changed;
     }
 
 		const std::vector<GuildRank_ptr>& getRanks() const {
@@ -83,6 +93,7 @@ class Guild
 		std::vector<GuildRank_ptr> ranks;
 		std::string name;
     uint64_t bankBalance = 0;
+    bool bankBalanceChanged = false;
 		std::string motd;
 		uint32_t id;
 		uint32_t memberCount = 0;
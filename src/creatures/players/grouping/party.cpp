@@ -21,6 +21,7 @@
 
 #include "creatures/players/grouping/party.h"
 #include "game/game.h"
+#include "game/scheduling/scheduler.h"
 #include "lua/creature/events.h"
 
 Party::Party(Player* initLeader) : leader(initLeader)
@@ -71,6 +72,10 @@ void Party::disband()
 		delete analyzer;
 	}
 	membersData.clear();
+
+	if (trackerAnalyzerEvent != 0) {
+		g_scheduler().stopEvent(trackerAnalyzerEvent);
+	}
 	delete this;
 }
 
@@ -157,6 +162,7 @@ bool Party::passPartyLeadership(Player* player)
 
 	Player* oldLeader = leader;
 	leader = player;
+	g_game().invalidatePlayerRelations();
 
 	memberList.insert(memberList.begin(), oldLeader);
 
@@ -233,6 +239,7 @@ bool Party::removeInvite(Player& player, bool removeFromPlayer/* = true*/)
 	}
 
 	inviteList.erase(it);
+	g_game().invalidatePlayerRelations();
 
 	leader->sendCreatureShield(&player);
 	player.sendCreatureShield(leader);
@@ -279,6 +286,7 @@ bool Party::invitePlayer(Player& player)
 	leader->sendTextMessage(MESSAGE_PARTY_MANAGEMENT, ss.str());
 
 	inviteList.push_back(&player);
+	g_game().invalidatePlayerRelations();
 
 	leader->sendCreatureShield(&player);
 	player.sendCreatureShield(leader);
@@ -331,6 +339,7 @@ void Party::updateSharedExperience()
 		bool result = canEnableSharedExperience();
 		if (result != sharedExpEnabled) {
 			sharedExpEnabled = result;
+			g_game().invalidatePlayerRelations();
 			updateAllPartyIcons();
 		}
 	}
@@ -347,6 +356,7 @@ bool Party::setSharedExperience(Player* player, bool newSharedExpActive)
 	}
 
 	this->sharedExpActive = newSharedExpActive;
+	g_game().invalidatePlayerRelations();
 
 	if (newSharedExpActive) {
 		this->sharedExpEnabled = canEnableSharedExperience();
@@ -374,20 +384,27 @@ void Party::shareExperience(uint64_t experience, Creature* target/* = nullptr*/)
 	leader->onGainSharedExperience(shareExperience, target);
 }
 
-bool Party::canUseSharedExperience(const Player* player) const
+uint32_t Party::getSharedExperienceMinLevel() const
 {
-	if (memberList.empty()) {
-		return false;
-	}
-
 	uint32_t highestLevel = leader->getLevel();
 	for (Player* member : memberList) {
 		if (member->getLevel() > highestLevel) {
 			highestLevel = member->getLevel();
 		}
 	}
+	return static_cast<uint32_t>(std::ceil((static_cast<float>(highestLevel) * 2) / 3));
+}
 
-	uint32_t minLevel = static_cast<uint32_t>(std::ceil((static_cast<float>(highestLevel) * 2) / 3));
+bool Party::canUseSharedExperience(const Player* player) const
+{
+	if (memberList.empty()) {
+		return false;
+	}
+	return canUseSharedExperience(player, getSharedExperienceMinLevel());
+}
+
+bool Party::canUseSharedExperience(const Player* player, uint32_t minLevel) const
+{
 	if (player->getLevel() < minLevel) {
 		return false;
 	}
@@ -413,12 +430,18 @@ bool Party::canUseSharedExperience(const Player* player) const
 
 bool Party::canEnableSharedExperience()
 {
-	if (!canUseSharedExperience(leader)) {
+	if (memberList.empty()) {
+		return false;
+	}
+
+	// the level range is the same for everyone, it is computed once per check
+	uint32_t minLevel = getSharedExperienceMinLevel();
+	if (!canUseSharedExperience(leader, minLevel)) {
 		return false;
 	}
 
 	for (Player* member : memberList) {
-		if (!canUseSharedExperience(member)) {
+		if (!canUseSharedExperience(member, minLevel)) {
 			return false;
 		}
 	}
@@ -429,7 +452,10 @@ void Party::updatePlayerTicks(Player* player, uint32_t points)
 {
 	if (points != 0 && !player->hasFlag(PlayerFlag_NotGainInFight)) {
 		ticksMap[player->getID()] = OTSYS_TIME();
-		updateSharedExperience();
+		// refreshing the activity of a member can only enable the shared experience
+		if (!sharedExpEnabled) {
+			updateSharedExperience();
+		}
 	}
 }
 
@@ -576,6 +602,19 @@ void Party::updateTrackerAnalyzer() const
 	}
 }
 
+void Party::scheduleTrackerAnalyzerUpdate()
+{
+	if (trackerAnalyzerEvent == 0) {
+		trackerAnalyzerEvent = g_scheduler().addEvent(createSchedulerTask(PARTY_ANALYZER_UPDATE_INTERVAL, std::bind(&Party::sendTrackerAnalyzerUpdate, this)));
+	}
+}
+
+void Party::sendTrackerAnalyzerUpdate()
+{
+	trackerAnalyzerEvent = 0;
+	updateTrackerAnalyzer();
+}
+
 void Party::addPlayerLoot(const Player* player, const Item* item)
 {
 	PartyAnalyzer* playerAnalyzer = getPlayerPartyAnalyzerStruct(player->getID());
@@ -597,7 +636,7 @@ void Party::addPlayerLoot(const Player* player, const Item* item)
 		std::map<uint16_t, uint64_t> itemMap {{item->getID(), count}};
 		playerAnalyzer->lootPrice += g_game().getItemMarketPrice(itemMap, false);
 	}
-	updateTrackerAnalyzer();
+	scheduleTrackerAnalyzerUpdate();
 }
 
 void Party::addPlayerSupply(const Player* player, const Item* item)
@@ -620,7 +659,7 @@ void Party::addPlayerSupply(const Player* player, const Item* item)
 		std::map<uint16_t, uint64_t> itemMap {{item->getID(), 1}};
 		playerAnalyzer->supplyPrice += g_game().getItemMarketPrice(itemMap, true);
 	}
-	updateTrackerAnalyzer();
+	scheduleTrackerAnalyzerUpdate();
 }
 
 void Party::addPlayerDamage(const Player* player, uint64_t amount)
@@ -632,7 +671,7 @@ void Party::addPlayerDamage(const Player* player, uint64_t amount)
 	}
 
 	playerAnalyzer->damage += amount;
-	updateTrackerAnalyzer();
+	scheduleTrackerAnalyzerUpdate();
 }
 
 void Party::addPlayerHealing(const Player* player, uint64_t amount)
@@ -644,7 +683,7 @@ void Party::addPlayerHealing(const Player* player, uint64_t amount)
 	}
 
 	playerAnalyzer->healing += amount;
-	updateTrackerAnalyzer();
+	scheduleTrackerAnalyzerUpdate();
 }
 
 void Party::switchAnalyzerPriceType()
@@ -28,6 +28,9 @@ class Party;
 
 using PlayerVector = std::vector<Player*>;
 
+// damage, healing, loot and supply events of a party are sent to the analyzers at most this often
+static constexpr int32_t PARTY_ANALYZER_UPDATE_INTERVAL = 1000;
+
 class Party
 {
 	public:
@@ -88,6 +91,7 @@ class Party
 		void updatePlayerVocation(const Player* player);
 
 		void updateTrackerAnalyzer() const;
+		void scheduleTrackerAnalyzerUpdate();
 		void addPlayerLoot(const Player* player, const Item* item);
 		void addPlayerSupply(const Player* player, const Item* item);
 		void addPlayerDamage(const Player* player, uint64_t amount);
@@ -120,8 +124,12 @@ class Party
 
 	private:
 		bool canEnableSharedExperience();
+		uint32_t getSharedExperienceMinLevel() const;
+		bool canUseSharedExperience(const Player* player, uint32_t minLevel) const;
+		void sendTrackerAnalyzerUpdate();
 
-		std::map<uint32_t, int64_t> ticksMap;
+		phmap::flat_hash_map<uint32_t, int64_t> ticksMap;
+		uint32_t trackerAnalyzerEvent = 0;
 
 		PlayerVector memberList;
 		PlayerVector inviteList;
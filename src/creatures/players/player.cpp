@@ -24,6 +24,8 @@
 #include "creatures/monsters/monster.h"
 #include "creatures/monsters/monsters.h"
 #include "creatures/players/player.h"
+#include "game/cyclopedia_cache.hpp"
+#include "game/experience_stages.hpp"
 #include "game/game.h"
 #include "game/scheduling/scheduler.h"
 #include "grouping/familiars.h"
@@ -50,6 +52,19 @@ Player::Player(ProtocolGame_ptr p) :
 
 Player::~Player()
 {
+	if (imbuementEvent != 0) {
+		g_scheduler().stopEvent(imbuementEvent);
+	}
+
+	for (const auto& callback : depotLoadCallbacks) {
+		callback(nullptr);
+	}
+
+	// the containers are only compared here, some may be gone already
+	for (const auto& [cid, openContainer] : openContainers) {
+		g_game().removeContainerViewer(openContainer.container, this, cid);
+	}
+
 	for (Item* item : inventory) {
 		if (item) {
 			item->setParent(nullptr);
@@ -472,17 +487,25 @@ void Player::updateInventoryWeight()
 	}
 }
 
-void Player::updateInventoryImbuement(bool init /* = false */)
+void Player::updateInventoryImbuement()
 {
-	uint8_t imbuementsToCheck = g_game().getPlayerActiveImbuements(getID());
-	for (int items = CONST_SLOT_FIRST; items <= CONST_SLOT_LAST; ++items) {
-		/*
-		 * Small optimization to avoid unneeded iteration.
-		 */
-		if (!init && imbuementsToCheck == 0) {
-			break;
-		}
+	int64_t now = OTSYS_TIME();
+	if (imbuementUpdateTime == 0) {
+		imbuementUpdateTime = now;
+	}
+
+	// whole seconds since the last update, the remainder is carried over
+	int32_t elapsed = static_cast<int32_t>((now - imbuementUpdateTime) / 1000);
+	imbuementUpdateTime += static_cast<int64_t>(elapsed) * 1000;
 
+	// aggressive imbuements only decay out of protection zone and in fight,
+	// the state is sampled here and every transition of it calls this function
+	bool aggressiveDecayed = imbuementAggressiveDecay;
+	const Tile* playerTile = getTile();
+	imbuementAggressiveDecay = !(playerTile && playerTile->hasFlag(TILESTATE_PROTECTIONZONE)) && hasCondition(CONDITION_INFIGHT);
+
+	int32_t nextExpiration = std::numeric_limits<int32_t>::max();
+	for (int items = CONST_SLOT_FIRST; items <= CONST_SLOT_LAST; ++items) {
 		Item* item = inventory[items];
 		if (!item) {
 			continue;
@@ -494,36 +517,39 @@ void Player::updateInventoryImbuement(bool init /* = false */)
 				continue;
 			}
 
-			// Time not decay on protection zone
-			const Tile* playerTile = getTile();
 			const CategoryImbuement *categoryImbuement = g_imbuements().getCategoryByID(imbuementInfo.imbuement->getCategory());
-			if (categoryImbuement->agressive && playerTile && playerTile->hasFlag(TILESTATE_PROTECTIONZONE)) {
-				continue;
-			}
-
-			// Time not decay if not is infight mode
-			if (categoryImbuement->agressive && !hasCondition(CONDITION_INFIGHT)) {
-				continue;
+			int32_t duration = imbuementInfo.duration;
+			if (elapsed > 0 && (!categoryImbuement->agressive || aggressiveDecayed)) {
+				duration = std::max<int32_t>(0, duration - elapsed);
+				item->decayImbuementTime(slotid, imbuementInfo.imbuement->getID(), duration);
+				if (duration == 0) {
+					removeItemImbuementStats(imbuementInfo.imbuement);
+					continue;
+				}
 			}
 
-			if (init) {
-				g_game().increasePlayerActiveImbuements(getID());
+			if (!categoryImbuement->agressive || imbuementAggressiveDecay) {
+				nextExpiration = std::min<int32_t>(nextExpiration, duration);
 			}
+		}
+	}
 
-			int32_t duration = std::max<int32_t>(0, imbuementInfo.duration - EVENT_IMBUEMENT_INTERVAL / 1000);
-			item->decayImbuementTime(slotid, imbuementInfo.imbuement->getID(), duration);
-			if (duration == 0) {
-				removeItemImbuementStats(imbuementInfo.imbuement);
-				g_game().decreasePlayerActiveImbuements(getID());
-			}
+	if (imbuementEvent != 0) {
+		g_scheduler().stopEvent(imbuementEvent);
+		imbuementEvent = 0;
+	}
 
-			imbuementsToCheck--;
-		}
+	if (nextExpiration == std::numeric_limits<int32_t>::max()) {
+		return;
 	}
+
+	int64_t delay = static_cast<int64_t>(nextExpiration) * 1000 - (now - imbuementUpdateTime);
+	delay = std::clamp<int64_t>(delay, SCHEDULER_MINTICKS, IMBUEMENT_UPDATE_INTERVAL);
+	imbuementEvent = g_scheduler().addEvent(createSchedulerTask(static_cast<uint32_t>(delay), std::bind(&Game::checkImbuements, &g_game(), getID())));
 }
 
 void Player::setTraining(bool value) {
-	for (const auto& [key, player] : g_game().getPlayers()) {
+	for (Player* player : g_game().getVipWatchers(guid)) {
 		if (!this->isInGhostMode() || player->isAccessPlayer()) {
 			player->notifyStatusChange(this, value ? VIPSTATUS_TRAINING : VIPSTATUS_ONLINE, false);
 		}
@@ -646,6 +672,7 @@ void Player::addContainer(uint8_t cid, Container* container)
 	if (it != openContainers.end()) {
 		OpenContainer& openContainer = it->second;
 		Container* oldContainer = openContainer.container;
+		g_game().removeContainerViewer(oldContainer, this, cid);
 		if (oldContainer->getID() == ITEM_BROWSEFIELD) {
 			oldContainer->decrementReferenceCounter();
 		}
@@ -658,6 +685,7 @@ void Player::addContainer(uint8_t cid, Container* container)
 		openContainer.index = 0;
 		openContainers[cid] = openContainer;
 	}
+	g_game().addContainerViewer(container, this, cid);
 }
 
 void Player::closeContainer(uint8_t cid)
@@ -670,6 +698,7 @@ void Player::closeContainer(uint8_t cid)
 	OpenContainer openContainer = it->second;
 	Container* container = openContainer.container;
 	openContainers.erase(it);
+	g_game().removeContainerViewer(container, this, cid);
 
 	if (container && container->getID() == ITEM_BROWSEFIELD) {
 		container->decrementReferenceCounter();
@@ -749,29 +778,28 @@ void Player::addStorageValue(const uint32_t key, const int32_t value, const bool
 	}
 
 	if (value != -1) {
-		int32_t oldValue;
-		getStorageValue(key, oldValue);
-
-		storageMap[key] = value;
-
-		if (!isLogin) {
+		if (isLogin) {
+			storage.load(key, value);
+		} else if (!g_events().hasListener(EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE)) {
+			storage.set(key, value);
+		} else {
+			int32_t oldValue;
+			getStorageValue(key, oldValue);
+			storage.set(key, value);
 			auto currentFrameTime = g_dispatcher().getDispatcherCycle();
 			g_events().eventOnStorageUpdate(this, key, value, oldValue, currentFrameTime);
 		}
 	} else {
-		storageMap.erase(key);
+		storage.erase(key);
 	}
 }
 
 bool Player::getStorageValue(const uint32_t key, int32_t& value) const
 {
-	auto it = storageMap.find(key);
-	if (it == storageMap.end()) {
+	if (!storage.get(key, value)) {
 		value = -1;
 		return false;
 	}
-
-	value = it->second;
 	return true;
 }
 
@@ -1003,6 +1031,8 @@ bool Player::isNearDepotBox() const
 
 DepotChest* Player::getDepotChest(uint32_t depotId, bool autoCreate)
 {
+	ensureDepotLoaded();
+
 	auto it = depotChests.find(depotId);
 	if (it != depotChests.end()) {
 		return it->second;
@@ -1030,6 +1060,8 @@ DepotChest* Player::getDepotChest(uint32_t depotId, bool autoCreate)
 
 DepotLocker* Player::getDepotLocker(uint32_t depotId)
 {
+	ensureDepotLoaded();
+
 	auto it = depotLockerMap.find(depotId);
 	if (it != depotLockerMap.end()) {
 		inbox->setParent(it->second);
@@ -1057,6 +1089,33 @@ DepotLocker* Player::getDepotLocker(uint32_t depotId)
 	return depotLocker;
 }
 
+void Player::loadDepot(std::function<void(Player*)> callback)
+{
+	if (!depotPending) {
+		callback(this);
+		return;
+	}
+
+	depotLoadCallbacks.push_back(std::move(callback));
+	if (depotLoadCallbacks.size() == 1) {
+		IOLoginData::loadDepotAsync(this);
+	}
+}
+
+void Player::loadDepotNow()
+{
+	IOLoginData::loadDepot(this);
+}
+
+void Player::onDepotLoaded()
+{
+	std::vector<std::function<void(Player*)>> callbacks = std::move(depotLoadCallbacks);
+	depotLoadCallbacks.clear();
+	for (const auto& callback : callbacks) {
+		callback(this);
+	}
+}
+
 RewardChest* Player::getRewardChest()
 {
 	if (rewardChest != nullptr) {
@@ -1228,6 +1287,8 @@ void Player::onApplyImbuement(Imbuement *imbuement, Item *item, uint8_t slot, bo
 		return;
 	}
 
+	updateInventoryImbuement();
+
 	ImbuementInfo imbuementInfo;
 	if (item->getImbuementInfo(slot, &imbuementInfo))
 	{
@@ -1312,6 +1373,8 @@ void Player::onClearImbuement(Item* item, uint8_t slot)
 		return;
 	}
 
+	updateInventoryImbuement();
+
 	ImbuementInfo imbuementInfo;
 	if (!item->getImbuementInfo(slot, &imbuementInfo))
 	{
@@ -1349,6 +1412,8 @@ void Player::openImbuementWindow(Item* item)
 		return;
 	}
 
+	updateInventoryImbuement();
+
 	if (item->getTopParent() != this) {
 		this->sendTextMessage(MESSAGE_FAILURE,
 			"You have to pick up the item to imbue it.");
@@ -1373,7 +1438,7 @@ void Player::sendMarketEnter(uint32_t depotId)
 }
 
 //container
-void Player::sendAddContainerItem(const Container* container, const Item* item)
+void Player::sendAddContainerItem(uint8_t cid, const Container* container, const Item* item)
 {
 	if (!client) {
 		return;
@@ -1383,55 +1448,57 @@ void Player::sendAddContainerItem(const Container* container, const Item* item)
 		return;
 	}
 
-	for (const auto& it : openContainers) {
-		const OpenContainer& openContainer = it.second;
-		if (openContainer.container != container) {
-			continue;
-		}
+	auto it = openContainers.find(cid);
+	if (it == openContainers.end()) {
+		return;
+	}
 
-		uint16_t slot = openContainer.index;
-		if (container->getID() == ITEM_BROWSEFIELD) {
-			uint16_t containerSize = container->size() - 1;
-			uint16_t pageEnd = openContainer.index + container->capacity() - 1;
-			if (containerSize > pageEnd) {
-				slot = pageEnd;
-				item = container->getItemByIndex(pageEnd);
-			} else {
-				slot = containerSize;
-			}
-		} else if (openContainer.index >= container->capacity()) {
-			item = container->getItemByIndex(openContainer.index - 1);
+	const OpenContainer& openContainer = it->second;
+	if (openContainer.container != container) {
+		return;
+	}
+
+	uint16_t slot = openContainer.index;
+	if (container->getID() == ITEM_BROWSEFIELD) {
+		uint16_t containerSize = container->size() - 1;
+		uint16_t pageEnd = openContainer.index + container->capacity() - 1;
+		if (containerSize > pageEnd) {
+			slot = pageEnd;
+			item = container->getItemByIndex(pageEnd);
+		} else {
+			slot = containerSize;
 		}
-		client->sendAddContainerItem(it.first, slot, item);
+	} else if (openContainer.index >= container->capacity()) {
+		item = container->getItemByIndex(openContainer.index - 1);
 	}
+	client->sendAddContainerItem(cid, slot, item);
 }
 
-void Player::sendUpdateContainerItem(const Container* container, uint16_t slot, const Item* newItem)
+void Player::sendUpdateContainerItem(uint8_t cid, const Container* container, uint16_t slot, const Item* newItem)
 {
 	if (!client) {
 		return;
 	}
 
-	for (const auto& it : openContainers) {
-		const OpenContainer& openContainer = it.second;
-		if (openContainer.container != container) {
-			continue;
-		}
-
-		if (slot < openContainer.index) {
-			continue;
-		}
+	auto it = openContainers.find(cid);
+	if (it == openContainers.end()) {
+		return;
+	}
 
-		uint16_t pageEnd = openContainer.index + container->capacity();
-		if (slot >= pageEnd) {
-			continue;
-		}
+	const OpenContainer& openContainer = it->second;
+	if (openContainer.container != container || slot < openContainer.index) {
+		return;
+	}
 
-		client->sendUpdateContainerItem(it.first, slot, newItem);
+	uint16_t pageEnd = openContainer.index + container->capacity();
+	if (slot >= pageEnd) {
+		return;
 	}
+
+	client->sendUpdateContainerItem(cid, slot, newItem);
 }
 
-void Player::sendRemoveContainerItem(const Container* container, uint16_t slot)
+void Player::sendRemoveContainerItem(uint8_t cid, const Container* container, uint16_t slot)
 {
 	if (!client) {
 		return;
@@ -1441,20 +1508,23 @@ void Player::sendRemoveContainerItem(const Container* container, uint16_t slot)
 		return;
 	}
 
-	for (auto& it : openContainers) {
-		OpenContainer& openContainer = it.second;
-		if (openContainer.container != container) {
-			continue;
-		}
+	auto it = openContainers.find(cid);
+	if (it == openContainers.end()) {
+		return;
+	}
 
-		uint16_t& firstIndex = openContainer.index;
-		if (firstIndex > 0 && firstIndex >= container->size() - 1) {
-			firstIndex -= container->capacity();
-			sendContainer(it.first, container, false, firstIndex);
-		}
+	OpenContainer& openContainer = it->second;
+	if (openContainer.container != container) {
+		return;
+	}
 
-		client->sendRemoveContainerItem(it.first, std::max<uint16_t>(slot, firstIndex), container->getItemByIndex(container->capacity() + firstIndex));
+	uint16_t& firstIndex = openContainer.index;
+	if (firstIndex > 0 && firstIndex >= container->size() - 1) {
+		firstIndex -= container->capacity();
+		sendContainer(cid, container, false, firstIndex);
 	}
+
+	client->sendRemoveContainerItem(cid, std::max<uint16_t>(slot, firstIndex), container->getItemByIndex(container->capacity() + firstIndex));
 }
 
 void Player::onUpdateTileItem(const Tile* updateTile, const Position& pos, const Item* oldItem,
@@ -1574,6 +1644,8 @@ void Player::onFollowCreatureDisappear(bool isLogout)
 
 void Player::onChangeZone(ZoneType_t zone)
 {
+	updateInventoryImbuement();
+
 	if (zone == ZONE_PROTECTION) {
 		if (attackedCreature && !hasFlag(PlayerFlag_IgnoreProtectionZone)) {
 			setAttackedCreature(nullptr);
@@ -1651,17 +1723,7 @@ void Player::onRemoveCreature(Creature* creature, bool isLogout)
 
 		closeShopWindow();
 
-		bool saved = false;
-		for (uint32_t tries = 0; tries < 3; ++tries) {
-			if (IOLoginData::savePlayer(this)) {
-				saved = true;
-				break;
-			}
-		}
-
-		if (!saved) {
-			SPDLOG_WARN("Error while saving player: {}", getName());
-		}
+		IOLoginData::savePlayerAsync(this);
 	}
 
 	if (creature == shopOwner) {
@@ -1681,8 +1743,7 @@ bool Player::openShopWindow(Npc* npc)
 	npc->addShopPlayer(this);
 
 	sendShop(npc);
-	std::map<uint16_t, uint16_t> inventoryMap;
-	sendSaleItemList(getAllSaleItemIdAndCount(inventoryMap));
+	sendSaleItemList();
 	return true;
 }
 
@@ -2132,7 +2193,11 @@ void Player::addExperience(Creature* target, uint64_t exp, bool sendText/* = fal
 		return;
 	}
 
-	g_events().eventPlayerOnGainExperience(this, target, exp, rawExp);
+	if (g_events().hasListener(EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE)) {
+		g_events().eventPlayerOnGainExperience(this, target, exp, rawExp);
+	} else if (target && !target->getPlayer()) {
+		exp = g_experienceStages().getKillExperience(*this, *target, exp);
+	}
 	if (exp == 0) {
 		return;
 	}
@@ -2474,6 +2539,18 @@ void Player::death(Creature* lastHitCreature)
 {
 	loginPosition = town->getTemplePosition();
 
+	// the onDeath script stored the death, it is a recent death of this player and a pvp kill of its attackers
+	g_cyclopediaCache().invalidate(getGUID());
+	for (const auto& it : damageMap) {
+		const Creature* attacker = g_game().getCreatureByID(it.first);
+		if (attacker && attacker->getMaster()) {
+			attacker = attacker->getMaster();
+		}
+		if (const Player* attackerPlayer = attacker ? attacker->getPlayer() : nullptr) {
+			g_cyclopediaCache().invalidate(attackerPlayer->getGUID());
+		}
+	}
+
 	if (skillLoss) {
 		uint8_t unfairFightReduction = 100;
 		int playerDmg = 0;
@@ -2649,33 +2726,33 @@ void Player::death(Creature* lastHitCreature)
 			mana = manaMax;
 		}
 
-		auto it = conditions.begin(), end = conditions.end();
-		while (it != end) {
-			Condition* condition = *it;
+		size_t index = 0;
+		while (index < conditions.size()) {
+			Condition* condition = conditions[index];
 			if (condition->isPersistent()) {
-				it = conditions.erase(it);
+				conditions.erase(conditions.begin() + index);
 
 				condition->endCondition(this);
 				onEndCondition(condition->getType());
 				delete condition;
 			} else {
-				++it;
+				++index;
 			}
 		}
 	} else {
 		setSkillLoss(true);
 
-		auto it = conditions.begin(), end = conditions.end();
-		while (it != end) {
-			Condition* condition = *it;
+		size_t index = 0;
+		while (index < conditions.size()) {
+			Condition* condition = conditions[index];
 			if (condition->isPersistent()) {
-				it = conditions.erase(it);
+				conditions.erase(conditions.begin() + index);
 
 				condition->endCondition(this);
 				onEndCondition(condition->getType());
 				delete condition;
 			} else {
-				++it;
+				++index;
 			}
 		}
 
@@ -2771,7 +2848,7 @@ void Player::despawn()
 	g_game().removePlayer(this);
 
 	// show player as pending
-	for (const auto& [key, player] : g_game().getPlayers()) {
+	for (Player* player : g_game().getVipWatchers(guid)) {
 		player->notifyStatusChange(this, VIPSTATUS_PENDING, false);
 	}
 
@@ -2823,14 +2900,14 @@ void Player::removeList()
 {
 	g_game().removePlayer(this);
 
-	for (const auto& [key, player] : g_game().getPlayers()) {
+	for (Player* player : g_game().getVipWatchers(guid)) {
 		player->notifyStatusChange(this, VIPSTATUS_OFFLINE);
 	}
 }
 
 void Player::addList()
 {
-	for (const auto& [key, player] : g_game().getPlayers()) {
+	for (Player* player : g_game().getVipWatchers(guid)) {
 		player->notifyStatusChange(this, this->statusVipList);
 	}
 
@@ -2875,6 +2952,7 @@ bool Player::removeVIP(uint32_t vipGuid)
 		return false;
 	}
 
+	g_game().removeVipWatcher(vipGuid, this);
 	IOLoginData::removeVIPEntry(accountNumber, vipGuid);
 	return true;
 }
@@ -2892,6 +2970,10 @@ bool Player::addVIP(uint32_t vipGuid, const std::string& vipName, VipStatus_t st
 		return false;
 	}
 
+	if (g_game().getPlayerByID(getID()) == this) {
+		g_game().addVipWatcher(vipGuid, this);
+	}
+
 	IOLoginData::addVIPEntry(accountNumber, vipGuid, "", 0, false);
 	if (client) {
 		client->sendVIP(vipGuid, vipName, "", 0, false, status);
@@ -3421,6 +3503,7 @@ void Player::addThing(int32_t index, Thing* thing)
 		return /*RETURNVALUE_NOTPOSSIBLE*/;
 	}
 
+	updateInventoryImbuement();
 	item->setParent(this);
 	inventory[index] = item;
 
@@ -3435,6 +3518,8 @@ void Player::updateThing(Thing* thing, uint16_t itemId, uint32_t count)
 		return /*RETURNVALUE_NOTPOSSIBLE*/;
 	}
 
+	updateInventoryImbuement();
+
 	Item* item = thing->getItem();
 	if (!item) {
 		return /*RETURNVALUE_NOTPOSSIBLE*/;
@@ -3466,6 +3551,8 @@ void Player::replaceThing(uint32_t index, Thing* thing)
 		return /*RETURNVALUE_NOTPOSSIBLE*/;
 	}
 
+	updateInventoryImbuement();
+
 	//send to client
 	sendInventoryItem(static_cast<Slots_t>(index), item);
 
@@ -3489,6 +3576,8 @@ void Player::removeThing(Thing* thing, uint32_t count)
 		return /*RETURNVALUE_NOTPOSSIBLE*/;
 	}
 
+	updateInventoryImbuement();
+
 	if (item->isStackable()) {
 		if (count == item->getItemCount()) {
 			//send change to client
@@ -3541,8 +3630,35 @@ size_t Player::getLastIndex() const
 	return CONST_SLOT_LAST + 1;
 }
 
+void Player::updateInventoryItemIndex() const
+{
+	if (!inventoryItemIndexOutdated) {
+		return;
+	}
+
+	inventoryItemCounts.clear();
+	inventoryTierItemCounts.clear();
+	inventorySaleItemCounts.clear();
+	for (Item* item : getAllInventoryItems()) {
+		uint16_t itemId = item->getID();
+		uint32_t count = item->getItemCount();
+		inventoryItemCounts[itemId] += count;
+		(inventoryTierItemCounts[itemId])[item->getTier()] += count;
+		if (item->getTier() == 0 && !item->hasImbuements()) {
+			inventorySaleItemCounts[itemId] += count;
+		}
+	}
+	inventoryItemIndexOutdated = false;
+}
+
 uint32_t Player::getItemTypeCount(uint16_t itemId, int32_t subType /*= -1*/) const
 {
+	if (subType == -1) {
+		updateInventoryItemIndex();
+		auto it = inventoryItemCounts.find(itemId);
+		return it != inventoryItemCounts.end() ? it->second : 0;
+	}
+
 	uint32_t count = 0;
 	for (int32_t i = CONST_SLOT_FIRST; i <= CONST_SLOT_LAST; i++) {
 		Item* item = inventory[i];
@@ -3570,19 +3686,24 @@ bool Player::isStashExhausted() const {
 	return (OTSYS_TIME() - lastStashInteraction < exhaust_time);
 }
 
-void Player::stashContainer(StashContainerList itemDict)
+void Player::endBulkRemove()
 {
-	StashItemList stashItemDict; // ItemID - Count
-	for (auto it_dict : itemDict) {
-		stashItemDict[(it_dict.first)->getID()] = it_dict.second;
+	if (--bulkRemoveDepth != 0 || !bulkRemoveUpdatePending) {
+		return;
 	}
 
-	for (auto it : stashItems) {
-		if(!stashItemDict[it.first]) {
-			stashItemDict[it.first] = it.second;
-		} else {
-			stashItemDict[it.first] += it.second;
-		}
+	bulkRemoveUpdatePending = false;
+	updateInventoryWeight();
+	updateItemsLight();
+	sendInventoryIds();
+	sendStats();
+}
+
+void Player::stashContainer(StashContainerList itemDict)
+{
+	StashItemList stashItemDict = stashItems; // ItemID - Count
+	for (const auto& [item, count] : itemDict) {
+		stashItemDict[item->getID()] += count;
 	}
 
 	if (getStashSize(stashItemDict) > g_configManager().getNumber(STASH_ITEMS)) {
@@ -3590,17 +3711,25 @@ void Player::stashContainer(StashContainerList itemDict)
 		return;
 	}
 
+	// the stash counts are added per item id after the removal, not per stack
+	StashItemList stowedItems;
+	beginBulkRemove();
+	for (const auto& [item, count] : itemDict) {
+		uint16_t itemId = item->getID();
+		if (g_game().internalRemoveItem(item, count) == RETURNVALUE_NOERROR) {
+			stowedItems[itemId] += count;
+		}
+	}
+	endBulkRemove();
+
 	uint32_t totalStowed = 0;
 	std::ostringstream retString;
 	uint16_t refreshDepotSearchOnItem = 0;
-	for (auto stashIterator : itemDict) {
-		uint16_t iteratorCID = (stashIterator.first)->getID();
-		if (g_game().internalRemoveItem(stashIterator.first, stashIterator.second) == RETURNVALUE_NOERROR) {
-			addItemOnStash(iteratorCID, stashIterator.second);
-			totalStowed += stashIterator.second;
-			if (isDepotSearchOpenOnItem(iteratorCID)) {
-				refreshDepotSearchOnItem = iteratorCID;
-			}
+	for (const auto& [itemId, count] : stowedItems) {
+		addItemOnStash(itemId, count);
+		totalStowed += count;
+		if (isDepotSearchOpenOnItem(itemId)) {
+			refreshDepotSearchOnItem = itemId;
 		}
 	}
 
@@ -3628,6 +3757,11 @@ bool Player::removeItemOfType(uint16_t itemId, uint32_t amount, int32_t subType,
 		return true;
 	}
 
+	// the equipped items are part of the count, so it is an upper bound either way
+	if (subType == -1 && getItemTypeCount(itemId) < amount) {
+		return false;
+	}
+
 	std::vector<Item*> itemList;
 
 	uint32_t count = 0;
@@ -3675,22 +3809,8 @@ bool Player::removeItemOfType(uint16_t itemId, uint32_t amount, int32_t subType,
 
 ItemsTierCountList Player::getInventoryItemsId() const
 {
-	ItemsTierCountList itemMap;
-	for (int32_t i = CONST_SLOT_FIRST; i <= CONST_SLOT_LAST; i++) {
-		Item* item = inventory[i];
-		if (!item) {
-			continue;
-		}
-
-		(itemMap[item->getID()])[item->getTier()] += Item::countByType(item, -1);
-		if (Container* container = item->getContainer()) {
-			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
-				auto containerItem = *it;
-				(itemMap[containerItem->getID()])[containerItem->getTier()] += Item::countByType(containerItem, -1);
-			}
-		}
-	}
-	return itemMap;
+	updateInventoryItemIndex();
+	return inventoryTierItemCounts;
 }
 
 std::vector<Item*> Player::getInventoryItemsFromId(uint16_t itemId, bool ignore /*= true*/) const
@@ -3743,27 +3863,13 @@ std::vector<Item*> Player::getAllInventoryItems() const
 
 std::map<uint32_t, uint32_t>& Player::getAllItemTypeCount(std::map<uint32_t, uint32_t>& countMap) const
 {
-	for (auto item : getAllInventoryItems()) {
-		countMap[static_cast<uint32_t>(item->getID())] += Item::countByType(item, -1);
+	updateInventoryItemIndex();
+	for (const auto& [itemId, count] : inventoryItemCounts) {
+		countMap[static_cast<uint32_t>(itemId)] += count;
 	}
 	return countMap;
 }
 
-std::map<uint16_t, uint16_t>& Player::getAllSaleItemIdAndCount(std::map<uint16_t, uint16_t> &countMap) const
-{
-	for (auto item : getAllInventoryItems()) {
-		if (item->getTier() > 0) {
-			continue;
-		}
-		
-		if (!item->hasImbuements()) {
-			countMap[item->getID()] += item->getItemCount();
-		}
-	}
-
-	return countMap;
-}
-
 void Player::getAllItemTypeCountAndSubtype(std::map<uint32_t, uint32_t>& countMap) const
 {
 	for (auto item : getAllInventoryItems()) {
@@ -3786,6 +3892,10 @@ Thing* Player::getThing(size_t index) const
 
 void Player::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t index, CylinderLink_t link /*= LINK_OWNER*/)
 {
+	if (link == LINK_OWNER || link == LINK_TOPPARENT) {
+		inventoryItemIndexOutdated = true;
+	}
+
 	if (link == LINK_OWNER) {
 		//calling movement scripts
 		g_moveEvents().onPlayerEquip(*this, *thing->getItem(), static_cast<Slots_t>(index), false);
@@ -3841,6 +3951,10 @@ void Player::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_
 
 void Player::postRemoveNotification(Thing* thing, const Cylinder* newParent, int32_t index, CylinderLink_t link /*= LINK_OWNER*/)
 {
+	if (link == LINK_OWNER || link == LINK_TOPPARENT) {
+		inventoryItemIndexOutdated = true;
+	}
+
 	if (link == LINK_OWNER) {
 		//calling movement scripts
 		g_moveEvents().onPlayerDeEquip(*this, *thing->getItem(), static_cast<Slots_t>(index));
@@ -3861,10 +3975,14 @@ void Player::postRemoveNotification(Thing* thing, const Cylinder* newParent, int
 			requireListUpdate = newParent != this;
 		}
 
-		updateInventoryWeight();
-		updateItemsLight();
-		sendInventoryIds();
-		sendStats();
+		if (bulkRemoveDepth != 0) {
+			bulkRemoveUpdatePending = true;
+		} else {
+			updateInventoryWeight();
+			updateItemsLight();
+			sendInventoryIds();
+			sendStats();
+		}
 	}
 
 	if (const Item* item = thing->getItem()) {
@@ -3923,7 +4041,12 @@ bool Player::hasShopItemForSale(uint16_t itemId, uint8_t subType) const
 	}
 
 	const ItemType& itemType = Item::items[itemId];
-	std::vector<ShopBlock> shoplist = shopOwner->getShopItemVector();
+	if (!itemType.isFluidContainer()) {
+		return shopOwner->getShopItemPrices(itemId).buyPrice != 0;
+	}
+
+	// fluids are sold per subtype, which the price index does not keep apart
+	const std::vector<ShopBlock>& shoplist = shopOwner->getShopItemVector();
 	return std::any_of(shoplist.begin(), shoplist.end(), [&](const ShopBlock& shopBlock) {
 		return shopBlock.itemId == itemId && shopBlock.itemBuyPrice != 0 && (!itemType.isFluidContainer() || shopBlock.itemSubType == subType);
 	});
@@ -3949,6 +4072,7 @@ void Player::internalAddThing(uint32_t index, Thing* thing)
 
 		inventory[index] = item;
 		item->setParent(this);
+		inventoryItemIndexOutdated = true;
 	}
 }
 
@@ -4145,6 +4269,8 @@ void Player::onAddCondition(ConditionType_t type)
 
 	if (type == CONDITION_OUTFIT && isMounted()) {
 		dismount();
+	} else if (type == CONDITION_INFIGHT) {
+		updateInventoryImbuement();
 	}
 
 	sendIcons();
@@ -4199,6 +4325,7 @@ void Player::onEndCondition(ConditionType_t type)
 	Creature::onEndCondition(type);
 
 	if (type == CONDITION_INFIGHT) {
+		updateInventoryImbuement();
 		onIdleStatus();
 		pzLocked = false;
 		clearAttacked();
@@ -4372,6 +4499,7 @@ bool Player::onKilledCreature(Creature* target, bool lastHit/* = true*/)
 							kill.unavenged = false;
 							auto it = attackedSet.find(targetPlayer->guid);
 							attackedSet.erase(it);
+							g_game().invalidatePlayerRelations();
 							break;
 						}
 					}
@@ -4549,12 +4677,12 @@ void Player::genReservedStorageRange()
 	// generate outfits range
 	uint32_t outfits_key = PSTRG_OUTFITS_RANGE_START;
 	for (const OutfitEntry& entry : outfits) {
-		storageMap[++outfits_key] = (entry.lookType << 16) | entry.addons;
+		storage.set(++outfits_key, (entry.lookType << 16) | entry.addons);
 	}
 	// generate familiars range
 	uint32_t familiar_key = PSTRG_FAMILIARS_RANGE_START;
 	for (const FamiliarEntry& entry : familiars) {
-		storageMap[++familiar_key] = (entry.lookType << 16);
+		storage.set(++familiar_key, entry.lookType << 16);
 	}
 }
 
@@ -4690,6 +4818,12 @@ bool Player::getFamiliar(const Familiar& familiar) const {
 	return true;
 }
 
+void Player::setGroup(Group* newGroup)
+{
+	group = newGroup;
+	g_game().invalidatePlayerRelations();
+}
+
 void Player::setSex(PlayerSex_t newSex)
 {
 	sex = newSex;
@@ -4710,28 +4844,62 @@ Skulls_t Player::getSkullClient(const Creature* creature) const
 	}
 
 	const Player* player = creature->getPlayer();
-	if (player && player->getSkull() == SKULL_NONE) {
-		if (player == this) {
-			for (const auto& kill : unjustifiedKills) {
-				if (kill.unavenged && (time(nullptr) - kill.time) < g_configManager().getNumber(ORANGE_SKULL_DURATION) * 24 * 60 * 60) {
-					return SKULL_ORANGE;
-				}
+	if (!player) {
+		return Creature::getSkullClient(creature);
+	}
+
+	PlayerRelation& relation = getPlayerRelation(player);
+	time_t now = time(nullptr);
+	if ((relation.fields & PLAYER_RELATION_SKULL) == 0 || now >= relation.skullValidUntil) {
+		relation.skull = computeSkullClient(player, now, relation.skullValidUntil);
+		relation.fields |= PLAYER_RELATION_SKULL;
+	}
+	return relation.skull;
+}
+
+Skulls_t Player::computeSkullClient(const Player* player, time_t now, time_t& validUntil) const
+{
+	validUntil = std::numeric_limits<time_t>::max();
+	if (player->getSkull() != SKULL_NONE) {
+		return player->getSkull();
+	}
+
+	time_t orangeSkullDuration = g_configManager().getNumber(ORANGE_SKULL_DURATION) * 24 * 60 * 60;
+	if (player == this) {
+		for (const auto& kill : unjustifiedKills) {
+			if (kill.unavenged && (now - kill.time) < orangeSkullDuration) {
+				validUntil = kill.time + orangeSkullDuration;
+				return SKULL_ORANGE;
 			}
 		}
+	}
 
-		if (player->hasKilled(this)) {
+	// same as player->hasKilled(this)
+	for (const auto& kill : player->unjustifiedKills) {
+		if (kill.target == getGUID() && kill.unavenged && (now - kill.time) < orangeSkullDuration) {
+			validUntil = kill.time + orangeSkullDuration;
 			return SKULL_ORANGE;
 		}
+	}
 
-		if (player->hasAttacked(this)) {
-			return SKULL_YELLOW;
-		}
+	if (player->hasAttacked(this)) {
+		return SKULL_YELLOW;
+	}
 
-		if (party && party == player->party) {
-			return SKULL_GREEN;
-		}
+	if (party && party == player->party) {
+		return SKULL_GREEN;
+	}
+	return SKULL_NONE;
+}
+
+Player::PlayerRelation& Player::getPlayerRelation(const Player* player) const
+{
+	if (uint32_t version = g_game().getPlayerRelationsVersion();
+		playerRelationsVersion != version) {
+		playerRelations.clear();
+		playerRelationsVersion = version;
 	}
-	return Creature::getSkullClient(creature);
+	return playerRelations[player->getID()];
 }
 
 bool Player::hasKilled(const Player* player) const
@@ -4760,7 +4928,9 @@ void Player::addAttacked(const Player* attacked)
 		return;
 	}
 
-	attackedSet.insert(attacked->guid);
+	if (attackedSet.insert(attacked->guid).second) {
+		g_game().invalidatePlayerRelations();
+	}
 }
 
 void Player::removeAttacked(const Player* attacked)
@@ -4772,12 +4942,16 @@ void Player::removeAttacked(const Player* attacked)
 	auto it = attackedSet.find(attacked->guid);
 	if (it != attackedSet.end()) {
 		attackedSet.erase(it);
+		g_game().invalidatePlayerRelations();
 	}
 }
 
 void Player::clearAttacked()
 {
-	attackedSet.clear();
+	if (!attackedSet.empty()) {
+		attackedSet.clear();
+		g_game().invalidatePlayerRelations();
+	}
 }
 
 void Player::addUnjustifiedDead(const Player* attacked)
@@ -4789,6 +4963,7 @@ void Player::addUnjustifiedDead(const Player* attacked)
 	sendTextMessage(MESSAGE_EVENT_ADVANCE, "Warning! The murder of " + attacked->getName() + " was not justified.");
 
 	unjustifiedKills.emplace_back(attacked->getGUID(), time(nullptr), true);
+	g_game().invalidatePlayerRelations();
 
 	uint8_t dayKills = 0;
 	uint8_t weekKills = 0;
@@ -4954,6 +5129,21 @@ PartyShields_t Player::getPartyShield(const Player* player) const
 		return SHIELD_NONE;
 	}
 
+	// the blinking shields follow the activity and distance of the members, those are never cached
+	if (party && party->isSharedExperienceActive() && !party->isSharedExperienceEnabled()) {
+		return computePartyShield(player);
+	}
+
+	PlayerRelation& relation = getPlayerRelation(player);
+	if ((relation.fields & PLAYER_RELATION_SHIELD) == 0) {
+		relation.shield = computePartyShield(player);
+		relation.fields |= PLAYER_RELATION_SHIELD;
+	}
+	return relation.shield;
+}
+
+PartyShields_t Player::computePartyShield(const Player* player) const
+{
 	if (party) {
 		if (party->getLeader() == player) {
 			if (party->isSharedExperienceActive()) {
@@ -5003,6 +5193,12 @@ PartyShields_t Player::getPartyShield(const Player* player) const
 	return SHIELD_NONE;
 }
 
+void Player::setParty(Party* newParty)
+{
+	party = newParty;
+	g_game().invalidatePlayerRelations();
+}
+
 bool Player::isInviting(const Player* player) const
 {
 	if (!player || !party || party->getLeader() != this) {
@@ -5063,6 +5259,16 @@ GuildEmblems_t Player::getGuildEmblem(const Player* player) const
 		return GUILDEMBLEM_NONE;
 	}
 
+	PlayerRelation& relation = getPlayerRelation(player);
+	if ((relation.fields & PLAYER_RELATION_EMBLEM) == 0) {
+		relation.emblem = computeGuildEmblem(player);
+		relation.fields |= PLAYER_RELATION_EMBLEM;
+	}
+	return relation.emblem;
+}
+
+GuildEmblems_t Player::computeGuildEmblem(const Player* player) const
+{
 	const Guild* playerGuild = player->getGuild();
 	if (!playerGuild) {
 		return GUILDEMBLEM_NONE;
@@ -5557,6 +5763,8 @@ void Player::setGuild(Guild* newGuild)
 		return;
 	}
 
+	g_game().invalidatePlayerRelations();
+
 	Guild* oldGuild = this->guild;
 
 	this->guildNick.clear();
@@ -5780,6 +5988,7 @@ void Player::stowItem(Item* item, uint32_t count, bool allItems) {
 		}
 	} else if (item->getContainer()) {
 		itemDict = item->getContainer()->getStowableItems();
+		beginBulkRemove();
 		for (Item* containerItem : item->getContainer()->getItems(true)) {
 			uint32_t depotChest = g_configManager().getNumber(DEPOTCHEST);
 			bool validDepot = depotChest > 0 && depotChest < 21;
@@ -5789,6 +5998,7 @@ void Player::stowItem(Item* item, uint32_t count, bool allItems) {
 				moved = true;
 			}
 		}
+		endBulkRemove();
 	} else {
 		itemDict.push_back(std::pair<Item*, uint32_t>(item, count));
 	}
@@ -5933,64 +6143,197 @@ void Player::triggerMomentum() {
 	}
 
 	double_t chance = item->getMomentumChance();
-	if (getZone() != ZONE_PROTECTION && hasCondition(CONDITION_INFIGHT) && ((OTSYS_TIME()/1000) % 2) == 0 && chance > 0 && uniform_random(1, 100) <= chance) {
-		bool triggered = false;
-		auto it = conditions.begin();
-		while (it != conditions.end()) {
-			auto condItem = *it;
-			ConditionType_t type = condItem->getType();
-			uint32_t spellId = condItem->getSubId();
-			int32_t ticks = condItem->getTicks();
-			int32_t newTicks = (ticks <= 2000) ? 0 : ticks - 2000;
-			triggered = true;
-			if (type == CONDITION_SPELLCOOLDOWN || (type == CONDITION_SPELLGROUPCOOLDOWN && spellId > SPELLGROUP_SUPPORT)) {
-				condItem->setTicks(newTicks);
-				type == CONDITION_SPELLGROUPCOOLDOWN ? sendSpellGroupCooldown(static_cast<SpellGroup_t>(spellId), newTicks) : sendSpellCooldown(static_cast<uint8_t>(spellId), newTicks);
+	int64_t timeNow = OTSYS_TIME();
+	if (getZone() != ZONE_PROTECTION && hasCondition(CONDITION_INFIGHT) && ((timeNow/1000) % 2) == 0 && chance > 0 && uniform_random(1, 100) <= chance) {
+		for (size_t spellId = 1; spellId < spellCooldowns.size(); ++spellId) {
+			int64_t& endTime = spellCooldowns[spellId];
+			if (endTime > timeNow) {
+				endTime = std::max<int64_t>(timeNow, endTime - 2000);
+				sendSpellCooldown(static_cast<uint8_t>(spellId), static_cast<uint32_t>(endTime - timeNow));
 			}
-			++it;
 		}
-		if (triggered) {
-			g_game().addMagicEffect(getPosition(), CONST_ME_HOURGLASS);
-			sendTextMessage(MESSAGE_ATTENTION, "Momentum was triggered.");
+		for (size_t groupId = SPELLGROUP_SUPPORT + 1; groupId < spellGroupCooldowns.size(); ++groupId) {
+			int64_t& endTime = spellGroupCooldowns[groupId];
+			if (endTime > timeNow) {
+				endTime = std::max<int64_t>(timeNow, endTime - 2000);
+				sendSpellGroupCooldown(static_cast<SpellGroup_t>(groupId), static_cast<uint32_t>(endTime - timeNow));
+			}
+		}
+		g_game().addMagicEffect(getPosition(), CONST_ME_HOURGLASS);
+		sendTextMessage(MESSAGE_ATTENTION, "Momentum was triggered.");
+	}
+}
+
+void Player::addSpellCooldown(uint8_t spellId, uint32_t ticks)
+{
+	int64_t endTime = OTSYS_TIME() + ticks;
+	if (spellCooldowns[spellId] > endTime) {
+		return;
+	}
+
+	spellCooldowns[spellId] = endTime;
+	if (spellId != 0 && ticks > 0) {
+		sendSpellCooldown(spellId, ticks);
+	}
+}
+
+void Player::addSpellGroupCooldown(SpellGroup_t groupId, uint32_t ticks)
+{
+	if (groupId >= spellGroupCooldowns.size()) {
+		return;
+	}
+
+	int64_t endTime = OTSYS_TIME() + ticks;
+	if (spellGroupCooldowns[groupId] > endTime) {
+		return;
+	}
+
+	spellGroupCooldowns[groupId] = endTime;
+	if (groupId != SPELLGROUP_NONE && ticks > 0) {
+		sendSpellGroupCooldown(groupId, ticks);
+	}
+}
+
+void Player::addCooldownCondition(const Condition* condition)
+{
+	if (condition->getTicks() < 0) {
+		return;
+	}
+
+	uint32_t ticks = static_cast<uint32_t>(condition->getTicks());
+	uint32_t subId = condition->getSubId();
+	if (condition->getType() == CONDITION_SPELLCOOLDOWN) {
+		if (subId <= std::numeric_limits<uint8_t>::max()) {
+			addSpellCooldown(static_cast<uint8_t>(subId), ticks);
+		}
+	} else if (subId <= std::numeric_limits<uint8_t>::max()) {
+		addSpellGroupCooldown(static_cast<SpellGroup_t>(subId), ticks);
+	}
+}
+
+void Player::serializeSpellCooldowns(PropWriteStream& propWriteStream) const
+{
+	// written as the conditions they replace, so stored characters load either way
+	int64_t timeNow = OTSYS_TIME();
+	auto serialize = [&propWriteStream, timeNow](ConditionType_t type, size_t subId, int64_t endTime) {
+		if (endTime <= timeNow) {
+			return;
 		}
+
+		std::unique_ptr<Condition> condition(Condition::createCondition(CONDITIONID_DEFAULT, type, static_cast<int32_t>(endTime - timeNow), 0, false, static_cast<uint32_t>(subId)));
+		condition->serialize(propWriteStream);
+		propWriteStream.write<uint8_t>(CONDITIONATTR_END);
+	};
+
+	for (size_t spellId = 0; spellId < spellCooldowns.size(); ++spellId) {
+		serialize(CONDITION_SPELLCOOLDOWN, spellId, spellCooldowns[spellId]);
+	}
+	for (size_t groupId = 0; groupId < spellGroupCooldowns.size(); ++groupId) {
+		serialize(CONDITION_SPELLGROUPCOOLDOWN, groupId, spellGroupCooldowns[groupId]);
 	}
 }
 
 /*******************************************************************************
  * Depot search system
  ******************************************************************************/
-void Player::requestDepotItems()
+const DepotLocker* Player::updateDepotSearchIndex()
 {
-	ItemsTierCountList itemMap;
-	uint16_t count = 0;
 	const DepotLocker* depotLocker = getDepotLocker(getLastDepotId());
 	if (!depotLocker) {
-		return;
+		return nullptr;
 	}
 
+	if (depotLocker == depotSearchLocker) {
+		bool outdated = false;
+		for (const auto& [container, revision] : depotSearchRevisions) {
+			if (container->getContentRevision() != revision) {
+				outdated = true;
+				break;
+			}
+		}
+
+		if (!outdated) {
+			return depotLocker;
+		}
+	}
+
+	// the depot boxes and the inbox are shared by every locker and do not report
+	// to their real parent, so their revisions are checked on their own
+	depotSearchRevisions.clear();
+	depotSearchRevisions.emplace_back(depotLocker, depotLocker->getContentRevision());
+	for (const Item* locker : depotLocker->getItemList()) {
+		const Container* c = locker->getContainer();
+		if (!c) {
+			continue;
+		}
+
+		depotSearchRevisions.emplace_back(c, c->getContentRevision());
+		for (const Item* item : c->getItemList()) {
+			if (const Container* box = item->getContainer()) {
+				depotSearchRevisions.emplace_back(box, box->getContentRevision());
+			}
+		}
+	}
+
+	depotSearchLocker = depotLocker;
+	depotSearchEntries.clear();
+	depotSearchItems.clear();
+	depotSearchItemsCount = 0;
 	for (Item* locker : depotLocker->getItemList()) {
 		const Container* c = locker->getContainer();
 		if (!c || c->empty()) {
 			continue;
 		}
 
+		bool isInbox = c->isInbox();
 		for (ContainerIterator it = c->iterator(); it.hasNext(); it.advance()) {
-			auto itemMap_it = itemMap.find((*it)->getID());
-
-			uint8_t itemTier = Item::items[(*it)->getID()].upgradeClassification > 0 ? (*it)->getTier() + 1 : 0;
-			if (itemMap_it == itemMap.end()) {
-				std::map<uint8_t, uint32_t> itemTierMap;
-				itemTierMap[itemTier] = Item::countByType((*it), -1);
-				itemMap[(*it)->getID()] = itemTierMap;
-				count++;
-			} else if (auto itemTier_it = itemMap[(*it)->getID()].find(itemTier); itemTier_it == itemMap[(*it)->getID()].end()) {
-				itemMap[(*it)->getID()][itemTier] = Item::countByType((*it), -1);
-				count++;
+			Item* item = *it;
+			uint16_t itemId = item->getID();
+			uint32_t count = Item::countByType(item, -1);
+
+			DepotSearchEntry& entry = depotSearchEntries[static_cast<uint32_t>(itemId) << 8 | item->getTier()];
+			if (isInbox) {
+				entry.inboxItems.push_back(item);
+				entry.inboxCount += count;
 			} else {
-				itemMap[(*it)->getID()][itemTier] += Item::countByType((*it), -1);
+				entry.depotItems.push_back(item);
+				entry.depotCount += count;
+			}
+
+			uint8_t itemTier = Item::items[itemId].upgradeClassification > 0 ? item->getTier() + 1 : 0;
+			auto [tierIt, inserted] = depotSearchItems[itemId].try_emplace(itemTier, 0);
+			tierIt->second += count;
+			if (inserted) {
+				depotSearchItemsCount++;
 			}
 		}
 	}
+	return depotLocker;
+}
+
+const Player::DepotSearchEntry* Player::getDepotSearchEntry(uint16_t itemId, uint8_t tier)
+{
+	auto it = depotSearchEntries.find(static_cast<uint32_t>(itemId) << 8 | tier);
+	return it != depotSearchEntries.end() ? &it->second : nullptr;
+}
+
+void Player::releaseDepotSearchIndex()
+{
+	depotSearchLocker = nullptr;
+	depotSearchRevisions = {};
+	depotSearchEntries = {};
+	depotSearchItems = {};
+	depotSearchItemsCount = 0;
+}
+
+void Player::requestDepotItems()
+{
+	if (!updateDepotSearchIndex()) {
+		return;
+	}
+
+	ItemsTierCountList itemMap = depotSearchItems;
+	uint16_t count = depotSearchItemsCount;
 
 	for (const auto& [itemId, itemCount] : getStashItems()) {
 		auto itemMap_it = itemMap.find(itemId);
@@ -6030,35 +6373,15 @@ void Player::requestDepotSearchItem(uint16_t itemId, uint8_t tier)
 		stashCount = getStashItemCount(itemId);
 	}
 
-	const DepotLocker* depotLocker = getDepotLocker(getLastDepotId());
-	if (!depotLocker) {
+	if (!updateDepotSearchIndex()) {
 		return;
 	}
 
-	for (Item* locker : depotLocker->getItemList()) {
-		const Container* c = locker->getContainer();
-		if (!c || c->empty()) {
-			continue;
-		}
-
-		for (ContainerIterator it = c->iterator(); it.hasNext(); it.advance()) {
-			Item* item = *it;
-			if (!item || item->getID() != itemId || item->getTier() != tier) {
-				continue;
-			}
-
-			if (c->isInbox()) {
-				if (inboxItems.size() < 255) {
-					inboxItems.push_back(item);
-				}
-				inboxCount += Item::countByType(item, -1);
-			} else {
-				if (depotItems.size() < 255) {
-					depotItems.push_back(item);
-				}
-				depotCount += Item::countByType(item, -1);
-			}
-		}
+	if (const DepotSearchEntry* entry = getDepotSearchEntry(itemId, tier)) {
+		depotItems.assign(entry->depotItems.begin(), entry->depotItems.begin() + std::min<size_t>(entry->depotItems.size(), 255));
+		inboxItems.assign(entry->inboxItems.begin(), entry->inboxItems.begin() + std::min<size_t>(entry->inboxItems.size(), 255));
+		depotCount = entry->depotCount;
+		inboxCount = entry->inboxCount;
 	}
 
 	setDepotSearchIsOpen(itemId, tier);
@@ -6067,34 +6390,14 @@ void Player::requestDepotSearchItem(uint16_t itemId, uint8_t tier)
 
 void Player::retrieveAllItemsFromDepotSearch(uint16_t itemId, uint8_t tier, bool isDepot)
 {
-	const DepotLocker* depotLocker = getDepotLocker(getLastDepotId());
-	if (!depotLocker) {
+	if (!updateDepotSearchIndex()) {
 		return;
 	}
 
+	// copied, the moves below change the index
 	std::vector<Item*> itemsVector;
-	for (Item* locker : depotLocker->getItemList()) {
-		const Container* c = locker->getContainer();
-		if (!c || c->empty() ||
-			// Retrieve from inbox.
-			(c->isInbox() && isDepot) ||
-			// Retrieve from depot.
-			(!c->isInbox() && !isDepot)
-		)
-		{
-			continue;
-		}
-
-		for (ContainerIterator it = c->iterator(); it.hasNext(); it.advance()) {
-			Item* item = *it;
-			if (!item) {
-				continue;
-			}
-
-			if (item->getID() == itemId && item->getTier() == depotSearchOnItem.second) {
-				itemsVector.push_back(item);
-			}
-		}
+	if (const DepotSearchEntry* entry = getDepotSearchEntry(itemId, depotSearchOnItem.second)) {
+		itemsVector = isDepot ? entry->depotItems : entry->inboxItems;
 	}
 
 	ReturnValue ret = RETURNVALUE_NOERROR;
@@ -6140,34 +6443,18 @@ void Player::openContainerFromDepotSearch(const Position& pos)
 
 Item* Player::getItemFromDepotSearch(uint16_t itemId, const Position& pos)
 {
-	const DepotLocker* depotLocker = getDepotLocker(getLastDepotId());
-	if (!depotLocker) {
+	if (!updateDepotSearchIndex() || (pos.y != 0x20 && pos.y != 0x21)) {
 		return nullptr;
 	}
 
-	uint8_t index = 0;
-	for (Item* locker : depotLocker->getItemList()) {
-		const Container* c = locker->getContainer();
-		if (!c || c->empty() ||
-			(c->isInbox() && pos.y != 0x21) ||	// From inbox.
-			(!c->isInbox() && pos.y != 0x20)) {	// From depot.
-			continue;
-		}
-
-		for (ContainerIterator it = c->iterator(); it.hasNext(); it.advance()) {
-			Item* item = *it;
-			if (!item || item->getID() != itemId || item->getTier() != depotSearchOnItem.second) {
-				continue;
-			}
-
-			if (pos.z == index) {
-				return item;
-			}
-			index++;
-		}
+	const DepotSearchEntry* entry = getDepotSearchEntry(itemId, depotSearchOnItem.second);
+	if (!entry) {
+		return nullptr;
 	}
 
-	return nullptr;
+	// 0x20 is the depot list and 0x21 the inbox list, pos.z the index in it
+	const ItemVector& items = pos.y == 0x20 ? entry->depotItems : entry->inboxItems;
+	return pos.z < items.size() ? items[pos.z] : nullptr;
 }
 
 std::pair<std::vector<Item*>, std::map<uint16_t, std::map<uint8_t, uint32_t>>> Player::requestLockerItems(DepotLocker *depotLocker, bool sendToClient /*= false*/, uint8_t tier /*= 0*/) const
@@ -6289,6 +6576,7 @@ bool Player::saySpell(
 	}
 
 	// Execute lua event method
+	bool hearEvent = g_events().hasListener(EVENT_HOOK_CREATURE_ON_HEAR);
 	for (Creature* spectator : spectators) {
 		auto tmpPlayer = spectator->getPlayer();
 		if (!tmpPlayer) {
@@ -6296,7 +6584,7 @@ bool Player::saySpell(
 		}
 
 		tmpPlayer->onCreatureSay(this, type, text);
-		if (this != tmpPlayer) {
+		if (hearEvent && this != tmpPlayer) {
 			g_events().eventCreatureOnHear(tmpPlayer, this, text, type);
 		}
 	}
@@ -35,6 +35,7 @@
 #include "io/ioprey.h"
 #include "creatures/appearance/mounts/mounts.h"
 #include "creatures/appearance/outfit/outfit.h"
+#include "creatures/players/player_storage.hpp"
 #include "grouping/party.h"
 #include "server/network/protocol/protocolgame.h"
 #include "items/containers/rewards/reward.h"
@@ -75,6 +76,15 @@ class Player final : public Creature, public Cylinder
 		Player(const Player&) = delete;
 		Player& operator=(const Player&) = delete;
 
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_PLAYER, size);
+			return ::operator new(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_PLAYER, size);
+			::operator delete(p);
+		}
+
 		Player* getPlayer() override {
 			return this;
 		}
@@ -242,7 +252,8 @@ class Player final : public Creature, public Cylinder
 			lastWalkthroughPosition = walkthroughPosition;
 		}
 
-		Inbox* getInbox() const {
+		Inbox* getInbox() {
+			ensureDepotLoaded();
 			return inbox;
 		}
 
@@ -252,7 +263,7 @@ class Player final : public Creature, public Cylinder
 		return guildWarVector;
 		}
 
-		std::list<MonsterType*> getBestiaryTrackerList() const {
+		const std::list<MonsterType*>& getBestiaryTrackerList() const {
 			return BestiaryTracker;
 		}
 
@@ -274,7 +285,7 @@ class Player final : public Creature, public Cylinder
 			}
 		}
 
-		void refreshBestiaryTracker(std::list<MonsterType*> trackerList) {
+		void refreshBestiaryTracker(const std::list<MonsterType*>& trackerList) {
 			if (client) {
 				client->refreshBestiaryTracker(trackerList);
 			}
@@ -303,9 +314,7 @@ class Player final : public Creature, public Cylinder
 			return secureMode;
 		}
 
-		void setParty(Party* newParty) {
-			this->party = newParty;
-		}
+		void setParty(Party* newParty);
 		Party* getParty() const {
 			return party;
 		}
@@ -391,9 +400,7 @@ class Player final : public Creature, public Cylinder
 		bool getStorageValue(const uint32_t key, int32_t& value) const;
 		void genReservedStorageRange();
 
-		void setGroup(Group* newGroup) {
-			group = newGroup;
-		}
+		void setGroup(Group* newGroup);
 		Group* getGroup() const {
 			return group;
 		}
@@ -408,7 +415,7 @@ class Player final : public Creature, public Cylinder
 
 			// Closing depot search when player have special container disabled and it's still open.
 			if (isDepotSearchOpen() && !depotSearchBool && depotSearch) {
-				depotSearchOnItem = {0, 0};
+				setDepotSearchIsOpen(0, 0);
 				sendCloseDepotSearch();
 			}
 
@@ -430,6 +437,9 @@ class Player final : public Creature, public Cylinder
 		}
 		void setDepotSearchIsOpen(uint16_t itemId, uint8_t tier) {
 			depotSearchOnItem = {itemId, tier};
+			if (itemId == 0) {
+				releaseDepotSearchIndex();
+			}
 		}
 		bool isDepotSearchAvailable() const {
 			return depotSearch;
@@ -638,6 +648,24 @@ class Player final : public Creature, public Cylinder
 
 		DepotChest* getDepotChest(uint32_t depotId, bool autoCreate);
 		DepotLocker* getDepotLocker(uint32_t depotId);
+
+		// the depot chests and inbox of a login with lazyDepotLoading are read on first use
+		bool isDepotLoaded() const {
+			return !depotPending;
+		}
+		// calls callback once they are read, right away if they are, or with nullptr if the player goes first
+		void loadDepot(std::function<void(Player*)> callback);
+		void onDepotLoaded();
+		// what had no chance to wait for loadDepot reads them on the dispatcher
+		void ensureDepotLoaded() {
+			if (depotPending) {
+				loadDepotNow();
+			}
+		}
+		// the saved rows are only replaced by what was read
+		bool canSaveDepot() const {
+			return !depotPending && !depotCorrupted;
+		}
 		void onReceiveMail() const;
 		bool isNearDepotBox() const;
 
@@ -742,12 +770,15 @@ class Player final : public Creature, public Cylinder
 		uint16_t getSkillLevel(uint8_t skill) const {
 			uint16_t skillLevel = std::max<uint16_t>(0, skills[skill].level + varSkills[skill]);
 
-			auto it = maxValuePerSkill.find(skill);
-			if (it != maxValuePerSkill.end()) {
-				skillLevel = std::min<uint16_t>(it->second, skillLevel);
+			switch (skill) {
+				case SKILL_LIFE_LEECH_CHANCE:
+				case SKILL_MANA_LEECH_CHANCE:
+					return std::min<uint16_t>(100, skillLevel);
+				case SKILL_CRITICAL_HIT_CHANCE:
+					return std::min<uint16_t>(g_configManager().getNumber(CRITICALCHANCE), skillLevel);
+				default:
+					return skillLevel;
 			}
-
-			return skillLevel;
 		}
 		uint16_t getBaseSkill(uint8_t skill) const {
 			return skills[skill].level;
@@ -904,6 +935,11 @@ class Player final : public Creature, public Cylinder
 				client->sendCreatureSay(creature, type, text, pos);
 			}
 		}
+		void sendCreatureSay(const NetworkMessage& encoded) {
+			if (client) {
+				client->sendCreatureSay(encoded);
+			}
+		}
 		void sendCreatureReload(const Creature* creature) {
 			if (client) {
 				client->reloadCreature(creature);
@@ -986,6 +1022,21 @@ class Player final : public Creature, public Cylinder
 				client->sendSpellGroupCooldown(groupId, time);
 			}
 		}
+		/**
+		 * Spell cooldowns are kept in a fixed table instead of conditions.
+		 * A cooldown only ever gets extended, as with the conditions it replaces.
+		 */
+		void addSpellCooldown(uint8_t spellId, uint32_t ticks);
+		void addSpellGroupCooldown(SpellGroup_t groupId, uint32_t ticks);
+		bool hasSpellCooldown(uint8_t spellId) const {
+			return spellCooldowns[spellId] > OTSYS_TIME();
+		}
+		bool hasSpellGroupCooldown(SpellGroup_t groupId) const {
+			return groupId < spellGroupCooldowns.size() && spellGroupCooldowns[groupId] > OTSYS_TIME();
+		}
+		// Lua and stored conditions of the cooldown types end up in the table
+		void addCooldownCondition(const Condition* condition);
+		void serializeSpellCooldowns(PropWriteStream& propWriteStream) const;
 		void sendUseItemCooldown(uint32_t time) const {
 			if (client) {
 				client->sendUseItemCooldown(time);
@@ -1000,9 +1051,10 @@ class Player final : public Creature, public Cylinder
 		void sendModalWindow(const ModalWindow& modalWindow);
 
 		//container
-		void sendAddContainerItem(const Container* container, const Item* item);
-		void sendUpdateContainerItem(const Container* container, uint16_t slot, const Item* newItem);
-		void sendRemoveContainerItem(const Container* container, uint16_t slot);
+		// cid is one the container is open with, from Game::getContainerViewers
+		void sendAddContainerItem(uint8_t cid, const Container* container, const Item* item);
+		void sendUpdateContainerItem(uint8_t cid, const Container* container, uint16_t slot, const Item* newItem);
+		void sendRemoveContainerItem(uint8_t cid, const Container* container, uint16_t slot);
 		void sendContainer(uint8_t cid, const Container* container, bool hasParent, uint16_t firstIndex) {
 			if (client) {
 				client->sendContainer(cid, container, hasParent, firstIndex);
@@ -1196,6 +1248,11 @@ class Player final : public Creature, public Cylinder
 				client->sendDistanceShoot(from, to, type);
 			}
 		}
+		void sendDistanceShoot(const NetworkMessage& encoded) const {
+			if (client) {
+				client->sendDistanceShoot(encoded);
+			}
+		}
 		void sendHouseWindow(House* house, uint32_t listId) const;
 		void sendCreatePrivateChannel(uint16_t channelId, const std::string& channelName) {
 			if (client) {
@@ -1223,6 +1280,11 @@ class Player final : public Creature, public Cylinder
 				client->sendMagicEffect(pos, type);
 			}
 		}
+		void sendMagicEffect(const Position& pos, const NetworkMessage& encoded) const {
+			if (client) {
+				client->sendMagicEffect(pos, encoded);
+			}
+		}
 		void sendPing();
 		void sendPingBack() const {
 			if (client) {
@@ -1271,14 +1333,19 @@ class Player final : public Creature, public Cylinder
 				client->sendToChannel(creature, type, text, channelId);
 			}
 		}
+		void sendToChannel(const NetworkMessage& encoded) const {
+			if (client) {
+				client->sendToChannel(encoded);
+			}
+		}
 		void sendShop(Npc* npc) const {
 			if (client) {
 				client->sendShop(npc);
 			}
 		}
-		void sendSaleItemList(const std::map<uint16_t, uint16_t>& inventoryMap) const {
+		void sendSaleItemList() const {
 			if (client && shopOwner) {
-				client->sendSaleItemList(shopOwner->getShopItemVector(), inventoryMap);
+				client->sendSaleItemList(shopOwner->getShopSellItemIds(), getSaleItemCounts());
 			}
 		}
 		void sendCloseShop() const {
@@ -1581,11 +1648,9 @@ class Player final : public Creature, public Cylinder
 			moduleDelayMap[byteortype] = OTSYS_TIME() + delay;
 		}
 
-		bool canRunModule(uint8_t byteortype) {
-			if (!moduleDelayMap[byteortype]) {
-				return true;
-			}
-			return moduleDelayMap[byteortype] <= OTSYS_TIME();
+		bool canRunModule(uint8_t byteortype) const {
+			auto it = moduleDelayMap.find(byteortype);
+			return it == moduleDelayMap.end() || it->second <= OTSYS_TIME();
 		}
 
 		uint32_t getNextActionTime() const;
@@ -2109,10 +2174,11 @@ class Player final : public Creature, public Cylinder
 
 		void updateInventoryWeight();
 		/**
-		 * @brief Starts checking the imbuements in the item so that the time decay is performed
-		 * Registers the player in an unordered_map in game.h so that the function can be initialized by the task
+		 * @brief Charges the time elapsed since the last call to the imbuements of the inventory
+		 * and schedules the next call for the closest expiration, see IMBUEMENT_UPDATE_INTERVAL.
+		 * Must be called before the inventory, the protection zone or the in fight state changes
 		 */
-		void updateInventoryImbuement(bool init = false);
+		void updateInventoryImbuement();
 
 		void setNextWalkActionTask(SchedulerTask* task);
 		void setNextWalkTask(SchedulerTask* task);
@@ -2151,6 +2217,16 @@ class Player final : public Creature, public Cylinder
 		size_t getLastIndex() const override;
 		uint32_t getItemTypeCount(uint16_t itemId, int32_t subType = -1) const override;
 		void stashContainer(StashContainerList itemDict);
+
+		/**
+		 * Between these calls removed items only mark the weight, light, inventory ids
+		 * and stats as outdated, endBulkRemove sends them once. Capacity can only be
+		 * overestimated meanwhile, so adds are left alone.
+		 */
+		void beginBulkRemove() {
+			++bulkRemoveDepth;
+		}
+		void endBulkRemove();
 		ItemsTierCountList getInventoryItemsId() const;
 
 		// Get specific inventory item from itemid
@@ -2161,31 +2237,70 @@ class Player final : public Creature, public Cylinder
 		// This function is a override function of base class
 		std::map<uint32_t, uint32_t>& getAllItemTypeCount(std::map<uint32_t,
                                       uint32_t>& countMap) const override;
-		// Function from player class with correct type sizes (uint16_t)
-		std::map<uint16_t, uint16_t>& getAllSaleItemIdAndCount(std::map<uint16_t, uint16_t> & countMap) const;
+		// Counts of the items an npc would take, tier 0 and without imbuements
+		const std::map<uint16_t, uint16_t>& getSaleItemCounts() const {
+			updateInventoryItemIndex();
+			return inventorySaleItemCounts;
+		}
 		void getAllItemTypeCountAndSubtype(std::map<uint32_t, uint32_t>& countMap) const;
 		Thing* getThing(size_t index) const override;
 
 		void internalAddThing(Thing* thing) override;
 		void internalAddThing(uint32_t index, Thing* thing) override;
 
+		/**
+		 * @brief Item counts of the whole inventory, nested containers included.
+		 * Every change of the inventory tree reaches postAddNotification/postRemoveNotification,
+		 * which mark the index as outdated, and the next query rebuilds it in one pass
+		 */
+		void updateInventoryItemIndex() const;
+
+		mutable phmap::flat_hash_map<uint16_t, uint32_t> inventoryItemCounts;
+		mutable ItemsTierCountList inventoryTierItemCounts;
+		mutable std::map<uint16_t, uint16_t> inventorySaleItemCounts;
+		mutable bool inventoryItemIndexOutdated = true;
+
+		uint16_t bulkRemoveDepth = 0;
+		bool bulkRemoveUpdatePending = false;
+
 		phmap::flat_hash_set<uint32_t> attackedSet;
 
+		// What this player shows for another one, filled field by field on demand
+		enum PlayerRelationField_t : uint8_t {
+			PLAYER_RELATION_SKULL = 1 << 0,
+			PLAYER_RELATION_SHIELD = 1 << 1,
+			PLAYER_RELATION_EMBLEM = 1 << 2,
+		};
+		struct PlayerRelation {
+			// orange skulls fade away without any state change
+			time_t skullValidUntil = 0;
+			Skulls_t skull = SKULL_NONE;
+			PartyShields_t shield = SHIELD_NONE;
+			GuildEmblems_t emblem = GUILDEMBLEM_NONE;
+			uint8_t fields = 0;
+		};
+		PlayerRelation& getPlayerRelation(const Player* player) const;
+		Skulls_t computeSkullClient(const Player* player, time_t now, time_t& validUntil) const;
+		PartyShields_t computePartyShield(const Player* player) const;
+		GuildEmblems_t computeGuildEmblem(const Player* player) const;
+		void loadDepotNow();
+
+		// by creature id, only holds entries of the current Game::getPlayerRelationsVersion
+		mutable phmap::flat_hash_map<uint32_t, PlayerRelation> playerRelations;
+		mutable uint32_t playerRelationsVersion = 0;
+
 		phmap::flat_hash_set<uint32_t> VIPList;
 
 		std::map<uint8_t, OpenContainer> openContainers;
 		std::map<uint32_t, DepotLocker*> depotLockerMap;
 		std::map<uint32_t, DepotChest*> depotChests;
+		std::vector<std::function<void(Player*)>> depotLoadCallbacks;
 		std::map<uint8_t, int64_t> moduleDelayMap;
-		std::map<uint32_t, int32_t> storageMap;
+		PlayerStorage storage;
+		// fingerprints of the rows each save section wrote last time
+		std::array<size_t, PLAYER_SAVE_LAST + 1> savedFingerprints {};
 		std::map<uint16_t, uint64_t> itemPriceMap;
 
-		std::map<uint8_t, uint16_t> maxValuePerSkill = {
-			{SKILL_LIFE_LEECH_CHANCE, 100},
-			{SKILL_MANA_LEECH_CHANCE, 100},
-			{SKILL_CRITICAL_HIT_CHANCE, g_configManager().getNumber(CRITICALCHANCE)}
-		};
-
 		std::map<uint32_t, Reward*> rewardMap;
 
 		std::map<ObjectCategory_t, Container*> quickLootContainers;
@@ -2205,6 +2320,10 @@ class Player final : public Creature, public Cylinder
 		// TODO: This variable is only temporarily used when logging in, get rid of it somehow.
 		std::forward_list<Condition*> storedConditionList;
 
+		// OTSYS_TIME() at which each spell and spell group is ready again
+		std::array<int64_t, std::numeric_limits<uint8_t>::max() + 1> spellCooldowns {};
+		std::array<int64_t, SPELLGROUP_ULTIMATESTRIKES + 1> spellGroupCooldowns {};
+
 		std::list<MonsterType*> BestiaryTracker;
 
 		std::string name;
@@ -2235,6 +2354,8 @@ class Player final : public Creature, public Cylinder
 		int64_t lastDepotSearchInteraction = 0;
 		int64_t lastPing;
 		int64_t lastPong;
+		// imbuement durations are up to date until this time
+		int64_t imbuementUpdateTime = 0;
 		int64_t nextAction = 0;
 		int64_t nextPotionAction = 0;
 		int64_t lastQuickLootNotification = 0;
@@ -2275,6 +2396,7 @@ class Player final : public Creature, public Cylinder
 		uint32_t actionPotionTaskEvent = 0;
 		uint32_t nextStepEvent = 0;
 		uint32_t walkTaskEvent = 0;
+		uint32_t imbuementEvent = 0;
 		uint32_t MessageBufferTicks = 0;
 		uint32_t lastIP = 0;
 		uint32_t accountNumber = 0;
@@ -2306,6 +2428,8 @@ class Player final : public Creature, public Cylinder
 		uint16_t storeXpBoost = 0;
 		uint16_t staminaXpBoost = 100;
 		int16_t lastDepotId = -1;
+		bool depotPending = false;
+		bool depotCorrupted = false;
 		StashItemList stashItems; // [ItemID] = amount
 		uint32_t movedItems = 0;
 
@@ -2313,6 +2437,32 @@ class Player final : public Creature, public Cylinder
 		bool depotSearch = false;
 		std::pair<uint16_t, uint8_t> depotSearchOnItem;
 
+		struct DepotSearchEntry {
+			ItemVector depotItems;
+			ItemVector inboxItems;
+			uint32_t depotCount = 0;
+			uint32_t inboxCount = 0;
+		};
+
+		/**
+		 * @brief Contents of the last used depot locker, inbox included, by item id and tier.
+		 * Built on the first search and kept while the content revisions of the locker,
+		 * its containers and the depot boxes stay the same.
+		 * @return nullptr if the player has no depot locker
+		 */
+		const DepotLocker* updateDepotSearchIndex();
+		const DepotSearchEntry* getDepotSearchEntry(uint16_t itemId, uint8_t tier);
+		// the index of a big depot is large, it is only kept while the search is open
+		void releaseDepotSearchIndex();
+
+		const DepotLocker* depotSearchLocker = nullptr;
+		std::vector<std::pair<const Container*, uint32_t>> depotSearchRevisions;
+		// key is itemId << 8 | tier
+		phmap::flat_hash_map<uint32_t, DepotSearchEntry> depotSearchEntries;
+		// tiers are stored + 1 for classified items, as sent to the client
+		ItemsTierCountList depotSearchItems;
+		uint16_t depotSearchItemsCount = 0;
+
 		// Bestiary
 		bool charmExpansion = false;
 		uint16_t charmRuneWound = 0;
@@ -2358,6 +2508,7 @@ class Player final : public Creature, public Cylinder
 		bool wasMounted = false;
 		bool ghostMode = false;
 		bool pzLocked = false;
+		bool imbuementAggressiveDecay = false;
 		bool isConnecting = false;
 		bool addAttackSkillPoint = false;
 		bool inventoryAbilities[CONST_SLOT_LAST + 1] = {};
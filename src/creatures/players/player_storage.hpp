@@ -0,0 +1,106 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_CREATURES_PLAYERS_PLAYER_STORAGE_HPP_
+#define SRC_CREATURES_PLAYERS_PLAYER_STORAGE_HPP_
+
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * Storage values of a player, with the keys changed since the last write kept
+ * aside: the periodic flush and the player save only write those rows.
+ * Not synced means the database copy is unknown (not loaded yet, or a write
+ * failed) and the next save rewrites every value.
+ */
+class PlayerStorage
+{
+	public:
+		bool get(uint32_t key, int32_t& value) const {
+			auto it = values.find(key);
+			if (it == values.end()) {
+				return false;
+			}
+			value = it->second;
+			return true;
+		}
+
+		void set(uint32_t key, int32_t value) {
+			auto [it, inserted] = values.try_emplace(key, value);
+			if (!inserted) {
+				if (it->second == value) {
+					return;
+				}
+				it->second = value;
+			}
+			changes.insert(key);
+		}
+
+		void erase(uint32_t key) {
+			if (values.erase(key) != 0) {
+				changes.insert(key);
+			}
+		}
+
+		// a value read from the database, not a change
+		void load(uint32_t key, int32_t value) {
+			values[key] = value;
+		}
+
+		const phmap::flat_hash_map<uint32_t, int32_t>& getValues() const {
+			return values;
+		}
+
+		bool hasChanges() const {
+			return !changes.empty();
+		}
+
+		// hands out the changed keys and forgets them
+		void takeChanges(std::vector<std::pair<uint32_t, int32_t>>& updated, std::vector<uint32_t>& removed) {
+			for (uint32_t key : changes) {
+				auto it = values.find(key);
+				if (it != values.end()) {
+					updated.emplace_back(key, it->second);
+				} else {
+					removed.push_back(key);
+				}
+			}
+			changes.clear();
+		}
+
+		void clearChanges() {
+			changes.clear();
+		}
+
+		bool isSynced() const {
+			return synced;
+		}
+		void setSynced(bool value) {
+			synced = value;
+		}
+
+	private:
+		phmap::flat_hash_map<uint32_t, int32_t> values;
+		phmap::flat_hash_set<uint32_t> changes;
+		bool synced = false;
+};
+
+#endif  // SRC_CREATURES_PLAYERS_PLAYER_STORAGE_HPP_
@@ -160,6 +160,8 @@ bool Vocations::loadFromXml()
 				}
 			}
 		}
+
+		voc.buildRequirementTables();
 	}
 	return true;
 }
@@ -197,33 +199,75 @@ uint16_t Vocations::getPromotedVocation(uint16_t vocationId) const
 
 uint32_t Vocation::skillBase[SKILL_LAST + 1] = {50, 50, 50, 50, 30, 100, 20};
 
-uint64_t Vocation::getReqSkillTries(uint8_t skill, uint16_t level)
+namespace {
+
+// 2^64, the first double past the uint64_t range
+constexpr double REQUIREMENT_LIMIT = 18446744073709551616.0;
+
+uint64_t toRequirement(double value)
+{
+	if (!(value < REQUIREMENT_LIMIT)) {
+		return std::numeric_limits<uint64_t>::max();
+	}
+	return static_cast<uint64_t>(value);
+}
+
+}  // namespace
+
+uint64_t Vocation::getReqSkillTries(uint8_t skill, uint16_t level) const
 {
 	if (skill > SKILL_LAST || level <= 10) {
 		return 0;
 	}
 
-	auto it = cacheSkill[skill].find(level);
-	if (it != cacheSkill[skill].end()) {
-		return it->second;
+	const std::vector<uint64_t>& table = reqSkillTries[skill];
+	if (level < table.size()) {
+		return table[level];
 	}
-
-	uint64_t tries = static_cast<uint64_t>(skillBase[skill] * std::pow(static_cast<double>(skillMultipliers[skill]), level - 11));
-	cacheSkill[skill][level] = tries;
-	return tries;
+	return computeReqSkillTries(skill, level);
 }
 
-uint64_t Vocation::getReqMana(uint32_t magLevel)
+uint64_t Vocation::getReqMana(uint32_t magLevel) const
 {
 	if (magLevel == 0) {
 		return 0;
 	}
-	auto it = cacheMana.find(magLevel);
-	if (it != cacheMana.end()) {
-		return it->second;
+
+	if (magLevel < reqMana.size()) {
+		return reqMana[magLevel];
+	}
+	return computeReqMana(magLevel);
+}
+
+uint64_t Vocation::computeReqSkillTries(uint8_t skill, uint32_t level) const
+{
+	return toRequirement(skillBase[skill] * std::pow(static_cast<double>(skillMultipliers[skill]), static_cast<int32_t>(level) - 11));
+}
+
+uint64_t Vocation::computeReqMana(uint32_t magLevel) const
+{
+	return toRequirement(std::floor(1600 * std::pow<double>(manaMultiplier, static_cast<int32_t>(magLevel) - 1)));
+}
+
+void Vocation::buildRequirementTables()
+{
+	// the levels below 11 and magic level 0 need nothing and are answered before the lookup
+	for (uint8_t skill = SKILL_FIRST; skill <= SKILL_LAST; ++skill) {
+		std::vector<uint64_t>& table = reqSkillTries[skill];
+		table.assign(11, 0);
+		for (uint32_t level = 11; level < REQUIREMENT_TABLE_LEVELS; ++level) {
+			table.push_back(computeReqSkillTries(skill, level));
+			if (table.back() == std::numeric_limits<uint64_t>::max()) {
+				break;
+			}
+		}
 	}
 
-	uint64_t reqMana = std::floor<uint64_t>(1600 * std::pow<double>(manaMultiplier, static_cast<int32_t>(magLevel) - 1));
-	cacheMana[magLevel] = reqMana;
-	return reqMana;
+	reqMana.assign(1, 0);
+	for (uint32_t magLevel = 1; magLevel < REQUIREMENT_TABLE_LEVELS; ++magLevel) {
+		reqMana.push_back(computeReqMana(magLevel));
+		if (reqMana.back() == std::numeric_limits<uint64_t>::max()) {
+			break;
+		}
+	}
 }
@@ -34,8 +34,8 @@ class Vocation
 		const std::string& getVocDescription() const {
 			return description;
 		}
-		uint64_t getReqSkillTries(uint8_t skill, uint16_t level);
-		uint64_t getReqMana(uint32_t magLevel);
+		uint64_t getReqSkillTries(uint8_t skill, uint16_t level) const;
+		uint64_t getReqMana(uint32_t magLevel) const;
 
 		uint16_t getId() const {
 			return id;
@@ -114,8 +114,17 @@ class Vocation
 	private:
 		friend class Vocations;
 
-		std::map<uint32_t, uint64_t> cacheMana;
-		std::map<uint32_t, uint32_t> cacheSkill[SKILL_LAST + 1];
+		// levels covered by the requirement tables, higher ones are computed on demand
+		static constexpr uint32_t REQUIREMENT_TABLE_LEVELS = 1024;
+
+		// fills the tables from the multipliers, after they were loaded
+		void buildRequirementTables();
+		uint64_t computeReqSkillTries(uint8_t skill, uint32_t level) const;
+		uint64_t computeReqMana(uint32_t magLevel) const;
+
+		// requirement by level, up to the first level that no longer fits in 64 bits
+		std::vector<uint64_t> reqMana;
+		std::array<std::vector<uint64_t>, SKILL_LAST + 1> reqSkillTries;
 
 		std::string name = "none";
 		std::string description;
@@ -21,9 +21,33 @@
 
 #include "config/configmanager.h"
 #include "database/database.h"
+#include "database/database_stats.hpp"
+#include "game/scheduling/dispatcher_watchdog.hpp"
+#include "utils/memory_accounting.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+bool isConnectionError(unsigned int error)
+{
+	return error == CR_SERVER_LOST || error == CR_SERVER_GONE_ERROR || error == CR_CONN_HOST_ERROR || error == 1053/*ER_SERVER_SHUTDOWN*/ || error == CR_CONNECTION_ERROR;
+}
+
+// result columns are fetched as text into these, longer values are fetched again at their length
+constexpr unsigned long STATEMENT_CELL_SIZE = 64;
+
+// keys written recently, with the time until their reads stay on the primary
+std::mutex replicaWritesLock;
+phmap::flat_hash_map<uint64_t, int64_t> replicaWrites;
+// expired keys are only dropped once there are this many
+constexpr size_t REPLICA_WRITES_PRUNE_SIZE = 4096;
+std::atomic<bool> replicaConnected {false};
+
+}  // namespace
 
 Database::~Database()
 {
+	closeStatements();
 	if (handle != nullptr) {
 		mysql_close(handle);
 	}
@@ -82,6 +106,78 @@ bool Database::connect(const char *host, const char *user, const char *password,
 	return true;
 }
 
+bool Database::reconnectAfterFork()
+{
+	// a thread of the parent may have held the locks at the fork, it does not exist here
+	new (&databaseLock) std::recursive_mutex();
+	new (&replicaWritesLock) std::mutex();
+	replicaConnected.store(false, std::memory_order_relaxed);
+
+	// the statements and handles live on the parent's connections, they are leaked on purpose
+	statements.clear();
+	replica.release();
+	handle = nullptr;
+	return connect();
+}
+
+bool Database::connectReplica()
+{
+	const std::string& host = g_configManager().getString(MYSQL_REPLICA_HOST);
+	if (host.empty()) {
+		return true;
+	}
+
+	const std::string& user = g_configManager().getString(MYSQL_REPLICA_USER);
+	const std::string& password = g_configManager().getString(MYSQL_REPLICA_PASS);
+	auto replicaDb = std::make_unique<Database>();
+	if (!replicaDb->connect(host.c_str(), (user.empty() ? g_configManager().getString(MYSQL_USER) : user).c_str(),
+			(user.empty() && password.empty() ? g_configManager().getString(MYSQL_PASS) : password).c_str(),
+			g_configManager().getString(MYSQL_DB).c_str(), g_configManager().getNumber(MYSQL_REPLICA_PORT), nullptr)) {
+		SPDLOG_WARN("[Database::connectReplica] - Failed to connect to the read replica at {}, reads stay on the primary", host);
+		return false;
+	}
+
+	replica = std::move(replicaDb);
+	replicaConnected.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+Database& Database::getReadConnection(uint64_t key /* = 0*/)
+{
+	if (!replica) {
+		return *this;
+	}
+
+	if (key != 0) {
+		std::lock_guard<std::mutex> lockClass(replicaWritesLock);
+		auto it = replicaWrites.find(key);
+		if (it != replicaWrites.end() && it->second > OTSYS_TIME()) {
+			return *this;
+		}
+	}
+	return *replica;
+}
+
+void Database::markWritten(uint64_t key)
+{
+	if (!replicaConnected.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	int64_t now = OTSYS_TIME();
+	std::lock_guard<std::mutex> lockClass(replicaWritesLock);
+	if (replicaWrites.size() >= REPLICA_WRITES_PRUNE_SIZE) {
+		for (auto it = replicaWrites.begin(); it != replicaWrites.end();) {
+			if (it->second <= now) {
+				replicaWrites.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+	replicaWrites[key] = now + g_configManager().getNumber(MYSQL_REPLICA_CONSISTENCY_TIME) * 1000;
+}
+
 bool Database::beginTransaction()
 {
 	if (!executeQuery("BEGIN")) {
@@ -134,6 +230,8 @@ bool Database::executeQuery(const std::string& query)
   }
 
 	bool success = true;
+	int64_t startTime = g_databaseStats().isEnabled() ? DispatcherProfiler::getTimeMicros() : 0;
+	DispatcherActivity activity("Database::executeQuery", query);
 
 	// executes the query
 	databaseLock.lock();
@@ -150,12 +248,19 @@ bool Database::executeQuery(const std::string& query)
 	}
 
 	MYSQL_RES* m_res = mysql_store_result(handle);
+	uint64_t rows = 0;
+	if (startTime != 0 && success) {
+		rows = m_res ? mysql_num_rows(m_res) : mysql_affected_rows(handle);
+	}
 	databaseLock.unlock();
 
 	if (m_res) {
 		mysql_free_result(m_res);
 	}
 
+	if (startTime != 0) {
+		g_databaseStats().recordQuery(query, DispatcherProfiler::getTimeMicros() - startTime, rows, success);
+	}
 	return success;
 }
 
@@ -166,6 +271,8 @@ DBResult_ptr Database::storeQuery(const std::string& query)
     return nullptr;
   }
 
+	int64_t startTime = g_databaseStats().isEnabled() ? DispatcherProfiler::getTimeMicros() : 0;
+	DispatcherActivity activity("Database::storeQuery", query);
 	databaseLock.lock();
 
 	retry:
@@ -188,12 +295,19 @@ DBResult_ptr Database::storeQuery(const std::string& query)
 		auto error = mysql_errno(handle);
 		if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
 			databaseLock.unlock();
+			if (startTime != 0) {
+				g_databaseStats().recordQuery(query, DispatcherProfiler::getTimeMicros() - startTime, 0, false);
+			}
 			return nullptr;
 		}
 		goto retry;
 	}
 	databaseLock.unlock();
 
+	if (startTime != 0) {
+		g_databaseStats().recordQuery(query, DispatcherProfiler::getTimeMicros() - startTime, mysql_num_rows(res), true);
+	}
+
 	// retrieving results of query
 	DBResult_ptr result = std::make_shared<DBResult>(res);
 	if (!result->hasNext()) {
@@ -202,6 +316,208 @@ DBResult_ptr Database::storeQuery(const std::string& query)
 	return result;
 }
 
+bool Database::executeQuery(const DBStatement& statement)
+{
+	if (!handle) {
+		SPDLOG_ERROR("Database not initialized!");
+		return false;
+	}
+
+	if (statement.params.empty()) {
+		return executeQuery(statement.query);
+	}
+
+	int64_t startTime = g_databaseStats().isEnabled() ? DispatcherProfiler::getTimeMicros() : 0;
+	DispatcherActivity activity("Database::executeQuery", statement.query);
+	databaseLock.lock();
+	MYSQL_STMT* stmt = executeStatement(statement);
+	uint64_t rows = 0;
+	if (stmt) {
+		rows = mysql_stmt_affected_rows(stmt);
+		mysql_stmt_free_result(stmt);
+	}
+	databaseLock.unlock();
+
+	if (startTime != 0) {
+		g_databaseStats().recordQuery(statement.query, DispatcherProfiler::getTimeMicros() - startTime, rows, stmt != nullptr);
+	}
+	return stmt != nullptr;
+}
+
+DBResult_ptr Database::storeQuery(const DBStatement& statement)
+{
+	if (!handle) {
+		SPDLOG_ERROR("Database not initialized!");
+		return nullptr;
+	}
+
+	int64_t startTime = g_databaseStats().isEnabled() ? DispatcherProfiler::getTimeMicros() : 0;
+	DispatcherActivity activity("Database::storeQuery", statement.query);
+	databaseLock.lock();
+	MYSQL_STMT* stmt = executeStatement(statement);
+	if (!stmt) {
+		databaseLock.unlock();
+		if (startTime != 0) {
+			g_databaseStats().recordQuery(statement.query, DispatcherProfiler::getTimeMicros() - startTime, 0, false);
+		}
+		return nullptr;
+	}
+
+	MYSQL_RES* metadata = mysql_stmt_result_metadata(stmt);
+	if (!metadata || mysql_stmt_store_result(stmt) != 0) {
+		// without metadata the statement returns no rows, which is not an error
+		bool success = metadata == nullptr;
+		if (metadata) {
+			SPDLOG_ERROR("Query: {}", statement.getQuery());
+			SPDLOG_ERROR("Message: {}", mysql_stmt_error(stmt));
+			mysql_free_result(metadata);
+		}
+		uint64_t rows = success ? mysql_stmt_affected_rows(stmt) : 0;
+		mysql_stmt_free_result(stmt);
+		databaseLock.unlock();
+		if (startTime != 0) {
+			g_databaseStats().recordQuery(statement.query, DispatcherProfiler::getTimeMicros() - startTime, rows, success);
+		}
+		return nullptr;
+	}
+
+	DBResultColumns names;
+	size_t columns = 0;
+	while (MYSQL_FIELD* field = mysql_fetch_field(metadata)) {
+		names[field->name] = columns++;
+	}
+	mysql_free_result(metadata);
+
+	// MySQL uses bool and MariaDB my_bool for the null flags
+	using NullFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+	std::vector<std::array<char, STATEMENT_CELL_SIZE>> buffers(columns);
+	std::vector<unsigned long> lengths(columns);
+	std::unique_ptr<NullFlag[]> nulls(new NullFlag[columns]());
+	std::vector<MYSQL_BIND> binds(columns);
+	for (size_t i = 0; i < columns; ++i) {
+		binds[i].buffer_type = MYSQL_TYPE_STRING;
+		binds[i].buffer = buffers[i].data();
+		binds[i].buffer_length = STATEMENT_CELL_SIZE;
+		binds[i].length = &lengths[i];
+		binds[i].is_null = &nulls[i];
+	}
+
+	std::vector<std::string> cells;
+	std::vector<bool> nullCells;
+	if (mysql_stmt_bind_result(stmt, binds.data()) == 0) {
+		cells.reserve(columns * static_cast<size_t>(mysql_stmt_num_rows(stmt)));
+		nullCells.reserve(cells.capacity());
+
+		int status;
+		while ((status = mysql_stmt_fetch(stmt)) == 0 || status == MYSQL_DATA_TRUNCATED) {
+			for (size_t i = 0; i < columns; ++i) {
+				std::string& cell = cells.emplace_back();
+				nullCells.push_back(nulls[i]);
+				if (nulls[i]) {
+					continue;
+				}
+
+				cell.resize(lengths[i]);
+				if (lengths[i] <= STATEMENT_CELL_SIZE) {
+					std::memcpy(cell.data(), buffers[i].data(), lengths[i]);
+					continue;
+				}
+
+				MYSQL_BIND column = {};
+				column.buffer_type = MYSQL_TYPE_STRING;
+				column.buffer = cell.data();
+				column.buffer_length = lengths[i];
+				mysql_stmt_fetch_column(stmt, &column, static_cast<unsigned int>(i), 0);
+			}
+		}
+
+		if (status != MYSQL_NO_DATA) {
+			SPDLOG_ERROR("Query: {}", statement.getQuery());
+			SPDLOG_ERROR("Message: {}", mysql_stmt_error(stmt));
+		}
+	} else {
+		SPDLOG_ERROR("Query: {}", statement.getQuery());
+		SPDLOG_ERROR("Message: {}", mysql_stmt_error(stmt));
+	}
+
+	mysql_stmt_free_result(stmt);
+	databaseLock.unlock();
+
+	if (startTime != 0) {
+		g_databaseStats().recordQuery(statement.query, DispatcherProfiler::getTimeMicros() - startTime, columns != 0 ? cells.size() / columns : 0, true);
+	}
+
+	if (cells.empty()) {
+		return nullptr;
+	}
+	return std::make_shared<DBResult>(std::move(names), columns, std::move(cells), nullCells);
+}
+
+MYSQL_STMT* Database::executeStatement(const DBStatement& statement)
+{
+	std::vector<MYSQL_BIND> binds(statement.params.size());
+	for (size_t i = 0; i < binds.size(); ++i) {
+		const DBStatement::Param& param = statement.params[i];
+		binds[i].buffer_type = param.type;
+		if (param.type == MYSQL_TYPE_LONGLONG) {
+			binds[i].buffer = const_cast<int64_t*>(&param.number);
+			binds[i].is_unsigned = param.isUnsigned;
+		} else {
+			binds[i].buffer = const_cast<char*>(param.data.data());
+			binds[i].buffer_length = param.data.size();
+		}
+	}
+
+	while (true) {
+		auto it = statements.find(statement.query);
+		if (it == statements.end()) {
+			MYSQL_STMT* stmt = mysql_stmt_init(handle);
+			if (!stmt) {
+				SPDLOG_ERROR("Failed to initialize MySQL statement handle");
+				return nullptr;
+			}
+			it = statements.emplace(statement.query, stmt).first;
+			if (mysql_stmt_prepare(stmt, statement.query.c_str(), statement.query.length()) != 0) {
+				SPDLOG_ERROR("Query: {}", statement.query);
+				SPDLOG_ERROR("Message: {}", mysql_stmt_error(stmt));
+				bool retry = isConnectionError(mysql_stmt_errno(stmt));
+				mysql_stmt_close(stmt);
+				statements.erase(it);
+				if (!retry) {
+					return nullptr;
+				}
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+				continue;
+			}
+		}
+
+		MYSQL_STMT* stmt = it->second;
+		if (mysql_stmt_bind_param(stmt, binds.data()) == 0 && mysql_stmt_execute(stmt) == 0) {
+			return stmt;
+		}
+
+		SPDLOG_ERROR("Query: {}", statement.query);
+		SPDLOG_ERROR("Message: {}", mysql_stmt_error(stmt));
+		if (!isConnectionError(mysql_stmt_errno(stmt))) {
+			mysql_stmt_close(stmt);
+			statements.erase(it);
+			return nullptr;
+		}
+
+		// statements do not survive a reconnect, prepare them again
+		closeStatements();
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+}
+
+void Database::closeStatements()
+{
+	for (const auto& it : statements) {
+		mysql_stmt_close(it.second);
+	}
+	statements.clear();
+}
+
 std::string Database::escapeString(const std::string& s) const
 {
 	return escapeBlob(s.c_str(), s.length());
@@ -240,14 +556,38 @@ DBResult::DBResult(MYSQL_RES* res)
 	}
 
 	row = mysql_fetch_row(handle);
+	if (row) {
+		size_t rowBytes = i * sizeof(char*);
+		const unsigned long* lengths = mysql_fetch_lengths(handle);
+		for (size_t column = 0; column < i; ++column) {
+			rowBytes += lengths[column] + 1;
+		}
+		accountedBytes += rowBytes * mysql_num_rows(handle);
+	}
+	MemoryAccounting::allocate(MEMORY_TAG_DB_RESULT, accountedBytes);
+}
+
+DBResult::DBResult(DBResultColumns names, size_t columnCount, std::vector<std::string> values, const std::vector<bool>& nullValues) :
+	listNames(std::move(names)), cells(std::move(values)), columns(columnCount)
+{
+	cellData.reserve(cells.size());
+	for (size_t i = 0; i < cells.size(); ++i) {
+		cellData.push_back(nullValues[i] ? nullptr : cells[i].data());
+		accountedBytes += sizeof(std::string) + sizeof(char*) + cells[i].capacity();
+	}
+	row = cellData.data();
+	MemoryAccounting::allocate(MEMORY_TAG_DB_RESULT, accountedBytes);
 }
 
 DBResult::~DBResult()
 {
-	mysql_free_result(handle);
+	MemoryAccounting::deallocate(MEMORY_TAG_DB_RESULT, accountedBytes);
+	if (handle) {
+		mysql_free_result(handle);
+	}
 }
 
-std::string DBResult::getString(const std::string& s) const
+std::string DBResult::getString(std::string_view s) const
 {
 	auto it = listNames.find(s);
 	if (it == listNames.end()) {
@@ -262,7 +602,7 @@ std::string DBResult::getString(const std::string& s) const
 	return std::string(row[it->second]);
 }
 
-const char* DBResult::getStream(const std::string& s, unsigned long& size) const
+const char* DBResult::getStream(std::string_view s, unsigned long& size) const
 {
 	auto it = listNames.find(s);
 	if (it == listNames.end()) {
@@ -276,12 +616,19 @@ const char* DBResult::getStream(const std::string& s, unsigned long& size) const
 		return nullptr;
 	}
 
-	size = mysql_fetch_lengths(handle)[it->second];
+	if (handle) {
+		size = mysql_fetch_lengths(handle)[it->second];
+	} else {
+		size = cells[rowIndex * columns + it->second].size();
+	}
 	return row[it->second];
 }
 
 size_t DBResult::countResults() const
 {
+	if (!handle) {
+		return cells.size() / columns;
+	}
 	return static_cast<size_t>(mysql_num_rows(handle));
 }
 
@@ -292,40 +639,74 @@ bool DBResult::hasNext() const
 
 bool DBResult::next()
 {
-  if (!handle) {
-    SPDLOG_ERROR("Database not initialized!");
-    return false;
-  }
+	if (!handle) {
+		if (!row) {
+			return false;
+		}
+		++rowIndex;
+		row = rowIndex * columns < cellData.size() ? &cellData[rowIndex * columns] : nullptr;
+		return row != nullptr;
+	}
 	row = mysql_fetch_row(handle);
 	return row != nullptr;
 }
 
+size_t DBStatement::getHash() const
+{
+	size_t hash = std::hash<std::string>()(query);
+	for (const Param& param : params) {
+		boost::hash_combine(hash, param.type);
+		boost::hash_combine(hash, param.number);
+		boost::hash_combine(hash, std::hash<std::string>()(param.data));
+	}
+	return hash;
+}
+
 DBInsert::DBInsert(std::string insertQuery) : query(std::move(insertQuery))
 {
-	this->length = this->query.length();
+	// half the packet limit leaves room for the protocol overhead
+	chunkSize = static_cast<size_t>(std::min<uint64_t>(MAX_CHUNK_SIZE, Database::getInstance().getMaxPacketSize() / 2));
+}
+
+DBInsert::DBInsert(std::string insertQuery, std::vector<DBStatement>& initOutput) : DBInsert(std::move(insertQuery))
+{
+	output = &initOutput;
+}
+
+void DBInsert::upsert(const std::vector<std::string>& columns)
+{
+	upsertClause = " ON DUPLICATE KEY UPDATE ";
+	for (const std::string& column : columns) {
+		if (&column != &columns.front()) {
+			upsertClause.append(", ");
+		}
+		upsertClause.append("`").append(column).append("` = VALUES(`").append(column).append("`)");
+	}
 }
 
 bool DBInsert::addRow(const std::string& row)
 {
-	// adds new row to buffer
-	const size_t rowLength = row.length();
-	length += rowLength;
-	if (length > Database::getInstance().getMaxPacketSize() && !execute()) {
-		return false;
+	// the row goes in as "(row)", after a comma unless it is the first one
+	const size_t rowLength = row.length() + (rows == 0 ? 2 : 3);
+	if (rows != 0 && buffer.length() + rowLength + upsertClause.length() > chunkSize) {
+		chunked = true;
+		if (!execute()) {
+			return false;
+		}
 	}
 
-	if (values.empty()) {
-		values.reserve(rowLength + 2);
-		values.push_back('(');
-		values.append(row);
-		values.push_back(')');
+	if (rows == 0) {
+		if (chunked) {
+			buffer.reserve(chunkSize);
+		}
+		buffer.append(query);
+		buffer.push_back('(');
 	} else {
-		values.reserve(values.length() + rowLength + 3);
-		values.push_back(',');
-		values.push_back('(');
-		values.append(row);
-		values.push_back(')');
+		buffer.append(",(");
 	}
+	buffer.append(row);
+	buffer.push_back(')');
+	++rows;
 	return true;
 }
 
@@ -338,13 +719,20 @@ bool DBInsert::addRow(std::ostringstream& row)
 
 bool DBInsert::execute()
 {
-	if (values.empty()) {
+	if (rows == 0) {
 		return true;
 	}
 
 	// executes buffer
-	bool res = Database::getInstance().executeQuery(query + values);
-	values.clear();
-	length = query.length();
+	buffer.append(upsertClause);
+	bool res = true;
+	if (output) {
+		output->emplace_back(std::move(buffer));
+	} else {
+		res = Database::getInstance().executeQuery(buffer);
+	}
+	// keeps its capacity unless it was moved out
+	buffer.clear();
+	rows = 0;
 	return res;
 }
@@ -23,7 +23,10 @@
 #include "declarations.hpp"
 
 class DBResult;
+// transparent comparison, columns are looked up by string_view without a temporary string
+using DBResultColumns = std::map<std::string, size_t, std::less<>>;
 using DBResult_ptr = std::shared_ptr<DBResult>;
+class DBStatement;
 
 class Database
 {
@@ -46,11 +49,21 @@ class Database
 
 		bool connect(const char *host, const char *user, const char *password,
                      const char *database, uint32_t port, const char *sock);
+		/**
+		 * In the child of a fork: opens a connection of its own and forgets the one
+		 * shared with the parent without closing it, which would end the parent's session.
+		 * The replica is dropped too, the child only writes.
+		 */
+		bool reconnectAfterFork();
 
 		bool executeQuery(const std::string& query);
 
 		DBResult_ptr storeQuery(const std::string& query);
 
+		// statements without values are sent as plain text and not kept prepared
+		bool executeQuery(const DBStatement& statement);
+		DBResult_ptr storeQuery(const DBStatement& statement);
+
 		std::string escapeString(const std::string& s) const;
 
 		std::string escapeBlob(const char* s, uint32_t length) const;
@@ -67,15 +80,40 @@ class Database
 			return maxPacketSize;
 		}
 
+		// pairs a read replica with this connection when mysqlReplicaHost is set, false if it is set but unreachable
+		bool connectReplica();
+		/**
+		 * The connection for a read that may lag behind the primary: the replica paired
+		 * with this connection, unless there is none or the player or account of key was
+		 * written in the last mysqlReplicaConsistencyTime seconds. Replicas never take writes.
+		 */
+		Database& getReadConnection(uint64_t key = 0);
+		// reads of key go to the primary until the replica caught up with the write
+		static void markWritten(uint64_t key);
+
+		static uint64_t getPlayerKey(uint32_t guid) {
+			return (static_cast<uint64_t>(1) << 32) | guid;
+		}
+		static uint64_t getAccountKey(uint32_t accountId) {
+			return (static_cast<uint64_t>(2) << 32) | accountId;
+		}
+
 	private:
 		bool beginTransaction();
 		bool rollback();
 		bool commit();
 
+		// binds and runs the statement, preparing it on first use, databaseLock is held by the caller
+		MYSQL_STMT* executeStatement(const DBStatement& statement);
+		void closeStatements();
+
 	private:
 		MYSQL* handle = nullptr;
 		std::recursive_mutex databaseLock;
 		uint64_t maxPacketSize = 1048576;
+		// prepared statements of this connection by query text
+		std::unordered_map<std::string, MYSQL_STMT*> statements;
+		std::unique_ptr<Database> replica;
 
 	friend class DBTransaction;
 };
@@ -84,6 +122,8 @@ class DBResult
 {
 	public:
 		explicit DBResult(MYSQL_RES* res);
+		// rows of a prepared statement, fetched at once, row by row in values
+		DBResult(DBResultColumns names, size_t columnCount, std::vector<std::string> values, const std::vector<bool>& nullValues);
 		~DBResult();
 
 		// non-copyable
@@ -91,7 +131,7 @@ class DBResult
 		DBResult& operator=(const DBResult&) = delete;
 
 		template<typename T>
-		T getNumber(const std::string& s) const {
+		T getNumber(std::string_view s) const {
 			auto it = listNames.find(s);
 			if (it == listNames.end()) {
 				SPDLOG_ERROR("[DBResult::getNumber] - Column '{}' doesn't exist in the result set", s);
@@ -125,18 +165,81 @@ class DBResult
 			return data;
 		}
 
-		std::string getString(const std::string& s) const;
-		const char* getStream(const std::string& s, unsigned long& size) const;
+		std::string getString(std::string_view s) const;
+		const char* getStream(std::string_view s, unsigned long& size) const;
 
     size_t countResults() const;
 		bool hasNext() const;
 		bool next();
 
 	private:
-		MYSQL_RES* handle;
-		MYSQL_ROW row;
+		MYSQL_RES* handle = nullptr;
+		MYSQL_ROW row = nullptr;
+
+		DBResultColumns listNames;
 
-		std::map<std::string, size_t> listNames;
+		// prepared statement results, row points into cellData
+		std::vector<std::string> cells;
+		std::vector<char*> cellData;
+		size_t columns = 0;
+		size_t rowIndex = 0;
+		// for the memory accounting, text results are estimated from their first row
+		size_t accountedBytes = sizeof(DBResult);
+
+	friend class Database;
+};
+
+/**
+ * Query with ? placeholders and typed values. It is prepared once per
+ * connection and sent with the binary protocol, so repeated queries are
+ * not parsed again and the values need no escaping.
+ */
+class DBStatement
+{
+	public:
+		explicit DBStatement(std::string initQuery) : query(std::move(initQuery)) {}
+
+		template<typename T>
+		DBStatement& bind(T value) {
+			static_assert(std::is_integral<T>::value, "use bindString or bindBlob for other values");
+			Param& param = params.emplace_back();
+			param.type = MYSQL_TYPE_LONGLONG;
+			param.isUnsigned = std::is_unsigned<T>::value;
+			param.number = static_cast<int64_t>(value);
+			return *this;
+		}
+
+		DBStatement& bindString(std::string value) {
+			Param& param = params.emplace_back();
+			param.type = MYSQL_TYPE_STRING;
+			param.data = std::move(value);
+			return *this;
+		}
+
+		DBStatement& bindBlob(const char* data, size_t length) {
+			Param& param = params.emplace_back();
+			param.type = MYSQL_TYPE_BLOB;
+			param.data.assign(data, length);
+			return *this;
+		}
+
+		const std::string& getQuery() const {
+			return query;
+		}
+
+		// changes with the query and with every bound value
+		size_t getHash() const;
+
+	private:
+		struct Param {
+			enum_field_types type = MYSQL_TYPE_NULL;
+			bool isUnsigned = false;
+			int64_t number = 0;
+			std::string data;
+		};
+
+		std::string query;
+		std::vector<Param> params;
 
 	friend class Database;
 };
@@ -148,24 +251,38 @@ class DBInsert
 {
 	public:
 		explicit DBInsert(std::string query);
+		// the finished batches are added to output instead of being executed
+		DBInsert(std::string query, std::vector<DBStatement>& output);
+		// rows that already exist get these columns updated instead
+		void upsert(const std::vector<std::string>& columns);
 		bool addRow(const std::string& row);
 		bool addRow(std::ostringstream& row);
 		bool execute();
 
 	private:
+		// a statement is cut well below max_allowed_packet, so one insert never blocks the server for long
+		static constexpr uint64_t MAX_CHUNK_SIZE = 1024 * 1024;
+
 		std::string query;
-		std::string values;
-		size_t length;
+		// the statement being built: query followed by the rows added so far
+		std::string buffer;
+		std::string upsertClause;
+		size_t chunkSize;
+		size_t rows = 0;
+		// set once a chunk filled up, the next buffers are sized for a whole chunk at once
+		bool chunked = false;
+		std::vector<DBStatement>* output = nullptr;
 };
 
 class DBTransaction
 {
 	public:
-		constexpr DBTransaction() = default;
+		DBTransaction() : database(Database::getInstance()) {}
+		explicit DBTransaction(Database& db) : database(db) {}
 
 		~DBTransaction() {
 			if (state == STATE_START) {
-				Database::getInstance().rollback();
+				database.rollback();
 			}
 		}
 
@@ -175,7 +292,7 @@ class DBTransaction
 
 		bool begin() {
 			state = STATE_START;
-			return Database::getInstance().beginTransaction();
+			return database.beginTransaction();
 		}
 
 		bool commit() {
@@ -184,10 +301,11 @@ class DBTransaction
 			}
 
 			state = STATE_COMMIT;
-			return Database::getInstance().commit();
+			return database.commit();
 		}
 
 	private:
+		Database& database;
 		TransactionStates_t state = STATE_NO_START;
 };
 
@@ -0,0 +1,203 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "database/database_stats.hpp"
+#include "io/player_name_cache.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+// kinds and task origins listed on each report, by total time
+constexpr size_t REPORT_TOP_COUNT = 20;
+
+// next word of query from pos on, without backticks, pos is moved past it
+std::string nextStatementWord(const std::string& query, size_t& pos)
+{
+	while (pos < query.length() && (std::isspace(static_cast<unsigned char>(query[pos])) || query[pos] == '(')) {
+		++pos;
+	}
+
+	std::string word;
+	while (pos < query.length()) {
+		char c = query[pos];
+		if (std::isspace(static_cast<unsigned char>(c)) || c == '(' || c == ')' || c == ',' || c == ';') {
+			break;
+		}
+		if (c != '`') {
+			word.push_back(c);
+		}
+		++pos;
+	}
+	return word;
+}
+
+}  // namespace
+
+void DatabaseStats::start()
+{
+	slowQueryThreshold = static_cast<int64_t>(g_configManager().getNumber(DATABASE_SLOW_QUERY_THRESHOLD)) * 1000;
+	setEnabled(g_configManager().getBoolean(DATABASE_STATS));
+}
+
+void DatabaseStats::setEnabled(bool value)
+{
+	if (value && !isEnabled()) {
+		reset();
+		SPDLOG_INFO("[DatabaseStats] Query statistics enabled");
+	}
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+std::string DatabaseStats::getStatementKind(const std::string& query)
+{
+	size_t pos = 0;
+	std::string verb = asUpperCaseString(nextStatementWord(query, pos));
+
+	const char* tableKeyword = nullptr;
+	if (verb == "SELECT" || verb == "DELETE") {
+		tableKeyword = "FROM";
+	} else if (verb == "INSERT" || verb == "REPLACE") {
+		tableKeyword = "INTO";
+	} else if (verb != "UPDATE") {
+		return verb;
+	}
+
+	if (tableKeyword) {
+		// the first FROM or INTO, a select list holds no subqueries in this code base
+		while (pos < query.length() && asUpperCaseString(nextStatementWord(query, pos)) != tableKeyword) {}
+	}
+
+	std::string table = nextStatementWord(query, pos);
+	if (table.empty()) {
+		return verb;
+	}
+	return verb + ' ' + table;
+}
+
+void DatabaseStats::recordQuery(const std::string& query, int64_t micros, uint64_t rows, bool success)
+{
+	std::string kind = getStatementKind(query);
+	micros = std::max<int64_t>(0, micros);
+
+	std::lock_guard<std::mutex> lockGuard(statsLock);
+	QueryStats& queryStats = queries[kind];
+	queryStats.latency.record(static_cast<uint64_t>(micros));
+	queryStats.rows += rows;
+	if (!success) {
+		++queryStats.failures;
+	}
+
+	if (slowQueryThreshold > 0 && micros >= slowQueryThreshold) {
+		++slowQueryCount;
+		slowQueries.push_front({query.substr(0, SLOW_QUERY_LENGTH), micros, rows});
+		if (slowQueries.size() > SLOW_QUERY_SAMPLES) {
+			slowQueries.pop_back();
+		}
+	}
+}
+
+void DatabaseStats::recordTask(const char* origin, int64_t waitMicros, int64_t runMicros)
+{
+	std::lock_guard<std::mutex> lockGuard(statsLock);
+	TaskStats& taskStats = tasks[origin];
+	taskStats.wait.record(static_cast<uint64_t>(std::max<int64_t>(0, waitMicros)));
+	taskStats.run.record(static_cast<uint64_t>(std::max<int64_t>(0, runMicros)));
+}
+
+void DatabaseStats::report()
+{
+	// counted even while the query statistics are off
+	PlayerNameCache& nameCache = g_playerNameCache();
+	uint64_t nameHits = nameCache.getHits();
+	uint64_t nameLookups = nameHits + nameCache.getMisses();
+	SPDLOG_INFO("[DatabaseStats] player name cache: {} characters, {} lookups, {:.1f}% answered without a query",
+		nameCache.size(), nameLookups, nameLookups != 0 ? nameHits * 100. / nameLookups : 0.);
+
+	std::lock_guard<std::mutex> lockGuard(statsLock);
+	if (!isEnabled()) {
+		SPDLOG_INFO("[DatabaseStats] Query statistics are disabled, enable them with databaseStats or /dbstats on");
+		return;
+	}
+
+	std::vector<std::pair<std::string_view, const QueryStats*>> queryEntries;
+	queryEntries.reserve(queries.size());
+	uint64_t totalQueries = 0;
+	uint64_t totalMicros = 0;
+	for (const auto& it : queries) {
+		queryEntries.emplace_back(it.first, &it.second);
+		totalQueries += it.second.latency.getCount();
+		totalMicros += it.second.latency.getTotal();
+	}
+	std::sort(queryEntries.begin(), queryEntries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second->latency.getTotal() > rhs.second->latency.getTotal();
+	});
+
+	int64_t windowMicros = std::max<int64_t>(1, DispatcherProfiler::getTimeMicros() - windowStart);
+	SPDLOG_INFO("[DatabaseStats] {} queries of {} kinds, {:.2f}ms in total over the last {:.1f}s",
+		totalQueries, queryEntries.size(), totalMicros / 1000., windowMicros / 1000000.);
+
+	size_t shown = std::min<size_t>(REPORT_TOP_COUNT, queryEntries.size());
+	for (size_t i = 0; i < shown; ++i) {
+		const QueryStats& queryStats = *queryEntries[i].second;
+		const LatencyHistogram& latency = queryStats.latency;
+		SPDLOG_INFO("[DatabaseStats] #{} {}: count {}, failed {}, rows {}, total {:.2f}ms, p50/p99/max {}/{}/{}us",
+			i + 1, queryEntries[i].first, latency.getCount(), queryStats.failures, queryStats.rows, latency.getTotal() / 1000.,
+			latency.getPercentile(50), latency.getPercentile(99), latency.getMax());
+	}
+
+	std::vector<std::pair<std::string_view, const TaskStats*>> taskEntries;
+	taskEntries.reserve(tasks.size());
+	for (const auto& it : tasks) {
+		taskEntries.emplace_back(it.first, &it.second);
+	}
+	std::sort(taskEntries.begin(), taskEntries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second->run.getTotal() > rhs.second->run.getTotal();
+	});
+
+	shown = std::min<size_t>(REPORT_TOP_COUNT, taskEntries.size());
+	for (size_t i = 0; i < shown; ++i) {
+		const LatencyHistogram& run = taskEntries[i].second->run;
+		const LatencyHistogram& wait = taskEntries[i].second->wait;
+		SPDLOG_INFO("[DatabaseStats] task #{} {}: count {}, total {:.2f}ms, run p50/p99/max {}/{}/{}us, queued p50/p99/max {}/{}/{}us",
+			i + 1, taskEntries[i].first, run.getCount(), run.getTotal() / 1000.,
+			run.getPercentile(50), run.getPercentile(99), run.getMax(),
+			wait.getPercentile(50), wait.getPercentile(99), wait.getMax());
+	}
+
+	if (slowQueryCount != 0) {
+		SPDLOG_INFO("[DatabaseStats] {} queries took {}ms or more, the latest {}:", slowQueryCount, slowQueryThreshold / 1000, slowQueries.size());
+		for (const SlowQuery& slowQuery : slowQueries) {
+			SPDLOG_INFO("[DatabaseStats] {:.2f}ms, {} rows: {}", slowQuery.micros / 1000., slowQuery.rows, slowQuery.query);
+		}
+	}
+}
+
+void DatabaseStats::reset()
+{
+	std::lock_guard<std::mutex> lockGuard(statsLock);
+	queries.clear();
+	tasks.clear();
+	slowQueries.clear();
+	slowQueryCount = 0;
+	windowStart = DispatcherProfiler::getTimeMicros();
+}
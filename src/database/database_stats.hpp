@@ -0,0 +1,112 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_DATABASE_DATABASE_STATS_HPP_
+#define SRC_DATABASE_DATABASE_STATS_HPP_
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "game/scheduling/dispatcher_profiler.hpp"
+
+/**
+ * Optional query instrumentation of every Database connection, the one of the
+ * dispatcher and the ones of the database workers alike. Queries are counted
+ * and timed by statement kind (verb and table), DatabaseTasks are timed by
+ * the function that queued them, and the latest queries slower than
+ * databaseSlowQueryThreshold are kept with their text.
+ * The report is logged on demand, from /dbstats or on SIGUSR2.
+ * When disabled the only cost is one relaxed atomic load per query.
+ */
+class DatabaseStats
+{
+	public:
+		DatabaseStats() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		DatabaseStats(const DatabaseStats&) = delete;
+		DatabaseStats& operator=(const DatabaseStats&) = delete;
+
+		static DatabaseStats& getInstance() {
+			// Guaranteed to be destroyed
+			static DatabaseStats instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads the configuration
+		void start();
+
+		bool isEnabled() const {
+			return enabled.load(std::memory_order_relaxed);
+		}
+		void setEnabled(bool value);
+
+		// "SELECT players", "UPDATE player_storage", ... or the first word for anything else
+		static std::string getStatementKind(const std::string& query);
+
+		// any thread, rows are returned or affected ones
+		void recordQuery(const std::string& query, int64_t micros, uint64_t rows, bool success);
+		void recordTask(const char* origin, int64_t waitMicros, int64_t runMicros);
+
+		// Logs everything recorded since the last reset
+		void report();
+		void reset();
+
+	private:
+		struct QueryStats {
+			LatencyHistogram latency;
+			uint64_t rows = 0;
+			uint64_t failures = 0;
+		};
+
+		struct TaskStats {
+			LatencyHistogram wait;
+			LatencyHistogram run;
+		};
+
+		struct SlowQuery {
+			std::string query;
+			int64_t micros;
+			uint64_t rows;
+		};
+
+		static constexpr size_t SLOW_QUERY_SAMPLES = 20;
+		static constexpr size_t SLOW_QUERY_LENGTH = 256;
+
+		std::atomic<bool> enabled {false};
+		int64_t slowQueryThreshold = 0;
+
+		std::mutex statsLock;
+		phmap::flat_hash_map<std::string, QueryStats> queries;
+		phmap::flat_hash_map<std::string_view, TaskStats> tasks;
+		// latest first
+		std::deque<SlowQuery> slowQueries;
+		uint64_t slowQueryCount = 0;
+		int64_t windowStart = 0;
+};
+
+constexpr auto g_databaseStats = &DatabaseStats::getInstance;
+
+#endif  // SRC_DATABASE_DATABASE_STATS_HPP_
@@ -21,8 +21,151 @@
 
 #include "config/configmanager.h"
 #include "database/databasemanager.h"
+#include "io/ioplayerstate.hpp"
 #include "lua/functions/core/libs/core_libs_functions.hpp"
 #include "lua/scripts/luascript.h"
+#include "utils/tools.h"
+
+namespace {
+
+// one player_state row per player with rows in the table of the component, then the table is emptied
+bool convertTableToState(Database& db, PlayerStateComponent_t component, const std::string& columns, const std::function<void(const DBResult_ptr&, PropWriteStream&, int32_t&)>& writeRow)
+{
+	const std::string tableName = IOPlayerState::getTableName(component);
+	std::ostringstream query;
+	query << "SELECT `player_id`, " << columns << " FROM `" << tableName << "` ORDER BY `player_id`";
+	if (IOPlayerState::isItemComponent(component)) {
+		query << ", `sid`";
+	}
+
+	if (DBResult_ptr result = db.storeQuery(query.str())) {
+		std::vector<DBStatement> queries;
+		PropWriteStream stream;
+		uint32_t guid = result->getNumber<uint32_t>("player_id");
+		int32_t lastSid = 0;
+		bool hasNext;
+		do {
+			writeRow(result, stream, lastSid);
+			hasNext = result->next();
+			uint32_t nextGuid = hasNext ? result->getNumber<uint32_t>("player_id") : 0;
+			if (hasNext && nextGuid == guid) {
+				continue;
+			}
+
+			if (!IOPlayerState::addSaveStatement(guid, component, stream, queries) || !db.executeQuery(queries.back())) {
+				return false;
+			}
+			queries.clear();
+			stream.clear();
+			lastSid = 0;
+			guid = nextGuid;
+		} while (hasNext);
+	}
+	return db.executeQuery("DELETE FROM `" + tableName + "`");
+}
+
+bool convertToPlayerState(Database& db)
+{
+	for (uint8_t component = PLAYER_STATE_ITEMS; component <= PLAYER_STATE_REWARDS; ++component) {
+		bool converted = convertTableToState(db, static_cast<PlayerStateComponent_t>(component), "`pid`, `sid`, `itemtype`, `count`, `attributes`", [](const DBResult_ptr& result, PropWriteStream& stream, int32_t& lastSid) {
+			PlayerItemRow row;
+			row.pid = result->getNumber<int32_t>("pid");
+			row.sid = result->getNumber<int32_t>("sid");
+			row.itemType = result->getNumber<uint16_t>("itemtype");
+			row.count = result->getNumber<uint16_t>("count");
+
+			unsigned long attributesSize;
+			row.attributes = result->getStream("attributes", attributesSize);
+			row.attributesSize = attributesSize;
+			IOPlayerState::writeItem(stream, lastSid, row);
+		});
+		if (!converted) {
+			return false;
+		}
+	}
+
+	return convertTableToState(db, PLAYER_STATE_STASH, "`item_id`, `item_count`", [](const DBResult_ptr& result, PropWriteStream& stream, int32_t&) {
+		IOPlayerState::writeStash(stream, result->getNumber<uint16_t>("item_id"), result->getNumber<uint32_t>("item_count"));
+	}) && convertTableToState(db, PLAYER_STATE_STORAGE, "`key`, `value`", [](const DBResult_ptr& result, PropWriteStream& stream, int32_t&) {
+		IOPlayerState::writeStorage(stream, result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"));
+	});
+}
+
+bool convertFromPlayerState(Database& db)
+{
+	std::vector<DBInsert> inserts;
+	for (uint8_t component = PLAYER_STATE_ITEMS; component <= PLAYER_STATE_LAST; ++component) {
+		std::string query = "INSERT INTO `" + std::string(IOPlayerState::getTableName(static_cast<PlayerStateComponent_t>(component))) + "` ";
+		if (component == PLAYER_STATE_STASH) {
+			query += "(`player_id`, `item_id`, `item_count`) VALUES ";
+		} else if (component == PLAYER_STATE_STORAGE) {
+			query += "(`player_id`, `key`, `value`) VALUES ";
+		} else {
+			query += "(`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ";
+		}
+		inserts.emplace_back(query);
+	}
+
+	if (DBResult_ptr result = db.storeQuery("SELECT `player_id`, `component`, `data` FROM `player_state`")) {
+		std::vector<char> raw;
+		std::ostringstream row;
+		do {
+			uint32_t guid = result->getNumber<uint32_t>("player_id");
+			uint16_t component = result->getNumber<uint16_t>("component");
+			if (component > PLAYER_STATE_LAST) {
+				continue;
+			}
+
+			unsigned long size;
+			const char* data = result->getStream("data", size);
+			if (!IOPlayerState::uncompress(data, size, raw)) {
+				SPDLOG_ERROR("[DatabaseManager::updatePlayerState] - Corrupted state {} of player {}", component, guid);
+				return false;
+			}
+
+			PropStream stream;
+			stream.init(raw.data(), raw.size());
+			DBInsert& insert = inserts[component];
+			if (component == PLAYER_STATE_STASH) {
+				uint16_t itemId;
+				uint32_t count;
+				while (IOPlayerState::readStash(stream, itemId, count)) {
+					row << guid << ',' << itemId << ',' << count;
+					if (!insert.addRow(row)) {
+						return false;
+					}
+				}
+			} else if (component == PLAYER_STATE_STORAGE) {
+				uint32_t key;
+				int32_t value;
+				while (IOPlayerState::readStorage(stream, key, value)) {
+					row << guid << ',' << key << ',' << value;
+					if (!insert.addRow(row)) {
+						return false;
+					}
+				}
+			} else {
+				PlayerItemRow item;
+				int32_t lastSid = 0;
+				while (IOPlayerState::readItem(stream, lastSid, item)) {
+					row << guid << ',' << item.pid << ',' << item.sid << ',' << item.itemType << ',' << item.count << ',' << db.escapeBlob(item.attributes, static_cast<uint32_t>(item.attributesSize));
+					if (!insert.addRow(row)) {
+						return false;
+					}
+				}
+			}
+		} while (result->next());
+	}
+
+	for (DBInsert& insert : inserts) {
+		if (!insert.execute()) {
+			return false;
+		}
+	}
+	return db.executeQuery("DELETE FROM `player_state`");
+}
+
+}  // namespace
 
 
 bool DatabaseManager::optimizeTables()
@@ -135,6 +278,37 @@ void DatabaseManager::updateDatabase()
 	lua_close(L);
 }
 
+void DatabaseManager::updatePlayerState()
+{
+	bool binaryState = g_configManager().getBoolean(PLAYER_BINARY_STATE);
+	int32_t savedState = 0;
+	getDatabaseConfig("player_binary_state", savedState);
+	if ((savedState != 0) == binaryState) {
+		IOPlayerState::setEnabled(binaryState);
+		return;
+	}
+
+	SPDLOG_INFO("Converting the player items and storage {} the binary player state...", binaryState ? "to" : "from");
+	int64_t start = OTSYS_PRECISE_TIME();
+
+	Database& db = Database::getInstance();
+	DBTransaction transaction;
+	bool converted = transaction.begin() && (binaryState ? convertToPlayerState(db) : convertFromPlayerState(db));
+	if (converted) {
+		registerDatabaseConfig("player_binary_state", binaryState ? 1 : 0);
+		converted = transaction.commit();
+	}
+
+	if (!converted) {
+		SPDLOG_ERROR("[DatabaseManager::updatePlayerState] - Conversion failed, the players stay in the {} mode", binaryState ? "row" : "binary");
+		IOPlayerState::setEnabled(!binaryState);
+		return;
+	}
+
+	SPDLOG_INFO("Converted the players in {} seconds", (OTSYS_PRECISE_TIME() - start) / 1000.);
+	IOPlayerState::setEnabled(binaryState);
+}
+
 bool DatabaseManager::getDatabaseConfig(const std::string& config, int32_t& value)
 {
 	Database& db = Database::getInstance();
@@ -32,6 +32,8 @@ class DatabaseManager
 
 		static bool optimizeTables();
 		static void updateDatabase();
+		// converts the player items and storage when playerBinaryState changed since the last start
+		static void updatePlayerState();
 
 		static bool getDatabaseConfig(const std::string& config, int32_t& value);
 		static void registerDatabaseConfig(const std::string& config, int32_t value);
@@ -20,86 +20,144 @@
 #include "pch.hpp"
 
 #include "database/databasetasks.h"
+#include "config/configmanager.h"
+#include "database/database_stats.hpp"
+#include "game/forked_save.hpp"
 #include "game/scheduling/tasks.h"
+#include "server/metrics/metrics.hpp"
+#include "utils/thread_topology.hpp"
 
-DatabaseTasks::DatabaseTasks() {
-  db_ = &Database::getInstance();
-}
+namespace {
 
-bool DatabaseTasks::SetDatabaseInterface(Database *database) {
-  if (database == nullptr) {
-    return false;
-  }
+const std::vector<uint64_t> taskTimeBounds = {500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000};
+MetricHistogram& taskWait = g_metrics().getHistogram("canary_database_task_wait_seconds", "Time database tasks wait for their worker", taskTimeBounds);
+MetricHistogram& taskRun = g_metrics().getHistogram("canary_database_task_run_seconds", "Time database tasks run on their worker", taskTimeBounds);
 
-  db_ = database;
-  return true;
-}
+}  // namespace
 
 void DatabaseTasks::start()
 {
-  if (db_ == nullptr) {
-    return;
-  }
-	db_->connect();
-	ThreadHolder::start();
-}
+	int32_t workerCount = std::max<int32_t>(1, g_configManager().getNumber(DATABASE_WORKERS));
+	for (int32_t i = 0; i < workerCount; ++i) {
+		auto worker = std::make_unique<DatabaseWorker>();
+		if (!worker->db.connect()) {
+			SPDLOG_ERROR("[DatabaseTasks::start] - Failed to connect database worker {}", i + 1);
+			break;
+		}
+		worker->db.connectReplica();
+		workers.emplace_back(std::move(worker));
+	}
 
-void DatabaseTasks::startThread()
-{
-	ThreadHolder::start();
+	if (workers.empty()) {
+		return;
+	}
+
+	threadState.store(THREAD_STATE_RUNNING, std::memory_order_relaxed);
+	for (size_t i = 0; i < workers.size(); ++i) {
+		workers[i]->thread = std::thread([this, i, &worker = *workers[i]]() {
+			g_threadTopology().applyToCurrentThread(THREAD_ROLE_DATABASE, i);
+			threadMain(worker);
+		});
+	}
 }
 
-void DatabaseTasks::threadMain()
+void DatabaseTasks::threadMain(DatabaseWorker& worker)
 {
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
-	while (getState() != THREAD_STATE_TERMINATED) {
+	mysql_thread_init();
+	std::unique_lock<std::mutex> taskLockUnique(worker.taskLock, std::defer_lock);
+	while (threadState.load(std::memory_order_relaxed) != THREAD_STATE_TERMINATED) {
 		taskLockUnique.lock();
-		if (tasks.empty()) {
-			if (flushTasks) {
-				flushSignal.notify_one();
+		worker.running = false;
+		if (worker.tasks.empty()) {
+			if (worker.flushTasks) {
+				worker.flushSignal.notify_all();
 			}
-			taskSignal.wait(taskLockUnique);
+			worker.taskSignal.wait(taskLockUnique);
 		}
 
-		if (!tasks.empty()) {
-			DatabaseTask task = std::move(tasks.front());
-			tasks.pop_front();
+		if (!worker.tasks.empty()) {
+			DatabaseTask task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+			worker.running = true;
 			taskLockUnique.unlock();
-			runTask(task);
+			// a forked save may still be writing this player, what comes after it waits
+			g_forkedSave().waitForPlayer(task.playerGuid);
+			runTask(worker.db, task);
 		} else {
 			taskLockUnique.unlock();
 		}
 	}
+	mysql_thread_end();
+}
+
+void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/, uint32_t orderKey/* = 0*/, uint32_t playerGuid/* = 0*/, const char* origin/* = __builtin_FUNCTION()*/)
+{
+	addTask(DatabaseTask(std::move(query), std::move(callback), store, origin), orderKey, playerGuid);
+}
+
+bool DatabaseTasks::addTask(std::function<bool(Database&)> function, std::function<void(DBResult_ptr, bool)> callback, uint32_t orderKey, uint32_t playerGuid/* = 0*/, const char* origin/* = __builtin_FUNCTION()*/)
+{
+	return addTask(DatabaseTask(std::move(function), std::move(callback), origin), orderKey, playerGuid);
 }
 
-void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/)
+void DatabaseTasks::addReadTask(std::string query, std::function<void(DBResult_ptr, bool)> callback, uint32_t orderKey, uint64_t consistencyKey, uint32_t playerGuid/* = 0*/, const char* origin/* = __builtin_FUNCTION()*/)
 {
+	DatabaseTask task(std::move(query), std::move(callback), true, origin);
+	task.replicaRead = true;
+	task.consistencyKey = consistencyKey;
+	addTask(std::move(task), orderKey, playerGuid);
+}
+
+bool DatabaseTasks::addTask(DatabaseTask&& task, uint32_t orderKey, uint32_t playerGuid)
+{
+	if (workers.empty()) {
+		return false;
+	}
+
+	task.queuedTime = DispatcherProfiler::getTimeMicros();
+	task.playerGuid = playerGuid;
+
+	DatabaseWorker& worker = *workers[orderKey % workers.size()];
+	bool added = false;
 	bool signal = false;
-	taskLock.lock();
-	if (getState() == THREAD_STATE_RUNNING) {
-		signal = tasks.empty();
-		tasks.emplace_back(std::move(query), std::move(callback), store);
+	worker.taskLock.lock();
+	if (threadState.load(std::memory_order_relaxed) == THREAD_STATE_RUNNING) {
+		signal = worker.tasks.empty();
+		worker.tasks.push_back(std::move(task));
+		added = true;
 	}
-	taskLock.unlock();
+	worker.taskLock.unlock();
 
 	if (signal) {
-		taskSignal.notify_one();
+		worker.taskSignal.notify_one();
 	}
+	return added;
 }
 
-void DatabaseTasks::runTask(const DatabaseTask& task)
+void DatabaseTasks::runTask(Database& db, const DatabaseTask& task)
 {
-  if (db_ == nullptr) {
-    return;
-  }
-  bool success;
+	int64_t startTime = DispatcherProfiler::getTimeMicros();
+	bool success;
 	DBResult_ptr result;
-	if (task.store) {
-		result = db_->storeQuery(task.query);
+	if (task.function) {
+		result = nullptr;
+		success = task.function(db);
+	} else if (task.replicaRead) {
+		result = db.getReadConnection(task.consistencyKey).storeQuery(task.query);
+		success = true;
+	} else if (task.store) {
+		result = db.storeQuery(task.query);
 		success = true;
 	} else {
 		result = nullptr;
-		success = db_->executeQuery(task.query);
+		success = db.executeQuery(task.query);
+	}
+
+	int64_t runMicros = DispatcherProfiler::getTimeMicros() - startTime;
+	taskWait.observe(startTime - task.queuedTime);
+	taskRun.observe(runMicros);
+	if (g_databaseStats().isEnabled()) {
+		g_databaseStats().recordTask(task.origin, startTime - task.queuedTime, runMicros);
 	}
 
 	if (task.callback) {
@@ -107,21 +165,74 @@ void DatabaseTasks::runTask(const DatabaseTask& task)
 	}
 }
 
+size_t DatabaseTasks::getPendingTasks()
+{
+	size_t pending = 0;
+	for (auto& worker : workers) {
+		std::lock_guard<std::mutex> lockClass(worker->taskLock);
+		pending += worker->tasks.size();
+	}
+	return pending;
+}
+
 void DatabaseTasks::flush()
 {
-	std::unique_lock<std::mutex> guard{ taskLock };
-	if (!tasks.empty()) {
-		flushTasks = true;
-		flushSignal.wait(guard);
-		flushTasks = false;
+	for (auto& worker : workers) {
+		flushWorker(*worker);
+	}
+}
+
+void DatabaseTasks::flush(uint32_t orderKey)
+{
+	if (!workers.empty()) {
+		flushWorker(*workers[orderKey % workers.size()]);
+	}
+}
+
+void DatabaseTasks::flushWorker(DatabaseWorker& worker)
+{
+	std::unique_lock<std::mutex> guard{ worker.taskLock };
+	if (!worker.tasks.empty() || worker.running) {
+		worker.flushTasks = true;
+		worker.flushSignal.wait(guard, [&worker]() { return worker.tasks.empty() && !worker.running; });
+		worker.flushTasks = false;
+	}
+}
+
+void DatabaseTasks::stop()
+{
+	if (threadState.load(std::memory_order_relaxed) == THREAD_STATE_RUNNING) {
+		threadState.store(THREAD_STATE_CLOSING, std::memory_order_relaxed);
 	}
 }
 
 void DatabaseTasks::shutdown()
 {
-	taskLock.lock();
-	setState(THREAD_STATE_TERMINATED);
-	taskLock.unlock();
+	stop();
 	flush();
-	taskSignal.notify_one();
+	for (auto& worker : workers) {
+		worker->taskLock.lock();
+		threadState.store(THREAD_STATE_TERMINATED, std::memory_order_relaxed);
+		worker->taskLock.unlock();
+		worker->taskSignal.notify_one();
+	}
+}
+
+void DatabaseTasks::releaseAfterFork()
+{
+	// their locks may be held and their threads are not joinable here, so they are leaked
+	for (auto& worker : workers) {
+		worker.release();
+	}
+	workers.clear();
+	threadState.store(THREAD_STATE_TERMINATED, std::memory_order_relaxed);
+}
+
+void DatabaseTasks::join()
+{
+	for (auto& worker : workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
 }
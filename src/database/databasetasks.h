@@ -21,21 +21,51 @@
 #define SRC_DATABASE_DATABASETASKS_H_
 
 #include "database/database.h"
-#include "utils/thread_holder_base.h"
 
 struct DatabaseTask {
-	DatabaseTask(std::string&& initQuery, std::function<void(DBResult_ptr, bool)>&& initCallback, bool initStore) :
-		query(std::move(initQuery)), callback(std::move(initCallback)), store(initStore) {}
+	DatabaseTask(std::string&& initQuery, std::function<void(DBResult_ptr, bool)>&& initCallback, bool initStore, const char* initOrigin) :
+		query(std::move(initQuery)), callback(std::move(initCallback)), store(initStore), origin(initOrigin) {}
+	DatabaseTask(std::function<bool(Database&)>&& initFunction, std::function<void(DBResult_ptr, bool)>&& initCallback, const char* initOrigin) :
+		function(std::move(initFunction)), callback(std::move(initCallback)), store(false), origin(initOrigin) {}
 
 	std::string query;
+	// runs instead of query, with the connection of the worker
+	std::function<bool(Database&)> function;
 	std::function<void(DBResult_ptr, bool)> callback;
 	bool store;
+	// a stored query that can run on the read replica, unless consistencyKey was written recently
+	bool replicaRead = false;
+	uint64_t consistencyKey = 0;
+	// the guid of the player the task reads or writes, 0 for the others, see ForkedSave::waitForPlayer
+	uint32_t playerGuid = 0;
+	// function that queued the task and when, for DatabaseStats and the metrics
+	const char* origin;
+	int64_t queuedTime = 0;
 };
 
-class DatabaseTasks : public ThreadHolder<DatabaseTasks>
+// One thread with its own MySQL connection and task queue
+struct DatabaseWorker {
+	Database db;
+	std::thread thread;
+	std::list<DatabaseTask> tasks;
+	std::mutex taskLock;
+	std::condition_variable taskSignal;
+	std::condition_variable flushSignal;
+	bool flushTasks = false;
+	// a task taken from the queue is still running
+	bool running = false;
+};
+
+/**
+ * Runs queries off the dispatcher on databaseWorkers connections.
+ * Tasks with the same order key run in the order they were added, on the
+ * same worker; tasks without a key all share the first worker, so they keep
+ * the order they had when there was a single connection.
+ */
+class DatabaseTasks
 {
 	public:
-		DatabaseTasks();
+		DatabaseTasks() = default;
 
 		// non-copyable
 		DatabaseTasks(DatabaseTasks const&) = delete;
@@ -48,25 +78,38 @@ class DatabaseTasks : public ThreadHolder<DatabaseTasks>
 			return instance;
 		}
 
-		bool SetDatabaseInterface(Database *database);
+		// Connects the workers and starts their threads
 		void start();
-		void startThread();
+		// Stops accepting tasks, the queued ones still run
+		void stop();
+		// Waits until every task added so far has run
 		void flush();
+		// Waits until the tasks added so far with this order key have run
+		void flush(uint32_t orderKey);
 		void shutdown();
+		void join();
+		// in the child of a fork: the worker threads were not copied, tasks run inline from now on
+		void releaseAfterFork();
+
+		// origin defaults to the name of the calling function, playerGuid is set for the tasks
+		// about one player only, they wait for a forked save still writing that player
+		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false, uint32_t orderKey = 0, uint32_t playerGuid = 0, const char* origin = __builtin_FUNCTION());
+		// returns false if the task was not queued because the workers are not running
+		bool addTask(std::function<bool(Database&)> function, std::function<void(DBResult_ptr, bool)> callback, uint32_t orderKey, uint32_t playerGuid = 0, const char* origin = __builtin_FUNCTION());
+		// a stored query that can run on the read replica, see Database::getReadConnection
+		void addReadTask(std::string query, std::function<void(DBResult_ptr, bool)> callback, uint32_t orderKey, uint64_t consistencyKey, uint32_t playerGuid = 0, const char* origin = __builtin_FUNCTION());
 
-		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false);
+		// tasks queued on every worker and not started yet
+		size_t getPendingTasks();
 
-		void threadMain();
 	private:
-		void runTask(const DatabaseTask& task);
+		bool addTask(DatabaseTask&& task, uint32_t orderKey, uint32_t playerGuid);
+		void flushWorker(DatabaseWorker& worker);
+		void threadMain(DatabaseWorker& worker);
+		void runTask(Database& db, const DatabaseTask& task);
 
-		Database *db_;
-		std::thread thread;
-		std::list<DatabaseTask> tasks;
-		std::mutex taskLock;
-		std::condition_variable taskSignal;
-		std::condition_variable flushSignal;
-		bool flushTasks = false;
+		std::vector<std::unique_ptr<DatabaseWorker>> workers;
+		std::atomic<ThreadState> threadState {THREAD_STATE_TERMINATED};
 };
 
 constexpr auto g_databaseTasks = &DatabaseTasks::getInstance;
@@ -0,0 +1,123 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/cyclopedia_cache.hpp"
+#include "utils/tools.h"
+
+const std::vector<RecentDeathEntry>* CyclopediaCache::getRecentDeaths(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint16_t& pages)
+{
+	const Page* cached = findPage(guid, false, page, entriesPerPage);
+	if (!cached) {
+		return nullptr;
+	}
+	pages = cached->pages;
+	return &cached->deaths;
+}
+
+const std::vector<RecentPvPKillEntry>* CyclopediaCache::getRecentPvPKills(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint16_t& pages)
+{
+	const Page* cached = findPage(guid, true, page, entriesPerPage);
+	if (!cached) {
+		return nullptr;
+	}
+	pages = cached->pages;
+	return &cached->kills;
+}
+
+void CyclopediaCache::setRecentDeaths(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages, const std::vector<RecentDeathEntry>& entries)
+{
+	if (Page* cached = addPage(guid, false, page, entriesPerPage, queryGeneration, pages)) {
+		cached->deaths = entries;
+	}
+}
+
+void CyclopediaCache::setRecentPvPKills(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages, const std::vector<RecentPvPKillEntry>& entries)
+{
+	if (Page* cached = addPage(guid, true, page, entriesPerPage, queryGeneration, pages)) {
+		cached->kills = entries;
+	}
+}
+
+void CyclopediaCache::invalidate(uint32_t guid)
+{
+	characters.erase(guid);
+	++generation;
+}
+
+CyclopediaCache::Page* CyclopediaCache::findPage(uint32_t guid, bool pvpKills, uint16_t page, uint16_t entriesPerPage)
+{
+	auto it = characters.find(guid);
+	if (it == characters.end()) {
+		return nullptr;
+	}
+
+	int64_t now = OTSYS_TIME();
+	for (Page& cached : it->second) {
+		if (cached.pvpKills == pvpKills && cached.page == page && cached.entriesPerPage == entriesPerPage) {
+			return cached.expires > now ? &cached : nullptr;
+		}
+	}
+	return nullptr;
+}
+
+CyclopediaCache::Page* CyclopediaCache::addPage(uint32_t guid, bool pvpKills, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages)
+{
+	// a death happened while the query ran, its result may miss it
+	if (queryGeneration != generation) {
+		return nullptr;
+	}
+
+	int64_t now = OTSYS_TIME();
+	if (characters.size() >= MAX_CHARACTERS && characters.find(guid) == characters.end()) {
+		for (auto it = characters.begin(); it != characters.end();) {
+			auto& characterPages = it->second;
+			characterPages.erase(std::remove_if(characterPages.begin(), characterPages.end(), [now](const Page& cached) {
+				return cached.expires <= now;
+			}), characterPages.end());
+			if (characterPages.empty()) {
+				it = characters.erase(it);
+			} else {
+				++it;
+			}
+		}
+		if (characters.size() >= MAX_CHARACTERS) {
+			return nullptr;
+		}
+	}
+
+	auto& characterPages = characters[guid];
+	for (Page& cached : characterPages) {
+		if (cached.pvpKills == pvpKills && cached.page == page && cached.entriesPerPage == entriesPerPage) {
+			cached.pages = pages;
+			cached.expires = now + PAGE_TTL;
+			return &cached;
+		}
+	}
+
+	Page& cached = characterPages.emplace_back();
+	cached.pvpKills = pvpKills;
+	cached.page = page;
+	cached.entriesPerPage = entriesPerPage;
+	cached.pages = pages;
+	cached.expires = now + PAGE_TTL;
+	return &cached;
+}
@@ -0,0 +1,89 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_CYCLOPEDIA_CACHE_HPP_
+#define SRC_GAME_CYCLOPEDIA_CACHE_HPP_
+
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "creatures/creatures_definitions.hpp"
+
+/**
+ * Pages of the cyclopedia character tabs that come from the database, the recent
+ * deaths and the recent pvp kills, kept for a short time so clicking through the
+ * tabs and pages does not query again. A player death drops the pages of the victim
+ * and of everyone who damaged it. Dispatcher thread only.
+ */
+class CyclopediaCache
+{
+	public:
+		CyclopediaCache() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		CyclopediaCache(const CyclopediaCache&) = delete;
+		CyclopediaCache& operator=(const CyclopediaCache&) = delete;
+
+		static CyclopediaCache& getInstance() {
+			// Guaranteed to be destroyed
+			static CyclopediaCache instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// taken before a query, a page filled by it is only kept if nothing was invalidated meanwhile
+		uint32_t getGeneration() const {
+			return generation;
+		}
+
+		// nullptr if the page is not cached or expired
+		const std::vector<RecentDeathEntry>* getRecentDeaths(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint16_t& pages);
+		const std::vector<RecentPvPKillEntry>* getRecentPvPKills(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint16_t& pages);
+		void setRecentDeaths(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages, const std::vector<RecentDeathEntry>& entries);
+		void setRecentPvPKills(uint32_t guid, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages, const std::vector<RecentPvPKillEntry>& entries);
+
+		void invalidate(uint32_t guid);
+
+	private:
+		static constexpr int64_t PAGE_TTL = 30 * 1000;
+		// characters with cached pages, expired ones are dropped when it fills up
+		static constexpr size_t MAX_CHARACTERS = 2048;
+
+		struct Page {
+			bool pvpKills;
+			uint16_t page;
+			uint16_t entriesPerPage;
+			uint16_t pages;
+			int64_t expires;
+			std::vector<RecentDeathEntry> deaths;
+			std::vector<RecentPvPKillEntry> kills;
+		};
+
+		Page* findPage(uint32_t guid, bool pvpKills, uint16_t page, uint16_t entriesPerPage);
+		Page* addPage(uint32_t guid, bool pvpKills, uint16_t page, uint16_t entriesPerPage, uint32_t queryGeneration, uint16_t pages);
+
+		phmap::flat_hash_map<uint32_t, std::vector<Page>> characters;
+		uint32_t generation = 0;
+};
+
+constexpr auto g_cyclopediaCache = &CyclopediaCache::getInstance;
+
+#endif  // SRC_GAME_CYCLOPEDIA_CACHE_HPP_
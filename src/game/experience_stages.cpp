@@ -0,0 +1,135 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "creatures/monsters/monster.h"
+#include "creatures/players/player.h"
+#include "game/experience_stages.hpp"
+#include "game/game.h"
+#include "game/scheduling/events_scheduler.hpp"
+#include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/luajit_sync.hpp"
+
+bool ExperienceStages::loadFromLua()
+{
+	if (g_luaEnvironment.loadFile("data/stages.lua") != 0) {
+		return false;
+	}
+	load(g_luaEnvironment.getLuaState());
+	return true;
+}
+
+void ExperienceStages::load(lua_State* L)
+{
+	stages.clear();
+	levelRates.clear();
+
+	lua_getglobal(L, "experienceStages");
+	if (lua_istable(L, -1)) {
+		// ipairs order, the first matching stage wins
+		for (int index = 1; ; ++index) {
+			lua_rawgeti(L, -1, index);
+			if (!lua_istable(L, -1)) {
+				lua_pop(L, 1);
+				break;
+			}
+
+			lua_getfield(L, -1, "minlevel");
+			lua_getfield(L, -2, "maxlevel");
+			lua_getfield(L, -3, "multiplier");
+			if (lua_isnumber(L, -3) && lua_isnumber(L, -1)) {
+				Stage stage;
+				stage.minLevel = static_cast<uint32_t>(std::max<lua_Number>(0, lua_tonumber(L, -3)));
+				stage.maxLevel = lua_isnumber(L, -2) ? static_cast<uint32_t>(std::max<lua_Number>(0, lua_tonumber(L, -2))) : std::numeric_limits<uint32_t>::max();
+				stage.multiplier = lua_tonumber(L, -1);
+				stages.push_back(stage);
+			}
+			lua_pop(L, 4);
+		}
+	}
+	lua_pop(L, 1);
+
+	// past the highest bound every level matches the same stage
+	uint32_t lastLevel = 0;
+	for (const Stage& stage : stages) {
+		lastLevel = std::max(lastLevel, stage.minLevel);
+		if (stage.maxLevel != std::numeric_limits<uint32_t>::max()) {
+			lastLevel = std::max(lastLevel, stage.maxLevel);
+		}
+	}
+
+	if (!stages.empty()) {
+		lastLevel = std::min(lastLevel + 1, MAX_TABLE_LEVEL);
+		levelRates.resize(lastLevel + 1);
+		for (uint32_t level = 0; level <= lastLevel; ++level) {
+			levelRates[level] = findStage(level);
+		}
+	}
+}
+
+double ExperienceStages::findStage(uint32_t level) const
+{
+	for (const Stage& stage : stages) {
+		if (level >= stage.minLevel && level <= stage.maxLevel) {
+			return stage.multiplier;
+		}
+	}
+	return -1;
+}
+
+double ExperienceStages::getRate(uint32_t level) const
+{
+	double rate;
+	if (!levelRates.empty()) {
+		rate = levelRates[std::min<size_t>(level, levelRates.size() - 1)];
+	} else {
+		rate = -1;
+	}
+
+	if (rate < 0) {
+		rate = g_configManager().getNumber(RATE_EXPERIENCE);
+	}
+
+	uint16_t schedule = g_eventsScheduler().getExpSchedule();
+	if (schedule != 100) {
+		rate = std::max<double>(0, rate * schedule / 100);
+	}
+	return rate;
+}
+
+uint64_t ExperienceStages::getKillExperience(const Player& player, const Creature& target, uint64_t exp) const
+{
+	double experience = static_cast<double>(exp);
+	if (strcasecmp(target.getName().c_str(), g_game().getBoostedMonsterName().c_str()) == 0) {
+		experience *= 2;
+	}
+
+	if (const Monster* monster = target.getMonster();
+		monster && g_configManager().getBoolean(PREY_ENABLED) && monster->getRaceId() > 0) {
+		const PreySlot* slot = player.getPreyWithMonster(monster->getRaceId());
+		if (slot && slot->isOccupied() && slot->bonus == PreyBonus_Experience && slot->bonusTimeLeft > 0) {
+			experience = std::ceil(experience * (100 + slot->bonusPercentage) / 100);
+		}
+	}
+
+	return static_cast<uint64_t>(experience * getRate(player.getLevel()));
+}
@@ -0,0 +1,83 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_EXPERIENCE_STAGES_HPP_
+#define SRC_GAME_EXPERIENCE_STAGES_HPP_
+
+#include <vector>
+
+class Creature;
+class Player;
+struct lua_State;
+
+/**
+ * The experienceStages table of data/stages.lua compiled into one multiplier per level.
+ * Player:onGainExperience reads it through Game.getExperienceStage instead of walking
+ * the stage list in Lua on every kill, and without a registered onGainExperience hook
+ * the kill experience is computed here without entering Lua at all.
+ */
+class ExperienceStages
+{
+	public:
+		ExperienceStages() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		ExperienceStages(const ExperienceStages&) = delete;
+		ExperienceStages& operator=(const ExperienceStages&) = delete;
+
+		static ExperienceStages& getInstance() {
+			// Guaranteed to be destroyed
+			static ExperienceStages instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// runs data/stages.lua and compiles its experienceStages table
+		bool loadFromLua();
+		// reads the global experienceStages table
+		void load(lua_State* L);
+
+		// stage multiplier of the level, or rateExp without a stage, with the event schedule applied
+		double getRate(uint32_t level) const;
+
+		// stage, event schedule, boosted creature and prey bonus of a monster kill
+		uint64_t getKillExperience(const Player& player, const Creature& target, uint64_t exp) const;
+
+	private:
+		// levels with their own table entry, higher ones walk the stages
+		static constexpr uint32_t MAX_TABLE_LEVEL = 0xFFFF;
+
+		struct Stage {
+			uint32_t minLevel;
+			uint32_t maxLevel;
+			double multiplier;
+		};
+
+		// first matching stage in table order, as getRateFromTable; negative without one
+		double findStage(uint32_t level) const;
+
+		std::vector<Stage> stages;
+		// stage multiplier by level, negative where no stage matches
+		std::vector<double> levelRates;
+};
+
+constexpr auto g_experienceStages = &ExperienceStages::getInstance;
+
+#endif  // SRC_GAME_EXPERIENCE_STAGES_HPP_
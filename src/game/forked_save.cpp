@@ -0,0 +1,347 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/forked_save.hpp"
+#include "config/configmanager.h"
+#include "database/database_stats.hpp"
+#include "database/databasetasks.h"
+#include "game/game.h"
+#include "game/scheduling/tasks.h"
+#include "io/iologindata.h"
+
+#ifdef __linux__
+#include <filesystem>
+
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum ForkedSaveMessage_t : uint8_t {
+	// id is the guid of a player that was written
+	FORKED_SAVE_PLAYER,
+	// id is a house that was written, value its saved fingerprint
+	FORKED_SAVE_HOUSE,
+	// every house was written
+	FORKED_SAVE_HOUSES,
+	// everything was written
+	FORKED_SAVE_DONE,
+};
+
+#ifdef __linux__
+bool readFull(int fd, void* data, size_t size)
+{
+	size_t done = 0;
+	while (done < size) {
+		ssize_t count = read(fd, static_cast<char*>(data) + done, size - done);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		done += static_cast<size_t>(count);
+	}
+	return true;
+}
+
+// the listening and client sockets, the MySQL connections and the log files stay the parent's
+void closeInheritedDescriptors(int keep)
+{
+	std::vector<int> descriptors;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fd", error)) {
+		int fd = std::atoi(entry.path().filename().c_str());
+		if (fd > STDERR_FILENO && fd != keep) {
+			descriptors.push_back(fd);
+		}
+	}
+
+	if (error) {
+		for (int fd = STDERR_FILENO + 1; fd < getdtablesize(); ++fd) {
+			if (fd != keep) {
+				descriptors.push_back(fd);
+			}
+		}
+	}
+
+	// the one of the directory listing is among them and already closed, which is harmless
+	for (int fd : descriptors) {
+		close(fd);
+	}
+}
+#endif
+
+}  // namespace
+
+bool ForkedSave::start()
+{
+#ifdef __linux__
+	if (!g_configManager().getBoolean(FORKED_SERVER_SAVE) || isRunning()) {
+		return false;
+	}
+
+	if (retryWithoutFork) {
+		retryWithoutFork = false;
+		return false;
+	}
+
+	// what was queued before lands first, the copy is newer than all of it
+	g_databaseTasks().flush();
+
+	int descriptors[2];
+	if (pipe(descriptors) != 0) {
+		SPDLOG_ERROR("[ForkedSave::start] - Failed to create the pipe: {}", std::strerror(errno));
+		return false;
+	}
+
+	if (monitorThread.joinable()) {
+		monitorThread.join();
+	}
+
+	const auto& players = g_game().getPlayers();
+	{
+		std::lock_guard<std::mutex> lockClass(lock);
+		pendingPlayers.clear();
+		for (const auto& [id, player] : players) {
+			pendingPlayers.emplace(player->getGUID(), player->getAccount());
+		}
+		housesPending = true;
+	}
+	running.store(true, std::memory_order_release);
+
+	int64_t forkStart = OTSYS_PRECISE_TIME();
+	pid_t pid = fork();
+	if (pid < 0) {
+		SPDLOG_ERROR("[ForkedSave::start] - Failed to fork the server save: {}", std::strerror(errno));
+		close(descriptors[0]);
+		close(descriptors[1]);
+		finish();
+		return false;
+	}
+
+	if (pid == 0) {
+		close(descriptors[0]);
+		runChild(descriptors[1]);
+	}
+
+	close(descriptors[1]);
+	monitorThread = std::thread(&ForkedSave::monitor, this, descriptors[0], pid);
+	SPDLOG_INFO("Forked the save of {} players in {} ms", players.size(), OTSYS_PRECISE_TIME() - forkStart);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ForkedSave::runChild(int fd)
+{
+#ifdef __linux__
+	// a thread of the parent may have held the lock of the logger at the fork, the child stays silent
+	spdlog::default_logger_raw()->set_level(spdlog::level::off);
+	closeInheritedDescriptors(fd);
+	// nothing waits for the copy in the copy itself
+	running.store(false, std::memory_order_relaxed);
+	g_databaseStats().setEnabled(false);
+	g_databaseTasks().releaseAfterFork();
+	if (!Database::getInstance().reconnectAfterFork()) {
+		_exit(EXIT_FAILURE);
+	}
+
+	auto send = [fd](uint8_t type, uint32_t id, uint64_t value) {
+		// smaller than PIPE_BUF, so the writes of the threads never interleave
+		Message message {};
+		message.type = type;
+		message.id = id;
+		message.value = value;
+		return write(fd, &message, sizeof(message)) == sizeof(message);
+	};
+
+	// captured one after the other, written side by side on connections of the child
+	std::vector<PlayerSaveSnapshot> snapshots;
+	snapshots.reserve(g_game().getPlayers().size());
+	for (const auto& [id, player] : g_game().getPlayers()) {
+		snapshots.emplace_back();
+		IOLoginData::capturePlayer(player, snapshots.back());
+	}
+
+	std::atomic<size_t> next {0};
+	std::atomic<bool> failed {false};
+	std::vector<std::thread> threads;
+	int32_t threadCount = std::max<int32_t>(1, g_configManager().getNumber(DATABASE_WORKERS));
+	for (int32_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back([&]() {
+			mysql_thread_init();
+			{
+				Database db;
+				if (!db.connect()) {
+					failed.store(true);
+				} else {
+					for (size_t index; (index = next.fetch_add(1)) < snapshots.size();) {
+						bool written = false;
+						if (!IOLoginData::persistPlayer(db, snapshots[index], written) || !send(FORKED_SAVE_PLAYER, snapshots[index].guid, 0)) {
+							failed.store(true);
+						}
+					}
+				}
+			}
+			mysql_thread_end();
+		});
+	}
+
+	// the houses go on the connection of this thread meanwhile
+	if (Map::save()) {
+		for (const auto& [key, house] : g_game().map.houses.getHouses()) {
+			send(FORKED_SAVE_HOUSE, house->getId(), house->getSavedFingerprint());
+		}
+		send(FORKED_SAVE_HOUSES, 0, 0);
+	} else {
+		failed.store(true);
+	}
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	if (failed.load() || !send(FORKED_SAVE_DONE, 0, 0)) {
+		_exit(EXIT_FAILURE);
+	}
+	// no destructor or atexit handler of the parent's objects runs
+	_exit(EXIT_SUCCESS);
+#else
+	std::abort();
+#endif
+}
+
+void ForkedSave::monitor(int fd, int pid)
+{
+#ifdef __linux__
+	bool done = false;
+	std::vector<std::pair<uint32_t, uint64_t>> houses;
+	Message message;
+	while (readFull(fd, &message, sizeof(message))) {
+		switch (message.type) {
+			case FORKED_SAVE_PLAYER: {
+				uint32_t accountId = 0;
+				{
+					std::lock_guard<std::mutex> lockClass(lock);
+					auto it = pendingPlayers.find(message.id);
+					if (it != pendingPlayers.end()) {
+						accountId = it->second;
+						pendingPlayers.erase(it);
+					}
+				}
+				signal.notify_all();
+
+				// the replica lag counts from the write of the child
+				Database::markWritten(Database::getPlayerKey(message.id));
+				Database::markWritten(Database::getAccountKey(accountId));
+				break;
+			}
+
+			case FORKED_SAVE_HOUSE:
+				houses.emplace_back(message.id, message.value);
+				break;
+
+			case FORKED_SAVE_HOUSES: {
+				std::lock_guard<std::mutex> lockClass(lock);
+				housesPending = false;
+				signal.notify_all();
+				break;
+			}
+
+			case FORKED_SAVE_DONE:
+				done = true;
+				break;
+
+			default:
+				break;
+		}
+	}
+	close(fd);
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+	bool success = done && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+	finish();
+
+	g_dispatcher().addTask(createTask([this, houses = std::move(houses), success]() {
+		// houses unchanged since the fork are skipped by the next save
+		for (const auto& [houseId, fingerprint] : houses) {
+			if (House* house = g_game().map.houses.getHouse(houseId)) {
+				house->setSavedFingerprint(static_cast<size_t>(fingerprint));
+			}
+		}
+
+		if (success) {
+			SPDLOG_INFO("Forked server save finished");
+			return;
+		}
+
+		// the players it did not write still have their changes, the next save writes them
+		SPDLOG_WARN("[ForkedSave::monitor] - The forked server save failed, saving again without it");
+		if (g_game().getGameState() != GAME_STATE_SHUTDOWN) {
+			retryWithoutFork = true;
+			g_game().saveGameState();
+		}
+	}));
+#endif
+}
+
+void ForkedSave::finish()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(lock);
+		pendingPlayers.clear();
+		housesPending = false;
+		running.store(false, std::memory_order_release);
+	}
+	signal.notify_all();
+}
+
+void ForkedSave::waitForPlayer(uint32_t guid)
+{
+	if (guid == 0 || !isRunning()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lockClass(lock);
+	signal.wait(lockClass, [this, guid]() { return pendingPlayers.find(guid) == pendingPlayers.end(); });
+}
+
+void ForkedSave::waitForHouses()
+{
+	if (!isRunning()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lockClass(lock);
+	signal.wait(lockClass, [this]() { return !housesPending; });
+}
+
+void ForkedSave::join()
+{
+	if (monitorThread.joinable()) {
+		monitorThread.join();
+	}
+}
@@ -0,0 +1,101 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_FORKED_SAVE_HPP_
+#define SRC_GAME_FORKED_SAVE_HPP_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * Server save written by a fork() of the server (Linux only, forkedServerSave).
+ * The child gets a copy-on-write image of the world at a dispatcher boundary,
+ * serializes the online players and the houses into connections of its own and
+ * exits; the parent only pauses for the fork and goes on with the game.
+ *
+ * Until the child reports a player as written, the database tasks keyed by its
+ * guid and the synchronous saves of it wait, so nothing newer is overwritten by
+ * the copy. The same goes for the house rows. Sockets and MySQL handles of the
+ * parent are never used by the child: it closes every inherited descriptor,
+ * connects again and leaves with _exit, without destructors or atexit handlers.
+ */
+class ForkedSave
+{
+	public:
+		ForkedSave() = default;
+
+		// non-copyable
+		ForkedSave(const ForkedSave&) = delete;
+		ForkedSave& operator=(const ForkedSave&) = delete;
+
+		static ForkedSave& getInstance() {
+			// Guaranteed to be destroyed
+			static ForkedSave instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		/**
+		 * Forks the child writing the players and houses, on the dispatcher.
+		 * \returns false if the save has to be done the usual way: disabled, not Linux,
+		 * a forked save still running, the fork failed or the last one did
+		 */
+		bool start();
+
+		bool isRunning() const {
+			return running.load(std::memory_order_acquire);
+		}
+
+		// blocks until the running child wrote the player, or gave up
+		void waitForPlayer(uint32_t guid);
+		// blocks until the running child wrote the houses, or gave up
+		void waitForHouses();
+
+		// waits for the running child, at shutdown
+		void join();
+
+	private:
+		struct Message {
+			uint8_t type;
+			uint32_t id;
+			uint64_t value;
+		};
+
+		[[noreturn]] void runChild(int fd);
+		void monitor(int fd, int pid);
+		void finish();
+
+		std::mutex lock;
+		std::condition_variable signal;
+		// online players at the fork not written yet, with their account
+		phmap::flat_hash_map<uint32_t, uint32_t> pendingPlayers;
+		bool housesPending = false;
+		// the next save is a normal one, the child of the last one failed
+		bool retryWithoutFork = false;
+		std::atomic<bool> running {false};
+		std::thread monitorThread;
+};
+
+constexpr auto g_forkedSave = &ForkedSave::getInstance;
+
+#endif  // SRC_GAME_FORKED_SAVE_HPP_
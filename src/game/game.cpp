@@ -25,7 +25,10 @@
 #include "lua/creature/creatureevent.h"
 #include "database/databasetasks.h"
 #include "lua/creature/events.h"
+#include "game/cyclopedia_cache.hpp"
+#include "game/forked_save.hpp"
 #include "game/game.h"
+#include "game/highscores.hpp"
 #include "lua/global/globalevent.h"
 #include "io/iologindata.h"
 #include "io/iomarket.h"
@@ -33,17 +36,25 @@
 #include "lua/scripts/lua_environment.hpp"
 #include "creatures/monsters/monster.h"
 #include "lua/creature/movement.h"
+#include "game/scheduling/dispatcher_governor.hpp"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/dispatcher_watchdog.hpp"
+#include "game/scheduling/input_trace.hpp"
 #include "game/scheduling/scheduler.h"
 #include "server/server.h"
 #include "creatures/combat/spells.h"
 #include "lua/creature/talkaction.h"
 #include "items/weapons/weapons.h"
+#include "lua/scripts/lua_workers.hpp"
 #include "lua/scripts/scripts.h"
 #include "lua/modules/modules.h"
 #include "creatures/players/imbuements/imbuements.h"
 #include "creatures/players/account/account.hpp"
 #include "creatures/npcs/npc.h"
 #include "creatures/npcs/npcs.h"
+#include "server/metrics/metrics.hpp"
+#include "server/network/connection/handshake_workers.hpp"
+#include "server/network/protocol/session_resume.hpp"
 #include "server/network/webhook/webhook.h"
 #include "protobuf/appearances.pb.h"
 
@@ -148,7 +159,11 @@ void Game::start(ServiceManager* manager)
 
 	g_scheduler().addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this)));
 	g_scheduler().addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0)));
-	g_scheduler().addEvent(createSchedulerTask(EVENT_IMBUEMENT_INTERVAL, std::bind(&Game::checkImbuements, this)));
+	g_highscores().start();
+	map.getStreamer().start();
+	if (g_configManager().getNumber(PLAYER_STORAGE_FLUSH_INTERVAL) > 0) {
+		g_scheduler().addEvent(createSchedulerTask(g_configManager().getNumber(PLAYER_STORAGE_FLUSH_INTERVAL) * 1000, std::bind(&Game::flushPlayerStorages, this)));
+	}
 }
 
 GameState_t Game::getGameState() const
@@ -159,6 +174,7 @@ GameState_t Game::getGameState() const
 void Game::setWorldType(WorldType_t type)
 {
 	worldType = type;
+	invalidatePlayerRelations();
 }
 
 void Game::setGameState(GameState_t newState)
@@ -254,19 +270,40 @@ void Game::saveGameState()
 	}
 
 	SPDLOG_INFO("Saving server...");
+	int64_t start = DispatcherProfiler::getTimeMicros();
+	DispatcherActivity activity("Game::saveGameState");
 
 	for (const auto& it : players) {
 		it.second->loginPosition = it.second->getPosition();
-		IOLoginData::savePlayer(it.second);
 	}
 
+	// a forked copy of the server writes the players and houses, see ForkedSave
+	bool forked = gameState != GAME_STATE_SHUTDOWN && g_forkedSave().start();
+	if (!forked) {
+		for (const auto& it : players) {
+			IOLoginData::savePlayerAsync(it.second);
+		}
+	}
+
+	std::vector<Guild*> guildList;
+	guildList.reserve(guilds.size());
 	for (const auto& it : guilds) {
-		IOGuild::saveGuild(it.second);
+		guildList.push_back(it.second);
 	}
+	IOGuild::saveGuilds(guildList);
 
-	Map::save();
+	if (!forked) {
+		Map::save();
+	}
 
-	g_databaseTasks().flush();
+	// the player saves finish on the database workers, only a shutdown has to wait for them
+	if (gameState == GAME_STATE_SHUTDOWN) {
+		g_databaseTasks().flush();
+	}
+
+	static MetricHistogram& saveTime = g_metrics().getHistogram("canary_server_save_seconds", "Time of a server save on the dispatcher, player saves are only queued",
+		{10000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000});
+	saveTime.observe(DispatcherProfiler::getTimeMicros() - start);
 
 	if (gameState == GAME_STATE_MAINTAIN) {
 		setGameState(GAME_STATE_NORMAL);
@@ -304,11 +341,11 @@ bool Game::loadItemsPrice()
 	return true;
 }
 
-bool Game::loadMainMap(const std::string& filename)
+bool Game::loadMainMap(const std::string& filename, bool fileLoaded/* = false*/)
 {
 	Monster::despawnRange = g_configManager().getNumber(DEFAULT_DESPAWNRANGE);
 	Monster::despawnRadius = g_configManager().getNumber(DEFAULT_DESPAWNRADIUS);
-	return map.loadMap("data/world/" + filename + ".otbm", true, true, true, true);
+	return map.loadMap("data/world/" + filename + ".otbm", true, true, true, true, fileLoaded);
 }
 
 bool Game::loadCustomMap(const std::string& filename)
@@ -318,6 +355,11 @@ bool Game::loadCustomMap(const std::string& filename)
 	return map.loadMapCustom("data/world/custom/" + filename + ".otbm", true, true, true);
 }
 
+void Game::loadMainMapFile(const std::string& filename)
+{
+	map.loadMapFile("data/world/" + filename + ".otbm", true);
+}
+
 void Game::loadMap(const std::string& path)
 {
 	map.loadMap(path);
@@ -504,40 +546,22 @@ void Game::internalGetPosition(Item* item, Position& pos, uint8_t& stackpos)
 
 Creature* Game::getCreatureByID(uint32_t id)
 {
-	if (id <= Player::playerAutoID) {
+	if (id < MONSTER_ID_BASE) {
 		return getPlayerByID(id);
-	} else if (id <= Monster::monsterAutoID) {
+	} else if (id < NPC_ID_BASE) {
 		return getMonsterByID(id);
-	} else if (id <= Npc::npcAutoID) {
-		return getNpcByID(id);
 	}
-	return nullptr;
+	return getNpcByID(id);
 }
 
 Monster* Game::getMonsterByID(uint32_t id)
 {
-	if (id == 0) {
-		return nullptr;
-	}
-
-	auto it = monsters.find(id);
-	if (it == monsters.end()) {
-		return nullptr;
-	}
-	return it->second;
+	return monsters.get(id);
 }
 
 Npc* Game::getNpcByID(uint32_t id)
 {
-	if (id == 0) {
-		return nullptr;
-	}
-
-	auto it = npcs.find(id);
-	if (it == npcs.end()) {
-		return nullptr;
-	}
-	return it->second;
+	return npcs.get(id);
 }
 
 Player* Game::getPlayerByID(uint32_t id)
@@ -563,15 +587,15 @@ Creature* Game::getCreatureByName(const std::string& s)
 		return m_it->second;
 	}
 
-	for (const auto& it : npcs) {
-		if (lowerCaseName == asLowerCaseString(it.second->getName())) {
-			return it.second;
+	for (Npc* npc : npcs.getList()) {
+		if (lowerCaseName == asLowerCaseString(npc->getName())) {
+			return npc;
 		}
 	}
 
-	for (const auto& it : monsters) {
-		if (lowerCaseName == asLowerCaseString(it.second->getName())) {
-			return it.second;
+	for (Monster* monster : monsters.getList()) {
+		if (lowerCaseName == asLowerCaseString(monster->getName())) {
+			return monster;
 		}
 	}
 	return nullptr;
@@ -584,9 +608,9 @@ Npc* Game::getNpcByName(const std::string& s)
 	}
 
 	const char* npcName = s.c_str();
-	for (const auto& it : npcs) {
-		if (strcasecmp(npcName, it.second->getName().c_str()) == 0) {
-			return it.second;
+	for (Npc* npc : npcs.getList()) {
+		if (strcasecmp(npcName, npc->getName().c_str()) == 0) {
+			return npc;
 		}
 	}
 	return nullptr;
@@ -819,39 +843,48 @@ FILELOADER_ERRORS Game::loadAppearanceProtobuf(const std::string& file)
 	// Verify that the version of the library that we linked against is
 	// compatible with the version of the headers we compiled against.
 	GOOGLE_PROTOBUF_VERIFY_VERSION;
-	appearances = Appearances();
-	if (!appearances.ParseFromIstream(&fileStream)) {
-		SPDLOG_ERROR("[Game::loadAppearanceProtobuf] - Failed to parse binary file {}, file is invalid", file);
-		fileStream.close();
-		return ERROR_NOT_OPEN;
-	}
 
-	// Parsing all items into ItemType
-	Item::items.loadFromProtobuf();
+	// The parsed tree, with every frame group and sprite of the client, only lives while
+	// the flags are copied into the item types; the arena frees it in a few large blocks.
+	{
+		google::protobuf::ArenaOptions arenaOptions;
+		arenaOptions.start_block_size = 64 * 1024;
+		arenaOptions.max_block_size = 4 * 1024 * 1024;
+		google::protobuf::Arena arena(arenaOptions);
 
-	// Only iterate other objects if necessary
-	if (g_configManager().getBoolean(WARN_UNSAFE_SCRIPTS)) {
-		// Registering distance effects
-		for (uint32_t it = 0; it < appearances.effect_size(); it++) {
-			registeredMagicEffects.push_back(static_cast<uint8_t>(appearances.effect(it).id()));
+		auto appearances = google::protobuf::Arena::CreateMessage<Appearances>(&arena);
+		if (!appearances->ParseFromIstream(&fileStream)) {
+			SPDLOG_ERROR("[Game::loadAppearanceProtobuf] - Failed to parse binary file {}, file is invalid", file);
+			fileStream.close();
+			return ERROR_NOT_OPEN;
 		}
 
-		// Registering missile effects
-		for (uint32_t it = 0; it < appearances.missile_size(); it++) {
-			registeredDistanceEffects.push_back(static_cast<uint8_t>(appearances.missile(it).id()));
-		}
+		// Parsing all items into ItemType
+		Item::items.loadFromProtobuf(*appearances);
 
-		// Registering outfits
-		for (uint32_t it = 0; it < appearances.outfit_size(); it++) {
-			registeredLookTypes.push_back(static_cast<uint16_t>(appearances.outfit(it).id()));
+		// Only iterate other objects if necessary
+		registeredMagicEffects.clear();
+		registeredDistanceEffects.clear();
+		registeredLookTypes.clear();
+		if (g_configManager().getBoolean(WARN_UNSAFE_SCRIPTS)) {
+			// Registering distance effects
+			for (const Appearance& effect : appearances->effect()) {
+				registeredMagicEffects.push_back(static_cast<uint8_t>(effect.id()));
+			}
+
+			// Registering missile effects
+			for (const Appearance& missile : appearances->missile()) {
+				registeredDistanceEffects.push_back(static_cast<uint8_t>(missile.id()));
+			}
+
+			// Registering outfits
+			for (const Appearance& outfit : appearances->outfit()) {
+				registeredLookTypes.push_back(static_cast<uint16_t>(outfit.id()));
+			}
 		}
 	}
 
 	fileStream.close();
-
-	// Disposing allocated objects.
-	google::protobuf::ShutdownProtobufLibrary();
-
 	return ERROR_NONE;
 }
 
@@ -2115,20 +2148,28 @@ void Game::internalQuickLootCorpse(Player* player, Container* corpse)
 		return;
 	}
 
+	QuickLootResult result;
+	internalQuickLootCorpse(player, corpse, result);
+	sendQuickLootResult(player, result);
+}
+
+void Game::internalQuickLootCorpse(Player* player, Container* corpse, QuickLootResult& result)
+{
+	if (!player || !corpse) {
+		return;
+	}
+
 	std::vector<Item*> itemList;
 	bool ignoreListItems = (player->quickLootFilter == QUICKLOOTFILTER_SKIPPEDLOOT);
 
-	bool missedAnyGold = false;
-	bool missedAnyItem = false;
-
 	for (ContainerIterator it = corpse->iterator(); it.hasNext(); it.advance()) {
 		Item* item = *it;
 		bool listed = player->isQuickLootListedItem(item);
 		if ((listed && ignoreListItems) || (!listed && !ignoreListItems)) {
 			if (item->getWorth() != 0) {
-				missedAnyGold = true;
+				result.missedAnyGold = true;
 			} else {
-				missedAnyItem = true;
+				result.missedAnyItem = true;
 			}
 			continue;
 		}
@@ -2136,41 +2177,60 @@ void Game::internalQuickLootCorpse(Player* player, Container* corpse)
 		itemList.push_back(item);
 	}
 
-	bool shouldNotifyCapacity = false;
-	ObjectCategory_t shouldNotifyNotEnoughRoom = OBJECTCATEGORY_NONE;
-
-	uint32_t totalLootedGold = 0;
-	uint32_t totalLootedItems = 0;
 	for (Item* item : itemList) {
 		uint32_t worth = item->getWorth();
 		uint16_t baseCount = item->getItemCount();
 		ObjectCategory_t category = getObjectCategory(item);
+		bool stackable = item->isStackable();
+
+		// a single item fails the same way as the ones before it, skip the container walk
+		ReturnValue ret;
+		if (!stackable && item->getWeight() >= result.failedWeight) {
+			ret = RETURNVALUE_NOTENOUGHCAPACITY;
+		} else if (!stackable && result.fullCategories.test(category)) {
+			ret = RETURNVALUE_CONTAINERNOTENOUGHROOM;
+		} else {
+			ret = internalQuickLootItem(player, item, category);
+		}
 
-		ReturnValue ret = internalQuickLootItem(player, item, category);
 		if (ret == RETURNVALUE_NOTENOUGHCAPACITY) {
-			shouldNotifyCapacity = true;
+			result.notEnoughCapacity = true;
+			if (!stackable) {
+				result.failedWeight = std::min<uint32_t>(result.failedWeight, item->getWeight());
+			}
 		} else if (ret == RETURNVALUE_CONTAINERNOTENOUGHROOM) {
-			shouldNotifyNotEnoughRoom = category;
+			result.fullCategory = category;
+			if (!stackable) {
+				result.fullCategories.set(category);
+			}
 		}
 
 		bool success = ret == RETURNVALUE_NOERROR;
 		if (worth != 0) {
-			missedAnyGold = missedAnyGold || !success;
+			result.missedAnyGold = result.missedAnyGold || !success;
 			if (success) {
 				player->sendLootStats(item, baseCount);
-				totalLootedGold += worth;
+				result.lootedGold += worth;
 			} else {
 				// item is not completely moved
-				totalLootedGold += worth - item->getWorth();
+				result.lootedGold += worth - item->getWorth();
 			}
 		} else {
-			missedAnyItem = missedAnyItem || !success;
+			result.missedAnyItem = result.missedAnyItem || !success;
 			if (success || item->getItemCount() != baseCount) {
-				totalLootedItems++;
+				result.lootedItems++;
 				player->sendLootStats(item, item->getItemCount());
 			}
 		}
 	}
+}
+
+void Game::sendQuickLootResult(Player* player, const QuickLootResult& result)
+{
+	uint32_t totalLootedGold = result.lootedGold;
+	uint32_t totalLootedItems = result.lootedItems;
+	bool missedAnyGold = result.missedAnyGold;
+	bool missedAnyItem = result.missedAnyItem;
 
 	std::stringstream ss;
 	if (totalLootedGold != 0 || missedAnyGold || totalLootedItems != 0 || missedAnyItem) {
@@ -2231,12 +2291,12 @@ void Game::internalQuickLootCorpse(Player* player, Container* corpse)
 	ss << ".";
 	player->sendTextMessage(MESSAGE_LOOT, ss.str());
 
-	if (shouldNotifyCapacity) {
+	if (result.notEnoughCapacity) {
 		ss.str(std::string());
 		ss << "Attention! The loot you are trying to pick up is too heavy for you to carry.";
-	} else if (shouldNotifyNotEnoughRoom != OBJECTCATEGORY_NONE) {
+	} else if (result.fullCategory != OBJECTCATEGORY_NONE) {
 		ss.str(std::string());
-		ss << "Attention! The container assigned to category " << getObjectCategoryName(shouldNotifyNotEnoughRoom) << " is full.";
+		ss << "Attention! The container assigned to category " << getObjectCategoryName(result.fullCategory) << " is full.";
 	} else {
 		return;
 	}
@@ -4236,6 +4296,11 @@ void Game::playerLookAt(uint32_t playerId, uint16_t itemId, const Position& pos,
 		lookDistance = -1;
 	}
 
+	// the description shows the remaining imbuement time
+	if (const Item* item = thing->getItem(); item && item->getImbuementSlot() > 0 && item->getParent() == player) {
+		player->updateInventoryImbuement();
+	}
+
 	// Parse onLook from event player
 	g_events().eventPlayerOnLook(player, pos, thing, stackPos, lookDistance);
 }
@@ -4418,6 +4483,7 @@ void Game::playerLootAllCorpses(Player* player, const Position& pos, bool lootAl
 
 		const TileItemVector *itemVector = tile->getItemList();
 		uint16_t corpses = 0;
+		QuickLootResult result;
 		for (Item *tileItem: *itemVector) {
 			if (!tileItem) {
 				continue;
@@ -4438,13 +4504,14 @@ void Game::playerLootAllCorpses(Player* player, const Position& pos, bool lootAl
 			}
 
 			corpses++;
-			internalQuickLootCorpse(player, tileCorpse);
+			internalQuickLootCorpse(player, tileCorpse, result);
 			if (corpses >= 30) {
 				break;
 			}
 		}
 
 		if (corpses > 0) {
+			sendQuickLootResult(player, result);
 			if (corpses > 1) {
 				std::stringstream string;
 				string << "You looted " << corpses << " corpses.";
@@ -5177,19 +5244,22 @@ bool Game::internalCreatureSay(Creature* creature, SpeakClasses type, const std:
 		spectators = (*spectatorsPtr);
 	}
 
-	//send to client
+	//send to client, one statement id for every listener
+	NetworkMessage msg;
+	ProtocolGame::AddCreatureSay(msg, creature, type, text, pos);
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
 			if (!ghostMode || tmpPlayer->canSeeCreature(creature)) {
-				tmpPlayer->sendCreatureSay(creature, type, text, pos);
+				tmpPlayer->sendCreatureSay(msg);
 			}
 		}
 	}
 
 	//event method
+	bool hearEvent = g_events().hasListener(EVENT_HOOK_CREATURE_ON_HEAR);
 	for (Creature* spectator : spectators) {
 		spectator->onCreatureSay(creature, type, text);
-		if (creature != spectator) {
+		if (hearEvent && creature != spectator) {
 			g_events().eventCreatureOnHear(spectator, creature, text, type);
 		}
 	}
@@ -5205,6 +5275,91 @@ void Game::checkCreatureWalk(uint32_t creatureId)
 	}
 }
 
+uint32_t Game::scheduleCreatureWalk(uint32_t creatureId, uint32_t delay)
+{
+	if (++lastWalkTicket == 0) {
+		lastWalkTicket = 1;
+	}
+
+	int64_t now = OTSYS_TIME();
+	if (!walkBucketsScheduled) {
+		nextWalkBucket = now / EVENT_WALK_BUCKET_INTERVAL;
+		walkBucketsScheduled = true;
+		g_scheduler().addEvent(createSchedulerTask(
+			static_cast<uint32_t>(EVENT_WALK_BUCKET_INTERVAL - now % EVENT_WALK_BUCKET_INTERVAL),
+			std::bind(&Game::checkCreatureWalks, this)));
+	}
+
+	// rounded up, a step is never taken before its delay has passed
+	int64_t bucket = std::max<int64_t>(nextWalkBucket, (now + delay + EVENT_WALK_BUCKET_INTERVAL - 1) / EVENT_WALK_BUCKET_INTERVAL);
+	walkBuckets[bucket % EVENT_WALK_BUCKET_COUNT].push_back({bucket, creatureId, lastWalkTicket});
+	++pendingWalkSteps;
+	return lastWalkTicket;
+}
+
+void Game::checkCreatureWalks()
+{
+	int64_t now = OTSYS_TIME();
+	int64_t currentBucket = now / EVENT_WALK_BUCKET_INTERVAL;
+
+	// catch up on every bucket passed since the last round, each slot is visited once at most
+	int64_t lastBucket = std::min<int64_t>(currentBucket, nextWalkBucket + EVENT_WALK_BUCKET_COUNT - 1);
+	for (int64_t bucket = nextWalkBucket; bucket <= lastBucket; ++bucket) {
+		auto& steps = walkBuckets[bucket % EVENT_WALK_BUCKET_COUNT];
+		// steps more than a full turn of the wheel away stay in their slot
+		for (size_t i = 0; i < steps.size();) {
+			if (steps[i].bucket <= currentBucket) {
+				dueWalkSteps.push_back(steps[i]);
+				steps[i] = steps.back();
+				steps.pop_back();
+			} else {
+				++i;
+			}
+		}
+	}
+	nextWalkBucket = currentBucket + 1;
+	pendingWalkSteps -= dueWalkSteps.size();
+
+	// cancelled steps are dropped here, the rest is walked region by region so that
+	// consecutive moves look up the same map leaves and spectators
+	size_t count = 0;
+	for (const WalkStep& step : dueWalkSteps) {
+		Creature* creature = getCreatureByID(step.creatureId);
+		if (!creature || creature->eventWalk != step.ticket) {
+			continue;
+		}
+
+		const Position& pos = creature->getPosition();
+		WalkStep& due = dueWalkSteps[count++];
+		due = step;
+		due.region = (static_cast<uint64_t>(pos.z) << 32) | (static_cast<uint64_t>(pos.y >> FLOOR_BITS) << 16) | static_cast<uint64_t>(pos.x >> FLOOR_BITS);
+	}
+	dueWalkSteps.resize(count);
+	std::sort(dueWalkSteps.begin(), dueWalkSteps.end(), [](const WalkStep& a, const WalkStep& b) {
+		return a.region < b.region;
+	});
+
+	for (const WalkStep& step : dueWalkSteps) {
+		// a previous step of this round may have killed, removed or stopped it
+		Creature* creature = getCreatureByID(step.creatureId);
+		if (creature && creature->eventWalk == step.ticket && creature->getHealth() > 0) {
+			creature->onCreatureWalk();
+		}
+	}
+	dueWalkSteps.clear();
+	cleanup();
+
+	if (pendingWalkSteps == 0) {
+		walkBucketsScheduled = false;
+		return;
+	}
+
+	now = OTSYS_TIME();
+	g_scheduler().addEvent(createSchedulerTask(
+		static_cast<uint32_t>(std::max<int64_t>(1, nextWalkBucket * EVENT_WALK_BUCKET_INTERVAL - now)),
+		std::bind(&Game::checkCreatureWalks, this)));
+}
+
 void Game::updateCreatureWalk(uint32_t creatureId)
 {
 	Creature* creature = getCreatureByID(creatureId);
@@ -5247,6 +5402,11 @@ void Game::checkCreatures(size_t index)
 	g_scheduler().addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT)));
 
 	auto& checkCreatureList = checkCreatureLists[index];
+	if (g_configManager().getBoolean(PARALLEL_CREATURE_THINK)) {
+		planCreatureThink(checkCreatureList);
+	}
+
+	fieldDamageRound = true;
 	size_t it = 0, end = checkCreatureList.size();
 	while (it < end) {
 		Creature* creature = checkCreatureList[it];
@@ -5268,9 +5428,88 @@ void Game::checkCreatures(size_t index)
 			--end;
 		}
 	}
+	applyFieldDamages();
 	cleanup();
 }
 
+bool Game::addFieldDamage(const Creature* creature, uint32_t owner, ConditionType_t type, int32_t value)
+{
+	if (!fieldDamageRound) {
+		return false;
+	}
+
+	fieldDamages.push_back({creature->getID(), owner, type, value});
+	return true;
+}
+
+void Game::applyFieldDamages()
+{
+	fieldDamageRound = false;
+	if (fieldDamages.empty()) {
+		return;
+	}
+
+	// occupants of the same fields stand next to each other, their health updates share the leaves
+	bool spectatorBatch = fieldDamages.size() >= COMBAT_SPECTATOR_BATCH_TILES;
+	bool previousBatch = spectatorBatch && map.setSpectatorBatch(true);
+	for (const FieldDamage& damage : fieldDamages) {
+		Creature* creature = getCreatureByID(damage.creatureId);
+		if (creature && !creature->isRemoved() && creature->getHealth() > 0) {
+			ConditionDamage::dealDamage(creature, damage.owner, damage.type, true, damage.value);
+		}
+	}
+	fieldDamages.clear();
+
+	if (spectatorBatch) {
+		map.setSpectatorBatch(previousBatch);
+	}
+}
+
+void Game::planCreatureThink(const std::vector<Creature*>& checkCreatureList)
+{
+	// group the monsters that are going to search a follow path by map region
+	size_t planned = 0;
+	for (Creature* creature : checkCreatureList) {
+		if (!creature || !creature->creatureCheck || creature->getHealth() <= 0 || !creature->getMonster()) {
+			continue;
+		}
+
+		if (!creature->isFollowPathDue(EVENT_CREATURE_THINK_INTERVAL)) {
+			continue;
+		}
+
+		const Position& pos = creature->getPosition();
+		const QTreeLeafNode* leaf = map.getQTNode(pos.x, pos.y);
+		auto it = thinkRegionIndex.find(leaf);
+		if (it == thinkRegionIndex.end()) {
+			it = thinkRegionIndex.emplace(leaf, thinkRegionIndex.size()).first;
+			if (thinkRegions.size() < thinkRegionIndex.size()) {
+				thinkRegions.emplace_back();
+			}
+		}
+		thinkRegions[it->second].push_back(creature);
+		++planned;
+	}
+
+	size_t regions = thinkRegionIndex.size();
+	if (planned >= PARALLEL_THINK_MIN_CREATURES) {
+		// nothing touches the map while the regions are planned, the paths are
+		// picked up (or discarded if the world changed) by onThink below
+		Map::ReadOnlyScope readOnlyScope(map);
+		#pragma omp parallel for schedule(dynamic)
+		for (int64_t i = 0; i < static_cast<int64_t>(regions); ++i) {
+			for (Creature* creature : thinkRegions[i]) {
+				creature->planFollowPath();
+			}
+		}
+	}
+
+	for (size_t i = 0; i < regions; ++i) {
+		thinkRegions[i].clear();
+	}
+	thinkRegionIndex.clear();
+}
+
 void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 {
 	int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -5279,11 +5518,9 @@ void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 	creature->setSpeed(varSpeed);
 
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), false, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), false, true, [creature](Creature* spectator) {
 		spectator->getPlayer()->sendChangeSpeed(creature, creature->getStepSpeed());
-	}
+	});
 }
 
 void Game::changePlayerSpeed(Player& player, int32_t varSpeedDelta)
@@ -5294,22 +5531,20 @@ void Game::changePlayerSpeed(Player& player, int32_t varSpeedDelta)
 	player.setSpeed(varSpeed);
 
 	// Send new player speed to the spectators
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, player.getPosition(), false, true);
-	for (Creature* creatureSpectator : spectators) {
+	map.forEachSpectator(player.getPosition(), false, true, [&player](Creature* creatureSpectator) {
 		if (creatureSpectator == nullptr) {
 			SPDLOG_ERROR("[Game::changePlayerSpeed] - Creature spectator is nullptr");
-			continue;
+			return;
 		}
 
 		const Player *playerSpectator = creatureSpectator->getPlayer();
 		if (playerSpectator == nullptr) {
 			SPDLOG_ERROR("[Game::changePlayerSpeed] - Player spectator is nullptr");
-			continue;
+			return;
 		}
 
 		playerSpectator->sendChangeSpeed(&player, player.getStepSpeed());
-	}
+	});
 }
 
 void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outfit)
@@ -5325,54 +5560,44 @@ void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outf
 	}
 
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureChangeOutfit(creature, outfit);
-	}
+	});
 }
 
 void Game::internalCreatureChangeVisible(Creature* creature, bool visible)
 {
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureChangeVisible(creature, visible);
-	}
+	});
 }
 
 void Game::changeLight(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureLight(creature);
-	}
+	});
 }
 
 void Game::updateCreatureIcon(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureIcon(creature);
-	}
+	});
 }
 
 void Game::reloadCreature(const Creature* creature)
 {
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), false, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), false, true, [creature](Creature* spectator) {
 		Player* tmpPlayer = spectator->getPlayer();
 		if (!tmpPlayer) {
-			continue;
+			return;
 		}
 		tmpPlayer->reloadCreature(creature);
-	}
+	});
 }
 
 bool Game::combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field)
@@ -5766,7 +5991,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 		TextMessage message;
 		message.position = targetPos;
 
-		if (!isEvent) {
+		if (!isEvent && g_events().hasListener(EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH)) {
 			g_events().eventCreatureOnDrainHealth(target, attacker, damage.primary.type, damage.primary.value, damage.secondary.type, damage.secondary.value, message.primary.color, message.secondary.color);
 		}
 		if (damage.origin != ORIGIN_NONE && attacker && damage.primary.type != COMBAT_HEALING) {
@@ -6356,12 +6581,23 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 
 void Game::addCreatureHealth(const Creature* target)
 {
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, target->getPosition(), true, true);
-	addCreatureHealth(spectators, target);
+	updatePartyHealth(target);
+	map.forEachSpectator(target->getPosition(), true, true, [target](Creature* spectator) {
+		spectator->getPlayer()->sendCreatureHealth(target);
+	});
 }
 
 void Game::addCreatureHealth(const SpectatorHashSet& spectators, const Creature* target)
+{
+	updatePartyHealth(target);
+	for (Creature* spectator : spectators) {
+		if (Player* tmpPlayer = spectator->getPlayer()) {
+			tmpPlayer->sendCreatureHealth(target);
+		}
+	}
+}
+
+void Game::updatePartyHealth(const Creature* target)
 {
 	uint8_t healthPercent = std::ceil((static_cast<double>(target->getHealth()) / std::max<int32_t>(target->getMaxHealth(), 1)) * 100);
 	if (const Player* targetPlayer = target->getPlayer()) {
@@ -6375,11 +6611,6 @@ void Game::addCreatureHealth(const SpectatorHashSet& spectators, const Creature*
 			}
 		}
 	}
-	for (Creature* spectator : spectators) {
-		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendCreatureHealth(target);
-		}
-	}
 }
 
 void Game::addPlayerMana(const Player* target)
@@ -6408,22 +6639,38 @@ void Game::addPlayerVocation(const Player* target)
 
 void Game::addMagicEffect(const Position& pos, uint8_t effect)
 {
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, pos, true, true);
-	addMagicEffect(spectators, pos, effect);
+	if (g_dispatcherGovernor().shouldShedCosmetic()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddMagicEffect(msg, pos, effect);
+	map.forEachSpectator(pos, true, true, [&pos, &msg](Creature* spectator) {
+		spectator->getPlayer()->sendMagicEffect(pos, msg);
+	});
 }
 
 void Game::addMagicEffect(const SpectatorHashSet& spectators, const Position& pos, uint8_t effect)
 {
+	if (g_dispatcherGovernor().shouldShedCosmetic()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddMagicEffect(msg, pos, effect);
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendMagicEffect(pos, effect);
+			tmpPlayer->sendMagicEffect(pos, msg);
 		}
 	}
 }
 
 void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect)
 {
+	if (g_dispatcherGovernor().shouldShedCosmetic()) {
+		return;
+	}
+
 	SpectatorHashSet spectators;
 	map.getSpectators(spectators, fromPos, false, true);
 	map.getSpectators(spectators, toPos, false, true);
@@ -6432,39 +6679,47 @@ void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, uin
 
 void Game::addDistanceEffect(const SpectatorHashSet& spectators, const Position& fromPos, const Position& toPos, uint8_t effect)
 {
+	if (g_dispatcherGovernor().shouldShedCosmetic()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddDistanceShoot(msg, fromPos, toPos, effect);
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendDistanceShoot(fromPos, toPos, effect);
+			tmpPlayer->sendDistanceShoot(msg);
 		}
 	}
 }
 
-void Game::checkImbuements()
+void Game::checkImbuements(uint32_t playerId)
 {
-	g_scheduler().addEvent(createSchedulerTask(EVENT_IMBUEMENT_INTERVAL, std::bind(&Game::checkImbuements, this)));
-
-	std::vector<uint32_t> toErase;
+	Player* player = getPlayerByID(playerId);
+	if (!player) {
+		return;
+	}
 
-	for (const auto& [key, value] : playersActiveImbuements) {
-		Player* player = getPlayerByID(key);
-		if (!player) {
-			toErase.push_back(key);
-			continue;
-		}
+	player->imbuementEvent = 0;
+	player->updateInventoryImbuement();
+}
 
-		player->updateInventoryImbuement();
-	}
+void Game::flushPlayerStorages()
+{
+	SchedulerTask* task = createSchedulerTask(g_configManager().getNumber(PLAYER_STORAGE_FLUSH_INTERVAL) * 1000, std::bind(&Game::flushPlayerStorages, this));
+	task->setPriority(TASK_PRIORITY_LOW);
+	g_scheduler().addEvent(task);
 
-	for (uint32_t playerId : toErase) {
-		setPlayerActiveImbuements(playerId, 0);
+	for (const auto& it : players) {
+		IOLoginData::flushPlayerStorage(it.second);
 	}
-
 }
 
 void Game::checkLight()
 {
 	g_scheduler().addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL_MS, std::bind(&Game::checkLight, this)));
 
+	const uint8_t previousLightLevel = lightLevel;
+	const int32_t previousHour = lightHour / 60;
 	lightHour += lightHourDelta;
 
 	if (lightHour > LIGHT_DAY_LENGTH) {
@@ -6478,17 +6733,14 @@ void Game::checkLight()
 	}
 
 	int32_t newLightLevel = lightLevel;
-	bool lightChange = false;
 
 	switch (lightState) {
 		case LIGHT_STATE_SUNRISE: {
 			newLightLevel += (LIGHT_LEVEL_DAY - LIGHT_LEVEL_NIGHT) / 30;
-			lightChange = true;
 			break;
 		}
 		case LIGHT_STATE_SUNSET: {
 			newLightLevel -= (LIGHT_LEVEL_DAY - LIGHT_LEVEL_NIGHT) / 30;
-			lightChange = true;
 			break;
 		}
 		default:
@@ -6507,15 +6759,18 @@ void Game::checkLight()
 
 	LightInfo lightInfo = getWorldLightInfo();
 
-	if (lightChange) {
+	// the client keeps its clock running on its own, so besides light changes the time is
+	// only resynchronised once per tibia hour; the clients skip values they already have
+	if (lightLevel != previousLightLevel) {
 		for (const auto& it : players) {
 			it.second->sendWorldLight(lightInfo);
-      it.second->sendTibiaTime(lightHour);
+			it.second->sendTibiaTime(lightHour);
 		}
-	} else {
+	} else if (lightHour / 60 != previousHour && !g_dispatcherGovernor().shouldShedCosmetic()) {
+		// the correction can wait for a calmer tick
 		for (const auto& it : players) {
 			it.second->sendTibiaTime(lightHour);
-    }
+		}
 	}
   if (currentLightState != lightState) {
 		currentLightState = lightState;
@@ -6555,6 +6810,9 @@ void Game::shutdown()
 	SPDLOG_INFO("Shutting down...");
 
 	g_scheduler().shutdown();
+	g_handshakeWorkers().shutdown();
+	g_luaWorkers().shutdown();
+	g_forkedSave().join();
 	g_databaseTasks().shutdown();
 	g_dispatcher().shutdown();
 	map.spawnsMonster.clear();
@@ -6568,6 +6826,7 @@ void Game::shutdown()
 	}
 
 	ConnectionManager::getInstance().closeAll();
+	g_inputTrace().stopRecording();
 
 	SPDLOG_INFO("Done!");
 }
@@ -6591,6 +6850,18 @@ void Game::ReleaseCreature(Creature* creature)
 	ToReleaseCreatures.push_back(creature);
 }
 
+uint32_t Game::takeTilesToClean(std::vector<Tile*>& tiles)
+{
+	uint32_t count = 0;
+	tiles.reserve(tiles.size() + tilesToClean.size());
+	for (const auto& [tile, items] : tilesToClean) {
+		tiles.push_back(tile);
+		count += items;
+	}
+	tilesToClean.clear();
+	return count;
+}
+
 void Game::ReleaseItem(Item* item)
 {
 	if (!item) {
@@ -6621,12 +6892,10 @@ void Game::broadcastMessage(const std::string& text, MessageClasses type) const
 void Game::updateCreatureWalkthrough(const Creature* creature)
 {
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [creature](Creature* spectator) {
 		Player* tmpPlayer = spectator->getPlayer();
 		tmpPlayer->sendCreatureWalkthrough(creature, tmpPlayer->canWalkthroughEx(creature));
-	}
+	});
 }
 
 void Game::updateCreatureSkull(const Creature* creature)
@@ -6635,20 +6904,16 @@ void Game::updateCreatureSkull(const Creature* creature)
 		return;
 	}
 
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(creature->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureSkull(creature);
-	}
+	});
 }
 
 void Game::updatePlayerShield(Player* player)
 {
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, player->getPosition(), true, true);
-	for (Creature* spectator : spectators) {
+	map.forEachSpectator(player->getPosition(), true, true, [&](Creature* spectator) {
 		spectator->getPlayer()->sendCreatureShield(player);
-	}
+	});
 }
 
 void Game::updateCreatureType(Creature* creature)
@@ -6673,22 +6938,14 @@ void Game::updateCreatureType(Creature* creature)
 	}
 
 	//send to clients
-	SpectatorHashSet spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	if (creatureType == CREATURETYPE_SUMMON_OTHERS) {
-		for (Creature* spectator : spectators) {
-			Player* player = spectator->getPlayer();
-			if (masterPlayer == player) {
-				player->sendCreatureType(creature, CREATURETYPE_SUMMON_PLAYER);
-			} else {
-				player->sendCreatureType(creature, creatureType);
-			}
-		}
-	} else {
-		for (Creature* spectator : spectators) {
-			spectator->getPlayer()->sendCreatureType(creature, creatureType);
+	map.forEachSpectator(creature->getPosition(), true, true, [creature, creatureType, masterPlayer](Creature* spectator) {
+		Player* player = spectator->getPlayer();
+		if (creatureType == CREATURETYPE_SUMMON_OTHERS && masterPlayer == player) {
+			player->sendCreatureType(creature, CREATURETYPE_SUMMON_PLAYER);
+		} else {
+			player->sendCreatureType(creature, creatureType);
 		}
-	}
+	});
 }
 
 void Game::updatePremium(account::Account& account)
@@ -6970,12 +7227,19 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 	case CYCLOPEDIA_CHARACTERINFO_GENERALSTATS: player->sendCyclopediaCharacterGeneralStats(); break;
 	case CYCLOPEDIA_CHARACTERINFO_COMBATSTATS: player->sendCyclopediaCharacterCombatStats(); break;
   case CYCLOPEDIA_CHARACTERINFO_RECENTDEATHS: {
+			uint16_t cachedPages;
+			if (const auto* cached = g_cyclopediaCache().getRecentDeaths(playerGUID, page, entriesPerPage, cachedPages)) {
+				player->sendCyclopediaCharacterRecentDeaths(page, cachedPages, *cached);
+				break;
+			}
+
     std::ostringstream query;
     uint32_t offset = static_cast<uint32_t>(page - 1) * entriesPerPage;
 			query << "SELECT `time`, `level`, `killed_by`, `mostdamage_by`, (select count(*) FROM `player_deaths` WHERE `player_id` = " << playerGUID << ") as `entries` FROM `player_deaths` WHERE `player_id` = " << playerGUID << " ORDER BY `time` DESC LIMIT " << offset << ", " << entriesPerPage;
 
 			uint32_t playerID = player->getID();
-			std::function<void(DBResult_ptr, bool)> callback = [playerID, page, entriesPerPage](DBResult_ptr result, bool) {
+			uint32_t generation = g_cyclopediaCache().getGeneration();
+			std::function<void(DBResult_ptr, bool)> callback = [playerID, playerGUID, generation, page, entriesPerPage](DBResult_ptr result, bool) {
 				Player* player = g_game().getPlayerByID(playerID);
 				if (!player) {
 					return;
@@ -7025,14 +7289,21 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 					cause << '.';
 					entries.emplace_back(std::move(cause.str()), result->getNumber<uint32_t>("time"));
 				} while (result->next());
+				g_cyclopediaCache().setRecentDeaths(playerGUID, page, entriesPerPage, generation, static_cast<uint16_t>(pages), entries);
 				player->sendCyclopediaCharacterRecentDeaths(page, static_cast<uint16_t>(pages), entries);
 			};
-			g_databaseTasks().addTask(query.str(), callback, true);
+			g_databaseTasks().addReadTask(query.str(), callback, playerGUID, Database::getPlayerKey(playerGUID), playerGUID);
 			player->addAsyncOngoingTask(PlayerAsyncTask_RecentDeaths);
 			break;
 	}
 	case CYCLOPEDIA_CHARACTERINFO_RECENTPVPKILLS: {
 			// TODO: add guildwar, assists and arena kills
+			uint16_t cachedPages;
+			if (const auto* cached = g_cyclopediaCache().getRecentPvPKills(playerGUID, page, entriesPerPage, cachedPages)) {
+				player->sendCyclopediaCharacterRecentPvPKills(page, cachedPages, *cached);
+				break;
+			}
+
 			Database& db = Database::getInstance();
 			const std::string& escapedName = db.escapeString(player->getName());
 			std::ostringstream query;
@@ -7040,7 +7311,8 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 			query << "SELECT `d`.`time`, `d`.`killed_by`, `d`.`mostdamage_by`, `d`.`unjustified`, `d`.`mostdamage_unjustified`, `p`.`name`, (select count(*) FROM `player_deaths` WHERE ((`killed_by` = " << escapedName << " AND `is_player` = 1) OR (`mostdamage_by` = " << escapedName << " AND `mostdamage_is_player` = 1))) as `entries` FROM `player_deaths` AS `d` INNER JOIN `players` AS `p` ON `d`.`player_id` = `p`.`id` WHERE ((`d`.`killed_by` = " << escapedName << " AND `d`.`is_player` = 1) OR (`d`.`mostdamage_by` = " << escapedName << " AND `d`.`mostdamage_is_player` = 1)) ORDER BY `time` DESC LIMIT " << offset << ", " << entriesPerPage;
 
 			uint32_t playerID = player->getID();
-			std::function<void(DBResult_ptr, bool)> callback = [playerID, page, entriesPerPage](DBResult_ptr result, bool) {
+			uint32_t generation = g_cyclopediaCache().getGeneration();
+			std::function<void(DBResult_ptr, bool)> callback = [playerID, playerGUID, generation, page, entriesPerPage](DBResult_ptr result, bool) {
 				Player* player = g_game().getPlayerByID(playerID);
 				if (!player) {
 					return;
@@ -7078,9 +7350,10 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 					description << "Killed " << name << '.';
 					entries.emplace_back(std::move(description.str()), result->getNumber<uint32_t>("time"), status);
 				} while (result->next());
+				g_cyclopediaCache().setRecentPvPKills(playerGUID, page, entriesPerPage, generation, static_cast<uint16_t>(pages), entries);
 				player->sendCyclopediaCharacterRecentPvPKills(page, static_cast<uint16_t>(pages), entries);
 			};
-			g_databaseTasks().addTask(query.str(), callback, true);
+			g_databaseTasks().addReadTask(query.str(), callback, playerGUID, Database::getPlayerKey(playerGUID), playerGUID);
 			player->addAsyncOngoingTask(PlayerAsyncTask_RecentPvPKills);
 			break;
 	}
@@ -7097,105 +7370,18 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 
 void Game::playerHighscores(Player* player, HighscoreType_t type, uint8_t category, uint32_t vocation, const std::string&, uint16_t page, uint8_t entriesPerPage)
 {
-	if (player->hasAsyncOngoingTask(PlayerAsyncTask_Highscore)) {
-		return;
+	if (category >= HIGHSCORE_CATEGORIES) {
+		category = HIGHSCORE_CATEGORY_EXPERIENCE;
 	}
 
-	std::string categoryName;
-	switch (category) {
-		case HIGHSCORE_CATEGORY_FIST_FIGHTING: categoryName = "skill_fist"; break;
-		case HIGHSCORE_CATEGORY_CLUB_FIGHTING: categoryName = "skill_club"; break;
-		case HIGHSCORE_CATEGORY_SWORD_FIGHTING: categoryName = "skill_sword"; break;
-		case HIGHSCORE_CATEGORY_AXE_FIGHTING: categoryName = "skill_axe"; break;
-		case HIGHSCORE_CATEGORY_DISTANCE_FIGHTING: categoryName = "skill_dist"; break;
-		case HIGHSCORE_CATEGORY_SHIELDING: categoryName = "skill_shielding"; break;
-		case HIGHSCORE_CATEGORY_FISHING: categoryName = "skill_fishing"; break;
-		case HIGHSCORE_CATEGORY_MAGIC_LEVEL: categoryName = "maglevel"; break;
-		default: {
-			category = HIGHSCORE_CATEGORY_EXPERIENCE;
-			categoryName = "experience";
-			break;
-		}
-	}
-
-	std::ostringstream query;
-	if (type == HIGHSCORE_GETENTRIES) {
-		uint32_t startPage = (static_cast<uint32_t>(page - 1) * static_cast<uint32_t>(entriesPerPage));
-		uint32_t endPage = startPage + static_cast<uint32_t>(entriesPerPage);
-		query << "SELECT *, @row AS `entries`, " << page << " AS `page` FROM (SELECT *, (@row := @row + 1) AS `rn` FROM (SELECT `id`, `name`, `level`, `vocation`, `" << categoryName << "` AS `points`, @curRank := IF(@prevRank = `" << categoryName << "`, @curRank, IF(@prevRank := `" << categoryName << "`, @curRank + 1, @curRank + 1)) AS `rank` FROM `players` `p`, (SELECT @curRank := 0, @prevRank := NULL, @row := 0) `r` WHERE `group_id` < " << static_cast<int>(account::GROUP_TYPE_GAMEMASTER) << " ORDER BY `" << categoryName << "` DESC) `t`";
-		if (vocation != 0xFFFFFFFF) {
-			bool firstVocation = true;
-
-			const auto& vocationsMap = g_vocations().getVocations();
-			for (const auto& it : vocationsMap) {
-				const Vocation& voc = it.second;
-				if (voc.getFromVocation() == vocation) {
-					if (firstVocation) {
-						query << " WHERE `vocation` = " << voc.getId();
-						firstVocation = false;
-					} else {
-						query << " OR `vocation` = " << voc.getId();
-					}
-				}
-			}
-		}
-		query << ") `T` WHERE `rn` > " << startPage << " AND `rn` <= " << endPage;
-	} else if (type == HIGHSCORE_OURRANK) {
-		std::string entriesStr = std::to_string(entriesPerPage);
-		query << "SELECT *, @row AS `entries`, (@ourRow DIV " << entriesStr << ") + 1 AS `page` FROM (SELECT *, (@row := @row + 1) AS `rn`, @ourRow := IF(`id` = " << player->getGUID() << ", @row - 1, @ourRow) AS `rw` FROM (SELECT `id`, `name`, `level`, `vocation`, `" << categoryName << "` AS `points`, @curRank := IF(@prevRank = `" << categoryName << "`, @curRank, IF(@prevRank := `" << categoryName << "`, @curRank + 1, @curRank + 1)) AS `rank` FROM `players` `p`, (SELECT @curRank := 0, @prevRank := NULL, @row := 0, @ourRow := 0) `r` WHERE `group_id` < " << static_cast<int>(account::GROUP_TYPE_GAMEMASTER) << " ORDER BY `" << categoryName << "` DESC) `t`";
-		if (vocation != 0xFFFFFFFF) {
-			bool firstVocation = true;
-
-			const auto& vocationsMap = g_vocations().getVocations();
-			for (const auto& it : vocationsMap) {
-				const Vocation& voc = it.second;
-				if (voc.getFromVocation() == vocation) {
-					if (firstVocation) {
-						query << " WHERE `vocation` = " << voc.getId();
-						firstVocation = false;
-					} else {
-						query << " OR `vocation` = " << voc.getId();
-					}
-				}
-			}
-		}
-		query << ") `T` WHERE `rn` > ((@ourRow DIV " << entriesStr << ") * " << entriesStr << ") AND `rn` <= (((@ourRow DIV " << entriesStr << ") * " << entriesStr << ") + " << entriesStr << ")";
+	std::vector<HighscoreCharacter> characters;
+	uint16_t resultPage;
+	uint16_t pages;
+	if (!g_highscores().getPage(type, category, vocation, player->getGUID(), page, entriesPerPage, characters, resultPage, pages)) {
+		player->sendHighscoresNoData();
+		return;
 	}
-
-	uint32_t playerID = player->getID();
-	std::function<void(DBResult_ptr, bool)> callback = [playerID, category, vocation, entriesPerPage](DBResult_ptr result, bool) {
-		Player* player = g_game().getPlayerByID(playerID);
-		if (!player) {
-			return;
-		}
-
-		player->resetAsyncOngoingTask(PlayerAsyncTask_Highscore);
-		if (!result) {
-			player->sendHighscoresNoData();
-			return;
-		}
-
-		uint16_t page = result->getNumber<uint16_t>("page");
-		uint32_t pages = result->getNumber<uint32_t>("entries");
-		pages += entriesPerPage - 1;
-		pages /= entriesPerPage;
-
-		std::vector<HighscoreCharacter> characters;
-		characters.reserve(result->countResults());
-		do {
-			uint8_t characterVocation;
-			const Vocation* voc = g_vocations().getVocation(result->getNumber<uint16_t>("vocation"));
-			if (voc) {
-				characterVocation = voc->getClientId();
-			} else {
-				characterVocation = 0;
-			}
-			characters.emplace_back(std::move(result->getString("name")), result->getNumber<uint64_t>("points"), result->getNumber<uint32_t>("id"), result->getNumber<uint32_t>("rank"), result->getNumber<uint16_t>("level"), characterVocation);
-		} while (result->next());
-		player->sendHighscores(characters, category, vocation, page, static_cast<uint16_t>(pages));
-	};
-	g_databaseTasks().addTask(query.str(), callback, true);
-	player->addAsyncOngoingTask(PlayerAsyncTask_Highscore);
+	player->sendHighscores(characters, category, vocation, resultPage, pages);
 }
 
 void Game::playerTournamentLeaderboard(uint32_t playerId, uint8_t leaderboardType) {
@@ -8135,6 +8321,7 @@ void Game::playerBuyStoreOffer(uint32_t playerId, uint32_t offerId,
 							query << "UPDATE `players` SET `name` = " << db.escapeString(newName) << " WHERE `id` = " <<
 								player -> getGUID();
 							if (db.executeQuery(query.str())) {
+								g_playerNameCache().remove(player -> getGUID());
 								account.LoadAccountDB(player -> getAccount());
 								account.RemoveCoins(offer -> price);
 								account.RegisterCoinsTransaction(account::COIN_REMOVE,
@@ -8425,8 +8612,7 @@ void Game::updatePlayerSaleItems(uint32_t playerId)
 		return;
 	}
 
-	std::map<uint16_t, uint16_t> inventoryMap;
-	player->sendSaleItemList(player->getAllSaleItemIdAndCount(inventoryMap));
+	player->sendSaleItemList();
 	player->setScheduledSaleUpdate(false);
 }
 
@@ -8436,6 +8622,9 @@ void Game::addPlayer(Player* player)
 	mappedPlayerNames[lowercase_name] = player;
 	wildcardTree.insert(lowercase_name);
 	players[player->getID()] = player;
+	for (uint32_t guid : player->VIPList) {
+		addVipWatcher(guid, player);
+	}
 }
 
 void Game::removePlayer(Player* player)
@@ -8444,26 +8633,91 @@ void Game::removePlayer(Player* player)
 	mappedPlayerNames.erase(lowercase_name);
 	wildcardTree.remove(lowercase_name);
 	players.erase(player->getID());
+	g_sessionResume().remove(player->getGUID());
+	for (uint32_t guid : player->VIPList) {
+		removeVipWatcher(guid, player);
+	}
+}
+
+const std::vector<Player*>& Game::getVipWatchers(uint32_t guid) const
+{
+	static const std::vector<Player*> noWatchers;
+	auto it = vipWatchers.find(guid);
+	return it != vipWatchers.end() ? it->second : noWatchers;
+}
+
+void Game::addVipWatcher(uint32_t guid, Player* watcher)
+{
+	std::vector<Player*>& watchers = vipWatchers[guid];
+	if (std::find(watchers.begin(), watchers.end(), watcher) == watchers.end()) {
+		watchers.push_back(watcher);
+	}
+}
+
+void Game::removeVipWatcher(uint32_t guid, Player* watcher)
+{
+	auto it = vipWatchers.find(guid);
+	if (it == vipWatchers.end()) {
+		return;
+	}
+
+	std::vector<Player*>& watchers = it->second;
+	if (auto watcherIt = std::find(watchers.begin(), watchers.end(), watcher); watcherIt != watchers.end()) {
+		*watcherIt = watchers.back();
+		watchers.pop_back();
+	}
+
+	if (watchers.empty()) {
+		vipWatchers.erase(it);
+	}
+}
+
+uint32_t Game::acquireNpcID(Npc* npc)
+{
+	uint32_t id = npcs.acquire(npc);
+	if (id == 0) {
+		SPDLOG_ERROR("[Game::acquireNpcID] - Out of npc ids, {} npcs exist", npcs.size());
+	}
+	return id;
+}
+
+void Game::releaseNpcID(uint32_t id)
+{
+	npcs.release(id);
 }
 
 void Game::addNpc(Npc* npc)
 {
-	npcs[npc->getID()] = npc;
+	npcs.add(npc);
 }
 
 void Game::removeNpc(Npc* npc)
 {
-	npcs.erase(npc->getID());
+	npcs.remove(npc);
+}
+
+uint32_t Game::acquireMonsterID(Monster* monster)
+{
+	uint32_t id = monsters.acquire(monster);
+	if (id == 0) {
+		SPDLOG_ERROR("[Game::acquireMonsterID] - Out of monster ids, {} monsters exist", monsters.size());
+	}
+	return id;
+}
+
+void Game::releaseMonsterID(uint32_t id)
+{
+	monsters.release(id);
 }
 
 void Game::addMonster(Monster* monster)
 {
-	monsters[monster->getID()] = monster;
+	monsters.add(monster);
 }
 
 void Game::removeMonster(Monster* monster)
 {
-	monsters.erase(monster->getID());
+	monsters.remove(monster);
 }
 
 Guild* Game::getGuild(uint32_t id) const
@@ -8487,7 +8741,7 @@ void Game::removeGuild(uint32_t guildId)
 {
   auto it = guilds.find(guildId);
   if (it != guilds.end()) {
-    IOGuild::saveGuild(it->second);
+    IOGuild::saveGuilds({it->second});
   }
 	guilds.erase(guildId);
 }
@@ -8505,6 +8759,31 @@ void Game::decreaseBrowseFieldRef(const Position& pos)
 	}
 }
 
+void Game::addContainerViewer(const Container* container, Player* player, uint8_t cid)
+{
+	containerViewers[container].emplace_back(player, cid);
+}
+
+void Game::removeContainerViewer(const Container* container, const Player* player, uint8_t cid)
+{
+	auto it = containerViewers.find(container);
+	if (it == containerViewers.end()) {
+		return;
+	}
+
+	auto& viewers = it->second;
+	for (auto viewer = viewers.begin(); viewer != viewers.end(); ++viewer) {
+		if (viewer->first == player && viewer->second == cid) {
+			viewers.erase(viewer);
+			break;
+		}
+	}
+
+	if (viewers.empty()) {
+		containerViewers.erase(it);
+	}
+}
+
 void Game::internalRemoveItems(const std::vector<Item*> itemVector, uint32_t amount, bool stackable)
 {
 	if (stackable) {
@@ -8574,9 +8853,13 @@ void Game::removeUniqueItem(uint16_t uniqueId)
 
 bool Game::reload(ReloadTypes_t reloadType)
 {
+	// item types, spells and vocations all show up in item descriptions
+	Item::clearDescriptionCache();
+
 	switch (reloadType) {
 		case RELOAD_TYPE_MONSTERS: {
 			g_scripts().loadScripts("monster", false, true);
+			g_ioprey().InitializeMonsterPools();
 			return true;
 		}
 		case RELOAD_TYPE_NPCS: {
@@ -8589,7 +8872,11 @@ bool Game::reload(ReloadTypes_t reloadType)
 			return true;
 		}
 		case RELOAD_TYPE_CHAT: return g_chat().load();
-		case RELOAD_TYPE_CONFIG: return g_configManager().reload();
+		case RELOAD_TYPE_CONFIG: {
+			// the orange skull duration may have changed
+			invalidatePlayerRelations();
+			return g_configManager().reload();
+		}
 		case RELOAD_TYPE_EVENTS: return g_events().loadFromXml();
 		case RELOAD_TYPE_ITEMS: return Item::items.reload();
 		case RELOAD_TYPE_MODULES: return g_modules().reload();
@@ -8616,6 +8903,19 @@ bool Game::reload(ReloadTypes_t reloadType)
 			g_scripts().loadScripts("npc", false, true);
 			// Reload npclib
 			g_luaEnvironment.loadFile("data/npclib/load.lua");
+			map.updateMoveEventFlags();
+			return true;
+		}
+
+		case RELOAD_TYPE_CHANGED_SCRIPTS: {
+			// only data/scripts, without tearing down the interfaces; the callbacks of
+			// replaced events stay in the lua registry until the next full reload
+			if (!g_scripts().reloadChangedScripts()) {
+				return reload(RELOAD_TYPE_SCRIPTS);
+			}
+			// items whose weapon script went away get their default weapon back
+			g_weapons().loadDefaults();
+			map.updateMoveEventFlags();
 			return true;
 		}
 
@@ -8636,6 +8936,7 @@ bool Game::reload(ReloadTypes_t reloadType)
 			g_globalEvents().clear(true);
 			g_spells().clear(true);
 			g_scripts().loadScripts("scripts", false, true);
+			map.updateMoveEventFlags();
 		}
 	}
 	return true;
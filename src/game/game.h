@@ -22,6 +22,7 @@
 
 #include "creatures/players/account/account.hpp"
 #include "creatures/combat/combat.h"
+#include "creatures/creature_registry.hpp"
 #include "items/containers/container.h"
 #include "game/gamestore.h"
 #include "creatures/players/grouping/groups.h"
@@ -35,7 +36,6 @@
 #include "creatures/players/grouping/team_finder.hpp"
 #include "utils/wildcardtree.h"
 #include "items/items_classification.hpp"
-#include "protobuf/appearances.pb.h"
 
 class ServiceManager;
 class Creature;
@@ -49,6 +49,23 @@ class ItemClassification;
 static constexpr int32_t EVENT_LIGHTINTERVAL_MS = 10000;
 static constexpr int32_t EVENT_DECAYINTERVAL = 250;
 static constexpr int32_t EVENT_DECAY_BUCKETS = 4;
+// below this many path searches per round the parallel think phase is not worth the fork
+static constexpr size_t PARALLEL_THINK_MIN_CREATURES = 32;
+
+// Outcome of a quick loot pass, shared by every corpse looted in it
+struct QuickLootResult {
+	uint32_t lootedGold = 0;
+	uint32_t lootedItems = 0;
+	bool missedAnyGold = false;
+	bool missedAnyItem = false;
+	bool notEnoughCapacity = false;
+	ObjectCategory_t fullCategory = OBJECTCATEGORY_NONE;
+
+	// lightest single item that did not fit the capacity, heavier ones are not tried again
+	uint32_t failedWeight = std::numeric_limits<uint32_t>::max();
+	// categories without a free slot left for a single item
+	std::bitset<OBJECTCATEGORY_LAST + 1> fullCategories;
+};
 
 class Game
 {
@@ -77,7 +94,7 @@ class Game
 		 * \param filename Is the map custom name (Example: "map".otbm, not is necessary add extension .otbm)
 		 * \returns true if the custom map was loaded successfully
 		*/
-		bool loadMainMap(const std::string& filename);
+		bool loadMainMap(const std::string& filename, bool fileLoaded = false);
 		/**
 		* Load the custom map
 		 * \param filename Is the map custom name (Example: "map".otbm, not is necessary add extension .otbm)
@@ -85,6 +102,11 @@ class Game
 		*/
 		bool loadCustomMap(const std::string& filename);
 		void loadMap(const std::string& path);
+		/**
+		* Reads the OTBM of the main map alone, it may run alongside the script loading
+		 * loadMainMap with fileLoaded adds the spawns and houses afterwards
+		*/
+		void loadMainMapFile(const std::string& filename);
 
 		void getMapDimensions(uint32_t& width, uint32_t& height) const {
 			width = map.width;
@@ -152,6 +174,14 @@ class Game
 		size_t getNpcsOnline() const {
 			return npcs.size();
 		}
+		// creatures in the think and walk check lists
+		size_t getCheckedCreatures() const {
+			size_t count = 0;
+			for (const auto& checkCreatureList : checkCreatureLists) {
+				count += checkCreatureList.size();
+			}
+			return count;
+		}
 		uint32_t getPlayersRecord() const {
 			return playersRecord;
 		}
@@ -229,6 +259,8 @@ class Game
                                  const Position* pos = nullptr);
 
 		void internalQuickLootCorpse(Player* player, Container* corpse);
+		void internalQuickLootCorpse(Player* player, Container* corpse, QuickLootResult& result);
+		void sendQuickLootResult(Player* player, const QuickLootResult& result);
 
 		ReturnValue internalQuickLootItem(Player* player, Item* item,
                     ObjectCategory_t category = OBJECTCATEGORY_DEFAULT);
@@ -427,10 +459,17 @@ class Game
 
 		// Events
 		void checkCreatureWalk(uint32_t creatureId);
+		/**
+		 * Queues a walk step of the creature in the bucket of its due time.
+		 * \returns the ticket to keep in Creature::eventWalk, the step is skipped once they differ
+		 */
+		uint32_t scheduleCreatureWalk(uint32_t creatureId, uint32_t delay);
+		void checkCreatureWalks();
 		void updateCreatureWalk(uint32_t creatureId);
 		void checkCreatureAttack(uint32_t creatureId);
 		void checkCreatures(size_t index);
 		void checkLight();
+		void checkImbuements(uint32_t playerId);
 
 		bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
 
@@ -438,6 +477,12 @@ class Game
 
 		bool combatChangeHealth(Creature* attacker, Creature* target, CombatDamage& damage, bool isEvent = false);
 		bool combatChangeMana(Creature* attacker, Creature* target, CombatDamage& damage);
+		/**
+		 * Queues a damage tick of a field condition while a creature check round runs,
+		 * so the hits of a flooded area are dealt at once on shared spectator queries.
+		 * \returns false outside of a round, the caller deals the damage itself
+		 */
+		bool addFieldDamage(const Creature* creature, uint32_t owner, ConditionType_t type, int32_t value);
 
 		// Animation help functions
 		void addCreatureHealth(const Creature* target);
@@ -465,26 +510,67 @@ class Game
 
 		const std::map<uint16_t, std::map<uint8_t, uint64_t>>& getItemsPrice() const { return itemsPriceMap; }
 		const phmap::flat_hash_map<uint32_t, Player*>& getPlayers() const { return players; }
-		const std::map<uint32_t, Npc*>& getNpcs() const { return npcs; }
+		const std::vector<Npc*>& getNpcs() const { return npcs.getList(); }
+		const std::vector<Monster*>& getMonsters() const { return monsters.getList(); }
 
 		const std::vector<ItemClassification*>& getItemsClassifications() const { return itemsClassifications; }
 
 		void addPlayer(Player* player);
 		void removePlayer(Player* player);
 
+		// online players that have the guid in their VIP list
+		const std::vector<Player*>& getVipWatchers(uint32_t guid) const;
+		void addVipWatcher(uint32_t guid, Player* watcher);
+		void removeVipWatcher(uint32_t guid, Player* watcher);
+
+		/**
+		 * Version of the party, guild, war and skull state between players.
+		 * Bumped on every change of that state, it drops the skull, shield and
+		 * emblem every player caches for the others it sees.
+		 */
+		uint32_t getPlayerRelationsVersion() const {
+			return playerRelationsVersion;
+		}
+		void invalidatePlayerRelations() {
+			++playerRelationsVersion;
+		}
+
+		// ids are generational slots of the registries, see CreatureRegistry
+		uint32_t acquireNpcID(Npc* npc);
+		void releaseNpcID(uint32_t id);
 		void addNpc(Npc* npc);
 		void removeNpc(Npc* npc);
 
-		void addMonster(Monster* npc);
-		void removeMonster(Monster* npc);
+		uint32_t acquireMonsterID(Monster* monster);
+		void releaseMonsterID(uint32_t id);
+		void addMonster(Monster* monster);
+		void removeMonster(Monster* monster);
 
 		Guild* getGuild(uint32_t id) const;
+		const phmap::flat_hash_map<uint32_t, Guild*>& getGuilds() const {
+			return guilds;
+		}
 		void addGuild(Guild* guild);
 		void removeGuild(uint32_t guildId);
 		void decreaseBrowseFieldRef(const Position& pos);
 
 		phmap::flat_hash_map<Tile*, Container*> browseFields;
 
+		// kept by Player::addContainer and closeContainer, so a container reaches its viewers without a spectator search
+		void addContainerViewer(const Container* container, Player* player, uint8_t cid);
+		void removeContainerViewer(const Container* container, const Player* player, uint8_t cid);
+		void removeContainerViewers(const Container* container) {
+			containerViewers.erase(container);
+		}
+		const std::vector<std::pair<Player*, uint8_t>>* getContainerViewers(const Container* container) const {
+			auto it = containerViewers.find(container);
+			return it != containerViewers.end() ? &it->second : nullptr;
+		}
+		// the trade checks of the container events only matter while a trade is open
+		bool hasTradeItems() const {
+			return !tradeItems.empty();
+		}
+
 		void internalRemoveItems(const std::vector<Item*> itemVector, uint32_t amount, bool stackable);
 
 		BedItem* getBedBySleeper(uint32_t guid) const;
@@ -505,20 +591,26 @@ class Game
 		Mounts mounts;
 		Raids raids;
 		GameStore gameStore;
-		Canary::protobuf::appearances::Appearances appearances;
 
-		phmap::flat_hash_set<Tile*> getTilesToClean() const {
-			return tilesToClean;
-		}
+		// one more cleanable item on the tile
 		void addTileToClean(Tile* tile) {
-			tilesToClean.emplace(tile);
+			++tilesToClean[tile];
 		}
+		// one cleanable item less on the tile
 		void removeTileToClean(Tile* tile) {
-			tilesToClean.erase(tile);
+			auto it = tilesToClean.find(tile);
+			if (it != tilesToClean.end() && --it->second == 0) {
+				tilesToClean.erase(it);
+			}
 		}
-		void clearTilesToClean() {
-			tilesToClean.clear();
+		void forgetTileToClean(Tile* tile) {
+			tilesToClean.erase(tile);
 		}
+		/**
+		 * Moves the tiles with cleanable items to tiles and empties the index.
+		 * \returns the number of cleanable items on them
+		 */
+		uint32_t takeTilesToClean(std::vector<Tile*>& tiles);
 
 		void playerInspectItem(Player* player, const Position& pos);
 		void playerInspectItem(Player* player, uint16_t itemId, uint8_t itemCount, bool cyclopedia);
@@ -529,31 +621,10 @@ class Game
 			CharmList.shrink_to_fit();
 		}
 
-		std::vector<Charm*> getCharmList() {
+		const std::vector<Charm*>& getCharmList() const {
 			return CharmList;
 		}
 
-		void increasePlayerActiveImbuements(uint32_t playerId) {
-			setPlayerActiveImbuements(playerId, playersActiveImbuements[playerId] + 1);
-		}
-
-		void decreasePlayerActiveImbuements(uint32_t playerId) {
-			setPlayerActiveImbuements(playerId, playersActiveImbuements[playerId] - 1);
-		}
-
-		void setPlayerActiveImbuements(uint32_t playerId, uint8_t value) {
-			if (value <= 0) {
-				playersActiveImbuements.erase(playerId);
-				return;
-			}
-			
-			playersActiveImbuements[playerId] = std::min<uint8_t>(255, value);
-		}
-
-		uint8_t getPlayerActiveImbuements(uint32_t playerId) {
-			return playersActiveImbuements[playerId];
-		}
-
 		FILELOADER_ERRORS loadAppearanceProtobuf(const std::string& file);
 		bool isMagicEffectRegistered(uint8_t type) const {
 			return std::find(registeredMagicEffects.begin(), registeredMagicEffects.end(), type) != registeredMagicEffects.end();
@@ -572,7 +643,11 @@ class Game
 		}
 
 	private:
-		void checkImbuements();
+		void flushPlayerStorages();
+		void planCreatureThink(const std::vector<Creature*>& checkCreatureList);
+		// deals the field damage queued by the creature check round
+		void applyFieldDamages();
+		static void updatePartyHealth(const Creature* target);
 		bool playerSaySpell(Player* player, SpeakClasses type, const std::string& text);
 		void playerWhisper(Player* player, const std::string& text);
 		bool playerYell(Player* player, const std::string& text);
@@ -580,7 +655,9 @@ class Game
 		void playerSpeakToNpc(Player* player, const std::string& text);
 
 		phmap::flat_hash_map<uint32_t, Player*> players;
-		phmap::flat_hash_map<uint32_t, uint8_t> playersActiveImbuements;
+		// reverse VIP lists by guid, kept by addPlayer/removePlayer and the VIP list edits
+		phmap::flat_hash_map<uint32_t, std::vector<Player*>> vipWatchers;
+		uint32_t playerRelationsVersion = 0;
 		phmap::flat_hash_map<std::string, Player*> mappedPlayerNames;
 		phmap::flat_hash_map<uint32_t, Guild*> guilds;
 		phmap::flat_hash_map<uint16_t, Item*> uniqueItems;
@@ -598,8 +675,36 @@ class Game
 		std::vector<Charm*> CharmList;
 		std::vector<Creature*> ToReleaseCreatures;
 		std::vector<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+
+		// timing wheel of walk steps, one bucket per EVENT_WALK_BUCKET_INTERVAL
+		struct WalkStep {
+			int64_t bucket;
+			uint32_t creatureId;
+			uint32_t ticket;
+			uint64_t region = 0;
+		};
+		std::array<std::vector<WalkStep>, EVENT_WALK_BUCKET_COUNT> walkBuckets;
+		std::vector<WalkStep> dueWalkSteps;
+		int64_t nextWalkBucket = 0;
+		size_t pendingWalkSteps = 0;
+		uint32_t lastWalkTicket = 0;
+		bool walkBucketsScheduled = false;
 		std::vector<Item*> ToReleaseItems;
 
+		// damage ticks of field conditions during a creature check round, dealt at its end
+		struct FieldDamage {
+			uint32_t creatureId;
+			uint32_t owner;
+			ConditionType_t type;
+			int32_t value;
+		};
+		std::vector<FieldDamage> fieldDamages;
+		bool fieldDamageRound = false;
+
+		// creatures of the current check bucket grouped by map region, reused between rounds
+		std::vector<std::vector<Creature*>> thinkRegions;
+		phmap::flat_hash_map<const QTreeLeafNode*, size_t> thinkRegionIndex;
+
 		std::vector<uint8_t> registeredMagicEffects;
 		std::vector<uint8_t> registeredDistanceEffects;
 		std::vector<uint16_t> registeredLookTypes;
@@ -607,19 +712,23 @@ class Game
 		size_t lastBucket = 0;
 		size_t lastImbuedBucket = 0;
 
-		WildcardTreeNode wildcardTree { false };
+		WildcardTree wildcardTree;
 
-		std::map<uint32_t, Npc*> npcs;
-		std::map<uint32_t, Monster*> monsters;
+		CreatureRegistry<Npc, NPC_ID_BASE> npcs;
+		CreatureRegistry<Monster, MONSTER_ID_BASE> monsters;
 
 		std::map<uint32_t, TeamFinder*> teamFinderMap; // [leaderGUID] = TeamFinder*
 
 		//list of items that are in trading state, mapped to the player
 		std::map<Item*, uint32_t> tradeItems;
 
+		// players and container ids every open container is shown with
+		phmap::flat_hash_map<const Container*, std::vector<std::pair<Player*, uint8_t>>> containerViewers;
+
 		std::map<uint32_t, BedItem*> bedSleepersMap;
 
-		phmap::flat_hash_set<Tile*> tilesToClean;
+		// tiles outside houses with cleanable items, with the number of them
+		phmap::flat_hash_map<Tile*, uint32_t> tilesToClean;
 
 		ModalWindow offlineTrainingWindow { std::numeric_limits<uint32_t>::max(), "Choose a Skill", "Please choose a skill:" };
 
@@ -193,6 +193,9 @@ struct BaseOffer{
 	Offer_t type;
 	StoreState_t state;
 	std::vector<std::string> icons;
+	// encoded once by GameStore, the offer in the offers packet is head, the per player disabled fields, then tail
+	std::string packetHead;
+	std::string packetTail;
 };
 
 struct ItemOffer : BaseOffer{
@@ -228,6 +231,8 @@ struct StoreCategory{
 	StoreState_t state;
 	std::vector<std::string> icons;
 	std::vector<BaseOffer*> offers;
+	// the offers packet up to the first offer
+	std::string packetHeader;
 };
 
 #endif  // SRC_GAME_GAME_DEFINITIONS_HPP_
@@ -21,6 +21,7 @@
 
 #include "database/database.h"
 #include "game/gamestore.h"
+#include "server/network/message/networkmessage.h"
 #include "utils/tools.h"
 
 uint16_t GameStore::HISTORY_ENTRIES_PER_PAGE=16;
@@ -272,11 +273,88 @@ bool GameStore::loadFromXml()
 			storeCategoryOffers.push_back(cat);
 		}
 		storeCategoryOffers.shrink_to_fit();
+		buildPackets();
 		loaded = true;
 		return true;
 	}
 }
 
+namespace {
+
+// what was written to msg, which is cleared for the next part
+std::string takeMessageBytes(NetworkMessage& msg)
+{
+	std::string bytes(reinterpret_cast<const char*>(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION), msg.getLength());
+	msg.reset();
+	return bytes;
+}
+
+uint8_t getStateByte(StoreState_t state)
+{
+	switch (state) {
+		case NEW:
+			return 1;
+		case SALE:
+			return 2;
+		case LIMITED_TIME:
+			return 3;
+		default:
+			return 0;
+	}
+}
+
+}  // namespace
+
+void GameStore::buildPackets()
+{
+	auto msg = std::make_unique<NetworkMessage>();
+
+	msg->addByte(0xFB); //open store
+	msg->addByte(0x00);
+	msg->add<uint16_t>(static_cast<uint16_t>(storeCategoryOffers.size()));
+	for (const StoreCategory* category : storeCategoryOffers) {
+		msg->addString(category->name);
+		msg->addString(category->description);
+		msg->addByte(getStateByte(category->state));
+
+		msg->addByte(static_cast<uint8_t>(category->icons.size()));
+		for (const std::string& icon : category->icons) {
+			msg->addString(icon);
+		}
+		msg->addString(""); //TODO: parentCategory
+	}
+	openStorePacket = takeMessageBytes(*msg);
+
+	for (StoreCategory* category : storeCategoryOffers) {
+		msg->addByte(0xFC); //StoreOffers
+		msg->addString(category->name);
+		msg->add<uint16_t>(static_cast<uint16_t>(category->offers.size()));
+		category->packetHeader = takeMessageBytes(*msg);
+
+		for (BaseOffer* offer : category->offers) {
+			msg->add<uint32_t>(offer->id);
+			std::ostringstream offerName;
+			if ((offer->type == ITEM || offer->type == STACKABLE_ITEM) && static_cast<ItemOffer*>(offer)->count > 1) {
+				offerName << static_cast<ItemOffer*>(offer)->count << "x ";
+			}
+			offerName << offer->name;
+			msg->addString(offerName.str());
+			msg->addString(offer->description);
+			msg->add<uint32_t>(offer->price);
+			msg->addByte(static_cast<uint8_t>(offer->state));
+			offer->packetHead = takeMessageBytes(*msg);
+
+			msg->addByte(static_cast<uint8_t>(offer->icons.size()));
+			for (const std::string& icon : offer->icons) {
+				msg->addString(icon);
+			}
+			msg->add<uint16_t>(0);
+			//TODO: add support to suboffers
+			offer->packetTail = takeMessageBytes(*msg);
+		}
+	}
+}
+
 int8_t GameStore::getCategoryIndexByName(std::string categoryName)
 {
 	for (uint16_t i = 0; i < storeCategoryOffers.size(); i++) {
@@ -41,18 +41,27 @@ class GameStore {
 			return (uint16_t) storeCategoryOffers.size();
 		}
 
-		std::vector<StoreCategory*> getCategoryOffers() {
+		const std::vector<StoreCategory*>& getCategoryOffers() const {
 			return storeCategoryOffers;
 		};
 
+		// the whole open store packet, the catalog only changes on reload
+		const std::string& getOpenStorePacket() const {
+			return openStorePacket;
+		}
+
 		int8_t getCategoryIndexByName(std::string categoryName);
 		bool haveCategoryByState(StoreState_t state);
 		const BaseOffer* getOfferByOfferId(uint32_t offerId);
 
 	private:
+		// encodes the parts of the store packets that are the same for every player
+		void buildPackets();
+
 		uint32_t offerCount=0;
 		bool loaded=false;
 		std::vector<StoreCategory*> storeCategoryOffers;
+		std::string openStorePacket;
 };
 
 class IOGameStore {
@@ -0,0 +1,195 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "creatures/players/account/account.hpp"
+#include "creatures/players/vocations/vocation.h"
+#include "database/databasetasks.h"
+#include "game/highscores.hpp"
+#include "game/scheduling/scheduler.h"
+
+namespace {
+
+// players table column of each HighscoreCategories_t
+constexpr std::array<const char*, HIGHSCORE_CATEGORIES> highscoreColumns = {
+	"experience", "skill_fist", "skill_club", "skill_sword", "skill_axe", "skill_dist", "skill_shielding", "skill_fishing", "maglevel"
+};
+
+}  // namespace
+
+void Highscores::start()
+{
+	refresh();
+}
+
+void Highscores::refresh()
+{
+	int32_t interval = g_configManager().getNumber(HIGHSCORES_REFRESH_INTERVAL);
+	SchedulerTask* refreshTask = createSchedulerTask(std::max<int32_t>(1, interval) * 1000, std::bind(&Highscores::refresh, this));
+	refreshTask->setPriority(TASK_PRIORITY_LOW);
+	g_scheduler().addEvent(refreshTask);
+	if (refreshing) {
+		return;
+	}
+
+	// the vocations are read here, the worker only gets the copy
+	phmap::flat_hash_map<uint16_t, uint32_t> fromVocations;
+	for (const auto& it : g_vocations().getVocations()) {
+		fromVocations[it.second.getId()] = it.second.getFromVocation();
+	}
+
+	auto newTables = std::make_shared<Tables>();
+	// the lists are minutes old anyway, the replica lagging a little is fine
+	auto task = [newTables, fromVocations = std::move(fromVocations)](Database& db) {
+		return build(db.getReadConnection(), *newTables, fromVocations);
+	};
+	auto done = [this, newTables](DBResult_ptr, bool success) {
+		refreshing = false;
+		if (success) {
+			tables = newTables;
+		}
+	};
+
+	refreshing = true;
+	if (!g_databaseTasks().addTask(task, done, 0)) {
+		done(nullptr, task(Database::getInstance()));
+	}
+}
+
+bool Highscores::build(Database& db, Tables& tables, const phmap::flat_hash_map<uint16_t, uint32_t>& fromVocations)
+{
+	std::ostringstream query;
+	query << "SELECT `id`, `name`, `level`, `vocation`";
+	for (const char* column : highscoreColumns) {
+		query << ", `" << column << '`';
+	}
+	query << " FROM `players` WHERE `group_id` < " << static_cast<int>(account::GROUP_TYPE_GAMEMASTER);
+
+	DBResult_ptr result = db.storeQuery(query.str());
+	if (!result) {
+		// empty or failed, either way the old lists stay
+		return false;
+	}
+
+	tables.rows.reserve(result->countResults());
+	do {
+		Row row;
+		row.id = result->getNumber<uint32_t>("id");
+		row.name = result->getString("name");
+		row.level = result->getNumber<uint16_t>("level");
+		row.vocation = result->getNumber<uint16_t>("vocation");
+		for (size_t category = 0; category < HIGHSCORE_CATEGORIES; ++category) {
+			row.points[category] = result->getNumber<uint64_t>(highscoreColumns[category]);
+		}
+		tables.rowById[row.id] = static_cast<uint32_t>(tables.rows.size());
+		tables.rows.push_back(std::move(row));
+	} while (result->next());
+
+	for (size_t category = 0; category < HIGHSCORE_CATEGORIES; ++category) {
+		std::vector<Entry>& list = tables.all[category];
+		list.reserve(tables.rows.size());
+		for (uint32_t i = 0; i < tables.rows.size(); ++i) {
+			list.push_back({i, 0});
+		}
+
+		// ties ordered by id, the binary search of getPage relies on it
+		std::sort(list.begin(), list.end(), [&](const Entry& lhs, const Entry& rhs) {
+			const Row& left = tables.rows[lhs.row];
+			const Row& right = tables.rows[rhs.row];
+			if (left.points[category] != right.points[category]) {
+				return left.points[category] > right.points[category];
+			}
+			return left.id < right.id;
+		});
+
+		uint32_t rank = 0;
+		for (size_t i = 0; i < list.size(); ++i) {
+			if (i == 0 || tables.rows[list[i].row].points[category] != tables.rows[list[i - 1].row].points[category]) {
+				++rank;
+			}
+			list[i].rank = rank;
+
+			auto it = fromVocations.find(tables.rows[list[i].row].vocation);
+			if (it != fromVocations.end()) {
+				tables.byVocation[it->second][category].push_back(list[i]);
+			}
+		}
+	}
+	return true;
+}
+
+bool Highscores::getPage(HighscoreType_t type, uint8_t category, uint32_t vocation, uint32_t playerGuid, uint16_t page, uint8_t entriesPerPage,
+	std::vector<HighscoreCharacter>& characters, uint16_t& resultPage, uint16_t& pages) const
+{
+	if (!tables || category >= HIGHSCORE_CATEGORIES || entriesPerPage == 0) {
+		return false;
+	}
+
+	// a vocation no one comes from is not filtered, as the query did
+	const std::vector<Entry>* list = &tables->all[category];
+	if (vocation != 0xFFFFFFFF) {
+		auto it = tables->byVocation.find(vocation);
+		if (it != tables->byVocation.end()) {
+			list = &it->second[category];
+		}
+	}
+
+	uint32_t start;
+	if (type == HIGHSCORE_OURRANK) {
+		size_t ourRow = 0;
+		auto rowIt = tables->rowById.find(playerGuid);
+		if (rowIt != tables->rowById.end()) {
+			const Row& ours = tables->rows[rowIt->second];
+			auto it = std::lower_bound(list->begin(), list->end(), ours, [&](const Entry& entry, const Row& key) {
+				const Row& row = tables->rows[entry.row];
+				if (row.points[category] != key.points[category]) {
+					return row.points[category] > key.points[category];
+				}
+				return row.id < key.id;
+			});
+			if (it != list->end() && it->row == rowIt->second) {
+				ourRow = static_cast<size_t>(it - list->begin());
+			}
+		}
+		start = static_cast<uint32_t>(ourRow / entriesPerPage) * entriesPerPage;
+		resultPage = static_cast<uint16_t>(ourRow / entriesPerPage + 1);
+	} else {
+		start = static_cast<uint32_t>(std::max<uint16_t>(page, 1) - 1) * entriesPerPage;
+		resultPage = page;
+	}
+
+	if (start >= list->size()) {
+		return false;
+	}
+
+	pages = static_cast<uint16_t>((list->size() + entriesPerPage - 1) / entriesPerPage);
+
+	size_t end = std::min<size_t>(list->size(), start + entriesPerPage);
+	characters.reserve(end - start);
+	for (size_t i = start; i < end; ++i) {
+		const Entry& entry = (*list)[i];
+		const Row& row = tables->rows[entry.row];
+		const Vocation* voc = g_vocations().getVocation(row.vocation);
+		characters.emplace_back(row.name, row.points[category], row.id, entry.rank, row.level, voc ? voc->getClientId() : 0);
+	}
+	return true;
+}
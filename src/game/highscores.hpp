@@ -0,0 +1,104 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_HIGHSCORES_HPP_
+#define SRC_GAME_HIGHSCORES_HPP_
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "declarations.hpp"
+
+class Database;
+
+static constexpr size_t HIGHSCORE_CATEGORIES = HIGHSCORE_CATEGORY_MAGIC_LEVEL + 1;
+
+/**
+ * The highscore lists of every category, whole and per vocation, built from
+ * the players table on a database worker every highscoresRefreshInterval
+ * seconds. Pages are cut from memory and the own rank is found by binary
+ * search, so a highscore request never reaches MySQL.
+ */
+class Highscores
+{
+	public:
+		Highscores() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		Highscores(const Highscores&) = delete;
+		Highscores& operator=(const Highscores&) = delete;
+
+		static Highscores& getInstance() {
+			// Guaranteed to be destroyed
+			static Highscores instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Builds the first lists and schedules the refresh
+		void start();
+
+		/**
+		 * Same rows the highscore query returned: the requested page, or for
+		 * HIGHSCORE_OURRANK the page holding playerGuid.
+		 * \returns false when the page is empty or the lists are not built yet
+		 */
+		bool getPage(HighscoreType_t type, uint8_t category, uint32_t vocation, uint32_t playerGuid, uint16_t page, uint8_t entriesPerPage,
+			std::vector<HighscoreCharacter>& characters, uint16_t& resultPage, uint16_t& pages) const;
+
+	private:
+		struct Row {
+			uint32_t id;
+			uint16_t level;
+			uint16_t vocation;
+			std::string name;
+			std::array<uint64_t, HIGHSCORE_CATEGORIES> points;
+		};
+
+		struct Entry {
+			uint32_t row;
+			// dense rank over every player, as before the vocation filter
+			uint32_t rank;
+		};
+
+		using Lists = std::array<std::vector<Entry>, HIGHSCORE_CATEGORIES>;
+
+		struct Tables {
+			std::vector<Row> rows;
+			phmap::flat_hash_map<uint32_t, uint32_t> rowById;
+			Lists all;
+			// by the vocation the filter asks for, the one the player's vocation comes from
+			phmap::flat_hash_map<uint32_t, Lists> byVocation;
+		};
+
+		void refresh();
+		// database worker, fromVocations maps each vocation id to its getFromVocation
+		static bool build(Database& db, Tables& tables, const phmap::flat_hash_map<uint16_t, uint32_t>& fromVocations);
+
+		std::shared_ptr<const Tables> tables;
+		bool refreshing = false;
+};
+
+constexpr auto g_highscores = &Highscores::getInstance;
+
+#endif  // SRC_GAME_HIGHSCORES_HPP_
@@ -0,0 +1,101 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_governor.hpp"
+#include "game/scheduling/scheduler.h"
+#include "server/metrics/metrics.hpp"
+
+namespace {
+
+const char* getLoadName(DispatcherLoad_t load)
+{
+	switch (load) {
+		case DISPATCHER_LOAD_BUSY: return "busy";
+		case DISPATCHER_LOAD_OVERLOADED: return "overloaded";
+		default: return "normal";
+	}
+}
+
+}  // namespace
+
+void DispatcherGovernor::start()
+{
+	busyLagMicros = static_cast<int64_t>(g_configManager().getNumber(DISPATCHER_BUSY_LAG)) * 1000;
+	overloadLagMicros = static_cast<int64_t>(g_configManager().getNumber(DISPATCHER_OVERLOAD_LAG)) * 1000;
+	if (busyLagMicros <= 0 && overloadLagMicros <= 0) {
+		return;
+	}
+
+	g_metrics().addCallback("canary_dispatcher_lag_seconds", "Smoothed delay of the dispatcher behind the scheduler events", [this]() {
+		return getLagMicros() / 1000000.;
+	});
+	g_metrics().addCallback("canary_dispatcher_load", "Load level of the dispatcher governor, 0 normal, 1 busy, 2 overloaded", [this]() {
+		return static_cast<double>(getLoad());
+	});
+	scheduleProbe();
+}
+
+uint32_t DispatcherGovernor::getDelayFactor(TaskPriority_t priority) const
+{
+	if (priority != TASK_PRIORITY_LOW) {
+		return 1;
+	}
+
+	switch (getLoad()) {
+		case DISPATCHER_LOAD_BUSY: return 2;
+		case DISPATCHER_LOAD_OVERLOADED: return 4;
+		default: return 1;
+	}
+}
+
+void DispatcherGovernor::scheduleProbe()
+{
+	auto due = std::chrono::steady_clock::now() + std::chrono::milliseconds(DISPATCHER_GOVERNOR_PROBE_INTERVAL);
+	g_scheduler().addEvent(createSchedulerTask(DISPATCHER_GOVERNOR_PROBE_INTERVAL, std::bind(&DispatcherGovernor::probe, this, due)));
+}
+
+void DispatcherGovernor::probe(std::chrono::steady_clock::time_point due)
+{
+	int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - due).count();
+	int64_t lag = std::max<int64_t>(std::max<int64_t>(0, sample), getLagMicros() * 3 / 4);
+	lagMicros.store(lag, std::memory_order_relaxed);
+
+	DispatcherLoad_t newLoad = DISPATCHER_LOAD_NORMAL;
+	if (overloadLagMicros > 0 && lag >= overloadLagMicros) {
+		newLoad = DISPATCHER_LOAD_OVERLOADED;
+	} else if (busyLagMicros > 0 && lag >= busyLagMicros) {
+		newLoad = DISPATCHER_LOAD_BUSY;
+	}
+
+	DispatcherLoad_t oldLoad = getLoad();
+	if (newLoad != oldLoad) {
+		load.store(newLoad, std::memory_order_relaxed);
+		if (newLoad > oldLoad) {
+			SPDLOG_WARN("[DispatcherGovernor] Dispatcher is {}, {}ms behind, backing off low priority work", getLoadName(newLoad), lag / 1000);
+		} else {
+			SPDLOG_INFO("[DispatcherGovernor] Dispatcher is {} again, {}ms behind", getLoadName(newLoad), lag / 1000);
+		}
+	}
+
+	scheduleProbe();
+}
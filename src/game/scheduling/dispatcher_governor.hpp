@@ -0,0 +1,102 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_SCHEDULING_DISPATCHER_GOVERNOR_HPP_
+#define SRC_GAME_SCHEDULING_DISPATCHER_GOVERNOR_HPP_
+
+#include <atomic>
+#include <chrono>
+
+#include "game/scheduling/tasks.h"
+
+enum DispatcherLoad_t : uint8_t {
+	DISPATCHER_LOAD_NORMAL,
+	DISPATCHER_LOAD_BUSY,
+	DISPATCHER_LOAD_OVERLOADED,
+};
+
+/**
+ * Watches how late the dispatcher runs scheduler events and backs off the
+ * work nobody waits for. A probe event is scheduled every
+ * DISPATCHER_GOVERNOR_PROBE_INTERVAL ms; the delay between its due time and
+ * the moment the dispatcher gets to it is the cycle lag.
+ *
+ * Busy from dispatcherBusyLag on, overloaded from dispatcherOverloadLag on:
+ * - combat, walking and creature checks are scheduler events, they already
+ *   jump the queue on the priority lane and are never touched
+ * - player actions are normal tasks, left alone as well
+ * - TASK_PRIORITY_LOW scheduler events (cleaning, market expiry, highscores,
+ *   storage flushes...) have their delay doubled when busy and quadrupled
+ *   when overloaded
+ * - cosmetic broadcasts (effects, idle yells, clock updates) are not tasks on
+ *   their own, the code sending them asks shouldShedCosmetic() and skips
+ *   them while overloaded
+ * The lag rises with every late probe and decays by a quarter per probe, so
+ * the load does not flap between two levels on a noisy cycle.
+ */
+class DispatcherGovernor
+{
+	public:
+		DispatcherGovernor() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		DispatcherGovernor(const DispatcherGovernor&) = delete;
+		DispatcherGovernor& operator=(const DispatcherGovernor&) = delete;
+
+		static DispatcherGovernor& getInstance() {
+			// Guaranteed to be destroyed
+			static DispatcherGovernor instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads the configuration and schedules the first probe
+		void start();
+
+		// any thread
+		DispatcherLoad_t getLoad() const {
+			return load.load(std::memory_order_relaxed);
+		}
+		int64_t getLagMicros() const {
+			return lagMicros.load(std::memory_order_relaxed);
+		}
+
+		bool shouldShedCosmetic() const {
+			return getLoad() == DISPATCHER_LOAD_OVERLOADED;
+		}
+
+		// factor applied to the delay of a scheduler event of that priority
+		uint32_t getDelayFactor(TaskPriority_t priority) const;
+
+	private:
+		static constexpr uint32_t DISPATCHER_GOVERNOR_PROBE_INTERVAL = 100;
+
+		void scheduleProbe();
+		void probe(std::chrono::steady_clock::time_point due);
+
+		std::atomic<DispatcherLoad_t> load {DISPATCHER_LOAD_NORMAL};
+		std::atomic<int64_t> lagMicros {0};
+		int64_t busyLagMicros = 0;
+		int64_t overloadLagMicros = 0;
+};
+
+constexpr auto g_dispatcherGovernor = &DispatcherGovernor::getInstance;
+
+#endif  // SRC_GAME_SCHEDULING_DISPATCHER_GOVERNOR_HPP_
@@ -0,0 +1,304 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/scheduler.h"
+#include "items/item.h"
+#include "lua/scripts/lua_allocator.hpp"
+#include "lua/scripts/lua_garbage_collector.hpp"
+#include "map/map.h"
+#include "server/network/connection/connection.h"
+#include "server/network/connection/handshake_workers.hpp"
+#include "server/network/protocol/protocol.h"
+#include "utils/object_pool.hpp"
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+	if (value < SUB_BUCKETS) {
+		return static_cast<size_t>(value);
+	}
+
+	uint64_t msb = SUB_BUCKET_BITS;
+	while (msb + 1 < MAX_VALUE_BITS && (value >> (msb + 1)) != 0) {
+		++msb;
+	}
+
+	if ((value >> (msb + 1)) != 0) {
+		// out of range, clamp to the last bucket
+		return BUCKETS - 1;
+	}
+
+	uint64_t subBucket = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return static_cast<size_t>((msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index)
+{
+	if (index < SUB_BUCKETS) {
+		return index;
+	}
+
+	uint64_t msb = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+	uint64_t subBucket = index % SUB_BUCKETS;
+	return (SUB_BUCKETS + subBucket) << (msb - SUB_BUCKET_BITS);
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+	++buckets[bucketIndex(value)];
+	++count;
+	total += value;
+	max = std::max(max, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	total += other.total;
+	max = std::max(max, other.max);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	uint64_t target = static_cast<uint64_t>(std::ceil(count * percentile / 100.));
+	target = std::max<uint64_t>(target, 1);
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		seen += buckets[i];
+		if (seen >= target) {
+			// report the upper bound of the bucket, never above the real maximum
+			uint64_t upper = i + 1 < BUCKETS ? bucketValue(i + 1) - 1 : max;
+			return std::min(upper, max);
+		}
+	}
+	return max;
+}
+
+void LatencyHistogram::reset()
+{
+	buckets.fill(0);
+	count = 0;
+	total = 0;
+	max = 0;
+}
+
+void DispatcherProfiler::start()
+{
+	reportInterval = std::max<int32_t>(1, g_configManager().getNumber(DISPATCHER_PROFILER_INTERVAL));
+	reportTopCount = std::max<int32_t>(1, g_configManager().getNumber(DISPATCHER_PROFILER_TOP_COUNT));
+	setEnabled(g_configManager().getBoolean(DISPATCHER_PROFILER));
+	scheduleReport();
+}
+
+void DispatcherProfiler::setEnabled(bool value)
+{
+	if (value && !isEnabled()) {
+		stats.clear();
+		AStarNodes::getStats().reset();
+		Map::getSightCacheStats().reset();
+		Connection::getWriteStats().reset();
+		Protocol::getCompressionStats().reset();
+		ObjectPool::getStats().reset();
+		LuaAllocator::getStats().reset();
+		g_luaGarbageCollector().getStats().reset();
+		windowStart = getTimeMicros();
+		SPDLOG_INFO("[DispatcherProfiler] Profiling enabled, reporting every {} seconds", reportInterval);
+	}
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+void DispatcherProfiler::record(const char* origin, int64_t waitMicros, int64_t executionMicros)
+{
+	TaskStats& taskStats = stats[origin];
+	if (waitMicros >= 0) {
+		taskStats.wait.record(static_cast<uint64_t>(waitMicros));
+	}
+	taskStats.execution.record(static_cast<uint64_t>(std::max<int64_t>(0, executionMicros)));
+}
+
+void DispatcherProfiler::scheduleReport()
+{
+	g_scheduler().addEvent(createSchedulerTask(reportInterval * 1000, std::bind(&DispatcherProfiler::report, this)));
+}
+
+void DispatcherProfiler::report()
+{
+	scheduleReport();
+	if (!isEnabled() || stats.empty()) {
+		return;
+	}
+
+	std::vector<std::pair<std::string_view, const TaskStats*>> entries;
+	entries.reserve(stats.size());
+
+	uint64_t totalExecution = 0;
+	uint64_t totalTasks = 0;
+	for (const auto& it : stats) {
+		entries.emplace_back(it.first, &it.second);
+		totalExecution += it.second.execution.getTotal();
+		totalTasks += it.second.execution.getCount();
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second->execution.getTotal() > rhs.second->execution.getTotal();
+	});
+
+	int64_t windowMicros = std::max<int64_t>(1, getTimeMicros() - windowStart);
+	SPDLOG_INFO("[DispatcherProfiler] {} tasks from {} origins, busy {:.1f}% of the last {:.1f}s",
+		totalTasks, entries.size(), totalExecution * 100. / windowMicros, windowMicros / 1000000.);
+
+	size_t shown = std::min<size_t>(reportTopCount, entries.size());
+	for (size_t i = 0; i < shown; ++i) {
+		const LatencyHistogram& execution = entries[i].second->execution;
+		const LatencyHistogram& wait = entries[i].second->wait;
+		SPDLOG_INFO("[DispatcherProfiler] #{} {}: count {}, total {:.2f}ms, exec p50/p99/max {}/{}/{}us, wait p50/p99/max {}/{}/{}us",
+			i + 1, entries[i].first, execution.getCount(), execution.getTotal() / 1000.,
+			execution.getPercentile(50), execution.getPercentile(99), execution.getMax(),
+			wait.getPercentile(50), wait.getPercentile(99), wait.getMax());
+	}
+
+	reportPathfinding();
+	reportNetwork();
+	reportItems();
+	reportLua(windowMicros);
+
+	stats.clear();
+	windowStart = getTimeMicros();
+}
+
+void DispatcherProfiler::reportPathfinding()
+{
+	PathfindingStats& pathStats = AStarNodes::getStats();
+	uint64_t searches = pathStats.searches.exchange(0, std::memory_order_relaxed);
+	uint64_t exhausted = pathStats.exhausted.exchange(0, std::memory_order_relaxed);
+	uint64_t expandedNodes = pathStats.expandedNodes.exchange(0, std::memory_order_relaxed);
+	uint64_t maxExpandedNodes = pathStats.maxExpandedNodes.exchange(0, std::memory_order_relaxed);
+	uint64_t micros = pathStats.micros.exchange(0, std::memory_order_relaxed);
+	if (searches != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] pathfinding: {} searches, {:.1f}us avg, expanded nodes avg/max {:.1f}/{}, {} ran out of the {} nodes",
+			searches, static_cast<double>(micros) / searches, static_cast<double>(expandedNodes) / searches, maxExpandedNodes, exhausted, MAX_NODES);
+	}
+
+	SightCacheStats& sightStats = Map::getSightCacheStats();
+	uint64_t hits = sightStats.hits.exchange(0, std::memory_order_relaxed);
+	uint64_t misses = sightStats.misses.exchange(0, std::memory_order_relaxed);
+	if (hits + misses != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] line of sight: {} checks, {:.1f}% answered from the cache",
+			hits + misses, hits * 100. / (hits + misses));
+	}
+}
+
+void DispatcherProfiler::reportNetwork()
+{
+	ConnectionWriteStats& writeStats = Connection::getWriteStats();
+	uint64_t writes = writeStats.writes.exchange(0, std::memory_order_relaxed);
+	uint64_t messages = writeStats.messages.exchange(0, std::memory_order_relaxed);
+	uint64_t bytes = writeStats.bytes.exchange(0, std::memory_order_relaxed);
+	if (writes != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] network: {} writes, {} messages, {:.2f} messages and {:.0f} bytes per write",
+			writes, messages, static_cast<double>(messages) / writes, static_cast<double>(bytes) / writes);
+	}
+
+	CompressionStats& compressionStats = Protocol::getCompressionStats();
+	uint64_t compressed = compressionStats.compressed.exchange(0, std::memory_order_relaxed);
+	uint64_t discarded = compressionStats.discarded.exchange(0, std::memory_order_relaxed);
+	uint64_t skipped = compressionStats.skipped.exchange(0, std::memory_order_relaxed);
+	uint64_t bytesIn = compressionStats.bytesIn.exchange(0, std::memory_order_relaxed);
+	uint64_t bytesOut = compressionStats.bytesOut.exchange(0, std::memory_order_relaxed);
+	uint64_t micros = compressionStats.micros.exchange(0, std::memory_order_relaxed);
+	if (bytesIn != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] compression: {} compressed, {} not smaller, {} skipped, ratio {:.2f}, {:.2f}ms deflating",
+			compressed, discarded, skipped, static_cast<double>(bytesOut) / bytesIn, micros / 1000.);
+	}
+
+	HandshakeStats& handshakeStats = HandshakeWorkers::getStats();
+	uint64_t handled = handshakeStats.handled.exchange(0, std::memory_order_relaxed);
+	uint64_t refused = handshakeStats.refused.exchange(0, std::memory_order_relaxed);
+	uint64_t waitMicros = handshakeStats.waitMicros.exchange(0, std::memory_order_relaxed);
+	uint64_t maxQueued = handshakeStats.maxQueued.exchange(0, std::memory_order_relaxed);
+	if (handled + refused != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] handshakes: {} handled, {} refused, {:.2f}ms avg wait, {} queued at most",
+			handled, refused, handled != 0 ? waitMicros / 1000. / handled : 0., maxQueued);
+	}
+}
+
+void DispatcherProfiler::reportItems()
+{
+	ItemMemoryStats& itemStats = Item::getMemoryStats();
+	int64_t items = itemStats.items.load(std::memory_order_relaxed);
+	int64_t blocks = itemStats.attributeBlocks.load(std::memory_order_relaxed);
+	int64_t integerSlots = itemStats.integerSlots.load(std::memory_order_relaxed);
+	int64_t stringSlots = itemStats.stringSlots.load(std::memory_order_relaxed);
+	int64_t customMaps = itemStats.customMaps.load(std::memory_order_relaxed);
+	if (items > 0) {
+		// custom maps are left out, they are few and need a walk over every item
+		int64_t attributeBytes = blocks * sizeof(ItemAttributes) + integerSlots * sizeof(int64_t) + stringSlots * sizeof(InternedString);
+		SPDLOG_INFO("[DispatcherProfiler] items: {} live, {} with attributes, {} integer and {} string slots, {} custom maps, {:.1f} attribute bytes per item",
+			items, blocks, integerSlots, stringSlots, customMaps, static_cast<double>(attributeBytes) / items);
+	}
+
+	const StringPoolStats& poolStats = g_stringPool().getStats();
+	int64_t strings = poolStats.strings.load(std::memory_order_relaxed);
+	if (strings > 0) {
+		int64_t storedBytes = poolStats.storedBytes.load(std::memory_order_relaxed);
+		SPDLOG_INFO("[DispatcherProfiler] string pool: {} strings with {} references, {} bytes stored, {} bytes saved",
+			strings, poolStats.references.load(std::memory_order_relaxed), storedBytes,
+			poolStats.referencedBytes.load(std::memory_order_relaxed) - storedBytes);
+	}
+
+	ObjectPoolStats& objectStats = ObjectPool::getStats();
+	uint64_t reused = objectStats.reused.exchange(0, std::memory_order_relaxed);
+	uint64_t allocated = objectStats.allocated.exchange(0, std::memory_order_relaxed);
+	uint64_t recycled = objectStats.recycled.exchange(0, std::memory_order_relaxed);
+	uint64_t released = objectStats.released.exchange(0, std::memory_order_relaxed);
+	if (reused + allocated != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] object pool: {} allocations, {:.1f}% reused, {} blocks recycled, {} released to the heap",
+			reused + allocated, reused * 100. / (reused + allocated), recycled, released);
+	}
+}
+
+void DispatcherProfiler::reportLua(int64_t windowMicros)
+{
+	// the report runs on the dispatcher, the only thread touching the Lua allocator
+	LuaAllocatorStats& luaStats = LuaAllocator::getStats();
+	if (luaStats.allocations != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] lua heap: {} live bytes, {:.0f} allocations per second, {:.1f}% from the heap, {} bytes in arenas",
+			luaStats.liveBytes, luaStats.allocations * 1000000. / windowMicros,
+			luaStats.heapAllocations * 100. / luaStats.allocations, luaStats.arenaBytes);
+	}
+	luaStats.reset();
+
+	LuaGarbageCollectorStats& gcStats = g_luaGarbageCollector().getStats();
+	if (gcStats.steps != 0) {
+		SPDLOG_INFO("[DispatcherProfiler] lua gc: {} idle steps, {} cycles finished while idle, {:.2f}ms collecting, longest idle run {}us",
+			gcStats.steps, gcStats.cycles, gcStats.micros / 1000., gcStats.maxMicros);
+	}
+	gcStats.reset();
+}
@@ -0,0 +1,129 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_GAME_SCHEDULING_DISPATCHER_PROFILER_HPP_
+#define SRC_GAME_SCHEDULING_DISPATCHER_PROFILER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * Log-linear histogram in the spirit of HdrHistogram: every power of two is
+ * split in 8 linear sub buckets, so percentiles are within 12.5%.
+ */
+class LatencyHistogram
+{
+	public:
+		void record(uint64_t value);
+		void merge(const LatencyHistogram& other);
+		uint64_t getPercentile(double percentile) const;
+		void reset();
+
+		uint64_t getCount() const {
+			return count;
+		}
+		uint64_t getTotal() const {
+			return total;
+		}
+		uint64_t getMax() const {
+			return max;
+		}
+
+	private:
+		static constexpr uint64_t SUB_BUCKET_BITS = 3;
+		static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		// values are capped at 2^40 (microseconds, ~12 days)
+		static constexpr uint64_t MAX_VALUE_BITS = 40;
+		static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+		static size_t bucketIndex(uint64_t value);
+		static uint64_t bucketValue(size_t index);
+
+		std::array<uint32_t, BUCKETS> buckets {};
+		uint64_t count = 0;
+		uint64_t total = 0;
+		uint64_t max = 0;
+};
+
+/**
+ * Optional per task-origin timing of the dispatcher.
+ * Tasks remember the function that created them, the dispatcher records
+ * how long each one waited in the queue and how long it ran, and a report
+ * with the top offenders is logged every dispatcherProfilerInterval seconds.
+ * When disabled the only cost is one relaxed atomic load per task.
+ */
+class DispatcherProfiler
+{
+	public:
+		DispatcherProfiler() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		DispatcherProfiler(const DispatcherProfiler&) = delete;
+		DispatcherProfiler& operator=(const DispatcherProfiler&) = delete;
+
+		static DispatcherProfiler& getInstance() {
+			// Guaranteed to be destroyed
+			static DispatcherProfiler instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		static int64_t getTimeMicros() {
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// Reads the configuration and schedules the periodic report
+		void start();
+
+		bool isEnabled() const {
+			return enabled.load(std::memory_order_relaxed);
+		}
+		void setEnabled(bool value);
+
+		// dispatcher thread
+		void record(const char* origin, int64_t waitMicros, int64_t executionMicros);
+
+	private:
+		struct TaskStats {
+			LatencyHistogram execution;
+			LatencyHistogram wait;
+		};
+
+		void scheduleReport();
+		void report();
+		void reportPathfinding();
+		void reportNetwork();
+		void reportItems();
+		void reportLua(int64_t windowMicros);
+
+		std::atomic<bool> enabled {false};
+		uint32_t reportInterval = 60;
+		uint32_t reportTopCount = 10;
+		int64_t windowStart = 0;
+
+		phmap::flat_hash_map<std::string_view, TaskStats> stats;
+};
+
+constexpr auto g_dispatcherProfiler = &DispatcherProfiler::getInstance;
+
+#endif  // SRC_GAME_SCHEDULING_DISPATCHER_PROFILER_HPP_
@@ -0,0 +1,291 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/scheduling/dispatcher_watchdog.hpp"
+#include "game/scheduling/tasks.h"
+#include "lua/scripts/lua_environment.hpp"
+
+#if defined(__linux__)
+	#include <csignal>
+	#include <execinfo.h>
+	#include <pthread.h>
+#endif
+
+namespace {
+
+// the stacks are captured while the dispatcher is still stuck, give each one this long
+constexpr int64_t CAPTURE_TIMEOUT = 50;
+// a long stall crosses the task and cycle thresholds, one report covers both
+constexpr int64_t REPORT_COOLDOWN = 5000;
+constexpr int MAX_NATIVE_FRAMES = 64;
+constexpr int MAX_LUA_FRAMES = 32;
+
+int64_t toMillis(int64_t steadyTicks)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration(steadyTicks)).count();
+}
+
+int64_t getSteadyMillis()
+{
+	return toMillis(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+void waitFor(const std::atomic<bool>& flag)
+{
+	int64_t deadline = getSteadyMillis() + CAPTURE_TIMEOUT;
+	while (!flag.load(std::memory_order_acquire) && getSteadyMillis() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void onLuaHook(lua_State* L, lua_Debug*)
+{
+	// dispatcher thread, inside the script that holds it
+	lua_sethook(L, nullptr, 0, 0);
+
+	std::string stack;
+	lua_Debug ar;
+	for (int level = 0; level < MAX_LUA_FRAMES && lua_getstack(L, level, &ar) != 0; ++level) {
+		lua_getinfo(L, "Sln", &ar);
+		stack += fmt::format("  {}:{} in {}\n", ar.short_src, ar.currentline, ar.name ? ar.name : ar.what);
+	}
+	g_dispatcherWatchdog().setLuaStack(stack.c_str());
+}
+
+#if defined(__linux__)
+pthread_t dispatcherThread;
+void* nativeFrames[MAX_NATIVE_FRAMES];
+std::atomic<int> nativeFrameCount {0};
+std::atomic<bool> nativeStackReady {false};
+
+void onWatchdogSignal(int)
+{
+	// backtrace was called once at start, it no longer loads anything here
+	nativeFrameCount.store(backtrace(nativeFrames, MAX_NATIVE_FRAMES), std::memory_order_relaxed);
+	nativeStackReady.store(true, std::memory_order_release);
+}
+
+int getWatchdogSignal()
+{
+	return SIGRTMIN + 3;
+}
+#endif
+
+}  // namespace
+
+void DispatcherWatchdog::start()
+{
+	if (!g_configManager().getBoolean(DISPATCHER_WATCHDOG)) {
+		return;
+	}
+
+	reportFile = g_configManager().getString(DISPATCHER_WATCHDOG_FILE);
+	taskThreshold = std::max<int32_t>(1, g_configManager().getNumber(DISPATCHER_WATCHDOG_TASK_THRESHOLD));
+	cycleThreshold = std::max<int32_t>(1, g_configManager().getNumber(DISPATCHER_WATCHDOG_CYCLE_THRESHOLD));
+	checkInterval = static_cast<uint32_t>(std::clamp<int64_t>(std::min(taskThreshold, cycleThreshold) / 4, 5, 100));
+
+	dispatcherThreadId = std::this_thread::get_id();
+#if defined(__linux__)
+	dispatcherThread = pthread_self();
+	void* warmup[1];
+	backtrace(warmup, 1);
+
+	struct sigaction action = {};
+	action.sa_handler = onWatchdogSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(getWatchdogSignal(), &action, nullptr);
+#endif
+
+	enabled.store(true, std::memory_order_release);
+	ThreadHolder::start();
+	SPDLOG_INFO("Dispatcher watchdog reports tasks over {}ms and cycles over {}ms to {}", taskThreshold, cycleThreshold, reportFile);
+}
+
+void DispatcherWatchdog::shutdown()
+{
+	if (!enabled.exchange(false)) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lockClass(signalLock);
+		setState(THREAD_STATE_TERMINATED);
+	}
+	signal.notify_one();
+}
+
+void DispatcherWatchdog::threadMain()
+{
+	std::unique_lock<std::mutex> signalLockUnique(signalLock);
+	while (getState() != THREAD_STATE_TERMINATED) {
+		signal.wait_for(signalLockUnique, std::chrono::milliseconds(checkInterval));
+		if (getState() != THREAD_STATE_TERMINATED) {
+			signalLockUnique.unlock();
+			check();
+			signalLockUnique.lock();
+		}
+	}
+}
+
+void DispatcherWatchdog::check()
+{
+	int64_t now = getSteadyMillis();
+	if (now - lastReportTime < REPORT_COOLDOWN) {
+		return;
+	}
+
+	int64_t taskStart = g_dispatcher().getTaskStart();
+	if (taskStart != 0 && taskStart != reportedTaskStart && now - toMillis(taskStart) >= taskThreshold) {
+		reportedTaskStart = taskStart;
+		lastReportTime = now;
+		report("task", now - toMillis(taskStart), taskThreshold);
+		return;
+	}
+
+	int64_t cycleStart = g_dispatcher().getCycleStart();
+	if (cycleStart != 0 && cycleStart != reportedCycleStart && now - toMillis(cycleStart) >= cycleThreshold) {
+		reportedCycleStart = cycleStart;
+		lastReportTime = now;
+		report("cycle", now - toMillis(cycleStart), cycleThreshold);
+	}
+}
+
+void DispatcherWatchdog::report(const char* kind, int64_t runningMillis, int64_t thresholdMillis)
+{
+	// read first, the dispatcher may move on while the stacks are captured
+	const char* origin = g_dispatcher().getRunningOrigin();
+	uint64_t cycle = g_dispatcher().getDispatcherCycle();
+	std::string inFlight;
+	{
+		std::lock_guard<std::mutex> lockClass(activityLock);
+		for (size_t i = 0; i < activityCount; ++i) {
+			const Activity& activity = activities[i];
+			inFlight += fmt::format("  {}{}{}\n", activity.label, activity.detail[0] != '\0' ? ": " : "", activity.detail.data());
+		}
+		if (droppedActivities != 0) {
+			inFlight += fmt::format("  ({} more nested)\n", droppedActivities);
+		}
+	}
+
+	std::string nativeStack = captureNativeStack();
+	std::string luaStack = captureLuaStack();
+	bool stillRunning = g_dispatcher().getDispatcherCycle() == cycle;
+
+	SPDLOG_WARN("[DispatcherWatchdog] - Dispatcher {} running for {}ms, task from {}, report written to {}", kind, runningMillis, origin ? origin : "(none)", reportFile);
+
+	std::ofstream file(reportFile, std::ios::app);
+	if (!file) {
+		SPDLOG_ERROR("[DispatcherWatchdog::report] - Cannot write {}", reportFile);
+		return;
+	}
+
+	file << fmt::format("=== {} dispatcher {} running for {}ms (threshold {}ms) ===\n", formatDate(time(nullptr)), kind, runningMillis, thresholdMillis);
+	file << fmt::format("task origin: {}\n", origin ? origin : "(none)");
+	file << fmt::format("dispatcher cycle: {}, pending tasks: {}{}\n", cycle, g_dispatcher().getPendingTasks(), stillRunning ? "" : ", the task ended while the stacks were captured");
+	file << "in flight:\n" << (inFlight.empty() ? "  (nothing marked)\n" : inFlight);
+	file << "lua stack:\n" << (luaStack.empty() ? "  (not in a script)\n" : luaStack);
+	file << "native stack:\n" << nativeStack << '\n';
+}
+
+std::string DispatcherWatchdog::captureLuaStack()
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (!L || lua_gethook(L) != nullptr) {
+		// no state yet, or a hook of someone else
+		return {};
+	}
+
+	luaStackReady.store(false, std::memory_order_relaxed);
+	// lua_sethook may be called from another thread, the hook runs on the next instruction
+	lua_sethook(L, onLuaHook, LUA_MASKCOUNT, 1);
+	waitFor(luaStackReady);
+	if (!luaStackReady.load(std::memory_order_acquire)) {
+		lua_sethook(L, nullptr, 0, 0);
+		return {};
+	}
+
+	std::lock_guard<std::mutex> lockClass(luaStackLock);
+	return luaStack;
+}
+
+void DispatcherWatchdog::setLuaStack(const char* stack)
+{
+	{
+		std::lock_guard<std::mutex> lockClass(luaStackLock);
+		luaStack = stack;
+	}
+	luaStackReady.store(true, std::memory_order_release);
+}
+
+std::string DispatcherWatchdog::captureNativeStack()
+{
+#if defined(__linux__)
+	nativeStackReady.store(false, std::memory_order_relaxed);
+	if (pthread_kill(dispatcherThread, getWatchdogSignal()) != 0) {
+		return "  (signal failed)\n";
+	}
+
+	waitFor(nativeStackReady);
+	if (!nativeStackReady.load(std::memory_order_acquire)) {
+		return "  (no answer from the dispatcher thread)\n";
+	}
+
+	int count = nativeFrameCount.load(std::memory_order_relaxed);
+	std::string stack;
+	if (char** symbols = backtrace_symbols(nativeFrames, count)) {
+		// the first frames are the signal handler
+		for (int i = 2; i < count; ++i) {
+			stack += fmt::format("  #{} {}\n", i - 2, symbols[i]);
+		}
+		free(symbols);
+	}
+	return stack;
+#else
+	return "  (only sampled on Linux)\n";
+#endif
+}
+
+void DispatcherWatchdog::pushActivity(const char* label, std::string_view detail)
+{
+	std::lock_guard<std::mutex> lockClass(activityLock);
+	if (activityCount == MAX_ACTIVITIES) {
+		++droppedActivities;
+		return;
+	}
+
+	Activity& activity = activities[activityCount++];
+	activity.label = label;
+	size_t length = std::min(detail.size(), ACTIVITY_DETAIL_SIZE - 1);
+	memcpy(activity.detail.data(), detail.data(), length);
+	activity.detail[length] = '\0';
+}
+
+void DispatcherWatchdog::popActivity()
+{
+	std::lock_guard<std::mutex> lockClass(activityLock);
+	if (droppedActivities != 0) {
+		--droppedActivities;
+	} else if (activityCount != 0) {
+		--activityCount;
+	}
+}
@@ -0,0 +1,144 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_SCHEDULING_DISPATCHER_WATCHDOG_HPP_
+#define SRC_GAME_SCHEDULING_DISPATCHER_WATCHDOG_HPP_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "utils/thread_holder_base.h"
+
+/**
+ * Thread watching the dispatcher for stalls while they happen.
+ * When the running task passes dispatcherWatchdogTaskThreshold, or the running
+ * cycle dispatcherWatchdogCycleThreshold, a report is appended to
+ * dispatcherWatchdogFile with the origin of the task, the activities it marked
+ * (database queries, saves), the Lua stack if it is inside a script and a
+ * native stack sample of the dispatcher thread (Linux only).
+ * The Lua stack comes from a count hook set from the watchdog thread, the way
+ * lua_sethook allows it, so it only shows up when the task runs Lua code.
+ */
+class DispatcherWatchdog : public ThreadHolder<DispatcherWatchdog>
+{
+	public:
+		DispatcherWatchdog() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		DispatcherWatchdog(const DispatcherWatchdog&) = delete;
+		DispatcherWatchdog& operator=(const DispatcherWatchdog&) = delete;
+
+		static DispatcherWatchdog& getInstance() {
+			// Guaranteed to be destroyed
+			static DispatcherWatchdog instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// dispatcher thread, reads the configuration and starts watching it
+		void start();
+		void shutdown();
+		void threadMain();
+
+		// the activities are only tracked on the dispatcher thread while watching
+		bool isTracking() const {
+			return enabled.load(std::memory_order_acquire) && std::this_thread::get_id() == dispatcherThreadId;
+		}
+		void pushActivity(const char* label, std::string_view detail);
+		void popActivity();
+
+		// dispatcher thread, from the Lua hook
+		void setLuaStack(const char* stack);
+
+	private:
+		static constexpr size_t MAX_ACTIVITIES = 8;
+		static constexpr size_t ACTIVITY_DETAIL_SIZE = 160;
+
+		struct Activity {
+			const char* label = nullptr;
+			std::array<char, ACTIVITY_DETAIL_SIZE> detail {};
+		};
+
+		void check();
+		void report(const char* kind, int64_t runningMillis, int64_t thresholdMillis);
+		std::string captureLuaStack();
+		std::string captureNativeStack();
+
+		std::atomic<bool> enabled {false};
+		std::thread::id dispatcherThreadId;
+		std::string reportFile;
+		int64_t taskThreshold = 0;
+		int64_t cycleThreshold = 0;
+		uint32_t checkInterval = 0;
+
+		std::mutex signalLock;
+		std::condition_variable signal;
+
+		// watchdog thread
+		int64_t reportedTaskStart = 0;
+		int64_t reportedCycleStart = 0;
+		int64_t lastReportTime = 0;
+
+		std::mutex activityLock;
+		std::array<Activity, MAX_ACTIVITIES> activities;
+		size_t activityCount = 0;
+		// pushed past MAX_ACTIVITIES, only counted
+		size_t droppedActivities = 0;
+
+		std::mutex luaStackLock;
+		std::string luaStack;
+		std::atomic<bool> luaStackReady {false};
+};
+
+constexpr auto g_dispatcherWatchdog = &DispatcherWatchdog::getInstance;
+
+/**
+ * Marks what the running dispatcher task is busy with for the watchdog reports,
+ * for calls that may block: database queries, saves. Costs one atomic load
+ * when the watchdog is off.
+ */
+class DispatcherActivity
+{
+	public:
+		explicit DispatcherActivity(const char* label, std::string_view detail = {}) {
+			if (g_dispatcherWatchdog().isTracking()) {
+				g_dispatcherWatchdog().pushActivity(label, detail);
+				tracked = true;
+			}
+		}
+		~DispatcherActivity() {
+			if (tracked) {
+				g_dispatcherWatchdog().popActivity();
+			}
+		}
+
+		DispatcherActivity(const DispatcherActivity&) = delete;
+		DispatcherActivity& operator=(const DispatcherActivity&) = delete;
+
+	private:
+		bool tracked = false;
+};
+
+#endif  // SRC_GAME_SCHEDULING_DISPATCHER_WATCHDOG_HPP_
@@ -0,0 +1,358 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/game.h"
+#include "game/scheduling/input_trace.hpp"
+#include "game/scheduling/scheduler.h"
+#include "server/network/protocol/protocolgame.h"
+
+namespace {
+
+constexpr char TRACE_MAGIC[4] = {'C', 'I', 'T', 'R'};
+constexpr uint16_t TRACE_VERSION = 1;
+// magic, version, seed and client version
+constexpr size_t TRACE_HEADER_SIZE = sizeof(TRACE_MAGIC) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t);
+constexpr size_t TRACE_FLUSH_SIZE = 64 * 1024;
+
+// records fed by one dispatcher task, the game tasks they add run in between
+constexpr uint32_t REPLAY_BATCH_SIZE = 64;
+constexpr uint32_t REPLAY_LOGIN_POLL = 10;
+constexpr int64_t REPLAY_LOGIN_TIMEOUT = 5000;
+
+int64_t getTimeMicros()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+void appendValue(std::vector<uint8_t>& buffer, T value)
+{
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void appendVarint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+	while (value >= 0x80) {
+		buffer.push_back(static_cast<uint8_t>(value) | 0x80);
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+}  // namespace
+
+bool InputTrace::startRecording(const std::string& filename, uint32_t newSeed)
+{
+	recordFile.open(filename, std::ios::binary | std::ios::trunc);
+	if (!recordFile) {
+		SPDLOG_ERROR("[InputTrace::startRecording] - Cannot open {}", filename);
+		return false;
+	}
+
+	seed = newSeed;
+	maxRecordBytes = static_cast<uint64_t>(std::max<int32_t>(1, g_configManager().getNumber(INPUT_TRACE_MAX_SIZE))) * 1024 * 1024;
+
+	recordBuffer.reserve(TRACE_FLUSH_SIZE * 2);
+	recordBuffer.insert(recordBuffer.end(), std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC));
+	appendValue<uint16_t>(recordBuffer, TRACE_VERSION);
+	appendValue<uint32_t>(recordBuffer, seed);
+	appendValue<uint32_t>(recordBuffer, CLIENT_VERSION);
+
+	recording = true;
+	SPDLOG_INFO("Recording the client input to {}, random seed {}", filename, seed);
+	return true;
+}
+
+void InputTrace::stopRecording()
+{
+	if (!recording) {
+		return;
+	}
+
+	flush();
+	recording = false;
+	recordFile.close();
+	SPDLOG_INFO("Input trace closed after {} bytes", recordedBytes);
+}
+
+void InputTrace::recordLogin(ProtocolGame& protocol, const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem)
+{
+	protocol.traceSessionId = ++nextSessionId;
+	beginRecord(RECORD_LOGIN, protocol.traceSessionId);
+	appendValue<uint32_t>(recordBuffer, accountId);
+	appendValue<uint8_t>(recordBuffer, operatingSystem);
+	appendVarint(recordBuffer, name.size());
+	recordBuffer.insert(recordBuffer.end(), name.begin(), name.end());
+}
+
+void InputTrace::recordPacket(const ProtocolGame& protocol, const NetworkMessage& msg)
+{
+	if (protocol.traceSessionId == 0) {
+		return;
+	}
+
+	// the decrypted packet as parsePacket gets it
+	const uint8_t* body = msg.getBuffer() + msg.getBufferPosition();
+	const uint8_t* bodyEnd = msg.getBuffer() + msg.getLength() + NetworkMessage::INITIAL_BUFFER_POSITION;
+	if (body >= bodyEnd) {
+		return;
+	}
+
+	beginRecord(RECORD_PACKET, protocol.traceSessionId);
+	appendVarint(recordBuffer, bodyEnd - body);
+	recordBuffer.insert(recordBuffer.end(), body, bodyEnd);
+	if (recordBuffer.size() >= TRACE_FLUSH_SIZE) {
+		flush();
+	}
+}
+
+void InputTrace::recordDisconnect(const ProtocolGame& protocol)
+{
+	if (protocol.traceSessionId == 0) {
+		return;
+	}
+
+	beginRecord(RECORD_DISCONNECT, protocol.traceSessionId);
+	if (recordBuffer.size() >= TRACE_FLUSH_SIZE) {
+		flush();
+	}
+}
+
+void InputTrace::beginRecord(RecordType_t type, uint32_t sessionId)
+{
+	int64_t now = getTimeMicros();
+	recordBuffer.push_back(type);
+	appendVarint(recordBuffer, lastRecordTime != 0 ? now - lastRecordTime : 0);
+	appendVarint(recordBuffer, sessionId);
+	lastRecordTime = now;
+}
+
+void InputTrace::flush()
+{
+	if (recordBuffer.empty()) {
+		return;
+	}
+
+	recordFile.write(reinterpret_cast<const char*>(recordBuffer.data()), recordBuffer.size());
+	recordedBytes += recordBuffer.size();
+	recordBuffer.clear();
+
+	if (!recordFile) {
+		SPDLOG_ERROR("[InputTrace::flush] - Write failed, the recording stops");
+		recording = false;
+	} else if (recordedBytes >= maxRecordBytes) {
+		SPDLOG_WARN("[InputTrace::flush] - The trace reached inputTraceMaxSize, the recording stops");
+		stopRecording();
+	}
+}
+
+bool InputTrace::openReplay(const std::string& filename, double speed)
+{
+	try {
+		replayFile.open(filename);
+	} catch (const std::exception& e) {
+		SPDLOG_ERROR("[InputTrace::openReplay] - Cannot open {}: {}", filename, e.what());
+		return false;
+	}
+
+	const char* data = replayFile.data();
+	uint16_t version;
+	uint32_t clientVersion;
+	if (replayFile.size() < TRACE_HEADER_SIZE || memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+		SPDLOG_ERROR("[InputTrace::openReplay] - {} is not an input trace", filename);
+		replayFile.close();
+		return false;
+	}
+
+	memcpy(&version, data + 4, sizeof(version));
+	memcpy(&seed, data + 6, sizeof(seed));
+	memcpy(&clientVersion, data + 10, sizeof(clientVersion));
+	if (version != TRACE_VERSION || clientVersion != CLIENT_VERSION) {
+		SPDLOG_ERROR("[InputTrace::openReplay] - {} was recorded by another version (trace {}, protocol {})", filename, version, clientVersion);
+		replayFile.close();
+		return false;
+	}
+
+	replayPosition = TRACE_HEADER_SIZE;
+	replaySpeed = std::max(0., speed);
+	replaying = true;
+	return true;
+}
+
+void InputTrace::startReplay()
+{
+	SPDLOG_INFO("Replaying {} bytes of input trace at {}", replayFile.size(), replaySpeed > 0 ? fmt::format("{}x the recorded speed", replaySpeed) : "full speed");
+	replayStart = getTimeMicros();
+	replayClockStart = replayStart;
+	g_dispatcher().addTask(createTask(std::bind(&InputTrace::replayNext, this)));
+}
+
+bool InputTrace::readVarint(uint64_t& value)
+{
+	const auto* data = reinterpret_cast<const uint8_t*>(replayFile.data());
+	value = 0;
+	for (uint32_t shift = 0; shift < 64 && replayPosition < replayFile.size(); shift += 7) {
+		uint8_t byte = data[replayPosition++];
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool InputTrace::readBytes(size_t length, const uint8_t*& bytes)
+{
+	if (length > replayFile.size() - replayPosition) {
+		return false;
+	}
+
+	bytes = reinterpret_cast<const uint8_t*>(replayFile.data()) + replayPosition;
+	replayPosition += length;
+	return true;
+}
+
+void InputTrace::replayNext()
+{
+	// dispatcher thread
+	if (g_game().getGameState() == GAME_STATE_SHUTDOWN) {
+		return;
+	}
+
+	if (pendingLogin) {
+		if (!pendingLogin->acceptPackets && OTSYS_TIME() < pendingLoginDeadline) {
+			// the player is still loading, the wait is left out of the trace timing
+			replayClockStart += REPLAY_LOGIN_POLL * 1000;
+			g_scheduler().addEvent(createSchedulerTask(REPLAY_LOGIN_POLL, std::bind(&InputTrace::replayNext, this)));
+			return;
+		}
+		pendingLogin.reset();
+	}
+
+	for (uint32_t fed = 0; fed < REPLAY_BATCH_SIZE; ++fed) {
+		if (replayPosition >= replayFile.size()) {
+			finishReplay("end of the trace");
+			return;
+		}
+
+		size_t recordStart = replayPosition;
+		const uint8_t type = static_cast<uint8_t>(replayFile.data()[replayPosition++]);
+		uint64_t delay;
+		uint64_t sessionId;
+		if (!readVarint(delay) || !readVarint(sessionId)) {
+			finishReplay("truncated record");
+			return;
+		}
+
+		if (replaySpeed > 0) {
+			int64_t due = replayClockStart + static_cast<int64_t>((replayTime + delay) / replaySpeed);
+			int64_t now = getTimeMicros();
+			if (due > now) {
+				// read again once it is due
+				replayPosition = recordStart;
+				g_scheduler().addEvent(createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, (due - now) / 1000), std::bind(&InputTrace::replayNext, this)));
+				return;
+			}
+		}
+		replayTime += delay;
+
+		switch (type) {
+			case RECORD_LOGIN: {
+				const uint8_t* fields;
+				uint64_t nameLength;
+				const uint8_t* name;
+				if (!readBytes(sizeof(uint32_t) + sizeof(uint8_t), fields) || !readVarint(nameLength) || !readBytes(nameLength, name)) {
+					finishReplay("truncated login");
+					return;
+				}
+
+				uint32_t accountId;
+				memcpy(&accountId, fields, sizeof(accountId));
+				auto operatingSystem = static_cast<OperatingSystem_t>(fields[sizeof(accountId)]);
+
+				auto protocol = std::make_shared<ProtocolGame>(nullptr);
+				replaySessions[sessionId] = protocol;
+				protocol->login(std::string(reinterpret_cast<const char*>(name), nameLength), accountId, operatingSystem);
+				++replayedLogins;
+
+				// the recorded packets of the session came once the player was in
+				pendingLogin = protocol;
+				pendingLoginDeadline = OTSYS_TIME() + REPLAY_LOGIN_TIMEOUT;
+				g_dispatcher().addTask(createTask(std::bind(&InputTrace::replayNext, this)));
+				return;
+			}
+
+			case RECORD_PACKET: {
+				uint64_t length;
+				const uint8_t* body;
+				if (!readVarint(length) || !readBytes(length, body)) {
+					finishReplay("truncated packet");
+					return;
+				}
+
+				auto it = replaySessions.find(sessionId);
+				if (it == replaySessions.end() || length > NETWORKMESSAGE_MAXSIZE - NetworkMessage::INITIAL_BUFFER_POSITION) {
+					break;
+				}
+
+				NetworkMessage msg;
+				msg.addBytes(reinterpret_cast<const char*>(body), length);
+				msg.setBufferPosition(NetworkMessage::INITIAL_BUFFER_POSITION);
+				it->second->parsePacket(msg);
+				++replayedPackets;
+				break;
+			}
+
+			case RECORD_DISCONNECT: {
+				auto it = replaySessions.find(sessionId);
+				if (it != replaySessions.end()) {
+					it->second->release();
+					replaySessions.erase(it);
+				}
+				break;
+			}
+
+			default:
+				finishReplay("unknown record");
+				return;
+		}
+	}
+
+	g_dispatcher().addTask(createTask(std::bind(&InputTrace::replayNext, this)));
+}
+
+void InputTrace::finishReplay(const char* reason)
+{
+	int64_t elapsed = getTimeMicros() - replayStart;
+	SPDLOG_INFO("Replay finished ({}): {} logins and {} packets in {:.1f}s, {:.1f}s of recorded time",
+				reason, replayedLogins, replayedPackets, elapsed / 1000000., replayTime / 1000000.);
+
+	for (auto& [sessionId, protocol] : replaySessions) {
+		protocol->release();
+	}
+	replaySessions.clear();
+	pendingLogin.reset();
+	replayFile.close();
+
+	g_game().setGameState(GAME_STATE_SHUTDOWN);
+}
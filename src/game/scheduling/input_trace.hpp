@@ -0,0 +1,136 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_GAME_SCHEDULING_INPUT_TRACE_HPP_
+#define SRC_GAME_SCHEDULING_INPUT_TRACE_HPP_
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <parallel_hashmap/phmap.h>
+
+#include "creatures/creatures_definitions.hpp"
+
+class NetworkMessage;
+class ProtocolGame;
+
+/**
+ * Recording of the client input reaching the dispatcher, for replays of real
+ * traffic on a dev box. The trace holds the random seed the server ran with,
+ * then the logins, decrypted packets and disconnects of every game session
+ * with the microseconds since the previous record.
+ *
+ * The replay (--replay=<file>) starts the server without the client ports and
+ * feeds the records to sessions without a connection, through the same
+ * ProtocolGame::login and parsePacket the network uses; the messages built for
+ * them are dropped. Scheduler events are not recorded, the game schedules them
+ * again from the same input. The replay follows the recorded timing scaled by
+ * --replay-speed, 0 = as fast as the dispatcher takes the packets, and shuts the
+ * server down when the trace ends. Creature ids in the packets refer to the
+ * recorded run, they only match while the logins and spawns happen in the same order.
+ */
+class InputTrace
+{
+	public:
+		InputTrace() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		InputTrace(const InputTrace&) = delete;
+		InputTrace& operator=(const InputTrace&) = delete;
+
+		static InputTrace& getInstance() {
+			// Guaranteed to be destroyed
+			static InputTrace instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// dispatcher thread, the recording functions are only called while recording
+		bool startRecording(const std::string& filename, uint32_t seed);
+		void stopRecording();
+		bool isRecording() const {
+			return recording;
+		}
+
+		void recordLogin(ProtocolGame& protocol, const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem);
+		void recordPacket(const ProtocolGame& protocol, const NetworkMessage& msg);
+		void recordDisconnect(const ProtocolGame& protocol);
+
+		// reads the header, before the modules are loaded
+		bool openReplay(const std::string& filename, double speed);
+		// from the opening of the trace to the shutdown, also once it is consumed
+		bool isReplaying() const {
+			return replaying;
+		}
+		uint32_t getSeed() const {
+			return seed;
+		}
+		// dispatcher thread, once the game is running
+		void startReplay();
+
+	private:
+		enum RecordType_t : uint8_t {
+			RECORD_LOGIN = 1,
+			RECORD_PACKET = 2,
+			RECORD_DISCONNECT = 3,
+		};
+
+		void beginRecord(RecordType_t type, uint32_t sessionId);
+		void flush();
+
+		void replayNext();
+		bool readVarint(uint64_t& value);
+		bool readBytes(size_t length, const uint8_t*& bytes);
+		void finishReplay(const char* reason);
+
+		uint32_t seed = 0;
+
+		// recording
+		bool recording = false;
+		std::ofstream recordFile;
+		std::vector<uint8_t> recordBuffer;
+		uint64_t recordedBytes = 0;
+		uint64_t maxRecordBytes = 0;
+		int64_t lastRecordTime = 0;
+		uint32_t nextSessionId = 0;
+
+		// replay
+		bool replaying = false;
+		boost::iostreams::mapped_file_source replayFile;
+		size_t replayPosition = 0;
+		double replaySpeed = 0;
+		int64_t replayStart = 0;
+		// start of the trace timeline, moved forward by the waits for the logins
+		int64_t replayClockStart = 0;
+		uint64_t replayTime = 0;
+		uint64_t replayedPackets = 0;
+		uint64_t replayedLogins = 0;
+		phmap::flat_hash_map<uint32_t, std::shared_ptr<ProtocolGame>> replaySessions;
+		// packets of a session wait until its player finished loading
+		std::shared_ptr<ProtocolGame> pendingLogin;
+		int64_t pendingLoginDeadline = 0;
+};
+
+constexpr auto g_inputTrace = &InputTrace::getInstance;
+
+#endif  // SRC_GAME_SCHEDULING_INPUT_TRACE_HPP_
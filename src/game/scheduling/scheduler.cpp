@@ -19,47 +19,46 @@
 
 #include "pch.hpp"
 
+#include "game/scheduling/dispatcher_governor.hpp"
 #include "game/scheduling/scheduler.h"
 
 void Scheduler::threadMain()
 {
+	std::vector<TimingWheelNode*> expired;
 	std::unique_lock<std::mutex> eventLockUnique(eventLock, std::defer_lock);
 	while (getState() != THREAD_STATE_TERMINATED) {
-		std::cv_status ret = std::cv_status::no_timeout;
-
 		eventLockUnique.lock();
-		if (eventList.empty()) {
+		if (eventWheel.empty()) {
+			wakeupTick = std::numeric_limits<int64_t>::max();
 			eventSignal.wait(eventLockUnique);
 		} else {
-			ret = eventSignal.wait_until(eventLockUnique, eventList.top()->getCycle());
+			wakeupTick = eventWheel.getNextTick();
+			eventSignal.wait_until(eventLockUnique, std::chrono::steady_clock::time_point(std::chrono::milliseconds(wakeupTick)));
 		}
 
 		// the mutex is locked again now...
-		if (ret == std::cv_status::timeout && !eventList.empty()) {
-			// ok we had a timeout, so there has to be an event we have to execute...
-			SchedulerTask* task = eventList.top();
-			eventList.pop();
-
-			// check if the event was stopped
-			auto it = eventIds.find(task->getEventId());
-			if (it == eventIds.end()) {
-				eventLockUnique.unlock();
-				delete task;
-				continue;
-			}
-			eventIds.erase(it);
-			eventLockUnique.unlock();
+		eventWheel.advance(toTick(std::chrono::steady_clock::now()), expired);
+		for (TimingWheelNode* node : expired) {
+			eventIds.erase(static_cast<SchedulerTask*>(node)->getEventId());
+		}
+		eventLockUnique.unlock();
 
+		// stopped events are removed from the wheel, everything here has to run
+		for (TimingWheelNode* node : expired) {
+			auto task = static_cast<SchedulerTask*>(node);
 			task->setDontExpire();
 			g_dispatcher().addTask(task, true);
-		} else {
-			eventLockUnique.unlock();
 		}
+		expired.clear();
 	}
 }
 
 uint32_t Scheduler::addEvent(SchedulerTask* task)
 {
+	if (task->getPriority() != TASK_PRIORITY_NORMAL) {
+		task->stretchDelay(g_dispatcherGovernor().getDelayFactor(task->getPriority()));
+	}
+
 	bool do_signal;
 	eventLock.lock();
 
@@ -74,15 +73,22 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 			task->setEventId(lastEventId);
 		}
 
-		// insert the event id in the list of active events
-		eventIds.insert(task->getEventId());
+		// an event with the same id replaces the pending one
+		auto it = eventIds.find(task->getEventId());
+		if (it != eventIds.end()) {
+			eventWheel.remove(it->second);
+			delete it->second;
+			it->second = task;
+		} else {
+			eventIds.emplace(task->getEventId(), task);
+		}
 
-		// add the event to the queue
-		eventList.push(task);
+		// add the event to the wheel
+		int64_t tick = toTick(task->getCycle());
+		eventWheel.insert(task, tick);
 
-		// if the list was empty or this event is the top in the list
-		// we have to signal it
-		do_signal = (task == eventList.top());
+		// if the scheduler sleeps past this event we have to signal it
+		do_signal = (tick < wakeupTick);
 	} else {
 		eventLock.unlock();
 		delete task;
@@ -98,41 +104,56 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 	return task->getEventId();
 }
 
+size_t Scheduler::getPendingEvents()
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	return eventIds.size();
+}
+
 bool Scheduler::stopEvent(uint32_t eventid)
 {
 	if (eventid == 0) {
 		return false;
 	}
 
-	std::lock_guard<std::mutex> lockClass(eventLock);
+	SchedulerTask* task;
+	{
+		std::lock_guard<std::mutex> lockClass(eventLock);
 
-	// search the event id..
-	auto it = eventIds.find(eventid);
-	if (it == eventIds.end()) {
-		return false;
+		// search the event id..
+		auto it = eventIds.find(eventid);
+		if (it == eventIds.end()) {
+			return false;
+		}
+
+		task = it->second;
+		eventIds.erase(it);
+		eventWheel.remove(task);
 	}
 
-	eventIds.erase(it);
+	delete task;
 	return true;
 }
 
 void Scheduler::shutdown()
 {
 	setState(THREAD_STATE_TERMINATED);
+
+	std::vector<TimingWheelNode*> pending;
 	eventLock.lock();
 
 	//this list should already be empty
-	while (!eventList.empty()) {
-		delete eventList.top();
-		eventList.pop();
-	}
-
+	eventWheel.clear(pending);
 	eventIds.clear();
 	eventLock.unlock();
 	eventSignal.notify_one();
+
+	for (TimingWheelNode* node : pending) {
+		delete static_cast<SchedulerTask*>(node);
+	}
 }
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f)
+SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunction f, const char* origin /*= __builtin_FUNCTION()*/)
 {
-	return new SchedulerTask(delay, std::move(f));
+	return new SchedulerTask(delay, std::move(f), origin);
 }
@@ -21,11 +21,12 @@
 #define SRC_GAME_SCHEDULING_SCHEDULER_H_
 
 #include "game/scheduling/tasks.h"
+#include "game/scheduling/timing_wheel.hpp"
 #include "utils/thread_holder_base.h"
 
 static constexpr int32_t SCHEDULER_MINTICKS = 50;
 
-class SchedulerTask : public Task
+class SchedulerTask : public Task, public TimingWheelNode
 {
 	public:
 		void setEventId(uint32_t id) {
@@ -35,25 +36,44 @@ class SchedulerTask : public Task
 			return eventId;
 		}
 
-		std::chrono::system_clock::time_point getCycle() const {
+		std::chrono::steady_clock::time_point getCycle() const {
 			return expiration;
 		}
 
+		// multiplies what is left of the delay
+		void stretchDelay(uint32_t factor) {
+			auto now = std::chrono::steady_clock::now();
+			if (factor > 1 && expiration > now) {
+				expiration = now + (expiration - now) * factor;
+			}
+		}
+
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_TASK, size);
+			if (size != sizeof(SchedulerTask)) {
+				return ::operator new(size);
+			}
+			return LockfreePoolingAllocator<SchedulerTask, TASK_FREE_LIST_CAPACITY>().allocate(1);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_TASK, size);
+			if (size != sizeof(SchedulerTask)) {
+				::operator delete(p);
+				return;
+			}
+			LockfreePoolingAllocator<SchedulerTask, TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<SchedulerTask*>(p), 1);
+		}
+
 	private:
-		SchedulerTask(uint32_t delay, std::function<void (void)>&& f) : Task(delay, std::move(f)) {}
+		SchedulerTask(uint32_t delay, TaskFunction&& f, const char* origin) : Task(delay, std::move(f), origin) {}
 
 		uint32_t eventId = 0;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, std::function<void (void)>);
+		friend SchedulerTask* createSchedulerTask(uint32_t, TaskFunction, const char*);
 };
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f);
-
-struct TaskComparator {
-	bool operator()(const SchedulerTask* lhs, const SchedulerTask* rhs) const {
-		return lhs->getCycle() > rhs->getCycle();
-	}
-};
+// origin defaults to the name of the calling function
+SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunction f, const char* origin = __builtin_FUNCTION());
 
 class Scheduler : public ThreadHolder<Scheduler>
 {
@@ -72,19 +92,30 @@ class Scheduler : public ThreadHolder<Scheduler>
 
 		uint32_t addEvent(SchedulerTask* task);
 		bool stopEvent(uint32_t eventId);
+		size_t getPendingEvents();
 
 		void shutdown();
 
 		void threadMain();
 
+		std::thread::native_handle_type getNativeHandle() {
+			return thread.native_handle();
+		}
+
 	private:
 		std::thread thread;
 		std::mutex eventLock;
 		std::condition_variable eventSignal;
 
+		static int64_t toTick(std::chrono::steady_clock::time_point time) {
+			return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+		}
+
 		uint32_t lastEventId {0};
-		std::priority_queue<SchedulerTask*, std::deque<SchedulerTask*>, TaskComparator> eventList;
-		phmap::flat_hash_set<uint32_t> eventIds;
+		// tick the scheduler thread is sleeping until, addEvent only wakes it for earlier events
+		int64_t wakeupTick = std::numeric_limits<int64_t>::max();
+		TimingWheel eventWheel {toTick(std::chrono::steady_clock::now())};
+		phmap::flat_hash_map<uint32_t, SchedulerTask*> eventIds;
 };
 
 constexpr auto g_scheduler = &Scheduler::getInstance;
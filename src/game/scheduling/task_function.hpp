@@ -0,0 +1,128 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_GAME_SCHEDULING_TASK_FUNCTION_HPP_
+#define SRC_GAME_SCHEDULING_TASK_FUNCTION_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Move-only void() callable with inline storage.
+ * Lambdas and std::bind results up to TASK_FUNCTION_INLINE_SIZE bytes are
+ * stored inside the object, bigger ones fall back to the heap.
+ */
+static constexpr size_t TASK_FUNCTION_INLINE_SIZE = 64;
+
+class TaskFunction
+{
+	public:
+		TaskFunction() = default;
+
+		template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskFunction>::value>::type>
+		TaskFunction(F&& f) {
+			using Fn = typename std::decay<F>::type;
+			if constexpr (fitsInline<Fn>()) {
+				new (&storage) Fn(std::forward<F>(f));
+				ops = &inlineOps<Fn>;
+			} else {
+				*reinterpret_cast<Fn**>(&storage) = new Fn(std::forward<F>(f));
+				ops = &heapOps<Fn>;
+			}
+		}
+
+		TaskFunction(TaskFunction&& other) noexcept {
+			moveFrom(other);
+		}
+
+		TaskFunction& operator=(TaskFunction&& other) noexcept {
+			if (this != &other) {
+				reset();
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		// non-copyable
+		TaskFunction(const TaskFunction&) = delete;
+		TaskFunction& operator=(const TaskFunction&) = delete;
+
+		~TaskFunction() {
+			reset();
+		}
+
+		void operator()() {
+			ops->invoke(&storage);
+		}
+
+		explicit operator bool() const {
+			return ops != nullptr;
+		}
+
+	private:
+		struct Ops {
+			void (*invoke)(void*);
+			void (*relocate)(void* from, void* to);
+			void (*destroy)(void*);
+		};
+
+		template <typename Fn>
+		static constexpr bool fitsInline() {
+			return sizeof(Fn) <= TASK_FUNCTION_INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<Fn>::value;
+		}
+
+		template <typename Fn>
+		static constexpr Ops inlineOps = {
+			[](void* p) { (*static_cast<Fn*>(p))(); },
+			[](void* from, void* to) {
+				new (to) Fn(std::move(*static_cast<Fn*>(from)));
+				static_cast<Fn*>(from)->~Fn();
+			},
+			[](void* p) { static_cast<Fn*>(p)->~Fn(); }
+		};
+
+		template <typename Fn>
+		static constexpr Ops heapOps = {
+			[](void* p) { (**static_cast<Fn**>(p))(); },
+			[](void* from, void* to) { *static_cast<Fn**>(to) = *static_cast<Fn**>(from); },
+			[](void* p) { delete *static_cast<Fn**>(p); }
+		};
+
+		void moveFrom(TaskFunction& other) {
+			ops = other.ops;
+			if (ops) {
+				ops->relocate(&other.storage, &storage);
+				other.ops = nullptr;
+			}
+		}
+
+		void reset() {
+			if (ops) {
+				ops->destroy(&storage);
+				ops = nullptr;
+			}
+		}
+
+		const Ops* ops = nullptr;
+		typename std::aligned_storage<TASK_FUNCTION_INLINE_SIZE, alignof(std::max_align_t)>::type storage;
+};
+
+#endif  // SRC_GAME_SCHEDULING_TASK_FUNCTION_HPP_
@@ -20,76 +20,134 @@
 #include "pch.hpp"
 
 #include "game/game.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
 #include "game/scheduling/tasks.h"
+#include "lua/scripts/lua_garbage_collector.hpp"
+#include "server/metrics/metrics.hpp"
+#include "utils/game_clock.hpp"
 
-Task* createTask(std::function<void (void)> f)
+namespace {
+
+MetricCounter& tasksAdded = g_metrics().getCounter("canary_dispatcher_tasks_added_total", "Tasks added to the dispatcher");
+MetricCounter& tasksRun = g_metrics().getCounter("canary_dispatcher_tasks_run_total", "Tasks taken from the dispatcher queues, expired ones included");
+MetricHistogram& cycleTime = g_metrics().getHistogram("canary_dispatcher_cycle_seconds", "Time the dispatcher spends on the tasks it takes at once after waking up or between batches",
+	{100, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000});
+
+}  // namespace
+
+Task* createTask(TaskFunction f, const char* origin /*= __builtin_FUNCTION()*/)
 {
-	return new Task(std::move(f));
+	return new Task(std::move(f), origin);
 }
 
-Task* createTask(uint32_t expiration, std::function<void (void)> f)
+Task* createTask(uint32_t expiration, TaskFunction f, const char* origin /*= __builtin_FUNCTION()*/)
 {
-	return new Task(expiration, std::move(f));
+	return new Task(expiration, std::move(f), origin);
 }
 
 void Dispatcher::threadMain()
 {
-	// NOTE: second argument defer_lock is to prevent from immediate locking
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	batch.reserve(DISPATCHER_BATCH_SIZE);
 
 	while (getState() != THREAD_STATE_TERMINATED) {
-		// check if there are tasks waiting
-		taskLockUnique.lock();
+		if (!hasPendingTasks()) {
+			// the queue ran empty, collect Lua garbage before going to sleep
+			g_luaGarbageCollector().runIdleSteps([this]() { return hasPendingTasks(); });
+		}
 
-		if (taskList.empty()) {
-			//if the list is empty wait for signal
-			taskSignal.wait(taskLockUnique);
+		if (!hasPendingTasks()) {
+			// announce that we are going to sleep before the last emptiness check,
+			// producers that see the flag take the lock to wake us up
+			std::unique_lock<std::mutex> taskLockUnique(taskLock);
+			sleeping.store(true, std::memory_order_seq_cst);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			taskSignal.wait(taskLockUnique, [this]() {
+				return hasPendingTasks() || getState() == THREAD_STATE_TERMINATED;
+			});
+			sleeping.store(false, std::memory_order_relaxed);
 		}
 
-		if (!taskList.empty()) {
-			// take the first task
-			Task* task = taskList.front();
-			taskList.pop_front();
-			taskLockUnique.unlock();
+		auto cycleStartTime = std::chrono::steady_clock::now();
+		cycleStart.store(cycleStartTime.time_since_epoch().count(), std::memory_order_relaxed);
+		// scheduler tasks jump the queue like push_front used to
+		while (Task* task = priorityTasks.pop()) {
+			runTask(task);
+		}
 
-			if (!task->hasExpired()) {
-				++dispatcherCycle;
-				// execute it
-				(*task)();
+		while (batch.size() < DISPATCHER_BATCH_SIZE) {
+			Task* task = tasks.pop();
+			if (!task) {
+				break;
 			}
-			delete task;
+			batch.push_back(task);
+		}
+
+		for (Task* task : batch) {
+			runTask(task);
+		}
+		batch.clear();
+		cycleStart.store(0, std::memory_order_relaxed);
+		cycleTime.observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cycleStartTime).count());
+	}
+}
+
+void Dispatcher::runTask(Task* task)
+{
+	tasksRun.add();
+	// one clock read per task, OTSYS_TIME returns this value until the next one
+	GameClock::update();
+	if (!task->hasExpired(GameClock::getTime())) {
+		dispatcherCycle.store(dispatcherCycle.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		runningOrigin.store(task->getOrigin(), std::memory_order_relaxed);
+		taskStart.store(GameClock::getTime().time_since_epoch().count(), std::memory_order_release);
+		if (g_dispatcherProfiler().isEnabled()) {
+			int64_t start = DispatcherProfiler::getTimeMicros();
+			// execute it
+			(*task)();
+			int64_t queuedTime = task->getQueuedTime();
+			g_dispatcherProfiler().record(task->getOrigin(), queuedTime != 0 ? start - queuedTime : -1, DispatcherProfiler::getTimeMicros() - start);
 		} else {
-			taskLockUnique.unlock();
+			// execute it
+			(*task)();
 		}
+		taskStart.store(0, std::memory_order_relaxed);
 	}
+	delete task;
 }
 
 void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
 {
-	bool do_signal = false;
-
-	taskLock.lock();
+	if (getState() != THREAD_STATE_RUNNING) {
+		delete task;
+		return;
+	}
 
-	if (getState() == THREAD_STATE_RUNNING) {
-		do_signal = taskList.empty();
+	if (g_dispatcherProfiler().isEnabled()) {
+		task->setQueuedTime(DispatcherProfiler::getTimeMicros());
+	}
 
-		if (push_front) {
-			taskList.push_front(task);
-		} else {
-			taskList.push_back(task);
-		}
+	tasksAdded.add();
+	if (push_front) {
+		priorityTasks.push(task);
 	} else {
-		delete task;
+		tasks.push(task);
 	}
 
-	taskLock.unlock();
-
-	// send a signal if the list was empty
-	if (do_signal) {
+	// send a signal if the dispatcher is (or is about to be) waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_seq_cst)) {
+		std::lock_guard<std::mutex> lockClass(taskLock);
 		taskSignal.notify_one();
 	}
 }
 
+int64_t Dispatcher::getPendingTasks() const
+{
+	// the two sums are not one snapshot, run is read first so it rarely gets ahead
+	uint64_t run = tasksRun.get();
+	return std::max<int64_t>(0, static_cast<int64_t>(tasksAdded.get() - run));
+}
+
 void Dispatcher::shutdown()
 {
 	Task* task = createTask([this]() {
@@ -97,8 +155,8 @@ void Dispatcher::shutdown()
 		taskSignal.notify_one();
 	});
 
-	std::lock_guard<std::mutex> lockClass(taskLock);
-	taskList.push_back(task);
+	tasks.push(task);
 
+	std::lock_guard<std::mutex> lockClass(taskLock);
 	taskSignal.notify_one();
 }
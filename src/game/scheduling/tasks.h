@@ -20,47 +20,102 @@
 #ifndef SRC_GAME_SCHEDULING_TASKS_H_
 #define SRC_GAME_SCHEDULING_TASKS_H_
 
+#include "game/scheduling/task_function.hpp"
+#include "utils/lockfree.h"
+#include "utils/memory_accounting.hpp"
 #include "utils/thread_holder_base.h"
 
 const int DISPATCHER_TASK_EXPIRATION = 2000;
-const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
+// maximum number of tasks taken from the normal lane before the priority lane is checked again
+const size_t DISPATCHER_BATCH_SIZE = 256;
+// number of freed Task/SchedulerTask blocks kept for reuse
+const size_t TASK_FREE_LIST_CAPACITY = 8192;
+
+// see DispatcherGovernor
+enum TaskPriority_t : uint8_t {
+	TASK_PRIORITY_NORMAL,
+	// background work, its scheduler events are pushed back while the dispatcher lags
+	TASK_PRIORITY_LOW,
+};
 
-class Task
+class Task : public LockfreeMPSCNode
 {
 	public:
 		// DO NOT allocate this class on the stack
-		explicit Task(std::function<void (void)>&& f) : func(std::move(f)) {}
-		Task(uint32_t ms, std::function<void (void)>&& f) :
-			expiration(std::chrono::system_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)) {}
+		Task(TaskFunction&& f, const char* origin) : func(std::move(f)), origin(origin) {}
+		Task(uint32_t ms, TaskFunction&& f, const char* origin) :
+			expiration(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)), origin(origin) {}
 
 		virtual ~Task() = default;
+
+		// tasks are created and destroyed at a very high rate, recycle their memory
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_TASK, size);
+			if (size != sizeof(Task)) {
+				return ::operator new(size);
+			}
+			return LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().allocate(1);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_TASK, size);
+			if (size != sizeof(Task)) {
+				::operator delete(p);
+				return;
+			}
+			LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<Task*>(p), 1);
+		}
+
 		void operator()() {
 			func();
 		}
 
 		void setDontExpire() {
-			expiration = SYSTEM_TIME_ZERO;
+			expiration = {};
 		}
 
-		bool hasExpired() const {
-			if (expiration == SYSTEM_TIME_ZERO) {
+		bool hasExpired(std::chrono::steady_clock::time_point now) const {
+			if (expiration == std::chrono::steady_clock::time_point()) {
 				return false;
 			}
-			return expiration < std::chrono::system_clock::now();
+			return expiration < now;
+		}
+
+		// function that created the task, used by the dispatcher profiler
+		const char* getOrigin() const {
+			return origin;
+		}
+
+		int64_t getQueuedTime() const {
+			return queuedTime;
+		}
+		void setQueuedTime(int64_t time) {
+			queuedTime = time;
+		}
+
+		TaskPriority_t getPriority() const {
+			return priority;
+		}
+		void setPriority(TaskPriority_t newPriority) {
+			priority = newPriority;
 		}
 
 	protected:
-		std::chrono::system_clock::time_point expiration = SYSTEM_TIME_ZERO;
+		// steady clock, wall clock corrections do not reorder the tasks
+		std::chrono::steady_clock::time_point expiration {};
 
 	private:
 		// Expiration has another meaning for scheduler tasks,
 		// then it is the time the task should be added to the
 		// dispatcher
-		std::function<void (void)> func;
+		TaskFunction func;
+		const char* origin;
+		int64_t queuedTime = 0;
+		TaskPriority_t priority = TASK_PRIORITY_NORMAL;
 };
 
-Task* createTask(std::function<void (void)> f);
-Task* createTask(uint32_t expiration, std::function<void (void)> f);
+// origin defaults to the name of the calling function
+Task* createTask(TaskFunction f, const char* origin = __builtin_FUNCTION());
+Task* createTask(uint32_t expiration, TaskFunction f, const char* origin = __builtin_FUNCTION());
 
 class Dispatcher : public ThreadHolder<Dispatcher> {
 	public:
@@ -81,17 +136,47 @@ class Dispatcher : public ThreadHolder<Dispatcher> {
 		void shutdown();
 
 		uint64_t getDispatcherCycle() const {
-			return dispatcherCycle;
+			return dispatcherCycle.load(std::memory_order_relaxed);
+		}
+
+		// read by the DispatcherWatchdog from its own thread,
+		// steady clock ticks when the running task and cycle started, 0 = none running
+		int64_t getTaskStart() const {
+			return taskStart.load(std::memory_order_acquire);
+		}
+		int64_t getCycleStart() const {
+			return cycleStart.load(std::memory_order_relaxed);
 		}
+		const char* getRunningOrigin() const {
+			return runningOrigin.load(std::memory_order_relaxed);
+		}
+
+		// tasks added and not run yet, any thread
+		int64_t getPendingTasks() const;
 
 		void threadMain();
 
 	private:
+		void runTask(Task* task);
+
+		bool hasPendingTasks() const {
+			return !priorityTasks.empty() || !tasks.empty();
+		}
+
+		// only the sleeping dispatcher thread and the producer waking it touch these
 		std::mutex taskLock;
 		std::condition_variable taskSignal;
-
-		std::list<Task*> taskList;
-		uint64_t dispatcherCycle = 0;
+		std::atomic<bool> sleeping {false};
+
+		// push_front tasks (scheduler events) go to their own lane, drained first
+		LockfreeMPSCQueue<Task> priorityTasks;
+		LockfreeMPSCQueue<Task> tasks;
+		std::vector<Task*> batch;
+		// only the dispatcher thread writes these
+		std::atomic<uint64_t> dispatcherCycle {0};
+		std::atomic<int64_t> taskStart {0};
+		std::atomic<int64_t> cycleStart {0};
+		std::atomic<const char*> runningOrigin {nullptr};
 };
 
 constexpr auto g_dispatcher = &Dispatcher::getInstance;
@@ -0,0 +1,172 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pch.hpp"
+
+#include "game/scheduling/timing_wheel.hpp"
+
+void TimingWheel::insert(TimingWheelNode* node, int64_t expiration)
+{
+	node->wheelExpiration = expiration;
+	link(node);
+	++count;
+}
+
+void TimingWheel::remove(TimingWheelNode* node)
+{
+	if (!node->isLinked()) {
+		return;
+	}
+
+	unlink(node);
+	--count;
+}
+
+void TimingWheel::advance(int64_t now, std::vector<TimingWheelNode*>& expired)
+{
+	while (count != 0 && currentTick <= now) {
+		int64_t index = currentTick & ROOT_MASK;
+		if (index == 0) {
+			// the first level wrapped, pull the next slot of the upper levels down
+			for (int level = 0; level < LEVELS; ++level) {
+				if (cascade(level, levelIndex(currentTick, level)) != 0) {
+					break;
+				}
+			}
+		}
+
+		++currentTick;
+
+		TimingWheelNode* node = root[index];
+		while (node) {
+			TimingWheelNode* next = node->wheelNext;
+			unlink(node);
+			--count;
+			expired.push_back(node);
+			node = next;
+		}
+	}
+
+	// nothing left to expire, skip the idle ticks
+	if (count == 0 && currentTick <= now) {
+		currentTick = now + 1;
+	}
+}
+
+int64_t TimingWheel::getNextTick() const
+{
+	for (int64_t i = 0; i < ROOT_SIZE; ++i) {
+		int64_t tick = currentTick + i;
+		int64_t index = tick & ROOT_MASK;
+		if (index == 0 || root[index]) {
+			return tick;
+		}
+	}
+	return currentTick + ROOT_SIZE;
+}
+
+void TimingWheel::clear(std::vector<TimingWheelNode*>& removed)
+{
+	auto drain = [&removed](TimingWheelNode*& head) {
+		while (head) {
+			TimingWheelNode* node = head;
+			unlink(node);
+			removed.push_back(node);
+		}
+	};
+
+	for (TimingWheelNode*& head : root) {
+		drain(head);
+	}
+
+	for (auto& level : levels) {
+		for (TimingWheelNode*& head : level) {
+			drain(head);
+		}
+	}
+	count = 0;
+}
+
+void TimingWheel::link(TimingWheelNode* node)
+{
+	int64_t expiration = node->wheelExpiration;
+	int64_t delta = expiration - currentTick;
+
+	TimingWheelNode** slot;
+	if (delta < 0) {
+		// already late, run it on the next processed tick
+		slot = &root[currentTick & ROOT_MASK];
+	} else if (delta < ROOT_SIZE) {
+		slot = &root[expiration & ROOT_MASK];
+	} else {
+		int level = 0;
+		while (level < LEVELS - 1 && delta >= (int64_t(1) << (ROOT_BITS + (level + 1) * LEVEL_BITS))) {
+			++level;
+		}
+
+		if (level == LEVELS - 1) {
+			// the last level holds up to 2^32 ticks ahead, clamp anything farther
+			// away; the real expiration is kept and checked again on cascade
+			constexpr int64_t maxDelta = (int64_t(1) << (ROOT_BITS + LEVELS * LEVEL_BITS)) - 1;
+			if (delta > maxDelta) {
+				expiration = currentTick + maxDelta;
+			}
+		}
+		slot = &levels[level][levelIndex(expiration, level)];
+	}
+
+	node->wheelSlot = slot;
+	node->wheelPrev = nullptr;
+	node->wheelNext = *slot;
+	if (*slot) {
+		(*slot)->wheelPrev = node;
+	}
+	*slot = node;
+}
+
+void TimingWheel::unlink(TimingWheelNode* node)
+{
+	if (node->wheelPrev) {
+		node->wheelPrev->wheelNext = node->wheelNext;
+	} else {
+		*node->wheelSlot = node->wheelNext;
+	}
+
+	if (node->wheelNext) {
+		node->wheelNext->wheelPrev = node->wheelPrev;
+	}
+
+	node->wheelPrev = nullptr;
+	node->wheelNext = nullptr;
+	node->wheelSlot = nullptr;
+}
+
+int64_t TimingWheel::cascade(int level, int64_t index)
+{
+	TimingWheelNode* node = levels[level][index];
+	levels[level][index] = nullptr;
+
+	while (node) {
+		TimingWheelNode* next = node->wheelNext;
+		node->wheelSlot = nullptr;
+		link(node);
+		node = next;
+	}
+	return index;
+}
@@ -0,0 +1,122 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_GAME_SCHEDULING_TIMING_WHEEL_HPP_
+#define SRC_GAME_SCHEDULING_TIMING_WHEEL_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Intrusive hook for objects stored in a TimingWheel.
+ * The wheel never owns the node, it only links it into a slot.
+ */
+class TimingWheelNode
+{
+	public:
+		int64_t getWheelExpiration() const {
+			return wheelExpiration;
+		}
+		bool isLinked() const {
+			return wheelSlot != nullptr;
+		}
+
+	protected:
+		TimingWheelNode() = default;
+		~TimingWheelNode() = default;
+
+	private:
+		TimingWheelNode* wheelPrev = nullptr;
+		TimingWheelNode* wheelNext = nullptr;
+		TimingWheelNode** wheelSlot = nullptr;
+		int64_t wheelExpiration = 0;
+
+		friend class TimingWheel;
+};
+
+/**
+ * Hierarchical timing wheel (the classic five level layout used by kernels).
+ * The first level has 256 slots of one tick each, the other four have 64
+ * slots each and cover 256 * 64^n ticks, so any uint32_t delay fits.
+ * Insert and remove are O(1); expired nodes are collected by advance().
+ */
+class TimingWheel
+{
+	public:
+		explicit TimingWheel(int64_t startTick) : currentTick(startTick) {}
+
+		// non-copyable
+		TimingWheel(const TimingWheel&) = delete;
+		TimingWheel& operator=(const TimingWheel&) = delete;
+
+		void insert(TimingWheelNode* node, int64_t expiration);
+		void remove(TimingWheelNode* node);
+
+		/**
+		 * Processes every tick up to (and including) now and appends the
+		 * nodes that expired to the expired list, unlinked from the wheel.
+		 */
+		void advance(int64_t now, std::vector<TimingWheelNode*>& expired);
+
+		/**
+		 * Returns the tick at which advance() has work to do, either an
+		 * expiration on the first level or the next cascade point.
+		 * Only meaningful when the wheel is not empty.
+		 */
+		int64_t getNextTick() const;
+
+		/**
+		 * Unlinks every node and hands it to the given list, used on shutdown.
+		 */
+		void clear(std::vector<TimingWheelNode*>& removed);
+
+		size_t size() const {
+			return count;
+		}
+		bool empty() const {
+			return count == 0;
+		}
+
+	private:
+		static constexpr int ROOT_BITS = 8;
+		static constexpr int LEVEL_BITS = 6;
+		static constexpr int LEVELS = 4;
+		static constexpr int64_t ROOT_SIZE = 1 << ROOT_BITS;
+		static constexpr int64_t LEVEL_SIZE = 1 << LEVEL_BITS;
+		static constexpr int64_t ROOT_MASK = ROOT_SIZE - 1;
+		static constexpr int64_t LEVEL_MASK = LEVEL_SIZE - 1;
+
+		static int64_t levelIndex(int64_t tick, int level) {
+			return (tick >> (ROOT_BITS + level * LEVEL_BITS)) & LEVEL_MASK;
+		}
+
+		void link(TimingWheelNode* node);
+		static void unlink(TimingWheelNode* node);
+		int64_t cascade(int level, int64_t index);
+
+		// first tick not processed yet
+		int64_t currentTick;
+		size_t count = 0;
+
+		std::array<TimingWheelNode*, ROOT_SIZE> root {};
+		std::array<std::array<TimingWheelNode*, LEVEL_SIZE>, LEVELS> levels {};
+};
+
+#endif  // SRC_GAME_SCHEDULING_TIMING_WHEEL_HPP_
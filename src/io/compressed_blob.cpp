@@ -0,0 +1,72 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "io/compressed_blob.hpp"
+
+bool CompressedBlob::compress(uint8_t version, const char* data, size_t size, std::string& blob)
+{
+	if (size > MAX_SIZE) {
+		SPDLOG_ERROR("[CompressedBlob::compress] - {} bytes are too many for one blob", size);
+		return false;
+	}
+
+	const size_t offset = blob.size();
+	const uint32_t rawSize = static_cast<uint32_t>(size);
+	uLongf compressedSize = compressBound(static_cast<uLong>(size));
+	blob.resize(offset + HEADER_SIZE + compressedSize);
+
+	char* header = blob.data() + offset;
+	memcpy(header, &version, sizeof(uint8_t));
+	memcpy(header + sizeof(uint8_t), &rawSize, sizeof(uint32_t));
+
+	if (int ret = compress2(reinterpret_cast<Bytef*>(header + HEADER_SIZE), &compressedSize, reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size), Z_DEFAULT_COMPRESSION);
+			ret != Z_OK) {
+		SPDLOG_ERROR("[CompressedBlob::compress] - Zlib compress2 error: {}", ret);
+		blob.resize(offset);
+		return false;
+	}
+
+	blob.resize(offset + HEADER_SIZE + compressedSize);
+	return true;
+}
+
+bool CompressedBlob::uncompress(const char* blob, size_t size, uint8_t& version, std::vector<char>& data)
+{
+	if (size < HEADER_SIZE) {
+		return false;
+	}
+
+	uint32_t rawSize;
+	memcpy(&version, blob, sizeof(uint8_t));
+	memcpy(&rawSize, blob + sizeof(uint8_t), sizeof(uint32_t));
+	if (rawSize > MAX_SIZE) {
+		return false;
+	}
+
+	data.resize(rawSize);
+	if (rawSize == 0) {
+		return true;
+	}
+
+	uLongf inflatedSize = rawSize;
+	return ::uncompress(reinterpret_cast<Bytef*>(data.data()), &inflatedSize, reinterpret_cast<const Bytef*>(blob + HEADER_SIZE), static_cast<uLong>(size - HEADER_SIZE)) == Z_OK && inflatedSize == rawSize;
+}
@@ -0,0 +1,44 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_IO_COMPRESSED_BLOB_HPP_
+#define SRC_IO_COMPRESSED_BLOB_HPP_
+
+#include <string>
+#include <vector>
+
+/**
+ * Versioned deflated blobs for the database: a version byte, the inflated
+ * size as uint32 and the zlib stream.
+ */
+class CompressedBlob
+{
+	public:
+		static constexpr size_t HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+		// a larger inflated size can only come from a corrupted blob
+		static constexpr uint32_t MAX_SIZE = 64 * 1024 * 1024;
+
+		// appends the blob of data to blob
+		static bool compress(uint8_t version, const char* data, size_t size, std::string& blob);
+		// false for a truncated or corrupted blob
+		static bool uncompress(const char* blob, size_t size, uint8_t& version, std::vector<char>& data);
+};
+
+#endif  // SRC_IO_COMPRESSED_BLOB_HPP_
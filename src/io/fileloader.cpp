@@ -50,18 +50,48 @@ static Node& getCurrentNode(const NodeStack& nodeStack) {
 	return *nodeStack.top();
 }
 
-const Node& Loader::parseTree()
-{
-	auto it = fileContents.begin() + sizeof(Identifier);
-	if (static_cast<uint8_t>(*it) != Node::START) {
-		throw InvalidOTBFormat{};
+// Moves it from the type byte of a node to its END, without building anything
+static ContentIt skipNode(ContentIt it, ContentIt end) {
+	size_t depth = 1;
+	while (++it != end) {
+		switch (static_cast<uint8_t>(*it)) {
+			case Node::START: {
+				if (++it == end) {
+					throw InvalidOTBFormat{};
+				}
+				++depth;
+				break;
+			}
+			case Node::END: {
+				if (--depth == 0) {
+					return it;
+				}
+				break;
+			}
+			case Node::ESCAPE: {
+				if (++it == end) {
+					throw InvalidOTBFormat{};
+				}
+				break;
+			}
+			default: {
+				break;
+			}
+		}
 	}
-	root.type = *(++it);
-	root.propsBegin = ++it;
-	NodeStack parseStack;
-	parseStack.push(&root);
+	throw InvalidOTBFormat{};
+}
 
-	for (; it != fileContents.end(); ++it) {
+// bytes of a node from its first property up to and including its END
+using NodeRange = std::pair<ContentIt, ContentIt>;
+
+/**
+ * Builds the nodes on parseStack from the bytes in [it, end).
+ * With deferredRanges set, children at PARALLEL_NODE_DEPTH are only created and
+ * skipped, and their byte range is stored for a later parse.
+ */
+static void parseNodes(NodeStack& parseStack, ContentIt it, ContentIt end, std::vector<NodeRange>* deferredRanges) {
+	for (; it != end; ++it) {
 		switch(static_cast<uint8_t>(*it)) {
 			case Node::START: {
 				auto& currentNode = getCurrentNode(parseStack);
@@ -70,11 +100,16 @@ const Node& Loader::parseTree()
 				}
 				currentNode.children.emplace_back();
 				auto& child = currentNode.children.back();
-				if (++it == fileContents.end()) {
+				if (++it == end) {
 					throw InvalidOTBFormat{};
 				}
 				child.type = *it;
 				child.propsBegin = it + sizeof(Node::type);
+				if (deferredRanges && parseStack.size() == Loader::PARALLEL_NODE_DEPTH) {
+					it = skipNode(it, end);
+					deferredRanges->emplace_back(child.propsBegin, it + 1);
+					break;
+				}
 				parseStack.push(&child);
 				break;
 			}
@@ -87,7 +122,7 @@ const Node& Loader::parseTree()
 				break;
 			}
 			case Node::ESCAPE: {
-				if (++it == fileContents.end()) {
+				if (++it == end) {
 					throw InvalidOTBFormat{};
 				}
 				break;
@@ -97,28 +132,87 @@ const Node& Loader::parseTree()
 			}
 		}
 	}
+}
+
+static void collectNodes(Node& node, size_t depth, std::vector<Node*>& nodes) {
+	if (depth == 0) {
+		nodes.push_back(&node);
+		return;
+	}
+
+	for (auto& child : node.children) {
+		collectNodes(child, depth - 1, nodes);
+	}
+}
+
+const Node& Loader::parseTree()
+{
+	auto it = fileContents.begin() + sizeof(Identifier);
+	if (static_cast<uint8_t>(*it) != Node::START) {
+		throw InvalidOTBFormat{};
+	}
+	root.type = *(++it);
+	root.propsBegin = ++it;
+	NodeStack parseStack;
+	parseStack.push(&root);
+
+	// first pass only indexes the deep subtrees, their START..END ranges are already validated
+	std::vector<NodeRange> deferredRanges;
+	parseNodes(parseStack, it, fileContents.end(), &deferredRanges);
 	if (!parseStack.empty()) {
 		throw InvalidOTBFormat{};
 	}
 
+	// the vectors holding the deferred nodes no longer grow, pointers into them are stable now
+	std::vector<Node*> deferredNodes;
+	deferredNodes.reserve(deferredRanges.size());
+	collectNodes(root, PARALLEL_NODE_DEPTH, deferredNodes);
+
+	std::vector<std::exception_ptr> errors(deferredNodes.size());
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int64_t i = 0; i < static_cast<int64_t>(deferredNodes.size()); ++i) {
+		try {
+			NodeStack nodeStack;
+			nodeStack.push(deferredNodes[i]);
+			// the range includes the END of the node, which pops it again
+			parseNodes(nodeStack, deferredRanges[i].first, deferredRanges[i].second, nullptr);
+		} catch (...) {
+			errors[i] = std::current_exception();
+		}
+	}
+
+	for (const auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
 	return root;
 }
 
 bool Loader::getProps(const Node& node, PropStream& props)
 {
-	auto size = std::distance(node.propsBegin, node.propsEnd);
-	if (size == 0) {
+	if (node.propsBegin == node.propsEnd) {
 		return false;
 	}
-	propBuffer.resize(size);
+
+	propBuffer.clear();
+	appendProps(node, propBuffer);
+	props.init(propBuffer.data(), propBuffer.size());
+	return true;
+}
+
+size_t Loader::appendProps(const Node& node, std::vector<char>& buffer)
+{
+	size_t offset = buffer.size();
+	buffer.resize(offset + std::distance(node.propsBegin, node.propsEnd));
 	bool lastEscaped = false;
 
-	auto escapedPropEnd = std::copy_if(node.propsBegin, node.propsEnd, propBuffer.begin(), [&lastEscaped](const char& byte) {
+	auto escapedPropEnd = std::copy_if(node.propsBegin, node.propsEnd, buffer.begin() + offset, [&lastEscaped](const char& byte) {
 		lastEscaped = byte == static_cast<char>(Node::ESCAPE) && !lastEscaped;
 		return !lastEscaped;
 	});
-	props.init(&propBuffer[0], std::distance(propBuffer.begin(), escapedPropEnd));
-	return true;
+	buffer.erase(escapedPropEnd, buffer.end());
+	return buffer.size() - offset;
 }
 
 } //namespace OTB
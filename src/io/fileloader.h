@@ -65,9 +65,14 @@ namespace OTB {
 		Node root;
 		std::vector < char > propBuffer;
 		public:
+			// nodes this deep (the tile areas of a map) have their subtrees built in parallel
+			static constexpr size_t PARALLEL_NODE_DEPTH = 2;
+
 			Loader(const std::string & fileName,
 				const Identifier & acceptedIdentifier);
 		bool getProps(const Node & node, PropStream & props);
+		// Appends the unescaped properties of node to buffer, safe to call from any thread
+		static size_t appendProps(const Node & node, std::vector < char > & buffer);
 		const Node & parseTree();
 	};
 
@@ -85,6 +90,11 @@ class PropStream
 			return end - p;
 		}
 
+		// the bytes not read yet
+		const char* data() const {
+			return p;
+		}
+
 		template <typename T>
 		bool read(T& ret) {
 			if (size() < sizeof(T)) {
@@ -147,10 +157,31 @@ class PropWriteStream
 			buffer.clear();
 		}
 
+		size_t size() const {
+			return buffer.size();
+		}
+
+		void reserve(size_t size) {
+			buffer.reserve(size);
+		}
+
 		template <typename T>
 		void write(T add) {
-			char* addr = reinterpret_cast<char*>(&add);
-			std::copy(addr, addr + sizeof(T), std::back_inserter(buffer));
+			size_t offset = buffer.size();
+			buffer.resize(offset + sizeof(T));
+			memcpy(buffer.data() + offset, &add, sizeof(T));
+		}
+
+		// overwrites a value written before, e.g. a size only known afterwards
+		template <typename T>
+		void writeAt(size_t offset, T value) {
+			memcpy(buffer.data() + offset, &value, sizeof(T));
+		}
+
+		void writeBytes(const char* bytes, size_t size) {
+			size_t offset = buffer.size();
+			buffer.resize(offset + size);
+			memcpy(buffer.data() + offset, bytes, size);
 		}
 
 		void writeString(const std::string& str) {
@@ -161,7 +192,7 @@ class PropWriteStream
 			}
 
 			write(static_cast<uint16_t>(strLength));
-			std::copy(str.begin(), str.end(), std::back_inserter(buffer));
+			writeBytes(str.data(), strLength);
 		}
 
 	private:
@@ -100,8 +100,7 @@ bool IOBestiary::parseCharmCombat(Charm* charm, Player* player, Creature* target
 
 Charm* IOBestiary::getBestiaryCharm(charmRune_t activeCharm, bool force /*= false*/)
 {
-	std::vector<Charm*> charmInternal = g_game().getCharmList();
-	for (Charm* tmpCharm : charmInternal) {
+	for (Charm* tmpCharm : g_game().getCharmList()) {
 		if (tmpCharm->id == activeCharm) {
 			return tmpCharm;
 		}
@@ -120,18 +119,18 @@ Charm* IOBestiary::getBestiaryCharm(charmRune_t activeCharm, bool force /*= fals
 
 std::map<uint16_t, std::string> IOBestiary::findRaceByName(const std::string &race, bool Onlystring /*= true*/, BestiaryType_t raceNumber /*= BESTY_RACE_NONE*/) const
 {
-	std::map<uint16_t, std::string> best_list = g_game().getBestiaryList();
+	const std::map<uint16_t, std::string>& best_list = g_game().getBestiaryList();
 	std::map<uint16_t, std::string> race_list;
 
 	if (Onlystring) {
-		for (auto it : best_list) {
+		for (const auto& it : best_list) {
 			const MonsterType* tmpType = g_monsters().getMonsterType(it.second);
 			if (tmpType && tmpType->info.bestiaryClass == race) {
 				race_list.insert({it.first, it.second});
 			}
 		}
 	} else {
-		for (auto itn : best_list) {
+		for (const auto& itn : best_list) {
 			const MonsterType* tmpType = g_monsters().getMonsterType(itn.second);
 			if (tmpType && tmpType->info.bestiaryRace == raceNumber) {
 				race_list.insert({itn.first, itn.second});
@@ -198,9 +197,7 @@ uint16_t IOBestiary::getBestiaryRaceUnlocked(Player* player, BestiaryType_t race
 	}
 
 	uint16_t count = 0;
-	std::map<uint16_t, std::string> besty_l = g_game().getBestiaryList();
-
-	for (auto it : besty_l) {
+	for (const auto& it : g_game().getBestiaryList()) {
 		const MonsterType* mtype = g_monsters().getMonsterType(it.second);
 		if (mtype && mtype->info.bestiaryRace == race && player->getBestiaryKillCount(mtype->info.raceid) > 0) {
 			count++;
@@ -248,10 +245,11 @@ void IOBestiary::addBestiaryKill(Player* player, MonsterType* mtype, uint32_t am
 			addCharmPoints(player, mtype->info.bestiaryCharmsPoints);
 	}
 
-	std::list<MonsterType*> trackerList = player->getBestiaryTrackerList();
-	for (MonsterType* mType : trackerList) {
+	const std::list<MonsterType*>& trackerList = player->getBestiaryTrackerList();
+	for (const MonsterType* mType : trackerList) {
 		if (raceid == mType->info.raceid) {
 			player->refreshBestiaryTracker(trackerList);
+			break;
 		}
 	}
 }
@@ -262,13 +260,18 @@ charmRune_t IOBestiary::getCharmFromTarget(Player* player, MonsterType* mtype)
 		return CHARM_NONE;
 	}
 
+	// runs on every hit between a player and a monster, so the used runes are read
+	// straight from the bits, highest first as in getCharmUsedRuneBitAll
 	uint16_t bestiaryEntry = mtype->info.raceid;
-	std::list<charmRune_t> usedRunes = getCharmUsedRuneBitAll(player);
+	int32_t usedRunes = player->getUsedRunesBit();
+	for (int8_t i = 30; i >= 0; --i) {
+		if ((usedRunes & (1 << i)) == 0) {
+			continue;
+		}
 
-	for (charmRune_t it : usedRunes) {
-		Charm* charm = getBestiaryCharm(it);
-		if (bestiaryEntry == player->parseRacebyCharm(charm->id, false, 0)) {
-			return charm->id;
+		auto rune = static_cast<charmRune_t>(i);
+		if (bestiaryEntry == player->parseRacebyCharm(rune, false, 0)) {
+			return rune;
 		}
 	}
 	return CHARM_NONE;
@@ -404,10 +407,10 @@ std::map<uint8_t, int16_t> IOBestiary::getMonsterElements(MonsterType* mtype) co
 	return defaultMap;
 }
 
-std::map<uint16_t, uint32_t> IOBestiary::getBestiaryKillCountByMonsterIDs(Player* player, std::map<uint16_t, std::string> mtype_list) const
+std::map<uint16_t, uint32_t> IOBestiary::getBestiaryKillCountByMonsterIDs(Player* player, const std::map<uint16_t, std::string>& mtype_list) const
 {
 	std::map<uint16_t, uint32_t> raceMonsters = {};
-	for (auto it : mtype_list) {
+	for (const auto& it : mtype_list) {
 		uint16_t raceid = it.first;
 		uint32_t thisKilled = player->getBestiaryKillCount(raceid);
 		if (thisKilled > 0) {
@@ -420,9 +423,7 @@ std::map<uint16_t, uint32_t> IOBestiary::getBestiaryKillCountByMonsterIDs(Player
 std::list<uint16_t> IOBestiary::getBestiaryFinished(Player* player) const
 {
 	std::list<uint16_t> finishedMonsters = {};
-	std::map<uint16_t, std::string> besty_l = g_game().getBestiaryList();
-
-	for (auto nt : besty_l) {
+	for (const auto& nt : g_game().getBestiaryList()) {
 		uint16_t raceid = nt.first;
 		uint32_t thisKilled = player->getBestiaryKillCount(raceid);
 		const MonsterType* mtype = g_monsters().getMonsterType(nt.second);
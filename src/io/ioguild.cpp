@@ -20,9 +20,37 @@
 #include "pch.hpp"
 
 #include "database/database.h"
+#include "database/databasetasks.h"
 #include "creatures/players/grouping/guild.h"
+#include "game/game.h"
 #include "io/ioguild.h"
 
+namespace {
+
+struct CachedWarList {
+	GuildWarVector wars;
+	int64_t expiresAt;
+};
+
+// the war lists are read by the database workers while players log in
+std::mutex warListsLock;
+phmap::flat_hash_map<uint32_t, CachedWarList> warLists;
+
+struct CachedGuildId {
+	uint32_t id;
+	int64_t expiresAt;
+};
+
+// dispatcher only, by lower case name
+phmap::flat_hash_map<std::string, CachedGuildId> guildIds;
+
+int64_t getGuildCacheTime()
+{
+	return static_cast<int64_t>(g_configManager().getNumber(GUILD_CACHE_TIME)) * 1000;
+}
+
+}  // namespace
+
 Guild* IOGuild::loadGuild(uint32_t guildId)
 {
 	Database& db = Database::getInstance();
@@ -31,6 +59,7 @@ Guild* IOGuild::loadGuild(uint32_t guildId)
 	if (DBResult_ptr result = db.storeQuery(query.str())) {
 		Guild* guild = new Guild(guildId, result->getString("name"));
     guild->setBankBalance(result->getNumber<uint64_t>("balance"));
+    guild->setBankBalanceChanged(false);
 		query.str(std::string());
 		query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `guild_id` = " << guildId;
 
@@ -44,47 +73,106 @@ Guild* IOGuild::loadGuild(uint32_t guildId)
 	return nullptr;
 }
 
-void IOGuild::saveGuild(Guild* guild) {
-  if (!guild)
-    return;
-  Database& db = Database::getInstance();
-  std::ostringstream updateQuery;
-  updateQuery << "UPDATE `guilds` SET ";
-  updateQuery << "`balance` = " << guild->getBankBalance();
-  updateQuery << " WHERE `id` = " << guild->getId();
-  db.executeQuery(updateQuery.str());
+void IOGuild::saveGuilds(const std::vector<Guild*>& guilds)
+{
+	std::vector<uint32_t> changedGuilds;
+	std::ostringstream cases;
+	std::ostringstream ids;
+	auto flush = [&]() {
+		std::ostringstream query;
+		query << "UPDATE `guilds` SET `balance` = CASE `id`" << cases.str() << " END WHERE `id` IN (" << ids.str() << ')';
+		g_databaseTasks().addTask(query.str(), [changedGuilds](DBResult_ptr, bool success) {
+			if (success) {
+				return;
+			}
+
+			// written again on the next save
+			SPDLOG_WARN("[IOGuild::saveGuilds] - Failed to save the balance of {} guilds", changedGuilds.size());
+			for (uint32_t guildId : changedGuilds) {
+				if (Guild* guild = g_game().getGuild(guildId)) {
+					guild->setBankBalanceChanged(true);
+				}
+			}
+		});
+		changedGuilds.clear();
+		cases.str(std::string());
+		ids.str(std::string());
+	};
+
+	for (Guild* guild : guilds) {
+		if (!guild || !guild->hasBankBalanceChanged()) {
+			continue;
+		}
+
+		guild->setBankBalanceChanged(false);
+		cases << " WHEN " << guild->getId() << " THEN " << guild->getBankBalance();
+		ids << (changedGuilds.empty() ? "" : ",") << guild->getId();
+		changedGuilds.push_back(guild->getId());
+		if (changedGuilds.size() == SAVE_BATCH_SIZE) {
+			flush();
+		}
+	}
+
+	if (!changedGuilds.empty()) {
+		flush();
+	}
 }
 
 uint32_t IOGuild::getGuildIdByName(const std::string& name)
 {
+	std::string key = asLowerCaseString(name);
+	for (const auto& [guildId, guild] : g_game().getGuilds()) {
+		if (asLowerCaseString(guild->getName()) == key) {
+			return guildId;
+		}
+	}
+
+	int64_t now = OTSYS_TIME();
+	auto it = guildIds.find(key);
+	if (it != guildIds.end() && it->second.expiresAt > now) {
+		return it->second.id;
+	}
+
 	Database& db = Database::getInstance();
 
 	std::ostringstream query;
 	query << "SELECT `id` FROM `guilds` WHERE `name` = " << db.escapeString(name);
 
 	DBResult_ptr result = db.storeQuery(query.str());
-	if (!result) {
-		return 0;
+	uint32_t guildId = result ? result->getNumber<uint32_t>("id") : 0;
+	// a guild that does not exist yet may be created on the website any time
+	if (guildId != 0) {
+		guildIds[key] = {guildId, now + getGuildCacheTime()};
 	}
-	return result->getNumber<uint32_t>("id");
+	return guildId;
 }
 
-void IOGuild::getWarList(uint32_t guildId, GuildWarVector& guildWarVector)
+void IOGuild::getWarList(Database& db, uint32_t guildId, GuildWarVector& guildWarVector)
 {
+	int64_t now = OTSYS_TIME();
+	{
+		std::lock_guard<std::mutex> lockClass(warListsLock);
+		auto it = warLists.find(guildId);
+		if (it != warLists.end() && it->second.expiresAt > now) {
+			guildWarVector = it->second.wars;
+			return;
+		}
+	}
+
 	std::ostringstream query;
 	query << "SELECT `guild1`, `guild2` FROM `guild_wars` WHERE (`guild1` = " << guildId << " OR `guild2` = " << guildId << ") AND `ended` = 0 AND `status` = 1";
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
-	if (!result) {
-		return;
+	if (DBResult_ptr result = db.storeQuery(query.str())) {
+		do {
+			uint32_t guild1 = result->getNumber<uint32_t>("guild1");
+			if (guildId != guild1) {
+				guildWarVector.push_back(guild1);
+			} else {
+				guildWarVector.push_back(result->getNumber<uint32_t>("guild2"));
+			}
+		} while (result->next());
 	}
 
-	do {
-		uint32_t guild1 = result->getNumber<uint32_t>("guild1");
-		if (guildId != guild1) {
-			guildWarVector.push_back(guild1);
-		} else {
-			guildWarVector.push_back(result->getNumber<uint32_t>("guild2"));
-		}
-	} while (result->next());
+	std::lock_guard<std::mutex> lockClass(warListsLock);
+	warLists[guildId] = {guildWarVector, now + getGuildCacheTime()};
 }
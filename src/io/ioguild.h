@@ -20,6 +20,7 @@
 #ifndef SRC_IO_IOGUILD_H_
 #define SRC_IO_IOGUILD_H_
 
+class Database;
 class Guild;
 using GuildWarVector = std::vector<uint32_t>;
 
@@ -27,9 +28,16 @@ class IOGuild
 {
 	public:
 		static Guild* loadGuild(uint32_t guildId);
-    static void saveGuild(Guild* guild);
+		// one UPDATE on a database worker for the guilds whose balance changed
+		static void saveGuilds(const std::vector<Guild*>& guilds);
+		// loaded guilds are found without a query, the others are cached for guildCacheTime seconds
 		static uint32_t getGuildIdByName(const std::string& name);
-		static void getWarList(uint32_t guildId, GuildWarVector& guildWarVector);
+		// db is the connection of the calling thread, the lists are cached for guildCacheTime seconds
+		static void getWarList(Database& db, uint32_t guildId, GuildWarVector& guildWarVector);
+
+	private:
+		// guild ids are cut in statements of this many, a CASE over every guild would get large
+		static constexpr size_t SAVE_BATCH_SIZE = 500;
 };
 
 #endif  // SRC_IO_IOGUILD_H_
@@ -21,19 +21,128 @@
 
 #include "io/iologindata.h"
 #include "game/game.h"
+#include "game/forked_save.hpp"
 #include "creatures/monsters/monster.h"
 #include "io/ioprey.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/dispatcher_watchdog.hpp"
+#include "game/scheduling/tasks.h"
+#include "server/metrics/metrics.hpp"
+#include "utils/log_rate_limiter.hpp"
+
+namespace {
+
+MetricHistogram& playerSaveTime = g_metrics().getHistogram("canary_player_save_seconds", "Time writing one player to the database, retries included",
+  {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000});
+
+// queued asynchronous saves by player guid, dispatcher thread only
+std::unordered_map<uint32_t, uint32_t> pendingSaves;
+
+void finishPendingSave(uint32_t guid)
+{
+  auto it = pendingSaves.find(guid);
+  if (it != pendingSaves.end() && --it->second == 0) {
+    pendingSaves.erase(it);
+  }
+}
+
+// a PlayerItemRow owning its attributes, for rows written after the items are gone
+struct RewardItemRow {
+  int32_t pid;
+  int32_t sid;
+  uint16_t itemType;
+  uint16_t count;
+  std::string attributes;
+
+  // the bag is numbered from 101 as in a save, offset moves it after the rows already stored
+  PlayerItemRow getRow(int32_t offset) const {
+    PlayerItemRow row;
+    row.pid = pid >= 100 ? pid + offset : pid;
+    row.sid = sid + offset;
+    row.itemType = itemType;
+    row.count = count;
+    row.attributes = attributes.data();
+    row.attributesSize = attributes.size();
+    return row;
+  }
+};
+
+bool appendRewardRows(Database& db, uint32_t guid, const std::vector<RewardItemRow>& rows)
+{
+  std::vector<DBStatement> queries;
+  if (IOPlayerState::isEnabled()) {
+    DBResult_ptr result = db.storeQuery(DBStatement("SELECT `data` FROM `player_state` WHERE `player_id` = ? AND `component` = ?").bind(guid).bind(static_cast<uint16_t>(PLAYER_STATE_REWARDS)));
+    std::vector<char> raw;
+    if (result) {
+      unsigned long size;
+      const char* data = result->getStream("data", size);
+      if (!IOPlayerState::uncompress(data, size, raw)) {
+        return false;
+      }
+    }
+
+    PropStream stream;
+    stream.init(raw.data(), raw.size());
+    int32_t lastSid = 0;
+    int32_t maxSid = 100;
+    size_t validSize = 0;
+    PlayerItemRow row;
+    while (IOPlayerState::readItem(stream, lastSid, row)) {
+      maxSid = std::max(maxSid, row.sid);
+      validSize = raw.size() - stream.size();
+    }
+
+    PropWriteStream stateStream;
+    stateStream.writeBytes(raw.data(), validSize);
+    for (const RewardItemRow& rewardRow : rows) {
+      IOPlayerState::writeItem(stateStream, lastSid, rewardRow.getRow(maxSid - 100));
+    }
+    if (!IOPlayerState::addSaveStatement(guid, PLAYER_STATE_REWARDS, stateStream, queries)) {
+      return false;
+    }
+  } else {
+    DBResult_ptr result = db.storeQuery(DBStatement("SELECT MAX(`sid`) AS `sid` FROM `player_rewards` WHERE `player_id` = ?").bind(guid));
+    int32_t offset = std::max<int32_t>(result ? result->getNumber<int32_t>("sid") : 0, 100) - 100;
+
+    DBInsert query_insert("INSERT INTO `player_rewards` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", queries);
+    std::ostringstream ss;
+    for (const RewardItemRow& rewardRow : rows) {
+      PlayerItemRow row = rewardRow.getRow(offset);
+      ss << guid << ',' << row.pid << ',' << row.sid << ',' << row.itemType << ',' << row.count << ',' << db.escapeBlob(row.attributes, static_cast<uint32_t>(row.attributesSize));
+      if (!query_insert.addRow(ss)) {
+        return false;
+      }
+    }
+    if (!query_insert.execute()) {
+      return false;
+    }
+  }
+
+  DBTransaction transaction(db);
+  if (!transaction.begin()) {
+    return false;
+  }
+
+  for (const DBStatement& statement : queries) {
+    if (!db.executeQuery(statement)) {
+      return false;
+    }
+  }
+  return transaction.commit();
+}
+
+}  // namespace
 
 bool IOLoginData::authenticateAccountPassword(const std::string& email, const std::string& password, account::Account *account) {
 	if (account::ERROR_NO != account->LoadAccountDB(email)) {
-		SPDLOG_ERROR("Email {} doesn't match any account.", email);
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "Email {} doesn't match any account.", email);
 		return false;
 	}
 
 	std::string accountPassword;
 	account->GetPassword(&accountPassword);
 	if (transformToSHA1(password) != accountPassword) {
-			SPDLOG_ERROR("Password '{}' doesn't match any account", transformToSHA1(password));
+			SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "Password '{}' doesn't match any account", transformToSHA1(password));
 			return false;
 	}
 
@@ -49,7 +158,7 @@ bool IOLoginData::gameWorldAuthentication(const std::string& email, const std::s
 
 	account::Player player;
 	if (account::ERROR_NO != account.GetAccountPlayer(&player, characterName)) {
-		SPDLOG_ERROR("Player not found or deleted for account.");
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "Player not found or deleted for account.");
 		return false;
 	}
 
@@ -95,13 +204,12 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
 {
   Database& db = Database::getInstance();
 
-  std::ostringstream query;
-  query << "SELECT `id`, `account_id`, `group_id`, `deletion`, (SELECT `type` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `account_type`";
+  std::string query = "SELECT `id`, `account_id`, `group_id`, `deletion`, (SELECT `type` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `account_type`";
   if (!g_configManager().getBoolean(FREE_PREMIUM)) {
-    query << ", (SELECT `premdays` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `premium_days`";
+    query += ", (SELECT `premdays` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `premium_days`";
   }
-  query << " FROM `players` WHERE `name` = " << db.escapeString(name);
-  DBResult_ptr result = db.storeQuery(query.str());
+  query += " FROM `players` WHERE `name` = ?";
+  DBResult_ptr result = db.storeQuery(DBStatement(std::move(query)).bindString(name));
   if (!result) {
     return false;
   }
@@ -130,33 +238,152 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
 
 bool IOLoginData::loadPlayerById(Player* player, uint32_t id)
 {
+  waitForPendingSave(id);
   Database& db = Database::getInstance();
-  std::ostringstream query;
-  query << "SELECT * FROM `players` WHERE `id` = " << id;
-  return loadPlayer(player, db.storeQuery(query.str()));
+  PlayerLoadContext context;
+  context.player = db.storeQuery(DBStatement("SELECT * FROM `players` WHERE `id` = ?").bind(id));
+  fetchPlayerData(db, context);
+  return loadPlayer(player, context);
 }
 
 bool IOLoginData::loadPlayerByName(Player* player, const std::string& name)
 {
   Database& db = Database::getInstance();
-  std::ostringstream query;
-  query << "SELECT * FROM `players` WHERE `name` = " << db.escapeString(name);
-  return loadPlayer(player, db.storeQuery(query.str()));
+  DBStatement statement("SELECT * FROM `players` WHERE `name` = ?");
+  statement.bindString(name);
+  DBResult_ptr result = db.storeQuery(statement);
+  if (result && pendingSaves.find(result->getNumber<uint32_t>("id")) != pendingSaves.end()) {
+    // the row is older than the queued save, read it again once that is written
+    waitForPendingSave(result->getNumber<uint32_t>("id"));
+    result = db.storeQuery(statement);
+  }
+
+  PlayerLoadContext context;
+  context.player = result;
+  fetchPlayerData(db, context);
+  return loadPlayer(player, context);
+}
+
+void IOLoginData::loadPlayerAsync(uint32_t guid, std::function<void(PlayerLoadContext&)> callback)
+{
+  auto context = std::make_shared<PlayerLoadContext>();
+  context->lazyDepot = g_configManager().getBoolean(LAZY_DEPOT_LOADING);
+  auto fetch = [context, guid](Database& db) {
+    context->player = db.storeQuery(DBStatement("SELECT * FROM `players` WHERE `id` = ?").bind(guid));
+    fetchPlayerData(db, *context);
+    return context->player != nullptr;
+  };
+  auto done = [context, callback](DBResult_ptr, bool) {
+    callback(*context);
+  };
+
+  // keyed by guid, so it runs after the saves already queued for the player
+  if (!g_databaseTasks().addTask(fetch, done, guid, guid)) {
+    // no worker is running, read it here
+    waitForPendingSave(guid);
+    fetch(Database::getInstance());
+    callback(*context);
+  }
+}
+
+void IOLoginData::fetchPlayerData(Database& db, PlayerLoadContext& context)
+{
+  if (!context.player) {
+    return;
+  }
+
+  uint32_t guid = context.player->getNumber<uint32_t>("id");
+  context.account.SetDatabaseInterface(&db);
+  context.account.LoadAccountDB(context.player->getNumber<uint32_t>("account_id"));
+  context.account.GetCoins(&context.coins);
+
+  if ((context.guildMembership = db.storeQuery(DBStatement("SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = ?").bind(guid)))) {
+    uint32_t guildId = context.guildMembership->getNumber<uint32_t>("guild_id");
+    IOGuild::getWarList(db, guildId, context.guildWars);
+    context.guildMemberCount = db.storeQuery(DBStatement("SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = ?").bind(guildId));
+  }
+
+  if (!(context.charms = db.storeQuery(DBStatement("SELECT * FROM `player_charms` WHERE `player_guid` = ?").bind(guid)))) {
+    db.executeQuery(DBStatement("INSERT INTO `player_charms` (`player_guid`) VALUES (?)").bind(guid));
+  }
+  context.spells = db.storeQuery(DBStatement("SELECT `player_id`, `name` FROM `player_spells` WHERE `player_id` = ?").bind(guid));
+  context.kills = db.storeQuery(DBStatement("SELECT `player_id`, `time`, `target`, `unavenged` FROM `player_kills` WHERE `player_id` = ?").bind(guid));
+  if (IOPlayerState::isEnabled()) {
+    fetchPlayerState(db, guid, context);
+  } else {
+    context.stash = db.storeQuery(DBStatement("SELECT `item_count`, `item_id`  FROM `player_stash` WHERE `player_id` = ?").bind(guid));
+    context.items = db.storeQuery(DBStatement("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_items` WHERE `player_id` = ? ORDER BY `sid` DESC").bind(guid));
+    context.rewardItems = db.storeQuery(DBStatement("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_rewards` WHERE `player_id` = ? ORDER BY `sid` DESC").bind(guid));
+    if (!context.lazyDepot) {
+      fetchDepotData(db, guid, context);
+    }
+    context.storage = db.storeQuery(DBStatement("SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = ?").bind(guid));
+  }
+  context.vip = db.storeQuery(DBStatement("SELECT `player_id` FROM `account_viplist` WHERE `account_id` = ?").bind(context.player->getNumber<uint32_t>("account_id")));
+  // read even when prey or task hunting are disabled, the config is not for worker threads
+  context.prey = db.storeQuery(DBStatement("SELECT * FROM `player_prey` WHERE `player_id` = ?").bind(guid));
+  context.taskHunt = db.storeQuery(DBStatement("SELECT * FROM `player_taskhunt` WHERE `player_id` = ?").bind(guid));
+}
+
+void IOLoginData::fetchPlayerState(Database& db, uint32_t guid, PlayerLoadContext& context)
+{
+  if (context.lazyDepot) {
+    DBStatement statement("SELECT `component`, `data` FROM `player_state` WHERE `player_id` = ? AND `component` NOT IN (?, ?)");
+    statement.bind(guid).bind(static_cast<uint16_t>(PLAYER_STATE_DEPOT)).bind(static_cast<uint16_t>(PLAYER_STATE_INBOX));
+    readPlayerState(db.storeQuery(statement), guid, context);
+  } else {
+    readPlayerState(db.storeQuery(DBStatement("SELECT `component`, `data` FROM `player_state` WHERE `player_id` = ?").bind(guid)), guid, context);
+  }
+}
+
+void IOLoginData::fetchDepotData(Database& db, uint32_t guid, PlayerLoadContext& context)
+{
+  if (IOPlayerState::isEnabled()) {
+    DBStatement statement("SELECT `component`, `data` FROM `player_state` WHERE `player_id` = ? AND `component` IN (?, ?)");
+    statement.bind(guid).bind(static_cast<uint16_t>(PLAYER_STATE_DEPOT)).bind(static_cast<uint16_t>(PLAYER_STATE_INBOX));
+    readPlayerState(db.storeQuery(statement), guid, context);
+  } else {
+    context.depotItems = db.storeQuery(DBStatement("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_depotitems` WHERE `player_id` = ? ORDER BY `sid` DESC").bind(guid));
+    context.inboxItems = db.storeQuery(DBStatement("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_inboxitems` WHERE `player_id` = ? ORDER BY `sid` DESC").bind(guid));
+  }
+}
+
+void IOLoginData::readPlayerState(DBResult_ptr result, uint32_t guid, PlayerLoadContext& context)
+{
+  if (!result) {
+    return;
+  }
+
+  do {
+    uint16_t component = result->getNumber<uint16_t>("component");
+    if (component > PLAYER_STATE_LAST) {
+      continue;
+    }
+
+    unsigned long size;
+    const char* data = result->getStream("data", size);
+    if (!IOPlayerState::uncompress(data, size, context.state[component])) {
+      SPDLOG_ERROR("[IOLoginData::fetchPlayerState] - Corrupted state {} of player {}", component, guid);
+      context.corruptedState = true;
+    }
+  } while (result->next());
 }
 
-bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
+bool IOLoginData::loadPlayer(Player* player, PlayerLoadContext& context)
 {
+  DBResult_ptr result = context.player;
   if (!result) {
     return false;
   }
 
-  Database& db = Database::getInstance();
+  // saving the player would overwrite what is left of the broken state
+  if (context.corruptedState) {
+    return false;
+  }
 
-  uint32_t accountId = result->getNumber<uint32_t>("account_id");
-  account::Account acc;
-  acc.SetDatabaseInterface(&db);
-  acc.LoadAccountDB(accountId);
+  Database& db = Database::getInstance();
 
+  account::Account& acc = context.account;
   player->setGUID(result->getNumber<uint32_t>("id"));
   player->name = result->getString("name");
   acc.GetID(&(player->accountNumber));
@@ -168,7 +395,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     acc.GetPremiumRemaningDays(&(player->premiumDays));
   }
 
-  acc.GetCoins(&(player->coinBalance));
+  player->coinBalance = context.coins;
 
   Group* group = g_game().groups.getGroup(result->getNumber<uint16_t>("group_id"));
   if (!group) {
@@ -176,6 +403,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     return false;
   }
   player->setGroup(group);
+  g_playerNameCache().add(player->getGUID(), player->name, group->id);
 
   player->setBankBalance(result->getNumber<uint64_t>("balance"));
 
@@ -332,9 +560,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   player->setManaShield(result->getNumber<uint16_t>("manashield"));
   player->setMaxManaShield(result->getNumber<uint16_t>("max_manashield"));
 
-  std::ostringstream query;
-  query << "SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.guildMembership)) {
     uint32_t guildId = result->getNumber<uint32_t>("guild_id");
     uint32_t playerRankId = result->getNumber<uint32_t>("rank_id");
     player->guildNick = result->getString("nick");
@@ -349,10 +575,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
       player->guild = guild;
       GuildRank_ptr rank = guild->getRankById(playerRankId);
       if (!rank) {
-        query.str(std::string());
-        query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = " << playerRankId;
-
-        if ((result = db.storeQuery(query.str()))) {
+        if ((result = db.storeQuery(DBStatement("SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = ?").bind(playerRankId)))) {
           guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
         }
 
@@ -364,29 +587,32 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
       player->guildRank = rank;
 
-      IOGuild::getWarList(guildId, player->guildWarVector);
+      player->guildWarVector = std::move(context.guildWars);
 
-      query.str(std::string());
-      query << "SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = " << guildId;
-      if ((result = db.storeQuery(query.str()))) {
+      if ((result = context.guildMemberCount)) {
         guild->setMemberCount(result->getNumber<uint32_t>("members"));
       }
     }
   }
 
   // Stash load items
-  query.str(std::string());
-  query << "SELECT `item_count`, `item_id`  FROM `player_stash` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.stash)) {
     do {
       player->addItemOnStash(result->getNumber<uint16_t>("item_id"), result->getNumber<uint32_t>("item_count"));
     } while (result->next());
+  } else if (const std::vector<char>& state = context.state[PLAYER_STATE_STASH]; !state.empty()) {
+    PropStream propStream;
+    propStream.init(state.data(), state.size());
+
+    uint16_t itemId;
+    uint32_t count;
+    while (IOPlayerState::readStash(propStream, itemId, count)) {
+      player->addItemOnStash(itemId, count);
+    }
   }
 
   // Bestiary charms
-  query.str(std::string());
-  query << "SELECT * FROM `player_charms` WHERE `player_guid` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.charms)) {
 	player->charmPoints = result->getNumber<uint32_t>("charm_points");
 	player->charmExpansion = result->getNumber<bool>("charm_expansion");
 	player->charmRuneWound = result->getNumber<uint16_t>("rune_wound");
@@ -423,17 +649,9 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
       player->addBestiaryTrackerList(tmp_tt);
     }
   }
-
-
-  } else {
-	query.str(std::string());
-	query << "INSERT INTO `player_charms` (`player_guid`) VALUES (" << player->getGUID() << ')';
-	Database::getInstance().executeQuery(query.str());
   }
 
-  query.str(std::string());
-  query << "SELECT `player_id`, `name` FROM `player_spells` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.spells)) {
     do {
       player->learnedInstantSpellList.emplace_front(result->getString("name"));
     } while (result->next());
@@ -442,9 +660,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
   //load inventory items
   ItemMap itemMap;
 
-  query.str(std::string());
-  query << "SELECT `player_id`, `time`, `target`, `unavenged` FROM `player_kills` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.kills)) {
     do {
       time_t killTime = result->getNumber<time_t>("time");
       if ((time(nullptr) - killTime) <= g_configManager().getNumber(FRAG_TIME)) {
@@ -453,13 +669,9 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     } while (result->next());
   }
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_items` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-
   std::vector<std::pair<uint8_t, Container*>> openContainersList;
 
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
+  if (loadItems(itemMap, context.items, context.state[PLAYER_STATE_ITEMS])) {
 
     for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
       const std::pair<Item*, int32_t>& pair = it->second;
@@ -518,50 +730,20 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     player->internalAddThing(CONST_SLOT_STORE_INBOX, Item::CreateItem(ITEM_STORE_INBOX));
   }
 
-  //load depot items
-  itemMap.clear();
-
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_depotitems` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
-    for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
-      const std::pair<Item*, int32_t>& pair = it->second;
-      Item* item = pair.first;
-
-      int32_t pid = pair.second;
-      if (pid >= 0 && pid < 100) {
-        DepotChest* depotChest = player->getDepotChest(pid, true);
-        if (depotChest) {
-          depotChest->internalAddThing(item);
-          item->startDecaying();
-        }
-      } else {
-        ItemMap::const_iterator it2 = itemMap.find(pid);
-        if (it2 == itemMap.end()) {
-          continue;
-        }
-
-        Container* container = it2->second.first->getContainer();
-        if (container) {
-          container->internalAddThing(item);
-          item->startDecaying();
-        }
-      }
-    }
+  if (context.lazyDepot) {
+    // read on first use, see Player::loadDepot
+    player->depotPending = true;
+  } else {
+    loadDepotItems(player, context);
   }
 
   //load reward chest items
   itemMap.clear();
 
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_rewards` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-    if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
+  if (loadItems(itemMap, context.rewardItems, context.state[PLAYER_STATE_REWARDS])) {
 
     //first loop handles the reward containers to retrieve its date attribute
-    //for (ItemMap::iterator it = itemMap.begin(), end = itemMap.end(); it != end; ++it) {
+    //offline rewards are appended after the saved rows, so the bags are not only the lowest sids
     for (auto& it : itemMap) {
       const std::pair<Item*, int32_t>& pair = it.second;
       Item* item = pair.first;
@@ -572,8 +754,6 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
         if (reward) {
           it.second = std::pair<Item*, int32_t>(reward->getItem(), pid); //update the map with the special reward container
         }
-      } else {
-        break;
       }
     }
 
@@ -585,7 +765,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
       int32_t pid = pair.second;
       if (pid >= 0 && pid < 100) {
-        break;
+        continue;
       }
 
       ItemMap::const_iterator it2 = itemMap.find(pid);
@@ -600,51 +780,25 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     }
   }
 
-  //load inbox items
-  itemMap.clear();
-
-  query.str(std::string());
-  query << "SELECT `pid`, `sid`, `itemtype`, `count`, `attributes` FROM `player_inboxitems` WHERE `player_id` = " << player->getGUID() << " ORDER BY `sid` DESC";
-  if ((result = db.storeQuery(query.str()))) {
-    loadItems(itemMap, result);
-
-    for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
-      const std::pair<Item*, int32_t>& pair = it->second;
-      Item* item = pair.first;
-      int32_t pid = pair.second;
-
-      if (pid >= 0 && pid < 100) {
-        player->getInbox()->internalAddThing(item);
-        item->startDecaying();
-      } else {
-        ItemMap::const_iterator it2 = itemMap.find(pid);
-
-        if (it2 == itemMap.end()) {
-          continue;
-        }
-
-        Container* container = it2->second.first->getContainer();
-        if (container) {
-          container->internalAddThing(item);
-          item->startDecaying();
-        }
-      }
-    }
-  }
-
   //load storage map
-  query.str(std::string());
-  query << "SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.storage)) {
     do {
       player->addStorageValue(result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"), true);
     } while (result->next());
+  } else if (const std::vector<char>& state = context.state[PLAYER_STATE_STORAGE]; !state.empty()) {
+    PropStream propStream;
+    propStream.init(state.data(), state.size());
+
+    uint32_t key;
+    int32_t value;
+    while (IOPlayerState::readStorage(propStream, key, value)) {
+      player->addStorageValue(key, value, true);
+    }
   }
+  player->storage.setSynced(true);
 
   //load vip
-  query.str(std::string());
-  query << "SELECT `player_id` FROM `account_viplist` WHERE `account_id` = " << player->getAccount();
-  if ((result = db.storeQuery(query.str()))) {
+  if ((result = context.vip)) {
     do {
       player->addVIPInternal(result->getNumber<uint32_t>("player_id"));
     } while (result->next());
@@ -652,9 +806,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
   // Load prey class
   if (g_configManager().getBoolean(PREY_ENABLED)) {
-    query.str(std::string());
-    query << "SELECT * FROM `player_prey` WHERE `player_id` = " << player->getGUID();
-    if (result = db.storeQuery(query.str())) {
+    if ((result = context.prey)) {
       do {
         auto slot = new PreySlot(static_cast<PreySlot_t>(result->getNumber<uint16_t>("slot")));
         slot->state = static_cast<PreyDataState_t>(result->getNumber<uint16_t>("state"));
@@ -683,9 +835,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
   // Load task hunting class
   if (g_configManager().getBoolean(TASK_HUNTING_ENABLED)) {
-    query.str(std::string());
-    query << "SELECT * FROM `player_taskhunt` WHERE `player_id` = " << player->getGUID();
-    if (result = db.storeQuery(query.str())) {
+    if ((result = context.taskHunt)) {
       do {
         auto slot = new TaskHuntingSlot(static_cast<PreySlot_t>(result->getNumber<uint16_t>("slot")));
         slot->state = static_cast<PreyTaskDataState_t>(result->getNumber<uint16_t>("state"));
@@ -719,23 +869,47 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 	player->initializeTaskHunting();
   player->updateBaseSpeed();
   player->updateInventoryWeight();
-  player->updateInventoryImbuement(true);
+  player->updateInventoryImbuement();
   player->updateItemsLight(true);
   return true;
 }
 
-bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream)
+void IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList, PlayerStateComponent_t component, std::vector<DBStatement>& queries, PropWriteStream& propWriteStream)
 {
+  if (IOPlayerState::isEnabled()) {
+    PropWriteStream stateStream;
+    int32_t lastSid = 0;
+    serializeItems(player, itemList, propWriteStream, [&stateStream, &lastSid](const PlayerItemRow& row) {
+      IOPlayerState::writeItem(stateStream, lastSid, row);
+      return true;
+    });
+    IOPlayerState::addSaveStatement(player->getGUID(), component, stateStream, queries);
+    return;
+  }
+
   Database& db = Database::getInstance();
+  const std::string tableName = IOPlayerState::getTableName(component);
+  queries.push_back(DBStatement("DELETE FROM `" + tableName + "` WHERE `player_id` = ?").bind(player->getGUID()));
 
+  DBInsert query_insert("INSERT INTO `" + tableName + "` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ", queries);
   std::ostringstream ss;
+  serializeItems(player, itemList, propWriteStream, [&](const PlayerItemRow& row) {
+    ss << player->getGUID() << ',' << row.pid << ',' << row.sid << ',' << row.itemType << ',' << row.count << ',' << db.escapeBlob(row.attributes, static_cast<uint32_t>(row.attributesSize));
+    return query_insert.addRow(ss);
+  });
+  query_insert.execute();
+}
 
+bool IOLoginData::serializeItems(const Player* player, const ItemBlockList& itemList, PropWriteStream& propWriteStream, const std::function<bool(const PlayerItemRow&)>& addRow)
+{
   using ContainerBlock = std::pair<Container*, int32_t>;
   std::list<ContainerBlock> queue;
 
   int32_t runningId = 100;
 
-  const auto& openContainers = player->getOpenContainers();
+  // no player for items that are not carried by one yet, as an offline reward
+  static const std::map<uint8_t, OpenContainer> noOpenContainers;
+  const auto& openContainers = player ? player->getOpenContainers() : noOpenContainers;
   for (const auto& it : itemList) {
     int32_t pid = it.first;
     Item* item = it.second;
@@ -764,14 +938,15 @@ bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList,
     propWriteStream.clear();
     item->serializeAttr(propWriteStream);
 
-    size_t attributesSize;
-    const char* attributes = propWriteStream.getStream(attributesSize);
-
-    ss << player->getGUID() << ',' << pid << ',' << runningId << ',' << item->getID() << ',' << item->getSubType() << ',' << db.escapeBlob(attributes, attributesSize);
-    if (!query_insert.addRow(ss)) {
+    PlayerItemRow row;
+    row.pid = pid;
+    row.sid = runningId;
+    row.itemType = item->getID();
+    row.count = item->getSubType();
+    row.attributes = propWriteStream.getStream(row.attributesSize);
+    if (!addRow(row)) {
       return false;
     }
-
   }
 
   while (!queue.empty()) {
@@ -806,41 +981,374 @@ bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList,
       propWriteStream.clear();
       item->serializeAttr(propWriteStream);
 
-      size_t attributesSize;
-      const char* attributes = propWriteStream.getStream(attributesSize);
-
-      ss << player->getGUID() << ',' << parentId << ',' << runningId << ',' << item->getID() << ',' << item->getSubType() << ',' << db.escapeBlob(attributes, attributesSize);
-      if (!query_insert.addRow(ss)) {
+      PlayerItemRow row;
+      row.pid = parentId;
+      row.sid = runningId;
+      row.itemType = item->getID();
+      row.count = item->getSubType();
+      row.attributes = propWriteStream.getStream(row.attributesSize);
+      if (!addRow(row)) {
         return false;
       }
     }
   }
-  return query_insert.execute();
+  return true;
+}
+
+void IOLoginData::loadDepotItems(Player* player, PlayerLoadContext& context)
+{
+  //load depot items
+  ItemMap itemMap;
+  if (loadItems(itemMap, context.depotItems, context.state[PLAYER_STATE_DEPOT])) {
+
+    for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
+      const std::pair<Item*, int32_t>& pair = it->second;
+      Item* item = pair.first;
+
+      int32_t pid = pair.second;
+      if (pid >= 0 && pid < 100) {
+        DepotChest* depotChest = player->getDepotChest(pid, true);
+        if (depotChest) {
+          depotChest->internalAddThing(item);
+          item->startDecaying();
+        }
+      } else {
+        ItemMap::const_iterator it2 = itemMap.find(pid);
+        if (it2 == itemMap.end()) {
+          continue;
+        }
+
+        Container* container = it2->second.first->getContainer();
+        if (container) {
+          container->internalAddThing(item);
+          item->startDecaying();
+        }
+      }
+    }
+  }
+
+  //load inbox items
+  itemMap.clear();
+
+  if (loadItems(itemMap, context.inboxItems, context.state[PLAYER_STATE_INBOX])) {
+
+    for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
+      const std::pair<Item*, int32_t>& pair = it->second;
+      Item* item = pair.first;
+      int32_t pid = pair.second;
+
+      if (pid >= 0 && pid < 100) {
+        player->getInbox()->internalAddThing(item);
+        item->startDecaying();
+      } else {
+        ItemMap::const_iterator it2 = itemMap.find(pid);
+
+        if (it2 == itemMap.end()) {
+          continue;
+        }
+
+        Container* container = it2->second.first->getContainer();
+        if (container) {
+          container->internalAddThing(item);
+          item->startDecaying();
+        }
+      }
+    }
+  }
+}
+
+void IOLoginData::loadDepotAsync(Player* player)
+{
+  auto context = std::make_shared<PlayerLoadContext>();
+  uint32_t guid = player->getGUID();
+  uint32_t playerId = player->getID();
+  auto fetch = [context, guid](Database& db) {
+    fetchDepotData(db, guid, *context);
+    return true;
+  };
+  auto done = [context, playerId](DBResult_ptr, bool) {
+    if (Player* player = g_game().getPlayerByID(playerId)) {
+      applyDepotData(player, *context);
+      player->onDepotLoaded();
+    }
+  };
+
+  // keyed by guid like the saves, which leave the depot alone while it is not read
+  if (!g_databaseTasks().addTask(fetch, done, guid, guid)) {
+    fetch(Database::getInstance());
+    done(nullptr, true);
+  }
+}
+
+void IOLoginData::loadDepot(Player* player)
+{
+  PlayerLoadContext context;
+  fetchDepotData(Database::getInstance(), player->getGUID(), context);
+  applyDepotData(player, context);
+}
+
+void IOLoginData::applyDepotData(Player* player, PlayerLoadContext& context)
+{
+  // read in between by loadDepot
+  if (!player->depotPending) {
+    return;
+  }
+  player->depotPending = false;
+
+  if (context.corruptedState) {
+    // as a corrupted state at login: the broken rows are kept and the player is not let in
+    SPDLOG_ERROR("[IOLoginData::applyDepotData] - Corrupted depot of player {}, kicking", player->getName());
+    player->depotCorrupted = true;
+    g_dispatcher().addTask(createTask(std::bind(&Game::kickPlayer, &g_game(), player->getID(), false)));
+    return;
+  }
+
+  loadDepotItems(player, context);
 }
 
 bool IOLoginData::savePlayer(Player* player)
 {
-  if (player->getHealth() <= 0) {
-    player->changeHealth(1);
+  DispatcherActivity activity("IOLoginData::savePlayer", player->getName());
+  waitForPendingSave(player->getGUID());
+
+  PlayerSaveSnapshot snapshot;
+  capturePlayer(player, snapshot);
+  bool written = false;
+  int64_t start = DispatcherProfiler::getTimeMicros();
+  bool success = persistPlayer(Database::getInstance(), snapshot, written);
+  playerSaveTime.observe(DispatcherProfiler::getTimeMicros() - start);
+  if (!written) {
+    resetSavedState(player);
+  }
+  return success;
+}
+
+void IOLoginData::savePlayerAsync(Player* player)
+{
+  auto snapshot = std::make_shared<PlayerSaveSnapshot>();
+  capturePlayer(player, *snapshot);
+
+  uint32_t guid = snapshot->guid;
+  uint32_t playerId = player->getID();
+  uint32_t accountId = player->getAccount();
+  // true once every section of the snapshot is in the database
+  auto persist = [snapshot](Database& db) {
+    bool written = false;
+    int64_t start = DispatcherProfiler::getTimeMicros();
+    for (uint32_t tries = 0; tries < 3; ++tries) {
+      if (persistPlayer(db, *snapshot, written)) {
+        playerSaveTime.observe(DispatcherProfiler::getTimeMicros() - start);
+        return written;
+      }
+    }
+    playerSaveTime.observe(DispatcherProfiler::getTimeMicros() - start);
+    SPDLOG_WARN("[IOLoginData::savePlayerAsync] - Error while saving player: {}", snapshot->name);
+    return false;
+  };
+  auto done = [guid, playerId, accountId](DBResult_ptr, bool written) {
+    finishPendingSave(guid);
+    // the replica lag counts from the write, not from the capture
+    Database::markWritten(Database::getPlayerKey(guid));
+    Database::markWritten(Database::getAccountKey(accountId));
+
+    Player* player;
+    if (!written && (player = g_game().getPlayerByID(playerId))) {
+      resetSavedState(player);
+    }
+  };
+
+  if (!g_databaseTasks().addTask(persist, done, guid, guid)) {
+    // no worker is running, write it here
+    if (!persist(Database::getInstance())) {
+      resetSavedState(player);
+    }
+    return;
   }
-  Database& db = Database::getInstance();
+  ++pendingSaves[guid];
+}
 
-  std::ostringstream query;
-  query << "SELECT `save` FROM `players` WHERE `id` = " << player->getGUID();
-  DBResult_ptr result = db.storeQuery(query.str());
+void IOLoginData::flushPlayerStorage(Player* player)
+{
+  if (!player->storage.isSynced() || !player->storage.hasChanges()) {
+    return;
+  }
+
+  auto queries = std::make_shared<std::vector<DBStatement>>();
+  if (IOPlayerState::isEnabled()) {
+    captureStorageState(player, *queries);
+    // the next save writes the storage again, even if it is back to what that save wrote last
+    player->savedFingerprints[PLAYER_SAVE_STORAGE] = 0;
+  } else {
+    captureStorageChanges(player, *queries);
+  }
+
+  uint32_t guid = player->getGUID();
+  uint32_t playerId = player->getID();
+  auto persist = [queries, guid](Database& db) {
+    for (uint32_t tries = 0; tries < 3; ++tries) {
+      if (persistStorage(db, guid, *queries)) {
+        return true;
+      }
+    }
+    SPDLOG_WARN("[IOLoginData::flushPlayerStorage] - Error while saving the storage of player: {}", guid);
+    return false;
+  };
+  auto done = [guid, playerId](DBResult_ptr, bool success) {
+    finishPendingSave(guid);
+
+    Player* player;
+    if (!success && (player = g_game().getPlayerByID(playerId))) {
+      // the changes are lost, the next save writes the whole storage
+      player->storage.setSynced(false);
+    }
+  };
+
+  if (!g_databaseTasks().addTask(persist, done, guid, guid)) {
+    if (!persist(Database::getInstance())) {
+      player->storage.setSynced(false);
+    }
+    return;
+  }
+  ++pendingSaves[guid];
+}
+
+bool IOLoginData::persistStorage(Database& db, uint32_t guid, const std::vector<DBStatement>& queries)
+{
+  DBResult_ptr result = db.storeQuery(DBStatement("SELECT `save` FROM `players` WHERE `id` = ?").bind(guid));
   if (!result) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error for select result query from player: {}", player->getName());
     return false;
   }
 
   if (result->getNumber<uint16_t>("save") == 0) {
-    query.str(std::string());
-    query << "UPDATE `players` SET `lastlogin` = " << player->lastLoginSaved << ", `lastip` = " << player->lastIP << " WHERE `id` = " << player->getGUID();
-    return db.executeQuery(query.str());
+    return true;
+  }
+
+  DBTransaction transaction(db);
+  if (!transaction.begin()) {
+    return false;
+  }
+
+  for (const DBStatement& statement : queries) {
+    if (!db.executeQuery(statement)) {
+      return false;
+    }
+  }
+  return transaction.commit();
+}
+
+void IOLoginData::addOfflineReward(uint32_t guid, uint32_t timestamp, const std::vector<std::pair<uint16_t, uint16_t>>& loot)
+{
+  Item* bag = Item::CreateItem(ITEM_REWARD_CONTAINER);
+  Container* container = bag ? bag->getContainer() : nullptr;
+  if (!container) {
+    delete bag;
+    return;
+  }
+
+  bag->setIntAttr(ITEM_ATTRIBUTE_DATE, timestamp);
+  for (const auto& [itemId, count] : loot) {
+    if (Item* item = Item::CreateItem(itemId, count)) {
+      container->internalAddThing(item);
+    }
+  }
+  bag->incrementReferenceCounter();
+
+  auto rows = std::make_shared<std::vector<RewardItemRow>>();
+  PropWriteStream propWriteStream;
+  serializeItems(nullptr, {{0, bag}}, propWriteStream, [&rows](const PlayerItemRow& row) {
+    rows->push_back({row.pid, row.sid, row.itemType, row.count, std::string(row.attributes, row.attributesSize)});
+    return true;
+  });
+
+  auto persist = [rows, guid](Database& db) {
+    for (uint32_t tries = 0; tries < 3; ++tries) {
+      if (appendRewardRows(db, guid, *rows)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  auto done = [guid, timestamp, bag](DBResult_ptr, bool success) {
+    finishPendingSave(guid);
+
+    // a login read before the write misses the bag and its next save would drop the rows, so it gets the items here
+    Player* player = g_game().getPlayerByGUID(guid);
+    if (player && !player->getReward(timestamp, false)) {
+      Reward* reward = player->getReward(timestamp, true);
+      for (const Item* item : bag->getContainer()->getItemList()) {
+        reward->internalAddThing(item->clone());
+      }
+    } else if (!success) {
+      SPDLOG_WARN("[IOLoginData::addOfflineReward] - Error while saving the reward {} of player {}", timestamp, guid);
+    }
+    bag->decrementReferenceCounter();
+  };
+
+  // keyed by guid, so it runs between the saves and loads of the player
+  if (!g_databaseTasks().addTask(persist, done, guid, guid)) {
+    waitForPendingSave(guid);
+    done(nullptr, persist(Database::getInstance()));
+    return;
+  }
+  ++pendingSaves[guid];
+}
+
+void IOLoginData::waitForPendingSave(uint32_t guid)
+{
+  g_forkedSave().waitForPlayer(guid);
+  if (pendingSaves.find(guid) != pendingSaves.end()) {
+    g_databaseTasks().flush(guid);
+  }
+}
+
+bool IOLoginData::persistPlayer(Database& db, const PlayerSaveSnapshot& snapshot, bool& written)
+{
+  written = false;
+  DBResult_ptr result = db.storeQuery(DBStatement("SELECT `save` FROM `players` WHERE `id` = ?").bind(snapshot.guid));
+  if (!result) {
+    SPDLOG_WARN("[IOLoginData::savePlayer] - Error for select result query from player: {}", snapshot.name);
+    return false;
+  }
+
+  if (result->getNumber<uint16_t>("save") == 0) {
+    return db.executeQuery(DBStatement("UPDATE `players` SET `lastlogin` = ?, `lastip` = ? WHERE `id` = ?").bind(snapshot.lastLogin).bind(snapshot.lastIP).bind(snapshot.guid));
+  }
+
+  DBTransaction transaction(db);
+  if (!transaction.begin()) {
+    return false;
+  }
+
+  for (const DBStatement& statement : snapshot.queries) {
+    if (!db.executeQuery(statement)) {
+      SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving player: {}", snapshot.name);
+      return false;
+    }
+  }
+
+  //End the transaction
+  written = transaction.commit();
+  return written;
+}
+
+void IOLoginData::capturePlayer(Player* player, PlayerSaveSnapshot& snapshot)
+{
+  player->updateInventoryImbuement();
+  if (player->getHealth() <= 0) {
+    player->changeHealth(1);
   }
+  Database& db = Database::getInstance();
+
+  snapshot.guid = player->getGUID();
+  snapshot.name = player->getName();
+  // the character list of the account shows the player too
+  Database::markWritten(Database::getPlayerKey(snapshot.guid));
+  Database::markWritten(Database::getAccountKey(player->getAccount()));
+  snapshot.lastLogin = player->lastLoginSaved;
+  snapshot.lastIP = player->lastIP;
 
   //First, an UPDATE query to write the player itself
-  query.str(std::string());
+  std::ostringstream query;
   query << "UPDATE `players` SET ";
   query << "`level` = " << player->level << ',';
   query << "`group_id` = " << player->group->id << ',';
@@ -894,6 +1402,7 @@ bool IOLoginData::savePlayer(Player* player)
       propWriteStream.write<uint8_t>(CONDITIONATTR_END);
     }
   }
+  player->serializeSpellCooldowns(propWriteStream);
 
   size_t attributesSize;
   const char* attributes = propWriteStream.getStream(attributesSize);
@@ -963,55 +1472,38 @@ bool IOLoginData::savePlayer(Player* player)
   }
   query << " WHERE `id` = " << player->getGUID();
 
-  DBTransaction transaction;
-  if (!transaction.begin()) {
-    return false;
-  }
-
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  snapshot.queries.push_back(DBStatement(query.str()));
 
   // Stash save items
-  query.str(std::string());
-  query << "DELETE FROM `player_stash` WHERE `player_id` = " << player->getGUID();
-  db.executeQuery(query.str());
-  for (auto it : player->getStashItems()) {
-	query.str(std::string());
-    query << "INSERT INTO `player_stash` (`player_id`,`item_id`,`item_count`) VALUES (";
-    query << player->getGUID() << ", ";
-    query << it.first << ", ";
-    query << it.second << ")";
-	db.executeQuery(query.str());
+  size_t sectionBegin = snapshot.queries.size();
+  if (IOPlayerState::isEnabled()) {
+    PropWriteStream stateStream;
+    for (const auto& [itemId, count] : player->getStashItems()) {
+      IOPlayerState::writeStash(stateStream, itemId, count);
+    }
+    IOPlayerState::addSaveStatement(player->getGUID(), PLAYER_STATE_STASH, stateStream, snapshot.queries);
+  } else {
+    snapshot.queries.push_back(DBStatement("DELETE FROM `player_stash` WHERE `player_id` = ?").bind(player->getGUID()));
+    for (auto it : player->getStashItems()) {
+      snapshot.queries.push_back(DBStatement("INSERT INTO `player_stash` (`player_id`,`item_id`,`item_count`) VALUES (?, ?, ?)").bind(player->getGUID()).bind(it.first).bind(it.second));
+    }
   }
+  skipUnchangedSection(player, snapshot, PLAYER_SAVE_STASH, sectionBegin);
 
   // learned spells
-  query.str(std::string());
-  query << "DELETE FROM `player_spells` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  sectionBegin = snapshot.queries.size();
+  snapshot.queries.push_back(DBStatement("DELETE FROM `player_spells` WHERE `player_id` = ?").bind(player->getGUID()));
 
   query.str(std::string());
 
-  DBInsert spellsQuery("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ");
+  DBInsert spellsQuery("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ", snapshot.queries);
   for (const std::string& spellName : player->learnedInstantSpellList) {
     query << player->getGUID() << ',' << db.escapeString(spellName);
-    if (!spellsQuery.addRow(query)) {
-      return false;
-    }
-  }
-
-  if (!spellsQuery.execute()) {
-    return false;
+    spellsQuery.addRow(query);
   }
 
-  //player kills
-  query.str(std::string());
-  query << "DELETE FROM `player_kills` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  spellsQuery.execute();
+  skipUnchangedSection(player, snapshot, PLAYER_SAVE_SPELLS, sectionBegin);
 
   //player bestiary charms
   query.str(std::string());
@@ -1050,34 +1542,25 @@ bool IOLoginData::savePlayer(Player* player)
   query << " `tracker list` = " << db.escapeBlob(trackerList, trackerSize);
   query << " WHERE `player_guid` = " << player->getGUID();
 
-  if (!db.executeQuery(query.str())) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving bestiary data from player: {}", player->getName());
-    return false;
-  }
+  snapshot.queries.push_back(DBStatement(query.str()));
+
+  //player kills
+  sectionBegin = snapshot.queries.size();
+  snapshot.queries.push_back(DBStatement("DELETE FROM `player_kills` WHERE `player_id` = ?").bind(player->getGUID()));
 
   query.str(std::string());
 
-  DBInsert killsQuery("INSERT INTO `player_kills` (`player_id`, `target`, `time`, `unavenged`) VALUES");
+  DBInsert killsQuery("INSERT INTO `player_kills` (`player_id`, `target`, `time`, `unavenged`) VALUES", snapshot.queries);
   for (const auto& kill : player->unjustifiedKills) {
     query << player->getGUID() << ',' << kill.target << ',' << kill.time << ',' << kill.unavenged;
-    if (!killsQuery.addRow(query)) {
-      return false;
-    }
+    killsQuery.addRow(query);
   }
 
-  if (!killsQuery.execute()) {
-    return false;
-  }
+  killsQuery.execute();
+  skipUnchangedSection(player, snapshot, PLAYER_SAVE_KILLS, sectionBegin);
 
   //item saving
-  query << "DELETE FROM `player_items` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Error delete query 'player_items' from player: {}", player->getName());
-    return false;
-  }
-
-  DBInsert itemsQuery("INSERT INTO `player_items` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
-
+  sectionBegin = snapshot.queries.size();
   ItemBlockList itemList;
   for (int32_t slotId = CONST_SLOT_FIRST; slotId <= CONST_SLOT_LAST; ++slotId) {
     Item* item = player->inventory[slotId];
@@ -1086,21 +1569,12 @@ bool IOLoginData::savePlayer(Player* player)
     }
   }
 
-  if (!saveItems(player, itemList, itemsQuery, propWriteStream)) {
-    SPDLOG_WARN("[IOLoginData::savePlayer] - Failed for save items from player: {}", player->getName());
-    return false;
-  }
+  saveItems(player, itemList, PLAYER_STATE_ITEMS, snapshot.queries, propWriteStream);
+  skipUnchangedSection(player, snapshot, PLAYER_SAVE_ITEMS, sectionBegin);
 
-  if (player->lastDepotId != -1) {
+  if (player->lastDepotId != -1 && player->canSaveDepot()) {
     //save depot items
-    query.str(std::string());
-    query << "DELETE FROM `player_depotitems` WHERE `player_id` = " << player->getGUID();
-
-    if (!db.executeQuery(query.str())) {
-      return false;
-    }
-
-    DBInsert depotQuery("INSERT INTO `player_depotitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
+    sectionBegin = snapshot.queries.size();
     itemList.clear();
 
     for (const auto& it : player->depotChests) {
@@ -1110,81 +1584,61 @@ bool IOLoginData::savePlayer(Player* player)
       }
     }
 
-    if (!saveItems(player, itemList, depotQuery, propWriteStream)) {
-      return false;
-    }
+    saveItems(player, itemList, PLAYER_STATE_DEPOT, snapshot.queries, propWriteStream);
+    skipUnchangedSection(player, snapshot, PLAYER_SAVE_DEPOT, sectionBegin);
   }
 
   //save reward items
-  query.str(std::string());
-  query << "DELETE FROM `player_rewards` WHERE `player_id` = " << player->getGUID();
-
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  sectionBegin = snapshot.queries.size();
+  itemList.clear();
 
   std::vector<uint32_t> rewardList;
   player->getRewardList(rewardList);
 
-  if (!rewardList.empty()) {
-    DBInsert rewardQuery("INSERT INTO `player_rewards` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
-    itemList.clear();
-
-    int running = 0;
-    for (const auto& rewardId : rewardList) {
-      Reward* reward = player->getReward(rewardId, false);
-      // rewards that are empty or older than 7 days aren't stored
-      if (!reward->empty() && (time(nullptr) - rewardId <= 60 * 60 * 24 * 7)) {
-        itemList.emplace_back(++running, reward);
-      }
-    }
-
-    if (!saveItems(player, itemList, rewardQuery, propWriteStream)) {
-      return false;
+  int running = 0;
+  for (const auto& rewardId : rewardList) {
+    Reward* reward = player->getReward(rewardId, false);
+    // rewards that are empty or older than 7 days aren't stored
+    if (!reward->empty() && (time(nullptr) - rewardId <= 60 * 60 * 24 * 7)) {
+      itemList.emplace_back(++running, reward);
     }
   }
 
-  //save inbox items
-  query.str(std::string());
-  query << "DELETE FROM `player_inboxitems` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
-  }
+  saveItems(player, itemList, PLAYER_STATE_REWARDS, snapshot.queries, propWriteStream);
+  skipUnchangedSection(player, snapshot, PLAYER_SAVE_REWARDS, sectionBegin);
 
-  DBInsert inboxQuery("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`) VALUES ");
-  itemList.clear();
+  //save inbox items, the saved rows stay as they are until the depot is read
+  if (player->canSaveDepot()) {
+    sectionBegin = snapshot.queries.size();
+    itemList.clear();
 
-  for (Item* item : player->getInbox()->getItemList()) {
-    itemList.emplace_back(0, item);
-  }
+    for (Item* item : player->getInbox()->getItemList()) {
+      itemList.emplace_back(0, item);
+    }
 
-  if (!saveItems(player, itemList, inboxQuery, propWriteStream)) {
-    return false;
+    saveItems(player, itemList, PLAYER_STATE_INBOX, snapshot.queries, propWriteStream);
+    skipUnchangedSection(player, snapshot, PLAYER_SAVE_INBOX, sectionBegin);
   }
 
   // Save prey class
   if (g_configManager().getBoolean(PREY_ENABLED)) {
-    query.str(std::string());
-    query << "DELETE FROM `player_prey` WHERE `player_id` = " << player->getGUID();
-    if (!db.executeQuery(query.str())) {
-      return false;
-    }
+    sectionBegin = snapshot.queries.size();
+    snapshot.queries.push_back(DBStatement("DELETE FROM `player_prey` WHERE `player_id` = ?").bind(player->getGUID()));
 
     for (uint8_t slotId = PreySlot_First; slotId <= PreySlot_Last; slotId++) {
       PreySlot* slot = player->getPreySlotById(static_cast<PreySlot_t>(slotId));
       if (slot) {
-        query.str(std::string());
-        query << "INSERT INTO `player_prey` (`player_id`, `slot`, `state`, `raceid`, `option`, `bonus_type`, `bonus_rarity`, `bonus_percentage`, `bonus_time`, `free_reroll`, `monster_list`) VALUES (";
-          query << player->getGUID() << ", ";
-          query << static_cast<uint16_t>(slot->id) << ", ";
-          query << static_cast<uint16_t>(slot->state) << ", ";
-          query << slot->selectedRaceId << ", ";
-          query << static_cast<uint16_t>(slot->option) << ", ";
-          query << static_cast<uint16_t>(slot->bonus) << ", ";
-          query << static_cast<uint16_t>(slot->bonusRarity) << ", ";
-          query << slot->bonusPercentage << ", ";
-          query << slot->bonusTimeLeft << ", ";
-          query << slot->freeRerollTimeStamp << ", ";
+        DBStatement statement("INSERT INTO `player_prey` (`player_id`, `slot`, `state`, `raceid`, `option`, `bonus_type`, `bonus_rarity`, `bonus_percentage`, `bonus_time`, `free_reroll`, `monster_list`) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        statement.bind(player->getGUID());
+        statement.bind(static_cast<uint16_t>(slot->id));
+        statement.bind(static_cast<uint16_t>(slot->state));
+        statement.bind(slot->selectedRaceId);
+        statement.bind(static_cast<uint16_t>(slot->option));
+        statement.bind(static_cast<uint16_t>(slot->bonus));
+        statement.bind(static_cast<uint16_t>(slot->bonusRarity));
+        statement.bind(slot->bonusPercentage);
+        statement.bind(slot->bonusTimeLeft);
+        statement.bind(slot->freeRerollTimeStamp);
 
         PropWriteStream propPreyStream;
         std::for_each(slot->raceIdList.begin(), slot->raceIdList.end(), [&propPreyStream](uint16_t raceId)
@@ -1194,38 +1648,32 @@ bool IOLoginData::savePlayer(Player* player)
 
         size_t preySize;
         const char* preyList = propPreyStream.getStream(preySize);
-        query << db.escapeBlob(preyList, static_cast<uint32_t>(preySize)) << ")";
+        statement.bindBlob(preyList, preySize);
 
-        if (!db.executeQuery(query.str())) {
-          SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving prey slot data from player: {}", player->getName());
-          return false;
-        }
+        snapshot.queries.push_back(std::move(statement));
       }
     }
+    skipUnchangedSection(player, snapshot, PLAYER_SAVE_PREY, sectionBegin);
   }
 
   // Save task hunting class
   if (g_configManager().getBoolean(TASK_HUNTING_ENABLED)) {
-    query.str(std::string());
-    query << "DELETE FROM `player_taskhunt` WHERE `player_id` = " << player->getGUID();
-    if (!db.executeQuery(query.str())) {
-      return false;
-    }
+    sectionBegin = snapshot.queries.size();
+    snapshot.queries.push_back(DBStatement("DELETE FROM `player_taskhunt` WHERE `player_id` = ?").bind(player->getGUID()));
 
     for (uint8_t slotId = PreySlot_First; slotId <= PreySlot_Last; slotId++) {
       TaskHuntingSlot* slot = player->getTaskHuntingSlotById(static_cast<PreySlot_t>(slotId));
       if (slot) {
-        query.str(std::string());
-        query << "INSERT INTO `player_taskhunt` (`player_id`, `slot`, `state`, `raceid`, `upgrade`, `rarity`, `kills`, `disabled_time`, `free_reroll`, `monster_list`) VALUES (";
-          query << player->getGUID() << ", ";
-          query << static_cast<uint16_t>(slot->id) << ", ";
-          query << static_cast<uint16_t>(slot->state) << ", ";
-          query << slot->selectedRaceId << ", ";
-          query << (slot->upgrade ? 1 : 0) << ", ";
-          query << static_cast<uint16_t>(slot->rarity) << ", ";
-          query << slot->currentKills << ", ";
-          query << slot->disabledUntilTimeStamp << ", ";
-          query << slot->freeRerollTimeStamp << ", ";
+        DBStatement statement("INSERT INTO `player_taskhunt` (`player_id`, `slot`, `state`, `raceid`, `upgrade`, `rarity`, `kills`, `disabled_time`, `free_reroll`, `monster_list`) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        statement.bind(player->getGUID());
+        statement.bind(static_cast<uint16_t>(slot->id));
+        statement.bind(static_cast<uint16_t>(slot->state));
+        statement.bind(slot->selectedRaceId);
+        statement.bind(slot->upgrade ? 1 : 0);
+        statement.bind(static_cast<uint16_t>(slot->rarity));
+        statement.bind(slot->currentKills);
+        statement.bind(slot->disabledUntilTimeStamp);
+        statement.bind(slot->freeRerollTimeStamp);
 
         PropWriteStream propTaskHuntingStream;
         std::for_each(slot->raceIdList.begin(), slot->raceIdList.end(), [&propTaskHuntingStream](uint16_t raceId)
@@ -1235,80 +1683,161 @@ bool IOLoginData::savePlayer(Player* player)
 
         size_t taskHuntingSize;
         const char* taskHuntingList = propTaskHuntingStream.getStream(taskHuntingSize);
-        query << db.escapeBlob(taskHuntingList, static_cast<uint32_t>(taskHuntingSize)) << ")";
+        statement.bindBlob(taskHuntingList, taskHuntingSize);
 
-        if (!db.executeQuery(query.str())) {
-          SPDLOG_WARN("[IOLoginData::savePlayer] - Error saving task hunting slot data from player: {}", player->getName());
-          return false;
-        }
+        snapshot.queries.push_back(std::move(statement));
       }
     }
+    skipUnchangedSection(player, snapshot, PLAYER_SAVE_TASKHUNT, sectionBegin);
   }
 
-  query.str(std::string());
-  query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-  if (!db.executeQuery(query.str())) {
-    return false;
+  player->genReservedStorageRange();
+  if (IOPlayerState::isEnabled()) {
+    sectionBegin = snapshot.queries.size();
+    captureStorageState(player, snapshot.queries);
+    skipUnchangedSection(player, snapshot, PLAYER_SAVE_STORAGE, sectionBegin);
+    return;
+  }
+
+  if (player->storage.isSynced()) {
+    captureStorageChanges(player, snapshot.queries);
+    return;
   }
 
+  snapshot.queries.push_back(DBStatement("DELETE FROM `player_storage` WHERE `player_id` = ?").bind(player->getGUID()));
+
   query.str(std::string());
 
-  DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ");
-  player->genReservedStorageRange();
+  DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ", snapshot.queries);
+  for (const auto& [key, value] : player->storage.getValues()) {
+    query << player->getGUID() << ',' << key << ',' << value;
+    storageQuery.addRow(query);
+  }
 
-  for (const auto& it : player->storageMap) {
-    query << player->getGUID() << ',' << it.first << ',' << it.second;
-    if (!storageQuery.addRow(query)) {
-      return false;
+  storageQuery.execute();
+  player->storage.clearChanges();
+  player->storage.setSynced(true);
+}
+
+void IOLoginData::skipUnchangedSection(Player* player, PlayerSaveSnapshot& snapshot, PlayerSaveSection_t section, size_t begin)
+{
+  size_t fingerprint = 0;
+  for (size_t i = begin; i < snapshot.queries.size(); ++i) {
+    boost::hash_combine(fingerprint, snapshot.queries[i].getHash());
+  }
+
+  if (fingerprint == player->savedFingerprints[section]) {
+    snapshot.queries.erase(snapshot.queries.begin() + begin, snapshot.queries.end());
+    return;
+  }
+  player->savedFingerprints[section] = fingerprint;
+}
+
+void IOLoginData::captureStorageChanges(Player* player, std::vector<DBStatement>& queries)
+{
+  std::vector<std::pair<uint32_t, int32_t>> updated;
+  std::vector<uint32_t> removed;
+  player->storage.takeChanges(updated, removed);
+
+  std::ostringstream query;
+  if (!removed.empty()) {
+    query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID() << " AND `key` IN (";
+    for (size_t i = 0; i < removed.size(); ++i) {
+      query << (i == 0 ? "" : ",") << removed[i];
     }
+    query << ')';
+    queries.emplace_back(query.str());
+    query.str(std::string());
+  }
+
+  DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ", queries);
+  storageQuery.upsert({"value"});
+  for (const auto& [key, value] : updated) {
+    query << player->getGUID() << ',' << key << ',' << value;
+    storageQuery.addRow(query);
+  }
+  storageQuery.execute();
+}
+
+void IOLoginData::captureStorageState(Player* player, std::vector<DBStatement>& queries)
+{
+  PropWriteStream stateStream;
+  stateStream.reserve(player->storage.getValues().size() * (sizeof(uint32_t) + sizeof(int32_t)));
+  for (const auto& [key, value] : player->storage.getValues()) {
+    IOPlayerState::writeStorage(stateStream, key, value);
+  }
+  IOPlayerState::addSaveStatement(player->getGUID(), PLAYER_STATE_STORAGE, stateStream, queries);
+  player->storage.clearChanges();
+  player->storage.setSynced(true);
+}
+
+void IOLoginData::resetSavedState(Player* player)
+{
+  // a write failed, the next save writes every section again
+  player->savedFingerprints.fill(0);
+  player->storage.setSynced(false);
+}
+
+bool IOLoginData::getPlayerNameEntry(const std::string& name, PlayerNameEntry& entry)
+{
+  if (g_playerNameCache().getByName(name, entry)) {
+    return true;
   }
 
-  if (!storageQuery.execute()) {
+  Database& db = Database::getInstance();
+
+  std::ostringstream query;
+  query << "SELECT `name`, `id`, `group_id` FROM `players` WHERE `name` = " << db.escapeString(name);
+  DBResult_ptr result = db.storeQuery(query.str());
+  if (!result) {
     return false;
   }
 
-  //End the transaction
-  return transaction.commit();
+  entry.guid = result->getNumber<uint32_t>("id");
+  entry.name = result->getString("name");
+  entry.groupId = result->getNumber<uint16_t>("group_id");
+  g_playerNameCache().add(entry.guid, entry.name, entry.groupId);
+  return true;
 }
 
 std::string IOLoginData::getNameByGuid(uint32_t guid)
 {
+  PlayerNameEntry entry;
+  if (g_playerNameCache().getByGuid(guid, entry)) {
+    return entry.name;
+  }
+
   std::ostringstream query;
-  query << "SELECT `name` FROM `players` WHERE `id` = " << guid;
+  query << "SELECT `name`, `group_id` FROM `players` WHERE `id` = " << guid;
   DBResult_ptr result = Database::getInstance().storeQuery(query.str());
   if (!result) {
     return std::string();
   }
-  return result->getString("name");
+
+  std::string name = result->getString("name");
+  g_playerNameCache().add(guid, name, result->getNumber<uint16_t>("group_id"));
+  return name;
 }
 
 uint32_t IOLoginData::getGuidByName(const std::string& name)
 {
-  Database& db = Database::getInstance();
-
-  std::ostringstream query;
-  query << "SELECT `id` FROM `players` WHERE `name` = " << db.escapeString(name);
-  DBResult_ptr result = db.storeQuery(query.str());
-  if (!result) {
+  PlayerNameEntry entry;
+  if (!getPlayerNameEntry(name, entry)) {
     return 0;
   }
-  return result->getNumber<uint32_t>("id");
+  return entry.guid;
 }
 
 bool IOLoginData::getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name)
 {
-  Database& db = Database::getInstance();
-
-  std::ostringstream query;
-  query << "SELECT `name`, `id`, `group_id`, `account_id` FROM `players` WHERE `name` = " << db.escapeString(name);
-  DBResult_ptr result = db.storeQuery(query.str());
-  if (!result) {
+  PlayerNameEntry entry;
+  if (!getPlayerNameEntry(name, entry)) {
     return false;
   }
 
-  name = result->getString("name");
-  guid = result->getNumber<uint32_t>("id");
-  const Group* group = g_game().groups.getGroup(result->getNumber<uint16_t>("group_id"));
+  name = entry.name;
+  guid = entry.guid;
+  const Group* group = g_game().groups.getGroup(entry.groupId);
 
   uint64_t flags;
   if (group) {
@@ -1323,51 +1852,71 @@ bool IOLoginData::getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string&
 
 bool IOLoginData::formatPlayerName(std::string& name)
 {
-  Database& db = Database::getInstance();
-
-  std::ostringstream query;
-  query << "SELECT `name` FROM `players` WHERE `name` = " << db.escapeString(name);
-
-  DBResult_ptr result = db.storeQuery(query.str());
-  if (!result) {
+  PlayerNameEntry entry;
+  if (!getPlayerNameEntry(name, entry)) {
     return false;
   }
 
-  name = result->getString("name");
+  name = entry.name;
   return true;
 }
 
-void IOLoginData::loadItems(ItemMap& itemMap, DBResult_ptr result)
+bool IOLoginData::loadItems(ItemMap& itemMap, DBResult_ptr result, const std::vector<char>& state)
 {
-  do {
-    uint32_t sid = result->getNumber<uint32_t>("sid");
-    uint32_t pid = result->getNumber<uint32_t>("pid");
-    uint16_t type = result->getNumber<uint16_t>("itemtype");
-    uint16_t count = result->getNumber<uint16_t>("count");
-
-    unsigned long attrSize;
-    const char* attr = result->getStream("attributes", attrSize);
-
-    PropStream propStream;
-    propStream.init(attr, attrSize);
+  if (result) {
+    do {
+      PlayerItemRow row;
+      row.sid = result->getNumber<int32_t>("sid");
+      row.pid = result->getNumber<int32_t>("pid");
+      row.itemType = result->getNumber<uint16_t>("itemtype");
+      row.count = result->getNumber<uint16_t>("count");
+
+      unsigned long attrSize;
+      row.attributes = result->getStream("attributes", attrSize);
+      row.attributesSize = attrSize;
+      loadItem(itemMap, row);
+    } while (result->next());
+  } else if (!state.empty()) {
+    PropStream stateStream;
+    stateStream.init(state.data(), state.size());
+
+    PlayerItemRow row;
+    int32_t lastSid = 0;
+    while (IOPlayerState::readItem(stateStream, lastSid, row)) {
+      loadItem(itemMap, row);
+    }
+  }
+  return !itemMap.empty();
+}
 
-    Item* item = Item::CreateItem(type, count);
-    if (item) {
-      if (!item->unserializeAttr(propStream)) {
-        SPDLOG_WARN("[IOLoginData::loadItems] - Failed to serialize");
-      }
+void IOLoginData::loadItem(ItemMap& itemMap, const PlayerItemRow& row)
+{
+  PropStream propStream;
+  propStream.init(row.attributes, row.attributesSize);
 
-      std::pair<Item*, uint32_t> pair(item, pid);
-      itemMap[sid] = pair;
+  Item* item = Item::CreateItem(row.itemType, row.count);
+  if (item) {
+    if (!item->unserializeAttr(propStream)) {
+      SPDLOG_WARN("[IOLoginData::loadItems] - Failed to serialize");
     }
-  } while (result->next());
+
+    std::pair<Item*, uint32_t> pair(item, row.pid);
+    itemMap[row.sid] = pair;
+  }
 }
 
 void IOLoginData::increaseBankBalance(uint32_t guid, uint64_t bankBalance)
 {
-  std::ostringstream query;
-  query << "UPDATE `players` SET `balance` = `balance` + " << bankBalance << " WHERE `id` = " << guid;
-  Database::getInstance().executeQuery(query.str());
+  auto update = [guid, bankBalance](Database& db) {
+    return db.executeQuery(DBStatement("UPDATE `players` SET `balance` = `balance` + ? WHERE `id` = ?").bind(bankBalance).bind(guid));
+  };
+
+  // keyed by guid and counted as a save, so it neither passes nor is passed by a save or load of the player
+  if (!g_databaseTasks().addTask(update, [guid](DBResult_ptr, bool) { finishPendingSave(guid); }, guid, guid)) {
+    update(Database::getInstance());
+    return;
+  }
+  ++pendingSaves[guid];
 }
 
 bool IOLoginData::hasBiddedOnHouse(uint32_t guid)
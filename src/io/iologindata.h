@@ -23,9 +23,56 @@
 #include "creatures/players/account/account.hpp"
 #include "creatures/players/player.h"
 #include "database/database.h"
+#include "io/ioplayerstate.hpp"
+#include "io/player_name_cache.hpp"
 
 using ItemBlockList = std::list<std::pair<int32_t, Item*>>;
 
+/**
+ * Everything savePlayer writes, captured on the dispatcher: the queries hold
+ * the serialized items, storage and skills, so they can run later on a
+ * database worker while the player keeps changing.
+ */
+struct PlayerSaveSnapshot {
+	uint32_t guid = 0;
+	std::string name;
+	// written alone when the `save` column of the player is 0
+	time_t lastLogin = 0;
+	uint32_t lastIP = 0;
+	// run in order, in one transaction
+	std::vector<DBStatement> queries;
+};
+
+/**
+ * The rows loadPlayer builds a player from. They are fetched in one go, on a
+ * database worker for logins, so the dispatcher only turns them into objects.
+ */
+struct PlayerLoadContext {
+	DBResult_ptr player;
+	account::Account account;
+	uint32_t coins = 0;
+	DBResult_ptr guildMembership;
+	DBResult_ptr guildMemberCount;
+	GuildWarVector guildWars;
+	DBResult_ptr stash;
+	DBResult_ptr charms;
+	DBResult_ptr spells;
+	DBResult_ptr kills;
+	DBResult_ptr items;
+	DBResult_ptr depotItems;
+	DBResult_ptr rewardItems;
+	DBResult_ptr inboxItems;
+	DBResult_ptr storage;
+	DBResult_ptr vip;
+	DBResult_ptr prey;
+	DBResult_ptr taskHunt;
+	// inflated player_state rows, the rows above of these components are not fetched when the binary state is on
+	std::array<std::vector<char>, PLAYER_STATE_LAST + 1> state;
+	bool corruptedState = false;
+	// the depot and inbox are left for Player::loadDepot
+	bool lazyDepot = false;
+};
+
 class IOLoginData
 {
 	public:
@@ -43,12 +90,23 @@ class IOLoginData
 
 		static bool loadPlayerById(Player* player, uint32_t id);
 		static bool loadPlayerByName(Player* player, const std::string& name);
-		static bool loadPlayer(Player* player, DBResult_ptr result);
+		// fetches the rows on a database worker, after any queued save of the player, and calls back on the dispatcher
+		static void loadPlayerAsync(uint32_t guid, std::function<void(PlayerLoadContext&)> callback);
+		static bool loadPlayer(Player* player, PlayerLoadContext& context);
+		// the depot chests and inbox of a player loaded without them
+		static void loadDepotAsync(Player* player);
+		static void loadDepot(Player* player);
 		static bool savePlayer(Player* player);
+		// captures the player now and writes it on a database worker
+		static void savePlayerAsync(Player* player);
+		// writes the storage values changed since the last write on a database worker
+		static void flushPlayerStorage(Player* player);
 		static uint32_t getGuidByName(const std::string& name);
 		static bool getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name);
 		static std::string getNameByGuid(uint32_t guid);
 		static bool formatPlayerName(std::string& name);
+		// name, guid and group of a character, from the name cache or the database
+		static bool getPlayerNameEntry(const std::string& name, PlayerNameEntry& entry);
 		static void increaseBankBalance(uint32_t guid, uint64_t bankBalance);
 		static bool hasBiddedOnHouse(uint32_t guid);
 
@@ -57,14 +115,44 @@ class IOLoginData
 		static void editVIPEntry(uint32_t accountId, uint32_t guid, const std::string& description, uint32_t icon, bool notify);
 		static void removeVIPEntry(uint32_t accountId, uint32_t guid);
 
+		// appends a reward bag with loot (item id, count) to the rewards of a player that is not online, on a database worker
+		static void addOfflineReward(uint32_t guid, uint32_t timestamp, const std::vector<std::pair<uint16_t, uint16_t>>& loot);
+
 		static void addPremiumDays(uint32_t accountId, int32_t addDays);
 		static void removePremiumDays(uint32_t accountId, int32_t removeDays);
 
 	private:
 		using ItemMap = std::map<uint32_t, std::pair<Item*, uint32_t>>;
 
-		static void loadItems(ItemMap& itemMap, DBResult_ptr result);
-		static bool saveItems(const Player* player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& stream);
+		// from the rows, or from the binary state when there are none, returns false if nothing was loaded
+		static bool loadItems(ItemMap& itemMap, DBResult_ptr result, const std::vector<char>& state);
+		static void loadItem(ItemMap& itemMap, const PlayerItemRow& row);
+		// fills the context from its player row, db is the connection of the calling thread
+		static void fetchPlayerData(Database& db, PlayerLoadContext& context);
+		static void fetchPlayerState(Database& db, uint32_t guid, PlayerLoadContext& context);
+		static void fetchDepotData(Database& db, uint32_t guid, PlayerLoadContext& context);
+		static void readPlayerState(DBResult_ptr result, uint32_t guid, PlayerLoadContext& context);
+		static void loadDepotItems(Player* player, PlayerLoadContext& context);
+		static void applyDepotData(Player* player, PlayerLoadContext& context);
+		static void capturePlayer(Player* player, PlayerSaveSnapshot& snapshot);
+		// written is false when the player is not saved, or only its login was
+		static bool persistPlayer(Database& db, const PlayerSaveSnapshot& snapshot, bool& written);
+		// drops the sections of the save that did not change since the last capture
+		static void skipUnchangedSection(Player* player, PlayerSaveSnapshot& snapshot, PlayerSaveSection_t section, size_t begin);
+		static void captureStorageChanges(Player* player, std::vector<DBStatement>& queries);
+		// the whole storage as one binary state row
+		static void captureStorageState(Player* player, std::vector<DBStatement>& queries);
+		static bool persistStorage(Database& db, uint32_t guid, const std::vector<DBStatement>& queries);
+		static void resetSavedState(Player* player);
+		// a load or synchronous save must not run before a queued save of the same player
+		static void waitForPendingSave(uint32_t guid);
+		// the rows of the component, or its binary state row, replacing what the database holds
+		static void saveItems(const Player* player, const ItemBlockList& itemList, PlayerStateComponent_t component, std::vector<DBStatement>& queries, PropWriteStream& stream);
+		// calls addRow for every item of the list and of their containers, stops when it returns false
+		static bool serializeItems(const Player* player, const ItemBlockList& itemList, PropWriteStream& stream, const std::function<bool(const PlayerItemRow&)>& addRow);
+
+	// captures and persists the players in its child process
+	friend class ForkedSave;
 };
 
 #endif  // SRC_IO_IOLOGINDATA_H_
@@ -20,6 +20,7 @@
 #include "pch.hpp"
 
 #include "io/iomap.h"
+#include "io/iomapcache.hpp"
 #include "game/movement/teleport.h"
 
 /*
@@ -46,6 +47,8 @@
 	|--- OTBM_ITEM_DEF (not implemented)
 */
 
+bool IOMap::buildCache = false;
+
 Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z)
 {
 	if (!ground) {
@@ -67,60 +70,75 @@ Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8
 
 bool IOMap::loadMap(Map* map, const std::string& fileName)
 {
-	int64_t start = OTSYS_TIME();
+	int64_t start = OTSYS_PRECISE_TIME();
+	bool streaming = g_configManager().getBoolean(MAP_STREAMING);
+	MapCacheReader cacheReader;
+	if (!buildCache && cacheReader.open(fileName)) {
+		// streamed tiles are deleted again, the arena would keep their memory
+		std::optional<MapArena::Scope> arenaScope;
+		if (streaming) {
+			map->streamer.addSource(cacheReader.getFile());
+		} else {
+			arenaScope.emplace();
+		}
+
+		if (!loadMapCache(cacheReader, *map, fileName)) {
+			return false;
+		}
+
+		SPDLOG_INFO("Map loading time: {} seconds (from {})", (OTSYS_PRECISE_TIME() - start) / (1000.), getMapCacheFileName(fileName));
+		return true;
+	}
+
+	if (streaming && !buildCache) {
+		SPDLOG_WARN("[IOMap::loadMap] - mapStreaming needs a map cache, {} is loaded as a whole", fileName);
+	}
+
+	MapArena::Scope arenaScope;
 	OTB::Loader loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}};
 	auto& root = loader.parseTree();
 
+	std::unique_ptr<MapCacheWriter> writer;
+	if (buildCache) {
+		writer = std::make_unique<MapCacheWriter>(fileName);
+		cacheWriter = writer.get();
+		cacheWriter->addNode(MAP_CACHE_ROOT_HEADER, root);
+	}
+
 	PropStream propStream;
 	if (!loader.getProps(root, propStream)) {
 		setLastErrorString("Could not read root property.");
 		return false;
 	}
 
-	OTBM_root_header root_header;
-	if (!propStream.read(root_header)) {
-		setLastErrorString("Could not read header.");
+	uint32_t headerVersion;
+	if (!parseRootHeader(propStream, *map, headerVersion)) {
 		return false;
 	}
 
-	uint32_t headerVersion = root_header.version;
-	if (headerVersion <= 0) {
-		//In otbm version 1 the count variable after splashes/fluidcontainers and stackables
-		//are saved as attributes instead, this solves alot of problems with items
-		//that is changed (stackable/charges/fluidcontainer/splash) during an update.
-		setLastErrorString("This map need to be upgraded by using the latest map editor version to be able to load correctly.");
-		return false;
-	}
-
-	if (headerVersion > 2) {
-		setLastErrorString("Unknown OTBM version detected.");
+	if (root.children.size() != 1 || root.children[0].type != OTBM_MAP_DATA) {
+		setLastErrorString("Could not read data node.");
 		return false;
 	}
 
-	if (root_header.majorVersionItems < 3) {
-		setLastErrorString("This map need to be upgraded by using the latest map editor version to be able to load correctly.");
+	auto& mapNode = root.children[0];
+	if (!loader.getProps(mapNode, propStream)) {
+		setLastErrorString("Could not read map data attributes.");
 		return false;
 	}
 
-	SPDLOG_INFO("Map size: {}x{}", root_header.width, root_header.height);
-	map->width = root_header.width;
-	map->height = root_header.height;
-
-	if (root.children.size() != 1 || root.children[0].type != OTBM_MAP_DATA) {
-		setLastErrorString("Could not read data node.");
-		return false;
+	if (cacheWriter) {
+		cacheWriter->addNode(MAP_CACHE_MAP_DATA, mapNode);
 	}
 
-	auto& mapNode = root.children[0];
-	if (!parseMapDataAttributes(loader, mapNode, *map, fileName)) {
+	if (!parseMapDataAttributes(propStream, *map, fileName)) {
 		return false;
 	}
 
+	std::vector<const OTB::Node*> tileAreaNodes;
 	for (auto& mapDataNode : mapNode.children) {
 		if (mapDataNode.type == OTBM_TILE_AREA) {
-			if (!parseTileArea(loader, mapDataNode, *map)) {
-				return false;
-			}
+			tileAreaNodes.push_back(&mapDataNode);
 		} else if (mapDataNode.type == OTBM_TOWNS) {
 			if (!parseTowns(loader, mapDataNode, *map)) {
 				return false;
@@ -135,18 +153,119 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		}
 	}
 
-	SPDLOG_INFO("Map loading time: {} seconds", (OTSYS_TIME() - start) / (1000.));
+	if (!parseTileAreas(tileAreaNodes, *map)) {
+		return false;
+	}
+
+	if (cacheWriter) {
+		cacheWriter = nullptr;
+		if (writer->save()) {
+			SPDLOG_INFO("Map cache saved to {}", getMapCacheFileName(fileName));
+		}
+	}
+
+	SPDLOG_INFO("Map loading time: {} seconds", (OTSYS_PRECISE_TIME() - start) / (1000.));
 	return true;
 }
 
-bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName)
+bool IOMap::loadMapCache(MapCacheReader& reader, Map& map, const std::string& fileName)
 {
+	// sections are stored in the order the OTBM path parses them
+	uint32_t headerVersion = 0;
+	bool streaming = g_configManager().getBoolean(MAP_STREAMING);
+	MapCacheSection section;
+	MapTileBatch batch;
 	PropStream propStream;
-	if (!loader.getProps(mapNode, propStream)) {
-		setLastErrorString("Could not read map data attributes.");
+	while (reader.next(section)) {
+		propStream.init(section.data, section.size);
+		switch (section.type) {
+			case MAP_CACHE_ROOT_HEADER:
+				if (!parseRootHeader(propStream, map, headerVersion)) {
+					return false;
+				}
+				break;
+
+			case MAP_CACHE_MAP_DATA:
+				if (!parseMapDataAttributes(propStream, map, fileName)) {
+					return false;
+				}
+				break;
+
+			case MAP_CACHE_TOWN:
+				if (!parseTown(propStream, map)) {
+					return false;
+				}
+				break;
+
+			case MAP_CACHE_WAYPOINT:
+				if (!parseWaypoint(propStream, map)) {
+					return false;
+				}
+				break;
+
+			case MAP_CACHE_TILE_AREA:
+				if (!MapCacheReader::readTileBatch(section, batch)) {
+					setLastErrorString("Invalid tile area in map cache.");
+					return false;
+				}
+
+				if (!loadTileBatch(batch, map)) {
+					return false;
+				}
+
+				if (streaming) {
+					map.streamer.addSector(section.data, section.size, batch);
+				}
+				break;
+
+			default:
+				setLastErrorString("Unknown map cache section.");
+				return false;
+		}
+	}
+
+	if (!reader.isComplete()) {
+		setLastErrorString("Truncated map cache.");
 		return false;
 	}
+	return true;
+}
 
+bool IOMap::parseRootHeader(PropStream& propStream, Map& map, uint32_t& headerVersion)
+{
+	OTBM_root_header root_header;
+	if (!propStream.read(root_header)) {
+		setLastErrorString("Could not read header.");
+		return false;
+	}
+
+	headerVersion = root_header.version;
+	if (headerVersion <= 0) {
+		//In otbm version 1 the count variable after splashes/fluidcontainers and stackables
+		//are saved as attributes instead, this solves alot of problems with items
+		//that is changed (stackable/charges/fluidcontainer/splash) during an update.
+		setLastErrorString("This map need to be upgraded by using the latest map editor version to be able to load correctly.");
+		return false;
+	}
+
+	if (headerVersion > 2) {
+		setLastErrorString("Unknown OTBM version detected.");
+		return false;
+	}
+
+	if (root_header.majorVersionItems < 3) {
+		setLastErrorString("This map need to be upgraded by using the latest map editor version to be able to load correctly.");
+		return false;
+	}
+
+	SPDLOG_INFO("Map size: {}x{}", root_header.width, root_header.height);
+	map.width = root_header.width;
+	map.height = root_header.height;
+	return true;
+}
+
+bool IOMap::parseMapDataAttributes(PropStream& propStream, Map& map, const std::string& fileName)
+{
 	std::string mapDescription;
 	std::string tmp;
 
@@ -198,72 +317,92 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map)
+namespace {
+
+// tile areas decoded ahead of the loading thread, bounds the memory held by the batches
+constexpr size_t MAP_TILE_AREA_WINDOW = 256;
+
+std::string getTileErrorString(uint16_t x, uint16_t y, uint16_t z, const std::string& message)
 {
-	PropStream propStream;
-	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
-		return false;
+	std::ostringstream ss;
+	ss << "[x:" << x << ", y:" << y << ", z:" << z << "] " << message;
+	return ss.str();
+}
+
+// Appends the records of an item node and, right after it, of the items inside it
+void decodeItemNode(const OTB::Node& itemNode, MapTileBatch& batch)
+{
+	size_t index = batch.items.size();
+	uint32_t propsOffset = static_cast<uint32_t>(batch.props.size());
+	uint32_t propsSize = static_cast<uint32_t>(OTB::Loader::appendProps(itemNode, batch.props));
+	batch.items.push_back({propsOffset, propsSize, 0, 0, 0});
+
+	for (auto& childNode : itemNode.children) {
+		if (childNode.type != OTBM_ITEM || childNode.propsBegin == childNode.propsEnd) {
+			batch.items[index].flags |= MAP_ITEM_INVALID_CHILDREN;
+			break;
+		}
+
+		++batch.items[index].childCount;
+		decodeItemNode(childNode, batch);
 	}
+	batch.items[index].descendantCount = static_cast<uint32_t>(batch.items.size() - index - 1);
+}
+
+// Worker thread part of the tile area loading, only reads the node tree
+void decodeTileArea(const OTB::Node& tileAreaNode, MapTileBatch& batch)
+{
+	PropStream propStream;
+	OTB::Loader::appendProps(tileAreaNode, batch.props);
+	propStream.init(batch.props.data(), batch.props.size());
 
 	OTBM_Destination_coords area_coord;
-	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
-		return false;
+	if (tileAreaNode.propsBegin == tileAreaNode.propsEnd || !propStream.read(area_coord)) {
+		batch.error = "Invalid map node.";
+		return;
 	}
+	batch.props.clear();
 
 	uint16_t base_x = area_coord.x;
 	uint16_t base_y = area_coord.y;
 	uint16_t z = area_coord.z;
 
-	static std::map<uint64_t, uint64_t> teleportMap;
-
 	for (auto& tileNode : tileAreaNode.children) {
 		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
-			return false;
+			batch.error = "Unknown tile node.";
+			return;
 		}
 
-		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
-			return false;
+		if (tileNode.propsBegin == tileNode.propsEnd) {
+			batch.error = "Could not read node data.";
+			return;
 		}
 
+		size_t propsOffset = batch.props.size();
+		size_t propsSize = OTB::Loader::appendProps(tileNode, batch.props);
+		propStream.init(batch.props.data() + propsOffset, propsSize);
+
 		OTBM_Tile_coords tile_coord;
 		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
-			return false;
+			batch.error = "Could not read tile position.";
+			return;
 		}
 
 		uint16_t x = base_x + tile_coord.x;
 		uint16_t y = base_y + tile_coord.y;
 
-		bool isHouseTile = false;
-		House* house = nullptr;
-		Tile* tile = nullptr;
-		Item* ground_item = nullptr;
-		uint32_t tileflags = TILESTATE_NONE;
-
-		if (tileNode.type == OTBM_HOUSETILE) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-				setLastErrorString(ss.str());
-				return false;
-			}
-
-			house = map.houses.addHouse(houseId);
-			if (!house) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
-				setLastErrorString(ss.str());
-				return false;
-			}
-
-			tile = new HouseTile(x, y, z, house);
-			house->addTile(static_cast<HouseTile*>(tile));
-			isHouseTile = true;
+		MapTileRecord& tile = batch.tiles.emplace_back();
+		tile.houseId = 0;
+		tile.tileflags = TILESTATE_NONE;
+		tile.firstItem = static_cast<uint32_t>(batch.items.size());
+		tile.x = x;
+		tile.y = y;
+		tile.z = static_cast<uint8_t>(z);
+		tile.isHouseTile = tileNode.type == OTBM_HOUSETILE;
+
+		if (tile.isHouseTile && !propStream.read<uint32_t>(tile.houseId)) {
+			batch.error = getTileErrorString(x, y, z, "Could not read house id.");
+			return;
 		}
 
 		uint8_t attribute;
@@ -273,110 +412,162 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 				case OTBM_ATTR_TILE_FLAGS: {
 					uint32_t flags;
 					if (!propStream.read<uint32_t>(flags)) {
-						std::ostringstream ss;
-						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
-						setLastErrorString(ss.str());
-						return false;
+						batch.error = getTileErrorString(x, y, z, "Failed to read tile flags.");
+						return;
 					}
 
 					if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-						tileflags |= TILESTATE_PROTECTIONZONE;
+						tile.tileflags |= TILESTATE_PROTECTIONZONE;
 					} else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-						tileflags |= TILESTATE_NOPVPZONE;
+						tile.tileflags |= TILESTATE_NOPVPZONE;
 					} else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-						tileflags |= TILESTATE_PVPZONE;
+						tile.tileflags |= TILESTATE_PVPZONE;
 					}
 
 					if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-						tileflags |= TILESTATE_NOLOGOUT;
+						tile.tileflags |= TILESTATE_NOLOGOUT;
 					}
 					break;
 				}
 
 				case OTBM_ATTR_ITEM: {
-					Item* item = Item::CreateItem(propStream);
-					if (!item) {
-						std::ostringstream ss;
-						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-						setLastErrorString(ss.str());
-						SPDLOG_WARN("[IOMap::loadMap] - {}", ss.str());
-						break;;
-					}
-
-			if (Teleport* teleport = item->getTeleport()) {
-				const Position& destPos = teleport->getDestPos();
-				uint64_t teleportPosition = (static_cast<uint64_t>(x) << 24) | (y << 8) | z;
-				uint64_t destinationPosition = (static_cast<uint64_t>(destPos.x) << 24) | (destPos.y << 8) | destPos.z;
-				teleportMap.emplace(teleportPosition, destinationPosition);
-				auto it = teleportMap.find(destinationPosition);
-				if (it != teleportMap.end()) {
-					SPDLOG_WARN("[IOMap::loadMap] - "
-                                "Teleport in position: x {}, y {}, z {} "
-                                "is leading to another teleport", x, y, z);
-				}
-				for (auto const& it2 : teleportMap) {
-					if (it2.second == teleportPosition) {
-						uint16_t fx = (it2.first >> 24) & 0xFFFF;
-						uint16_t fy = (it2.first >> 8) & 0xFFFF;
-						uint8_t fz = (it2.first) & 0xFF;
-						SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Teleport in position: x {}, y {}, z {} "
-                                    "is leading to another teleport",
-                                    fx, fy, static_cast<uint16_t>(fz));
-					}
-				}
-
-			}
-
-					if (isHouseTile && item->isMoveable()) {
-						SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Moveable item with ID: {}, in house: {}, "
-                                    "at position: x {}, y {}, z {}",
-                                    item->getID(), house->getId(), x, y, z);
-						delete item;
-					} else {
-						if (item->getItemCount() <= 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							delete ground_item;
-							ground_item = item;
-						} else {
-							tile = createTile(ground_item, item, x, y, z);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
-					}
+					// an inline item is only its id, a truncated one fails in Item::CreateItem as before
+					uint32_t itemOffset = static_cast<uint32_t>(batch.props.size() - propStream.size());
+					uint32_t itemSize = static_cast<uint32_t>(std::min<size_t>(propStream.size(), sizeof(uint16_t)));
+					batch.items.push_back({itemOffset, itemSize, 0, 0, MAP_ITEM_INLINE});
+					propStream.skip(sizeof(uint16_t));
 					break;
 				}
 
 				default:
-					std::ostringstream ss;
-					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
-					setLastErrorString(ss.str());
-					return false;
+					batch.error = getTileErrorString(x, y, z, "Unknown tile attribute.");
+					return;
 			}
 		}
 
 		for (auto& itemNode : tileNode.children) {
 			if (itemNode.type != OTBM_ITEM) {
+				batch.error = getTileErrorString(x, y, z, "Unknown node type.");
+				return;
+			}
+
+			if (itemNode.propsBegin == itemNode.propsEnd) {
+				batch.error = "Invalid item node.";
+				return;
+			}
+
+			decodeItemNode(itemNode, batch);
+		}
+
+		tile.itemCount = static_cast<uint32_t>(batch.items.size() - tile.firstItem);
+	}
+}
+
+}  // namespace
+
+bool IOMap::parseTileAreas(const std::vector<const OTB::Node*>& tileAreaNodes, Map& map)
+{
+	std::vector<MapTileBatch> batches;
+	for (size_t windowStart = 0; windowStart < tileAreaNodes.size(); windowStart += MAP_TILE_AREA_WINDOW) {
+		size_t windowSize = std::min(MAP_TILE_AREA_WINDOW, tileAreaNodes.size() - windowStart);
+		batches.resize(windowSize);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int64_t i = 0; i < static_cast<int64_t>(windowSize); ++i) {
+			MapTileBatch& batch = batches[i];
+			batch.tiles.clear();
+			batch.items.clear();
+			batch.props.clear();
+			batch.error.clear();
+			decodeTileArea(*tileAreaNodes[windowStart + i], batch);
+		}
+
+		// items register unique ids, bed sleepers and decay, so they are created here in file order
+		for (size_t i = 0; i < windowSize; ++i) {
+			if (!batches[i].error.empty()) {
+				setLastErrorString(batches[i].error);
+				return false;
+			}
+
+			if (cacheWriter) {
+				cacheWriter->addTileBatch(batches[i]);
+			}
+
+			if (!loadTileBatch(batches[i], map)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool IOMap::unserializeItemRecord(const MapTileBatch& batch, size_t index, Item* item, PropStream& propStream)
+{
+	// same as Item/Container::unserializeItemNode
+	if (!item->unserializeAttr(propStream)) {
+		return false;
+	}
+
+	Container* container = item->getContainer();
+	if (!container) {
+		return true;
+	}
+
+	const MapItemRecord& record = batch.items[index];
+	size_t childIndex = index + 1;
+	for (uint32_t i = 0; i < record.childCount; ++i) {
+		const MapItemRecord& childRecord = batch.items[childIndex];
+		PropStream childStream;
+		childStream.init(batch.props.data() + childRecord.propsOffset, childRecord.propsSize);
+
+		Item* childItem = Item::CreateItem(childStream);
+		if (!childItem) {
+			return false;
+		}
+
+		if (!unserializeItemRecord(batch, childIndex, childItem, childStream)) {
+			delete childItem;
+			return false;
+		}
+
+		container->addItem(childItem);
+		container->updateItemWeight(childItem->getWeight());
+		childIndex += childRecord.descendantCount + 1;
+	}
+	return (record.flags & MAP_ITEM_INVALID_CHILDREN) == 0;
+}
+
+bool IOMap::loadTileBatch(const MapTileBatch& batch, Map& map)
+{
+	static std::map<uint64_t, uint64_t> teleportMap;
+
+	for (const MapTileRecord& record : batch.tiles) {
+		uint16_t x = record.x;
+		uint16_t y = record.y;
+		uint16_t z = record.z;
+
+		House* house = nullptr;
+		Tile* tile = nullptr;
+		Item* ground_item = nullptr;
+
+		if (record.isHouseTile) {
+			house = map.houses.addHouse(record.houseId);
+			if (!house) {
 				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
+				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << record.houseId;
 				setLastErrorString(ss.str());
 				return false;
 			}
 
+			tile = new HouseTile(x, y, z, house);
+			house->addTile(static_cast<HouseTile*>(tile));
+		}
+
+		// the records of items inside containers are skipped here, unserializeItemRecord reads them
+		for (size_t i = record.firstItem, last = record.firstItem + record.itemCount; i < last; i += batch.items[i].descendantCount + 1) {
+			const MapItemRecord& itemRecord = batch.items[i];
 			PropStream stream;
-			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
-				return false;
-			}
+			stream.init(batch.props.data() + itemRecord.propsOffset, itemRecord.propsSize);
 
 			Item* item = Item::CreateItem(stream);
 			if (!item) {
@@ -384,22 +575,46 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
 				setLastErrorString(ss.str());
 				SPDLOG_WARN("[IOMap::loadMap] - {}", ss.str());
-				continue;;
+				continue;
 			}
 
-			if (!item->unserializeItemNode(loader, itemNode, stream)) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
-				setLastErrorString(ss.str());
-				delete item;
-				return false;
+			if ((itemRecord.flags & MAP_ITEM_INLINE) == 0) {
+				if (!unserializeItemRecord(batch, i, item, stream)) {
+					std::ostringstream ss;
+					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
+					setLastErrorString(ss.str());
+					delete item;
+					return false;
+				}
+			} else if (Teleport* teleport = item->getTeleport()) {
+				const Position& destPos = teleport->getDestPos();
+				uint64_t teleportPosition = (static_cast<uint64_t>(x) << 24) | (y << 8) | z;
+				uint64_t destinationPosition = (static_cast<uint64_t>(destPos.x) << 24) | (destPos.y << 8) | destPos.z;
+				teleportMap.emplace(teleportPosition, destinationPosition);
+				auto it = teleportMap.find(destinationPosition);
+				if (it != teleportMap.end()) {
+					SPDLOG_WARN("[IOMap::loadMap] - "
+                                "Teleport in position: x {}, y {}, z {} "
+                                "is leading to another teleport", x, y, z);
+				}
+				for (auto const& it2 : teleportMap) {
+					if (it2.second == teleportPosition) {
+						uint16_t fx = (it2.first >> 24) & 0xFFFF;
+						uint16_t fy = (it2.first >> 8) & 0xFFFF;
+						uint8_t fz = (it2.first) & 0xFF;
+						SPDLOG_WARN("[IOMap::loadMap] - "
+                                    "Teleport in position: x {}, y {}, z {} "
+                                    "is leading to another teleport",
+                                    fx, fy, static_cast<uint16_t>(fz));
+					}
+				}
 			}
 
-			if (isHouseTile && item->isMoveable()) {
+			if (record.isHouseTile && item->isMoveable()) {
 				SPDLOG_WARN("[IOMap::loadMap] - "
-                                    "Moveable item with ID: {}, in house: {}, "
-                                    "at position: x {}, y {}, z {}",
-                                    item->getID(), house->getId(), x, y, z);
+                            "Moveable item with ID: {}, in house: {}, "
+                            "at position: x {}, y {}, z {}",
+                            item->getID(), house->getId(), x, y, z);
 				delete item;
 			} else {
 				if (item->getItemCount() <= 0) {
@@ -426,7 +641,7 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			tile = createTile(ground_item, nullptr, x, y, z);
 		}
 
-		tile->setFlag(static_cast<TileFlags_t>(tileflags));
+		tile->setFlag(static_cast<TileFlags_t>(record.tileflags));
 
 		map.setTile(x, y, z, tile);
 	}
@@ -447,34 +662,46 @@ bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map
 			return false;
 		}
 
-		uint32_t townId;
-		if (!propStream.read<uint32_t>(townId)) {
-			setLastErrorString("Could not read town id.");
-			return false;
-		}
-
-		Town* town = map.towns.getTown(townId);
-		if (!town) {
-			town = new Town(townId);
-			map.towns.addTown(townId, town);
+		if (cacheWriter) {
+			cacheWriter->addNode(MAP_CACHE_TOWN, townNode);
 		}
 
-		std::string townName;
-		if (!propStream.readString(townName)) {
-			setLastErrorString("Could not read town name.");
+		if (!parseTown(propStream, map)) {
 			return false;
 		}
+	}
+	return true;
+}
 
-		town->setName(townName);
+bool IOMap::parseTown(PropStream& propStream, Map& map)
+{
+	uint32_t townId;
+	if (!propStream.read<uint32_t>(townId)) {
+		setLastErrorString("Could not read town id.");
+		return false;
+	}
 
-		OTBM_Destination_coords town_coords;
-		if (!propStream.read(town_coords)) {
-			setLastErrorString("Could not read town coordinates.");
-			return false;
-		}
+	Town* town = map.towns.getTown(townId);
+	if (!town) {
+		town = new Town(townId);
+		map.towns.addTown(townId, town);
+	}
 
-		town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
+	std::string townName;
+	if (!propStream.readString(townName)) {
+		setLastErrorString("Could not read town name.");
+		return false;
 	}
+
+	town->setName(townName);
+
+	OTBM_Destination_coords town_coords;
+	if (!propStream.read(town_coords)) {
+		setLastErrorString("Could not read town coordinates.");
+		return false;
+	}
+
+	town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
 	return true;
 }
 
@@ -493,20 +720,31 @@ bool IOMap::parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode,
 			return false;
 		}
 
-		std::string name;
-		if (!propStream.readString(name)) {
-			setLastErrorString("Could not read waypoint name.");
-			return false;
+		if (cacheWriter) {
+			cacheWriter->addNode(MAP_CACHE_WAYPOINT, node);
 		}
 
-		OTBM_Destination_coords waypoint_coords;
-		if (!propStream.read(waypoint_coords)) {
-			setLastErrorString("Could not read waypoint coordinates.");
+		if (!parseWaypoint(propStream, map)) {
 			return false;
 		}
-
-		map.waypoints[name] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
 	}
 	return true;
 }
 
+bool IOMap::parseWaypoint(PropStream& propStream, Map& map)
+{
+	std::string name;
+	if (!propStream.readString(name)) {
+		setLastErrorString("Could not read waypoint name.");
+		return false;
+	}
+
+	OTBM_Destination_coords waypoint_coords;
+	if (!propStream.read(waypoint_coords)) {
+		setLastErrorString("Could not read waypoint coordinates.");
+		return false;
+	}
+
+	map.waypoints[name] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
+	return true;
+}
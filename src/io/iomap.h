@@ -52,13 +52,70 @@ struct OTBM_Tile_coords {
 
 #pragma pack()
 
+enum MapItemRecordFlags : uint32_t {
+	// stored as an attribute of the tile, only the item id
+	MAP_ITEM_INLINE = 1 << 0,
+	// one of the child nodes is not a valid item, loading it as a container fails
+	MAP_ITEM_INVALID_CHILDREN = 1 << 1,
+};
+
+/**
+ * An item of a tile, its unescaped properties are in MapTileBatch::props.
+ * The items inside it (child nodes) directly follow it in MapTileBatch::items.
+ * Records are plain data without padding, the map cache stores them as they are.
+ */
+struct MapItemRecord {
+	uint32_t propsOffset;
+	uint32_t propsSize;
+	uint32_t childCount;
+	uint32_t descendantCount;
+	uint32_t flags;
+};
+
+struct MapTileRecord {
+	uint32_t houseId;
+	uint32_t tileflags;
+	uint32_t firstItem;
+	// records of the tile, including the items inside containers
+	uint32_t itemCount;
+	uint16_t x;
+	uint16_t y;
+	uint8_t z;
+	bool isHouseTile;
+	// explicit padding, so stored records do not carry uninitialized bytes
+	uint16_t unused = 0;
+};
+
+/**
+ * Tiles of one OTBM_TILE_AREA decoded by a worker thread. Everything that
+ * creates items or touches global state is left to the loading thread.
+ */
+struct MapTileBatch {
+	std::vector<MapTileRecord> tiles;
+	std::vector<MapItemRecord> items;
+	std::vector<char> props;
+	std::string error;
+};
+
+class MapCacheReader;
+class MapCacheWriter;
+
 class IOMap
 {
 	static Tile* createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z);
+	static bool unserializeItemRecord(const MapTileBatch& batch, size_t index, Item* item, PropStream& propStream);
 
 	public:
 		bool loadMap(Map* map, const std::string& identifier);
 
+		/**
+		* Loads the OTBM files even if a map cache exists, and writes a new
+		* cache next to every map loaded (--build-map-cache)
+		*/
+		static void setBuildCache(bool value) {
+			buildCache = value;
+		}
+
 		/**
 		* Load main map monsters
 		 * \param map Is the map class
@@ -155,6 +212,9 @@ class IOMap
 			return map->housesCustom.loadHousesXML(map->housefile);
 		}
 
+		// Creates the tiles of a decoded tile area, the map streamer loads sectors with it
+		bool loadTileBatch(const MapTileBatch& batch, Map& map);
+
 		const std::string& getLastErrorString() const {
 			return errorString;
 		}
@@ -164,10 +224,19 @@ class IOMap
 		}
 
 	private:
-		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName);
+		bool loadMapCache(MapCacheReader& reader, Map& map, const std::string& fileName);
+		bool parseRootHeader(PropStream& propStream, Map& map, uint32_t& headerVersion);
+		bool parseMapDataAttributes(PropStream& propStream, Map& map, const std::string& fileName);
 		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
+		bool parseWaypoint(PropStream& propStream, Map& map);
 		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map);
+		bool parseTown(PropStream& propStream, Map& map);
+		bool parseTileAreas(const std::vector<const OTB::Node*>& tileAreaNodes, Map& map);
+
+		static bool buildCache;
+
+		// set while the OTBM is loaded with buildCache
+		MapCacheWriter* cacheWriter = nullptr;
 		std::string errorString;
 };
 
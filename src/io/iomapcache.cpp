@@ -0,0 +1,248 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pch.hpp"
+
+#include "io/iomapcache.hpp"
+
+static_assert(std::is_trivially_copyable_v<MapTileRecord> && sizeof(MapTileRecord) == 24, "MapTileRecord is stored as is");
+static_assert(std::is_trivially_copyable_v<MapItemRecord> && sizeof(MapItemRecord) == 20, "MapItemRecord is stored as is");
+
+namespace {
+
+constexpr std::array<char, 4> MAP_CACHE_IDENTIFIER = {{'C', 'M', 'A', 'P'}};
+
+template <typename T>
+void appendData(std::vector<char>& buffer, const T* data, size_t count)
+{
+	const char* bytes = reinterpret_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+}  // namespace
+
+std::string getMapCacheFileName(const std::string& fileName)
+{
+	return getCachePath(boost::filesystem::path(fileName).filename().string() + ".cache", fileName + ".cache");
+}
+
+MapCacheWriter::MapCacheWriter(const std::string& initFileName) :
+	fileName(initFileName),
+	tempFileName(getCacheTempFileName(getMapCacheFileName(initFileName))),
+	file(tempFileName, std::ios::binary | std::ios::trunc)
+{
+	// the header is written last, once the checksums are known
+	MapCacheHeader header {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void MapCacheWriter::write(const char* data, size_t size)
+{
+	file.write(data, size);
+	payloadChecksum = updateCrc32(payloadChecksum, data, size);
+	payloadSize += size;
+}
+
+void MapCacheWriter::addSection(MapCacheSection_t type, const char* data, size_t size)
+{
+	auto sectionSize = static_cast<uint32_t>(size);
+	write(reinterpret_cast<const char*>(&type), sizeof(type));
+	write(reinterpret_cast<const char*>(&sectionSize), sizeof(sectionSize));
+	write(data, size);
+}
+
+void MapCacheWriter::addNode(MapCacheSection_t type, const OTB::Node& node)
+{
+	buffer.clear();
+	OTB::Loader::appendProps(node, buffer);
+	addSection(type, buffer.data(), buffer.size());
+}
+
+void MapCacheWriter::addTileBatch(const MapTileBatch& batch)
+{
+	const uint32_t counts[] = {
+		static_cast<uint32_t>(batch.tiles.size()),
+		static_cast<uint32_t>(batch.items.size()),
+		static_cast<uint32_t>(batch.props.size())
+	};
+
+	buffer.clear();
+	appendData(buffer, counts, std::size(counts));
+	appendData(buffer, batch.tiles.data(), batch.tiles.size());
+	appendData(buffer, batch.items.data(), batch.items.size());
+	appendData(buffer, batch.props.data(), batch.props.size());
+	addSection(MAP_CACHE_TILE_AREA, buffer.data(), buffer.size());
+}
+
+bool MapCacheWriter::save()
+{
+	MapCacheHeader header;
+	header.identifier = MAP_CACHE_IDENTIFIER;
+	header.version = MAP_CACHE_VERSION;
+	if (!getFileChecksum(fileName, header.sourceSize, header.sourceChecksum)) {
+		return false;
+	}
+
+	const auto endMarker = MAP_CACHE_END;
+	write(reinterpret_cast<const char*>(&endMarker), sizeof(endMarker));
+	header.payloadSize = payloadSize;
+	header.payloadChecksum = payloadChecksum;
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.close();
+
+	boost::system::error_code error;
+	if (file.fail()) {
+		SPDLOG_ERROR("[MapCacheWriter::save] - Could not write {}", tempFileName);
+		boost::filesystem::remove(tempFileName, error);
+		return false;
+	}
+
+	boost::filesystem::rename(tempFileName, getMapCacheFileName(fileName), error);
+	if (error) {
+		SPDLOG_ERROR("[MapCacheWriter::save] - Could not replace {}: {}", getMapCacheFileName(fileName), error.message());
+		return false;
+	}
+	return true;
+}
+
+bool MapCacheReader::open(const std::string& fileName)
+{
+	const std::string cacheFileName = getMapCacheFileName(fileName);
+	boost::system::error_code error;
+	if (!boost::filesystem::exists(cacheFileName, error)) {
+		return false;
+	}
+
+	try {
+		file.open(cacheFileName);
+	} catch (const std::exception& e) {
+		SPDLOG_WARN("[MapCacheReader::open] - Could not open {}: {}", cacheFileName, e.what());
+		return false;
+	}
+
+	MapCacheHeader header;
+	if (file.size() < sizeof(header)) {
+		SPDLOG_WARN("[MapCacheReader::open] - {} is damaged, loading {} instead", cacheFileName, fileName);
+		file.close();
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.identifier != MAP_CACHE_IDENTIFIER || header.version != MAP_CACHE_VERSION) {
+		SPDLOG_WARN("[MapCacheReader::open] - {} was built by another version, loading {} instead", cacheFileName, fileName);
+		file.close();
+		return false;
+	}
+
+	uint64_t sourceSize;
+	uint32_t sourceChecksum;
+	if (!getFileChecksum(fileName, sourceSize, sourceChecksum) || sourceSize != header.sourceSize || sourceChecksum != header.sourceChecksum) {
+		SPDLOG_WARN("[MapCacheReader::open] - {} changed since {} was built, loading it instead", fileName, cacheFileName);
+		file.close();
+		return false;
+	}
+
+	const char* payload = file.data() + sizeof(header);
+	if (header.payloadSize != file.size() - sizeof(header) || updateCrc32(0, payload, header.payloadSize) != header.payloadChecksum) {
+		SPDLOG_WARN("[MapCacheReader::open] - {} is damaged, loading {} instead", cacheFileName, fileName);
+		file.close();
+		return false;
+	}
+
+	position = payload;
+	end = payload + header.payloadSize;
+	complete = false;
+	return true;
+}
+
+bool MapCacheReader::next(MapCacheSection& section)
+{
+	if (complete || position == end) {
+		return false;
+	}
+
+	auto type = static_cast<MapCacheSection_t>(*position++);
+	if (type == MAP_CACHE_END) {
+		complete = true;
+		return false;
+	}
+
+	uint32_t size;
+	if (static_cast<size_t>(end - position) < sizeof(size)) {
+		position = end;
+		return false;
+	}
+
+	std::memcpy(&size, position, sizeof(size));
+	position += sizeof(size);
+	if (static_cast<size_t>(end - position) < size) {
+		position = end;
+		return false;
+	}
+
+	section.type = type;
+	section.data = position;
+	section.size = size;
+	position += size;
+	return true;
+}
+
+bool MapCacheReader::readTileBatch(const MapCacheSection& section, MapTileBatch& batch)
+{
+	uint32_t counts[3];
+	if (section.size < sizeof(counts)) {
+		return false;
+	}
+
+	std::memcpy(counts, section.data, sizeof(counts));
+	const uint64_t tilesSize = static_cast<uint64_t>(counts[0]) * sizeof(MapTileRecord);
+	const uint64_t itemsSize = static_cast<uint64_t>(counts[1]) * sizeof(MapItemRecord);
+	if (section.size != sizeof(counts) + tilesSize + itemsSize + counts[2]) {
+		return false;
+	}
+
+	const char* data = section.data + sizeof(counts);
+	batch.tiles.resize(counts[0]);
+	std::memcpy(batch.tiles.data(), data, tilesSize);
+	data += tilesSize;
+
+	batch.items.resize(counts[1]);
+	std::memcpy(batch.items.data(), data, itemsSize);
+	data += itemsSize;
+
+	batch.props.assign(data, data + counts[2]);
+	batch.error.clear();
+
+	// IOMap::loadTileBatch trusts the offsets
+	for (const MapTileRecord& tile : batch.tiles) {
+		if (static_cast<uint64_t>(tile.firstItem) + tile.itemCount > batch.items.size()) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < batch.items.size(); ++i) {
+		const MapItemRecord& item = batch.items[i];
+		if (static_cast<uint64_t>(item.propsOffset) + item.propsSize > batch.props.size() || i + item.descendantCount >= batch.items.size()) {
+			return false;
+		}
+	}
+	return true;
+}
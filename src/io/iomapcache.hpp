@@ -0,0 +1,121 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_IO_IOMAPCACHE_HPP_
+#define SRC_IO_IOMAPCACHE_HPP_
+
+#include <fstream>
+
+#include "io/iomap.h"
+
+/**
+ * Map cache: a copy of an OTBM with the node tree, the escaping and the tile
+ * decoding already done, written by --build-map-cache next to the map file
+ * or into cacheDirectory, where every world of the host can map it.
+ * It is a list of sections, the property sections hold the unescaped
+ * properties of the OTBM node and the tile areas hold a MapTileBatch as
+ * flat arrays; IOMap feeds both to the same code that loads the OTBM.
+ * The cache is only used while the size and checksum of the OTBM match.
+ * Records are stored in the byte order of the machine that built it.
+ */
+enum MapCacheSection_t : uint8_t {
+	MAP_CACHE_END = 0,
+	MAP_CACHE_ROOT_HEADER = 1,
+	MAP_CACHE_MAP_DATA = 2,
+	MAP_CACHE_TOWN = 3,
+	MAP_CACHE_WAYPOINT = 4,
+	MAP_CACHE_TILE_AREA = 5,
+};
+
+static constexpr uint32_t MAP_CACHE_VERSION = 1;
+
+#pragma pack(1)
+
+struct MapCacheHeader {
+	std::array<char, 4> identifier;
+	uint32_t version;
+	uint64_t sourceSize;
+	uint32_t sourceChecksum;
+	uint64_t payloadSize;
+	uint32_t payloadChecksum;
+};
+
+#pragma pack()
+
+struct MapCacheSection {
+	MapCacheSection_t type;
+	const char* data;
+	size_t size;
+};
+
+std::string getMapCacheFileName(const std::string& fileName);
+
+class MapCacheWriter
+{
+	public:
+		explicit MapCacheWriter(const std::string& fileName);
+
+		// non-copyable
+		MapCacheWriter(const MapCacheWriter&) = delete;
+		MapCacheWriter& operator=(const MapCacheWriter&) = delete;
+
+		void addNode(MapCacheSection_t type, const OTB::Node& node);
+		void addTileBatch(const MapTileBatch& batch);
+
+		// Writes the cache file, replacing an older one only once it is complete
+		bool save();
+
+	private:
+		void write(const char* data, size_t size);
+		void addSection(MapCacheSection_t type, const char* data, size_t size);
+
+		std::string fileName;
+		std::string tempFileName;
+		std::ofstream file;
+		std::vector<char> buffer;
+		uint64_t payloadSize = 0;
+		uint32_t payloadChecksum = 0;
+};
+
+class MapCacheReader
+{
+	public:
+		// Maps the cache of fileName, false if there is none or it does not match the OTBM
+		bool open(const std::string& fileName);
+
+		bool next(MapCacheSection& section);
+		// the last section was the end marker
+		bool isComplete() const {
+			return complete;
+		}
+
+		static bool readTileBatch(const MapCacheSection& section, MapTileBatch& batch);
+
+		const boost::iostreams::mapped_file_source& getFile() const {
+			return file;
+		}
+
+	private:
+		boost::iostreams::mapped_file_source file;
+		const char* position = nullptr;
+		const char* end = nullptr;
+		bool complete = false;
+};
+
+#endif  // SRC_IO_IOMAPCACHE_HPP_
@@ -20,12 +20,21 @@
 #include "pch.hpp"
 
 #include "io/iomapserialize.h"
+#include "io/compressed_blob.hpp"
 #include "game/game.h"
 #include "items/bed.h"
 
+namespace {
+
+// legacy rows start with the x and y of their tile, no house tile can be at 0xFFFF, 0xFFFF
+constexpr uint16_t HOUSE_ROW_MARKER = 0xFFFF;
+constexpr uint8_t HOUSE_ROW_VERSION = 1;
+
+}  // namespace
+
 void IOMapSerialize::loadHouseItems(Map* map)
 {
-	int64_t start = OTSYS_TIME();
+	int64_t start = OTSYS_PRECISE_TIME();
 
 	DBResult_ptr result = Database::getInstance().storeQuery("SELECT `data` FROM `tile_store`");
 	if (!result) {
@@ -40,73 +49,195 @@ void IOMapSerialize::loadHouseItems(Map* map)
 		propStream.init(attr, attrSize);
 
 		uint16_t x, y;
-		uint8_t z;
-		if (!propStream.read<uint16_t>(x) || !propStream.read<uint16_t>(y) || !propStream.read<uint8_t>(z)) {
+		if (!propStream.read<uint16_t>(x) || !propStream.read<uint16_t>(y)) {
 			continue;
 		}
 
-		Tile* tile = map->getTile(x, y, z);
-		if (!tile) {
+		if (x == HOUSE_ROW_MARKER && y == HOUSE_ROW_MARKER) {
+			loadHouseRow(map, attr, attrSize);
 			continue;
 		}
 
-		uint32_t item_count;
-		if (!propStream.read<uint32_t>(item_count)) {
+		uint8_t z;
+		if (!propStream.read<uint8_t>(z)) {
 			continue;
 		}
 
-		while (item_count--) {
-			loadItem(propStream, tile);
+		if (Tile* tile = map->getTile(x, y, z)) {
+			loadTileItems(propStream, tile);
 		}
 	} while (result->next());
-	SPDLOG_INFO("Loaded house items in {} seconds", (OTSYS_TIME() - start) / (1000.));
+
+	// the rows in the database are what the houses hold now, the first save can skip them
+	PropWriteStream stream;
+	for (const auto& [key, house] : map->houses.getHouses()) {
+		house->setSavedFingerprint(serializeHouse(house, stream));
+	}
+	SPDLOG_INFO("Loaded house items in {} seconds", (OTSYS_PRECISE_TIME() - start) / (1000.));
 }
 
 bool IOMapSerialize::saveHouseItems()
 {
-	int64_t start = OTSYS_TIME();
+	int64_t start = OTSYS_PRECISE_TIME();
 	Database& db = Database::getInstance();
 	std::ostringstream query;
 
-	//Start the transaction
-	DBTransaction transaction;
-	if (!transaction.begin()) {
-		return false;
+	// only houses whose rows changed since the last save are written again
+	std::vector<uint32_t> changedHouses;
+	std::vector<DBStatement> inserts;
+	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ", inserts);
+
+	PropWriteStream stream;
+	std::string row;
+	const HouseMap& houses = g_game().map.houses.getHouses();
+	for (const auto& [key, house] : houses) {
+		size_t fingerprint = serializeHouse(house, stream);
+		if (fingerprint == house->getSavedFingerprint()) {
+			continue;
+		}
+
+		// a failed compression keeps the old rows and tries again on the next save
+		if (stream.size() > 0 && !compressHouse(stream, row)) {
+			continue;
+		}
+
+		house->setSavedFingerprint(fingerprint);
+		changedHouses.push_back(house->getId());
+		if (stream.size() > 0) {
+			query << house->getId() << ',' << db.escapeBlob(row.data(), static_cast<uint32_t>(row.size()));
+			stmt.addRow(query);
+		}
 	}
 
-	//clear old tile data
-	if (!db.executeQuery("DELETE FROM `tile_store`")) {
-		return false;
+	stmt.execute();
+
+	// the old rows of every changed house go first
+	auto queries = std::make_shared<std::vector<DBStatement>>();
+	queries->reserve(changedHouses.size() + inserts.size());
+	for (uint32_t houseId : changedHouses) {
+		queries->push_back(DBStatement("DELETE FROM `tile_store` WHERE `house_id` = ?").bind(houseId));
 	}
+	std::move(inserts.begin(), inserts.end(), std::back_inserter(*queries));
 
-	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
+	SPDLOG_INFO("Serialized house items in {} seconds, {} of {} houses changed", (OTSYS_PRECISE_TIME() - start) / (1000.), changedHouses.size(), houses.size());
+	if (changedHouses.empty()) {
+		return true;
+	}
 
-	PropWriteStream stream;
-	for (const auto& [key, house] : g_game().map.houses.getHouses()) {
-		//save house items
-		for (HouseTile* tile : house->getTiles()) {
-			saveTile(stream, tile);
-
-			size_t attributesSize;
-			const char* attributes = stream.getStream(attributesSize);
-			if (attributesSize > 0) {
-				query << house->getId() << ',' << db.escapeBlob(attributes, attributesSize);
-				if (!stmt.addRow(query)) {
-					return false;
-				}
-				stream.clear();
+	auto persist = [queries](Database& taskDb) {
+		DBTransaction transaction(taskDb);
+		if (!transaction.begin()) {
+			return false;
+		}
+
+		for (const DBStatement& statement : *queries) {
+			if (!taskDb.executeQuery(statement)) {
+				return false;
 			}
 		}
+		return transaction.commit();
+	};
+	auto done = [changedHouses](DBResult_ptr, bool success) {
+		if (success) {
+			return;
+		}
+
+		// write them again on the next save
+		SPDLOG_WARN("[IOMapSerialize::saveHouseItems] - Failed to save the items of {} houses", changedHouses.size());
+		for (uint32_t houseId : changedHouses) {
+			if (House* house = g_game().map.houses.getHouse(houseId)) {
+				house->setSavedFingerprint(0);
+			}
+		}
+	};
+
+	if (!g_databaseTasks().addTask(persist, done, 0)) {
+		bool success = persist(db);
+		done(nullptr, success);
+		return success;
 	}
+	return true;
+}
 
-	if (!stmt.execute()) {
-		return false;
+size_t IOMapSerialize::serializeHouse(const House* house, PropWriteStream& stream)
+{
+	stream.clear();
+	Position lastPosition;
+	for (HouseTile* tile : house->getTiles()) {
+		saveTile(stream, tile, lastPosition);
 	}
 
-	//End the transaction
-	bool success = transaction.commit();
-	SPDLOG_INFO("Saved house items in {} seconds", (OTSYS_TIME() - start) / (1000.));
-	return success;
+	// 0 is left for an unknown state
+	size_t fingerprint = 1;
+	size_t size;
+	const char* data = stream.getStream(size);
+	boost::hash_combine(fingerprint, std::hash<std::string_view>()(std::string_view(data, size)));
+	return fingerprint;
+}
+
+bool IOMapSerialize::compressHouse(const PropWriteStream& stream, std::string& row)
+{
+	size_t size;
+	const char* data = stream.getStream(size);
+
+	row.clear();
+	row.append(reinterpret_cast<const char*>(&HOUSE_ROW_MARKER), sizeof(uint16_t));
+	row.append(reinterpret_cast<const char*>(&HOUSE_ROW_MARKER), sizeof(uint16_t));
+	return CompressedBlob::compress(HOUSE_ROW_VERSION, data, size, row);
+}
+
+void IOMapSerialize::loadHouseRow(Map* map, const char* data, size_t size)
+{
+	uint8_t version;
+	std::vector<char> raw;
+	const size_t markerSize = sizeof(uint16_t) * 2;
+	if (size < markerSize || !CompressedBlob::uncompress(data + markerSize, size - markerSize, version, raw)) {
+		SPDLOG_WARN("[IOMapSerialize::loadHouseRow] - Corrupted house row");
+		return;
+	}
+
+	if (version != HOUSE_ROW_VERSION) {
+		SPDLOG_WARN("[IOMapSerialize::loadHouseRow] - Unknown house row version {}", version);
+		return;
+	}
+
+	PropStream propStream;
+	propStream.init(raw.data(), raw.size());
+
+	Position position;
+	while (propStream.size() > 0) {
+		uint16_t deltaX, deltaY;
+		uint8_t deltaZ;
+		uint32_t tileSize;
+		if (!propStream.read<uint16_t>(deltaX) || !propStream.read<uint16_t>(deltaY) || !propStream.read<uint8_t>(deltaZ) || !propStream.read<uint32_t>(tileSize) || propStream.size() < tileSize) {
+			SPDLOG_WARN("[IOMapSerialize::loadHouseRow] - Truncated tile at {}", position.toString());
+			return;
+		}
+
+		position.x += deltaX;
+		position.y += deltaY;
+		position.z += deltaZ;
+
+		// every tile has its own size, a tile removed from the map or a broken item only loses that tile
+		PropStream tileStream;
+		tileStream.init(propStream.data(), tileSize);
+		propStream.skip(tileSize);
+		if (Tile* tile = map->getTile(position)) {
+			loadTileItems(tileStream, tile);
+		}
+	}
+}
+
+void IOMapSerialize::loadTileItems(PropStream& propStream, Tile* tile)
+{
+	uint32_t item_count;
+	if (!propStream.read<uint32_t>(item_count)) {
+		return;
+	}
+
+	while (item_count--) {
+		loadItem(propStream, tile);
+	}
 }
 
 bool IOMapSerialize::loadContainer(PropStream& propStream, Container* container)
@@ -230,11 +361,11 @@ void IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item)
 	stream.write<uint8_t>(0x00); // attr end
 }
 
-void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
+bool IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile, Position& lastPosition)
 {
 	const TileItemVector* tileItems = tile->getItemList();
 	if (!tileItems) {
-		return;
+		return false;
 	}
 
 	std::forward_list<Item*> items;
@@ -252,17 +383,27 @@ void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
 		++count;
 	}
 
-	if (!items.empty()) {
-		const Position& tilePosition = tile->getPosition();
-		stream.write<uint16_t>(tilePosition.x);
-		stream.write<uint16_t>(tilePosition.y);
-		stream.write<uint8_t>(tilePosition.z);
+	if (items.empty()) {
+		return false;
+	}
 
-		stream.write<uint32_t>(count);
-		for (const Item* item : items) {
-			saveItem(stream, item);
-		}
+	// the tiles of a house are next to each other, the deltas are mostly 0 and 1 and deflate well
+	const Position& tilePosition = tile->getPosition();
+	stream.write<uint16_t>(static_cast<uint16_t>(tilePosition.x - lastPosition.x));
+	stream.write<uint16_t>(static_cast<uint16_t>(tilePosition.y - lastPosition.y));
+	stream.write<uint8_t>(static_cast<uint8_t>(tilePosition.z - lastPosition.z));
+	lastPosition = tilePosition;
+
+	// the size of the tile is only known once its items are written
+	size_t sizeOffset = stream.size();
+	stream.write<uint32_t>(0);
+
+	stream.write<uint32_t>(count);
+	for (const Item* item : items) {
+		saveItem(stream, item);
 	}
+	stream.writeAt<uint32_t>(sizeOffset, static_cast<uint32_t>(stream.size() - sizeOffset - sizeof(uint32_t)));
+	return true;
 }
 
 bool IOMapSerialize::loadHouseInfo()
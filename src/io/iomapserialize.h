@@ -30,10 +30,20 @@ class IOMapSerialize
 		static bool loadHouseInfo();
 		static bool saveHouseInfo();
 
-	private:
+		// the item with its attributes and, for containers, everything inside it
 		static void saveItem(PropWriteStream& stream, const Item* item);
-		static void saveTile(PropWriteStream& stream, const Tile* tile);
 
+	private:
+		// the position is written as a delta from lastPosition, returns false if the tile has nothing to keep
+		static bool saveTile(PropWriteStream& stream, const Tile* tile, Position& lastPosition);
+		// every tile of the house with items to keep in one stream, returns its fingerprint
+		static size_t serializeHouse(const House* house, PropWriteStream& stream);
+		// the versioned tile_store row of a serialized house
+		static bool compressHouse(const PropWriteStream& stream, std::string& row);
+
+		// a row holding a whole house, legacy rows hold a single tile
+		static void loadHouseRow(Map* map, const char* data, size_t size);
+		static void loadTileItems(PropStream& propStream, Tile* tile);
 		static bool loadContainer(PropStream& propStream, Container* container);
 		static bool loadItem(PropStream& propStream, Cylinder* parent);
 };
@@ -35,61 +35,149 @@ uint8_t IOMarket::getTierFromDatabaseTable(const std::string &string) {
 	return tier;
 }
 
-MarketOfferList IOMarket::getActiveOffers(MarketAction_t action, uint16_t itemId, uint8_t tier)
+void IOMarket::loadOffers()
 {
-	MarketOfferList offerList;
-
-	std::ostringstream query;
-	query << "SELECT `id`, `amount`, `price`, `tier`, `created`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `sale` = " << action << " AND `itemtype` = " << itemId << " AND `tier` = " << std::to_string(tier);
+	offers.clear();
+	offerBook.clear();
+	playerOffers.clear();
+	offerCounters.clear();
+	nextOfferId = 1;
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	DBResult_ptr result = Database::getInstance().storeQuery("SELECT `id`, `player_id`, `sale`, `itemtype`, `amount`, `created`, `anonymous`, `price`, `tier`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers`");
 	if (!result) {
-		return offerList;
+		return;
 	}
 
-	const int32_t marketOfferDuration = g_configManager().getNumber(MARKET_OFFER_DURATION);
-
 	do {
-		MarketOffer offer;
+		MarketOfferEx offer;
+		offer.id = result->getNumber<uint32_t>("id");
+		offer.playerId = result->getNumber<uint32_t>("player_id");
+		offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
+		offer.itemId = result->getNumber<uint16_t>("itemtype");
 		offer.amount = result->getNumber<uint16_t>("amount");
+		offer.timestamp = result->getNumber<uint32_t>("created");
+		offer.counter = offer.id & 0xFFFF;
 		offer.price = result->getNumber<uint64_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
+		offer.tier = getTierFromDatabaseTable(result->getString("tier"));
 		if (result->getNumber<uint16_t>("anonymous") == 0) {
 			offer.playerName = result->getString("player_name");
 		} else {
 			offer.playerName = "Anonymous";
 		}
-		offer.tier = getTierFromDatabaseTable(result->getString("tier"));
-		offerList.push_back(offer);
+		nextOfferId = std::max(nextOfferId, offer.id + 1);
+		addOffer(std::move(offer));
 	} while (result->next());
-	return offerList;
+	SPDLOG_INFO("Loaded {} market offers", offers.size());
 }
 
-MarketOfferList IOMarket::getOwnOffers(MarketAction_t action, uint32_t playerId)
+void IOMarket::addOffer(MarketOfferEx&& offer)
+{
+	uint32_t offerId = offer.id;
+	offerBook[getBookKey(offer.type, offer.itemId, offer.tier)].emplace(offer.price, offerId);
+	playerOffers[offer.playerId].insert(offerId);
+	offerCounters[getCounterKey(offer.timestamp, offer.counter)] = offerId;
+	offers.emplace(offerId, std::move(offer));
+}
+
+void IOMarket::removeOffer(std::map<uint32_t, MarketOfferEx>::iterator it)
+{
+	const MarketOfferEx& offer = it->second;
+	auto bookIt = offerBook.find(getBookKey(offer.type, offer.itemId, offer.tier));
+	if (bookIt != offerBook.end()) {
+		bookIt->second.erase(std::make_pair(offer.price, offer.id));
+		if (bookIt->second.empty()) {
+			offerBook.erase(bookIt);
+		}
+	}
+
+	auto playerIt = playerOffers.find(offer.playerId);
+	if (playerIt != playerOffers.end()) {
+		playerIt->second.erase(offer.id);
+		if (playerIt->second.empty()) {
+			playerOffers.erase(playerIt);
+		}
+	}
+
+	offerCounters.erase(getCounterKey(offer.timestamp, offer.counter));
+	offers.erase(it);
+}
+
+void IOMarket::writeOffer(uint32_t offerId, std::vector<DBStatement> statements)
+{
+	auto write = [statements = std::move(statements)](Database& db) {
+		DBTransaction transaction(db);
+		if (!transaction.begin()) {
+			return false;
+		}
+
+		for (const DBStatement& statement : statements) {
+			if (!db.executeQuery(statement)) {
+				SPDLOG_WARN("[IOMarket::writeOffer] - Error writing query: {}", statement.getQuery());
+				return false;
+			}
+		}
+		return transaction.commit();
+	};
+
+	// keyed by offer, so the rows of one offer are written in order
+	if (!g_databaseTasks().addTask(write, nullptr, offerId)) {
+		write(Database::getInstance());
+	}
+}
+
+MarketOfferList IOMarket::getActiveOffers(MarketAction_t action, uint16_t itemId, uint8_t tier)
 {
 	MarketOfferList offerList;
 
+	const IOMarket& market = getInstance();
+	auto bookIt = market.offerBook.find(getBookKey(action, itemId, tier));
+	if (bookIt == market.offerBook.end()) {
+		return offerList;
+	}
+
 	const int32_t marketOfferDuration = g_configManager().getNumber(MARKET_OFFER_DURATION);
 
-	std::ostringstream query;
-	query << "SELECT `id`, `amount`, `price`, `created`, `itemtype`, `tier` FROM `market_offers` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
+	for (const auto& [price, offerId] : bookIt->second) {
+		const MarketOfferEx& offerEx = market.offers.at(offerId);
+		MarketOffer offer;
+		offer.amount = offerEx.amount;
+		offer.price = offerEx.price;
+		offer.timestamp = offerEx.timestamp + marketOfferDuration;
+		offer.counter = offerEx.counter;
+		offer.playerName = offerEx.playerName;
+		offer.tier = offerEx.tier;
+		offerList.push_back(offer);
+	}
+	return offerList;
+}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
-	if (!result) {
+MarketOfferList IOMarket::getOwnOffers(MarketAction_t action, uint32_t playerId)
+{
+	MarketOfferList offerList;
+
+	const IOMarket& market = getInstance();
+	auto playerIt = market.playerOffers.find(playerId);
+	if (playerIt == market.playerOffers.end()) {
 		return offerList;
 	}
 
-	do {
+	const int32_t marketOfferDuration = g_configManager().getNumber(MARKET_OFFER_DURATION);
+
+	for (uint32_t offerId : playerIt->second) {
+		const MarketOfferEx& offerEx = market.offers.at(offerId);
+		if (offerEx.type != action) {
+			continue;
+		}
+
 		MarketOffer offer;
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint64_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-		offer.itemId = result->getNumber<uint16_t>("itemtype");
-		offer.tier = getTierFromDatabaseTable(result->getString("tier"));
+		offer.amount = offerEx.amount;
+		offer.price = offerEx.price;
+		offer.timestamp = offerEx.timestamp + marketOfferDuration;
+		offer.counter = offerEx.counter;
+		offer.itemId = offerEx.itemId;
+		offer.tier = offerEx.tier;
 		offerList.push_back(offer);
-	} while (result->next());
+	}
 	return offerList;
 }
 
@@ -97,10 +185,10 @@ HistoryMarketOfferList IOMarket::getOwnHistory(MarketAction_t action, uint32_t p
 {
 	HistoryMarketOfferList offerList;
 
-	std::ostringstream query;
-	query << "SELECT `itemtype`, `amount`, `price`, `expires_at`, `state`, `tier` FROM `market_history` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
+	DBStatement statement("SELECT `itemtype`, `amount`, `price`, `expires_at`, `state`, `tier` FROM `market_history` WHERE `player_id` = ? AND `sale` = ?");
+	statement.bind(playerId).bind(static_cast<uint16_t>(action));
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	DBResult_ptr result = Database::getInstance().getReadConnection(Database::getPlayerKey(playerId)).storeQuery(statement);
 	if (!result) {
 		return offerList;
 	}
@@ -125,170 +213,278 @@ HistoryMarketOfferList IOMarket::getOwnHistory(MarketAction_t action, uint32_t p
 	return offerList;
 }
 
-void IOMarket::processExpiredOffers(DBResult_ptr result, bool)
+void IOMarket::checkExpiredOffers()
 {
-	if (!result) {
+	IOMarket& market = getInstance();
+	if (market.expiringOffers.empty()) {
+		const time_t lastExpireDate = time(nullptr) - g_configManager().getNumber(MARKET_OFFER_DURATION);
+		for (const auto& it : market.offers) {
+			if (it.second.timestamp <= lastExpireDate) {
+				market.expiringOffers.push_back(it.first);
+			}
+		}
+
+		if (!market.expiringOffers.empty()) {
+			market.expiryRun = {};
+			market.expiryRun.start = OTSYS_PRECISE_TIME();
+			market.processExpiredBatch();
+		}
+	}
+
+	int32_t checkExpiredMarketOffersEachMinutes = g_configManager().getNumber(CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES);
+	if (checkExpiredMarketOffersEachMinutes <= 0) {
 		return;
 	}
 
-	do {
-		if (!IOMarket::moveOfferToHistory(result->getNumber<uint32_t>("id"), OFFERSTATE_EXPIRED)) {
+	g_scheduler().addEvent(createSchedulerTask(checkExpiredMarketOffersEachMinutes * 60 * 1000, IOMarket::checkExpiredOffers));
+}
+
+void IOMarket::processExpiredBatch()
+{
+	int64_t batchStart = OTSYS_PRECISE_TIME();
+	time_t now = time(nullptr);
+
+	// one DELETE and one multi-row history INSERT for the whole batch
+	std::vector<DBStatement> statements;
+	DBInsert historyQuery("INSERT INTO `market_history` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `expires_at`, `inserted`, `state`, `tier`) VALUES ", statements);
+	std::ostringstream offerIds;
+	std::ostringstream row;
+
+	// ordered by player, the offers of one player are returned together
+	std::map<uint32_t, std::vector<MarketOfferEx>> playerReturns;
+	uint32_t firstOfferId = 0;
+	size_t count = 0;
+	while (count < EXPIRY_BATCH_SIZE && !expiringOffers.empty()) {
+		uint32_t offerId = expiringOffers.front();
+		expiringOffers.pop_front();
+
+		auto it = offers.find(offerId);
+		if (it == offers.end()) {
+			// accepted or cancelled since it was queued
 			continue;
 		}
 
-		const uint32_t playerId = result->getNumber<uint32_t>("player_id");
-		const uint16_t amount = result->getNumber<uint16_t>("amount");
-		const auto tier = getTierFromDatabaseTable(result->getString("tier"));
-		if (result->getNumber<uint16_t>("sale") == 1) {
-			const ItemType& itemType = Item::items[result->getNumber<uint16_t>("itemtype")];
-			if (itemType.id == 0) {
-				continue;
-			}
+		const MarketOfferEx& offer = it->second;
+		if (count == 0) {
+			firstOfferId = offerId;
+		} else {
+			offerIds << ',';
+		}
+		offerIds << offerId;
 
-			Player* player = g_game().getPlayerByGUID(playerId);
-			if (!player) {
-				player = new Player(nullptr);
-				if (!IOLoginData::loadPlayerById(player, playerId)) {
-					delete player;
-					continue;
-				}
-			}
+		row << offer.playerId << ',' << offer.type << ',' << offer.itemId << ',' << offer.amount << ',' << offer.price << ','
+			<< now << ',' << now << ',' << OFFERSTATE_EXPIRED << ',' << std::to_string(offer.tier);
+		historyQuery.addRow(row);
 
-			if (itemType.stackable) {
-				uint16_t tmpAmount = amount;
-				while (tmpAmount > 0) {
-					uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
-					Item* item = Item::CreateItem(itemType.id, stackCount);
-					if (g_game().internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR)
-					{
-						SPDLOG_ERROR("{} - Ocurred an error to add item with id {} to player {}", itemType.id, player->getName());
-						delete item;
-						break;
-					}
-
-					if (tier != 0) {
-						item->setIntAttr(ITEM_ATTRIBUTE_TIER, tier);
-					}
-
-					tmpAmount -= stackCount;
-				}
-			} else {
-				int32_t subType;
-				if (itemType.charges != 0) {
-					subType = itemType.charges;
-				} else {
-					subType = -1;
-				}
-
-				for (uint16_t i = 0; i < amount; ++i) {
-					Item* item = Item::CreateItem(itemType.id, subType);
-					if (g_game().internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
-						delete item;
-						break;
-					}
-
-					if (tier != 0) {
-						item->setIntAttr(ITEM_ATTRIBUTE_TIER, tier);
-					}
-				}
-			}
+		playerReturns[offer.playerId].push_back(offer);
+		removeOffer(it);
+		++count;
+	}
 
-			if (player->isOffline()) {
-				IOLoginData::savePlayer(player);
-				delete player;
-			}
-		} else {
-			uint64_t totalPrice = result->getNumber<uint64_t>("price") * amount;
+	if (count != 0) {
+		historyQuery.execute();
+		statements.emplace_back("DELETE FROM `market_offers` WHERE `id` IN (" + offerIds.str() + ")");
+		writeOffer(firstOfferId, std::move(statements));
+	}
 
-			Player* player = g_game().getPlayerByGUID(playerId);
-			if (player) {
-				player->setBankBalance(player->getBankBalance() + totalPrice);
-			} else {
-				IOLoginData::increaseBankBalance(playerId, totalPrice);
-			}
-		}
-	} while (result->next());
+	for (const auto& [playerId, expiredOffers] : playerReturns) {
+		Database::markWritten(Database::getPlayerKey(playerId));
+		returnExpiredOffers(playerId, expiredOffers);
+	}
+
+	expiryRun.offers += count;
+	expiryRun.playerReturns += playerReturns.size();
+	++expiryRun.batches;
+	expiryRun.busyMs += OTSYS_PRECISE_TIME() - batchStart;
+
+	if (!expiringOffers.empty()) {
+		SchedulerTask* task = createSchedulerTask(EXPIRY_BATCH_DELAY, std::bind(&IOMarket::processExpiredBatch, this));
+		task->setPriority(TASK_PRIORITY_LOW);
+		g_scheduler().addEvent(task);
+		return;
+	}
+
+	if (expiryRun.offers != 0) {
+		SPDLOG_INFO("[IOMarket::checkExpiredOffers] Returned {} expired offers to {} players in {} batches, {}ms on the dispatcher over {}ms",
+			expiryRun.offers, expiryRun.playerReturns, expiryRun.batches, expiryRun.busyMs, OTSYS_PRECISE_TIME() - expiryRun.start);
+	}
 }
 
-void IOMarket::checkExpiredOffers()
+void IOMarket::returnExpiredOffers(uint32_t playerId, const std::vector<MarketOfferEx>& expiredOffers)
 {
-	const time_t lastExpireDate = time(nullptr) - g_configManager().getNumber(MARKET_OFFER_DURATION);
+	uint64_t totalPrice = 0;
+	bool hasItems = false;
+	for (const MarketOfferEx& offer : expiredOffers) {
+		if (offer.type == MARKETACTION_BUY) {
+			totalPrice += offer.price * offer.amount;
+		} else {
+			hasItems = true;
+		}
+	}
 
-	std::ostringstream query;
-	query << "SELECT `id`, `amount`, `price`, `itemtype`, `player_id`, `sale`, `tier` FROM `market_offers` WHERE `created` <= " << lastExpireDate;
-	g_databaseTasks().addTask(query.str(), IOMarket::processExpiredOffers, true);
+	Player* player = g_game().getPlayerByGUID(playerId);
+	if (totalPrice != 0) {
+		if (player) {
+			player->setBankBalance(player->getBankBalance() + totalPrice);
+		} else {
+			IOLoginData::increaseBankBalance(playerId, totalPrice);
+		}
+	}
 
-	int32_t checkExpiredMarketOffersEachMinutes = g_configManager().getNumber(CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES);
-	if (checkExpiredMarketOffersEachMinutes <= 0) {
+	if (!hasItems) {
 		return;
 	}
 
-	g_scheduler().addEvent(createSchedulerTask(checkExpiredMarketOffersEachMinutes * 60 * 1000, IOMarket::checkExpiredOffers));
+	if (!player) {
+		// the load waits for the balance update above
+		player = new Player(nullptr);
+		if (!IOLoginData::loadPlayerById(player, playerId)) {
+			delete player;
+			return;
+		}
+	}
+
+	for (const MarketOfferEx& offer : expiredOffers) {
+		if (offer.type == MARKETACTION_SELL) {
+			returnOfferItems(player, offer);
+		}
+	}
+
+	if (player->isOffline()) {
+		IOLoginData::savePlayerAsync(player);
+		delete player;
+	}
 }
 
-uint32_t IOMarket::getPlayerOfferCount(uint32_t playerId)
+void IOMarket::returnOfferItems(Player* player, const MarketOfferEx& offer)
 {
-	std::ostringstream query;
-	query << "SELECT COUNT(*) AS `count` FROM `market_offers` WHERE `player_id` = " << playerId;
+	const ItemType& itemType = Item::items[offer.itemId];
+	if (itemType.id == 0) {
+		return;
+	}
 
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
-	if (!result) {
+	if (itemType.stackable) {
+		uint16_t tmpAmount = offer.amount;
+		while (tmpAmount > 0) {
+			uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
+			Item* item = Item::CreateItem(itemType.id, stackCount);
+			if (g_game().internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR)
+			{
+				SPDLOG_ERROR("{} - Ocurred an error to add item with id {} to player {}", itemType.id, player->getName());
+				delete item;
+				break;
+			}
+
+			if (offer.tier != 0) {
+				item->setIntAttr(ITEM_ATTRIBUTE_TIER, offer.tier);
+			}
+
+			tmpAmount -= stackCount;
+		}
+	} else {
+		int32_t subType;
+		if (itemType.charges != 0) {
+			subType = itemType.charges;
+		} else {
+			subType = -1;
+		}
+
+		for (uint16_t i = 0; i < offer.amount; ++i) {
+			Item* item = Item::CreateItem(itemType.id, subType);
+			if (g_game().internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+				delete item;
+				break;
+			}
+
+			if (offer.tier != 0) {
+				item->setIntAttr(ITEM_ATTRIBUTE_TIER, offer.tier);
+			}
+		}
+	}
+}
+
+uint32_t IOMarket::getPlayerOfferCount(uint32_t playerId)
+{
+	const IOMarket& market = getInstance();
+	auto playerIt = market.playerOffers.find(playerId);
+	if (playerIt == market.playerOffers.end()) {
 		return 0;
 	}
-	return result->getNumber<int32_t>("count");
+	return static_cast<uint32_t>(playerIt->second.size());
 }
 
 MarketOfferEx IOMarket::getOfferByCounter(uint32_t timestamp, uint16_t counter)
 {
-	MarketOfferEx offer;
+	const IOMarket& market = getInstance();
+	const uint32_t created = timestamp - g_configManager().getNumber(MARKET_OFFER_DURATION);
 
-	const int32_t created = timestamp - g_configManager().getNumber(MARKET_OFFER_DURATION);
-
-	std::ostringstream query;
-	query << "SELECT `id`, `sale`, `itemtype`, `amount`, `created`, `price`, `player_id`, `anonymous`, `tier`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `created` = " << created << " AND (`id` & 65535) = " << counter << " LIMIT 1";
-
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
-	if (!result) {
+	auto it = market.offerCounters.find(getCounterKey(created, counter));
+	if (it == market.offerCounters.end()) {
+		MarketOfferEx offer;
 		offer.id = 0;
 		return offer;
 	}
-
-	offer.id = result->getNumber<uint32_t>("id");
-	offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
-	offer.amount = result->getNumber<uint16_t>("amount");
-	offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-	offer.timestamp = result->getNumber<uint32_t>("created");
-	offer.price = result->getNumber<uint64_t>("price");
-	offer.itemId = result->getNumber<uint16_t>("itemtype");
-	offer.playerId = result->getNumber<uint32_t>("player_id");
-	offer.tier = getTierFromDatabaseTable(result->getString("tier"));
-	if (result->getNumber<uint16_t>("anonymous") == 0) {
-		offer.playerName = result->getString("player_name");
-	} else {
-		offer.playerName = "Anonymous";
-	}
-	return offer;
+	return market.offers.at(it->second);
 }
 
 void IOMarket::createOffer(uint32_t playerId, MarketAction_t action, uint32_t itemId, uint16_t amount, uint64_t price, uint8_t tier, bool anonymous)
 {
-	std::ostringstream query;
-	query << "INSERT INTO `market_offers` (`player_id`, `sale`, `itemtype`, `amount`, `created`, `anonymous`, `price`, `tier`) VALUES (" << playerId << ',' << action << ',' << itemId << ',' << amount << ',' << time(nullptr) << ',' << anonymous << ',' << price << ',' << std::to_string(tier) << ')';
-	Database::getInstance().executeQuery(query.str());
+	IOMarket& market = getInstance();
+
+	MarketOfferEx offer;
+	offer.id = market.nextOfferId++;
+	offer.playerId = playerId;
+	offer.type = action;
+	offer.itemId = static_cast<uint16_t>(itemId);
+	offer.amount = amount;
+	offer.timestamp = static_cast<uint32_t>(time(nullptr));
+	offer.counter = offer.id & 0xFFFF;
+	offer.price = price;
+	offer.tier = tier;
+	if (anonymous) {
+		offer.playerName = "Anonymous";
+	} else if (const Player* player = g_game().getPlayerByGUID(playerId)) {
+		offer.playerName = player->getName();
+	} else {
+		offer.playerName = IOLoginData::getNameByGuid(playerId);
+	}
+
+	// the id is given here, so the row exists in memory before it does in the database
+	DBStatement statement("INSERT INTO `market_offers` (`id`, `player_id`, `sale`, `itemtype`, `amount`, `created`, `anonymous`, `price`, `tier`) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+	statement.bind(offer.id).bind(playerId).bind(static_cast<uint16_t>(action)).bind(itemId).bind(amount).bind(offer.timestamp).bind(anonymous).bind(price).bind(tier);
+	std::vector<DBStatement> statements;
+	statements.push_back(std::move(statement));
+	writeOffer(offer.id, std::move(statements));
+
+	market.addOffer(std::move(offer));
 }
 
 void IOMarket::acceptOffer(uint32_t offerId, uint16_t amount)
 {
-	std::ostringstream query;
-	query << "UPDATE `market_offers` SET `amount` = `amount` - " << amount << " WHERE `id` = " << offerId;
-	Database::getInstance().executeQuery(query.str());
+	IOMarket& market = getInstance();
+	auto it = market.offers.find(offerId);
+	if (it == market.offers.end()) {
+		return;
+	}
+
+	it->second.amount -= std::min(amount, it->second.amount);
+
+	std::vector<DBStatement> statements;
+	statements.push_back(DBStatement("UPDATE `market_offers` SET `amount` = `amount` - ? WHERE `id` = ?").bind(amount).bind(offerId));
+	writeOffer(offerId, std::move(statements));
 }
 
 void IOMarket::deleteOffer(uint32_t offerId)
 {
-	std::ostringstream query;
-	query << "DELETE FROM `market_offers` WHERE `id` = " << offerId;
-	Database::getInstance().executeQuery(query.str());
+	IOMarket& market = getInstance();
+	auto it = market.offers.find(offerId);
+	if (it != market.offers.end()) {
+		market.removeOffer(it);
+	}
+
+	std::vector<DBStatement> statements;
+	statements.push_back(DBStatement("DELETE FROM `market_offers` WHERE `id` = ?").bind(offerId));
+	writeOffer(offerId, std::move(statements));
 }
 
 void IOMarket::appendHistory(uint32_t playerId, MarketAction_t type, uint16_t itemId, uint16_t amount, uint64_t price, time_t timestamp, uint8_t tier, MarketOfferState_t state)
@@ -297,53 +493,146 @@ void IOMarket::appendHistory(uint32_t playerId, MarketAction_t type, uint16_t it
 	query << "INSERT INTO `market_history` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `expires_at`, `inserted`, `state`, `tier`) VALUES ("
 		<< playerId << ',' << type << ',' << itemId << ',' << amount << ',' << price << ','
 		<< timestamp << ',' << time(nullptr) << ',' << state << ',' << std::to_string(tier) << ')';
-	g_databaseTasks().addTask(query.str());
+	g_databaseTasks().addTask(query.str(), nullptr, false, playerId, playerId);
+	Database::markWritten(Database::getPlayerKey(playerId));
+
+	// the seller or buyer side of an accepted offer, as the statistics always counted it
+	if (state == OFFERSTATE_ACCEPTED) {
+		getInstance().addStatistics(type, itemId, tier, price);
+	}
 }
 
 bool IOMarket::moveOfferToHistory(uint32_t offerId, MarketOfferState_t state)
 {
-	Database& db = Database::getInstance();
-
-	std::ostringstream query;
-	query << "SELECT `player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `tier` FROM `market_offers` WHERE `id` = " << offerId;
-
-	DBResult_ptr result = db.storeQuery(query.str());
-	if (!result) {
+	IOMarket& market = getInstance();
+	auto it = market.offers.find(offerId);
+	if (it == market.offers.end()) {
 		return false;
 	}
 
-	query.str(std::string());
-	query << "DELETE FROM `market_offers` WHERE `id` = " << offerId;
-	if (!db.executeQuery(query.str())) {
-		return false;
-	}
-
-	appendHistory(result->getNumber<uint32_t>("player_id"), static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale")), result->getNumber<uint16_t>("itemtype"), result->getNumber<uint16_t>("amount"), result->getNumber<uint64_t>("price"), time(nullptr), getTierFromDatabaseTable(result->getString("tier")), state);
+	const MarketOfferEx offer = it->second;
+	deleteOffer(offerId);
+	appendHistory(offer.playerId, offer.type, offer.itemId, offer.amount, offer.price, time(nullptr), offer.tier, state);
 	return true;
 }
 
-void IOMarket::updateStatistics()
+void IOMarket::loadStatistics()
 {
-	std::ostringstream query;
-	query << "SELECT `sale` AS `sale`, `itemtype` AS `itemtype`, COUNT(`price`) AS `num`, MIN(`price`) AS `min`, MAX(`price`) AS `max`, SUM(`price`) AS `sum`, `tier` AS `tier` FROM `market_history` WHERE `state` = " << OFFERSTATE_ACCEPTED << " GROUP BY `itemtype`, `sale`, `tier`";
-	DBResult_ptr result = Database::getInstance().storeQuery(query.str());
+	statistics.clear();
+	statisticsDays = static_cast<uint32_t>(std::max<int32_t>(0, g_configManager().getNumber(MARKET_STATISTICS_DAYS)));
+
+	Database& db = Database::getInstance();
+	uint32_t firstDay = 0;
+	if (statisticsDays != 0) {
+		firstDay = static_cast<uint32_t>(time(nullptr) / STATISTICS_DAY_SECONDS) - statisticsDays + 1;
+		// the days that left the window are never read again
+		db.executeQuery(DBStatement("DELETE FROM `market_statistics` WHERE `day` < ?").bind(firstDay));
+	}
+
+	DBStatement statement("SELECT `sale`, `itemtype`, `tier`, `day`, `num`, `min`, `max`, `sum` FROM `market_statistics` WHERE `day` >= ? ORDER BY `day`");
+	statement.bind(firstDay);
+	DBResult_ptr result = db.storeQuery(statement);
 	if (!result) {
 		return;
 	}
 
+	size_t rows = 0;
 	do {
-		MarketStatistics* statistics = nullptr;
-		auto tier = getTierFromDatabaseTable(result->getString("tier"));
+		auto action = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
 		auto itemId = result->getNumber<uint16_t>("itemtype");
-		if (result->getNumber<uint16_t>("sale") == MARKETACTION_BUY) {
-			statistics = &purchaseStatistics[itemId][tier];
+		auto tier = getTierFromDatabaseTable(result->getString("tier"));
+
+		MarketStatistics dayStatistics;
+		dayStatistics.numTransactions = result->getNumber<uint32_t>("num");
+		dayStatistics.lowestPrice = result->getNumber<uint64_t>("min");
+		dayStatistics.totalPrice = result->getNumber<uint64_t>("sum");
+		dayStatistics.highestPrice = result->getNumber<uint64_t>("max");
+
+		uint32_t day = statisticsDays == 0 ? 0 : result->getNumber<uint32_t>("day");
+		std::vector<DailyStatistics>& days = statistics[getBookKey(action, itemId, tier)];
+		if (days.empty() || days.back().day != day) {
+			days.push_back({day, dayStatistics});
 		} else {
-			statistics = &saleStatistics[itemId][tier];
+			mergeStatistics(days.back().statistics, dayStatistics);
 		}
-
-		statistics->numTransactions = result->getNumber<uint32_t>("num");
-		statistics->lowestPrice = result->getNumber<uint64_t>("min");
-		statistics->totalPrice = result->getNumber<uint64_t>("sum");
-		statistics->highestPrice = result->getNumber<uint64_t>("max");
+		++rows;
 	} while (result->next());
+	SPDLOG_INFO("Loaded {} market statistics rows", rows);
+}
+
+MarketStatistics IOMarket::getStatistics(MarketAction_t action, uint16_t itemId, uint8_t tier) const
+{
+	MarketStatistics windowStatistics;
+	auto it = statistics.find(getBookKey(action, itemId, tier));
+	if (it == statistics.end()) {
+		return windowStatistics;
+	}
+
+	uint32_t today = getStatisticsDay(time(nullptr));
+	for (const DailyStatistics& daily : it->second) {
+		if (statisticsDays == 0 || daily.day + statisticsDays > today) {
+			mergeStatistics(windowStatistics, daily.statistics);
+		}
+	}
+	return windowStatistics;
+}
+
+void IOMarket::mergeStatistics(MarketStatistics& total, const MarketStatistics& other)
+{
+	if (other.numTransactions == 0) {
+		return;
+	}
+
+	if (total.numTransactions == 0) {
+		total = other;
+		return;
+	}
+
+	total.numTransactions += other.numTransactions;
+	total.totalPrice += other.totalPrice;
+	total.highestPrice = std::max(total.highestPrice, other.highestPrice);
+	total.lowestPrice = std::min(total.lowestPrice, other.lowestPrice);
+}
+
+uint32_t IOMarket::getStatisticsDay(time_t timestamp) const
+{
+	return statisticsDays == 0 ? 0 : static_cast<uint32_t>(timestamp / STATISTICS_DAY_SECONDS);
+}
+
+void IOMarket::addStatistics(MarketAction_t action, uint16_t itemId, uint8_t tier, uint64_t price)
+{
+	MarketStatistics transaction;
+	transaction.numTransactions = 1;
+	transaction.lowestPrice = price;
+	transaction.highestPrice = price;
+	transaction.totalPrice = price;
+
+	const time_t now = time(nullptr);
+	const uint32_t bookKey = getBookKey(action, itemId, tier);
+	const uint32_t day = getStatisticsDay(now);
+	std::vector<DailyStatistics>& days = statistics[bookKey];
+	if (days.empty() || days.back().day != day) {
+		days.push_back({day, transaction});
+	} else {
+		mergeStatistics(days.back().statistics, transaction);
+	}
+
+	if (statisticsDays != 0 && days.front().day + statisticsDays <= day) {
+		days.erase(days.begin(), std::find_if(days.begin(), days.end(), [&](const DailyStatistics& daily) {
+			return daily.day + statisticsDays > day;
+		}));
+	}
+
+	// the table always keeps real days, so the window can be changed between restarts
+	DBStatement statement("INSERT INTO `market_statistics` (`sale`, `itemtype`, `tier`, `day`, `num`, `min`, `max`, `sum`) VALUES (?, ?, ?, ?, 1, ?, ?, ?) "
+		"ON DUPLICATE KEY UPDATE `num` = `num` + 1, `min` = LEAST(`min`, VALUES(`min`)), `max` = GREATEST(`max`, VALUES(`max`)), `sum` = `sum` + VALUES(`sum`)");
+	statement.bind(static_cast<uint16_t>(action)).bind(itemId).bind(static_cast<uint16_t>(tier));
+	statement.bind(static_cast<uint32_t>(now / STATISTICS_DAY_SECONDS)).bind(price).bind(price).bind(price);
+
+	auto write = [statement = std::move(statement)](Database& db) {
+		return db.executeQuery(statement);
+	};
+	if (!g_databaseTasks().addTask(write, nullptr, bookKey)) {
+		write(Database::getInstance());
+	}
 }
@@ -23,20 +23,24 @@
 #include "database/database.h"
 #include "declarations.hpp"
 
+class Player;
+
 class IOMarket
 {
-	using StatisticsMap = std::map<uint16_t, std::map<uint8_t, MarketStatistics>>;
 	public:
 		static IOMarket& getInstance() {
 			static IOMarket instance;
 			return instance;
 		}
 
+		// reads the active offers into memory, they are written back on the database workers from then on
+		void loadOffers();
+
 		static MarketOfferList getActiveOffers(MarketAction_t action, uint16_t itemId, uint8_t tier);
 		static MarketOfferList getOwnOffers(MarketAction_t action, uint32_t playerId);
 		static HistoryMarketOfferList getOwnHistory(MarketAction_t action, uint32_t playerId);
 
-		static void processExpiredOffers(DBResult_ptr result, bool);
+		// queues the expired offers and returns them in batches
 		static void checkExpiredOffers();
 
 		static uint32_t getPlayerOfferCount(uint32_t playerId);
@@ -49,23 +53,71 @@ class IOMarket
 		static void appendHistory(uint32_t playerId, MarketAction_t type, uint16_t itemId, uint16_t amount, uint64_t price, time_t timestamp, uint8_t tier, MarketOfferState_t state);
 		static bool moveOfferToHistory(uint32_t offerId, MarketOfferState_t state);
 
-		void updateStatistics();
-
-		StatisticsMap getPurchaseStatistics() const {
-			return purchaseStatistics;
-		}
-		StatisticsMap getSaleStatistics() const {
-			return saleStatistics;
-		}
+		// reads the daily totals of market_statistics, the history table is not aggregated
+		void loadStatistics();
+		// accepted offers of the configured window, all zero if the item was not traded in it
+		MarketStatistics getStatistics(MarketAction_t action, uint16_t itemId, uint8_t tier) const;
 
 		static uint8_t getTierFromDatabaseTable(const std::string &string);
 
 	private:
 		IOMarket() = default;
 
-		// [uint16_t = item id, [uint8_t = item tier, MarketStatistics = structure of the statistics]]
-		StatisticsMap purchaseStatistics;
-		StatisticsMap saleStatistics;
+		static uint32_t getBookKey(MarketAction_t action, uint16_t itemId, uint8_t tier) {
+			return (static_cast<uint32_t>(itemId) << 16) | (static_cast<uint32_t>(tier) << 8) | static_cast<uint32_t>(action);
+		}
+		static uint64_t getCounterKey(uint32_t created, uint16_t counter) {
+			return (static_cast<uint64_t>(created) << 16) | counter;
+		}
+
+		// expired offers handled per dispatcher task, the next batch follows after a short delay
+		static constexpr size_t EXPIRY_BATCH_SIZE = 200;
+		static constexpr uint32_t EXPIRY_BATCH_DELAY = 50;
+
+		void processExpiredBatch();
+		// gives the player its items and money back, loading it once if it is offline
+		static void returnExpiredOffers(uint32_t playerId, const std::vector<MarketOfferEx>& expiredOffers);
+		static void returnOfferItems(Player* player, const MarketOfferEx& offer);
+
+		void addOffer(MarketOfferEx&& offer);
+		void removeOffer(std::map<uint32_t, MarketOfferEx>::iterator it);
+		// runs the statements of one offer in order, in one transaction
+		static void writeOffer(uint32_t offerId, std::vector<DBStatement> statements);
+
+		static constexpr time_t STATISTICS_DAY_SECONDS = 24 * 60 * 60;
+
+		struct DailyStatistics {
+			uint32_t day;
+			MarketStatistics statistics;
+		};
+
+		static void mergeStatistics(MarketStatistics& total, const MarketStatistics& other);
+		// days since the epoch, always 0 without a window so everything goes in one entry
+		uint32_t getStatisticsDay(time_t timestamp) const;
+		// counts one accepted offer in memory and in its market_statistics row
+		void addStatistics(MarketAction_t action, uint16_t itemId, uint8_t tier, uint64_t price);
+
+		// active offers by id, the reference copy: the database follows behind
+		std::map<uint32_t, MarketOfferEx> offers;
+		// offer ids by (item id, tier, action), ordered by price
+		phmap::flat_hash_map<uint32_t, std::set<std::pair<uint64_t, uint32_t>>> offerBook;
+		phmap::flat_hash_map<uint32_t, std::set<uint32_t>> playerOffers;
+		// offer ids by creation time and counter, the way the client names an offer
+		phmap::flat_hash_map<uint64_t, uint32_t> offerCounters;
+		uint32_t nextOfferId = 1;
+
+		std::deque<uint32_t> expiringOffers;
+		struct {
+			uint32_t offers = 0;
+			uint32_t playerReturns = 0;
+			uint32_t batches = 0;
+			int64_t busyMs = 0;
+			int64_t start = 0;
+		} expiryRun;
+
+		// daily totals by (item id, tier, action), oldest day first
+		phmap::flat_hash_map<uint32_t, std::vector<DailyStatistics>> statistics;
+		uint32_t statisticsDays = 0;
 };
 
 #endif  // SRC_IO_IOMARKET_H_
@@ -0,0 +1,124 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "io/compressed_blob.hpp"
+#include "io/ioplayerstate.hpp"
+
+bool IOPlayerState::enabled = false;
+
+const char* IOPlayerState::getTableName(PlayerStateComponent_t component)
+{
+	switch (component) {
+		case PLAYER_STATE_ITEMS:
+			return "player_items";
+		case PLAYER_STATE_DEPOT:
+			return "player_depotitems";
+		case PLAYER_STATE_INBOX:
+			return "player_inboxitems";
+		case PLAYER_STATE_REWARDS:
+			return "player_rewards";
+		case PLAYER_STATE_STASH:
+			return "player_stash";
+		case PLAYER_STATE_STORAGE:
+			return "player_storage";
+	}
+	return "";
+}
+
+void IOPlayerState::writeItem(PropWriteStream& stream, int32_t& lastSid, const PlayerItemRow& row)
+{
+	stream.write<int32_t>(row.sid - lastSid);
+	stream.write<int32_t>(row.pid);
+	stream.write<uint16_t>(row.itemType);
+	stream.write<uint16_t>(row.count);
+	stream.write<uint32_t>(static_cast<uint32_t>(row.attributesSize));
+	stream.writeBytes(row.attributes, row.attributesSize);
+	lastSid = row.sid;
+}
+
+bool IOPlayerState::readItem(PropStream& stream, int32_t& lastSid, PlayerItemRow& row)
+{
+	int32_t sidDelta;
+	uint32_t attributesSize;
+	if (!stream.read<int32_t>(sidDelta) || !stream.read<int32_t>(row.pid) || !stream.read<uint16_t>(row.itemType)
+			|| !stream.read<uint16_t>(row.count) || !stream.read<uint32_t>(attributesSize) || stream.size() < attributesSize) {
+		return false;
+	}
+
+	row.sid = lastSid + sidDelta;
+	row.attributes = stream.data();
+	row.attributesSize = attributesSize;
+	stream.skip(attributesSize);
+	lastSid = row.sid;
+	return true;
+}
+
+void IOPlayerState::writeStash(PropWriteStream& stream, uint16_t itemId, uint32_t count)
+{
+	stream.write<uint16_t>(itemId);
+	stream.write<uint32_t>(count);
+}
+
+bool IOPlayerState::readStash(PropStream& stream, uint16_t& itemId, uint32_t& count)
+{
+	return stream.read<uint16_t>(itemId) && stream.read<uint32_t>(count);
+}
+
+void IOPlayerState::writeStorage(PropWriteStream& stream, uint32_t key, int32_t value)
+{
+	stream.write<uint32_t>(key);
+	stream.write<int32_t>(value);
+}
+
+bool IOPlayerState::readStorage(PropStream& stream, uint32_t& key, int32_t& value)
+{
+	return stream.read<uint32_t>(key) && stream.read<int32_t>(value);
+}
+
+bool IOPlayerState::addSaveStatement(uint32_t guid, PlayerStateComponent_t component, const PropWriteStream& stream, std::vector<DBStatement>& queries)
+{
+	size_t size;
+	const char* data = stream.getStream(size);
+
+	std::string blob;
+	if (!CompressedBlob::compress(VERSION, data, size, blob)) {
+		return false;
+	}
+
+	DBStatement& statement = queries.emplace_back("INSERT INTO `player_state` (`player_id`, `component`, `data`) VALUES (?, ?, ?) ON DUPLICATE KEY UPDATE `data` = VALUES(`data`)");
+	statement.bind(guid).bind(static_cast<uint16_t>(component)).bindBlob(blob.data(), blob.size());
+	return true;
+}
+
+bool IOPlayerState::uncompress(const char* data, size_t size, std::vector<char>& raw)
+{
+	uint8_t version;
+	if (!CompressedBlob::uncompress(data, size, version, raw)) {
+		return false;
+	}
+
+	if (version != VERSION) {
+		SPDLOG_WARN("[IOPlayerState::uncompress] - Unknown player state version {}", version);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,89 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_IO_IOPLAYERSTATE_HPP_
+#define SRC_IO_IOPLAYERSTATE_HPP_
+
+#include "database/database.h"
+#include "io/fileloader.h"
+
+enum PlayerStateComponent_t : uint8_t {
+	PLAYER_STATE_ITEMS = 0,
+	PLAYER_STATE_DEPOT,
+	PLAYER_STATE_INBOX,
+	PLAYER_STATE_REWARDS,
+	PLAYER_STATE_STASH,
+	PLAYER_STATE_STORAGE,
+
+	PLAYER_STATE_LAST = PLAYER_STATE_STORAGE
+};
+
+// one row of the player item tables
+struct PlayerItemRow {
+	int32_t pid = 0;
+	int32_t sid = 0;
+	uint16_t itemType = 0;
+	uint16_t count = 0;
+	const char* attributes = nullptr;
+	size_t attributesSize = 0;
+};
+
+/**
+ * The binary player state: each component of a player is one `player_state`
+ * row holding the same values as its rows in the other tables, in a compressed
+ * blob. A save then replaces a few rows instead of deleting and inserting one
+ * per item or storage value.
+ */
+class IOPlayerState
+{
+	public:
+		static constexpr uint8_t VERSION = 1;
+
+		// set on startup, once the database holds the players in the configured mode
+		static void setEnabled(bool value) {
+			enabled = value;
+		}
+		static bool isEnabled() {
+			return enabled;
+		}
+
+		// table the component is kept in when the binary state is off
+		static const char* getTableName(PlayerStateComponent_t component);
+		static bool isItemComponent(PlayerStateComponent_t component) {
+			return component <= PLAYER_STATE_REWARDS;
+		}
+
+		// sid is written as a delta from lastSid, the rows of a component are mostly numbered one after the other
+		static void writeItem(PropWriteStream& stream, int32_t& lastSid, const PlayerItemRow& row);
+		static bool readItem(PropStream& stream, int32_t& lastSid, PlayerItemRow& row);
+		static void writeStash(PropWriteStream& stream, uint16_t itemId, uint32_t count);
+		static bool readStash(PropStream& stream, uint16_t& itemId, uint32_t& count);
+		static void writeStorage(PropWriteStream& stream, uint32_t key, int32_t value);
+		static bool readStorage(PropStream& stream, uint32_t& key, int32_t& value);
+
+		// adds the upsert writing stream as the component of the player to queries
+		static bool addSaveStatement(uint32_t guid, PlayerStateComponent_t component, const PropWriteStream& stream, std::vector<DBStatement>& queries);
+		static bool uncompress(const char* data, size_t size, std::vector<char>& raw);
+
+	private:
+		static bool enabled;
+};
+
+#endif  // SRC_IO_IOPLAYERSTATE_HPP_
@@ -26,6 +26,53 @@
 #include "game/game.h"
 #include "io/ioprey.h"
 
+namespace {
+
+// Monsters taken from each star pool of a grid, one row per level band
+constexpr std::array<std::array<uint8_t, IOPrey::MONSTER_POOL_COUNT>, 4> monsterGridStages = {{
+	{ 3, 3, 2, 1 }, // From level 0 to 99
+	{ 1, 3, 3, 2 }, // From level 100 to 299
+	{ 1, 2, 3, 3 }, // From level 300 to 499
+	{ 1, 1, 3, 4 } // From level 500 to ...
+}};
+
+size_t getMonsterGridBand(uint32_t level)
+{
+	uint32_t levelStage = level / 100;
+	if (levelStage == 0) {
+		return 0;
+	} else if (levelStage <= 2) {
+		return 1;
+	} else if (levelStage <= 4) {
+		return 2;
+	}
+	return 3;
+}
+
+/**
+ * Partial Fisher-Yates over pool[begin, end): moves up to wanted monsters that
+ * are not in blackList to raceIdList, without repetitions.
+ * \returns the first position that was not drawn
+ */
+size_t drawMonsters(std::vector<uint16_t>& pool, size_t begin, size_t end, size_t wanted, const std::vector<uint16_t>& blackList, std::vector<uint16_t>& raceIdList)
+{
+	RandomGenerator& generator = getRandomGenerator();
+	size_t index = begin;
+	while (wanted != 0 && index < end) {
+		std::swap(pool[index], pool[std::uniform_int_distribution<size_t>(index, end - 1)(generator)]);
+		uint16_t raceId = pool[index++];
+		if (std::find(blackList.begin(), blackList.end(), raceId) != blackList.end()) {
+			continue;
+		}
+
+		raceIdList.push_back(raceId);
+		--wanted;
+	}
+	return index;
+}
+
+}  // namespace
+
 // Prey class
 PreySlot::PreySlot(PreySlot_t id) :
 									id(id) {
@@ -65,7 +112,7 @@ void PreySlot::reloadBonusValue()
 	}
 }
 
-void PreySlot::reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_t level)
+void PreySlot::reloadMonsterGrid(const std::vector<uint16_t>& blackList, uint32_t level)
 {
 	raceIdList.clear();
 
@@ -76,69 +123,11 @@ void PreySlot::reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_t level
 	// Disabling prey system if the server have less then 36 registered monsters on bestiary because:
 	// - Impossible to generate random lists without duplications on slots.
 	// - Stress the server with unnecessary loops.
-	std::map<uint16_t, std::string> bestiary = g_game().getBestiaryList();
-	if (bestiary.size() < 36) {
+	if (g_game().getBestiaryList().size() < 36) {
 		return;
 	}
 
-	uint8_t stageOne;
-	uint8_t stageTwo;
-	uint8_t stageThree;
-	uint8_t stageFour;
-	if (auto levelStage = static_cast<uint32_t>(std::floor(level / 100));
-		levelStage == 0) { // From level 0 to 99
-		stageOne = 3;
-		stageTwo = 3;
-		stageThree = 2;
-		stageFour = 1;
-	} else if (levelStage <= 2) { // From level 100 to 299
-		stageOne = 1;
-		stageTwo = 3;
-		stageThree = 3;
-		stageFour = 2;
-	} else if (levelStage <= 4) { // From level 300 to 499
-		stageOne = 1;
-		stageTwo = 2;
-		stageThree = 3;
-		stageFour = 3;
-	} else { // From level 500 to ...
-		stageOne = 1;
-		stageTwo = 1;
-		stageThree = 3;
-		stageFour = 4;
-	}
-
-	uint8_t tries = 0;
-	auto maxIndex = static_cast<int32_t>(bestiary.size() - 1);
-	while (raceIdList.size() < 9) {
-		uint16_t raceId = (*(std::next(bestiary.begin(), uniform_random(0, maxIndex)))).first;
-		tries++;
-
-		if (std::count(blackList.begin(), blackList.end(), raceId) != 0) {
-			continue;
-		}
-
-		blackList.push_back(raceId);
-		const MonsterType* mtype = g_monsters().getMonsterTypeByRaceId(raceId);
-		if (!mtype || mtype->info.experience == 0) {
-			continue;
-		} else if (stageOne != 0 && mtype->info.bestiaryStars <= 1) {
-			raceIdList.push_back(raceId);
-			--stageOne;
-		} else if (stageTwo != 0 && mtype->info.bestiaryStars == 2) {
-			raceIdList.push_back(raceId);
-			--stageTwo;
-		} else if (stageThree != 0 && mtype->info.bestiaryStars == 3) {
-			raceIdList.push_back(raceId);
-			--stageThree;
-		} else if (stageFour != 0 && mtype->info.bestiaryStars >= 4) {
-			raceIdList.push_back(raceId);
-			--stageFour;
-		} else if (tries >= 10) {
-			raceIdList.push_back(raceId);
-			tries = 0;
-		}
-	}
+	g_ioprey().generateMonsterGrid(raceIdList, blackList, level);
 }
 
 // Task hunting class
@@ -147,7 +136,7 @@ TaskHuntingSlot::TaskHuntingSlot(PreySlot_t id) :
 	freeRerollTimeStamp = OTSYS_TIME() + g_configManager().getNumber(TASK_HUNTING_FREE_REROLL_TIME) * 1000;
 }
 
-void TaskHuntingSlot::reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_t level)
+void TaskHuntingSlot::reloadMonsterGrid(const std::vector<uint16_t>& blackList, uint32_t level)
 {
 	raceIdList.clear();
 
@@ -158,69 +147,11 @@ void TaskHuntingSlot::reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_
 	// Disabling task hunting system if the server have less then 36 registered monsters on bestiary because:
 	// - Impossible to generate random lists without duplications on slots.
 	// - Stress the server with unnecessary loops.
-	std::map<uint16_t, std::string> bestiary = g_game().getBestiaryList();
-	if (bestiary.size() < 36) {
+	if (g_game().getBestiaryList().size() < 36) {
 		return;
 	}
 
-	uint8_t stageOne;
-	uint8_t stageTwo;
-	uint8_t stageThree;
-	uint8_t stageFour;
-	if (auto levelStage = static_cast<uint32_t>(std::floor(level / 100));
-		levelStage == 0) { // From level 0 to 99
-		stageOne = 3;
-		stageTwo = 3;
-		stageThree = 2;
-		stageFour = 1;
-	} else if (levelStage <= 2) { // From level 100 to 299
-		stageOne = 1;
-		stageTwo = 3;
-		stageThree = 3;
-		stageFour = 2;
-	} else if (levelStage <= 4) { // From level 300 to 499
-		stageOne = 1;
-		stageTwo = 2;
-		stageThree = 3;
-		stageFour = 3;
-	} else { // From level 500 to ...
-		stageOne = 1;
-		stageTwo = 1;
-		stageThree = 3;
-		stageFour = 4;
-	}
-
-	uint8_t tries = 0;
-	auto maxIndex = static_cast<int32_t>(bestiary.size() - 1);
-	while (raceIdList.size() < 9) {
-		uint16_t raceId = (*(std::next(bestiary.begin(), uniform_random(0, maxIndex)))).first;
-		tries++;
-
-		if (std::count(blackList.begin(), blackList.end(), raceId) != 0) {
-			continue;
-		}
-
-		blackList.push_back(raceId);
-		const MonsterType* mtype = g_monsters().getMonsterTypeByRaceId(raceId);
-		if (!mtype || mtype->info.experience == 0) {
-			continue;
-		} else if (stageOne != 0 && mtype->info.bestiaryStars <= 1) {
-			raceIdList.push_back(raceId);
-			--stageOne;
-		} else if (stageTwo != 0 && mtype->info.bestiaryStars == 2) {
-			raceIdList.push_back(raceId);
-			--stageTwo;
-		} else if (stageThree != 0 && mtype->info.bestiaryStars == 3) {
-			raceIdList.push_back(raceId);
-			--stageThree;
-		} else if (stageFour != 0 && mtype->info.bestiaryStars >= 4) {
-			raceIdList.push_back(raceId);
-			--stageFour;
-		} else if (tries >= 10) {
-			raceIdList.push_back(raceId);
-			tries = 0;
-		}
-	}
+	g_ioprey().generateMonsterGrid(raceIdList, blackList, level);
 }
 
 void TaskHuntingSlot::reloadReward()
@@ -643,3 +574,51 @@ TaskHuntingOption* IOPrey::GetTaskRewardOption(const TaskHuntingSlot* slot) cons
 
 	return nullptr;
 }
+
+void IOPrey::InitializeMonsterPools()
+{
+	std::array<std::vector<uint16_t>, MONSTER_POOL_COUNT> pools;
+	const std::map<uint16_t, std::string>& bestiary = g_game().getBestiaryList();
+	for (const auto& [raceId, name] : bestiary) {
+		const MonsterType* mtype = g_monsters().getMonsterTypeByRaceId(raceId);
+		if (!mtype || mtype->info.experience == 0) {
+			continue;
+		}
+
+		// 1 or less, 2, 3 and 4 or more stars
+		pools[std::clamp<uint32_t>(mtype->info.bestiaryStars, 1, MONSTER_POOL_COUNT) - 1].push_back(raceId);
+	}
+
+	monsterPool.clear();
+	for (size_t pool = 0; pool < MONSTER_POOL_COUNT; ++pool) {
+		monsterPoolOffsets[pool] = monsterPool.size();
+		monsterPool.insert(monsterPool.end(), pools[pool].begin(), pools[pool].end());
+	}
+	monsterPoolOffsets[MONSTER_POOL_COUNT] = monsterPool.size();
+	monsterPoolBestiarySize = bestiary.size();
+}
+
+void IOPrey::generateMonsterGrid(std::vector<uint16_t>& raceIdList, const std::vector<uint16_t>& blackList, uint32_t level)
+{
+	raceIdList.clear();
+	if (monsterPoolBestiarySize != g_game().getBestiaryList().size()) {
+		InitializeMonsterPools();
+	}
+
+	const auto& stages = monsterGridStages[getMonsterGridBand(level)];
+	std::array<size_t, MONSTER_POOL_COUNT> drawnEnd;
+	for (size_t pool = 0; pool < MONSTER_POOL_COUNT; ++pool) {
+		drawnEnd[pool] = drawMonsters(monsterPool, monsterPoolOffsets[pool], monsterPoolOffsets[pool + 1], stages[pool], blackList, raceIdList);
+	}
+
+	if (raceIdList.size() >= MONSTER_GRID_SIZE) {
+		return;
+	}
+
+	// Some pool ran out, complete the grid with whatever is left on the others
+	std::vector<uint16_t> spare;
+	for (size_t pool = 0; pool < MONSTER_POOL_COUNT; ++pool) {
+		spare.insert(spare.end(), monsterPool.begin() + drawnEnd[pool], monsterPool.begin() + monsterPoolOffsets[pool + 1]);
+	}
+	drawMonsters(spare, 0, spare.size(), MONSTER_GRID_SIZE - raceIdList.size(), blackList, raceIdList);
+}
@@ -130,7 +130,7 @@ class PreySlot
 
 	void reloadBonusType();
 	void reloadBonusValue();
-	void reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_t level);
+	void reloadMonsterGrid(const std::vector<uint16_t>& blackList, uint32_t level);
 
 	PreySlot_t id = PreySlot_First;
 	PreyBonus_t bonus = PreyBonus_None;
@@ -184,7 +184,7 @@ class TaskHuntingSlot
 	}
 
 	void reloadReward();
-	void reloadMonsterGrid(std::vector<uint16_t> blackList, uint32_t level);
+	void reloadMonsterGrid(const std::vector<uint16_t>& blackList, uint32_t level);
 
 	PreySlot_t id = PreySlot_First;
 	PreyTaskDataState_t state = PreyTaskDataState_Inactive;
@@ -240,6 +240,15 @@ public:
 	void ParseTaskHuntingAction(Player* player, PreySlot_t slotId, PreyTaskAction_t action, bool upgrade, uint16_t raceId) const;
 
 	void InitializeTaskHuntOptions();
+
+	/**
+	 * Buckets the bestiary monsters that give experience by stars, the grids of
+	 * both prey and task hunting are drawn from these pools.
+	 * Must run again whenever the monsters are reloaded.
+	 */
+	void InitializeMonsterPools();
+	// Fills raceIdList with a grid of monsters not in blackList, balanced by stars for the level band
+	void generateMonsterGrid(std::vector<uint16_t>& raceIdList, const std::vector<uint16_t>& blackList, uint32_t level);
 	TaskHuntingOption* GetTaskRewardOption(const TaskHuntingSlot* slot) const;
 
 	std::vector<TaskHuntingOption*> GetTaskOptions() const {
@@ -252,6 +261,16 @@ public:
 
 	NetworkMessage baseDataMessage;
 	std::vector<TaskHuntingOption*> taskOption;
+
+	static constexpr size_t MONSTER_POOL_COUNT = 4;
+	static constexpr size_t MONSTER_GRID_SIZE = 9;
+
+private:
+	// Pools laid out back to back, pool N is [monsterPoolOffsets[N], monsterPoolOffsets[N + 1])
+	// Their order inside a pool is irrelevant, draws shuffle them in place.
+	std::vector<uint16_t> monsterPool;
+	std::array<size_t, MONSTER_POOL_COUNT + 1> monsterPoolOffsets {};
+	size_t monsterPoolBestiarySize = 0;
 };
 
 constexpr auto g_ioprey = &IOPrey::getInstance;
@@ -0,0 +1,103 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "io/player_name_cache.hpp"
+#include "utils/tools.h"
+
+std::string PlayerNameCache::getNameKey(const std::string& name)
+{
+	std::string key = name;
+	toLowerCaseString(key);
+	return key;
+}
+
+bool PlayerNameCache::getByName(const std::string& name, PlayerNameEntry& entry)
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	auto it = names.find(getNameKey(name));
+	if (it == names.end()) {
+		misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return get(it->second, entry);
+}
+
+bool PlayerNameCache::getByGuid(uint32_t guid, PlayerNameEntry& entry)
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	auto it = guids.find(guid);
+	if (it == guids.end()) {
+		misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return get(it->second, entry);
+}
+
+bool PlayerNameCache::get(EntryList::iterator it, PlayerNameEntry& entry)
+{
+	hits.fetch_add(1, std::memory_order_relaxed);
+	entries.splice(entries.begin(), entries, it);
+	entry = *it;
+	return true;
+}
+
+void PlayerNameCache::add(uint32_t guid, const std::string& name, uint16_t groupId)
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	// the guid may be cached under an older name, or the name under an older guid
+	if (auto it = guids.find(guid); it != guids.end()) {
+		erase(it->second);
+	}
+	std::string key = getNameKey(name);
+	if (auto it = names.find(key); it != names.end()) {
+		erase(it->second);
+	}
+
+	entries.push_front({guid, name, groupId});
+	guids[guid] = entries.begin();
+	names[std::move(key)] = entries.begin();
+
+	if (entries.size() > PLAYER_NAME_CACHE_SIZE) {
+		erase(std::prev(entries.end()));
+	}
+}
+
+void PlayerNameCache::remove(uint32_t guid)
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	if (auto it = guids.find(guid); it != guids.end()) {
+		erase(it->second);
+	}
+}
+
+size_t PlayerNameCache::size()
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	return entries.size();
+}
+
+void PlayerNameCache::erase(EntryList::iterator it)
+{
+	guids.erase(it->guid);
+	names.erase(getNameKey(it->name));
+	entries.erase(it);
+}
@@ -0,0 +1,97 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_IO_PLAYER_NAME_CACHE_HPP_
+#define SRC_IO_PLAYER_NAME_CACHE_HPP_
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+
+#include <parallel_hashmap/phmap.h>
+
+// the least recently used entries are dropped beyond this many characters
+static constexpr size_t PLAYER_NAME_CACHE_SIZE = 8192;
+
+struct PlayerNameEntry {
+	uint32_t guid;
+	std::string name;
+	uint16_t groupId;
+};
+
+/**
+ * Name and guid of characters looked up by IOLoginData, so house lists,
+ * vip lists, beds and mail resolve offline characters without a query.
+ * Names are matched case insensitive, as the players table does.
+ * Only characters that exist are cached; a player log in refreshes its
+ * entry and a rename done by the server drops it.
+ */
+class PlayerNameCache
+{
+	public:
+		PlayerNameCache() = default;
+
+		// non-copyable
+		PlayerNameCache(const PlayerNameCache&) = delete;
+		PlayerNameCache& operator=(const PlayerNameCache&) = delete;
+
+		static PlayerNameCache& getInstance() {
+			// Guaranteed to be destroyed
+			static PlayerNameCache instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		bool getByName(const std::string& name, PlayerNameEntry& entry);
+		bool getByGuid(uint32_t guid, PlayerNameEntry& entry);
+
+		void add(uint32_t guid, const std::string& name, uint16_t groupId);
+		void remove(uint32_t guid);
+
+		uint64_t getHits() const {
+			return hits.load(std::memory_order_relaxed);
+		}
+		uint64_t getMisses() const {
+			return misses.load(std::memory_order_relaxed);
+		}
+		size_t size();
+
+	private:
+		using EntryList = std::list<PlayerNameEntry>;
+
+		bool get(EntryList::iterator it, PlayerNameEntry& entry);
+		void erase(EntryList::iterator it);
+
+		static std::string getNameKey(const std::string& name);
+
+		std::mutex cacheLock;
+		// most recently used first
+		EntryList entries;
+		phmap::flat_hash_map<uint32_t, EntryList::iterator> guids;
+		phmap::flat_hash_map<std::string, EntryList::iterator> names;
+
+		std::atomic<uint64_t> hits {0};
+		std::atomic<uint64_t> misses {0};
+};
+
+constexpr auto g_playerNameCache = &PlayerNameCache::getInstance;
+
+#endif  // SRC_IO_PLAYER_NAME_CACHE_HPP_
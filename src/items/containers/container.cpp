@@ -46,6 +46,7 @@ Container::Container(Tile* tile) : Container(ITEM_BROWSEFIELD, 30, false, true)
 			if (((item->getContainer() || item->hasProperty(CONST_PROP_MOVEABLE)) || (item->isWrapable() && !item->hasProperty(CONST_PROP_MOVEABLE) && !item->hasProperty(CONST_PROP_BLOCKPATH))) && !item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
 				itemlist.push_front(item);
 				item->setParent(this);
+				updateHoldingCounts(item, 1);
 			}
 		}
 	}
@@ -55,6 +56,8 @@ Container::Container(Tile* tile) : Container(ITEM_BROWSEFIELD, 30, false, true)
 
 Container::~Container()
 {
+	g_game().removeContainerViewers(this);
+
 	if (getID() == ITEM_BROWSEFIELD) {
 		g_game().browseFields.erase(getTile());
 
@@ -117,6 +120,8 @@ void Container::addItem(Item* item)
 {
 	itemlist.push_back(item);
 	item->setParent(this);
+	updateHoldingCounts(item, 1);
+	++contentRevision;
 }
 
 StashContainerList Container::getStowableItems() const
@@ -197,13 +202,33 @@ bool Container::countsToLootAnalyzerBalance()
 
 void Container::updateItemWeight(int32_t diff)
 {
+	// every change of the contents passes here, even when the weight stays the same
 	totalWeight += diff;
+	++contentRevision;
 	Container* parentContainer = this;	// credits: SaiyansKing
 	while ((parentContainer = parentContainer->getParentContainer()) != nullptr) {
 		parentContainer->totalWeight += diff;
+		++parentContainer->contentRevision;
 	}
 }
 
+void Container::updateHoldingCounts(const Item* item, int32_t sign)
+{
+	uint32_t itemDiff = 1;
+	uint32_t containerDiff = 0;
+	if (const Container* container = item->getContainer()) {
+		itemDiff += container->holdingItemCount;
+		containerDiff = container->holdingContainerCount + 1;
+	}
+
+	// same chain as updateItemWeight
+	Container* parentContainer = this;
+	do {
+		parentContainer->holdingItemCount += sign * itemDiff;
+		parentContainer->holdingContainerCount += sign * containerDiff;
+	} while ((parentContainer = parentContainer->getParentContainer()) != nullptr);
+}
+
 uint32_t Container::getWeight() const
 {
 	return Item::getWeight() + totalWeight;
@@ -249,82 +274,90 @@ Item* Container::getItemByIndex(size_t index) const
 	return itemlist[index];
 }
 
-uint32_t Container::getItemHoldingCount() const
+bool Container::isHoldingItem(const Item* item) const
 {
-	uint32_t counter = 0;
-	for (ContainerIterator it = iterator(); it.hasNext(); it.advance()) {
-		++counter;
+	// an item is held by the containers it can reach through its parents
+	for (const Cylinder* cylinder = item->getParent(); cylinder; cylinder = cylinder->getParent()) {
+		if (cylinder == this) {
+			return true;
+		}
 	}
-	return counter;
+	return false;
 }
 
-uint32_t Container::getContainerHoldingCount() const
+template <typename Function>
+void Container::forEachEventPlayer(Function&& function)
 {
-	uint32_t counter = 0;
-	for (ContainerIterator it = iterator(); it.hasNext(); it.advance()) {
-		if ((*it)->getContainer()) {
-			++counter;
+	// the trade checks need the players around, otherwise only the holder and the viewers care
+	if (g_game().hasTradeItems()) {
+		SpectatorHashSet spectators;
+		g_game().map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
+		for (Creature* spectator : spectators) {
+			function(spectator->getPlayer());
 		}
+		return;
 	}
-	return counter;
-}
 
-bool Container::isHoldingItem(const Item* item) const
-{
-	for (ContainerIterator it = iterator(); it.hasNext(); it.advance()) {
-		if (*it == item) {
-			return true;
+	std::vector<Player*> players;
+	if (Player* holder = getHoldingPlayer()) {
+		players.push_back(holder);
+	}
+	if (const auto* viewers = g_game().getContainerViewers(this)) {
+		for (const auto& [player, cid] : *viewers) {
+			if (std::find(players.begin(), players.end(), player) == players.end()) {
+				players.push_back(player);
+			}
 		}
 	}
-	return false;
+
+	for (Player* player : players) {
+		function(player);
+	}
 }
 
 void Container::onAddContainerItem(Item* item)
 {
-	SpectatorHashSet spectators;
-	g_game().map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
-
 	//send to client
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->sendAddContainerItem(this, item);
+	if (const auto* viewers = g_game().getContainerViewers(this)) {
+		for (const auto& [player, cid] : *viewers) {
+			player->sendAddContainerItem(cid, this, item);
+		}
 	}
 
 	//event methods
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->onAddContainerItem(item);
-	}
+	forEachEventPlayer([item](Player* player) {
+		player->onAddContainerItem(item);
+	});
 }
 
 void Container::onUpdateContainerItem(uint32_t index, Item* oldItem, Item* newItem)
 {
-	SpectatorHashSet spectators;
-	g_game().map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
-
 	//send to client
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->sendUpdateContainerItem(this, index, newItem);
+	if (const auto* viewers = g_game().getContainerViewers(this)) {
+		for (const auto& [player, cid] : *viewers) {
+			player->sendUpdateContainerItem(cid, this, index, newItem);
+		}
 	}
 
 	//event methods
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->onUpdateContainerItem(this, oldItem, newItem);
-	}
+	forEachEventPlayer([this, oldItem, newItem](Player* player) {
+		player->onUpdateContainerItem(this, oldItem, newItem);
+	});
 }
 
 void Container::onRemoveContainerItem(uint32_t index, Item* item)
 {
-	SpectatorHashSet spectators;
-	g_game().map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
-
 	//send change to client
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->sendRemoveContainerItem(this, index);
+	if (const auto* viewers = g_game().getContainerViewers(this)) {
+		for (const auto& [player, cid] : *viewers) {
+			player->sendRemoveContainerItem(cid, this, index);
+		}
 	}
 
 	//event methods
-	for (Creature* spectator : spectators) {
-		spectator->getPlayer()->onRemoveContainerItem(this, item);
-	}
+	forEachEventPlayer([this, item](Player* player) {
+		player->onRemoveContainerItem(this, item);
+	});
 }
 
 ReturnValue Container::queryAdd(int32_t addIndex, const Thing& addThing, uint32_t addCount,
@@ -584,6 +617,7 @@ void Container::addThing(int32_t index, Thing* thing)
 
 	item->setParent(this);
 	itemlist.push_front(item);
+	updateHoldingCounts(item, 1);
 	updateItemWeight(item->getWeight());
 
 	//send change to client
@@ -640,6 +674,8 @@ void Container::replaceThing(uint32_t index, Thing* thing)
 
 	itemlist[index] = item;
 	item->setParent(this);
+	updateHoldingCounts(replacedItem, -1);
+	updateHoldingCounts(item, 1);
 	updateItemWeight(-static_cast<int32_t>(replacedItem->getWeight()) + item->getWeight());
 
 	//send change to client
@@ -673,6 +709,7 @@ void Container::removeThing(Thing* thing, uint32_t count)
 			onUpdateContainerItem(index, item, item);
 		}
 	} else {
+		updateHoldingCounts(item, -1);
 		updateItemWeight(-static_cast<int32_t>(item->getWeight()));
 
 		//send change to client
@@ -790,6 +827,7 @@ void Container::internalAddThing(uint32_t, Thing* thing)
 
 	item->setParent(this);
 	itemlist.push_front(item);
+	updateHoldingCounts(item, 1);
 	updateItemWeight(item->getWeight());
 }
 
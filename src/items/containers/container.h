@@ -59,6 +59,16 @@ class Container : public Item, public Cylinder
 		Container(const Container&) = delete;
 		Container& operator=(const Container&) = delete;
 
+		// pooled as any item, only counted apart
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_CONTAINER, size);
+			return ObjectPool::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_CONTAINER, size);
+			ObjectPool::deallocate(p, size);
+		}
+
 		Item* clone() const override final;
 
 		Container* getContainer() override final {
@@ -129,14 +139,24 @@ class Container : public Item, public Cylinder
 		Item* getItemByIndex(size_t index) const;
 		bool isHoldingItem(const Item* item) const;
 
-		uint32_t getItemHoldingCount() const;
-		uint32_t getContainerHoldingCount() const;
+		// items and containers anywhere below this one, kept up to date like totalWeight
+		uint32_t getItemHoldingCount() const {
+			return holdingItemCount;
+		}
+		uint32_t getContainerHoldingCount() const {
+			return holdingContainerCount;
+		}
 		uint16_t getFreeSlots() const;
 		uint32_t getWeight() const override final;
 
 		bool isUnlocked() const {
 			return !this->isCorpse() && unlocked;
 		}
+
+		// changes whenever the contents change, nested containers included
+		uint32_t getContentRevision() const {
+			return contentRevision;
+		}
 		bool hasPagination() const {
 			return pagination;
 		}
@@ -181,13 +201,22 @@ class Container : public Item, public Cylinder
 
 		uint32_t maxSize;
 		uint32_t totalWeight = 0;
+		uint32_t holdingItemCount = 0;
+		uint32_t holdingContainerCount = 0;
+		uint32_t contentRevision = 0;
 		ItemDeque itemlist;
 		uint32_t serializationCount = 0;
 
 		bool unlocked;
 		bool pagination;
 
+		// Adds (sign 1) or removes (sign -1) item and everything it holds to the counts of this container and its parents
+		void updateHoldingCounts(const Item* item, int32_t sign);
+
 	private:
+		// the players the add, update and remove events are called on
+		template <typename Function>
+		void forEachEventPlayer(Function&& function);
 		void onAddContainerItem(Item* item);
 		void onUpdateContainerItem(uint32_t index, Item* oldItem, Item* newItem);
 		void onRemoveContainerItem(uint32_t index, Item* item);
@@ -197,6 +226,7 @@ class Container : public Item, public Cylinder
 		void updateItemWeight(int32_t diff);
 
 		friend class ContainerIterator;
+		friend class IOMap;
 		friend class IOMapSerialize;
 };
 
@@ -63,4 +63,5 @@ void DepotLocker::removeInbox(Inbox* inbox)
 		return;
 	}
 	itemlist.erase(cit);
+	updateHoldingCounts(inbox, -1);
 }
@@ -98,7 +98,7 @@ bool Mailbox::sendItem(Item* item) const
 		return false;
 	}
 
-	const Player* player = g_game().getPlayerByName(receiver);
+	Player* player = g_game().getPlayerByName(receiver);
 	std::string writer;
 	time_t date = time(0);
 	std::string text;
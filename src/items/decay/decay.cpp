@@ -50,61 +50,48 @@ void Decay::startDecay(Item* item)
 			stopDecay(item);
 		}
 
-		int64_t timestamp = OTSYS_TIME() + duration;
-		if (decayMap.empty()) {
-			eventId = g_scheduler().addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, duration), std::bind(&Decay::checkDecay, this)));
-		} else {
-			if (timestamp < decayMap.begin()->first) {
-				g_scheduler().stopEvent(eventId);
-				eventId = g_scheduler().addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, duration), std::bind(&Decay::checkDecay, this)));
-			}
+		int64_t now = OTSYS_TIME();
+		if (positions.empty()) {
+			// nothing is pending, skip the idle buckets
+			currentBucket = std::max<int64_t>(currentBucket, now / DECAY_BUCKET_MS);
 		}
 
+		int64_t timestamp = now + duration;
+		int64_t bucket = std::max<int64_t>(currentBucket, (timestamp + DECAY_BUCKET_MS - 1) / DECAY_BUCKET_MS);
+
 		item->incrementReferenceCounter();
 		item->setDecaying(DECAYING_TRUE);
 		item->setDurationTimestamp(timestamp);
-		decayMap[timestamp].push_back(item);
+		pullFarBuckets();
+		addToBucket(item, bucket);
+
+		if (scheduledBucket == 0 || bucket < scheduledBucket) {
+			scheduleCheck(bucket);
+		}
 	}
 }
 
 void Decay::stopDecay(Item* item)
 {
 	if (item->hasAttribute(ITEM_ATTRIBUTE_DECAYSTATE)) {
-		int64_t timestamp = item->getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
 		if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
-			auto it = decayMap.find(timestamp);
-			if (it != decayMap.end()) {
-				std::vector<Item*>& decayItems = it->second;
-
-				size_t i = 0, end = decayItems.size();
-				if (end == 1) {
-					if (item == decayItems[i]) {
-						if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-							//Incase we removed duration attribute don't assign new duration
-							item->setDuration(item->getDuration());
-						}
-						item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-						g_game().ReleaseItem(item);
-
-						decayMap.erase(it);
-					}
-					return;
+			auto it = positions.find(item);
+			if (it != positions.end()) {
+				const DecaySlot& decaySlot = it->second;
+				if (decaySlot.bucket < currentBucket + DECAY_WHEEL_SIZE) {
+					wheel[decaySlot.bucket & DECAY_WHEEL_MASK][decaySlot.slot] = nullptr;
+				} else {
+					farBuckets[decaySlot.bucket][decaySlot.slot] = nullptr;
 				}
-				while (i < end) {
-					if (item == decayItems[i]) {
-						if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-							//Incase we removed duration attribute don't assign new duration
-							item->setDuration(item->getDuration());
-						}
-						item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-						g_game().ReleaseItem(item);
-
-						decayItems[i] = decayItems.back();
-						decayItems.pop_back();
-						return;
-					}
-					++i;
+				positions.erase(it);
+
+				if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
+					//Incase we removed duration attribute don't assign new duration
+					item->setDuration(item->getDuration());
 				}
+				item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
+				g_game().ReleaseItem(item);
+				return;
 			}
 			item->removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
 		} else {
@@ -113,25 +100,82 @@ void Decay::stopDecay(Item* item)
 	}
 }
 
+void Decay::addToBucket(Item* item, int64_t bucket)
+{
+	std::vector<Item*>& items = bucket < currentBucket + DECAY_WHEEL_SIZE ? wheel[bucket & DECAY_WHEEL_MASK] : farBuckets[bucket];
+	positions[item] = {bucket, items.size()};
+	items.push_back(item);
+}
+
+void Decay::pullFarBuckets()
+{
+	while (!farBuckets.empty() && farBuckets.begin()->first < currentBucket + DECAY_WHEEL_SIZE) {
+		auto it = farBuckets.begin();
+		for (Item* item : it->second) {
+			if (item) {
+				addToBucket(item, it->first);
+			}
+		}
+		farBuckets.erase(it);
+	}
+}
+
+int64_t Decay::getNextBucket() const
+{
+	for (int64_t bucket = currentBucket; bucket < currentBucket + DECAY_WHEEL_SIZE; ++bucket) {
+		if (!wheel[bucket & DECAY_WHEEL_MASK].empty()) {
+			return bucket;
+		}
+	}
+	return farBuckets.empty() ? 0 : farBuckets.begin()->first;
+}
+
+void Decay::scheduleCheck(int64_t bucket)
+{
+	if (scheduledBucket != 0) {
+		g_scheduler().stopEvent(eventId);
+	}
+
+	int64_t delay = bucket * DECAY_BUCKET_MS - OTSYS_TIME();
+	scheduledBucket = bucket;
+	eventId = g_scheduler().addEvent(createSchedulerTask(static_cast<uint32_t>(std::max<int64_t>(SCHEDULER_MINTICKS, delay)), std::bind(&Decay::checkDecay, this)));
+}
+
 void Decay::checkDecay()
 {
-	int64_t timestamp = OTSYS_TIME();
+	scheduledBucket = 0;
+	int64_t nowBucket = OTSYS_TIME() / DECAY_BUCKET_MS;
 
 	std::vector<Item*> tempItems;
 	tempItems.reserve(32);// Small preallocation
 
-	auto it = decayMap.begin(), end = decayMap.end();
-	while (it != end) {
-		if (it->first > timestamp) {
-			break;
+	// the buckets are emptied first, decaying items can start and stop other decays
+	while (currentBucket <= nowBucket && !positions.empty()) {
+		pullFarBuckets();
+		std::vector<Item*>& decayItems = wheel[currentBucket & DECAY_WHEEL_MASK];
+		for (Item* item : decayItems) {
+			if (item) {
+				positions.erase(item);
+				tempItems.push_back(item);
+			}
 		}
+		decayItems.clear();
+		++currentBucket;
+	}
+	pullFarBuckets();
 
-		// Iterating here is unsafe so let's copy our items into temporary vector
-		std::vector<Item*>& decayItems = it->second;
-		tempItems.insert(tempItems.end(), decayItems.begin(), decayItems.end());
-		it = decayMap.erase(it);
+	if (positions.empty()) {
+		// stopped items can leave null slots behind
+		for (int64_t bucket = currentBucket; bucket < currentBucket + DECAY_WHEEL_SIZE; ++bucket) {
+			wheel[bucket & DECAY_WHEEL_MASK].clear();
+		}
+		farBuckets.clear();
+		currentBucket = std::max<int64_t>(currentBucket, nowBucket + 1);
 	}
 
+	// a mass decay updates many tiles of the same areas, their spectators are read once per leaf
+	bool spectatorBatch = tempItems.size() >= DECAY_SPECTATOR_BATCH_ITEMS;
+	bool previousBatch = spectatorBatch && g_game().map.setSpectatorBatch(true);
 	for (Item* item : tempItems) {
 		if (!item->canDecay()) {
 			item->setDuration(item->getDuration());
@@ -144,8 +188,12 @@ void Decay::checkDecay()
 		g_game().ReleaseItem(item);
 	}
 
-	if (it != end) {
-		eventId = g_scheduler().addEvent(createSchedulerTask(std::max<int32_t>(SCHEDULER_MINTICKS, static_cast<int32_t>(it->first - timestamp)), std::bind(&Decay::checkDecay, this)));
+	if (spectatorBatch) {
+		g_game().map.setSpectatorBatch(previousBatch);
+	}
+
+	if (scheduledBucket == 0 && !positions.empty()) {
+		scheduleCheck(getNextBucket());
 	}
 }
 
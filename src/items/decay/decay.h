@@ -22,6 +22,21 @@
 
 #include "items/item.h"
 
+// items decay at the end of the 100ms bucket their timestamp falls in
+static constexpr int64_t DECAY_BUCKET_MS = 100;
+// 8192 buckets, about 13 minutes ahead; later items wait in farBuckets
+static constexpr int64_t DECAY_WHEEL_BITS = 13;
+static constexpr int64_t DECAY_WHEEL_SIZE = 1 << DECAY_WHEEL_BITS;
+static constexpr int64_t DECAY_WHEEL_MASK = DECAY_WHEEL_SIZE - 1;
+// below this many items in one check the spectators are looked up per tile
+static constexpr size_t DECAY_SPECTATOR_BATCH_ITEMS = 16;
+
+/**
+ * Decaying items in a wheel of time buckets. Every item is indexed by its
+ * bucket and slot, so start and stop are O(1): a stopped item leaves a
+ * null slot behind, which keeps the insertion order of the rest. Expired
+ * buckets are taken in order in one pass.
+ */
 class Decay
 {
 	public:
@@ -41,11 +56,29 @@ class Decay
 	private:
 		Decay() = default;
 
+		struct DecaySlot {
+			int64_t bucket;
+			size_t slot;
+		};
+
 		void checkDecay();
 		void internalDecayItem(Item* item);
 
+		void addToBucket(Item* item, int64_t bucket);
+		// moves the far buckets that are now inside the wheel
+		void pullFarBuckets();
+		int64_t getNextBucket() const;
+		void scheduleCheck(int64_t bucket);
+
 		uint32_t eventId {0};
-		std::map<int64_t, std::vector<Item*>> decayMap;
+		// bucket the pending check event runs at, 0 for none
+		int64_t scheduledBucket = 0;
+		// first bucket not processed yet
+		int64_t currentBucket = 0;
+
+		std::array<std::vector<Item*>, DECAY_WHEEL_SIZE> wheel;
+		std::map<int64_t, std::vector<Item*>> farBuckets;
+		phmap::flat_hash_map<Item*, DecaySlot> positions;
 };
 
 constexpr auto g_decay = &Decay::getInstance;
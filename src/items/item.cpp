@@ -39,6 +39,15 @@
 
 Items Item::items;
 
+namespace {
+
+// descriptions of items without attributes, dispatcher thread only
+phmap::flat_hash_map<uint64_t, std::string> descriptionCache;
+// the cache is dropped as a whole past this many entries
+constexpr size_t DESCRIPTION_CACHE_MAX_ENTRIES = 1 << 16;
+
+}  // namespace
+
 Item* Item::CreateItem(const uint16_t type, uint16_t count /*= 0*/)
 {
 	Item* newItem = nullptr;
@@ -229,6 +238,7 @@ Item::Item(const uint16_t itemId, uint16_t itemCount /*= 0*/) :
 	}
 
 	setDefaultDuration();
+	getMemoryStats().items.fetch_add(1, std::memory_order_relaxed);
 }
 
 Item::Item(const Item& i) :
@@ -237,6 +247,12 @@ Item::Item(const Item& i) :
 	if (i.attributes) {
 		attributes.reset(new ItemAttributes(*i.attributes));
 	}
+	getMemoryStats().items.fetch_add(1, std::memory_order_relaxed);
+}
+
+Item::~Item()
+{
+	getMemoryStats().items.fetch_sub(1, std::memory_order_relaxed);
 }
 
 Item* Item::clone() const
@@ -271,23 +287,14 @@ bool Item::equals(const Item* otherItem) const
 		return false;
 	}
 
-	for (const auto& attribute : attributes->attributes) {
-		for (const auto& otherAttribute : otherAttributes->attributes) {
-			if (attribute.type != otherAttribute.type) {
-				continue;
-			}
-
-			if (ItemAttributes::isStrAttrType(attribute.type) && *attribute.value.string != *otherAttribute.value.string) {
-				return false;
-			}
-
-			if (ItemAttributes::isIntAttrType(attribute.type) && attribute.value.integer != otherAttribute.value.integer) {
-				return false;
-			}
-		}
+	// same bits, so the slots line up
+	size_t integerCount = ItemAttributes::countAttributes(attributes->attributeBits & ItemAttributes::INT_ATTR_TYPES);
+	if (!std::equal(attributes->integers.get(), attributes->integers.get() + integerCount, otherAttributes->integers.get())) {
+		return false;
 	}
 
-	return true;
+	size_t stringCount = ItemAttributes::countAttributes(attributes->attributeBits & ItemAttributes::STR_ATTR_TYPES);
+	return std::equal(attributes->strings.get(), attributes->strings.get() + stringCount, otherAttributes->strings.get());
 }
 
 void Item::setDefaultSubtype()
@@ -318,6 +325,7 @@ void Item::setID(uint16_t newid)
 {
 	const ItemType& prevIt = Item::items[id];
 	id = newid;
+	resetTileDescriptionCache();
 
 	const ItemType& it = Item::items[newid];
 	uint32_t newDuration = it.decayTime * 1000;
@@ -398,6 +406,24 @@ const Tile* Item::getTile() const
 	return dynamic_cast<const Tile*>(cylinder);
 }
 
+void Item::resetTileDescriptionCache()
+{
+	// only the items lying directly on a tile are part of its description
+	Tile* tile = parent ? parent->getTile() : nullptr;
+	if (tile && tile == parent) {
+		tile->resetDescriptionCache();
+	}
+}
+
+void Item::updateTileMoveEventFlag()
+{
+	// the move events of a tile only look at the items lying directly on it
+	Tile* tile = parent ? parent->getTile() : nullptr;
+	if (tile && tile == parent) {
+		tile->updateMoveEventFlag();
+	}
+}
+
 uint16_t Item::getSubType() const
 {
 	const ItemType& it = items[id];
@@ -961,20 +987,20 @@ void Item::serializeAttr(PropWriteStream& propWriteStream) const
 
 bool Item::hasProperty(ItemProperty prop) const
 {
-	const ItemType& it = items[id];
+	const ItemTypeHotData& it = items.getHotData(id);
 	switch (prop) {
-		case CONST_PROP_BLOCKSOLID: return it.blockSolid;
-		case CONST_PROP_MOVEABLE: return it.moveable && !hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
-		case CONST_PROP_HASHEIGHT: return it.hasHeight;
-		case CONST_PROP_BLOCKPROJECTILE: return it.blockProjectile;
-		case CONST_PROP_BLOCKPATH: return it.blockPathFind;
-		case CONST_PROP_ISVERTICAL: return it.isVertical;
-		case CONST_PROP_ISHORIZONTAL: return it.isHorizontal;
-		case CONST_PROP_IMMOVABLEBLOCKSOLID: return it.blockSolid && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_IMMOVABLEBLOCKPATH: return it.blockPathFind && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_IMMOVABLENOFIELDBLOCKPATH: return !it.isMagicField() && it.blockPathFind && (!it.moveable || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
-		case CONST_PROP_NOFIELDBLOCKPATH: return !it.isMagicField() && it.blockPathFind;
-		case CONST_PROP_SUPPORTHANGABLE: return it.isHorizontal || it.isVertical;
+		case CONST_PROP_BLOCKSOLID: return it.hasFlag(ITEM_FLAG_BLOCKSOLID);
+		case CONST_PROP_MOVEABLE: return it.hasFlag(ITEM_FLAG_MOVEABLE) && !hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+		case CONST_PROP_HASHEIGHT: return it.hasFlag(ITEM_FLAG_HASHEIGHT);
+		case CONST_PROP_BLOCKPROJECTILE: return it.hasFlag(ITEM_FLAG_BLOCKPROJECTILE);
+		case CONST_PROP_BLOCKPATH: return it.hasFlag(ITEM_FLAG_BLOCKPATH);
+		case CONST_PROP_ISVERTICAL: return it.hasFlag(ITEM_FLAG_VERTICAL);
+		case CONST_PROP_ISHORIZONTAL: return it.hasFlag(ITEM_FLAG_HORIZONTAL);
+		case CONST_PROP_IMMOVABLEBLOCKSOLID: return it.hasFlag(ITEM_FLAG_BLOCKSOLID) && (!it.hasFlag(ITEM_FLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_IMMOVABLEBLOCKPATH: return it.hasFlag(ITEM_FLAG_BLOCKPATH) && (!it.hasFlag(ITEM_FLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_IMMOVABLENOFIELDBLOCKPATH: return !it.hasFlag(ITEM_FLAG_MAGICFIELD) && it.hasFlag(ITEM_FLAG_BLOCKPATH) && (!it.hasFlag(ITEM_FLAG_MOVEABLE) || hasAttribute(ITEM_ATTRIBUTE_UNIQUEID));
+		case CONST_PROP_NOFIELDBLOCKPATH: return !it.hasFlag(ITEM_FLAG_MAGICFIELD) && it.hasFlag(ITEM_FLAG_BLOCKPATH);
+		case CONST_PROP_SUPPORTHANGABLE: return it.hasFlag(ITEM_FLAG_HORIZONTAL | ITEM_FLAG_VERTICAL);
 		default: return false;
 	}
 }
@@ -1715,6 +1741,41 @@ std::string Item::parseShowAttributesDescription(const Item *item, const uint16_
 std::string Item::getDescription(const ItemType& it, int32_t lookDistance,
                                  const Item* item /*= nullptr*/,
                                  int32_t subType /*= -1*/, bool addArticle /*= true*/)
+{
+	// without attributes the text only depends on the type, the count and how close
+	// the item is; containers show their weight with the contents
+	if (item && (item->attributes || item->getContainer() || item->getID() != it.id)) {
+		return buildDescription(it, lookDistance, item, subType, addArticle);
+	}
+
+	if (item) {
+		subType = item->getSubType();
+	}
+
+	// the description only compares lookDistance with 1 and 4
+	uint64_t distanceBucket = lookDistance <= 1 ? 0 : (lookDistance <= 4 ? 1 : 2);
+	uint64_t key = (static_cast<uint64_t>(it.id) << 40) | (static_cast<uint64_t>(static_cast<uint32_t>(subType)) << 8) | (distanceBucket << 1) | (item ? 1 : 0);
+	if (!addArticle) {
+		key |= 1ull << 56;
+	}
+
+	auto cached = descriptionCache.find(key);
+	if (cached != descriptionCache.end()) {
+		return cached->second;
+	}
+
+	if (descriptionCache.size() >= DESCRIPTION_CACHE_MAX_ENTRIES) {
+		descriptionCache.clear();
+	}
+	return descriptionCache.emplace(key, buildDescription(it, lookDistance, item, subType, addArticle)).first->second;
+}
+
+void Item::clearDescriptionCache()
+{
+	descriptionCache.clear();
+}
+
+std::string Item::buildDescription(const ItemType& it, int32_t lookDistance, const Item* item, int32_t subType, bool addArticle)
 {
 	const std::string* text = nullptr;
 
@@ -2463,6 +2524,7 @@ void Item::setUniqueId(uint16_t n)
 
 	if (g_game().addUniqueItem(n, this)) {
 		getAttributes()->setUniqueId(n);
+		updateTileMoveEventFlag();
 	}
 }
 
@@ -2507,22 +2569,57 @@ LightInfo Item::getLightInfo() const
 	return {it.lightLevel, it.lightColor};
 }
 
+ItemMemoryStats ItemAttributes::memoryStats;
+
 std::string ItemAttributes::emptyString;
 int64_t ItemAttributes::emptyInt;
 double ItemAttributes::emptyDouble;
 bool ItemAttributes::emptyBool;
 
-const std::string& ItemAttributes::getStrAttr(ItemAttrTypes type) const
+ItemAttributes::ItemAttributes()
 {
-	if (!isStrAttrType(type)) {
-		return emptyString;
+	memoryStats.attributeBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+ItemAttributes::ItemAttributes(const ItemAttributes& other) :
+	attributeBits(other.attributeBits)
+{
+	size_t integerCount = countAttributes(attributeBits & INT_ATTR_TYPES);
+	if (integerCount != 0) {
+		integers.reset(new int64_t[integerCount]);
+		std::copy_n(other.integers.get(), integerCount, integers.get());
+	}
+
+	size_t stringCount = countAttributes(attributeBits & STR_ATTR_TYPES);
+	if (stringCount != 0) {
+		strings.reset(new InternedString[stringCount]);
+		std::copy_n(other.strings.get(), stringCount, strings.get());
+	}
+
+	if (other.custom) {
+		custom = std::make_unique<CustomAttributeMap>(*other.custom);
 	}
 
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
+	memoryStats.attributeBlocks.fetch_add(1, std::memory_order_relaxed);
+	memoryStats.integerSlots.fetch_add(integerCount, std::memory_order_relaxed);
+	memoryStats.stringSlots.fetch_add(stringCount, std::memory_order_relaxed);
+	memoryStats.customMaps.fetch_add(custom ? 1 : 0, std::memory_order_relaxed);
+}
+
+ItemAttributes::~ItemAttributes()
+{
+	memoryStats.attributeBlocks.fetch_sub(1, std::memory_order_relaxed);
+	memoryStats.integerSlots.fetch_sub(countAttributes(attributeBits & INT_ATTR_TYPES), std::memory_order_relaxed);
+	memoryStats.stringSlots.fetch_sub(countAttributes(attributeBits & STR_ATTR_TYPES), std::memory_order_relaxed);
+	memoryStats.customMaps.fetch_sub(custom ? 1 : 0, std::memory_order_relaxed);
+}
+
+const std::string& ItemAttributes::getStrAttr(ItemAttrTypes type) const
+{
+	if (!isStrAttrType(type) || !hasAttribute(type)) {
 		return emptyString;
 	}
-	return *attr->value.string;
+	return strings[getSlot(type, STR_ATTR_TYPES)].get();
 }
 
 void ItemAttributes::setStrAttr(ItemAttrTypes type, const std::string& value)
@@ -2535,9 +2632,25 @@ void ItemAttributes::setStrAttr(ItemAttrTypes type, const std::string& value)
 		return;
 	}
 
-	Attribute& attr = getAttr(type);
-	delete attr.value.string;
-	attr.value.string = new std::string(value);
+	getStrSlot(type) = g_stringPool().intern(value);
+}
+
+InternedString& ItemAttributes::getStrSlot(ItemAttrTypes type)
+{
+	size_t slot = getSlot(type, STR_ATTR_TYPES);
+	if (hasAttribute(type)) {
+		return strings[slot];
+	}
+
+	size_t count = countAttributes(attributeBits & STR_ATTR_TYPES);
+	std::unique_ptr<InternedString[]> newStrings(new InternedString[count + 1]);
+	std::move(strings.get(), strings.get() + slot, newStrings.get());
+	std::move(strings.get() + slot, strings.get() + count, newStrings.get() + slot + 1);
+	strings = std::move(newStrings);
+
+	attributeBits |= type;
+	memoryStats.stringSlots.fetch_add(1, std::memory_order_relaxed);
+	return strings[slot];
 }
 
 void ItemAttributes::removeAttribute(ItemAttrTypes type)
@@ -2546,27 +2659,43 @@ void ItemAttributes::removeAttribute(ItemAttrTypes type)
 		return;
 	}
 
-	for (auto it = attributes.begin(), end = attributes.end(); it != end; ++it) {
-		if ((*it).type == type) {
-			(*it) = std::move(attributes.back());
-			attributes.pop_back();
-			break;
+	if (isIntAttrType(type)) {
+		size_t slot = getSlot(type, INT_ATTR_TYPES);
+		size_t count = countAttributes(attributeBits & INT_ATTR_TYPES);
+		if (count == 1) {
+			integers.reset();
+		} else {
+			std::unique_ptr<int64_t[]> newIntegers(new int64_t[count - 1]);
+			std::copy_n(integers.get(), slot, newIntegers.get());
+			std::copy(integers.get() + slot + 1, integers.get() + count, newIntegers.get() + slot);
+			integers = std::move(newIntegers);
+		}
+		memoryStats.integerSlots.fetch_sub(1, std::memory_order_relaxed);
+	} else if (isStrAttrType(type)) {
+		size_t slot = getSlot(type, STR_ATTR_TYPES);
+		size_t count = countAttributes(attributeBits & STR_ATTR_TYPES);
+		if (count == 1) {
+			strings.reset();
+		} else {
+			std::unique_ptr<InternedString[]> newStrings(new InternedString[count - 1]);
+			std::move(strings.get(), strings.get() + slot, newStrings.get());
+			std::move(strings.get() + slot + 1, strings.get() + count, newStrings.get() + slot);
+			strings = std::move(newStrings);
 		}
+		memoryStats.stringSlots.fetch_sub(1, std::memory_order_relaxed);
+	} else if (isCustomAttrType(type)) {
+		custom.reset();
+		memoryStats.customMaps.fetch_sub(1, std::memory_order_relaxed);
 	}
 	attributeBits &= ~type;
 }
 
 int64_t ItemAttributes::getIntAttr(ItemAttrTypes type) const
 {
-	if (!isIntAttrType(type)) {
+	if (!isIntAttrType(type) || !hasAttribute(type)) {
 		return 0;
 	}
-
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
-		return 0;
-	}
-	return attr->value.integer;
+	return integers[getSlot(type, INT_ATTR_TYPES)];
 }
 
 void ItemAttributes::setIntAttr(ItemAttrTypes type, int64_t value)
@@ -2575,7 +2704,7 @@ void ItemAttributes::setIntAttr(ItemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer = value;
+	getIntSlot(type) = value;
 }
 
 void ItemAttributes::increaseIntAttr(ItemAttrTypes type, int64_t value)
@@ -2584,34 +2713,39 @@ void ItemAttributes::increaseIntAttr(ItemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer += value;
+	getIntSlot(type) += value;
 }
 
-const ItemAttributes::Attribute* ItemAttributes::getExistingAttr(ItemAttrTypes type) const
+int64_t& ItemAttributes::getIntSlot(ItemAttrTypes type)
 {
+	size_t slot = getSlot(type, INT_ATTR_TYPES);
 	if (hasAttribute(type)) {
-		for (const Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return &attribute;
-			}
-		}
+		return integers[slot];
 	}
-	return nullptr;
+
+	size_t count = countAttributes(attributeBits & INT_ATTR_TYPES);
+	std::unique_ptr<int64_t[]> newIntegers(new int64_t[count + 1]);
+	std::copy_n(integers.get(), slot, newIntegers.get());
+	std::copy(integers.get() + slot, integers.get() + count, newIntegers.get() + slot + 1);
+	newIntegers[slot] = 0;
+	integers = std::move(newIntegers);
+
+	attributeBits |= type;
+	memoryStats.integerSlots.fetch_add(1, std::memory_order_relaxed);
+	return integers[slot];
 }
 
-ItemAttributes::Attribute& ItemAttributes::getAttr(ItemAttrTypes type)
+size_t ItemAttributes::getMemoryUsage() const
 {
-	if (hasAttribute(type)) {
-		for (Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return attribute;
-			}
-		}
-	}
+	size_t usage = sizeof(ItemAttributes);
+	usage += countAttributes(attributeBits & INT_ATTR_TYPES) * sizeof(int64_t);
 
-	attributeBits |= type;
-	attributes.emplace_back(type);
-	return attributes.back();
+	usage += countAttributes(attributeBits & STR_ATTR_TYPES) * sizeof(InternedString);
+
+	if (custom) {
+		usage += sizeof(CustomAttributeMap) + custom->bucket_count() * (sizeof(CustomAttributeMap::value_type) + 1);
+	}
+	return usage;
 }
 
 void Item::startDecaying()
@@ -2630,22 +2764,20 @@ bool Item::hasMarketAttributes()
 		return true;
 	}
 
-	for (const auto& attribute : attributes->getList()) {
-		if (attribute.type == ITEM_ATTRIBUTE_CHARGES && static_cast<uint16_t>(attribute.value.integer) != items[id].charges) {
-			return false;
-		}
+	if (hasAttribute(ITEM_ATTRIBUTE_CHARGES) && static_cast<uint16_t>(getIntAttr(ITEM_ATTRIBUTE_CHARGES)) != items[id].charges) {
+		return false;
+	}
 
-		if (attribute.type == ITEM_ATTRIBUTE_DURATION && static_cast<uint32_t>(attribute.value.integer) != getDefaultDuration()) {
-			return false;
-		}
+	if (hasAttribute(ITEM_ATTRIBUTE_DURATION) && static_cast<uint32_t>(getIntAttr(ITEM_ATTRIBUTE_DURATION)) != getDefaultDuration()) {
+		return false;
+	}
 
-		if (attribute.type == ITEM_ATTRIBUTE_IMBUEMENT_TYPE && !hasImbuements()) {
-			return false;
-		}
+	if (hasAttribute(ITEM_ATTRIBUTE_IMBUEMENT_TYPE) && !hasImbuements()) {
+		return false;
+	}
 
-		if (attribute.type == ITEM_ATTRIBUTE_TIER && static_cast<uint32_t>(attribute.value.integer) != getTier()) {
-			return false;
-		}
+	if (hasAttribute(ITEM_ATTRIBUTE_TIER) && static_cast<uint32_t>(getIntAttr(ITEM_ATTRIBUTE_TIER)) != getTier()) {
+		return false;
 	}
 
 	return true;
@@ -24,6 +24,9 @@
 #include "items/thing.h"
 #include "items/items.h"
 #include "lua/scripts/luascript.h"
+#include "utils/memory_accounting.hpp"
+#include "utils/object_pool.hpp"
+#include "utils/string_pool.hpp"
 #include "utils/tools.h"
 #include "io/fileloader.h"
 
@@ -39,10 +42,31 @@ class MagicField;
 class BedItem;
 class Imbuement;
 
+// Live items and attribute slots, shared by all threads
+struct ItemMemoryStats {
+	std::atomic<int64_t> items {0};
+	std::atomic<int64_t> attributeBlocks {0};
+	std::atomic<int64_t> integerSlots {0};
+	std::atomic<int64_t> stringSlots {0};
+	std::atomic<int64_t> customMaps {0};
+};
+
 class ItemAttributes
 {
 	public:
-		ItemAttributes() = default;
+		ItemAttributes();
+		ItemAttributes(const ItemAttributes& other);
+		~ItemAttributes();
+
+		// non-assignable
+		ItemAttributes& operator=(const ItemAttributes&) = delete;
+
+		static void* operator new(size_t size) {
+			return ObjectPool::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			ObjectPool::deallocate(p, size);
+		}
 
 		void setSpecialDescription(const std::string& desc) {
 			setStrAttr(ITEM_ATTRIBUTE_DESCRIPTION, desc);
@@ -307,6 +331,8 @@ class ItemAttributes
 		}
 		void removeAttribute(ItemAttrTypes type);
 
+		static ItemMemoryStats memoryStats;
+
 		static std::string emptyString;
 		static int64_t emptyInt;
 		static double emptyDouble;
@@ -314,64 +340,25 @@ class ItemAttributes
 
 		typedef phmap::flat_hash_map<std::string, CustomAttribute> CustomAttributeMap;
 
-		struct Attribute {
-			union {
-				int64_t integer;
-				std::string* string;
-				CustomAttributeMap* custom;
-			} value;
-			ItemAttrTypes type;
-
-			// Singleton - ensures we don't accidentally copy it
-			Attribute& operator=(const Attribute& other) = delete;
-
-			explicit Attribute(ItemAttrTypes type) : type(type) {
-				memset(&value, 0, sizeof(value));
-			}
-			Attribute(const Attribute& i) {
-				type = i.type;
-				if (ItemAttributes::isIntAttrType(type)) {
-					value.integer = i.value.integer;
-				} else if (ItemAttributes::isStrAttrType(type)) {
-					value.string = new std::string(*i.value.string);
-				} else if (ItemAttributes::isCustomAttrType(type)) {
-					value.custom = new CustomAttributeMap(*i.value.custom);
-				} else {
-					memset(&value, 0, sizeof(value));
-				}
-			}
-			Attribute(Attribute&& attribute) noexcept : value(attribute.value), type(attribute.type) {
-				memset(&attribute.value, 0, sizeof(value));
-				attribute.type = ITEM_ATTRIBUTE_NONE;
-			}
-			Attribute& operator=(Attribute&& other) noexcept {
-				if (this != &other) {
-					if (ItemAttributes::isStrAttrType(type)) {
-						delete value.string;
-					} else if (ItemAttributes::isCustomAttrType(type)) {
-						delete value.custom;
-					}
-
-					value = other.value;
-					type = other.type;
-
-					memset(&other.value, 0, sizeof(value));
-					other.type = ITEM_ATTRIBUTE_NONE;
-				}
-				return *this;
-			}
-			~Attribute() {
-				if (ItemAttributes::isStrAttrType(type)) {
-					delete value.string;
-				} else if (ItemAttributes::isCustomAttrType(type)) {
-					delete value.custom;
-				}
-			}
-		};
-
-		std::vector<Attribute> attributes;
+		/**
+		 * The values of the set attributes of each kind, in bit order and sized to
+		 * exactly the set ones: the value of a type is at the number of set types of
+		 * its kind below it. Strings are interned in the string pool, so the many
+		 * equal writers, descriptions and names share one copy. The custom
+		 * attribute map is only allocated when a custom attribute is set.
+		 */
+		std::unique_ptr<int64_t[]> integers;
+		std::unique_ptr<InternedString[]> strings;
+		std::unique_ptr<CustomAttributeMap> custom;
 		std::underlying_type_t<ItemAttrTypes> attributeBits = 0;
 
+		static size_t countAttributes(std::underlying_type_t<ItemAttrTypes> bits) {
+			return std::bitset<32>(bits).count();
+		}
+		size_t getSlot(ItemAttrTypes type, std::underlying_type_t<ItemAttrTypes> kindTypes) const {
+			return countAttributes(attributeBits & kindTypes & (type - 1));
+		}
+
 		const std::string& getStrAttr(ItemAttrTypes type) const;
 		void setStrAttr(ItemAttrTypes type, const std::string& value);
 
@@ -379,15 +366,20 @@ class ItemAttributes
 		void setIntAttr(ItemAttrTypes type, int64_t value);
 		void increaseIntAttr(ItemAttrTypes type, int64_t value);
 
-		const Attribute* getExistingAttr(ItemAttrTypes type) const;
-		Attribute& getAttr(ItemAttrTypes type);
+		// slot of the type, added to the slots of its kind when it is not set yet
+		int64_t& getIntSlot(ItemAttrTypes type);
+		InternedString& getStrSlot(ItemAttrTypes type);
 
-		CustomAttributeMap* getCustomAttributeMap() {
-			if (!hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				return nullptr;
+		CustomAttributeMap* getCustomAttributeMap() const {
+			return custom.get();
+		}
+		CustomAttributeMap& getCustomAttributes() {
+			if (!custom) {
+				custom = std::make_unique<CustomAttributeMap>();
+				attributeBits |= ITEM_ATTRIBUTE_CUSTOM;
+				memoryStats.customMaps.fetch_add(1, std::memory_order_relaxed);
 			}
-
-			return getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
+			return *custom;
 		}
 
 		template<typename R>
@@ -404,22 +396,12 @@ class ItemAttributes
 		template<typename R>
 		void setCustomAttribute(std::string& key, R value) {
 			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->emplace(key, value);
+			getCustomAttributes().insert_or_assign(key, CustomAttribute(value));
 		}
 
 		void setCustomAttribute(std::string& key, CustomAttribute& value) {
 			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->insert(std::make_pair(std::move(key), std::move(value)));
+			getCustomAttributes().insert_or_assign(std::move(key), std::move(value));
 		}
 
 		const CustomAttribute* getCustomAttribute(int64_t key) {
@@ -454,50 +436,27 @@ class ItemAttributes
 		}
 
 	public:
+		static constexpr std::underlying_type_t<ItemAttrTypes> INT_ATTR_TYPES = ITEM_ATTRIBUTE_ACTIONID | ITEM_ATTRIBUTE_UNIQUEID |
+			ITEM_ATTRIBUTE_DATE | ITEM_ATTRIBUTE_WEIGHT | ITEM_ATTRIBUTE_ATTACK | ITEM_ATTRIBUTE_DEFENSE | ITEM_ATTRIBUTE_EXTRADEFENSE |
+			ITEM_ATTRIBUTE_ARMOR | ITEM_ATTRIBUTE_HITCHANCE | ITEM_ATTRIBUTE_SHOOTRANGE | ITEM_ATTRIBUTE_OWNER | ITEM_ATTRIBUTE_DURATION |
+			ITEM_ATTRIBUTE_DECAYSTATE | ITEM_ATTRIBUTE_CORPSEOWNER | ITEM_ATTRIBUTE_CHARGES | ITEM_ATTRIBUTE_FLUIDTYPE | ITEM_ATTRIBUTE_DOORID |
+			ITEM_ATTRIBUTE_IMBUEMENT_SLOT | ITEM_ATTRIBUTE_OPENCONTAINER | ITEM_ATTRIBUTE_QUICKLOOTCONTAINER |
+			ITEM_ATTRIBUTE_DURATION_TIMESTAMP | ITEM_ATTRIBUTE_TIER;
+		static constexpr std::underlying_type_t<ItemAttrTypes> STR_ATTR_TYPES = ITEM_ATTRIBUTE_DESCRIPTION | ITEM_ATTRIBUTE_TEXT |
+			ITEM_ATTRIBUTE_WRITER | ITEM_ATTRIBUTE_NAME | ITEM_ATTRIBUTE_ARTICLE | ITEM_ATTRIBUTE_PLURALNAME | ITEM_ATTRIBUTE_SPECIAL;
+
 		static bool isIntAttrType(ItemAttrTypes type) {
-			std::underlying_type_t<ItemAttrTypes> checkTypes = 0;
-			checkTypes |= ITEM_ATTRIBUTE_ACTIONID;
-			checkTypes |= ITEM_ATTRIBUTE_UNIQUEID;
-			checkTypes |= ITEM_ATTRIBUTE_DATE;
-			checkTypes |= ITEM_ATTRIBUTE_WEIGHT;
-			checkTypes |= ITEM_ATTRIBUTE_ATTACK;
-			checkTypes |= ITEM_ATTRIBUTE_DEFENSE;
-			checkTypes |= ITEM_ATTRIBUTE_EXTRADEFENSE;
-			checkTypes |= ITEM_ATTRIBUTE_ARMOR;
-			checkTypes |= ITEM_ATTRIBUTE_HITCHANCE;
-			checkTypes |= ITEM_ATTRIBUTE_SHOOTRANGE;
-			checkTypes |= ITEM_ATTRIBUTE_OWNER;
-			checkTypes |= ITEM_ATTRIBUTE_DURATION;
-			checkTypes |= ITEM_ATTRIBUTE_DECAYSTATE;
-			checkTypes |= ITEM_ATTRIBUTE_CORPSEOWNER;
-			checkTypes |= ITEM_ATTRIBUTE_CHARGES;
-			checkTypes |= ITEM_ATTRIBUTE_FLUIDTYPE;
-			checkTypes |= ITEM_ATTRIBUTE_DOORID;
-			checkTypes |= ITEM_ATTRIBUTE_IMBUEMENT_SLOT;
-			checkTypes |= ITEM_ATTRIBUTE_OPENCONTAINER;
-			checkTypes |= ITEM_ATTRIBUTE_QUICKLOOTCONTAINER;
-			checkTypes |= ITEM_ATTRIBUTE_DURATION_TIMESTAMP;
-			checkTypes |= ITEM_ATTRIBUTE_TIER;
-			return (type & static_cast<ItemAttrTypes>(checkTypes)) != 0;
+			return (type & INT_ATTR_TYPES) != 0;
 		}
 		static bool isStrAttrType(ItemAttrTypes type) {
-			std::underlying_type_t<ItemAttrTypes> checkTypes = 0;
-			checkTypes |= ITEM_ATTRIBUTE_DESCRIPTION;
-			checkTypes |= ITEM_ATTRIBUTE_TEXT;
-			checkTypes |= ITEM_ATTRIBUTE_WRITER;
-			checkTypes |= ITEM_ATTRIBUTE_NAME;
-			checkTypes |= ITEM_ATTRIBUTE_ARTICLE;
-			checkTypes |= ITEM_ATTRIBUTE_PLURALNAME;
-			checkTypes |= ITEM_ATTRIBUTE_SPECIAL;
-			return (type & static_cast<ItemAttrTypes>(checkTypes)) != 0;
+			return (type & STR_ATTR_TYPES) != 0;
 		}
 		inline static bool isCustomAttrType(ItemAttrTypes type) {
 			return (type & ITEM_ATTRIBUTE_CUSTOM) != 0;
 		}
 
-		const std::vector<Attribute>& getList() const {
-			return attributes;
-		}
+		// heap bytes of these attributes, the block itself included and the pooled strings left out
+		size_t getMemoryUsage() const;
 
 	friend class Item;
 };
@@ -511,16 +470,31 @@ class Item : virtual public Thing
 		static Item* CreateItem(PropStream& propStream);
 		static Items items;
 
+		static ItemMemoryStats& getMemoryStats() {
+			return ItemAttributes::memoryStats;
+		}
+
 		// Constructor for items
 		Item(const uint16_t type, uint16_t count = 0);
 		Item(const Item& i);
 		virtual Item* clone() const;
 
-		virtual ~Item() = default;
+		virtual ~Item();
 
 		// non-assignable
 		Item& operator=(const Item&) = delete;
 
+		// the virtual destructor hands the size of the most derived class to
+		// operator delete, so every item subclass is pooled with its own size
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_ITEM, size);
+			return ObjectPool::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_ITEM, size);
+			ObjectPool::deallocate(p, size);
+		}
+
 		bool equals(const Item* otherItem) const;
 
 		Item* getItem() override final {
@@ -584,6 +558,11 @@ class Item : virtual public Thing
 		}
 		void setIntAttr(ItemAttrTypes type, int64_t value) {
 			getAttributes()->setIntAttr(type, value);
+			if (type == ITEM_ATTRIBUTE_FLUIDTYPE || type == ITEM_ATTRIBUTE_TIER) {
+				resetTileDescriptionCache();
+			} else if (type == ITEM_ATTRIBUTE_ACTIONID || type == ITEM_ATTRIBUTE_UNIQUEID) {
+				updateTileMoveEventFlag();
+			}
 		}
 		void increaseIntAttr(ItemAttrTypes type, int64_t value) {
 			getAttributes()->increaseIntAttr(type, value);
@@ -608,6 +587,10 @@ class Item : virtual public Thing
 			}
 			return attributes->hasAttribute(type);
 		}
+		// heap bytes held by the attributes of this item
+		size_t getAttributeMemory() const {
+			return attributes ? attributes->getMemoryUsage() : 0;
+		}
 
 		template<typename R>
 		void setCustomAttribute(std::string& key, R value) {
@@ -630,11 +613,7 @@ class Item : virtual public Thing
 				return nullptr;
 			}
 
-			if (!attributes->hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				return nullptr;
-			}
-
-			ItemAttributes::CustomAttributeMap* customAttrMap = attributes->getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
+			const ItemAttributes::CustomAttributeMap* customAttrMap = attributes->getCustomAttributeMap();
 			if (!customAttrMap) {
 				return nullptr;
 			}
@@ -795,6 +774,8 @@ class Item : virtual public Thing
 		static std::vector<std::pair<std::string, std::string>> getDescriptions(const ItemType& it,
                                     const Item* item = nullptr);
 		static std::string getDescription(const ItemType& it, int32_t lookDistance, const Item* item = nullptr, int32_t subType = -1, bool addArticle = true);
+		// forgets the cached descriptions, after anything they are built from was reloaded
+		static void clearDescriptionCache();
 		static std::string getNameDescription(const ItemType& it, const Item* item = nullptr, int32_t subType = -1, bool addArticle = true);
 		static std::string getWeightDescription(const ItemType& it, uint32_t weight, uint32_t count = 1);
 
@@ -842,7 +823,7 @@ class Item : virtual public Thing
 			if (hasAttribute(ITEM_ATTRIBUTE_WEIGHT)) {
 				return getIntAttr(ITEM_ATTRIBUTE_WEIGHT);
 			}
-			return items[id].weight;
+			return items.getHotData(id).weight;
 		}
 		int32_t getAttack() const {
 			if (hasAttribute(ITEM_ATTRIBUTE_ATTACK)) {
@@ -895,34 +876,34 @@ class Item : virtual public Thing
 
 		bool hasProperty(ItemProperty prop) const;
 		bool isBlocking() const {
-			return items[id].blockSolid;
+			return items.getHotData(id).hasFlag(ITEM_FLAG_BLOCKSOLID);
 		}
 		bool isStackable() const {
-			return items[id].stackable;
+			return items.getHotData(id).hasFlag(ITEM_FLAG_STACKABLE);
 		}
 		bool isStowable() const {
 			return items[id].stackable && items[id].wareId > 0;
 		}
 		bool isAlwaysOnTop() const {
-			return items[id].alwaysOnTopOrder != 0;
+			return items.getHotData(id).alwaysOnTopOrder != 0;
 		}
 		bool isGroundTile() const {
-			return items[id].isGroundTile();
+			return items.getHotData(id).hasFlag(ITEM_FLAG_GROUND);
 		}
 		bool isMagicField() const {
-			return items[id].isMagicField();
+			return items.getHotData(id).hasFlag(ITEM_FLAG_MAGICFIELD);
 		}
 		bool isWrapContainer() const {
 			return items[id].wrapContainer;
 		}
 		bool isMoveable() const {
-			return items[id].moveable;
+			return items.getHotData(id).hasFlag(ITEM_FLAG_MOVEABLE);
 		}
 		bool isCorpse() const {
 			return items[id].isCorpse;
 		}
 		bool isPickupable() const {
-			return items[id].pickupable;
+			return items.getHotData(id).hasFlag(ITEM_FLAG_PICKUPABLE);
 		}
 		bool isMultiUse() const {
 			return items[id].multiUse;
@@ -940,7 +921,7 @@ class Item : virtual public Thing
 			return items[id].wrapable && items[id].wrapableTo;
 		}
 		bool hasWalkStack() const {
-			return items[id].walkStack;
+			return items.getHotData(id).hasFlag(ITEM_FLAG_WALKSTACK);
 		}
 		bool isQuiver() const {
 			return items[id].isQuiver();
@@ -971,6 +952,7 @@ class Item : virtual public Thing
 		}
 		void setItemCount(uint8_t n) {
 			count = n;
+			resetTileDescriptionCache();
 		}
 
 		static uint32_t countByType(const Item* item, int32_t subType) {
@@ -1027,6 +1009,9 @@ class Item : virtual public Thing
 			return attributes;
 		}
 
+		uint32_t getReferenceCounter() const {
+			return referenceCounter;
+		}
 		void incrementReferenceCounter() {
 			++referenceCounter;
 		}
@@ -1046,6 +1031,10 @@ class Item : virtual public Thing
 		const Cylinder* getTopParent() const;
 		Tile* getTile() override;
 		const Tile* getTile() const override;
+		// Drops the cached description of the tile this item lies on, if any
+		void resetTileDescriptionCache();
+		// Lets the tile this item lies on notice a new action or unique id
+		void updateTileMoveEventFlag();
 		bool isRemoved() const override {
 			return !parent || parent->isRemoved();
 		}
@@ -1149,6 +1138,8 @@ class Item : virtual public Thing
 		Cylinder* parent = nullptr;
 		std::unique_ptr<ItemAttributes> attributes;
 
+		static std::string buildDescription(const ItemType& it, int32_t lookDistance, const Item* item, int32_t subType, bool addArticle);
+
 		uint32_t referenceCounter = 0;
 
 		uint16_t id;  // the same id as in ItemType
@@ -21,9 +21,11 @@
 
 #include "items/functions/item_parse.hpp"
 #include "items/items.h"
+#include "items/items_cache.hpp"
 #include "items/weapons/weapons.h"
 #include "game/game.h"
 #include "utils/pugicast.h"
+#include "protobuf/appearances.pb.h"
 
 #ifdef __cpp_lib_filesystem
 #include <filesystem>
@@ -38,7 +40,8 @@ Items::Items(){}
 void Items::clear()
 {
 	items.clear();
-	nameToItems.clear();
+	hotData.clear();
+	nameIndex.clear();
 }
 
 using LootTypeNames = phmap::flat_hash_map<std::string, ItemTypes_t>;
@@ -83,7 +86,9 @@ ItemTypes_t Items::getLootType(const std::string& strValue)
 bool Items::reload()
 {
 	clear();
-	loadFromProtobuf();
+	if (g_game().loadAppearanceProtobuf("data/items/appearances.dat") != ERROR_NONE) {
+		return false;
+	}
 
 	if (!loadFromXml()) {
 		return false;
@@ -93,13 +98,11 @@ bool Items::reload()
 	return true;
 }
 
-void Items::loadFromProtobuf()
+void Items::loadFromProtobuf(const Canary::protobuf::appearances::Appearances& appearances)
 {
 	using namespace Canary::protobuf::appearances;
 
-	for (uint32_t it = 0; it < g_game().appearances.object_size(); ++it) {
-		Appearance object = g_game().appearances.object(it);
-
+	for (const Appearance& object : appearances.object()) {
 		// This scenario should never happen but on custom assets this can break the loader.
 		if (!object.has_flags()) {
 			SPDLOG_WARN("[Items::loadFromProtobuf] - Item with id '{}' is invalid and was ignored.", object.id());
@@ -174,10 +177,7 @@ void Items::loadFromProtobuf()
 		iType.expireStop = object.flags().expirestop();
 
 		if (!iType.name.empty()) {
-			nameToItems.insert({
-				asLowerCaseString(iType.name),
-				iType.id
-			});
+			nameIndex.emplace_back(asLowerCaseString(iType.name), iType.id);
 		}
 	}
 
@@ -186,10 +186,26 @@ void Items::loadFromProtobuf()
 
 bool Items::loadFromXml()
 {
+	const std::string xmlFileName = "data/items/items.xml";
+	const std::string appearancesFileName = "data/items/appearances.dat";
+	if (loadItemsCache(xmlFileName, appearancesFileName, items)) {
+		nameIndex.clear();
+		for (const ItemType& itemType : items) {
+			if (!itemType.name.empty()) {
+				nameIndex.emplace_back(asLowerCaseString(itemType.name), itemType.id);
+			}
+		}
+
+		buildNameIndex();
+		buildHotData();
+		SPDLOG_INFO("Loaded {} item types from {}", items.size(), getItemsCacheFileName(xmlFileName));
+		return true;
+	}
+
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file("data/items/items.xml");
+	pugi::xml_parse_result result = doc.load_file(xmlFileName.c_str());
 	if (!result) {
-		printXMLError("Error - Items::loadFromXml", "data/items/items.xml", result);
+		printXMLError("Error - Items::loadFromXml", xmlFileName, result);
 		return false;
 	}
 
@@ -226,9 +242,56 @@ bool Items::loadFromXml()
 			parseItemNode(itemNode, id++);
 		}
 	}
+
+	buildNameIndex();
+	buildHotData();
+	if (saveItemsCache(xmlFileName, appearancesFileName, items)) {
+		SPDLOG_INFO("Items cache saved to {}", getItemsCacheFileName(xmlFileName));
+	}
 	return true;
 }
 
+void Items::buildNameIndex()
+{
+	std::sort(nameIndex.begin(), nameIndex.end());
+	nameIndex.shrink_to_fit();
+}
+
+void Items::buildHotData()
+{
+	hotData.assign(items.size(), ItemTypeHotData());
+	for (size_t id = 0; id < items.size(); ++id) {
+		const ItemType& itemType = items[id];
+		ItemTypeHotData& data = hotData[id];
+		data.weight = itemType.weight;
+		data.speed = itemType.speed;
+		data.alwaysOnTopOrder = itemType.alwaysOnTopOrder;
+
+		const std::pair<bool, uint16_t> flags[] = {
+			{itemType.blockSolid, ITEM_FLAG_BLOCKSOLID},
+			{itemType.blockPathFind, ITEM_FLAG_BLOCKPATH},
+			{itemType.blockProjectile, ITEM_FLAG_BLOCKPROJECTILE},
+			{itemType.hasHeight, ITEM_FLAG_HASHEIGHT},
+			{itemType.moveable, ITEM_FLAG_MOVEABLE},
+			{itemType.isVertical, ITEM_FLAG_VERTICAL},
+			{itemType.isHorizontal, ITEM_FLAG_HORIZONTAL},
+			{itemType.isMagicField(), ITEM_FLAG_MAGICFIELD},
+			{itemType.isGroundTile(), ITEM_FLAG_GROUND},
+			{itemType.stackable, ITEM_FLAG_STACKABLE},
+			{itemType.walkStack, ITEM_FLAG_WALKSTACK},
+			{itemType.pickupable, ITEM_FLAG_PICKUPABLE},
+			{itemType.allowPickupable, ITEM_FLAG_ALLOWPICKUPABLE},
+			{itemType.lookThrough, ITEM_FLAG_LOOKTHROUGH},
+			{itemType.isBed(), ITEM_FLAG_BED},
+		};
+		for (const auto& [isSet, flag] : flags) {
+			if (isSet) {
+				data.flags |= flag;
+			}
+		}
+	}
+}
+
 void Items::buildInventoryList()
 {
 	inventory.reserve(items.size());
@@ -271,18 +334,17 @@ void Items::parseItemNode(const pugi::xml_node & itemNode, uint16_t id) {
 	if (std::string xmlName = itemNode.attribute("name").as_string();
 			!xmlName.empty() && itemType.name != xmlName) {
 		if (!itemType.name.empty()) {
-			if (auto it = std::find_if(nameToItems.begin(), nameToItems.end(), [id](const auto nameMapIt) {
-					return nameMapIt.second == id;
-				}); it != nameToItems.end()) {
-				nameToItems.erase(it);
+			if (auto it = std::find_if(nameIndex.begin(), nameIndex.end(), [id](const auto& entry) {
+					return entry.second == id;
+				}); it != nameIndex.end()) {
+				// the index is sorted at the end, the order does not matter yet
+				*it = std::move(nameIndex.back());
+				nameIndex.pop_back();
 			}
 		}
 
 		itemType.name = xmlName;
-		nameToItems.insert({
-			asLowerCaseString(itemType.name),
-			id
-		});
+		nameIndex.emplace_back(asLowerCaseString(itemType.name), id);
 	}
 
 	itemType.loaded = true;
@@ -339,14 +401,37 @@ const ItemType& Items::getItemType(size_t id) const
 	return items.front();
 }
 
-uint16_t Items::getItemIdByName(const std::string& name)
+Items::NameRange Items::getItemIdsByName(std::string_view name) const
 {
-	auto result = nameToItems.find(asLowerCaseString(name));
+	// the stored names are lower case, the searched one is lowered while comparing
+	auto compare = [name](const std::string& stored) {
+		size_t length = std::min(stored.size(), name.size());
+		for (size_t i = 0; i < length; ++i) {
+			unsigned char left = stored[i];
+			unsigned char right = static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(name[i])));
+			if (left != right) {
+				return left < right ? -1 : 1;
+			}
+		}
+		return stored.size() == name.size() ? 0 : (stored.size() < name.size() ? -1 : 1);
+	};
+
+	auto first = std::partition_point(nameIndex.begin(), nameIndex.end(), [&compare](const auto& entry) {
+		return compare(entry.first) < 0;
+	});
+	auto last = std::partition_point(first, nameIndex.end(), [&compare](const auto& entry) {
+		return compare(entry.first) == 0;
+	});
+	return {first, last};
+}
 
-	if (result == nameToItems.end())
+uint16_t Items::getItemIdByName(std::string_view name) const
+{
+	auto [first, last] = getItemIdsByName(name);
+	if (first == last) {
 		return 0;
-
-	return result->second;
+	}
+	return first->second;
 }
 
 bool Items::hasItemType(size_t hasId) const
@@ -25,6 +25,10 @@
 #include "declarations.hpp"
 #include "game/movement/position.h"
 
+namespace Canary::protobuf::appearances {
+	class Appearances;
+}
+
 struct Abilities {
 	public:
 		uint32_t conditionImmunities = 0;
@@ -300,10 +304,46 @@ class ItemType
 		bool loaded = false;
 };
 
+enum ItemTypeFlag_t : uint16_t {
+	ITEM_FLAG_BLOCKSOLID = 1 << 0,
+	ITEM_FLAG_BLOCKPATH = 1 << 1,
+	ITEM_FLAG_BLOCKPROJECTILE = 1 << 2,
+	ITEM_FLAG_HASHEIGHT = 1 << 3,
+	ITEM_FLAG_MOVEABLE = 1 << 4,
+	ITEM_FLAG_VERTICAL = 1 << 5,
+	ITEM_FLAG_HORIZONTAL = 1 << 6,
+	ITEM_FLAG_MAGICFIELD = 1 << 7,
+	ITEM_FLAG_GROUND = 1 << 8,
+	ITEM_FLAG_STACKABLE = 1 << 9,
+	ITEM_FLAG_WALKSTACK = 1 << 10,
+	ITEM_FLAG_PICKUPABLE = 1 << 11,
+	ITEM_FLAG_ALLOWPICKUPABLE = 1 << 12,
+	ITEM_FLAG_LOOKTHROUGH = 1 << 13,
+	ITEM_FLAG_BED = 1 << 14,
+};
+
+/**
+ * The ItemType fields read by the tile, movement and pathfinding checks, packed
+ * in 12 bytes per item id so those checks do not pull the whole ItemType
+ * into the cache. Built once the item types are loaded, none of them changes later.
+ */
+struct ItemTypeHotData {
+	uint32_t weight = 0;
+	uint16_t speed = 0;
+	uint16_t flags = 0;
+	uint8_t alwaysOnTopOrder = 0;
+
+	bool hasFlag(uint16_t flag) const {
+		return (flags & flag) != 0;
+	}
+};
+
 class Items
 {
 	public:
-		using NameMap = std::unordered_multimap<std::string, uint16_t>;
+		// lower case names, sorted by name and id once items.xml is loaded
+		using NameIndex = std::vector<std::pair<std::string, uint16_t>>;
+		using NameRange = std::pair<NameIndex::const_iterator, NameIndex::const_iterator>;
 		using InventoryVector = std::vector<uint16_t>;
 
 		Items();
@@ -315,7 +355,7 @@ class Items
 		bool reload();
 		void clear();
 
-		void loadFromProtobuf();
+		void loadFromProtobuf(const Canary::protobuf::appearances::Appearances& appearances);
 
 		const ItemType& operator[](size_t id) const {
 			return getItemType(id);
@@ -332,7 +372,17 @@ class Items
 		 */
 		bool hasItemType(size_t hasId) const;
 
-		uint16_t getItemIdByName(const std::string& name);
+		const ItemTypeHotData& getHotData(size_t id) const {
+			if (id < hotData.size()) {
+				return hotData[id];
+			}
+			return hotData.front();
+		}
+
+		// case insensitive, the lowest id when several items share the name
+		uint16_t getItemIdByName(std::string_view name) const;
+		// every item with the name, case insensitive
+		NameRange getItemIdsByName(std::string_view name) const;
 
 		ItemTypes_t getLootType(const std::string& strValue);
 
@@ -348,11 +398,13 @@ class Items
 			return items.size();
 		}
 
-		NameMap nameToItems;
-
 	private:
+		void buildNameIndex();
+		void buildHotData();
 
 		std::vector<ItemType> items;
+		std::vector<ItemTypeHotData> hotData;
+		NameIndex nameIndex;
 		InventoryVector inventory;
 };
 
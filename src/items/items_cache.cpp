@@ -0,0 +1,416 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "creatures/combat/condition.h"
+#include "io/fileloader.h"
+#include "items/items_cache.hpp"
+#include "utils/tools.h"
+
+static_assert(std::is_trivially_copyable_v<Abilities>, "Abilities is stored as is");
+
+namespace {
+
+constexpr std::array<char, 4> ITEMS_CACHE_IDENTIFIER = {{'C', 'I', 'T', 'M'}};
+
+#pragma pack(1)
+
+struct ItemsCacheHeader {
+	std::array<char, 4> identifier;
+	uint32_t version;
+	// a changed layout of the types makes older caches unusable even without a version bump
+	uint32_t itemTypeSize;
+	uint32_t abilitiesSize;
+	uint64_t xmlSize;
+	uint32_t xmlChecksum;
+	uint64_t appearancesSize;
+	uint32_t appearancesChecksum;
+	uint64_t payloadSize;
+	uint32_t payloadChecksum;
+};
+
+#pragma pack()
+
+class ItemsCacheWriter
+{
+	public:
+		explicit ItemsCacheWriter(PropWriteStream& initStream) :
+			stream(initStream) {}
+
+		template <typename T>
+		void value(const T& data) {
+			static_assert(std::is_trivially_copyable_v<T>, "only plain values are written as is");
+			stream.write<T>(data);
+		}
+		void value(const std::string& data) {
+			stream.writeString(data);
+		}
+
+		void abilities(const std::unique_ptr<Abilities>& abilities) {
+			stream.write<uint8_t>(abilities ? 1 : 0);
+			if (abilities) {
+				stream.write<Abilities>(*abilities);
+			}
+		}
+
+		void conditionDamage(const std::unique_ptr<ConditionDamage>& condition) {
+			stream.write<uint8_t>(condition ? 1 : 0);
+			if (!condition) {
+				return;
+			}
+
+			stream.write<uint32_t>(condition->getId());
+			stream.write<uint32_t>(condition->getType());
+			const std::deque<IntervalInfo>& damageList = condition->getDamageList();
+			stream.write<uint32_t>(static_cast<uint32_t>(damageList.size()));
+			for (const IntervalInfo& damageInfo : damageList) {
+				stream.write<int32_t>(damageInfo.interval);
+				stream.write<int32_t>(damageInfo.value);
+			}
+		}
+
+		void imbuementTypes(const std::map<ImbuementTypes_t, uint16_t>& imbuementTypes) {
+			stream.write<uint32_t>(static_cast<uint32_t>(imbuementTypes.size()));
+			for (const auto& [imbuementType, maxTier] : imbuementTypes) {
+				stream.write<ImbuementTypes_t>(imbuementType);
+				stream.write<uint16_t>(maxTier);
+			}
+		}
+
+	private:
+		PropWriteStream& stream;
+};
+
+class ItemsCacheReader
+{
+	public:
+		explicit ItemsCacheReader(PropStream& initStream) :
+			stream(initStream) {}
+
+		template <typename T>
+		void value(T& data) {
+			if (!stream.read<T>(data)) {
+				failed = true;
+			}
+		}
+		void value(std::string& data) {
+			if (!stream.readString(data)) {
+				failed = true;
+			}
+		}
+
+		void abilities(std::unique_ptr<Abilities>& abilities) {
+			uint8_t hasAbilities = 0;
+			value(hasAbilities);
+			if (hasAbilities != 0) {
+				abilities = std::make_unique<Abilities>();
+				value(*abilities);
+			}
+		}
+
+		void conditionDamage(std::unique_ptr<ConditionDamage>& condition) {
+			uint8_t hasCondition = 0;
+			value(hasCondition);
+			if (hasCondition == 0) {
+				return;
+			}
+
+			uint32_t id = 0;
+			uint32_t type = 0;
+			uint32_t count = 0;
+			value(id);
+			value(type);
+			value(count);
+			if (failed) {
+				return;
+			}
+
+			// rebuilt the way ItemParse::parseField builds it, the intervals are already clamped
+			condition = std::make_unique<ConditionDamage>(static_cast<ConditionId_t>(id), static_cast<ConditionType_t>(type));
+			for (uint32_t i = 0; i < count && !failed; ++i) {
+				int32_t interval = 0;
+				int32_t damage = 0;
+				value(interval);
+				value(damage);
+				condition->addDamage(1, interval, damage);
+			}
+
+			condition->setParam(CONDITION_PARAM_FIELD, 1);
+			if (condition->getTotalDamage() > 0) {
+				condition->setParam(CONDITION_PARAM_FORCEUPDATE, 1);
+			}
+		}
+
+		void imbuementTypes(std::map<ImbuementTypes_t, uint16_t>& imbuementTypes) {
+			uint32_t count = 0;
+			value(count);
+			for (uint32_t i = 0; i < count && !failed; ++i) {
+				ImbuementTypes_t imbuementType;
+				uint16_t maxTier = 0;
+				value(imbuementType);
+				value(maxTier);
+				imbuementTypes[imbuementType] = maxTier;
+			}
+		}
+
+		bool hasFailed() const {
+			return failed;
+		}
+
+	private:
+		PropStream& stream;
+		bool failed = false;
+};
+
+// Every member of ItemType, in one order for both directions
+template <typename Archive, typename Type>
+void visitItemType(Archive& archive, Type& itemType)
+{
+	archive.value(itemType.group);
+	archive.value(itemType.type);
+	archive.value(itemType.id);
+
+	archive.value(itemType.name);
+	archive.value(itemType.article);
+	archive.value(itemType.pluralName);
+	archive.value(itemType.description);
+	archive.value(itemType.runeSpellName);
+	archive.value(itemType.vocationString);
+
+	archive.abilities(itemType.abilities);
+	archive.conditionDamage(itemType.conditionDamage);
+
+	archive.value(itemType.weight);
+	archive.value(itemType.levelDoor);
+	archive.value(itemType.decayTime);
+	archive.value(itemType.wieldInfo);
+	archive.value(itemType.minReqLevel);
+	archive.value(itemType.minReqMagicLevel);
+	archive.value(itemType.charges);
+	archive.value(itemType.buyPrice);
+	archive.value(itemType.sellPrice);
+	archive.value(itemType.maxHitChance);
+	archive.value(itemType.decayTo);
+	archive.value(itemType.attack);
+	archive.value(itemType.defense);
+	archive.value(itemType.extraDefense);
+	archive.value(itemType.armor);
+	archive.value(itemType.rotateTo);
+	archive.value(itemType.runeMagLevel);
+	archive.value(itemType.runeLevel);
+	archive.value(itemType.wrapableTo);
+
+	archive.value(itemType.combatType);
+
+	archive.value(itemType.transformToOnUse[0]);
+	archive.value(itemType.transformToOnUse[1]);
+	archive.value(itemType.transformToFree);
+	archive.value(itemType.destroyTo);
+	archive.value(itemType.maxTextLen);
+	archive.value(itemType.writeOnceItemId);
+	archive.value(itemType.transformEquipTo);
+	archive.value(itemType.transformDeEquipTo);
+	archive.value(itemType.maxItems);
+	archive.value(itemType.slotPosition);
+	archive.value(itemType.speed);
+	archive.value(itemType.wareId);
+
+	archive.value(itemType.magicEffect);
+	archive.value(itemType.bedPartnerDir);
+	archive.value(itemType.weaponType);
+	archive.value(itemType.ammoType);
+	archive.value(itemType.shootType);
+	archive.value(itemType.corpseType);
+	archive.value(itemType.fluidSource);
+	archive.value(itemType.floorChange);
+	archive.imbuementTypes(itemType.imbuementTypes);
+
+	archive.value(itemType.upgradeClassification);
+	archive.value(itemType.alwaysOnTopOrder);
+	archive.value(itemType.lightLevel);
+	archive.value(itemType.lightColor);
+	archive.value(itemType.shootRange);
+	archive.value(itemType.imbuementSlot);
+	archive.value(itemType.hitChance);
+
+	archive.value(itemType.wearOut);
+	archive.value(itemType.clockExpire);
+	archive.value(itemType.expire);
+	archive.value(itemType.expireStop);
+
+	archive.value(itemType.forceUse);
+	archive.value(itemType.hasHeight);
+	archive.value(itemType.walkStack);
+	archive.value(itemType.blockSolid);
+	archive.value(itemType.blockPickupable);
+	archive.value(itemType.blockProjectile);
+	archive.value(itemType.blockPathFind);
+	archive.value(itemType.allowPickupable);
+	archive.value(itemType.showDuration);
+	archive.value(itemType.showCharges);
+	archive.value(itemType.showAttributes);
+	archive.value(itemType.replaceable);
+	archive.value(itemType.pickupable);
+	archive.value(itemType.rotatable);
+	archive.value(itemType.wrapable);
+	archive.value(itemType.wrapContainer);
+	archive.value(itemType.multiUse);
+	archive.value(itemType.moveable);
+	archive.value(itemType.canReadText);
+	archive.value(itemType.canWriteText);
+	archive.value(itemType.isVertical);
+	archive.value(itemType.isHorizontal);
+	archive.value(itemType.isHangable);
+	archive.value(itemType.allowDistRead);
+	archive.value(itemType.lookThrough);
+	archive.value(itemType.stopTime);
+	archive.value(itemType.showCount);
+	archive.value(itemType.stackable);
+	archive.value(itemType.isPodium);
+	archive.value(itemType.isCorpse);
+	archive.value(itemType.loaded);
+}
+
+bool fillSourceChecksums(const std::string& xmlFileName, const std::string& appearancesFileName, ItemsCacheHeader& header)
+{
+	return getFileChecksum(xmlFileName, header.xmlSize, header.xmlChecksum) &&
+		getFileChecksum(appearancesFileName, header.appearancesSize, header.appearancesChecksum);
+}
+
+}  // namespace
+
+std::string getItemsCacheFileName(const std::string& xmlFileName)
+{
+	return getCachePath(boost::filesystem::path(xmlFileName).filename().string() + ".cache", xmlFileName + ".cache");
+}
+
+bool loadItemsCache(const std::string& xmlFileName, const std::string& appearancesFileName, std::vector<ItemType>& items)
+{
+	const std::string cacheFileName = getItemsCacheFileName(xmlFileName);
+	boost::system::error_code error;
+	if (!boost::filesystem::exists(cacheFileName, error)) {
+		return false;
+	}
+
+	boost::iostreams::mapped_file_source file;
+	try {
+		file.open(cacheFileName);
+	} catch (const std::exception& e) {
+		SPDLOG_WARN("[loadItemsCache] - Could not open {}: {}", cacheFileName, e.what());
+		return false;
+	}
+
+	ItemsCacheHeader header;
+	if (file.size() < sizeof(header)) {
+		SPDLOG_WARN("[loadItemsCache] - {} is damaged, loading {} instead", cacheFileName, xmlFileName);
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.identifier != ITEMS_CACHE_IDENTIFIER || header.version != ITEMS_CACHE_VERSION
+			|| header.itemTypeSize != sizeof(ItemType) || header.abilitiesSize != sizeof(Abilities)) {
+		SPDLOG_INFO("{} was built by another version, loading {} instead", cacheFileName, xmlFileName);
+		return false;
+	}
+
+	ItemsCacheHeader current {};
+	if (!fillSourceChecksums(xmlFileName, appearancesFileName, current)
+			|| current.xmlSize != header.xmlSize || current.xmlChecksum != header.xmlChecksum
+			|| current.appearancesSize != header.appearancesSize || current.appearancesChecksum != header.appearancesChecksum) {
+		SPDLOG_INFO("{} or {} changed since {} was built, loading them instead", xmlFileName, appearancesFileName, cacheFileName);
+		return false;
+	}
+
+	const char* payload = file.data() + sizeof(header);
+	if (header.payloadSize != file.size() - sizeof(header) || updateCrc32(0, payload, header.payloadSize) != header.payloadChecksum) {
+		SPDLOG_WARN("[loadItemsCache] - {} is damaged, loading {} instead", cacheFileName, xmlFileName);
+		return false;
+	}
+
+	PropStream propStream;
+	propStream.init(payload, header.payloadSize);
+	ItemsCacheReader reader(propStream);
+
+	uint32_t count = 0;
+	reader.value(count);
+
+	std::vector<ItemType> cachedItems(count);
+	for (ItemType& itemType : cachedItems) {
+		visitItemType(reader, itemType);
+		if (reader.hasFailed()) {
+			break;
+		}
+	}
+
+	if (reader.hasFailed() || propStream.size() != 0) {
+		SPDLOG_WARN("[loadItemsCache] - {} is damaged, loading {} instead", cacheFileName, xmlFileName);
+		return false;
+	}
+
+	items = std::move(cachedItems);
+	return true;
+}
+
+bool saveItemsCache(const std::string& xmlFileName, const std::string& appearancesFileName, const std::vector<ItemType>& items)
+{
+	ItemsCacheHeader header;
+	header.identifier = ITEMS_CACHE_IDENTIFIER;
+	header.version = ITEMS_CACHE_VERSION;
+	header.itemTypeSize = sizeof(ItemType);
+	header.abilitiesSize = sizeof(Abilities);
+	if (!fillSourceChecksums(xmlFileName, appearancesFileName, header)) {
+		return false;
+	}
+
+	PropWriteStream propWriteStream;
+	ItemsCacheWriter writer(propWriteStream);
+	writer.value(static_cast<uint32_t>(items.size()));
+	for (const ItemType& itemType : items) {
+		visitItemType(writer, itemType);
+	}
+
+	size_t payloadSize;
+	const char* payload = propWriteStream.getStream(payloadSize);
+	header.payloadSize = payloadSize;
+	header.payloadChecksum = updateCrc32(0, payload, payloadSize);
+
+	// written aside and renamed, so a crash never leaves a truncated cache behind
+	const std::string cacheFileName = getItemsCacheFileName(xmlFileName);
+	const std::string tempFileName = getCacheTempFileName(cacheFileName);
+	std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(payload, payloadSize);
+	file.close();
+
+	boost::system::error_code error;
+	if (file.fail()) {
+		SPDLOG_ERROR("[saveItemsCache] - Could not write {}", tempFileName);
+		boost::filesystem::remove(tempFileName, error);
+		return false;
+	}
+
+	boost::filesystem::rename(tempFileName, cacheFileName, error);
+	if (error) {
+		SPDLOG_ERROR("[saveItemsCache] - Could not replace {}: {}", cacheFileName, error.message());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_ITEMS_ITEMS_CACHE_HPP_
+#define SRC_ITEMS_ITEMS_CACHE_HPP_
+
+#include "items/items.h"
+
+/**
+ * Items cache: the item types as they are once appearances.dat and items.xml
+ * are loaded, written next to items.xml (or into cacheDirectory) after it is
+ * parsed and read back on the next boot instead of parsing it. It is only used while the size and
+ * checksum of both files match the ones it was built from, and is rebuilt
+ * otherwise. Records are stored in the byte order of the machine that built it.
+ */
+static constexpr uint32_t ITEMS_CACHE_VERSION = 1;
+
+std::string getItemsCacheFileName(const std::string& xmlFileName);
+
+// Replaces items with the cached types, false if there is no valid cache
+bool loadItemsCache(const std::string& xmlFileName, const std::string& appearancesFileName, std::vector<ItemType>& items);
+bool saveItemsCache(const std::string& xmlFileName, const std::string& appearancesFileName, const std::vector<ItemType>& items);
+
+#endif  // SRC_ITEMS_ITEMS_CACHE_HPP_
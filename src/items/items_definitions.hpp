@@ -349,6 +349,17 @@ enum TileFlags_t : uint32_t {
 	TILESTATE_IMMOVABLENOFIELDBLOCKPATH = 1 << 21,
 	TILESTATE_NOFIELDBLOCKPATH = 1 << 22,
 	TILESTATE_SUPPORTS_HANGABLE = 1 << 23,
+	// the position or an item of the tile has a move event fired from the tile, see MoveEvents::hasTileEvent
+	TILESTATE_MOVEEVENT = 1 << 24,
+
+	// set while any item of the tile has the matching item property, Tile::hasProperty reads them
+	TILESTATE_ITEM_PROPERTIES = TILESTATE_BLOCKSOLID |
+                                TILESTATE_BLOCKPATH |
+                                TILESTATE_IMMOVABLEBLOCKSOLID |
+                                TILESTATE_IMMOVABLEBLOCKPATH |
+                                TILESTATE_IMMOVABLENOFIELDBLOCKPATH |
+                                TILESTATE_NOFIELDBLOCKPATH |
+                                TILESTATE_SUPPORTS_HANGABLE,
 
 	TILESTATE_FLOORCHANGE = TILESTATE_FLOORCHANGE_DOWN |
                             TILESTATE_FLOORCHANGE_NORTH |
@@ -35,8 +35,64 @@
 StaticTile real_nullptr_tile(0xFFFF, 0xFFFF, 0xFF);
 Tile& Tile::nullptr_tile = real_nullptr_tile;
 
+bool MapArena::enabled = false;
+
+Arena& MapArena::getArena()
+{
+	// never destroyed, the map is torn down during static destruction and still frees into it
+	static Arena* arena = new Arena(1 << 20);
+	return *arena;
+}
+
+void* MapArena::allocate(size_t size)
+{
+	if (!enabled) {
+		return ::operator new(size);
+	}
+	return getArena().allocate(size, alignof(std::max_align_t));
+}
+
+void MapArena::deallocate(void* pointer)
+{
+	if (pointer && !getArena().owns(pointer)) {
+		::operator delete(pointer);
+	}
+}
+
+size_t MapArena::getReservedBytes()
+{
+	return getArena().getReservedBytes();
+}
+
+uint8_t Tile::getWalkFlags() const
+{
+	uint8_t walkFlags = TILE_WALK_EXISTS;
+	if (hasFlag(TILESTATE_BLOCKSOLID)) {
+		walkFlags |= TILE_WALK_BLOCKSOLID;
+	}
+	if (hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		walkFlags |= TILE_WALK_BLOCKPROJECTILE;
+	}
+	if (getThingCount() > 0) {
+		walkFlags |= TILE_WALK_HAS_THINGS;
+	}
+	return walkFlags;
+}
+
 bool Tile::hasProperty(ItemProperty prop) const
 {
+	// these are kept up to date in the tile flags as items come and go
+	switch (prop) {
+		case CONST_PROP_BLOCKSOLID: return hasFlag(TILESTATE_BLOCKSOLID);
+		case CONST_PROP_BLOCKPATH: return hasFlag(TILESTATE_BLOCKPATH);
+		case CONST_PROP_IMMOVABLEBLOCKSOLID: return hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID);
+		case CONST_PROP_IMMOVABLEBLOCKPATH: return hasFlag(TILESTATE_IMMOVABLEBLOCKPATH);
+		case CONST_PROP_IMMOVABLENOFIELDBLOCKPATH: return hasFlag(TILESTATE_IMMOVABLENOFIELDBLOCKPATH);
+		case CONST_PROP_NOFIELDBLOCKPATH: return hasFlag(TILESTATE_NOFIELDBLOCKPATH);
+		case CONST_PROP_SUPPORTHANGABLE: return hasFlag(TILESTATE_SUPPORTS_HANGABLE);
+		default: break;
+	}
+
 	if (ground && ground->hasProperty(prop)) {
 		return true;
 	}
@@ -332,7 +388,7 @@ Item* Tile::getItemByTopOrder(int32_t topOrder)
 	//4: creatures
 	if (TileItemVector* items = getItemList()) {
 		for (auto it = ItemVector::const_reverse_iterator(items->getEndTopItem()), end = ItemVector::const_reverse_iterator(items->getBeginTopItem()); it != end; ++it) {
-			if (Item::items[(*it)->getID()].alwaysOnTopOrder == topOrder) {
+			if (Item::items.getHotData((*it)->getID()).alwaysOnTopOrder == topOrder) {
 				return (*it);
 			}
 		}
@@ -350,15 +406,13 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
 	TileItemVector* items = getItemList();
 	if (items) {
 		for (ItemVector::const_iterator it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end; ++it) {
-			const ItemType& iit = Item::items[(*it)->getID()];
-			if (!iit.lookThrough) {
+			if (!Item::items.getHotData((*it)->getID()).hasFlag(ITEM_FLAG_LOOKTHROUGH)) {
 				return (*it);
 			}
 		}
 
 		for (auto it = ItemVector::const_reverse_iterator(items->getEndTopItem()), end = ItemVector::const_reverse_iterator(items->getBeginTopItem()); it != end; ++it) {
-			const ItemType& iit = Item::items[(*it)->getID()];
-			if (!iit.lookThrough) {
+			if (!Item::items.getHotData((*it)->getID()).hasFlag(ITEM_FLAG_LOOKTHROUGH)) {
 				return (*it);
 			}
 		}
@@ -369,6 +423,8 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
 
 void Tile::onAddTileItem(Item* item)
 {
+	resetDescriptionCache();
+
 	if ((item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) || (item->isWrapable() && !item->hasProperty(CONST_PROP_MOVEABLE) && !item->hasProperty(CONST_PROP_BLOCKPATH))) {
 		auto it = g_game().browseFields.find(this);
 		if (it != g_game().browseFields.end()) {
@@ -406,6 +462,8 @@ void Tile::onAddTileItem(Item* item)
 
 void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType)
 {
+	resetDescriptionCache();
+
 	if ((newItem->hasProperty(CONST_PROP_MOVEABLE) || newItem->getContainer()) || (newItem->isWrapable() && newItem->hasProperty(CONST_PROP_MOVEABLE) && !oldItem->hasProperty(CONST_PROP_BLOCKPATH))) {
 		auto it = g_game().browseFields.find(this);
 		if (it != g_game().browseFields.end()) {
@@ -440,10 +498,23 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 	for (Creature* spectator : spectators) {
 		spectator->onUpdateTileItem(this, cylinderMapPos, oldItem, oldType, newItem, newType);
 	}
+
+	// a transformed item can start or stop being cleanable
+	bool cleanable = newItem->isCleanable();
+	if (oldItem != newItem && oldItem->isCleanable() != cleanable && !dynamic_cast<HouseTile*>(this)
+			&& (!hasFlag(TILESTATE_PROTECTIONZONE) || g_configManager().getBoolean(CLEAN_PROTECTION_ZONES))) {
+		if (cleanable) {
+			g_game().addTileToClean(this);
+		} else {
+			g_game().removeTileToClean(this);
+		}
+	}
 }
 
 void Tile::onRemoveTileItem(const SpectatorHashSet& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item)
 {
+	resetDescriptionCache();
+
 	if ((item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) || (item->isWrapable() && !item->hasProperty(CONST_PROP_MOVEABLE) && !item->hasProperty(CONST_PROP_BLOCKPATH))) {
 		auto it = g_game().browseFields.find(this);
 		if (it != g_game().browseFields.end()) {
@@ -469,22 +540,11 @@ void Tile::onRemoveTileItem(const SpectatorHashSet& spectators, const std::vecto
 		spectator->onRemoveTileItem(this, cylinderMapPos, iType, item);
 	}
 
-  if (!hasFlag(TILESTATE_PROTECTIONZONE) || g_configManager().getBoolean(CLEAN_PROTECTION_ZONES)) {
+	if (!hasFlag(TILESTATE_PROTECTIONZONE) || g_configManager().getBoolean(CLEAN_PROTECTION_ZONES)) {
 		auto items = getItemList();
 		if (!items || items->empty()) {
-			g_game().removeTileToClean(this);
-			return;
-		}
-
-		bool ret = false;
-		for (auto toCheck : *items) {
-			if (toCheck->isCleanable()) {
-				ret = true;
-				break;
-			}
-		}
-
-		if (!ret) {
+			g_game().forgetTileToClean(this);
+		} else if (item->isCleanable()) {
 			g_game().removeTileToClean(this);
 		}
 	}
@@ -648,16 +708,16 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t tileF
 		} else {
 			//FLAG_IGNOREBLOCKITEM is set
 			if (ground) {
-				const ItemType& iiType = Item::items[ground->getID()];
-				if (iiType.blockSolid && (!iiType.moveable || ground->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
+				const ItemTypeHotData& iiType = Item::items.getHotData(ground->getID());
+				if (iiType.hasFlag(ITEM_FLAG_BLOCKSOLID) && (!iiType.hasFlag(ITEM_FLAG_MOVEABLE) || ground->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
 					return RETURNVALUE_NOTPOSSIBLE;
 				}
 			}
 
 			if (const auto items = getItemList()) {
 				for (const Item* item : *items) {
-					const ItemType& iiType = Item::items[item->getID()];
-					if (iiType.blockSolid && (!iiType.moveable || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
+					const ItemTypeHotData& iiType = Item::items.getHotData(item->getID());
+					if (iiType.hasFlag(ITEM_FLAG_BLOCKSOLID) && (!iiType.hasFlag(ITEM_FLAG_MOVEABLE) || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID))) {
 						return RETURNVALUE_NOTPOSSIBLE;
 					}
 				}
@@ -697,14 +757,14 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t tileF
 			}
 		} else {
 			if (ground) {
-				const ItemType& iiType = Item::items[ground->getID()];
-				if (iiType.blockSolid) {
-					if (!iiType.allowPickupable || item->isMagicField() || item->isBlocking()) {
+				const ItemTypeHotData& iiType = Item::items.getHotData(ground->getID());
+				if (iiType.hasFlag(ITEM_FLAG_BLOCKSOLID)) {
+					if (!iiType.hasFlag(ITEM_FLAG_ALLOWPICKUPABLE) || item->isMagicField() || item->isBlocking()) {
 						if (!item->isPickupable()) {
 							return RETURNVALUE_NOTENOUGHROOM;
 						}
 
-						if (!iiType.hasHeight || iiType.pickupable || iiType.isBed()) {
+						if (!iiType.hasFlag(ITEM_FLAG_HASHEIGHT) || iiType.hasFlag(ITEM_FLAG_PICKUPABLE | ITEM_FLAG_BED)) {
 							return RETURNVALUE_NOTENOUGHROOM;
 						}
 					}
@@ -713,12 +773,12 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t tileF
 
 			if (items) {
 				for (const Item* tileItem : *items) {
-					const ItemType& iiType = Item::items[tileItem->getID()];
-					if (!iiType.blockSolid) {
+					const ItemTypeHotData& iiType = Item::items.getHotData(tileItem->getID());
+					if (!iiType.hasFlag(ITEM_FLAG_BLOCKSOLID)) {
 						continue;
 					}
 
-					if (iiType.allowPickupable && !item->isMagicField() && !item->isBlocking()) {
+					if (iiType.hasFlag(ITEM_FLAG_ALLOWPICKUPABLE) && !item->isMagicField() && !item->isBlocking()) {
 						continue;
 					}
 
@@ -726,7 +786,7 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t tileF
 						return RETURNVALUE_NOTENOUGHROOM;
 					}
 
-					if (!iiType.hasHeight || iiType.pickupable || iiType.isBed()) {
+					if (!iiType.hasFlag(ITEM_FLAG_HASHEIGHT) || iiType.hasFlag(ITEM_FLAG_PICKUPABLE | ITEM_FLAG_BED)) {
 						return RETURNVALUE_NOTENOUGHROOM;
 					}
 				}
@@ -871,10 +931,11 @@ void Tile::addThing(int32_t, Thing* thing)
 {
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game().map.clearSpectatorCache();
+		g_game().map.invalidateSpectatorCache(tilePos);
 		creature->setParent(this);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
+		g_game().map.updateTileWalkFlags(*this);
 	} else {
 		Item* item = thing->getItem();
 		if (item == nullptr) {
@@ -927,7 +988,7 @@ void Tile::addThing(int32_t, Thing* thing)
 			if (items) {
 				for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
 					//Note: this is different from internalAddThing
-					if (itemType.alwaysOnTopOrder <= Item::items[(*it)->getID()].alwaysOnTopOrder) {
+					if (itemType.alwaysOnTopOrder <= Item::items.getHotData((*it)->getID()).alwaysOnTopOrder) {
 						items->insert(it, item);
 						isInserted = true;
 						break;
@@ -1076,8 +1137,9 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		if (creatures) {
 			auto it = std::find(creatures->begin(), creatures->end(), thing);
 			if (it != creatures->end()) {
-				g_game().map.clearSpectatorCache();
+				g_game().map.invalidateSpectatorCache(tilePos);
 				creatures->erase(it);
+				g_game().map.updateTileWalkFlags(*this);
 			}
 		}
 		return;
@@ -1157,6 +1219,66 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 	}
 }
 
+void Tile::removeCleanableItems(std::vector<Item*>& removedItems)
+{
+	TileItemVector* items = getItemList();
+	if (!items) {
+		return;
+	}
+
+	const size_t firstRemoved = removedItems.size();
+	auto browseField = g_game().browseFields.find(this);
+	for (auto it = items->begin(); it != items->end();) {
+		Item* item = *it;
+		if (!item->isCleanable()) {
+			++it;
+			continue;
+		}
+
+		if (browseField != g_game().browseFields.end()) {
+			browseField->second->removeThing(item, item->getItemCount());
+		}
+
+		if (it < items->getEndDownItem()) {
+			items->decreaseDownItemCount();
+		}
+		it = items->erase(it);
+		item->setParent(nullptr);
+		resetTileFlags(item);
+		removedItems.push_back(item);
+	}
+
+	if (removedItems.size() == firstRemoved) {
+		return;
+	}
+
+	resetDescriptionCache();
+
+	SpectatorHashSet spectators;
+	g_game().map.getSpectators(spectators, tilePos, true);
+
+	SpectatorHashSet players;
+	for (Creature* spectator : spectators) {
+		if (spectator->getPlayer()) {
+			players.insert(spectator);
+		}
+	}
+	onUpdateTile(players);
+
+	for (size_t i = firstRemoved; i < removedItems.size(); ++i) {
+		Item* item = removedItems[i];
+		const ItemType& itemType = Item::items[item->getID()];
+		for (Creature* spectator : spectators) {
+			spectator->onRemoveTileItem(this, tilePos, itemType, item);
+		}
+		// what postRemoveNotification does for each item, without its tile update
+		for (Creature* player : players) {
+			player->getPlayer()->postRemoveNotification(item, nullptr, 0, LINK_NEAR);
+		}
+		g_moveEvents().onItemMove(*item, *this, false);
+	}
+}
+
 void Tile::removeCreature(Creature* creature)
 {
 	g_game().map.getQTNode(tilePos.x, tilePos.y)->removeCreature(creature);
@@ -1498,15 +1620,18 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game().map.clearSpectatorCache();
+		g_game().map.invalidateSpectatorCache(tilePos);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
+		g_game().map.updateTileWalkFlags(*this);
 	} else {
 		Item* item = thing->getItem();
 		if (item == nullptr) {
 			return;
 		}
 
+		resetDescriptionCache();
+
 		const ItemType& itemType = Item::items[item->getID()];
 		if (itemType.isGroundTile()) {
 			if (ground == nullptr) {
@@ -1524,7 +1649,7 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 		if (item->isAlwaysOnTop()) {
 			bool isInserted = false;
 			for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
-				if (Item::items[(*it)->getID()].alwaysOnTopOrder > itemType.alwaysOnTopOrder) {
+				if (Item::items.getHotData((*it)->getID()).alwaysOnTopOrder > itemType.alwaysOnTopOrder) {
 					items->insert(it, item);
 					isInserted = true;
 					break;
@@ -1545,6 +1670,8 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 void Tile::setTileFlags(const Item* item)
 {
+	g_game().map.updateTileGeneration(tilePos);
+
 	if (!hasFlag(TILESTATE_FLOORCHANGE)) {
 		const ItemType& it = Item::items[item->getID()];
 		if (it.floorChange != 0) {
@@ -1552,21 +1679,7 @@ void Tile::setTileFlags(const Item* item)
 		}
 	}
 
-	if (item->hasProperty(CONST_PROP_IMMOVABLEBLOCKSOLID)) {
-		setFlag(TILESTATE_IMMOVABLEBLOCKSOLID);
-	}
-
-	if (item->hasProperty(CONST_PROP_BLOCKPATH)) {
-		setFlag(TILESTATE_BLOCKPATH);
-	}
-
-	if (item->hasProperty(CONST_PROP_NOFIELDBLOCKPATH)) {
-		setFlag(TILESTATE_NOFIELDBLOCKPATH);
-	}
-
-	if (item->hasProperty(CONST_PROP_IMMOVABLENOFIELDBLOCKPATH)) {
-		setFlag(TILESTATE_IMMOVABLENOFIELDBLOCKPATH);
-	}
+	setFlag(getItemPropertyFlags(item));
 
 	if (item->getTeleport()) {
 		setFlag(TILESTATE_TELEPORT);
@@ -1584,10 +1697,6 @@ void Tile::setTileFlags(const Item* item)
 		setFlag(TILESTATE_TRASHHOLDER);
 	}
 
-	if (item->hasProperty(CONST_PROP_BLOCKSOLID)) {
-		setFlag(TILESTATE_BLOCKSOLID);
-	}
-
 	if (item->getBed()) {
 		setFlag(TILESTATE_BED);
 	}
@@ -1597,40 +1706,38 @@ void Tile::setTileFlags(const Item* item)
 		setFlag(TILESTATE_DEPOT);
 	}
 
-	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
-		setFlag(TILESTATE_SUPPORTS_HANGABLE);
+	if (!hasFlag(TILESTATE_MOVEEVENT) && (g_moveEvents().hasTileEvent(*item) || g_moveEvents().hasTileEvent(tilePos))) {
+		setFlag(TILESTATE_MOVEEVENT);
 	}
+
+	g_game().map.updateTileWalkFlags(*this);
 }
 
 void Tile::resetTileFlags(const Item* item)
 {
+	g_game().map.updateTileGeneration(tilePos);
+
 	const ItemType& it = Item::items[item->getID()];
 	if (it.floorChange != 0) {
 		resetFlag(TILESTATE_FLOORCHANGE);
 	}
 
-	if (item->hasProperty(CONST_PROP_BLOCKSOLID) && !hasProperty(item, CONST_PROP_BLOCKSOLID)) {
-		resetFlag(TILESTATE_BLOCKSOLID);
-	}
-
-	if (item->hasProperty(CONST_PROP_IMMOVABLEBLOCKSOLID) && !hasProperty(item, CONST_PROP_IMMOVABLEBLOCKSOLID)) {
-		resetFlag(TILESTATE_IMMOVABLEBLOCKSOLID);
-	}
-
-	if (item->hasProperty(CONST_PROP_BLOCKPATH) && !hasProperty(item, CONST_PROP_BLOCKPATH)) {
-		resetFlag(TILESTATE_BLOCKPATH);
-	}
-
-	if (item->hasProperty(CONST_PROP_NOFIELDBLOCKPATH) && !hasProperty(item, CONST_PROP_NOFIELDBLOCKPATH)) {
-		resetFlag(TILESTATE_NOFIELDBLOCKPATH);
-	}
-
-	if (item->hasProperty(CONST_PROP_IMMOVABLEBLOCKPATH) && !hasProperty(item, CONST_PROP_IMMOVABLEBLOCKPATH)) {
-		resetFlag(TILESTATE_IMMOVABLEBLOCKPATH);
-	}
+	// one pass over the other items, stopping once all the item's properties are still given
+	uint32_t removedFlags = getItemPropertyFlags(item);
+	if (removedFlags != 0) {
+		uint32_t remainingFlags = 0;
+		if (ground && ground != item) {
+			remainingFlags |= getItemPropertyFlags(ground);
+		}
 
-	if (item->hasProperty(CONST_PROP_IMMOVABLENOFIELDBLOCKPATH) && !hasProperty(item, CONST_PROP_IMMOVABLENOFIELDBLOCKPATH)) {
-		resetFlag(TILESTATE_IMMOVABLENOFIELDBLOCKPATH);
+		if (const TileItemVector* items = getItemList()) {
+			for (auto it = items->begin(), end = items->end(); it != end && (remainingFlags & removedFlags) != removedFlags; ++it) {
+				if (*it != item) {
+					remainingFlags |= getItemPropertyFlags(*it);
+				}
+			}
+		}
+		resetFlag(removedFlags & ~remainingFlags);
 	}
 
 	if (item->getTeleport()) {
@@ -1658,9 +1765,68 @@ void Tile::resetTileFlags(const Item* item)
 		resetFlag(TILESTATE_DEPOT);
 	}
 
-	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
-		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
+	if (hasFlag(TILESTATE_MOVEEVENT) && g_moveEvents().hasTileEvent(*item)) {
+		updateMoveEventFlag(item);
+	}
+
+	g_game().map.updateTileWalkFlags(*this);
+}
+
+void Tile::updateMoveEventFlag(const Item* ignoredItem)
+{
+	bool hasEvent = g_moveEvents().hasTileEvent(tilePos);
+	if (!hasEvent && ground && ground != ignoredItem) {
+		hasEvent = g_moveEvents().hasTileEvent(*ground);
+	}
+
+	if (const TileItemVector* items = getItemList()) {
+		for (auto it = items->begin(), end = items->end(); !hasEvent && it != end; ++it) {
+			hasEvent = *it != ignoredItem && g_moveEvents().hasTileEvent(**it);
+		}
+	}
+
+	if (hasEvent) {
+		setFlag(TILESTATE_MOVEEVENT);
+	} else {
+		resetFlag(TILESTATE_MOVEEVENT);
+	}
+}
+
+uint32_t Tile::getItemPropertyFlags(const Item* item)
+{
+	// same rules as Item::hasProperty
+	const ItemTypeHotData& it = Item::items.getHotData(item->getID());
+	uint32_t flags = TILESTATE_NONE;
+	if (it.hasFlag(ITEM_FLAG_VERTICAL | ITEM_FLAG_HORIZONTAL)) {
+		flags |= TILESTATE_SUPPORTS_HANGABLE;
+	}
+
+	if (!it.hasFlag(ITEM_FLAG_BLOCKSOLID | ITEM_FLAG_BLOCKPATH)) {
+		return flags;
+	}
+
+	bool immovable = !it.hasFlag(ITEM_FLAG_MOVEABLE) || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+	if (it.hasFlag(ITEM_FLAG_BLOCKSOLID)) {
+		flags |= TILESTATE_BLOCKSOLID;
+		if (immovable) {
+			flags |= TILESTATE_IMMOVABLEBLOCKSOLID;
+		}
+	}
+
+	if (it.hasFlag(ITEM_FLAG_BLOCKPATH)) {
+		flags |= TILESTATE_BLOCKPATH;
+		if (immovable) {
+			flags |= TILESTATE_IMMOVABLEBLOCKPATH;
+		}
+
+		if (!it.hasFlag(ITEM_FLAG_MAGICFIELD)) {
+			flags |= TILESTATE_NOFIELDBLOCKPATH;
+			if (immovable) {
+				flags |= TILESTATE_IMMOVABLENOFIELDBLOCKPATH;
+			}
+		}
 	}
+	return flags;
 }
 
 bool Tile::isMoveableBlocking() const
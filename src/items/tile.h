@@ -23,6 +23,7 @@
 #include "items/cylinder.h"
 #include "declarations.hpp"
 #include "items/item.h"
+#include "utils/arena.hpp"
 #include "utils/tools.h"
 
 class Creature;
@@ -37,6 +38,14 @@ using CreatureVector = std::vector<Creature*>;
 using ItemVector = std::vector<Item*>;
 using SpectatorHashSet = phmap::flat_hash_set<Creature*>;
 
+// Summary of a tile kept by its Floor, so map scans can skip the item stack
+enum TileWalkFlags : uint8_t {
+	TILE_WALK_EXISTS = 1 << 0,
+	TILE_WALK_BLOCKSOLID = 1 << 1,
+	TILE_WALK_BLOCKPROJECTILE = 1 << 2,
+	TILE_WALK_HAS_THINGS = 1 << 3,
+};
+
 class TileItemVector : private ItemVector
 {
 	public:
@@ -111,6 +120,57 @@ class TileItemVector : private ItemVector
 		uint32_t downItemCount = 0;
 };
 
+/**
+ * Tiles and floors created while a map file loads are placed in one arena
+ * instead of a heap block each: a load creates millions of them in a row and
+ * they live as long as the map. Arena memory is only returned with the process,
+ * deleting an object from it runs its destructor and nothing else.
+ */
+class MapArena
+{
+	public:
+		static void* allocate(size_t size);
+		static void deallocate(void* pointer);
+
+		static size_t getReservedBytes();
+
+		// enables the arena while it lives, loading thread only
+		struct Scope {
+			Scope() {
+				enabled = true;
+			}
+			~Scope() {
+				enabled = false;
+			}
+		};
+
+	private:
+		static Arena& getArena();
+
+		static bool enabled;
+};
+
+/**
+ * Item stack of a tile as ProtocolGame::GetTileDescription encodes it, so map
+ * descriptions copy the bytes instead of encoding every item for every viewer.
+ * Holds the ground and top items followed by the down items, 10 items at most
+ * as that is all a client is sent. Creatures are per viewer and not part of it.
+ */
+struct TileDescriptionCache {
+	static constexpr size_t MAX_ITEMS = 10;
+	// an item is 5 bytes at most once items with timers, charges or podium looks are left out
+	static constexpr size_t MAX_BYTES = MAX_ITEMS * 5;
+
+	bool valid = false;
+	// false when an item of the stack is not cacheable, until the stack changes
+	bool cacheable = false;
+	uint8_t topItems = 0;
+	uint8_t downItems = 0;
+	// offsets[i] is where item i starts, offsets[topItems + downItems] the end
+	std::array<uint8_t, MAX_ITEMS + 1> offsets;
+	std::array<uint8_t, MAX_BYTES> bytes;
+};
+
 class Tile : public Cylinder
 {
 	public:
@@ -124,6 +184,15 @@ class Tile : public Cylinder
 		Tile(const Tile&) = delete;
 		Tile& operator=(const Tile&) = delete;
 
+		static void* operator new(size_t size) {
+			MemoryAccounting::allocate(MEMORY_TAG_TILE, size);
+			return MapArena::allocate(size);
+		}
+		static void operator delete(void* pointer, size_t size) {
+			MemoryAccounting::deallocate(MEMORY_TAG_TILE, size);
+			MapArena::deallocate(pointer);
+		}
+
 		virtual TileItemVector* getItemList() = 0;
 		virtual const TileItemVector* getItemList() const = 0;
 		virtual TileItemVector* makeItemList() = 0;
@@ -170,6 +239,8 @@ class Tile : public Cylinder
 
 		bool hasProperty(ItemProperty prop) const;
 		bool hasProperty(const Item* exclude, ItemProperty prop) const;
+		// TileWalkFlags describing the current state of this tile
+		uint8_t getWalkFlags() const;
 
 		bool hasFlag(uint32_t flag) const {
 			return hasBitSet(flag, this->flags);
@@ -220,6 +291,11 @@ class Tile : public Cylinder
 		void removeThing(Thing* thing, uint32_t count) override final;
 
 		void removeCreature(Creature* creature);
+		/**
+		 * Takes every cleanable item off the tile and appends it to removedItems.
+		 * The clients get one tile update instead of one removal per item.
+		 */
+		void removeCleanableItems(std::vector<Item*>& removedItems);
 
 		int32_t getThingIndex(const Thing* thing) const override final;
 		size_t getFirstIndex() const override final;
@@ -249,7 +325,24 @@ class Tile : public Cylinder
 		}
 		void setGround(Item* item) {
 			ground = item;
+			resetDescriptionCache();
+		}
+
+		// Cached encoding of the item stack, filled by ProtocolGame. Dispatcher thread only
+		TileDescriptionCache& getDescriptionCache() const {
+			if (!descriptionCache) {
+				descriptionCache = std::make_unique<TileDescriptionCache>();
+			}
+			return *descriptionCache;
+		}
+		// Called on every change to the item stack or to how one of its items is encoded
+		void resetDescriptionCache() {
+			if (descriptionCache) {
+				descriptionCache->valid = false;
+			}
 		}
+		// Recomputes TILESTATE_MOVEEVENT from the position and every item but ignoredItem
+		void updateMoveEventFlag(const Item* ignoredItem = nullptr);
 
 	private:
 		void onAddTileItem(Item* item);
@@ -259,11 +352,15 @@ class Tile : public Cylinder
 
 		void setTileFlags(const Item* item);
 		void resetTileFlags(const Item* item);
+		// the TILESTATE_ITEM_PROPERTIES flags the item gives to its tile
+		static uint32_t getItemPropertyFlags(const Item* item);
 
 	protected:
 		Item* ground = nullptr;
 		Position tilePos;
 		uint32_t flags = 0;
+		// created the first time the tile is described to a client
+		mutable std::unique_ptr<TileDescriptionCache> descriptionCache;
 };
 
 // Used for walkable tiles, where there is high likeliness of
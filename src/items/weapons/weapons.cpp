@@ -61,6 +61,20 @@ void Weapons::clear(bool fromLua)
 	reInitState(fromLua);
 }
 
+size_t Weapons::clearFile(const std::string& file)
+{
+	size_t count = 0;
+	for (auto it = weapons.begin(); it != weapons.end(); ) {
+		if (it->second->fromLua && it->second->getSourceFile() == file) {
+			it = weapons.erase(it);
+			++count;
+		} else {
+			++it;
+		}
+	}
+	return count;
+}
+
 LuaScriptInterface& Weapons::getScriptInterface()
 {
 	return scriptInterface;
@@ -547,7 +561,7 @@ bool Weapon::executeUseWeapon(Player* player, const LuaVariant& var) const
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	scriptInterface->pushVariant(L, var);
 
 	return scriptInterface->callFunction(2);
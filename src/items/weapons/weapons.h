@@ -59,6 +59,7 @@ class Weapons final : public BaseEvents
 
 		bool registerLuaEvent(Weapon* event);
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 
 	private:
 		LuaScriptInterface& getScriptInterface() override;
@@ -39,7 +39,7 @@ Actions::~Actions() {
 void Actions::clearMap(ActionUseMap& map, bool fromLua) {
 	for (auto it = map.begin(); it != map.end(); ) {
 		if (fromLua == it->second.fromLua) {
-			it = map.erase(it);
+			map.erase(it++);
 		} else {
 			++it;
 		}
@@ -63,6 +63,10 @@ void Actions::clear(bool fromLua) {
 	reInitState(fromLua);
 }
 
+size_t Actions::clearFile(const std::string& file) {
+	return clearFileMap(useItemMap, file) + clearFileMap(uniqueItemMap, file) + clearFileMap(actionItemMap, file) + clearFileMap(actionPositionMap, file);
+}
+
 LuaScriptInterface& Actions::getScriptInterface() {
 	return scriptInterface;
 }
@@ -383,7 +387,8 @@ Action* Actions::getAction(const Item* item) {
 	}
 
 
-	if (auto iteratePositions = actionPositionMap.find(item->getPosition());
+	// positions are rare, skip resolving the item position when there are none
+	if (auto iteratePositions = actionPositionMap.empty() ? actionPositionMap.end() : actionPositionMap.find(item->getPosition());
 	iteratePositions != actionPositionMap.end())
 	{
 		if (const Tile * tile = item->getTile();
@@ -446,6 +451,18 @@ ReturnValue Actions::internalUseItem(Player* player, const Position& pos, uint8_
 
 		//depot container
 		if (DepotLocker* depot = container->getDepotLocker()) {
+			if (!player->isDepotLoaded()) {
+				// opened again once the depot is read, if the player is still at the locker
+				item->incrementReferenceCounter();
+				player->loadDepot([pos, index, item, isHotkey](Player* loadedPlayer) {
+					if (loadedPlayer && !item->isRemoved() && Position::areInRange<1, 1, 0>(loadedPlayer->getPosition(), item->getPosition())) {
+						g_actions().useItem(loadedPlayer, pos, index, item, isHotkey);
+					}
+					item->decrementReferenceCounter();
+				});
+				return RETURNVALUE_NOERROR;
+			}
+
 			DepotLocker* myDepotLocker = player->getDepotLocker(depot->getDepotId());
 			myDepotLocker->setParent(depot->getParent()->getTile());
 			openContainer = myDepotLocker;
@@ -675,7 +692,7 @@ bool Action::executeUse(Player* player, Item* item, const Position& fromPosition
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushPosition(L, fromPosition);
@@ -161,6 +161,7 @@ class Actions final : public BaseEvents {
 		bool registerLuaPositionEvent(Action* action);
 		bool registerLuaEvent(Action* event);
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 
 	private:
 		bool hasPosition(Position position) const {
@@ -228,7 +229,8 @@ class Actions final : public BaseEvents {
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
 
-		using ActionUseMap = std::map<uint16_t, Action>;
+		// looked up for every used item, ids have no order worth keeping
+		using ActionUseMap = phmap::flat_hash_map<uint16_t, Action>;
 		ActionUseMap useItemMap;
 		ActionUseMap uniqueItemMap;
 		ActionUseMap actionItemMap;
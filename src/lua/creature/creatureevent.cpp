@@ -38,6 +38,18 @@ void CreatureEvents::clear(bool fromLua) {
 	reInitState(fromLua);
 }
 
+size_t CreatureEvents::clearFile(const std::string& file) {
+	// creatures keep pointers to their events, so the entries stay and get reused on register
+	size_t count = 0;
+	for (auto& [name, creatureEvent] : creatureEvents) {
+		if (creatureEvent.fromLua && creatureEvent.getSourceFile() == file) {
+			creatureEvent.clearEvent();
+			++count;
+		}
+	}
+	return count;
+}
+
 LuaScriptInterface& CreatureEvents::getScriptInterface() {
 	return scriptInterface;
 }
@@ -257,6 +269,7 @@ std::string CreatureEvent::getScriptEventName() const {
 void CreatureEvent::copyEvent(CreatureEvent* creatureEvent) {
 	scriptId = creatureEvent->scriptId;
 	scriptInterface = creatureEvent->scriptInterface;
+	sourceFile = creatureEvent->sourceFile;
 	scripted = creatureEvent->scripted;
 	loaded = creatureEvent->loaded;
 }
@@ -284,7 +297,7 @@ bool CreatureEvent::executeOnLogin(Player* player) const {
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -304,7 +317,7 @@ bool CreatureEvent::executeOnLogout(Player* player) const {
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -416,7 +429,7 @@ bool CreatureEvent::executeAdvance(Player* player, skills_t skill, uint32_t oldL
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	lua_pushnumber(L, static_cast<uint32_t>(skill));
 	lua_pushnumber(L, oldLevel);
 	lua_pushnumber(L, newLevel);
@@ -464,7 +477,7 @@ void CreatureEvent::executeModalWindow(Player* player, uint32_t modalWindowId, u
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, modalWindowId);
 	lua_pushnumber(L, buttonId);
@@ -489,7 +502,7 @@ bool CreatureEvent::executeTextEdit(Player* player, Item* item, const std::strin
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushString(L, text);
@@ -600,7 +613,7 @@ void CreatureEvent::executeExtendedOpcode(Player* player, uint8_t opcode, const
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, opcode);
 	LuaScriptInterface::pushString(L, buffer);
@@ -103,6 +103,7 @@ class CreatureEvents final : public BaseEvents {
 		bool registerLuaEvent(CreatureEvent* event);
 		void removeInvalidEvents();
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 
 	private:
 		LuaScriptInterface& getScriptInterface() override;
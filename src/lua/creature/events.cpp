@@ -24,9 +24,57 @@
 #include "items/item.h"
 #include "creatures/players/player.h"
 
+namespace {
+
+struct EventHookMethod {
+	const char* className;
+	const char* methodName;
+	EventHook_t hook;
+};
+
+constexpr EventHookMethod eventHookMethods[] = {
+	{"Creature", "onChangeOutfit", EVENT_HOOK_CREATURE_ON_CHANGE_OUTFIT},
+	{"Creature", "onAreaCombat", EVENT_HOOK_CREATURE_ON_AREA_COMBAT},
+	{"Creature", "onTargetCombat", EVENT_HOOK_CREATURE_ON_TARGET_COMBAT},
+	{"Creature", "onHear", EVENT_HOOK_CREATURE_ON_HEAR},
+	{"Creature", "onDrainHealth", EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH},
+	{"Party", "onJoin", EVENT_HOOK_PARTY_ON_JOIN},
+	{"Party", "onLeave", EVENT_HOOK_PARTY_ON_LEAVE},
+	{"Party", "onDisband", EVENT_HOOK_PARTY_ON_DISBAND},
+	{"Party", "onShareExperience", EVENT_HOOK_PARTY_ON_SHARE_EXPERIENCE},
+	{"Player", "onBrowseField", EVENT_HOOK_PLAYER_ON_BROWSE_FIELD},
+	{"Player", "onLook", EVENT_HOOK_PLAYER_ON_LOOK},
+	{"Player", "onLookInBattleList", EVENT_HOOK_PLAYER_ON_LOOK_IN_BATTLE_LIST},
+	{"Player", "onLookInTrade", EVENT_HOOK_PLAYER_ON_LOOK_IN_TRADE},
+	{"Player", "onLookInShop", EVENT_HOOK_PLAYER_ON_LOOK_IN_SHOP},
+	{"Player", "onTradeRequest", EVENT_HOOK_PLAYER_ON_TRADE_REQUEST},
+	{"Player", "onTradeAccept", EVENT_HOOK_PLAYER_ON_TRADE_ACCEPT},
+	{"Player", "onMoveItem", EVENT_HOOK_PLAYER_ON_MOVE_ITEM},
+	{"Player", "onItemMoved", EVENT_HOOK_PLAYER_ON_ITEM_MOVED},
+	{"Player", "onChangeZone", EVENT_HOOK_PLAYER_ON_CHANGE_ZONE},
+	{"Player", "onMoveCreature", EVENT_HOOK_PLAYER_ON_MOVE_CREATURE},
+	{"Player", "onReportRuleViolation", EVENT_HOOK_PLAYER_ON_REPORT_RULE_VIOLATION},
+	{"Player", "onReportBug", EVENT_HOOK_PLAYER_ON_REPORT_BUG},
+	{"Player", "onTurn", EVENT_HOOK_PLAYER_ON_TURN},
+	{"Player", "onGainExperience", EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE},
+	{"Player", "onLoseExperience", EVENT_HOOK_PLAYER_ON_LOSE_EXPERIENCE},
+	{"Player", "onGainSkillTries", EVENT_HOOK_PLAYER_ON_GAIN_SKILL_TRIES},
+	{"Player", "onRequestQuestLog", EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LOG},
+	{"Player", "onRequestQuestLine", EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LINE},
+	{"Player", "onStorageUpdate", EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE},
+	{"Player", "onRemoveCount", EVENT_HOOK_PLAYER_ON_REMOVE_COUNT},
+	{"Player", "onCombat", EVENT_HOOK_PLAYER_ON_COMBAT},
+	{"Monster", "onDropLoot", EVENT_HOOK_MONSTER_ON_DROP_LOOT},
+	{"Monster", "onSpawn", EVENT_HOOK_MONSTER_ON_SPAWN},
+	{"Npc", "onSpawn", EVENT_HOOK_NPC_ON_SPAWN},
+};
+
+}  // namespace
+
 Events::Events() :
 	scriptInterface("Event Interface") {
 	scriptInterface.initState();
+	hooks.fill(-1);
 }
 
 bool Events::loadFromXml() {
@@ -37,7 +85,8 @@ bool Events::loadFromXml() {
 		return false;
 	}
 
-	info = {};
+	hooks.fill(-1);
+	hookMask = 0;
 
 	std::set<std::string> classes;
 	for (auto eventNode : doc.child("events").children()) {
@@ -56,97 +105,31 @@ bool Events::loadFromXml() {
 		}
 
 		const std::string& methodName = eventNode.attribute("method").as_string();
-		const int32_t event = scriptInterface.getMetaEvent(className, methodName);
-		if (className == "Creature") {
-			if (methodName == "onChangeOutfit") {
-				info.creatureOnChangeOutfit = event;
-			} else if (methodName == "onAreaCombat") {
-				info.creatureOnAreaCombat = event;
-			} else if (methodName == "onTargetCombat") {
-				info.creatureOnTargetCombat = event;
-			} else if (methodName == "onHear") {
-				info.creatureOnHear = event;
-			} else if (methodName == "onDrainHealth") {
-				info.creatureOnDrainHealth = event;
-			} else {
-				SPDLOG_WARN("[Events::load] - Unknown creature method: {}", methodName);
-			}
-		} else if (className == "Party") {
-			if (methodName == "onJoin") {
-				info.partyOnJoin = event;
-			} else if (methodName == "onLeave") {
-				info.partyOnLeave = event;
-			} else if (methodName == "onDisband") {
-				info.partyOnDisband = event;
-			} else if (methodName == "onShareExperience") {
-				info.partyOnShareExperience = event;
-			} else {
-				SPDLOG_WARN("[Events::load] - Unknown party method: {}", methodName);
-			}
-		} else if (className == "Player") {
-			if (methodName == "onBrowseField") {
-				info.playerOnBrowseField = event;
-			} else if (methodName == "onLook") {
-				info.playerOnLook = event;
-			} else if (methodName == "onLookInBattleList") {
-				info.playerOnLookInBattleList = event;
-			} else if (methodName == "onLookInTrade") {
-				info.playerOnLookInTrade = event;
-			} else if (methodName == "onLookInShop") {
-				info.playerOnLookInShop = event;
-			} else if (methodName == "onTradeRequest") {
-				info.playerOnTradeRequest = event;
-			} else if (methodName == "onTradeAccept") {
-				info.playerOnTradeAccept = event;
-			} else if (methodName == "onMoveItem") {
-				info.playerOnMoveItem = event;
-			} else if (methodName == "onItemMoved") {
-				info.playerOnItemMoved = event;
-			} else if (methodName == "onChangeZone") {
-				info.playerOnChangeZone = event;
-			} else if (methodName == "onMoveCreature") {
-				info.playerOnMoveCreature = event;
-			} else if (methodName == "onReportRuleViolation") {
-				info.playerOnReportRuleViolation = event;
-			} else if (methodName == "onReportBug") {
-				info.playerOnReportBug = event;
-			} else if (methodName == "onTurn") {
-				info.playerOnTurn = event;
-			} else if (methodName == "onGainExperience") {
-				info.playerOnGainExperience = event;
-			} else if (methodName == "onLoseExperience") {
-				info.playerOnLoseExperience = event;
-			} else if (methodName == "onGainSkillTries") {
-				info.playerOnGainSkillTries = event;
-			} else if (methodName == "onRequestQuestLog") {
-				info.playerOnRequestQuestLog = event;
-			} else if (methodName == "onRequestQuestLine") {
-				info.playerOnRequestQuestLine = event;
-			} else if (methodName == "onStorageUpdate") {
-				info.playerOnStorageUpdate = event;
-			} else if (methodName == "onRemoveCount") {
-				info.playerOnRemoveCount = event;
-			}else if (methodName == "onCombat") {
-				info.playerOnCombat = event;
-			} else {
-				SPDLOG_WARN("[Events::load] - Unknown player method: {}", methodName);
+		const EventHookMethod* hookMethod = nullptr;
+		bool knownClass = false;
+		for (const EventHookMethod& it : eventHookMethods) {
+			if (className == it.className) {
+				knownClass = true;
+				if (methodName == it.methodName) {
+					hookMethod = &it;
+					break;
+				}
 			}
-		} else if (className == "Monster") {
-			if (methodName == "onDropLoot") {
-				info.monsterOnDropLoot = event;
-			} else if (methodName == "onSpawn") {
-				info.monsterOnSpawn = event;
-			} else {
-				SPDLOG_WARN("[Events::load] - Unknown monster method: {}", methodName);
-			}
-		} else if (className == "Npc") {
-			if (methodName == "onSpawn") {
-				info.monsterOnSpawn = event;
+		}
+
+		if (!hookMethod) {
+			if (knownClass) {
+				SPDLOG_WARN("[Events::load] - Unknown {} method: {}", asLowerCaseString(className), methodName);
 			} else {
-				SPDLOG_WARN("[Events::load] - Unknown npc method: {}", methodName);
+				SPDLOG_WARN("[Events::load] - Unknown class: {}", className);
 			}
-		} else {
-			SPDLOG_WARN("[Events::load] - Unknown class: {}", className);
+			continue;
+		}
+
+		const int32_t event = scriptInterface.getMetaEvent(className, methodName);
+		hooks[hookMethod->hook] = event;
+		if (event != -1) {
+			hookMask |= uint64_t(1) << hookMethod->hook;
 		}
 	}
 	return true;
@@ -155,7 +138,7 @@ bool Events::loadFromXml() {
 // Monster
 void Events::eventMonsterOnSpawn(Monster* monster, const Position& position) {
 	// Monster:onSpawn(position) or Monster.onSpawn(self, position)
-	if (info.monsterOnSpawn == -1) {
+	if (!hasListener(EVENT_HOOK_MONSTER_ON_SPAWN)) {
 		return;
 	}
 
@@ -168,13 +151,13 @@ void Events::eventMonsterOnSpawn(Monster* monster, const Position& position) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.monsterOnSpawn, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_MONSTER_ON_SPAWN], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.monsterOnSpawn);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_MONSTER_ON_SPAWN]);
 
 	LuaScriptInterface::pushUserdata<Monster>(L, monster);
-	LuaScriptInterface::setMetatable(L, -1, "Monster");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 	LuaScriptInterface::pushPosition(L, position);
 
 	if (scriptInterface.protectedCall(L, 2, 1) != 0) {
@@ -189,7 +172,7 @@ void Events::eventMonsterOnSpawn(Monster* monster, const Position& position) {
 // Npc
 void Events::eventNpcOnSpawn(Npc* npc, const Position& position) {
 	// Npc:onSpawn(position) or Npc.onSpawn(self, position)
-	if (info.npcOnSpawn == -1) {
+	if (!hasListener(EVENT_HOOK_NPC_ON_SPAWN)) {
 		return;
 	}
 
@@ -202,13 +185,13 @@ void Events::eventNpcOnSpawn(Npc* npc, const Position& position) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.npcOnSpawn, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_NPC_ON_SPAWN], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.npcOnSpawn);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_NPC_ON_SPAWN]);
 
 	LuaScriptInterface::pushUserdata<Npc>(L, npc);
-	LuaScriptInterface::setMetatable(L, -1, "Npc");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Npc);
 	LuaScriptInterface::pushPosition(L, position);
 
 	if (scriptInterface.protectedCall(L, 2, 1) != 0) {
@@ -223,7 +206,7 @@ void Events::eventNpcOnSpawn(Npc* npc, const Position& position) {
 // Creature
 bool Events::eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& outfit) {
 	// Creature:onChangeOutfit(outfit) or Creature.onChangeOutfit(self, outfit)
-	if (info.creatureOnChangeOutfit == -1) {
+	if (!hasListener(EVENT_HOOK_CREATURE_ON_CHANGE_OUTFIT)) {
 		return true;
 	}
 
@@ -235,10 +218,10 @@ bool Events::eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& out
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnChangeOutfit, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_CREATURE_ON_CHANGE_OUTFIT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnChangeOutfit);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_CREATURE_ON_CHANGE_OUTFIT]);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -250,7 +233,7 @@ bool Events::eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& out
 
 ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bool aggressive) {
 	// Creature:onAreaCombat(tile, aggressive) or Creature.onAreaCombat(self, tile, aggressive)
-	if (info.creatureOnAreaCombat == -1) {
+	if (!hasListener(EVENT_HOOK_CREATURE_ON_AREA_COMBAT)) {
 		return RETURNVALUE_NOERROR;
 	}
 
@@ -266,10 +249,10 @@ ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bo
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnAreaCombat, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_CREATURE_ON_AREA_COMBAT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnAreaCombat);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_CREATURE_ON_AREA_COMBAT]);
 
 	if (creature) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -279,7 +262,7 @@ ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bo
 	}
 
 	LuaScriptInterface::pushUserdata<Tile>(L, tile);
-	LuaScriptInterface::setMetatable(L, -1, "Tile");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Tile);
 
 	LuaScriptInterface::pushBoolean(L, aggressive);
 
@@ -298,7 +281,7 @@ ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bo
 
 ReturnValue Events::eventCreatureOnTargetCombat(Creature* creature, Creature* target) {
 	// Creature:onTargetCombat(target) or Creature.onTargetCombat(self, target)
-	if (info.creatureOnTargetCombat == -1) {
+	if (!hasListener(EVENT_HOOK_CREATURE_ON_TARGET_COMBAT)) {
 		return RETURNVALUE_NOERROR;
 	}
 
@@ -311,10 +294,10 @@ ReturnValue Events::eventCreatureOnTargetCombat(Creature* creature, Creature* ta
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnTargetCombat, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_CREATURE_ON_TARGET_COMBAT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnTargetCombat);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_CREATURE_ON_TARGET_COMBAT]);
 
 	if (creature) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -341,7 +324,7 @@ ReturnValue Events::eventCreatureOnTargetCombat(Creature* creature, Creature* ta
 
 void Events::eventCreatureOnHear(Creature* creature, Creature* speaker, const std::string& words, SpeakClasses type) {
 	// Creature:onHear(speaker, words, type)
-	if (info.creatureOnHear == -1) {
+	if (!hasListener(EVENT_HOOK_CREATURE_ON_HEAR)) {
 		return;
 	}
 
@@ -354,10 +337,10 @@ void Events::eventCreatureOnHear(Creature* creature, Creature* speaker, const st
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnHear, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_CREATURE_ON_HEAR], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnHear);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_CREATURE_ON_HEAR]);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -372,7 +355,7 @@ void Events::eventCreatureOnHear(Creature* creature, Creature* speaker, const st
 }
 
 void Events::eventCreatureOnDrainHealth(Creature* creature, Creature* attacker, CombatType_t& typePrimary, int32_t& damagePrimary, CombatType_t& typeSecondary, int32_t& damageSecondary, TextColor_t& colorPrimary, TextColor_t& colorSecondary) {
-	if (info.creatureOnDrainHealth == -1) {
+	if (!hasListener(EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH)) {
 		return;
 	}
 
@@ -385,10 +368,10 @@ void Events::eventCreatureOnDrainHealth(Creature* creature, Creature* attacker,
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnDrainHealth, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnDrainHealth);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH]);
 
 	if (creature) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -429,7 +412,7 @@ void Events::eventCreatureOnDrainHealth(Creature* creature, Creature* attacker,
 // Party
 bool Events::eventPartyOnJoin(Party* party, Player* player) {
 	// Party:onJoin(player) or Party.onJoin(self, player)
-	if (info.partyOnJoin == -1) {
+	if (!hasListener(EVENT_HOOK_PARTY_ON_JOIN)) {
 		return true;
 	}
 
@@ -442,23 +425,23 @@ bool Events::eventPartyOnJoin(Party* party, Player* player) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnJoin, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PARTY_ON_JOIN], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnJoin);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PARTY_ON_JOIN]);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	return scriptInterface.callFunction(2);
 }
 
 bool Events::eventPartyOnLeave(Party* party, Player* player) {
 	// Party:onLeave(player) or Party.onLeave(self, player)
-	if (info.partyOnLeave == -1) {
+	if (!hasListener(EVENT_HOOK_PARTY_ON_LEAVE)) {
 		return true;
 	}
 
@@ -471,23 +454,23 @@ bool Events::eventPartyOnLeave(Party* party, Player* player) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnLeave, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PARTY_ON_LEAVE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnLeave);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PARTY_ON_LEAVE]);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	return scriptInterface.callFunction(2);
 }
 
 bool Events::eventPartyOnDisband(Party* party) {
 	// Party:onDisband() or Party.onDisband(self)
-	if (info.partyOnDisband == -1) {
+	if (!hasListener(EVENT_HOOK_PARTY_ON_DISBAND)) {
 		return true;
 	}
 
@@ -499,10 +482,10 @@ bool Events::eventPartyOnDisband(Party* party) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnDisband, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PARTY_ON_DISBAND], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnDisband);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PARTY_ON_DISBAND]);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
@@ -512,7 +495,7 @@ bool Events::eventPartyOnDisband(Party* party) {
 
 void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp) {
 	// Party:onShareExperience(exp) or Party.onShareExperience(self, exp)
-	if (info.partyOnShareExperience == -1) {
+	if (!hasListener(EVENT_HOOK_PARTY_ON_SHARE_EXPERIENCE)) {
 		return;
 	}
 
@@ -523,10 +506,10 @@ void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnShareExperience, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PARTY_ON_SHARE_EXPERIENCE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnShareExperience);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PARTY_ON_SHARE_EXPERIENCE]);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
@@ -546,7 +529,7 @@ void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp) {
 // Player
 bool Events::eventPlayerOnBrowseField(Player* player, const Position& position) {
 	// Player:onBrowseField(position) or Player.onBrowseField(self, position)
-	if (info.playerOnBrowseField == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_BROWSE_FIELD)) {
 		return true;
 	}
 
@@ -559,13 +542,13 @@ bool Events::eventPlayerOnBrowseField(Player* player, const Position& position)
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnBrowseField, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_BROWSE_FIELD], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnBrowseField);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_BROWSE_FIELD]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushPosition(L, position);
 
@@ -574,7 +557,7 @@ bool Events::eventPlayerOnBrowseField(Player* player, const Position& position)
 
 void Events::eventPlayerOnLook(Player* player, const Position& position, Thing* thing, uint8_t stackpos, int32_t lookDistance) {
 	// Player:onLook(thing, position, distance) or Player.onLook(self, thing, position, distance)
-	if (info.playerOnLook == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_LOOK)) {
 		return;
 	}
 
@@ -587,13 +570,13 @@ void Events::eventPlayerOnLook(Player* player, const Position& position, Thing*
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLook, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_LOOK], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLook);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_LOOK]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	if (Creature* creature = thing->getCreature()) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -613,7 +596,7 @@ void Events::eventPlayerOnLook(Player* player, const Position& position, Thing*
 
 void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, int32_t lookDistance) {
 	// Player:onLookInBattleList(creature, position, distance) or Player.onLookInBattleList(self, creature, position, distance)
-	if (info.playerOnLookInBattleList == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_LOOK_IN_BATTLE_LIST)) {
 		return;
 	}
 
@@ -626,13 +609,13 @@ void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, i
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInBattleList, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_BATTLE_LIST], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInBattleList);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_BATTLE_LIST]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -644,7 +627,7 @@ void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, i
 
 void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* item, int32_t lookDistance) {
 	// Player:onLookInTrade(partner, item, distance) or Player.onLookInTrade(self, partner, item, distance)
-	if (info.playerOnLookInTrade == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_LOOK_IN_TRADE)) {
 		return;
 	}
 
@@ -657,16 +640,16 @@ void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* ite
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInTrade, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_TRADE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInTrade);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_TRADE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Player>(L, partner);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -678,7 +661,7 @@ void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* ite
 
 bool Events::eventPlayerOnLookInShop(Player* player, const ItemType* itemType, uint8_t count) {
 	// Player:onLookInShop(itemType, count) or Player.onLookInShop(self, itemType, count)
-	if (info.playerOnLookInShop == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_LOOK_IN_SHOP)) {
 		return true;
 	}
 
@@ -691,13 +674,13 @@ bool Events::eventPlayerOnLookInShop(Player* player, const ItemType* itemType, u
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInShop, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_SHOP], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInShop);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_LOOK_IN_SHOP]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<const ItemType>(L, itemType);
 	LuaScriptInterface::setMetatable(L, -1, "ItemType");
@@ -709,7 +692,7 @@ bool Events::eventPlayerOnLookInShop(Player* player, const ItemType* itemType, u
 
 bool Events::eventPlayerOnRemoveCount(Player* player, Item* item) {
 	// Player:onMove()
-	if (info.playerOnRemoveCount == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_REMOVE_COUNT)) {
 		return true;
 	}
 
@@ -722,13 +705,13 @@ bool Events::eventPlayerOnRemoveCount(Player* player, Item* item) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnRemoveCount, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_REMOVE_COUNT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnRemoveCount);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_REMOVE_COUNT]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -738,7 +721,7 @@ bool Events::eventPlayerOnRemoveCount(Player* player, Item* item) {
 
 bool Events::eventPlayerOnMoveItem(Player* player, Item* item, uint16_t count, const Position& fromPosition, const Position& toPosition, Cylinder* fromCylinder, Cylinder* toCylinder) {
 	// Player:onMoveItem(item, count, fromPosition, toPosition) or Player.onMoveItem(self, item, count, fromPosition, toPosition, fromCylinder, toCylinder)
-	if (info.playerOnMoveItem == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_MOVE_ITEM)) {
 		return true;
 	}
 
@@ -751,13 +734,13 @@ bool Events::eventPlayerOnMoveItem(Player* player, Item* item, uint16_t count, c
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnMoveItem, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_MOVE_ITEM], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnMoveItem);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_MOVE_ITEM]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -774,7 +757,7 @@ bool Events::eventPlayerOnMoveItem(Player* player, Item* item, uint16_t count, c
 
 void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count, const Position& fromPosition, const Position& toPosition, Cylinder* fromCylinder, Cylinder* toCylinder) {
 	// Player:onItemMoved(item, count, fromPosition, toPosition) or Player.onItemMoved(self, item, count, fromPosition, toPosition, fromCylinder, toCylinder)
-	if (info.playerOnItemMoved == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_ITEM_MOVED)) {
 		return;
 	}
 
@@ -787,13 +770,13 @@ void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count,
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnItemMoved, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_ITEM_MOVED], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnItemMoved);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_ITEM_MOVED]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -811,7 +794,7 @@ void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count,
 void Events::eventPlayerOnChangeZone(Player* player, ZoneType_t zone)
 {
 	// Player:onChangeZone(zone)
-	if (info.playerOnChangeZone == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_CHANGE_ZONE)) {
 		return;
 	}
 
@@ -824,13 +807,13 @@ void Events::eventPlayerOnChangeZone(Player* player, ZoneType_t zone)
 	}
 
 	ScriptEnvironment * env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnChangeZone, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_CHANGE_ZONE], &scriptInterface);
 
 	lua_State * L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnChangeZone);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_CHANGE_ZONE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, zone);
 	scriptInterface.callVoidFunction(2);
@@ -838,7 +821,7 @@ void Events::eventPlayerOnChangeZone(Player* player, ZoneType_t zone)
 
 bool Events::eventPlayerOnMoveCreature(Player* player, Creature* creature, const Position& fromPosition, const Position& toPosition) {
 	// Player:onMoveCreature(creature, fromPosition, toPosition) or Player.onMoveCreature(self, creature, fromPosition, toPosition)
-	if (info.playerOnMoveCreature == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_MOVE_CREATURE)) {
 		return true;
 	}
 
@@ -851,13 +834,13 @@ bool Events::eventPlayerOnMoveCreature(Player* player, Creature* creature, const
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnMoveCreature, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_MOVE_CREATURE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnMoveCreature);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_MOVE_CREATURE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -870,7 +853,7 @@ bool Events::eventPlayerOnMoveCreature(Player* player, Creature* creature, const
 
 void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string& targetName, uint8_t reportType, uint8_t reportReason, const std::string& comment, const std::string& translation) {
 	// Player:onReportRuleViolation(targetName, reportType, reportReason, comment, translation)
-	if (info.playerOnReportRuleViolation == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_REPORT_RULE_VIOLATION)) {
 		return;
 	}
 
@@ -883,13 +866,13 @@ void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string&
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportRuleViolation, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_REPORT_RULE_VIOLATION], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportRuleViolation);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_REPORT_RULE_VIOLATION]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, targetName);
 
@@ -904,7 +887,7 @@ void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string&
 
 bool Events::eventPlayerOnReportBug(Player* player, const std::string& message, const Position& position, uint8_t category) {
 	// Player:onReportBug(message, position, category)
-	if (info.playerOnReportBug == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_REPORT_BUG)) {
 		return true;
 	}
 
@@ -917,13 +900,13 @@ bool Events::eventPlayerOnReportBug(Player* player, const std::string& message,
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportBug, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_REPORT_BUG], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportBug);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_REPORT_BUG]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, message);
 	LuaScriptInterface::pushPosition(L, position);
@@ -934,7 +917,7 @@ bool Events::eventPlayerOnReportBug(Player* player, const std::string& message,
 
 bool Events::eventPlayerOnTurn(Player* player, Direction direction) {
 	// Player:onTurn(direction) or Player.onTurn(self, direction)
-	if (info.playerOnTurn == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_TURN)) {
 		return true;
 	}
 
@@ -947,13 +930,13 @@ bool Events::eventPlayerOnTurn(Player* player, Direction direction) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTurn, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_TURN], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTurn);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_TURN]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, direction);
 
@@ -962,7 +945,7 @@ bool Events::eventPlayerOnTurn(Player* player, Direction direction) {
 
 bool Events::eventPlayerOnTradeRequest(Player* player, Player* target, Item* item) {
 	// Player:onTradeRequest(target, item)
-	if (info.playerOnTradeRequest == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_TRADE_REQUEST)) {
 		return true;
 	}
 
@@ -975,16 +958,16 @@ bool Events::eventPlayerOnTradeRequest(Player* player, Player* target, Item* ite
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeRequest, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_TRADE_REQUEST], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeRequest);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_TRADE_REQUEST]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Player>(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -994,7 +977,7 @@ bool Events::eventPlayerOnTradeRequest(Player* player, Player* target, Item* ite
 
 bool Events::eventPlayerOnTradeAccept(Player* player, Player* target, Item* item, Item* targetItem) {
 	// Player:onTradeAccept(target, item, targetItem)
-	if (info.playerOnTradeAccept == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_TRADE_ACCEPT)) {
 		return true;
 	}
 
@@ -1007,16 +990,16 @@ bool Events::eventPlayerOnTradeAccept(Player* player, Player* target, Item* item
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeAccept, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_TRADE_ACCEPT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeAccept);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_TRADE_ACCEPT]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Player>(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -1030,7 +1013,7 @@ bool Events::eventPlayerOnTradeAccept(Player* player, Player* target, Item* item
 void Events::eventPlayerOnGainExperience(Player* player, Creature* target, uint64_t& exp, uint64_t rawExp) {
 	// Player:onGainExperience(target, exp, rawExp)
 	// rawExp gives the original exp which is not multiplied
-	if (info.playerOnGainExperience == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE)) {
 		return;
 	}
 
@@ -1043,13 +1026,13 @@ void Events::eventPlayerOnGainExperience(Player* player, Creature* target, uint6
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnGainExperience, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnGainExperience);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	if (target) {
 		LuaScriptInterface::pushUserdata<Creature>(L, target);
@@ -1073,7 +1056,7 @@ void Events::eventPlayerOnGainExperience(Player* player, Creature* target, uint6
 
 void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp) {
 	// Player:onLoseExperience(exp)
-	if (info.playerOnLoseExperience == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_LOSE_EXPERIENCE)) {
 		return;
 	}
 
@@ -1086,13 +1069,13 @@ void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLoseExperience, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_LOSE_EXPERIENCE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLoseExperience);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_LOSE_EXPERIENCE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, exp);
 
@@ -1108,7 +1091,7 @@ void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp) {
 
 void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_t& tries) {
 	// Player:onGainSkillTries(skill, tries)
-	if (info.playerOnGainSkillTries == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_GAIN_SKILL_TRIES)) {
 		return;
 	}
 
@@ -1121,13 +1104,13 @@ void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnGainSkillTries, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_GAIN_SKILL_TRIES], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnGainSkillTries);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_GAIN_SKILL_TRIES]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, skill);
 	lua_pushnumber(L, tries);
@@ -1144,7 +1127,7 @@ void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_
 
 void Events::eventPlayerOnCombat(Player* player, Creature* target, Item* item, CombatDamage& damage) {
 	// Player:onCombat(target, item, primaryDamage, primaryType, secondaryDamage, secondaryType)
-	if (info.playerOnCombat == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_COMBAT)) {
 		return;
 	}
 
@@ -1157,13 +1140,13 @@ void Events::eventPlayerOnCombat(Player* player, Creature* target, Item* item, C
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnCombat, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_COMBAT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnCombat);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_COMBAT]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	if (target) {
 		LuaScriptInterface::pushUserdata<Creature>(L, target);
@@ -1174,7 +1157,7 @@ void Events::eventPlayerOnCombat(Player* player, Creature* target, Item* item, C
 
 	if(item){
 		LuaScriptInterface::pushUserdata<Item>(L, item);
-		LuaScriptInterface::setMetatable(L, -1, "Item");
+		LuaScriptInterface::setMetatable(L, -1, LuaData_Item);
 	}else{
 		lua_pushnil(L);
 	}
@@ -1212,7 +1195,7 @@ void Events::eventPlayerOnCombat(Player* player, Creature* target, Item* item, C
 
 void Events::eventPlayerOnRequestQuestLog(Player* player) {
 	// Player:onRequestQuestLog()
-	if (info.playerOnRequestQuestLog == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LOG)) {
 		return;
 	}
 
@@ -1225,20 +1208,20 @@ void Events::eventPlayerOnRequestQuestLog(Player* player) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnRequestQuestLog, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LOG], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnRequestQuestLog);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LOG]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	scriptInterface.callVoidFunction(1);
 }
 
 void Events::eventPlayerOnRequestQuestLine(Player* player, uint16_t questId) {
 	// Player::onRequestQuestLine()
-	if (info.playerOnRequestQuestLine == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LINE)) {
 		return;
 	}
 
@@ -1251,13 +1234,13 @@ void Events::eventPlayerOnRequestQuestLine(Player* player, uint16_t questId) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnRequestQuestLine, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LINE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnRequestQuestLine);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LINE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, questId);
 
@@ -1266,7 +1249,7 @@ void Events::eventPlayerOnRequestQuestLine(Player* player, uint16_t questId) {
 
 void Events::eventOnStorageUpdate(Player* player, const uint32_t key, const int32_t value, int32_t oldValue, uint64_t currentTime) {
 	// Player::onStorageUpdate(key, value, oldValue, currentTime)
-	if (info.playerOnStorageUpdate == -1) {
+	if (!hasListener(EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE)) {
 		return;
 	}
 
@@ -1279,13 +1262,13 @@ void Events::eventOnStorageUpdate(Player* player, const uint32_t key, const int3
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnStorageUpdate, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnStorageUpdate);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE]);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, key);
 	lua_pushnumber(L, value);
@@ -1298,7 +1281,7 @@ void Events::eventOnStorageUpdate(Player* player, const uint32_t key, const int3
 // Monster
 void Events::eventMonsterOnDropLoot(Monster* monster, Container* corpse) {
 	// Monster:onDropLoot(corpse)
-	if (info.monsterOnDropLoot == -1) {
+	if (!hasListener(EVENT_HOOK_MONSTER_ON_DROP_LOOT)) {
 		return;
 	}
 
@@ -1311,16 +1294,16 @@ void Events::eventMonsterOnDropLoot(Monster* monster, Container* corpse) {
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.monsterOnDropLoot, &scriptInterface);
+	env->setScriptId(hooks[EVENT_HOOK_MONSTER_ON_DROP_LOOT], &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.monsterOnDropLoot);
+	scriptInterface.pushFunction(hooks[EVENT_HOOK_MONSTER_ON_DROP_LOOT]);
 
 	LuaScriptInterface::pushUserdata<Monster>(L, monster);
-	LuaScriptInterface::setMetatable(L, -1, "Monster");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Monster);
 
 	LuaScriptInterface::pushUserdata<Container>(L, corpse);
-	LuaScriptInterface::setMetatable(L, -1, "Container");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Container);
 
 	return scriptInterface.callVoidFunction(2);
 }
@@ -29,53 +29,55 @@ class ItemType;
 class Tile;
 class Imbuements;
 
-class Events {
-	struct EventsInfo {
-		// Creature
-		int32_t creatureOnChangeOutfit = -1;
-		int32_t creatureOnAreaCombat = -1;
-		int32_t creatureOnTargetCombat = -1;
-		int32_t creatureOnHear = -1;
-		int32_t creatureOnDrainHealth = -1;
-
-		// Party
-		int32_t partyOnJoin = -1;
-		int32_t partyOnLeave = -1;
-		int32_t partyOnDisband = -1;
-		int32_t partyOnShareExperience = -1;
-
-		// Player
-		int32_t playerOnBrowseField = -1;
-		int32_t playerOnLook = -1;
-		int32_t playerOnLookInBattleList = -1;
-		int32_t playerOnLookInTrade = -1;
-		int32_t playerOnLookInShop = -1;
-		int32_t playerOnMoveItem = -1;
-		int32_t playerOnItemMoved = -1;
-		int32_t playerOnChangeZone = -1;
-		int32_t playerOnMoveCreature = -1;
-		int32_t playerOnReportRuleViolation = -1;
-		int32_t playerOnReportBug = -1;
-		int32_t playerOnTurn = -1;
-		int32_t playerOnTradeRequest = -1;
-		int32_t playerOnTradeAccept = -1;
-		int32_t playerOnGainExperience = -1;
-		int32_t playerOnLoseExperience = -1;
-		int32_t playerOnGainSkillTries = -1;
-		int32_t playerOnRequestQuestLog = -1;
-		int32_t playerOnRequestQuestLine = -1;
-		int32_t playerOnStorageUpdate = -1;
-		int32_t playerOnRemoveCount = -1;
-		int32_t playerOnCombat = -1;
-
-		// Monster
-		int32_t monsterOnDropLoot = -1;
-		int32_t monsterOnSpawn = -1;
-
-		// Npc
-		int32_t npcOnSpawn = -1;
-	};
+enum EventHook_t : uint8_t {
+	// Creature
+	EVENT_HOOK_CREATURE_ON_CHANGE_OUTFIT,
+	EVENT_HOOK_CREATURE_ON_AREA_COMBAT,
+	EVENT_HOOK_CREATURE_ON_TARGET_COMBAT,
+	EVENT_HOOK_CREATURE_ON_HEAR,
+	EVENT_HOOK_CREATURE_ON_DRAIN_HEALTH,
+
+	// Party
+	EVENT_HOOK_PARTY_ON_JOIN,
+	EVENT_HOOK_PARTY_ON_LEAVE,
+	EVENT_HOOK_PARTY_ON_DISBAND,
+	EVENT_HOOK_PARTY_ON_SHARE_EXPERIENCE,
+
+	// Player
+	EVENT_HOOK_PLAYER_ON_BROWSE_FIELD,
+	EVENT_HOOK_PLAYER_ON_LOOK,
+	EVENT_HOOK_PLAYER_ON_LOOK_IN_BATTLE_LIST,
+	EVENT_HOOK_PLAYER_ON_LOOK_IN_TRADE,
+	EVENT_HOOK_PLAYER_ON_LOOK_IN_SHOP,
+	EVENT_HOOK_PLAYER_ON_MOVE_ITEM,
+	EVENT_HOOK_PLAYER_ON_ITEM_MOVED,
+	EVENT_HOOK_PLAYER_ON_CHANGE_ZONE,
+	EVENT_HOOK_PLAYER_ON_MOVE_CREATURE,
+	EVENT_HOOK_PLAYER_ON_REPORT_RULE_VIOLATION,
+	EVENT_HOOK_PLAYER_ON_REPORT_BUG,
+	EVENT_HOOK_PLAYER_ON_TURN,
+	EVENT_HOOK_PLAYER_ON_TRADE_REQUEST,
+	EVENT_HOOK_PLAYER_ON_TRADE_ACCEPT,
+	EVENT_HOOK_PLAYER_ON_GAIN_EXPERIENCE,
+	EVENT_HOOK_PLAYER_ON_LOSE_EXPERIENCE,
+	EVENT_HOOK_PLAYER_ON_GAIN_SKILL_TRIES,
+	EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LOG,
+	EVENT_HOOK_PLAYER_ON_REQUEST_QUEST_LINE,
+	EVENT_HOOK_PLAYER_ON_STORAGE_UPDATE,
+	EVENT_HOOK_PLAYER_ON_REMOVE_COUNT,
+	EVENT_HOOK_PLAYER_ON_COMBAT,
+
+	// Monster
+	EVENT_HOOK_MONSTER_ON_DROP_LOOT,
+	EVENT_HOOK_MONSTER_ON_SPAWN,
+
+	// Npc
+	EVENT_HOOK_NPC_ON_SPAWN,
+
+	EVENT_HOOK_LAST
+};
 
+class Events {
 	public:
 	
 		Events();
@@ -93,6 +95,15 @@ class Events {
 			return instance;
 		}
 
+		/**
+		 * Whether data/events has a method for this hook.
+		 * A caller that has to prepare the arguments checks it first,
+		 * every event function returns its default right away without one.
+		 */
+		bool hasListener(EventHook_t hook) const {
+			return (hookMask >> hook) & 1;
+		}
+
 		// Creature
 		bool eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& outfit);
 		ReturnValue eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bool aggressive);
@@ -139,7 +150,11 @@ class Events {
 
 	private:
 		LuaScriptInterface scriptInterface;
-		EventsInfo info;
+		// script id of each hook, -1 without a method
+		std::array<int32_t, EVENT_HOOK_LAST> hooks;
+		uint64_t hookMask = 0;
+
+		static_assert(EVENT_HOOK_LAST <= 64, "hookMask has a bit per hook");
 };
 
 constexpr auto g_events = &Events::getInstance;
@@ -29,6 +29,33 @@ void MoveEvents::clear() {
 	actionIdMap.clear();
 	itemIdMap.clear();
 	positionsMap.clear();
+
+	itemIdEvents.clear();
+	itemIdEventTypes.clear();
+	actionIdEventTypes = 0;
+	uniqueIdEventTypes = 0;
+	positionEventTypes = 0;
+	positionEvents.clear();
+}
+
+template <typename MoveListMap>
+size_t MoveEvents::clearFileLists(MoveListMap& map, const std::string& file) {
+	// emptied lists stay, the flat indexes point into them and only ever over-report
+	size_t count = 0;
+	for (auto& [key, moveEventList] : map) {
+		for (std::list<MoveEvent>& moveEvents : moveEventList.moveEvent) {
+			count += moveEvents.size();
+			moveEvents.remove_if([&file](const MoveEvent& moveEvent) {
+				return moveEvent.fromLua && moveEvent.getSourceFile() == file;
+			});
+			count -= moveEvents.size();
+		}
+	}
+	return count;
+}
+
+size_t MoveEvents::clearFile(const std::string& file) {
+	return clearFileLists(uniqueIdMap, file) + clearFileLists(actionIdMap, file) + clearFileLists(itemIdMap, file) + clearFileLists(positionsMap, file);
 }
 
 Event_ptr MoveEvents::getEvent(const std::string& nodeName) {
@@ -49,7 +76,15 @@ bool MoveEvents::registerLuaItemEvent(MoveEvent& moveEvent) {
 			it.minReqMagicLevel = moveEvent.getReqMagLv();
 			it.vocationString = moveEvent.getVocationString();
 		}
-		return registerEvent(moveEvent, itemId, itemIdMap);
+
+		uint8_t eventTypeBit = getEventTypeBit(moveEvent.getEventType());
+		MoveEventList& moveEventList = registerEvent(moveEvent, itemId, itemIdMap);
+		if (itemId >= itemIdEvents.size()) {
+			itemIdEvents.resize(itemId + 1, nullptr);
+			itemIdEventTypes.resize(itemId + 1, 0);
+		}
+		itemIdEvents[itemId] = &moveEventList;
+		itemIdEventTypes[itemId] |= eventTypeBit;
 	});
 	itemIdVector.clear();
 	itemIdVector.shrink_to_fit();
@@ -63,7 +98,8 @@ bool MoveEvents::registerLuaActionEvent(MoveEvent& moveEvent) {
 	}
 
 	std::for_each(actionIdVector.begin(), actionIdVector.end(), [this, &moveEvent](const uint32_t &actionId) {
-		return registerEvent(moveEvent, actionId, actionIdMap);
+		actionIdEventTypes |= getEventTypeBit(moveEvent.getEventType());
+		registerEvent(moveEvent, actionId, actionIdMap);
 	});
 
 	actionIdVector.clear();
@@ -78,7 +114,8 @@ bool MoveEvents::registerLuaUniqueEvent(MoveEvent& moveEvent) {
 	}
 
 	std::for_each(uniqueIdVector.begin(), uniqueIdVector.end(), [this, &moveEvent](const uint32_t &uniqueId) {
-		return registerEvent(moveEvent, uniqueId, uniqueIdMap);
+		uniqueIdEventTypes |= getEventTypeBit(moveEvent.getEventType());
+		registerEvent(moveEvent, uniqueId, uniqueIdMap);
 	});
 
 	uniqueIdVector.clear();
@@ -93,7 +130,8 @@ bool MoveEvents::registerLuaPositionEvent(MoveEvent& moveEvent) {
 	}
 
 	std::for_each(positionVector.begin(), positionVector.end(), [this, &moveEvent](const Position &position) {
-		return registerEvent(moveEvent, position, positionsMap);
+		positionEventTypes |= getEventTypeBit(moveEvent.getEventType());
+		positionEvents[getPositionKey(position)] = &registerEvent(moveEvent, position, positionsMap);
 	});
 
 	positionVector.clear();
@@ -118,12 +156,12 @@ bool MoveEvents::registerLuaEvent(MoveEvent& moveEvent) {
 	return false;
 }
 
-void MoveEvents::registerEvent(MoveEvent& moveEvent, int32_t id, std::map<int32_t, MoveEventList>& moveListMap) const {
+MoveEventList& MoveEvents::registerEvent(MoveEvent& moveEvent, int32_t id, std::map<int32_t, MoveEventList>& moveListMap) const {
 	auto it = moveListMap.find(id);
 	if (it == moveListMap.end()) {
-		MoveEventList moveEventList;
+		MoveEventList& moveEventList = moveListMap[id];
 		moveEventList.moveEvent[moveEvent.getEventType()].push_back(std::move(moveEvent));
-		moveListMap[id] = moveEventList;
+		return moveEventList;
 	} else {
 		std::list<MoveEvent>& moveEventList = it->second.moveEvent[moveEvent.getEventType()];
 		for (MoveEvent& existingMoveEvent : moveEventList) {
@@ -133,6 +171,7 @@ void MoveEvents::registerEvent(MoveEvent& moveEvent, int32_t id, std::map<int32_
 			}
 		}
 		moveEventList.push_back(std::move(moveEvent));
+		return it->second;
 	}
 }
 
@@ -152,7 +191,8 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType, Slots_t slot)
 		default: slotp = 0; break;
 	}
 
-	if (item.hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
+	uint8_t eventTypeBit = getEventTypeBit(eventType);
+	if ((actionIdEventTypes & eventTypeBit) != 0 && item.hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
 		std::map<int32_t, MoveEventList>::iterator it = actionIdMap.find(item.getActionId());
 		if (it != actionIdMap.end()) {
 			std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
@@ -164,9 +204,9 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType, Slots_t slot)
 		}
 	}
 
-	auto it = itemIdMap.find(item.getID());
-	if (it != itemIdMap.end()) {
-		std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
+	uint16_t itemId = item.getID();
+	if (itemId < itemIdEventTypes.size() && (itemIdEventTypes[itemId] & eventTypeBit) != 0) {
+		std::list<MoveEvent>& moveEventList = itemIdEvents[itemId]->moveEvent[eventType];
 		for (MoveEvent& moveEvent : moveEventList) {
 			if ((moveEvent.getSlot() & slotp) != 0) {
 				return &moveEvent;
@@ -177,8 +217,9 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType, Slots_t slot)
 }
 
 MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType) {
+	uint8_t eventTypeBit = getEventTypeBit(eventType);
 	std::map<int32_t, MoveEventList>::iterator it;
-	if (item.hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+	if ((uniqueIdEventTypes & eventTypeBit) != 0 && item.hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
 		it = uniqueIdMap.find(item.getUniqueId());
 		if (it != uniqueIdMap.end()) {
 			std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
@@ -188,7 +229,7 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType) {
 		}
 	}
 
-	if (item.hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
+	if ((actionIdEventTypes & eventTypeBit) != 0 && item.hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
 		it = actionIdMap.find(item.getActionId());
 		if (it != actionIdMap.end()) {
 			std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
@@ -198,9 +239,9 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType) {
 		}
 	}
 
-	it = itemIdMap.find(item.getID());
-	if (it != itemIdMap.end()) {
-		std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
+	uint16_t itemId = item.getID();
+	if (itemId < itemIdEventTypes.size() && (itemIdEventTypes[itemId] & eventTypeBit) != 0) {
+		std::list<MoveEvent>& moveEventList = itemIdEvents[itemId]->moveEvent[eventType];
 		if (!moveEventList.empty()) {
 			return &(*moveEventList.begin());
 		}
@@ -208,12 +249,12 @@ MoveEvent* MoveEvents::getEvent(Item& item, MoveEvent_t eventType) {
 	return nullptr;
 }
 
-void MoveEvents::registerEvent(MoveEvent& moveEvent, const Position& position, std::map<Position, MoveEventList>& moveListMap) const {
+MoveEventList& MoveEvents::registerEvent(MoveEvent& moveEvent, const Position& position, std::map<Position, MoveEventList>& moveListMap) const {
 	auto it = moveListMap.find(position);
 	if (it == moveListMap.end()) {
-		MoveEventList moveEventList;
+		MoveEventList& moveEventList = moveListMap[position];
 		moveEventList.moveEvent[moveEvent.getEventType()].push_back(std::move(moveEvent));
-		moveListMap[position] = moveEventList;
+		return moveEventList;
 	} else {
 		std::list<MoveEvent>& moveEventList = it->second.moveEvent[moveEvent.getEventType()];
 		if (!moveEventList.empty()) {
@@ -222,14 +263,19 @@ void MoveEvents::registerEvent(MoveEvent& moveEvent, const Position& position, s
 		}
 
 		moveEventList.push_back(std::move(moveEvent));
+		return it->second;
 	}
 }
 
 MoveEvent* MoveEvents::getEvent(Tile& tile, MoveEvent_t eventType) {
-	if (auto it = positionsMap.find(tile.getPosition());
-	it != positionsMap.end())
+	if ((positionEventTypes & getEventTypeBit(eventType)) == 0) {
+		return nullptr;
+	}
+
+	if (auto it = positionEvents.find(getPositionKey(tile.getPosition()));
+	it != positionEvents.end())
 	{
-		std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
+		std::list<MoveEvent>& moveEventList = it->second->moveEvent[eventType];
 		if (!moveEventList.empty()) {
 			return &(*moveEventList.begin());
 		}
@@ -237,7 +283,38 @@ MoveEvent* MoveEvents::getEvent(Tile& tile, MoveEvent_t eventType) {
 	return nullptr;
 }
 
+bool MoveEvents::hasTileEvent(const Item& item) const {
+	if (!tileEventsReady.load(std::memory_order_relaxed)) {
+		return false;
+	}
+
+	uint16_t itemId = item.getID();
+	if (itemId < itemIdEventTypes.size() && (itemIdEventTypes[itemId] & TILE_EVENT_TYPES) != 0) {
+		return true;
+	}
+
+	if ((actionIdEventTypes & TILE_EVENT_TYPES) != 0 && item.hasAttribute(ITEM_ATTRIBUTE_ACTIONID)
+		&& actionIdMap.find(item.getActionId()) != actionIdMap.end()) {
+		return true;
+	}
+
+	return (uniqueIdEventTypes & TILE_EVENT_TYPES) != 0 && item.hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)
+		&& uniqueIdMap.find(item.getUniqueId()) != uniqueIdMap.end();
+}
+
+bool MoveEvents::hasTileEvent(const Position& pos) const {
+	if (!tileEventsReady.load(std::memory_order_relaxed)) {
+		return false;
+	}
+
+	return (positionEventTypes & TILE_EVENT_TYPES) != 0 && positionEvents.find(getPositionKey(pos)) != positionEvents.end();
+}
+
 uint32_t MoveEvents::onCreatureMove(Creature& creature, Tile& tile, MoveEvent_t eventType) {
+	if (!tile.hasFlag(TILESTATE_MOVEEVENT)) {
+		return 1;
+	}
+
 	const Position& pos = tile.getPosition();
 
 	uint32_t ret = 1;
@@ -305,6 +382,10 @@ uint32_t MoveEvents::onItemMove(Item& item, Tile& tile, bool isAdd) {
 		ret &= moveEvent->fireAddRemItem(item, tile.getPosition());
 	}
 
+	if (!tile.hasFlag(TILESTATE_MOVEEVENT)) {
+		return ret;
+	}
+
 	for (size_t i = tile.getFirstIndex(), j = tile.getLastIndex(); i < j; ++i) {
 		Thing* thing = tile.getThing(i);
 		if (!thing) {
@@ -433,9 +514,10 @@ uint32_t MoveEvent::EquipItem(MoveEvent* moveEvent, Player* player, Item* item,
 		}
 
 		player->addItemImbuementStats(imbuementInfo.imbuement);
-		g_game().increasePlayerActiveImbuements(player->getID());
 	}
 
+	player->updateInventoryImbuement();
+
 	if (!it.abilities) {
 		return 1;
 	}
@@ -540,7 +622,6 @@ uint32_t MoveEvent::DeEquipItem(MoveEvent*, Player* player, Item* item, Slots_t
 		}
 
 		player->removeItemImbuementStats(imbuementInfo.imbuement);
-		g_game().decreasePlayerActiveImbuements(player->getID());
 	}
 
 	if (!it.abilities) {
@@ -677,7 +758,7 @@ bool MoveEvent::executeEquip(Player& player, Item& item, Slots_t onSlot, bool is
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata<Player>(L, &player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	LuaScriptInterface::pushThing(L, &item);
 	lua_pushnumber(L, onSlot);
 	LuaScriptInterface::pushBoolean(L, isCheck);
@@ -53,6 +53,21 @@ class MoveEvents final : public BaseEvents {
 		uint32_t onPlayerDeEquip(Player& player, Item& item, Slots_t slot);
 		uint32_t onItemMove(Item& item, Tile& tile, bool isAdd);
 
+		/**
+		 * Whether a step or add/remove item event may fire from the tile because
+		 * of this item or position. Tiles keep the answer as TILESTATE_MOVEEVENT,
+		 * so Map::updateMoveEventFlags must run when events are registered after
+		 * the map was loaded.
+		 * Both answer false until setTileEventsReady: at startup the map may be read
+		 * while the scripts still register their events.
+		 */
+		bool hasTileEvent(const Item& item) const;
+		bool hasTileEvent(const Position& pos) const;
+
+		void setTileEventsReady() {
+			tileEventsReady.store(true, std::memory_order_relaxed);
+		}
+
 		void clear(bool fromLua) override {
 			fromLua = false;
 		}
@@ -70,10 +85,6 @@ class MoveEvents final : public BaseEvents {
 			return false;
 		}
 
-		void setPosition(Position position, MoveEventList moveEventList) {
-			positionsMap.try_emplace(position, moveEventList);
-		}
-
 		std::map<int32_t, MoveEventList> getItemIdMap() const {
 			return itemIdMap;
 		}
@@ -87,10 +98,6 @@ class MoveEvents final : public BaseEvents {
 			return false;
 		}
 
-		void setItemId(int32_t itemId, MoveEventList moveEventList) {
-			itemIdMap.try_emplace(itemId, moveEventList);
-		}
-
 		std::map<int32_t, MoveEventList> getUniqueIdMap() const {
 			return uniqueIdMap;
 		}
@@ -104,10 +111,6 @@ class MoveEvents final : public BaseEvents {
 			return false;
 		}
 
-		void setUniqueId(int32_t uniqueId, MoveEventList moveEventList) {
-			uniqueIdMap.try_emplace(uniqueId, moveEventList);
-		}
-
 		std::map<int32_t, MoveEventList> getActionIdMap() const {
 			return actionIdMap;
 		}
@@ -121,10 +124,6 @@ class MoveEvents final : public BaseEvents {
 			return false;
 		}
 
-		void setActionId(int32_t actionId, MoveEventList moveEventList) {
-			actionIdMap.try_emplace(actionId, moveEventList);
-		}
-
 		MoveEvent* getEvent(Item& item, MoveEvent_t eventType);
 
 		bool registerLuaItemEvent(MoveEvent& moveEvent);
@@ -133,10 +132,13 @@ class MoveEvents final : public BaseEvents {
 		bool registerLuaPositionEvent(MoveEvent& moveEvent);
 		bool registerLuaEvent(MoveEvent& event);
 		void clear();
+		size_t clearFile(const std::string& file);
 
 	private:
 		void clearMap(std::map<int32_t, MoveEventList>& map, bool fromLua);
 		void clearPosMap(std::map<Position, MoveEventList>& map, bool fromLua);
+		template <typename MoveListMap>
+		static size_t clearFileLists(MoveListMap& map, const std::string& file);
 
 		LuaScriptInterface& getScriptInterface() override {
 			return scriptInterface;
@@ -149,8 +151,8 @@ class MoveEvents final : public BaseEvents {
 			return false;
 		}
 
-		void registerEvent(MoveEvent& moveEvent, int32_t id, std::map<int32_t, MoveEventList>& moveListMap) const;
-		void registerEvent(MoveEvent& moveEvent, const Position& position, std::map<Position, MoveEventList>& moveListMap) const;
+		MoveEventList& registerEvent(MoveEvent& moveEvent, int32_t id, std::map<int32_t, MoveEventList>& moveListMap) const;
+		MoveEventList& registerEvent(MoveEvent& moveEvent, const Position& position, std::map<Position, MoveEventList>& moveListMap) const;
 		MoveEvent* getEvent(Tile& tile, MoveEvent_t eventType);
 
 		MoveEvent* getEvent(Item& item, MoveEvent_t eventType, Slots_t slot);
@@ -160,6 +162,31 @@ class MoveEvents final : public BaseEvents {
 		std::map<int32_t, MoveEventList> itemIdMap;
 		std::map<Position, MoveEventList> positionsMap;
 
+		static uint8_t getEventTypeBit(MoveEvent_t eventType) {
+			return static_cast<uint8_t>(1 << eventType);
+		}
+		// every event type but equip and deequip is fired from a tile
+		static constexpr uint8_t TILE_EVENT_TYPES = static_cast<uint8_t>(~((1 << MOVE_EVENT_EQUIP) | (1 << MOVE_EVENT_DEEQUIP)));
+		static uint64_t getPositionKey(const Position& pos) {
+			return (static_cast<uint64_t>(pos.x) << 24) | (static_cast<uint64_t>(pos.y) << 8) | pos.z;
+		}
+
+		/**
+		 * Flat indexes over the maps above, filled as events are registered.
+		 * Every step checks every item of the tile, with these that costs a few
+		 * array reads per item unless the item really has a script.
+		 */
+		// by item id, pointing into itemIdMap, and the event types each id has
+		std::vector<MoveEventList*> itemIdEvents;
+		std::vector<uint8_t> itemIdEventTypes;
+		// event types registered for any action id, unique id or position
+		uint8_t actionIdEventTypes = 0;
+		uint8_t uniqueIdEventTypes = 0;
+		uint8_t positionEventTypes = 0;
+		// by getPositionKey, pointing into positionsMap
+		phmap::flat_hash_map<uint64_t, MoveEventList*> positionEvents;
+		std::atomic<bool> tileEventsReady {false};
+
 		LuaScriptInterface scriptInterface {"MoveEvent interface"};
 };
 
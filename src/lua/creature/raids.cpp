@@ -116,33 +116,77 @@ bool Raids::startup() {
 
 	setLastRaidEnd(OTSYS_TIME());
 
-	checkRaidsEvent = g_scheduler().addEvent(createSchedulerTask(CHECK_RAIDS_INTERVAL * 1000, std::bind(&Raids::checkRaids, this)));
-
 	started = true;
+	scheduleNextRaid();
 	return started;
 }
 
-void Raids::checkRaids() {
-	if (!getRunning()) {
-		uint64_t now = OTSYS_TIME();
+void Raids::scheduleNextRaid() {
+	g_scheduler().stopEvent(checkRaidsEvent);
+	checkRaidsEvent = 0;
 
-		for (auto it = raidList.begin(), end = raidList.end(); it != end; ++it) {
-			Raid* raid = *it;
-			if (now >= (getLastRaidEnd() + raid->getMargin())) {
-				if (((MAX_RAND_RANGE * CHECK_RAIDS_INTERVAL) / raid->getInterval()) >= static_cast<uint32_t>(uniform_random(0, MAX_RAND_RANGE))) {
-					setRunning(raid);
-					raid->startRaid();
+	// a running raid schedules the next one when it ends
+	if (!isStarted() || getRunning()) {
+		return;
+	}
 
-					if (!raid->canBeRepeated()) {
-						raidList.erase(it);
-					}
-					break;
-				}
-			}
+	static constexpr int64_t checkInterval = CHECK_RAIDS_INTERVAL * 1000;
+	int64_t now = OTSYS_TIME();
+	int64_t firstCheck = now + checkInterval;
+
+	Raid* nextRaid = nullptr;
+	int64_t nextRaidTime = std::numeric_limits<int64_t>::max();
+	for (Raid* raid : raidList) {
+		// the same odds the per interval roll had
+		double chance = std::min(1.0, static_cast<double>((MAX_RAND_RANGE * CHECK_RAIDS_INTERVAL) / raid->getInterval()) / MAX_RAND_RANGE);
+		if (chance <= 0) {
+			continue;
 		}
+
+		// rolls only count once the margin after the last raid passed
+		int64_t eligible = static_cast<int64_t>(getLastRaidEnd() + raid->getMargin());
+		int64_t start = firstCheck;
+		if (eligible > start) {
+			start += (eligible - start + checkInterval - 1) / checkInterval * checkInterval;
+		}
+
+		std::geometric_distribution<int64_t> failedRolls(chance);
+		int64_t rolls = std::min<int64_t>(failedRolls(getRandomGenerator()), MAX_RAID_SCHEDULE_DELAY / checkInterval + 1);
+		int64_t raidTime = start + rolls * checkInterval;
+		// ties go to the raid listed first, as they did when rolling in order
+		if (raidTime < nextRaidTime) {
+			nextRaid = raid;
+			nextRaidTime = raidTime;
+		}
+	}
+
+	if (!nextRaid) {
+		return;
+	}
+
+	int64_t delay = nextRaidTime - now;
+	if (delay > MAX_RAID_SCHEDULE_DELAY) {
+		// nothing lost by drawing again later, every roll is independent
+		checkRaidsEvent = g_scheduler().addEvent(createSchedulerTask(MAX_RAID_SCHEDULE_DELAY, std::bind(&Raids::scheduleNextRaid, this)));
+		return;
+	}
+
+	checkRaidsEvent = g_scheduler().addEvent(createSchedulerTask(static_cast<uint32_t>(delay), std::bind(&Raids::startScheduledRaid, this, nextRaid)));
+}
+
+void Raids::startScheduledRaid(Raid* raid) {
+	checkRaidsEvent = 0;
+	// started by hand in the meantime, its end schedules again
+	if (getRunning()) {
+		return;
 	}
 
-	checkRaidsEvent = g_scheduler().addEvent(createSchedulerTask(CHECK_RAIDS_INTERVAL * 1000, std::bind(&Raids::checkRaids, this)));
+	setRunning(raid);
+	raid->startRaid();
+
+	if (!raid->canBeRepeated()) {
+		raidList.remove(raid);
+	}
 }
 
 void Raids::clear() {
@@ -256,6 +300,7 @@ void Raid::resetRaid() {
 	state = RAIDSTATE_IDLE;
 	g_game().raids.setRunning(nullptr);
 	g_game().raids.setLastRaidEnd(OTSYS_TIME());
+	g_game().raids.scheduleNextRaid();
 }
 
 void Raid::stopEvents() {
@@ -37,6 +37,8 @@ struct MonsterSpawn {
 //How many times it will try to find a tile to add the monster to before giving up
 static constexpr int32_t MAXIMUM_TRIES_PER_MONSTER = 10;
 static constexpr int32_t CHECK_RAIDS_INTERVAL = 60;
+// longest wait scheduled at once, the draw is simply repeated after it
+static constexpr int64_t MAX_RAID_SCHEDULE_DELAY = 24 * 60 * 60 * 1000;
 static constexpr int32_t RAID_MINTICKS = 1000;
 
 class Raid;
@@ -80,13 +82,21 @@ class Raids {
 			lastRaidEnd = newLastRaidEnd;
 		}
 
-		void checkRaids();
+		/**
+		 * Every CHECK_RAIDS_INTERVAL each eligible raid rolls its chance, in list order.
+		 * Instead of polling, the number of failed rolls until each raid succeeds is
+		 * drawn from the matching geometric distribution and a single event is
+		 * scheduled for the earliest one. Called on startup and when a raid ends.
+		 */
+		void scheduleNextRaid();
 
 		LuaScriptInterface& getScriptInterface() {
 			return scriptInterface;
 		}
 
 	private:
+		void startScheduledRaid(Raid* raid);
+
 		LuaScriptInterface scriptInterface{"Raid Interface"};
 
 		std::list<Raid*> raidList;
@@ -41,9 +41,25 @@ void TalkActions::clear(bool fromLua) {
 		}
 	}
 
+	talkActionWords.clear();
+	for (const auto& [words, talkAction] : talkActions) {
+		talkActionWords.insert(words, &talkAction);
+	}
+
 	reInitState(fromLua);
 }
 
+size_t TalkActions::clearFile(const std::string& file) {
+	size_t count = clearFileMap(talkActions, file);
+	if (count != 0) {
+		talkActionWords.clear();
+		for (const auto& [words, talkAction] : talkActions) {
+			talkActionWords.insert(words, &talkAction);
+		}
+	}
+	return count;
+}
+
 LuaScriptInterface& TalkActions::getScriptInterface() {
 	return scriptInterface;
 }
@@ -61,59 +77,50 @@ Event_ptr TalkActions::getEvent(const std::string& nodeName) {
 
 bool TalkActions::registerEvent(Event_ptr event, const pugi::xml_node&) {
 	TalkAction_ptr talkAction{static_cast<TalkAction*>(event.release())}; // event is guaranteed to be a TalkAction
-	std::vector<std::string> words = talkAction->getWordsMap();
-
-	for (size_t i = 0; i < words.size(); i++) {
-		if (i == words.size() - 1) {
-			talkActions.emplace(words[i], std::move(*talkAction));
-		} else {
-			talkActions.emplace(words[i], *talkAction);
-		}
-	}
-
+	addTalkActions(std::move(talkAction));
 	return true;
 }
 
 bool TalkActions::registerLuaEvent(TalkAction* event) {
 	TalkAction_ptr talkAction{ event };
+	addTalkActions(std::move(talkAction));
+	return true;
+}
+
+void TalkActions::addTalkActions(TalkAction_ptr talkAction) {
 	std::vector<std::string> words = talkAction->getWordsMap();
 
 	for (size_t i = 0; i < words.size(); i++) {
+		std::pair<std::map<std::string, TalkAction>::iterator, bool> result;
 		if (i == words.size() - 1) {
-			talkActions.emplace(words[i], std::move(*talkAction));
+			result = talkActions.emplace(words[i], std::move(*talkAction));
 		} else {
-			talkActions.emplace(words[i], *talkAction);
+			result = talkActions.emplace(words[i], *talkAction);
 		}
-	}
 
-	return true;
+		if (result.second) {
+			talkActionWords.insert(result.first->first, &result.first->second);
+		}
+	}
 }
 
 TalkActionResult_t TalkActions::playerSaySpell(Player* player, SpeakClasses type, const std::string& words) const {
 	size_t wordsLength = words.length();
-	for (auto it = talkActions.begin(); it != talkActions.end(); ) {
-		const std::string& talkactionWords = it->first;
-		size_t talkactionLength = talkactionWords.length();
-		if (wordsLength < talkactionLength || strncasecmp(words.c_str(), talkactionWords.c_str(), talkactionLength) != 0) {
-			++it;
-			continue;
-		}
-
+	TalkActionResult_t result = TALKACTION_CONTINUE;
+	talkActionWords.forEachPrefix(words, [&](size_t talkactionLength, const TalkAction* talkAction) {
 		std::string param;
 		if (wordsLength != talkactionLength) {
-			param = words.substr(talkactionLength);
-			if (param.front() != ' ') {
-				++it;
-				continue;
+			if (words[talkactionLength] != ' ') {
+				return false;
 			}
+			param = words.substr(talkactionLength);
 			trim_left(param, ' ');
 
-			std::string separator = it->second.getSeparator();
+			std::string separator = talkAction->getSeparator();
 			if (separator != " ") {
 				if (!param.empty()) {
 					if (param != separator) {
-						++it;
-						continue;
+						return false;
 					} else {
 						param.erase(param.begin());
 					}
@@ -121,13 +128,10 @@ TalkActionResult_t TalkActions::playerSaySpell(Player* player, SpeakClasses type
 			}
 		}
 
-		if (it->second.executeSay(player, words, param, type)) {
-			return TALKACTION_CONTINUE;
-		} else {
-			return TALKACTION_BREAK;
-		}
-	}
-	return TALKACTION_CONTINUE;
+		result = talkAction->executeSay(player, words, param, type) ? TALKACTION_CONTINUE : TALKACTION_BREAK;
+		return true;
+	});
+	return result;
 }
 
 bool TalkAction::configureEvent(const pugi::xml_node& node) {
@@ -170,7 +174,7 @@ bool TalkAction::executeSay(Player* player, const std::string& words, const std:
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, words);
 	LuaScriptInterface::pushString(L, param);
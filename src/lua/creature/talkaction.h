@@ -24,6 +24,7 @@
 #include "utils/utils_definitions.hpp"
 #include "declarations.hpp"
 #include "lua/scripts/luascript.h"
+#include "utils/word_trie.hpp"
 
 class TalkAction;
 using TalkAction_ptr = std::unique_ptr<TalkAction>;
@@ -83,14 +84,18 @@ class TalkActions final : public BaseEvents {
 
 		bool registerLuaEvent(TalkAction* event);
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 
 	private:
 		LuaScriptInterface& getScriptInterface() override;
 		std::string getScriptBaseName() const override;
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
+		void addTalkActions(TalkAction_ptr talkAction);
 
 		std::map<std::string, TalkAction> talkActions;
+		// words of talkActions, pointing into the map
+		WordTrie<const TalkAction*> talkActionWords;
 
 		LuaScriptInterface scriptInterface;
 };
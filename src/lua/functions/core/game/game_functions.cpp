@@ -20,6 +20,9 @@
 #include "pch.hpp"
 
 #include "creatures/monsters/monster.h"
+#include "creatures/monsters/monster_type_cache.hpp"
+#include "database/database_stats.hpp"
+#include "game/experience_stages.hpp"
 #include "game/game.h"
 #include "items/item.h"
 #include "io/iobestiary.h"
@@ -28,7 +31,9 @@
 #include "game/scheduling/tasks.h"
 #include "lua/functions/creatures/npc/npc_type_functions.hpp"
 #include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/lua_profiler.hpp"
 #include "lua/scripts/scripts.h"
+#include "utils/memory_accounting.hpp"
 
 // Game
 int GameFunctions::luaGameCreateMonsterType(lua_State* L) {
@@ -45,6 +50,7 @@ int GameFunctions::luaGameCreateMonsterType(lua_State* L) {
 		}
 
 		monsterType->nameDescription = "a " + name;
+		g_monsterTypeCache().onCreateMonsterType(name, monsterType);
 		pushUserdata<MonsterType>(L, monsterType);
 		setMetatable(L, -1, "MonsterType");
 	} else {
@@ -76,7 +82,9 @@ int GameFunctions::luaGameGetSpectators(lua_State* L) {
 	int32_t minRangeY = getNumber<int32_t>(L, 6, 0);
 	int32_t maxRangeY = getNumber<int32_t>(L, 7, 0);
 
-	SpectatorHashSet spectators;
+	// kept between calls, the usual small results reuse its buckets instead of allocating
+	static SpectatorHashSet spectators;
+	spectators.clear();
 	g_game().map.getSpectators(spectators, position, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
 
 	lua_createtable(L, spectators.size(), 0);
@@ -150,7 +158,7 @@ int GameFunctions::luaGameGetPlayers(lua_State* L) {
 	int index = 0;
 	for (const auto& playerEntry : g_game().getPlayers()) {
 		pushUserdata<Player>(L, playerEntry.second);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -387,7 +395,7 @@ int GameFunctions::luaGameCreateContainer(lua_State* L) {
 	}
 
 	pushUserdata<Container>(L, container);
-	setMetatable(L, -1, "Container");
+	setMetatable(L, -1, LuaData_Container);
 	return 1;
 }
 
@@ -413,7 +421,7 @@ int GameFunctions::luaGameCreateMonster(lua_State* L) {
 	bool force = getBoolean(L, 4, false);
 	if (g_game().placeCreature(monster, position, extended, force)) {
 		pushUserdata<Monster>(L, monster);
-		setMetatable(L, -1, "Monster");
+		setMetatable(L, -1, LuaData_Monster);
 	} else {
 		if (isSummon) {
 			monster->setMaster(nullptr);
@@ -433,7 +441,7 @@ int GameFunctions::luaGameGenerateNpc(lua_State* L) {
 		return 1;
 	} else {
 		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		setMetatable(L, -1, LuaData_Npc);
 	}
 	return 1;
 }
@@ -451,7 +459,7 @@ int GameFunctions::luaGameCreateNpc(lua_State* L) {
 	bool force = getBoolean(L, 4, false);
 	if (g_game().placeCreature(npc, position, extended, force)) {
 		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		setMetatable(L, -1, LuaData_Npc);
 	} else {
 		delete npc;
 		lua_pushnil(L);
@@ -464,7 +472,7 @@ int GameFunctions::luaGameCreateTile(lua_State* L) {
 	// Game.createTile(position[, isDynamic = false])
 	Position position;
 	bool isDynamic;
-	if (isTable(L, 1)) {
+	if (isPosition(L, 1)) {
 		position = getPosition(L, 1);
 		isDynamic = getBoolean(L, 2, false);
 	} else {
@@ -486,13 +494,40 @@ int GameFunctions::luaGameCreateTile(lua_State* L) {
 	}
 
 	pushUserdata(L, tile);
-	setMetatable(L, -1, "Tile");
+	setMetatable(L, -1, LuaData_Tile);
+	return 1;
+}
+
+int GameFunctions::luaGameCreateMapInstance(lua_State* L) {
+	// Game.createMapInstance(fromPosition, toPosition)
+	Position origin;
+	uint32_t instanceId = g_game().map.getInstances().create(getPosition(L, 1), getPosition(L, 2), origin);
+	if (instanceId == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	// fromPosition is at origin in the instance
+	lua_pushnumber(L, instanceId);
+	pushPosition(L, origin);
+	return 2;
+}
+
+int GameFunctions::luaGameDestroyMapInstance(lua_State* L) {
+	// Game.destroyMapInstance(instanceId)
+	pushBoolean(L, g_game().map.getInstances().destroy(getNumber<uint32_t>(L, 1)));
+	return 1;
+}
+
+int GameFunctions::luaGameGetMapInstance(lua_State* L) {
+	// Game.getMapInstance(position)
+	lua_pushnumber(L, g_game().map.getInstances().getInstanceId(getPosition(L, 1)));
 	return 1;
 }
 
 int GameFunctions::luaGameGetBestiaryCharm(lua_State* L) {
 	// Game.getBestiaryCharm()
-	std::vector<Charm*> c_list = g_game().getCharmList();
+	const std::vector<Charm*>& c_list = g_game().getCharmList();
 	lua_createtable(L, c_list.size(), 0);
 
 	int index = 0;
@@ -579,10 +614,10 @@ int GameFunctions::luaGameReload(lua_State* L) {
 
 	if (reloadType == RELOAD_TYPE_GLOBAL) {
 		pushBoolean(L, g_luaEnvironment.loadFile("data/global.lua") == 0);
-		pushBoolean(L, g_luaEnvironment.loadFile("data/stages.lua") == 0);
+		pushBoolean(L, g_experienceStages().loadFromLua());
 		pushBoolean(L, g_scripts().loadScripts("scripts/lib", true, true));
 	} else if (reloadType == RELOAD_TYPE_STAGES) {
-		pushBoolean(L, g_luaEnvironment.loadFile("data/stages.lua") == 0);
+		pushBoolean(L, g_experienceStages().loadFromLua());
 	} else {
 		pushBoolean(L, g_game().reload(reloadType));
 	}
@@ -613,8 +648,90 @@ int GameFunctions::luaGameGetOfflinePlayer(lua_State* L) {
 		lua_pushnil(L);
 	} else {
 		pushUserdata<Player>(L, offlinePlayer);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
+	}
+
+	return 1;
+}
+
+int GameFunctions::luaGameSetDatabaseStats(lua_State* L) {
+	// Game.setDatabaseStats(enabled)
+	g_databaseStats().setEnabled(getBoolean(L, 1));
+	pushBoolean(L, true);
+	return 1;
+}
+
+int GameFunctions::luaGameReportDatabaseStats(lua_State* L) {
+	// Game.reportDatabaseStats([reset = false])
+	g_databaseStats().report();
+	if (getBoolean(L, 1, false)) {
+		g_databaseStats().reset();
 	}
+	pushBoolean(L, g_databaseStats().isEnabled());
+	return 1;
+}
 
+int GameFunctions::luaGameSetLuaProfiler(lua_State* L) {
+	// Game.setLuaProfiler(enabled)
+	g_luaProfiler().setEnabled(getBoolean(L, 1));
+	pushBoolean(L, true);
+	return 1;
+}
+
+int GameFunctions::luaGameReportLuaProfiler(lua_State* L) {
+	// Game.reportLuaProfiler([foldedStacksFile = ""[, reset = false]])
+	g_luaProfiler().report();
+	const std::string& fileName = getString(L, 1);
+	if (!fileName.empty() && !g_luaProfiler().writeFoldedStacks(fileName)) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (getBoolean(L, 2, false)) {
+		g_luaProfiler().reset();
+	}
+	pushBoolean(L, g_luaProfiler().isEnabled());
+	return 1;
+}
+
+int GameFunctions::luaGameGetExperienceStage(lua_State* L) {
+	// Game.getExperienceStage(level)
+	lua_pushnumber(L, g_experienceStages().getRate(getNumber<uint32_t>(L, 1)));
+	return 1;
+}
+
+int GameFunctions::luaGameAddOfflineReward(lua_State* L) {
+	// Game.addOfflineReward(playerGuid, timestamp, {{itemId, count}, ...})
+	uint32_t guid = getNumber<uint32_t>(L, 1);
+	uint32_t timestamp = getNumber<uint32_t>(L, 2);
+	if (g_game().getPlayerByGUID(guid)) {
+		// online players get the items in their reward container
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	std::vector<std::pair<uint16_t, uint16_t>> loot;
+	if (isTable(L, 3)) {
+		lua_pushnil(L);
+		while (lua_next(L, 3) != 0) {
+			if (isTable(L, -1)) {
+				lua_rawgeti(L, -1, 1);
+				lua_rawgeti(L, -2, 2);
+				loot.emplace_back(getNumber<uint16_t>(L, -2), isNumber(L, -1) ? getNumber<uint16_t>(L, -1) : 1);
+				lua_pop(L, 2);
+			}
+			lua_pop(L, 1);
+		}
+	}
+
+	IOLoginData::addOfflineReward(guid, timestamp, loot);
+	pushBoolean(L, true);
+	return 1;
+}
+
+int GameFunctions::luaGameReportMemory(lua_State* L) {
+	// Game.reportMemory()
+	MemoryAccounting::report();
+	pushBoolean(L, true);
 	return 1;
 }
@@ -60,6 +60,9 @@ class GameFunctions final : LuaScriptInterface {
 				registerMethod(L, "Game", "createNpc", GameFunctions::luaGameCreateNpc);
 				registerMethod(L, "Game", "generateNpc", GameFunctions::luaGameGenerateNpc);
 				registerMethod(L, "Game", "createTile", GameFunctions::luaGameCreateTile);
+				registerMethod(L, "Game", "createMapInstance", GameFunctions::luaGameCreateMapInstance);
+				registerMethod(L, "Game", "destroyMapInstance", GameFunctions::luaGameDestroyMapInstance);
+				registerMethod(L, "Game", "getMapInstance", GameFunctions::luaGameGetMapInstance);
 				registerMethod(L, "Game", "createBestiaryCharm", GameFunctions::luaGameCreateBestiaryCharm);
 
 				registerMethod(L, "Game", "createItemClassification", GameFunctions::luaGameCreateItemClassification);
@@ -75,6 +78,14 @@ class GameFunctions final : LuaScriptInterface {
 				registerMethod(L, "Game", "hasDistanceEffect", GameFunctions::luaGameHasDistanceEffect);
 				registerMethod(L, "Game", "hasEffect", GameFunctions::luaGameHasEffect);
 				registerMethod(L, "Game", "getOfflinePlayer", GameFunctions::luaGameGetOfflinePlayer);
+
+				registerMethod(L, "Game", "setDatabaseStats", GameFunctions::luaGameSetDatabaseStats);
+				registerMethod(L, "Game", "reportDatabaseStats", GameFunctions::luaGameReportDatabaseStats);
+				registerMethod(L, "Game", "setLuaProfiler", GameFunctions::luaGameSetLuaProfiler);
+				registerMethod(L, "Game", "reportLuaProfiler", GameFunctions::luaGameReportLuaProfiler);
+				registerMethod(L, "Game", "reportMemory", GameFunctions::luaGameReportMemory);
+				registerMethod(L, "Game", "getExperienceStage", GameFunctions::luaGameGetExperienceStage);
+				registerMethod(L, "Game", "addOfflineReward", GameFunctions::luaGameAddOfflineReward);
 			}
 
 	private:
@@ -111,6 +122,9 @@ class GameFunctions final : LuaScriptInterface {
 			static int luaGameGenerateNpc(lua_State* L);
 			static int luaGameCreateNpc(lua_State* L);
 			static int luaGameCreateTile(lua_State* L);
+			static int luaGameCreateMapInstance(lua_State* L);
+			static int luaGameDestroyMapInstance(lua_State* L);
+			static int luaGameGetMapInstance(lua_State* L);
 
 			static int luaGameGetBestiaryCharm(lua_State* L);
 			static int luaGameCreateBestiaryCharm(lua_State* L);
@@ -126,6 +140,14 @@ class GameFunctions final : LuaScriptInterface {
 			static int luaGameGetOfflinePlayer(lua_State* L);
 			static int luaGameHasEffect(lua_State* L);
 			static int luaGameHasDistanceEffect(lua_State* L);
+
+			static int luaGameSetDatabaseStats(lua_State* L);
+			static int luaGameReportDatabaseStats(lua_State* L);
+			static int luaGameSetLuaProfiler(lua_State* L);
+			static int luaGameReportLuaProfiler(lua_State* L);
+			static int luaGameReportMemory(lua_State* L);
+			static int luaGameGetExperienceStage(lua_State* L);
+			static int luaGameAddOfflineReward(lua_State* L);
 };
 
 #endif  // SRC_LUA_FUNCTIONS_CORE_GAME_GAME_FUNCTIONS_HPP_
@@ -574,7 +574,7 @@ int GlobalFunctions::luaAddEvent(lua_State* L) {
 			lua_rawgeti(L, -1, 't');
 
 			LuaDataType type = getNumber<LuaDataType>(L, -1);
-			if (type != LuaData_Unknown && type != LuaData_Tile) {
+			if (type != LuaData_Unknown && type != LuaData_Tile && type != LuaData_Position) {
 				indexes.push_back({i, type});
 			}
 			lua_pop(globalState, 2);
@@ -639,24 +639,22 @@ int GlobalFunctions::luaAddEvent(lua_State* L) {
 		}
 	}
 
-	LuaTimerEventDesc eventDesc;
-	for (int i = 0; i < parameters - 2; ++i) { // -2 because addEvent needs at least two parameters
-		eventDesc.parameters.push_back(luaL_ref(globalState, LUA_REGISTRYINDEX));
-	}
-
-	uint32_t delay = std::max<uint32_t>(100, getNumber<uint32_t>(globalState, 2));
-	lua_pop(globalState, 1);
+	uint32_t parameterCount = parameters - 2; // -2 because addEvent needs at least two parameters
+	uint32_t delay = std::max<uint32_t>(100, getNumber<uint32_t>(globalState, -parameters + 1));
 
-	eventDesc.function = luaL_ref(globalState, LUA_REGISTRYINDEX);
-	eventDesc.scriptId = getScriptEnv()->getScriptId();
-
-	auto& lastTimerEventId = g_luaEnvironment.lastEventTimerId;
-	eventDesc.eventId = g_scheduler().addEvent(createSchedulerTask(
-					delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId)
-	));
+	// one registry reference for {callback, parameters...}
+	lua_createtable(globalState, parameterCount + 1, 0);
+	lua_pushvalue(globalState, -parameters - 1);
+	lua_rawseti(globalState, -2, 1);
+	for (uint32_t i = 0; i < parameterCount; ++i) {
+		lua_pushvalue(globalState, -static_cast<int32_t>(parameterCount) - 1 + i);
+		lua_rawseti(globalState, -2, i + 2);
+	}
+	int32_t ref = luaL_ref(globalState, LUA_REGISTRYINDEX);
+	lua_pop(globalState, parameters);
 
-	g_luaEnvironment.timerEvents.emplace(lastTimerEventId, std::move(eventDesc));
-	lua_pushnumber(L, lastTimerEventId++);
+	uint32_t eventId = g_luaEnvironment.addTimerEvent(getScriptEnv()->getScriptId(), ref, parameterCount, delay);
+	lua_pushnumber(L, eventId);
 	return 1;
 }
 
@@ -669,26 +667,7 @@ int GlobalFunctions::luaStopEvent(lua_State* L) {
 		return 1;
 	}
 
-	uint32_t eventId = getNumber<uint32_t>(L, 1);
-
-	auto& timerEvents = g_luaEnvironment.timerEvents;
-	auto it = timerEvents.find(eventId);
-	if (it == timerEvents.end()) {
-		pushBoolean(L, false);
-		return 1;
-	}
-
-	LuaTimerEventDesc timerEventDesc = std::move(it->second);
-	timerEvents.erase(it);
-
-	g_scheduler().stopEvent(timerEventDesc.eventId);
-	luaL_unref(globalState, LUA_REGISTRYINDEX, timerEventDesc.function);
-
-	for (auto parameter : timerEventDesc.parameters) {
-		luaL_unref(globalState, LUA_REGISTRYINDEX, parameter);
-	}
-
-	pushBoolean(L, true);
+	pushBoolean(L, g_luaEnvironment.stopTimerEvent(getNumber<uint32_t>(L, 1)));
 	return 1;
 }
 
@@ -821,6 +821,7 @@ class LuaEnums final : LuaScriptInterface {
 			registerEnum(L, TILESTATE_FLOORCHANGE_SOUTH_ALT)
 			registerEnum(L, TILESTATE_FLOORCHANGE_EAST_ALT)
 			registerEnum(L, TILESTATE_SUPPORTS_HANGABLE)
+			registerEnum(L, TILESTATE_MOVEEVENT)
 
 			registerEnum(L, WEAPON_NONE)
 			registerEnum(L, WEAPON_SWORD)
@@ -1003,6 +1004,7 @@ class LuaEnums final : LuaScriptInterface {
 			registerEnum(L, RELOAD_TYPE_RAIDS)
 			registerEnum(L, RELOAD_TYPE_SCRIPTS)
 			registerEnum(L, RELOAD_TYPE_STAGES)
+			registerEnum(L, RELOAD_TYPE_CHANGED_SCRIPTS)
 
 			registerEnum(L, ZONE_PROTECTION)
 			registerEnum(L, ZONE_NOPVP)
@@ -25,6 +25,7 @@
 #include "lua/functions/core/libs/db_functions.hpp"
 #include "lua/functions/core/libs/result_functions.hpp"
 #include "lua/functions/core/libs/spdlog_functions.hpp"
+#include "lua/functions/core/libs/worker_functions.hpp"
 
 class CoreLibsFunctions final : LuaScriptInterface {
 	public:
@@ -33,6 +34,7 @@ class CoreLibsFunctions final : LuaScriptInterface {
 			DBFunctions::init(L);
 			ResultFunctions::init(L);
 			SpdlogFunctions::init(L);
+			WorkerFunctions::init(L);
 		}
 
 	private:
@@ -30,8 +30,12 @@ int DBFunctions::luaDatabaseExecute(lua_State* L) {
 }
 
 int DBFunctions::luaDatabaseAsyncExecute(lua_State* L) {
+	// db.asyncQuery(query[, callback[, orderKey]])
+	std::string query = getString(L, 1);
+	uint32_t orderKey = getNumber<uint32_t>(L, 3, 0);
 	std::function<void(DBResult_ptr, bool)> callback;
-	if (lua_gettop(L) > 1) {
+	if (isFunction(L, 2)) {
+		lua_pushvalue(L, 2);
 		int32_t ref = luaL_ref(L, LUA_REGISTRYINDEX);
 		auto scriptId = getScriptEnv()->getScriptId();
 		callback = [ref, scriptId](DBResult_ptr, bool success) {
@@ -54,7 +58,7 @@ int DBFunctions::luaDatabaseAsyncExecute(lua_State* L) {
 				luaL_unref(luaState, LUA_REGISTRYINDEX, ref);
 		};
 	}
-	g_databaseTasks().addTask(getString(L, -1), callback);
+	g_databaseTasks().addTask(std::move(query), callback, false, orderKey);
 	return 0;
 }
 
@@ -68,8 +72,12 @@ int DBFunctions::luaDatabaseStoreQuery(lua_State* L) {
 }
 
 int DBFunctions::luaDatabaseAsyncStoreQuery(lua_State* L) {
+	// db.asyncStoreQuery(query[, callback[, orderKey]])
+	std::string query = getString(L, 1);
+	uint32_t orderKey = getNumber<uint32_t>(L, 3, 0);
 	std::function<void(DBResult_ptr, bool)> callback;
-	if (lua_gettop(L) > 1) {
+	if (isFunction(L, 2)) {
+		lua_pushvalue(L, 2);
 		int32_t ref = luaL_ref(L, LUA_REGISTRYINDEX);
 		auto scriptId = getScriptEnv()->getScriptId();
 		callback = [ref, scriptId](DBResult_ptr result, bool) {
@@ -96,7 +104,7 @@ int DBFunctions::luaDatabaseAsyncStoreQuery(lua_State* L) {
 				luaL_unref(luaState, LUA_REGISTRYINDEX, ref);
 		};
 	}
-	g_databaseTasks().addTask(getString(L, -1), callback, true);
+	g_databaseTasks().addTask(std::move(query), callback, true, orderKey);
 	return 0;
 }
 
@@ -28,8 +28,7 @@ int ResultFunctions::luaResultGetNumber(lua_State* L) {
 		return 1;
 	}
 
-	const std::string& s = getString(L, 2);
-	lua_pushnumber(L, res->getNumber<int64_t>(s));
+	lua_pushnumber(L, res->getNumber<int64_t>(getStringView(L, 2)));
 	return 1;
 }
 
@@ -40,8 +39,7 @@ int ResultFunctions::luaResultGetString(lua_State* L) {
 		return 1;
 	}
 
-	const std::string& s = getString(L, 2);
-	pushString(L, res->getString(s));
+	pushString(L, res->getString(getStringView(L, 2)));
 	return 1;
 }
 
@@ -53,7 +51,7 @@ int ResultFunctions::luaResultGetStream(lua_State* L) {
 	}
 
 	unsigned long length;
-	const char* stream = res->getStream(getString(L, 2), length);
+	const char* stream = res->getStream(getStringView(L, 2), length);
 	lua_pushlstring(L, stream, length);
 	lua_pushnumber(L, length);
 	return 2;
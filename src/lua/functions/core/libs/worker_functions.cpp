@@ -0,0 +1,89 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "lua/functions/core/libs/worker_functions.hpp"
+#include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/lua_workers.hpp"
+
+int WorkerFunctions::luaWorkerRun(lua_State* L) {
+	// worker.run(function, callback[, ...])
+	// callback(true, results...) or callback(false, errorMessage)
+	std::string bytecode;
+	std::string error;
+	if (!LuaWorkers::dumpFunction(L, 1, bytecode, error)) {
+		reportErrorFunc(error);
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	if (!isFunction(L, 2)) {
+		reportErrorFunc("The callback must be a function");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	std::string arguments;
+	if (!LuaWorkers::serializeValues(L, 3, arguments, error)) {
+		reportErrorFunc(error);
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	lua_pushvalue(L, 2);
+	int32_t ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	auto scriptId = getScriptEnv()->getScriptId();
+	auto callback = [ref, scriptId](bool success, const std::string& result) {
+		lua_State* luaState = g_luaEnvironment.getLuaState();
+		if (!luaState) {
+			return;
+		}
+
+		if (!WorkerFunctions::reserveScriptEnv()) {
+			luaL_unref(luaState, LUA_REGISTRYINDEX, ref);
+			return;
+		}
+
+		lua_rawgeti(luaState, LUA_REGISTRYINDEX, ref);
+		pushBoolean(luaState, success);
+		int32_t count = 1;
+		if (success) {
+			count += LuaWorkers::pushValues(luaState, result);
+		} else {
+			pushString(luaState, result);
+			++count;
+		}
+		auto env = getScriptEnv();
+		env->setScriptId(scriptId, &g_luaEnvironment);
+		g_luaEnvironment.callFunction(count);
+
+		luaL_unref(luaState, LUA_REGISTRYINDEX, ref);
+	};
+
+	if (!g_luaWorkers().addJob(std::move(bytecode), std::move(arguments), std::move(callback))) {
+		luaL_unref(L, LUA_REGISTRYINDEX, ref);
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	pushBoolean(L, true);
+	return 1;
+}
@@ -159,7 +159,7 @@ int NetworkMessageFunctions::luaNetworkMessageAddU64(lua_State* L) {
 
 int NetworkMessageFunctions::luaNetworkMessageAddString(lua_State* L) {
 	// networkMessage:addString(string)
-	const std::string& string = getString(L, 2);
+	std::string_view string = getStringView(L, 2);
 	NetworkMessage* message = getUserdata<NetworkMessage>(L, 1);
 	if (message) {
 		message->addString(string);
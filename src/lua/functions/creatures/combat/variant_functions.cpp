@@ -25,14 +25,14 @@
 int VariantFunctions::luaVariantCreate(lua_State* L) {
 	// Variant(number or string or position or thing)
 	LuaVariant variant;
-	if (isUserdata(L, 2)) {
+	if (isPosition(L, 2)) {
+		variant.type = VARIANT_POSITION;
+		variant.pos = getPosition(L, 2);
+	} else if (isUserdata(L, 2)) {
 		if (Thing* thing = getThing(L, 2)) {
 			variant.type = VARIANT_TARGETPOSITION;
 			variant.pos = thing->getPosition();
 		}
-	} else if (isTable(L, 2)) {
-		variant.type = VARIANT_POSITION;
-		variant.pos = getPosition(L, 2);
 	} else if (isNumber(L, 2)) {
 		variant.type = VARIANT_NUMBER;
 		variant.number = getNumber<uint32_t>(L, 2);
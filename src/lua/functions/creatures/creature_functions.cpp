@@ -419,7 +419,7 @@ int CreatureFunctions::luaCreatureGetTile(lua_State* L) {
 	Tile* tile = creature->getTile();
 	if (tile) {
 		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		setMetatable(L, -1, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -894,7 +894,7 @@ int CreatureFunctions::luaCreatureGetPathTo(lua_State* L) {
 	fpp.maxSearchDist = getNumber<int32_t>(L, 7, fpp.maxSearchDist);
 
 	std::forward_list<Direction> dirList;
-	if (creature->getPathTo(position, dirList, fpp)) {
+	if (creature->getPathTo(position, dirList, fpp) || g_game().map.getLongPathMatching(creature->getPosition(), dirList, position, fpp)) {
 		lua_newtable(L);
 
 		int index = 0;
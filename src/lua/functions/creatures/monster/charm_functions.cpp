@@ -27,8 +27,7 @@ int CharmFunctions::luaCharmCreate(lua_State* L) {
 	// charm(id)
 	if (isNumber(L, 2)) {
 		charmRune_t charmid = getNumber<charmRune_t>(L, 2);
-		std::vector<Charm*> charmList = g_game().getCharmList();
-		for (auto& it : charmList) {
+		for (const auto& it : g_game().getCharmList()) {
 			Charm* charm = it;
 			if (charm->id == charmid) {
 				pushUserdata<Charm>(L, charm);
@@ -67,9 +67,9 @@ int LootFunctions::luaLootSetIdFromName(lua_State* L) {
 	Loot* loot = getUserdata<Loot>(L, 1);
 	if (loot && isString(L, 2)) {
 		auto name = getString(L, 2);
-		auto ids = Item::items.nameToItems.equal_range(asLowerCaseString(name));
+		auto ids = Item::items.getItemIdsByName(name);
 
-		if (ids.first == Item::items.nameToItems.cend()) {
+		if (ids.first == ids.second) {
 			SPDLOG_WARN("[LootFunctions::luaLootSetIdFromName] - "
 						"Unknown loot item {}", name);
 			lua_pushnil(L);
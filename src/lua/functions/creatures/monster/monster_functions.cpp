@@ -42,7 +42,7 @@ int MonsterFunctions::luaMonsterCreate(lua_State* L) {
 
 	if (monster) {
 		pushUserdata<Monster>(L, monster);
-		setMetatable(L, -1, "Monster");
+		setMetatable(L, -1, LuaData_Monster);
 	} else {
 		lua_pushnil(L);
 	}
@@ -20,6 +20,7 @@
 #include "pch.hpp"
 
 #include "creatures/combat/spells.h"
+#include "creatures/monsters/monster_type_cache.hpp"
 #include "creatures/monsters/monsters.h"
 #include "game/game.h"
 #include "lua/functions/creatures/monster/monster_type_functions.hpp"
@@ -773,6 +774,7 @@ int MonsterTypeFunctions::luaMonsterTypeAddAttack(lua_State* L) {
 			spellBlock_t sb;
 			if (g_monsters().deserializeSpell(spell, sb, monsterType->name)) {
 				monsterType->info.attackSpells.push_back(std::move(sb));
+				g_monsterTypeCache().onAddSpell(monsterType, *spell, true);
 			} else {
 				SPDLOG_WARN("Monster: {}, cant load spell: {}", monsterType->name,
 					spell->name);
@@ -836,6 +838,7 @@ int MonsterTypeFunctions::luaMonsterTypeAddDefense(lua_State* L) {
 			spellBlock_t sb;
 			if (g_monsters().deserializeSpell(spell, sb, monsterType->name)) {
 				monsterType->info.defenseSpells.push_back(std::move(sb));
+				g_monsterTypeCache().onAddSpell(monsterType, *spell, false);
 			} else {
 				SPDLOG_WARN("Monster: {}, Cant load spell: {}", monsterType->name,
 					spell->name);
@@ -948,7 +951,12 @@ int MonsterTypeFunctions::luaMonsterTypeGetLoot(lua_State* L) {
 		return 1;
 	}
 
-	createMonsterTypeLootLuaTable(L, monsterType->info.lootItems);
+	// the table is built once per monster type and shared by every kill, scripts must not modify it
+	if (monsterType->info.lootTableRef == -1) {
+		createMonsterTypeLootLuaTable(L, monsterType->info.lootItems);
+		monsterType->info.lootTableRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, monsterType->info.lootTableRef);
 	return 1;
 }
 
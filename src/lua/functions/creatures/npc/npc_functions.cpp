@@ -47,7 +47,7 @@ int NpcFunctions::luaNpcCreate(lua_State* L) {
 
 	if (npc) {
 		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		setMetatable(L, -1, LuaData_Npc);
 	} else {
 		lua_pushnil(L);
 	}
@@ -164,7 +164,7 @@ int NpcFunctions::luaNpcPlace(lua_State* L) {
 	bool force = getBoolean(L, 4, true);
 	if (g_game().placeCreature(npc, position, extended, force)) {
 		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		setMetatable(L, -1, LuaData_Npc);
 	} else {
 		lua_pushnil(L);
 	}
@@ -399,7 +399,7 @@ int NpcFunctions::luaNpcIsMerchant(lua_State* L) {
 		return 1;
 	}
 
-	const std::vector<ShopBlock> shopItems = npc->getShopItemVector();
+	const std::vector<ShopBlock> &shopItems = npc->getShopItemVector();
 
 	if (shopItems.empty()) {
 		pushBoolean(L, false);
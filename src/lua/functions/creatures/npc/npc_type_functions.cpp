@@ -130,6 +130,22 @@ int NpcTypeFunctions::luaNpcTypeCanPushCreatures(lua_State* L) {
 	return 1;
 }
 
+int NpcTypeFunctions::luaNpcTypeAlwaysThink(lua_State* L) {
+	// get: npcType:alwaysThink() set: npcType:alwaysThink(bool)
+	NpcType* npcType = getUserdata<NpcType>(L, 1);
+	if (npcType) {
+		if (lua_gettop(L) == 1) {
+			pushBoolean(L, npcType->info.alwaysThink);
+		} else {
+			npcType->info.alwaysThink = getBoolean(L, 2);
+			pushBoolean(L, true);
+		}
+	} else {
+		lua_pushnil(L);
+	}
+	return 1;
+}
+
 int32_t NpcTypeFunctions::luaNpcTypeName(lua_State* L) {
 	// get: npcType:name() set: npcType:name(name)
 	NpcType* npcType = getUserdata<NpcType>(L, 1);
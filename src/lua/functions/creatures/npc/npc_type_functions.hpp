@@ -35,6 +35,7 @@ class NpcTypeFunctions final : LuaScriptInterface {
 
 			registerMethod(L, "NpcType", "canPushItems", NpcTypeFunctions::luaNpcTypeCanPushItems);
 			registerMethod(L, "NpcType", "canPushCreatures", NpcTypeFunctions::luaNpcTypeCanPushCreatures);
+			registerMethod(L, "NpcType", "alwaysThink", NpcTypeFunctions::luaNpcTypeAlwaysThink);
 
 			registerMethod(L, "NpcType", "name", NpcTypeFunctions::luaNpcTypeName);
 
@@ -88,6 +89,7 @@ class NpcTypeFunctions final : LuaScriptInterface {
 
 		static int luaNpcTypeCanPushItems(lua_State* L);
 		static int luaNpcTypeCanPushCreatures(lua_State* L);
+		static int luaNpcTypeAlwaysThink(lua_State* L);
 
 		static int luaNpcTypeName(lua_State* L);
 		static int luaNpcTypeNameDescription(lua_State* L);
@@ -67,9 +67,9 @@ int ShopFunctions::luaShopSetIdFromName(lua_State* L) {
 	Shop* shop = getUserdata<Shop>(L, 1);
 	if (shop && isString(L, 2)) {
 		auto name = getString(L, 2);
-		auto ids = Item::items.nameToItems.equal_range(asLowerCaseString(name));
+		auto ids = Item::items.getItemIdsByName(name);
 
-		if (ids.first == Item::items.nameToItems.cend()) {
+		if (ids.first == ids.second) {
 			SPDLOG_WARN("[ShopFunctions::luaShopSetIdFromName] - "
 						"Unknown shop item {}", name);
 			lua_pushnil(L);
@@ -73,7 +73,7 @@ int GuildFunctions::luaGuildGetMembersOnline(lua_State* L) {
 	int index = 0;
 	for (Player* player : members) {
 		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
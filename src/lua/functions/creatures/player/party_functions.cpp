@@ -70,7 +70,7 @@ int PartyFunctions::luaPartyGetLeader(lua_State* L) {
 	Player* leader = party->getLeader();
 	if (leader) {
 		pushUserdata<Player>(L, leader);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -101,7 +101,7 @@ int PartyFunctions::luaPartyGetMembers(lua_State* L) {
 	lua_createtable(L, party->getMemberCount(), 0);
 	for (Player* player : party->getMembers()) {
 		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -127,7 +127,7 @@ int PartyFunctions::luaPartyGetInvitees(lua_State* L) {
 		int index = 0;
 		for (Player* player : party->getInvitees()) {
 			pushUserdata<Player>(L, player);
-			setMetatable(L, -1, "Player");
+			setMetatable(L, -1, LuaData_Player);
 			lua_rawseti(L, -2, ++index);
 		}
 	} else {
@@ -145,7 +145,7 @@ int PlayerFunctions::luaPlayerCreate(lua_State* L) {
 
 	if (player) {
 		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		setMetatable(L, -1, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -2680,16 +2680,16 @@ int PlayerFunctions::luaPlayerSetGhostMode(lua_State* L) {
 	}
 
 	if (player->isInGhostMode()) {
-		for (const auto& it : g_game().getPlayers()) {
-			if (!it.second->isAccessPlayer()) {
-				it.second->notifyStatusChange(player, VIPSTATUS_OFFLINE);
+		for (Player* watcher : g_game().getVipWatchers(player->getGUID())) {
+			if (!watcher->isAccessPlayer()) {
+				watcher->notifyStatusChange(player, VIPSTATUS_OFFLINE);
 			}
 		}
 		IOLoginData::updateOnlineStatus(player->getGUID(), false);
 	} else {
-		for (const auto& it : g_game().getPlayers()) {
-			if (!it.second->isAccessPlayer()) {
-				it.second->notifyStatusChange(player, player->statusVipList);
+		for (Player* watcher : g_game().getVipWatchers(player->getGUID())) {
+			if (!watcher->isAccessPlayer()) {
+				watcher->notifyStatusChange(player, player->statusVipList);
 			}
 		}
 		IOLoginData::updateOnlineStatus(player->getGUID(), true);
@@ -2726,7 +2726,7 @@ int PlayerFunctions::luaPlayerGetContainerById(lua_State* L) {
 	Container* container = player->getContainerByID(getNumber<uint8_t>(L, 2));
 	if (container) {
 		pushUserdata<Container>(L, container);
-		setMetatable(L, -1, "Container");
+		setMetatable(L, -1, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
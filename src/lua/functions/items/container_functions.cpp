@@ -30,7 +30,7 @@ int ContainerFunctions::luaContainerCreate(lua_State* L) {
 	Container* container = getScriptEnv()->getContainerByUID(id);
 	if (container) {
 		pushUserdata(L, container);
-		setMetatable(L, -1, "Container");
+		setMetatable(L, -1, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
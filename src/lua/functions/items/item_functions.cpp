@@ -324,7 +324,7 @@ int ItemFunctions::luaItemGetTile(lua_State* L) {
 	Tile* tile = item->getTile();
 	if (tile) {
 		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		setMetatable(L, -1, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -352,6 +352,18 @@ int ItemFunctions::luaItemHasAttribute(lua_State* L) {
 	return 1;
 }
 
+int ItemFunctions::luaItemGetAttributeMemory(lua_State* L) {
+	// item:getAttributeMemory()
+	const Item* item = getUserdata<const Item>(L, 1);
+	if (!item) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_pushnumber(L, item->getAttributeMemory());
+	return 1;
+}
+
 int ItemFunctions::luaItemGetAttribute(lua_State* L) {
 	// item:getAttribute(key)
 	Item* item = getUserdata<Item>(L, 1);
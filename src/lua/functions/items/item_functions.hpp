@@ -66,6 +66,7 @@ class ItemFunctions final : LuaScriptInterface {
 			registerMethod(L, "Item", "setAttribute", ItemFunctions::luaItemSetAttribute);
 			registerMethod(L, "Item", "removeAttribute", ItemFunctions::luaItemRemoveAttribute);
 			registerMethod(L, "Item", "getCustomAttribute", ItemFunctions::luaItemGetCustomAttribute);
+			registerMethod(L, "Item", "getAttributeMemory", ItemFunctions::luaItemGetAttributeMemory);
 			registerMethod(L, "Item", "setCustomAttribute", ItemFunctions::luaItemSetCustomAttribute);
 			registerMethod(L, "Item", "removeCustomAttribute", ItemFunctions::luaItemRemoveCustomAttribute);
 
@@ -134,6 +135,7 @@ class ItemFunctions final : LuaScriptInterface {
 		static int luaItemSetAttribute(lua_State* L);
 		static int luaItemRemoveAttribute(lua_State* L);
 		static int luaItemGetCustomAttribute(lua_State* L);
+		static int luaItemGetAttributeMemory(lua_State* L);
 		static int luaItemSetCustomAttribute(lua_State* L);
 		static int luaItemRemoveCustomAttribute(lua_State* L);
 
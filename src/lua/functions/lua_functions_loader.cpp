@@ -161,7 +161,7 @@ void LuaFunctionsLoader::pushCylinder(lua_State* L, Cylinder* cylinder) {
 		setItemMetatable(L, -1, parentItem);
 	} else if (Tile* tile = cylinder->getTile()) {
 		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		setMetatable(L, -1, LuaData_Tile);
 	} else if (cylinder == VirtualCylinder::virtualCylinder) {
 		pushBoolean(L, true);
 	} else {
@@ -197,6 +197,11 @@ void LuaFunctionsLoader::setMetatable(lua_State* L, int32_t index, const std::st
 	lua_setmetatable(L, index - 1);
 }
 
+void LuaFunctionsLoader::setMetatable(lua_State* L, int32_t index, LuaDataType type) {
+	lua_rawgeti(L, LUA_REGISTRYINDEX, metatableRefs[type]);
+	lua_setmetatable(L, index - 1);
+}
+
 void LuaFunctionsLoader::setWeakMetatable(lua_State* L, int32_t index, const std::string& name) {
 	static std::set<std::string> weakObjectTypes;
 	const std::string& weakName = name + "_weak";
@@ -233,24 +238,22 @@ void LuaFunctionsLoader::setWeakMetatable(lua_State* L, int32_t index, const std
 
 void LuaFunctionsLoader::setItemMetatable(lua_State* L, int32_t index, const Item* item) {
 	if (item->getContainer()) {
-		luaL_getmetatable(L, "Container");
+		setMetatable(L, index, LuaData_Container);
 	} else if (item->getTeleport()) {
-		luaL_getmetatable(L, "Teleport");
+		setMetatable(L, index, LuaData_Teleport);
 	} else {
-		luaL_getmetatable(L, "Item");
+		setMetatable(L, index, LuaData_Item);
 	}
-	lua_setmetatable(L, index - 1);
 }
 
 void LuaFunctionsLoader::setCreatureMetatable(lua_State* L, int32_t index, const Creature* creature) {
 	if (creature->getPlayer()) {
-		luaL_getmetatable(L, "Player");
+		setMetatable(L, index, LuaData_Player);
 	} else if (creature->getMonster()) {
-		luaL_getmetatable(L, "Monster");
+		setMetatable(L, index, LuaData_Monster);
 	} else {
-		luaL_getmetatable(L, "Npc");
+		setMetatable(L, index, LuaData_Npc);
 	}
-	lua_setmetatable(L, index - 1);
 }
 
 CombatDamage LuaFunctionsLoader::getCombatDamage(lua_State* L) {
@@ -275,6 +278,11 @@ std::string LuaFunctionsLoader::getString(lua_State* L, int32_t arg) {
 }
 
 Position LuaFunctionsLoader::getPosition(lua_State* L, int32_t arg, int32_t& stackpos) {
+	if (const LuaPosition* luaPosition = getLuaPosition(L, arg)) {
+		stackpos = luaPosition->stackpos;
+		return luaPosition->position;
+	}
+
 	Position position;
 	position.x = getField<uint16_t>(L, arg, "x");
 	position.y = getField<uint16_t>(L, arg, "y");
@@ -292,6 +300,10 @@ Position LuaFunctionsLoader::getPosition(lua_State* L, int32_t arg, int32_t& sta
 }
 
 Position LuaFunctionsLoader::getPosition(lua_State* L, int32_t arg) {
+	if (const LuaPosition* luaPosition = getLuaPosition(L, arg)) {
+		return luaPosition->position;
+	}
+
 	Position position;
 	position.x = getField<uint16_t>(L, arg, "x");
 	position.y = getField<uint16_t>(L, arg, "y");
@@ -301,6 +313,17 @@ Position LuaFunctionsLoader::getPosition(lua_State* L, int32_t arg) {
 	return position;
 }
 
+LuaPosition* LuaFunctionsLoader::getLuaPosition(lua_State* L, int32_t arg) {
+	if (lua_type(L, arg) != LUA_TUSERDATA || lua_getmetatable(L, arg) == 0) {
+		return nullptr;
+	}
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, metatableRefs[LuaData_Position]);
+	bool isPosition = lua_rawequal(L, -1, -2) != 0;
+	lua_pop(L, 2);
+	return isPosition ? static_cast<LuaPosition*>(lua_touserdata(L, arg)) : nullptr;
+}
+
 Outfit_t LuaFunctionsLoader::getOutfit(lua_State* L, int32_t arg) {
 	Outfit_t outfit;
 	outfit.lookMountFeet = getField<uint8_t>(L, arg, "lookMountFeet");
@@ -447,14 +470,12 @@ void LuaFunctionsLoader::pushInstantSpell(lua_State* L, const InstantSpell& spel
 }
 
 void LuaFunctionsLoader::pushPosition(lua_State* L, const Position& position, int32_t stackpos/* = 0*/) {
-	lua_createtable(L, 0, 4);
+	LuaPosition* luaPosition = static_cast<LuaPosition*>(lua_newuserdata(L, sizeof(LuaPosition)));
+	new (luaPosition) LuaPosition();
+	luaPosition->position = position;
+	luaPosition->stackpos = stackpos;
 
-	setField(L, "x", position.x);
-	setField(L, "y", position.y);
-	setField(L, "z", position.z);
-	setField(L, "stackpos", stackpos);
-
-	setMetatable(L, -1, "Position");
+	setMetatable(L, -1, LuaData_Position);
 }
 
 void LuaFunctionsLoader::pushOutfit(lua_State* L, const Outfit_t& outfit) {
@@ -523,26 +544,35 @@ void LuaFunctionsLoader::registerClass(lua_State* L, const std::string& classNam
 	lua_pushnumber(L, parents);
 	lua_rawseti(L, metatable, 'p');
 
-	// className.metatable['t'] = type
+	LuaDataType type = LuaData_Unknown;
 	if (className == "Item") {
-		lua_pushnumber(L, LuaData_Item);
+		type = LuaData_Item;
 	} else if (className == "Container") {
-		lua_pushnumber(L, LuaData_Container);
+		type = LuaData_Container;
 	} else if (className == "Teleport") {
-		lua_pushnumber(L, LuaData_Teleport);
+		type = LuaData_Teleport;
 	} else if (className == "Player") {
-		lua_pushnumber(L, LuaData_Player);
+		type = LuaData_Player;
 	} else if (className == "Monster") {
-		lua_pushnumber(L, LuaData_Monster);
+		type = LuaData_Monster;
 	} else if (className == "Npc") {
-		lua_pushnumber(L, LuaData_Npc);
+		type = LuaData_Npc;
 	} else if (className == "Tile") {
-		lua_pushnumber(L, LuaData_Tile);
-	} else {
-		lua_pushnumber(L, LuaData_Unknown);
+		type = LuaData_Tile;
+	} else if (className == "Position") {
+		type = LuaData_Position;
 	}
+
+	// className.metatable['t'] = type
+	lua_pushnumber(L, type);
 	lua_rawseti(L, metatable, 't');
 
+	if (type != LuaData_Unknown) {
+		// referenced by number for setMetatable(L, index, type)
+		lua_pushvalue(L, metatable);
+		metatableRefs[type] = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
 	// pop className, className.metatable
 	lua_pop(L, 2);
 }
@@ -36,6 +36,19 @@ class Thing;
 
 #define reportErrorFunc(a)  reportError(__FUNCTION__, a, true)
 
+/**
+ * Userdata behind a Lua position value.
+ * thing stays nullptr so getUserdata<T> on a position finds no object, as it did
+ * when positions were tables. Fields scripts set besides x, y, z and stackpos
+ * are kept in the userdata environment table, created on the first such write.
+ */
+struct LuaPosition {
+	void* thing = nullptr;
+	Position position;
+	int32_t stackpos = 0;
+	bool hasFields = false;
+};
+
 class LuaFunctionsLoader {
 	public:
 		static void load(lua_State* L);
@@ -62,6 +75,8 @@ class LuaFunctionsLoader {
 		}
 
 		static void setMetatable(lua_State* L, int32_t index, const std::string& name);
+		// Same as above for the classes with a LuaDataType, without looking the name up
+		static void setMetatable(lua_State* L, int32_t index, LuaDataType type);
 		static void setWeakMetatable(lua_State* L, int32_t index, const std::string& name);
 		static void setItemMetatable(lua_State* L, int32_t index, const Item* item);
 		static void setCreatureMetatable(lua_State* L, int32_t index, const Creature* creature);
@@ -116,9 +131,18 @@ class LuaFunctionsLoader {
 		}
 
 		static std::string getString(lua_State* L, int32_t arg);
+		// points into the Lua string, valid while the value stays on the stack
+		static std::string_view getStringView(lua_State* L, int32_t arg)
+		{
+			size_t length;
+			const char* str = lua_tolstring(L, arg, &length);
+			return str ? std::string_view(str, length) : std::string_view();
+		}
 		static CombatDamage getCombatDamage(lua_State* L);
 		static Position getPosition(lua_State* L, int32_t arg, int32_t& stackpos);
 		static Position getPosition(lua_State* L, int32_t arg);
+		// nullptr unless the value at arg is a position userdata
+		static LuaPosition* getLuaPosition(lua_State* L, int32_t arg);
 		static Outfit_t getOutfit(lua_State* L, int32_t arg);
 		static LuaVariant getVariant(lua_State* L, int32_t arg);
 
@@ -153,6 +177,11 @@ class LuaFunctionsLoader {
 		{
 			return lua_istable(L, arg);
 		}
+		// a position userdata or a table to read x, y and z from
+		static bool isPosition(lua_State* L, int32_t arg)
+		{
+			return lua_istable(L, arg) || getLuaPosition(L, arg) != nullptr;
+		}
 		static bool isFunction(lua_State* L, int32_t arg)
 		{
 			return lua_isfunction(L, arg);
@@ -213,6 +242,8 @@ class LuaFunctionsLoader {
 
 		static ScriptEnvironment scriptEnv[16];
 		static int32_t scriptEnvIndex;
+		// registry references of the class metatables by LuaDataType, set by registerClass
+		static std::array<int32_t, LuaData_Last> metatableRefs;
 };
 
 #endif
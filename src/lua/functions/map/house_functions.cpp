@@ -264,7 +264,7 @@ int HouseFunctions::luaHouseGetTiles(lua_State* L) {
 	int index = 0;
 	for (Tile* tile : tiles) {
 		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		setMetatable(L, -1, LuaData_Tile);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
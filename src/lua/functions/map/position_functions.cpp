@@ -23,6 +23,41 @@
 #include "game/movement/position.h"
 #include "lua/functions/map/position_functions.hpp"
 
+namespace {
+
+enum PositionField {
+	POSITION_FIELD_NONE,
+	POSITION_FIELD_X,
+	POSITION_FIELD_Y,
+	POSITION_FIELD_Z,
+	POSITION_FIELD_STACKPOS,
+};
+
+PositionField getPositionField(lua_State* L, int32_t arg)
+{
+	if (lua_type(L, arg) != LUA_TSTRING) {
+		return POSITION_FIELD_NONE;
+	}
+
+	size_t length;
+	const char* key = lua_tolstring(L, arg, &length);
+	if (length == 1) {
+		switch (key[0]) {
+			case 'x':
+				return POSITION_FIELD_X;
+			case 'y':
+				return POSITION_FIELD_Y;
+			case 'z':
+				return POSITION_FIELD_Z;
+			default:
+				return POSITION_FIELD_NONE;
+		}
+	}
+	return length == 8 && std::memcmp(key, "stackpos", 8) == 0 ? POSITION_FIELD_STACKPOS : POSITION_FIELD_NONE;
+}
+
+}  // namespace
+
 int PositionFunctions::luaPositionCreate(lua_State* L) {
 	// Position([x = 0[, y = 0[, z = 0[, stackpos = 0]]]])
 	// Position([position])
@@ -32,7 +67,7 @@ int PositionFunctions::luaPositionCreate(lua_State* L) {
 	}
 
 	int32_t stackpos;
-	if (isTable(L, 2)) {
+	if (isPosition(L, 2)) {
 		const Position& position = getPosition(L, 2, stackpos);
 		pushPosition(L, position, stackpos);
 	} else {
@@ -46,6 +81,78 @@ int PositionFunctions::luaPositionCreate(lua_State* L) {
 	return 1;
 }
 
+int PositionFunctions::luaPositionIndex(lua_State* L) {
+	// position[key], only ever called with a position userdata as first argument
+	const LuaPosition* luaPosition = static_cast<LuaPosition*>(lua_touserdata(L, 1));
+	switch (getPositionField(L, 2)) {
+		case POSITION_FIELD_X:
+			lua_pushnumber(L, luaPosition->position.x);
+			return 1;
+		case POSITION_FIELD_Y:
+			lua_pushnumber(L, luaPosition->position.y);
+			return 1;
+		case POSITION_FIELD_Z:
+			lua_pushnumber(L, luaPosition->position.z);
+			return 1;
+		case POSITION_FIELD_STACKPOS:
+			lua_pushnumber(L, luaPosition->stackpos);
+			return 1;
+		default:
+			break;
+	}
+
+	if (luaPosition->hasFields) {
+		lua_getfenv(L, 1);
+		lua_pushvalue(L, 2);
+		lua_rawget(L, -2);
+		if (!lua_isnil(L, -1)) {
+			return 1;
+		}
+		lua_pop(L, 2);
+	}
+
+	// Position.metatable.__metatable is the Position class table with the methods
+	lua_getmetatable(L, 1);
+	lua_getfield(L, -1, "__metatable");
+	lua_pushvalue(L, 2);
+	lua_gettable(L, -2);
+	return 1;
+}
+
+int PositionFunctions::luaPositionNewIndex(lua_State* L) {
+	// position[key] = value
+	LuaPosition* luaPosition = static_cast<LuaPosition*>(lua_touserdata(L, 1));
+	switch (getPositionField(L, 2)) {
+		case POSITION_FIELD_X:
+			luaPosition->position.x = getNumber<uint16_t>(L, 3);
+			return 0;
+		case POSITION_FIELD_Y:
+			luaPosition->position.y = getNumber<uint16_t>(L, 3);
+			return 0;
+		case POSITION_FIELD_Z:
+			luaPosition->position.z = getNumber<uint8_t>(L, 3);
+			return 0;
+		case POSITION_FIELD_STACKPOS:
+			luaPosition->stackpos = getNumber<int32_t>(L, 3);
+			return 0;
+		default:
+			break;
+	}
+
+	// any other field goes to the environment table, as it went to the position table before
+	if (!luaPosition->hasFields) {
+		lua_newtable(L);
+		lua_setfenv(L, 1);
+		luaPosition->hasFields = true;
+	}
+
+	lua_getfenv(L, 1);
+	lua_pushvalue(L, 2);
+	lua_pushvalue(L, 3);
+	lua_rawset(L, -3);
+	return 0;
+}
+
 int PositionFunctions::luaPositionAdd(lua_State* L) {
 	// positionValue = position + positionEx
 	int32_t stackpos;
@@ -113,7 +220,7 @@ int PositionFunctions::luaPositionGetPathTo(lua_State* L) {
 	fpp.maxSearchDist = getNumber<int32_t>(L, 7, fpp.maxSearchDist);
 
 	std::forward_list<Direction> dirList;
-	if (g_game().map.getPathMatching(pos, dirList, FrozenPathingConditionCall(position), fpp)) {
+	if (g_game().map.getPathMatching(pos, dirList, FrozenPathingConditionCall(position), fpp) || g_game().map.getLongPathMatching(pos, dirList, position, fpp)) {
 		lua_newtable(L);
 
 		int index = 0;
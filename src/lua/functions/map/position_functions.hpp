@@ -26,6 +26,8 @@ class PositionFunctions final : LuaScriptInterface {
 	public:
 		static void init(lua_State* L) {
 			registerClass(L, "Position", "", PositionFunctions::luaPositionCreate);
+			registerMetaMethod(L, "Position", "__index", PositionFunctions::luaPositionIndex);
+			registerMetaMethod(L, "Position", "__newindex", PositionFunctions::luaPositionNewIndex);
 			registerMetaMethod(L, "Position", "__add", PositionFunctions::luaPositionAdd);
 			registerMetaMethod(L, "Position", "__sub", PositionFunctions::luaPositionSub);
 			registerMetaMethod(L, "Position", "__eq", PositionFunctions::luaPositionCompare);
@@ -40,6 +42,8 @@ class PositionFunctions final : LuaScriptInterface {
 
 	private:
 		static int luaPositionCreate(lua_State* L);
+		static int luaPositionIndex(lua_State* L);
+		static int luaPositionNewIndex(lua_State* L);
 		static int luaPositionAdd(lua_State* L);
 		static int luaPositionSub(lua_State* L);
 		static int luaPositionCompare(lua_State* L);
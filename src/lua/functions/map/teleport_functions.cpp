@@ -31,7 +31,7 @@ int TeleportFunctions::luaTeleportCreate(lua_State* L) {
 	Item* item = getScriptEnv()->getItemByUID(id);
 	if (item && item->getTeleport()) {
 		pushUserdata(L, item);
-		setMetatable(L, -1, "Teleport");
+		setMetatable(L, -1, LuaData_Teleport);
 	} else {
 		lua_pushnil(L);
 	}
@@ -26,7 +26,7 @@ int TileFunctions::luaTileCreate(lua_State* L) {
 	// Tile(x, y, z)
 	// Tile(position)
 	Tile* tile;
-	if (isTable(L, 2)) {
+	if (isPosition(L, 2)) {
 		tile = g_game().map.getTile(getPosition(L, 2));
 	} else {
 		uint8_t z = getNumber<uint8_t>(L, 4);
@@ -37,7 +37,7 @@ int TileFunctions::luaTileCreate(lua_State* L) {
 
 	if (tile) {
 		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		setMetatable(L, -1, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
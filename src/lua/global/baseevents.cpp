@@ -93,7 +93,11 @@ void BaseEvents::reInitState(bool fromLua) {
 	}
 }
 
-Event::Event(LuaScriptInterface* interface) : scriptInterface(interface) {}
+Event::Event(LuaScriptInterface* interface) : scriptInterface(interface) {
+	if (interface) {
+		sourceFile = interface->getLoadingFile();
+	}
+}
 
 bool Event::checkScript(const std::string& basePath, const std::string&
 							scriptsName, const std::string& scriptFile) const {
@@ -101,6 +101,15 @@ class Event {
 			return scriptId;
 		}
 
+		/**
+        * @brief Get the script file that was loading when the event was created
+        *
+        * @return const std::string& Path as given to LuaScriptInterface::loadFile
+        */
+		const std::string& getSourceFile() const {
+			return sourceFile;
+		}
+
 		bool scripted = false;
 		bool fromLua = false;
 
@@ -109,6 +118,7 @@ class Event {
 
 		int32_t scriptId = 0;
 		LuaScriptInterface* scriptInterface = nullptr;
+		std::string sourceFile;
 };
 
 /**
@@ -158,6 +168,28 @@ class BaseEvents {
         */
 		void reInitState(bool fromLua);
 
+	protected:
+		/**
+        * @brief Erase the lua events of a map that were created by a script file
+        *
+        * @param map Event map, the events stored by value
+        * @param file Script file
+        * @return size_t Number of erased events
+        */
+		template <typename EventMap>
+		static size_t clearFileMap(EventMap& map, const std::string& file) {
+			size_t count = 0;
+			for (auto it = map.begin(); it != map.end(); ) {
+				if (it->second.fromLua && it->second.getSourceFile() == file) {
+					map.erase(it++);
+					++count;
+				} else {
+					++it;
+				}
+			}
+			return count;
+		}
+
 	private:
 		virtual LuaScriptInterface& getScriptInterface() = 0;
 		virtual std::string getScriptBaseName() const = 0;
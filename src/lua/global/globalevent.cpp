@@ -43,6 +43,11 @@ void GlobalEvents::clearMap(GlobalEventMap& map, bool fromLua) {
 	}
 }
 
+size_t GlobalEvents::clearFile(const std::string& file) {
+	// the think and timer events keep running, they just find fewer entries
+	return clearFileMap(thinkMap, file) + clearFileMap(serverMap, file) + clearFileMap(timerMap, file);
+}
+
 void GlobalEvents::clear(bool fromLua) {
 	g_scheduler().stopEvent(thinkEventId);
 	thinkEventId = 0;
@@ -53,6 +53,7 @@ class GlobalEvents final : public BaseEvents {
 
 		bool registerLuaEvent(GlobalEvent* event);
 		void clear(bool fromLua) override final;
+		size_t clearFile(const std::string& file);
 
 	private:
 		std::string getScriptBaseName() const override {
@@ -38,6 +38,10 @@ enum LuaDataType {
 	LuaData_Monster,
 	LuaData_Npc,
 	LuaData_Tile,
+	// a table rather than a userdata, only used to look up its cached metatable
+	LuaData_Position,
+
+	LuaData_Last
 };
 
 enum CreatureEventType_t {
@@ -203,12 +207,11 @@ struct LuaVariant {
 
 struct LuaTimerEventDesc {
 	int32_t scriptId = -1;
-	int32_t function = -1;
-	std::list<int32_t> parameters;
-	uint32_t eventId = 0;
-
-	LuaTimerEventDesc() = default;
-	LuaTimerEventDesc(LuaTimerEventDesc&& other) = default;
+	// registry reference to {function, parameters...}
+	int32_t ref = -1;
+	uint32_t parameterCount = 0;
+	// timer wheel tick the event is due at
+	int64_t tick = 0;
 };
 
 #endif  // SRC_LUA_LUA_DEFINITIONS_HPP_
@@ -0,0 +1,153 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "lua/scripts/lua_allocator.hpp"
+#include "utils/memory_accounting.hpp"
+
+std::array<LuaAllocator::FreeBlock*, LUA_ALLOCATOR_SIZE_CLASSES> LuaAllocator::freeLists = {};
+std::vector<char*> LuaAllocator::arenas;
+size_t LuaAllocator::arenaOffset = LUA_ALLOCATOR_ARENA_SIZE;
+LuaAllocatorStats LuaAllocator::stats;
+
+namespace {
+
+int luaAllocatorPanic(lua_State* L)
+{
+	SPDLOG_ERROR("[LuaAllocator] - Unprotected error in Lua call: {}", lua_tostring(L, -1));
+	return 0;
+}
+
+}  // namespace
+
+lua_State* LuaAllocator::newState()
+{
+	lua_State* L = lua_newstate(allocate, nullptr);
+	if (!L) {
+		// 64 bit LuaJIT without GC64 only works with its own allocator
+		SPDLOG_WARN("[LuaAllocator] - Lua refused the pooled allocator, using the default one");
+		return luaL_newstate();
+	}
+
+	lua_atpanic(L, luaAllocatorPanic);
+	return L;
+}
+
+void* LuaAllocator::allocate(void*, void* pointer, size_t oldSize, size_t newSize)
+{
+	// oldSize is only meaningful when there is an old block
+	if (!pointer) {
+		oldSize = 0;
+	}
+
+	if (newSize == 0) {
+		if (pointer) {
+			freeBlock(pointer, oldSize);
+			MemoryAccounting::deallocate(MEMORY_TAG_LUA, oldSize);
+		}
+		return nullptr;
+	}
+
+	if (pointer && oldSize > LUA_ALLOCATOR_MAX_SIZE && newSize > LUA_ALLOCATOR_MAX_SIZE) {
+		void* block = std::realloc(pointer, newSize);
+		if (block) {
+			stats.liveBytes += static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize);
+			++stats.allocations;
+			++stats.heapAllocations;
+			MemoryAccounting::resize(MEMORY_TAG_LUA, static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize));
+		}
+		return block;
+	}
+
+	if (pointer && newSize <= LUA_ALLOCATOR_MAX_SIZE && oldSize <= LUA_ALLOCATOR_MAX_SIZE && getSizeClass(oldSize) == getSizeClass(newSize)) {
+		// still fits the block it has
+		stats.liveBytes += static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize);
+		MemoryAccounting::resize(MEMORY_TAG_LUA, static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize));
+		return pointer;
+	}
+
+	void* block = allocateBlock(newSize);
+	if (!block) {
+		// Lua keeps the old block when growing fails
+		return nullptr;
+	}
+
+	if (pointer) {
+		std::memcpy(block, pointer, std::min(oldSize, newSize));
+		freeBlock(pointer, oldSize);
+		MemoryAccounting::resize(MEMORY_TAG_LUA, static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize));
+	} else {
+		MemoryAccounting::allocate(MEMORY_TAG_LUA, newSize);
+	}
+	return block;
+}
+
+void* LuaAllocator::allocateBlock(size_t size)
+{
+	++stats.allocations;
+	stats.liveBytes += size;
+
+	if (size > LUA_ALLOCATOR_MAX_SIZE) {
+		++stats.heapAllocations;
+		void* block = std::malloc(size);
+		if (!block) {
+			stats.liveBytes -= size;
+		}
+		return block;
+	}
+
+	size_t sizeClass = getSizeClass(size);
+	if (FreeBlock* block = freeLists[sizeClass]) {
+		freeLists[sizeClass] = block->next;
+		return block;
+	}
+
+	size_t blockSize = (sizeClass + 1) * LUA_ALLOCATOR_GRANULARITY;
+	if (arenaOffset + blockSize > LUA_ALLOCATOR_ARENA_SIZE) {
+		char* arena = static_cast<char*>(std::malloc(LUA_ALLOCATOR_ARENA_SIZE));
+		if (!arena) {
+			stats.liveBytes -= size;
+			return nullptr;
+		}
+		// the tail of the previous arena is too small for this class, it stays unused
+		arenas.push_back(arena);
+		arenaOffset = 0;
+		stats.arenaBytes += LUA_ALLOCATOR_ARENA_SIZE;
+	}
+
+	void* block = arenas.back() + arenaOffset;
+	arenaOffset += blockSize;
+	return block;
+}
+
+void LuaAllocator::freeBlock(void* pointer, size_t size)
+{
+	stats.liveBytes -= size;
+	if (size > LUA_ALLOCATOR_MAX_SIZE) {
+		std::free(pointer);
+		return;
+	}
+
+	size_t sizeClass = getSizeClass(size);
+	FreeBlock* block = static_cast<FreeBlock*>(pointer);
+	block->next = freeLists[sizeClass];
+	freeLists[sizeClass] = block;
+}
@@ -0,0 +1,92 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_LUA_SCRIPTS_LUA_ALLOCATOR_HPP_
+#define SRC_LUA_SCRIPTS_LUA_ALLOCATOR_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lua/scripts/luajit_sync.hpp"
+
+// blocks are rounded up to a multiple of this, one free list per multiple
+static constexpr size_t LUA_ALLOCATOR_GRANULARITY = 16;
+// strings, tables and closures of scripts are nearly all below this, larger blocks use the heap
+static constexpr size_t LUA_ALLOCATOR_MAX_SIZE = 256;
+static constexpr size_t LUA_ALLOCATOR_SIZE_CLASSES = LUA_ALLOCATOR_MAX_SIZE / LUA_ALLOCATOR_GRANULARITY;
+// pooled blocks are carved from arenas of this size, arenas are never given back
+static constexpr size_t LUA_ALLOCATOR_ARENA_SIZE = 256 * 1024;
+
+// dispatcher thread only, like the allocator
+struct LuaAllocatorStats {
+	// bytes Lua asked for and did not free yet
+	int64_t liveBytes = 0;
+	// allocations since the last report, pooled or not
+	uint64_t allocations = 0;
+	uint64_t heapAllocations = 0;
+	// bytes taken from the heap for arenas
+	uint64_t arenaBytes = 0;
+
+	void reset() {
+		allocations = 0;
+		heapAllocations = 0;
+	}
+};
+
+/**
+ * lua_Alloc of the LuaEnvironment state: blocks up to LUA_ALLOCATOR_MAX_SIZE
+ * come from per size class free lists carved out of large arenas, so the
+ * Position tables, event arguments and dialogue strings scripts create and
+ * drop all the time never reach malloc and free.
+ * There is no locking, the Lua state only ever runs on the dispatcher thread.
+ */
+class LuaAllocator
+{
+	public:
+		// as lua_newstate(allocate, nullptr), falls back to luaL_newstate if the Lua build refuses custom allocators
+		static lua_State* newState();
+
+		static void* allocate(void* userData, void* pointer, size_t oldSize, size_t newSize);
+
+		static LuaAllocatorStats& getStats() {
+			return stats;
+		}
+
+	private:
+		struct FreeBlock {
+			FreeBlock* next;
+		};
+
+		static size_t getSizeClass(size_t size) {
+			return (size - 1) / LUA_ALLOCATOR_GRANULARITY;
+		}
+
+		static void* allocateBlock(size_t size);
+		static void freeBlock(void* pointer, size_t size);
+
+		static std::array<FreeBlock*, LUA_ALLOCATOR_SIZE_CLASSES> freeLists;
+		static std::vector<char*> arenas;
+		static size_t arenaOffset;
+		static LuaAllocatorStats stats;
+};
+
+#endif  // SRC_LUA_SCRIPTS_LUA_ALLOCATOR_HPP_
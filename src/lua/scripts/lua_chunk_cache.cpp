@@ -0,0 +1,150 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "lua/scripts/lua_chunk_cache.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+// compiled chunks are tied to the VM that wrote them
+constexpr const char* LUA_CHUNK_CACHE_VERSION = LUAJIT_VERSION;
+// on hosts with fewer cores the loading thread waits for the workers anyway
+constexpr size_t LUA_CHUNK_CACHE_FILES_PER_THREAD = 16;
+
+boost::filesystem::path getCacheDirectory()
+{
+	return getCachePath("lua", (boost::filesystem::current_path() / "cache" / "lua").string());
+}
+
+bool readFile(const boost::filesystem::path& path, std::string& contents)
+{
+	std::ifstream file(path.string(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+int writeChunk(lua_State*, const void* data, size_t size, void* userdata)
+{
+	static_cast<std::string*>(userdata)->append(static_cast<const char*>(data), size);
+	return 0;
+}
+
+}  // namespace
+
+void LuaChunkCache::prepare(const std::vector<boost::filesystem::path>& files)
+{
+	const bool useDisk = g_configManager().getBoolean(LUA_BYTECODE_CACHE);
+	std::vector<std::string> bytecode(files.size());
+	std::atomic<size_t> next {0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < files.size(); i = next++) {
+			bytecode[i] = compile(files[i].string(), useDisk);
+		}
+	};
+
+	size_t threadCount = std::min<size_t>(std::max<unsigned int>(1, std::thread::hardware_concurrency()), files.size() / LUA_CHUNK_CACHE_FILES_PER_THREAD);
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (!bytecode[i].empty()) {
+			chunks[files[i].string()] = std::move(bytecode[i]);
+		}
+	}
+}
+
+void LuaChunkCache::clear()
+{
+	chunks.clear();
+}
+
+int LuaChunkCache::loadFile(lua_State* L, const std::string& file) const
+{
+	auto it = chunks.find(file);
+	if (it == chunks.end()) {
+		return luaL_loadfile(L, file.c_str());
+	}
+
+	// the chunk name is the same luaL_loadfile gives, error messages and debug info do not change
+	const std::string chunkName = "@" + file;
+	return luaL_loadbuffer(L, it->second.data(), it->second.size(), chunkName.c_str());
+}
+
+std::string LuaChunkCache::compile(const std::string& file, bool useDisk)
+{
+	namespace fs = boost::filesystem;
+
+	std::string source;
+	if (!readFile(file, source)) {
+		return {};
+	}
+
+	fs::path cachePath;
+	std::string bytecode;
+	if (useDisk) {
+		size_t hash = std::hash<std::string>()(fmt::format("{}\n{}\n{}", LUA_CHUNK_CACHE_VERSION, file, source));
+		cachePath = getCacheDirectory() / fmt::format("{:016x}.luac", hash);
+		if (readFile(cachePath, bytecode) && !bytecode.empty()) {
+			return bytecode;
+		}
+	}
+
+	lua_State* L = luaL_newstate();
+	if (!L) {
+		return {};
+	}
+
+	const std::string chunkName = "@" + file;
+	if (luaL_loadbuffer(L, source.data(), source.size(), chunkName.c_str()) == 0) {
+		lua_dump(L, writeChunk, &bytecode);
+	}
+	lua_close(L);
+
+	if (useDisk && !bytecode.empty()) {
+		// write through a temporary name, a half written entry must never be picked up
+		boost::system::error_code error;
+		fs::create_directories(cachePath.parent_path(), error);
+		fs::path temporaryPath = cachePath;
+		temporaryPath += fmt::format(".{}", std::hash<std::thread::id>()(std::this_thread::get_id()));
+		std::ofstream output(temporaryPath.string(), std::ios::binary | std::ios::trunc);
+		output.write(bytecode.data(), bytecode.size());
+		output.close();
+		if (output.fail()) {
+			fs::remove(temporaryPath, error);
+		} else {
+			fs::rename(temporaryPath, cachePath, error);
+		}
+	}
+	return bytecode;
+}
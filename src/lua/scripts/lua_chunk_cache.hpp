@@ -0,0 +1,72 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_LUA_SCRIPTS_LUA_CHUNK_CACHE_HPP_
+#define SRC_LUA_SCRIPTS_LUA_CHUNK_CACHE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <parallel_hashmap/phmap.h>
+
+#include "lua/scripts/luajit_sync.hpp"
+
+/**
+ * Compiles a batch of script files to bytecode on worker threads, each with
+ * a lua_State of its own, so the main state only has to load the result.
+ * With luaBytecodeCache the bytecode is also kept on disk next to the
+ * server, keyed by a hash of the Lua version, the file path and its source,
+ * and a changed file simply gets a new entry.
+ * Files that fail to compile are left out and load from source as before,
+ * which reports the syntax error the usual way.
+ */
+class LuaChunkCache
+{
+	public:
+		LuaChunkCache() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		LuaChunkCache(const LuaChunkCache&) = delete;
+		LuaChunkCache& operator=(const LuaChunkCache&) = delete;
+
+		static LuaChunkCache& getInstance() {
+			// Guaranteed to be destroyed
+			static LuaChunkCache instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		void prepare(const std::vector<boost::filesystem::path>& files);
+		// frees the bytecode kept by prepare
+		void clear();
+
+		// Same as luaL_loadfile, from the prepared bytecode when there is some
+		int loadFile(lua_State* L, const std::string& file) const;
+
+	private:
+		static std::string compile(const std::string& file, bool useDisk);
+
+		phmap::flat_hash_map<std::string, std::string> chunks;
+};
+
+constexpr auto g_luaChunkCache = &LuaChunkCache::getInstance;
+
+#endif  // SRC_LUA_SCRIPTS_LUA_CHUNK_CACHE_HPP_
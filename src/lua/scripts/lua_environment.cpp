@@ -20,6 +20,8 @@
 #include "pch.hpp"
 
 #include "declarations.hpp"
+#include "game/scheduling/scheduler.h"
+#include "lua/scripts/lua_allocator.hpp"
 #include "lua/scripts/lua_environment.hpp"
 #include "lua/functions/lua_functions_loader.hpp"
 #include "lua/scripts/script_environment.hpp"
@@ -34,7 +36,7 @@ LuaEnvironment::~LuaEnvironment() {
 }
 
 bool LuaEnvironment::initState() {
-	luaState = luaL_newstate();
+	luaState = LuaAllocator::newState();
 	LuaFunctionsLoader::load(luaState);
 	runningEventId = EVENT_ID_USER;
 
@@ -60,12 +62,12 @@ bool LuaEnvironment::closeState() {
 		clearAreaObjects(areaEntry.first);
 	}
 
-	for (auto & timerEntry: timerEvents) {
-		LuaTimerEventDesc timerEventDesc = std::move(timerEntry.second);
-		for (int32_t parameter: timerEventDesc.parameters) {
-			luaL_unref(luaState, LUA_REGISTRYINDEX, parameter);
-		}
-		luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
+	// a pending wheel event stays armed and finds nothing to do
+	for (const auto & timerEntry: timerEvents) {
+		luaL_unref(luaState, LUA_REGISTRYINDEX, timerEntry.second.ref);
+	}
+	for (auto & slot: timerWheel) {
+		slot.clear();
 	}
 
 	combatIdMap.clear();
@@ -147,38 +149,110 @@ void LuaEnvironment::clearAreaObjects(LuaScriptInterface * interface) {
 	it -> second.clear();
 }
 
+uint32_t LuaEnvironment::addTimerEvent(int32_t scriptId, int32_t ref, uint32_t parameterCount, uint32_t delay) {
+	LuaTimerEventDesc timerEventDesc;
+	timerEventDesc.scriptId = scriptId;
+	timerEventDesc.ref = ref;
+	timerEventDesc.parameterCount = parameterCount;
+	// rounded up, an event never runs before its delay has passed
+	timerEventDesc.tick = (OTSYS_TIME() + delay + LUA_TIMER_WHEEL_TICK - 1) / LUA_TIMER_WHEEL_TICK;
+
+	uint32_t eventId = lastEventTimerId++;
+	timerWheel[timerEventDesc.tick % LUA_TIMER_WHEEL_SLOTS].push_back(eventId);
+	timerEvents.emplace(eventId, timerEventDesc);
+	scheduleTimerWheel();
+	return eventId;
+}
+
+bool LuaEnvironment::stopTimerEvent(uint32_t eventId) {
+	auto it = timerEvents.find(eventId);
+	if (it == timerEvents.end()) {
+		return false;
+	}
+
+	luaL_unref(luaState, LUA_REGISTRYINDEX, it -> second.ref);
+	timerEvents.erase(it);
+	return true;
+}
+
+void LuaEnvironment::scheduleTimerWheel() {
+	if (timerWheelEvent != 0 || timerEvents.empty()) {
+		return;
+	}
+
+	int64_t now = OTSYS_TIME();
+	// an idle wheel restarts at the current tick, nothing is due before it
+	timerWheelTick = std::max<int64_t>(timerWheelTick, now / LUA_TIMER_WHEEL_TICK);
+	int64_t delay = std::max<int64_t>(SCHEDULER_MINTICKS, timerWheelTick * LUA_TIMER_WHEEL_TICK - now);
+	timerWheelEvent = g_scheduler().addEvent(createSchedulerTask(delay, std::bind(&LuaEnvironment::runTimerWheel, this)));
+}
+
+void LuaEnvironment::runTimerWheel() {
+	timerWheelEvent = 0;
+
+	// catches up on every tick since the last run, a whole turn at most since that visits every slot
+	int64_t nowTick = OTSYS_TIME() / LUA_TIMER_WHEEL_TICK;
+	int64_t lastTick = std::min<int64_t>(nowTick, timerWheelTick + LUA_TIMER_WHEEL_SLOTS - 1);
+	std::vector<uint32_t> dueEvents;
+	for (; timerWheelTick <= lastTick; ++timerWheelTick) {
+		auto & slot = timerWheel[timerWheelTick % LUA_TIMER_WHEEL_SLOTS];
+		dueEvents.clear();
+		// events due on a later turn go back into the slot
+		auto kept = slot.begin();
+		for (uint32_t eventId: slot) {
+			auto it = timerEvents.find(eventId);
+			if (it == timerEvents.end()) {
+				continue;
+			}
+
+			if (it -> second.tick > nowTick) {
+				*kept++ = eventId;
+			} else {
+				dueEvents.push_back(eventId);
+			}
+		}
+		slot.erase(kept, slot.end());
+
+		// callbacks may add timers, also to this slot, so the slot is settled before any runs
+		for (uint32_t eventId: dueEvents) {
+			executeTimerEvent(eventId);
+		}
+	}
+	timerWheelTick = nowTick + 1;
+
+	scheduleTimerWheel();
+}
+
 void LuaEnvironment::executeTimerEvent(uint32_t eventIndex) {
 	auto it = timerEvents.find(eventIndex);
 	if (it == timerEvents.end()) {
 		return;
 	}
 
-	LuaTimerEventDesc timerEventDesc = std::move(it -> second);
+	LuaTimerEventDesc timerEventDesc = it -> second;
 	timerEvents.erase(it);
 
-	// push function
-	lua_rawgeti(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
-
-	// push parameters
-	for (auto parameter: boost::adaptors::reverse(timerEventDesc.parameters)) {
-		lua_rawgeti(luaState, LUA_REGISTRYINDEX, parameter);
+	// push function and parameters, stored in that order
+	lua_rawgeti(luaState, LUA_REGISTRYINDEX, timerEventDesc.ref);
+	int32_t count = timerEventDesc.parameterCount + 1;
+	for (int32_t i = 1; i <= count; ++i) {
+		lua_rawgeti(luaState, -i, i);
 	}
+	lua_remove(luaState, -count - 1);
 
 	// call the function
 	if (reserveScriptEnv()) {
 		ScriptEnvironment * env = getScriptEnv();
 		env -> setTimerEvent();
 		env -> setScriptId(timerEventDesc.scriptId, this);
-		callFunction(timerEventDesc.parameters.size());
+		callFunction(timerEventDesc.parameterCount);
 	} else {
+		lua_pop(luaState, count);
 		SPDLOG_ERROR("[LuaEnvironment::executeTimerEvent - Lua file {}] "
 			"Call stack overflow. Too many lua script calls being nested",
 			getLoadingFile());
 	}
 
 	// free resources
-	luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
-	for (auto parameter: timerEventDesc.parameters) {
-		luaL_unref(luaState, LUA_REGISTRYINDEX, parameter);
-	}
+	luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.ref);
 }
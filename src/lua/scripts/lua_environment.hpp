@@ -30,6 +30,10 @@ class Cylinder;
 class Game;
 class GlobalFunctions;
 
+// Lua timers are rounded up to ticks of this many milliseconds
+static constexpr int64_t LUA_TIMER_WHEEL_TICK = 50;
+static constexpr size_t LUA_TIMER_WHEEL_SLOTS = 256;
+
 class LuaEnvironment: public LuaScriptInterface {
 	public:
 		LuaEnvironment();
@@ -53,11 +57,26 @@ class LuaEnvironment: public LuaScriptInterface {
 		uint32_t createAreaObject(LuaScriptInterface * interface);
 		void clearAreaObjects(LuaScriptInterface * interface);
 
+		/**
+		 * Takes over ref, a registry reference to {function, parameters...},
+		 * and calls it after delay milliseconds.
+		 * \returns the event id for stopTimerEvent
+		 */
+		uint32_t addTimerEvent(int32_t scriptId, int32_t ref, uint32_t parameterCount, uint32_t delay);
+		bool stopTimerEvent(uint32_t eventId);
+
 	private:
 		void executeTimerEvent(uint32_t eventIndex);
+		void scheduleTimerWheel();
+		void runTimerWheel();
 
 		phmap::flat_hash_map < uint32_t,
 		LuaTimerEventDesc > timerEvents;
+		// every slot holds the ids due at its ticks, one scheduler event drives the whole wheel;
+		// stopped ids stay in their slot until it comes around and are skipped then
+		std::array<std::vector<uint32_t>, LUA_TIMER_WHEEL_SLOTS> timerWheel;
+		int64_t timerWheelTick = 0;
+		uint32_t timerWheelEvent = 0;
 		phmap::flat_hash_map < uint32_t,
 		Combat * > combatMap;
 		phmap::flat_hash_map < uint32_t,
@@ -0,0 +1,78 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/lua_garbage_collector.hpp"
+
+void LuaGarbageCollector::start()
+{
+	idleBudget = std::max<int64_t>(0, g_configManager().getNumber(LUA_GC_IDLE_BUDGET));
+}
+
+int64_t LuaGarbageCollector::getTimeMicros()
+{
+	return DispatcherProfiler::getTimeMicros();
+}
+
+bool LuaGarbageCollector::beginIdle()
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (!L) {
+		return false;
+	}
+
+	if (cycleRunning) {
+		return true;
+	}
+
+	int64_t heapKB = lua_gc(L, LUA_GCCOUNT, 0);
+	int64_t growthKB = std::max<int64_t>(1024, lastCycleKB * LUA_GC_IDLE_GROWTH / 100);
+	if (heapKB < lastCycleKB + growthKB) {
+		return false;
+	}
+
+	cycleRunning = true;
+	return true;
+}
+
+bool LuaGarbageCollector::step()
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	++stats.steps;
+	if (lua_gc(L, LUA_GCSTEP, LUA_GC_IDLE_STEP_KB) == 0) {
+		return true;
+	}
+
+	// what is left now is live data, the next cycle waits for it to grow
+	cycleRunning = false;
+	lastCycleKB = lua_gc(L, LUA_GCCOUNT, 0);
+	++stats.cycles;
+	return false;
+}
+
+void LuaGarbageCollector::endIdle(int64_t micros)
+{
+	stats.micros += micros;
+	stats.maxMicros = std::max(stats.maxMicros, micros);
+}
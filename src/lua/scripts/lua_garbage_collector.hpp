@@ -0,0 +1,106 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_LUA_SCRIPTS_LUA_GARBAGE_COLLECTOR_HPP_
+#define SRC_LUA_SCRIPTS_LUA_GARBAGE_COLLECTOR_HPP_
+
+#include <cstdint>
+
+// work of one incremental step, as the size argument of LUA_GCSTEP
+static constexpr int LUA_GC_IDLE_STEP_KB = 16;
+// idle steps only start a new cycle once the heap grew this much since the last one (percent, at least 1 MB)
+static constexpr int64_t LUA_GC_IDLE_GROWTH = 10;
+
+// dispatcher thread only
+struct LuaGarbageCollectorStats {
+	uint64_t steps = 0;
+	uint64_t cycles = 0;
+	int64_t micros = 0;
+	int64_t maxMicros = 0;
+
+	void reset() {
+		steps = 0;
+		cycles = 0;
+		micros = 0;
+		maxMicros = 0;
+	}
+};
+
+/**
+ * Runs incremental steps of the Lua garbage collector while the dispatcher
+ * has nothing else to do, so most of the collection happens between ticks
+ * instead of as debt paid inside a crowded one. Lua keeps collecting on its
+ * own as well, the idle steps just leave it little to do.
+ * Each idle period is capped by luaGcIdleBudget microseconds and ends as soon
+ * as a task is queued.
+ */
+class LuaGarbageCollector
+{
+	public:
+		LuaGarbageCollector() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		LuaGarbageCollector(const LuaGarbageCollector&) = delete;
+		LuaGarbageCollector& operator=(const LuaGarbageCollector&) = delete;
+
+		static LuaGarbageCollector& getInstance() {
+			// Guaranteed to be destroyed
+			static LuaGarbageCollector instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads the configuration, before that idle steps are off
+		void start();
+
+		// dispatcher thread, stops early once hasWork() returns true
+		template <typename HasWork>
+		void runIdleSteps(HasWork&& hasWork) {
+			if (idleBudget == 0 || !beginIdle()) {
+				return;
+			}
+
+			int64_t start = getTimeMicros();
+			while (step() && !hasWork() && getTimeMicros() - start < idleBudget) { }
+			endIdle(getTimeMicros() - start);
+		}
+
+		LuaGarbageCollectorStats& getStats() {
+			return stats;
+		}
+
+	private:
+		static int64_t getTimeMicros();
+
+		// whether there is garbage worth collecting now
+		bool beginIdle();
+		// false once the current cycle is done
+		bool step();
+		void endIdle(int64_t micros);
+
+		int64_t idleBudget = 0;
+		bool cycleRunning = false;
+		int64_t lastCycleKB = 0;
+		LuaGarbageCollectorStats stats;
+};
+
+constexpr auto g_luaGarbageCollector = &LuaGarbageCollector::getInstance;
+
+#endif  // SRC_LUA_SCRIPTS_LUA_GARBAGE_COLLECTOR_HPP_
@@ -0,0 +1,158 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "lua/scripts/lua_profiler.hpp"
+
+namespace {
+
+// functions listed on each report, by self time
+constexpr size_t REPORT_TOP_COUNT = 20;
+
+}  // namespace
+
+void LuaProfiler::start()
+{
+	setEnabled(g_configManager().getBoolean(LUA_PROFILER));
+}
+
+void LuaProfiler::setEnabled(bool value)
+{
+	if (value && !isEnabled()) {
+		reset();
+		SPDLOG_INFO("[LuaProfiler] Lua callback profiling enabled");
+	}
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+int64_t LuaProfiler::getHeapBytes(lua_State* L)
+{
+	return static_cast<int64_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+void LuaProfiler::enter(lua_State* L, const std::string& interfaceName, const std::string& function)
+{
+	Frame frame;
+	if (!frames.empty()) {
+		frame.stack = frames.back().stack;
+		frame.stack.push_back(';');
+	}
+	frame.stack.append(interfaceName).push_back(';');
+	frame.stack.append(function);
+	frame.interfaceName = interfaceName;
+	frame.childMicros = 0;
+	frame.heapBytes = getHeapBytes(L);
+	frame.start = DispatcherProfiler::getTimeMicros();
+	frames.push_back(std::move(frame));
+}
+
+void LuaProfiler::leave(lua_State* L)
+{
+	if (frames.empty()) {
+		return;
+	}
+
+	Frame& frame = frames.back();
+	int64_t totalMicros = DispatcherProfiler::getTimeMicros() - frame.start;
+	int64_t selfMicros = std::max<int64_t>(0, totalMicros - frame.childMicros);
+
+	CallStats& callStats = stacks[frame.stack];
+	++callStats.calls;
+	callStats.totalMicros += totalMicros;
+	callStats.selfMicros += selfMicros;
+	// a collection during the call shrinks the heap, that is not negative memory use
+	callStats.heapBytes += std::max<int64_t>(0, getHeapBytes(L) - frame.heapBytes);
+	interfaceMicros[frame.interfaceName] += selfMicros;
+
+	frames.pop_back();
+	if (!frames.empty()) {
+		frames.back().childMicros += totalMicros;
+	}
+}
+
+void LuaProfiler::report() const
+{
+	if (stacks.empty()) {
+		SPDLOG_INFO("[LuaProfiler] No Lua callbacks recorded");
+		return;
+	}
+
+	std::vector<std::pair<std::string_view, const CallStats*>> entries;
+	entries.reserve(stacks.size());
+
+	uint64_t totalCalls = 0;
+	int64_t totalMicros = 0;
+	for (const auto& it : stacks) {
+		entries.emplace_back(it.first, &it.second);
+		totalCalls += it.second.calls;
+		totalMicros += it.second.selfMicros;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second->selfMicros > rhs.second->selfMicros;
+	});
+
+	int64_t windowMicros = std::max<int64_t>(1, DispatcherProfiler::getTimeMicros() - windowStart);
+	SPDLOG_INFO("[LuaProfiler] {} callbacks, {:.2f}ms in Lua, {:.1f}% of the last {:.1f}s",
+		totalCalls, totalMicros / 1000., totalMicros * 100. / windowMicros, windowMicros / 1000000.);
+
+	std::vector<std::pair<std::string_view, int64_t>> interfaces(interfaceMicros.begin(), interfaceMicros.end());
+	std::sort(interfaces.begin(), interfaces.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.second > rhs.second;
+	});
+	for (const auto& [interfaceName, micros] : interfaces) {
+		SPDLOG_INFO("[LuaProfiler] {}: {:.2f}ms", interfaceName, micros / 1000.);
+	}
+
+	size_t shown = std::min<size_t>(REPORT_TOP_COUNT, entries.size());
+	for (size_t i = 0; i < shown; ++i) {
+		const CallStats& callStats = *entries[i].second;
+		SPDLOG_INFO("[LuaProfiler] #{} {}: count {}, self {:.2f}ms, total {:.2f}ms, avg {:.1f}us, heap growth {} bytes",
+			i + 1, entries[i].first, callStats.calls, callStats.selfMicros / 1000., callStats.totalMicros / 1000.,
+			static_cast<double>(callStats.totalMicros) / callStats.calls, callStats.heapBytes);
+	}
+}
+
+bool LuaProfiler::writeFoldedStacks(const std::string& fileName) const
+{
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file) {
+		SPDLOG_ERROR("[LuaProfiler::writeFoldedStacks] - Cannot write {}", fileName);
+		return false;
+	}
+
+	for (const auto& [stack, callStats] : stacks) {
+		if (callStats.selfMicros > 0) {
+			file << stack << ' ' << callStats.selfMicros << '\n';
+		}
+	}
+	return static_cast<bool>(file);
+}
+
+void LuaProfiler::reset()
+{
+	// open frames are kept, their callbacks are still running
+	stacks.clear();
+	interfaceMicros.clear();
+	windowStart = DispatcherProfiler::getTimeMicros();
+}
@@ -0,0 +1,106 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_LUA_SCRIPTS_LUA_PROFILER_HPP_
+#define SRC_LUA_SCRIPTS_LUA_PROFILER_HPP_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "lua/scripts/luajit_sync.hpp"
+
+/**
+ * Optional timing of every Lua callback the engine runs, by script function
+ * and by the script interface it belongs to (actions, movements, creature
+ * and global events, Events hooks, revscripts...).
+ * Callbacks nested inside another one are kept under it, so the recorded
+ * stacks can be written as folded stacks for flamegraph.pl.
+ * Memory is the growth of the Lua heap over the callback: LuaJIT on 64 bit
+ * refuses a custom lua_Alloc, so single allocations cannot be counted.
+ * Switched at runtime with /luaprofiler, dispatcher thread only.
+ */
+class LuaProfiler
+{
+	public:
+		LuaProfiler() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		LuaProfiler(const LuaProfiler&) = delete;
+		LuaProfiler& operator=(const LuaProfiler&) = delete;
+
+		static LuaProfiler& getInstance() {
+			// Guaranteed to be destroyed
+			static LuaProfiler instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads the configuration
+		void start();
+
+		bool isEnabled() const {
+			return enabled.load(std::memory_order_relaxed);
+		}
+		void setEnabled(bool value);
+
+		// every enter is matched by a leave, even if the profiler is switched meanwhile
+		void enter(lua_State* L, const std::string& interfaceName, const std::string& function);
+		void leave(lua_State* L);
+
+		// Logs the slowest functions and the time spent by script interface
+		void report() const;
+		// Writes "interface;function;... selfMicros" lines, false if the file cannot be written
+		bool writeFoldedStacks(const std::string& fileName) const;
+		void reset();
+
+	private:
+		struct Frame {
+			std::string stack;
+			std::string interfaceName;
+			int64_t start;
+			int64_t childMicros;
+			int64_t heapBytes;
+		};
+
+		struct CallStats {
+			uint64_t calls = 0;
+			int64_t totalMicros = 0;
+			int64_t selfMicros = 0;
+			int64_t heapBytes = 0;
+		};
+
+		static int64_t getHeapBytes(lua_State* L);
+
+		std::atomic<bool> enabled {false};
+
+		std::vector<Frame> frames;
+		// by folded stack
+		phmap::flat_hash_map<std::string, CallStats> stacks;
+		// self time by script interface
+		phmap::flat_hash_map<std::string, int64_t> interfaceMicros;
+		int64_t windowStart = 0;
+};
+
+constexpr auto g_luaProfiler = &LuaProfiler::getInstance;
+
+#endif  // SRC_LUA_SCRIPTS_LUA_PROFILER_HPP_
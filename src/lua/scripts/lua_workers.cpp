@@ -0,0 +1,425 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/tasks.h"
+#include "lua/scripts/lua_workers.hpp"
+#include "lua/scripts/luajit_sync.hpp"
+#include "utils/thread_topology.hpp"
+
+namespace {
+
+enum LuaWorkerValue_t : uint8_t {
+	LUA_WORKER_NIL,
+	LUA_WORKER_FALSE,
+	LUA_WORKER_TRUE,
+	LUA_WORKER_NUMBER,
+	LUA_WORKER_STRING,
+	LUA_WORKER_TABLE,
+	LUA_WORKER_TABLE_END,
+};
+
+// deeper tables are refused, which also stops at cycles
+constexpr int LUA_WORKER_MAX_DEPTH = 32;
+// the worker states drop their loaded functions past this many
+constexpr size_t LUA_WORKER_MAX_FUNCTIONS = 256;
+// the deadline is checked every this many VM instructions
+constexpr int LUA_WORKER_HOOK_INSTRUCTIONS = 1000;
+
+// globals the worker states keep, the rest of luaL_openlibs is removed
+const phmap::flat_hash_set<std::string> allowedGlobals = {
+	"_G", "_VERSION", "assert", "error", "getmetatable", "ipairs", "next", "pairs", "pcall",
+	"rawequal", "rawget", "rawset", "select", "setmetatable", "tonumber", "tostring", "type",
+	"unpack", "xpcall", "string", "table", "math", "bit"
+};
+
+thread_local int64_t jobDeadline = 0;
+
+void deadlineHook(lua_State* L, lua_Debug*)
+{
+	if (DispatcherProfiler::getTimeMicros() > jobDeadline) {
+		luaL_error(L, "job stopped after luaWorkerTimeout");
+	}
+}
+
+template <typename T>
+void appendValue(std::string& data, T value)
+{
+	data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(const std::string& data, size_t& position, T& value)
+{
+	if (data.size() - position < sizeof(value)) {
+		return false;
+	}
+	std::memcpy(&value, data.data() + position, sizeof(value));
+	position += sizeof(value);
+	return true;
+}
+
+bool serializeValue(lua_State* L, int index, int depth, std::string& data, std::string& error)
+{
+	switch (lua_type(L, index)) {
+		case LUA_TNIL:
+			appendValue<uint8_t>(data, LUA_WORKER_NIL);
+			return true;
+
+		case LUA_TBOOLEAN:
+			appendValue<uint8_t>(data, lua_toboolean(L, index) ? LUA_WORKER_TRUE : LUA_WORKER_FALSE);
+			return true;
+
+		case LUA_TNUMBER:
+			appendValue<uint8_t>(data, LUA_WORKER_NUMBER);
+			appendValue<double>(data, lua_tonumber(L, index));
+			return true;
+
+		case LUA_TSTRING: {
+			size_t length;
+			const char* string = lua_tolstring(L, index, &length);
+			appendValue<uint8_t>(data, LUA_WORKER_STRING);
+			appendValue<uint32_t>(data, static_cast<uint32_t>(length));
+			data.append(string, length);
+			return true;
+		}
+
+		case LUA_TTABLE: {
+			if (depth >= LUA_WORKER_MAX_DEPTH || !lua_checkstack(L, 3)) {
+				error = "tables are nested too deep or recursive";
+				return false;
+			}
+
+			if (index < 0) {
+				index = lua_gettop(L) + index + 1;
+			}
+			appendValue<uint8_t>(data, LUA_WORKER_TABLE);
+			lua_pushnil(L);
+			while (lua_next(L, index) != 0) {
+				if (!serializeValue(L, -2, depth + 1, data, error) || !serializeValue(L, -1, depth + 1, data, error)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				lua_pop(L, 1);
+			}
+			appendValue<uint8_t>(data, LUA_WORKER_TABLE_END);
+			return true;
+		}
+
+		default:
+			error = std::string("a ") + lua_typename(L, lua_type(L, index)) + " cannot be passed to or from a worker";
+			return false;
+	}
+}
+
+// pushes one value, false at the end of the data or of the table being read
+bool pushValue(lua_State* L, const std::string& data, size_t& position, int depth)
+{
+	uint8_t type;
+	if (!readValue(data, position, type)) {
+		return false;
+	}
+
+	switch (type) {
+		case LUA_WORKER_NIL:
+			lua_pushnil(L);
+			return true;
+
+		case LUA_WORKER_FALSE:
+		case LUA_WORKER_TRUE:
+			lua_pushboolean(L, type == LUA_WORKER_TRUE);
+			return true;
+
+		case LUA_WORKER_NUMBER: {
+			double number;
+			if (!readValue(data, position, number)) {
+				return false;
+			}
+			lua_pushnumber(L, number);
+			return true;
+		}
+
+		case LUA_WORKER_STRING: {
+			uint32_t length;
+			if (!readValue(data, position, length) || data.size() - position < length) {
+				return false;
+			}
+			lua_pushlstring(L, data.data() + position, length);
+			position += length;
+			return true;
+		}
+
+		case LUA_WORKER_TABLE: {
+			if (depth >= LUA_WORKER_MAX_DEPTH || !lua_checkstack(L, 3)) {
+				return false;
+			}
+
+			lua_newtable(L);
+			while (pushValue(L, data, position, depth + 1)) {
+				if (!pushValue(L, data, position, depth + 1)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				lua_rawset(L, -3);
+			}
+			return true;
+		}
+
+		default:
+			return false;
+	}
+}
+
+int writeBytecode(lua_State*, const void* data, size_t size, void* userdata)
+{
+	static_cast<std::string*>(userdata)->append(static_cast<const char*>(data), size);
+	return 0;
+}
+
+}  // namespace
+
+void LuaWorkers::start()
+{
+	timeout = std::max<int64_t>(1, g_configManager().getNumber(LUA_WORKER_TIMEOUT)) * 1000;
+	maxQueueSize = static_cast<size_t>(std::max<int32_t>(1, g_configManager().getNumber(LUA_WORKER_QUEUE_SIZE)));
+	running.store(true, std::memory_order_relaxed);
+
+	int32_t workerCount = g_configManager().getNumber(LUA_WORKERS);
+	inlineJobs = workerCount <= 0;
+	for (int32_t i = 0; i < workerCount; ++i) {
+		threads.emplace_back([this, i]() {
+			g_threadTopology().applyToCurrentThread(THREAD_ROLE_WORKER, i);
+			threadMain();
+		});
+	}
+}
+
+void LuaWorkers::threadMain()
+{
+	Worker worker;
+	if (!openWorker(worker)) {
+		SPDLOG_ERROR("[LuaWorkers::threadMain] - Could not create a worker state");
+		return;
+	}
+
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	while (true) {
+		jobSignal.wait(jobLockUnique, [this]() {
+			return !jobs.empty() || !running.load(std::memory_order_relaxed);
+		});
+		if (!running.load(std::memory_order_relaxed)) {
+			break;
+		}
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		jobLockUnique.unlock();
+
+		runJob(worker, job);
+
+		jobLockUnique.lock();
+	}
+	jobLockUnique.unlock();
+
+	closeWorker(worker);
+}
+
+bool LuaWorkers::addJob(std::string bytecode, std::string arguments, Callback callback)
+{
+	if (inlineJobs) {
+		if (!running.load(std::memory_order_relaxed) || (!inlineWorker.L && !openWorker(inlineWorker))) {
+			return false;
+		}
+
+		Job job {std::move(bytecode), std::move(arguments), std::move(callback)};
+		runJob(inlineWorker, job);
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		if (!running.load(std::memory_order_relaxed) || jobs.size() >= maxQueueSize) {
+			return false;
+		}
+		jobs.push_back({std::move(bytecode), std::move(arguments), std::move(callback)});
+	}
+	jobSignal.notify_one();
+	return true;
+}
+
+void LuaWorkers::runJob(Worker& worker, Job& job)
+{
+	lua_State* L = worker.L;
+	bool success = false;
+	std::string result;
+
+	auto it = worker.functions.find(job.bytecode);
+	if (it == worker.functions.end()) {
+		if (worker.functions.size() >= LUA_WORKER_MAX_FUNCTIONS) {
+			for (const auto& [bytecode, ref] : worker.functions) {
+				luaL_unref(L, LUA_REGISTRYINDEX, ref);
+			}
+			worker.functions.clear();
+		}
+
+		if (luaL_loadbuffer(L, job.bytecode.data(), job.bytecode.size(), "=worker") != 0) {
+			result = lua_tostring(L, -1) ? lua_tostring(L, -1) : "the function could not be loaded";
+			lua_settop(L, 0);
+		} else {
+			it = worker.functions.emplace(job.bytecode, luaL_ref(L, LUA_REGISTRYINDEX)).first;
+		}
+	}
+
+	if (it != worker.functions.end()) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, it->second);
+		int argumentCount = pushValues(L, job.arguments);
+
+		jobDeadline = DispatcherProfiler::getTimeMicros() + timeout;
+		if (lua_pcall(L, argumentCount, LUA_MULTRET, 0) != 0) {
+			result = lua_tostring(L, -1) ? lua_tostring(L, -1) : "the job failed";
+		} else {
+			success = serializeValues(L, 1, result, result);
+		}
+		lua_settop(L, 0);
+	}
+
+	// the garbage of a job is not left to the next one
+	lua_gc(L, LUA_GCSTEP, 0);
+
+	Callback callback = std::move(job.callback);
+	g_dispatcher().addTask(createTask([callback = std::move(callback), success, result = std::move(result)]() {
+		callback(success, result);
+	}));
+}
+
+bool LuaWorkers::openWorker(Worker& worker)
+{
+	lua_State* L = luaL_newstate();
+	if (!L) {
+		return false;
+	}
+	luaL_openlibs(L);
+
+	// os keeps the clock functions only
+	lua_newtable(L);
+	lua_getglobal(L, "os");
+	lua_getfield(L, -1, "time");
+	lua_setfield(L, -3, "time");
+	lua_getfield(L, -1, "clock");
+	lua_setfield(L, -3, "clock");
+	lua_pop(L, 1);
+
+	std::vector<std::string> removed;
+	lua_pushnil(L);
+	while (lua_next(L, LUA_GLOBALSINDEX) != 0) {
+		lua_pop(L, 1);
+		if (lua_type(L, -1) == LUA_TSTRING && allowedGlobals.count(lua_tostring(L, -1)) == 0) {
+			removed.emplace_back(lua_tostring(L, -1));
+		}
+	}
+	for (const std::string& name : removed) {
+		lua_pushnil(L);
+		lua_setglobal(L, name.c_str());
+	}
+	lua_setglobal(L, "os");
+
+	lua_sethook(L, deadlineHook, LUA_MASKCOUNT, LUA_WORKER_HOOK_INSTRUCTIONS);
+	worker.L = L;
+	return true;
+}
+
+void LuaWorkers::closeWorker(Worker& worker)
+{
+	if (worker.L) {
+		lua_close(worker.L);
+		worker.L = nullptr;
+	}
+	worker.functions.clear();
+}
+
+void LuaWorkers::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(jobLock);
+		running.store(false, std::memory_order_relaxed);
+		// the dispatcher runs no callbacks past the shutdown
+		jobs.clear();
+	}
+	jobSignal.notify_all();
+}
+
+void LuaWorkers::join()
+{
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+	closeWorker(inlineWorker);
+}
+
+bool LuaWorkers::serializeValues(lua_State* L, int first, std::string& data, std::string& error)
+{
+	std::string values;
+	std::string valueError;
+	const int top = lua_gettop(L);
+	for (int index = first; index <= top; ++index) {
+		if (!serializeValue(L, index, 0, values, valueError)) {
+			error = std::move(valueError);
+			return false;
+		}
+	}
+	data = std::move(values);
+	return true;
+}
+
+int LuaWorkers::pushValues(lua_State* L, const std::string& data)
+{
+	int count = 0;
+	size_t position = 0;
+	while (position < data.size() && lua_checkstack(L, 1) && pushValue(L, data, position, 0)) {
+		++count;
+	}
+	return count;
+}
+
+bool LuaWorkers::dumpFunction(lua_State* L, int index, std::string& bytecode, std::string& error)
+{
+	if (!lua_isfunction(L, index) || lua_iscfunction(L, index)) {
+		error = "a worker runs Lua functions only";
+		return false;
+	}
+
+	// the values of upvalues are not carried over, the function has to be self contained
+	if (lua_getupvalue(L, index, 1)) {
+		lua_pop(L, 1);
+		error = "a worker function cannot use upvalues, pass them as arguments";
+		return false;
+	}
+
+	lua_pushvalue(L, index);
+	lua_dump(L, writeBytecode, &bytecode);
+	lua_pop(L, 1);
+	return true;
+}
@@ -0,0 +1,119 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_LUA_SCRIPTS_LUA_WORKERS_HPP_
+#define SRC_LUA_SCRIPTS_LUA_WORKERS_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+struct lua_State;
+
+/**
+ * Secondary Lua states for pure computations, each owned by one thread.
+ * A job is a function without upvalues, dumped to bytecode, and its arguments
+ * copied as nil, boolean, number, string and nested tables of those; the
+ * results come back the same way to a callback on the dispatcher.
+ * The states only know the base functions without file access or loading,
+ * string, table, math, bit and os.time/os.clock, so a job cannot reach the
+ * game state or the dispatcher state. A job running longer than
+ * luaWorkerTimeout is stopped with an error.
+ * With luaWorkers = 0 the jobs run on one such state on the dispatcher, the
+ * callback is still called from a later task.
+ */
+class LuaWorkers
+{
+	public:
+		// called on the dispatcher with whether the job ran and its results, or the error message
+		using Callback = std::function<void(bool, const std::string&)>;
+
+		LuaWorkers() = default;
+
+		// non-copyable
+		LuaWorkers(const LuaWorkers&) = delete;
+		LuaWorkers& operator=(const LuaWorkers&) = delete;
+
+		static LuaWorkers& getInstance() {
+			// Guaranteed to be destroyed
+			static LuaWorkers instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads luaWorkers, luaWorkerQueueSize and luaWorkerTimeout and starts the threads
+		void start();
+		void shutdown();
+		void join();
+
+		// returns false if the queue is full or the workers were shut down
+		bool addJob(std::string bytecode, std::string arguments, Callback callback);
+
+		/**
+		 * Copies the values from index first to the top of the stack.
+		 * \returns false with error set if one of them cannot be copied
+		 */
+		static bool serializeValues(lua_State* L, int first, std::string& data, std::string& error);
+		// pushes copied values, returns how many
+		static int pushValues(lua_State* L, const std::string& data);
+		// bytecode of a function at index that can run on a worker, false with error set otherwise
+		static bool dumpFunction(lua_State* L, int index, std::string& bytecode, std::string& error);
+
+	private:
+		struct Job {
+			std::string bytecode;
+			std::string arguments;
+			Callback callback;
+		};
+
+		// a worker state with the functions it loaded, by bytecode
+		struct Worker {
+			lua_State* L = nullptr;
+			phmap::flat_hash_map<std::string, int> functions;
+		};
+
+		void threadMain();
+		void runJob(Worker& worker, Job& job);
+		bool openWorker(Worker& worker);
+		static void closeWorker(Worker& worker);
+
+		std::vector<std::thread> threads;
+		std::deque<Job> jobs;
+		std::mutex jobLock;
+		std::condition_variable jobSignal;
+		size_t maxQueueSize = 0;
+		int64_t timeout = 0;
+		std::atomic<bool> running {false};
+
+		// dispatcher state used without worker threads
+		Worker inlineWorker;
+		bool inlineJobs = false;
+};
+
+constexpr auto g_luaWorkers = &LuaWorkers::getInstance;
+
+#endif  // SRC_LUA_SCRIPTS_LUA_WORKERS_HPP_
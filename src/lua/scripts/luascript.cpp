@@ -20,7 +20,22 @@
 #include "pch.hpp"
 
 #include "lua/scripts/luascript.h"
+#include "lua/scripts/lua_chunk_cache.hpp"
 #include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/lua_profiler.hpp"
+#include "server/metrics/metrics.hpp"
+
+namespace {
+
+MetricHistogram& callbackTime = g_metrics().getHistogram("canary_lua_callback_seconds", "Time of the Lua callbacks run by the engine, a nested callback is also counted in its caller",
+	{10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 100000, 500000});
+
+int64_t getCallbackMicros(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
 
 ScriptEnvironment::DBResultMap ScriptEnvironment::tempResults;
 uint32_t ScriptEnvironment::lastResultId = 0;
@@ -28,6 +43,7 @@ std::multimap <ScriptEnvironment* , Item*> ScriptEnvironment::tempItems;
 
 ScriptEnvironment LuaFunctionsLoader::scriptEnv[16];
 int32_t LuaFunctionsLoader::scriptEnvIndex = -1;
+std::array<int32_t, LuaData_Last> LuaFunctionsLoader::metatableRefs = {};
 
 LuaScriptInterface::LuaScriptInterface(std::string initInterfaceName) : interfaceName(std::move(initInterfaceName)) {
 	if (!g_luaEnvironment.getLuaState()) {
@@ -51,7 +67,7 @@ bool LuaScriptInterface::reInitState() {
 
 int32_t LuaScriptInterface::loadFile(const std::string& file) {
 	//loads file as a chunk at stack top
-	int ret = luaL_loadfile(luaState, file.c_str());
+	int ret = g_luaChunkCache().loadFile(luaState, file);
 	if (ret != 0) {
 		lastLuaError = popString(luaState);
 		return -1;
@@ -234,10 +250,27 @@ bool LuaScriptInterface::closeState() {
 	return true;
 }
 
+void LuaScriptInterface::enterProfiler() {
+	ScriptEnvironment* env = getScriptEnv();
+	LuaScriptInterface* scriptInterface = env->getScriptInterface() ? env->getScriptInterface() : this;
+	g_luaProfiler().enter(luaState, scriptInterface->getInterfaceName(), scriptInterface->getFileById(env->getScriptId()));
+}
+
 bool LuaScriptInterface::callFunction(int params) {
 	bool result = false;
 	int size = lua_gettop(luaState);
-	if (protectedCall(luaState, params, 1) != 0) {
+	bool profiled = g_luaProfiler().isEnabled();
+	if (profiled) {
+		enterProfiler();
+	}
+	auto start = std::chrono::steady_clock::now();
+	int ret = protectedCall(luaState, params, 1);
+	callbackTime.observe(getCallbackMicros(start));
+	if (profiled) {
+		g_luaProfiler().leave(luaState);
+	}
+
+	if (ret != 0) {
 		LuaScriptInterface::reportError(nullptr, LuaScriptInterface::getString(luaState, -1));
 	} else {
 		result = LuaScriptInterface::getBoolean(luaState, -1);
@@ -254,7 +287,18 @@ bool LuaScriptInterface::callFunction(int params) {
 
 void LuaScriptInterface::callVoidFunction(int params) {
 	int size = lua_gettop(luaState);
-	if (protectedCall(luaState, params, 0) != 0) {
+	bool profiled = g_luaProfiler().isEnabled();
+	if (profiled) {
+		enterProfiler();
+	}
+	auto start = std::chrono::steady_clock::now();
+	int ret = protectedCall(luaState, params, 0);
+	callbackTime.observe(getCallbackMicros(start));
+	if (profiled) {
+		g_luaProfiler().leave(luaState);
+	}
+
+	if (ret != 0) {
 		LuaScriptInterface::reportError(nullptr, LuaScriptInterface::popString(luaState));
 	}
 
@@ -54,6 +54,10 @@ class LuaScriptInterface : public LuaFunctionsLoader {
 		lua_State* getLuaState() const {
 			return luaState;
 		}
+		// the id the next stored callback gets, unchanged while no callback was stored
+		int32_t getNextEventId() const {
+			return runningEventId;
+		}
 
 		bool pushFunction(int32_t functionId);
 
@@ -64,6 +68,8 @@ class LuaScriptInterface : public LuaFunctionsLoader {
 
 	protected:
 		virtual bool closeState();
+		// opens the LuaProfiler frame of the callback about to run
+		void enterProfiler();
 		lua_State* luaState = nullptr;
 		int32_t eventTableRef = -1;
 		int32_t runningEventId = EVENT_ID_USER;
@@ -19,11 +19,47 @@
 
 #include "pch.hpp"
 
+#include "creatures/combat/spells.h"
+#include "creatures/monsters/monster_type_cache.hpp"
 #include "creatures/players/imbuements/imbuements.h"
 #include "items/weapons/weapons.h"
+#include "lua/creature/actions.h"
+#include "lua/creature/creatureevent.h"
 #include "lua/creature/movement.h"
+#include "lua/creature/talkaction.h"
+#include "lua/global/globalevent.h"
+#include "lua/scripts/lua_chunk_cache.hpp"
 #include "lua/scripts/scripts.h"
 
+namespace {
+
+// the .lua files of a script folder in load order, skipping disabled ones
+void collectScriptFiles(const boost::filesystem::path& dir, bool isLib, std::vector<boost::filesystem::path>& files) {
+	namespace fs = boost::filesystem;
+
+	fs::recursive_directory_iterator endit;
+	std::string disable = ("#");
+	for(fs::recursive_directory_iterator it(dir); it != endit; ++it) {
+		auto fn = it->path().parent_path().filename();
+		if ((fn == "lib" && !isLib) || fn == "events") {
+			continue;
+		}
+		if(fs::is_regular_file(*it) && it->path().extension() == ".lua") {
+			size_t found = it->path().filename().string().find(disable);
+			if (found != std::string::npos) {
+				if (g_configManager().getBoolean(SCRIPTS_CONSOLE_LOGS)) {
+					SPDLOG_INFO("{} [disabled]", it->path().filename().string());
+				}
+				continue;
+			}
+			files.push_back(it->path());
+		}
+	}
+	sort(files.begin(), files.end());
+}
+
+}  // namespace
+
 Scripts::Scripts() :
 	scriptInterface("Scripts Interface") {
 	scriptInterface.initState();
@@ -67,29 +103,36 @@ bool Scripts::loadScripts(std::string folderName, bool isLib, bool reload) {
 		return false;
 	}
 
-	fs::recursive_directory_iterator endit;
 	std::vector<fs::path> v;
-	std::string disable = ("#");
-	for(fs::recursive_directory_iterator it(dir); it != endit; ++it) {
-		auto fn = it->path().parent_path().filename();
-		if ((fn == "lib" && !isLib) || fn == "events") {
-			continue;
-		}
-		if(fs::is_regular_file(*it) && it->path().extension() == ".lua") {
-			size_t found = it->path().filename().string().find(disable);
-			if (found != std::string::npos) {
-				if (g_configManager().getBoolean(SCRIPTS_CONSOLE_LOGS)) {
-					SPDLOG_INFO("{} [disabled]", it->path().filename().string());
-				}
-				continue;
+	collectScriptFiles(dir, isLib, v);
+
+	// unchanged monster files build their types natively, only the rest is compiled
+	const bool cacheMonsterTypes = !isLib && folderName == "monster" && g_monsterTypeCache().open();
+	if (cacheMonsterTypes) {
+		std::vector<fs::path> uncached;
+		for (const fs::path& file : v) {
+			if (!g_monsterTypeCache().isCached(file.string())) {
+				uncached.push_back(file);
 			}
-			v.push_back(it->path());
 		}
+		g_luaChunkCache().prepare(uncached);
+	} else {
+		g_luaChunkCache().prepare(v);
+	}
+
+	// a full load of the scripts folder is the base the changed files are compared to
+	const bool trackFiles = !isLib && folderName == "scripts";
+	if (trackFiles) {
+		scriptFiles.clear();
 	}
-	sort(v.begin(), v.end());
 	std::string redir;
 	for (auto it = v.begin(); it != v.end(); ++it) {
 		const std::string scriptFile = it->string();
+		if (trackFiles) {
+			boost::system::error_code error;
+			scriptFiles[scriptFile] = { fs::last_write_time(*it, error), fs::file_size(*it, error) };
+		}
+
 		if (!isLib) {
 			if (redir.empty() || redir != it->parent_path().string()) {
 				auto p = it->relative_path();
@@ -100,7 +143,22 @@ bool Scripts::loadScripts(std::string folderName, bool isLib, bool reload) {
 			}
 		}
 
-		if(scriptInterface.loadFile(scriptFile) == -1) {
+		if (cacheMonsterTypes && g_monsterTypeCache().load(scriptFile)) {
+			if (g_configManager().getBoolean(SCRIPTS_CONSOLE_LOGS)) {
+				SPDLOG_INFO("{} [cached]", it->filename().string());
+			}
+			continue;
+		}
+
+		if (cacheMonsterTypes) {
+			g_monsterTypeCache().beginFile(scriptInterface.getLuaState(), scriptFile, scriptInterface.getNextEventId());
+		}
+		const bool loaded = scriptInterface.loadFile(scriptFile) != -1;
+		if (cacheMonsterTypes) {
+			g_monsterTypeCache().endFile(scriptInterface.getLuaState(), loaded, scriptInterface.getNextEventId());
+		}
+
+		if (!loaded) {
 			SPDLOG_ERROR(it->filename().string());
 			SPDLOG_ERROR(scriptInterface.getLastLuaError());
 			continue;
@@ -115,5 +173,72 @@ bool Scripts::loadScripts(std::string folderName, bool isLib, bool reload) {
 		}
 	}
 
+	if (cacheMonsterTypes) {
+		g_monsterTypeCache().close();
+	}
+	g_luaChunkCache().clear();
+	return true;
+}
+
+size_t Scripts::clearScriptFile(const std::string& file) {
+	return g_actions().clearFile(file) + g_moveEvents().clearFile(file) + g_talkActions().clearFile(file)
+		+ g_creatureEvents().clearFile(file) + g_spells().clearFile(file) + g_globalEvents().clearFile(file)
+		+ g_weapons().clearFile(file);
+}
+
+bool Scripts::reloadChangedScripts() {
+	namespace fs = boost::filesystem;
+
+	const auto dir = fs::current_path() / "data" / "scripts";
+	if (scriptFiles.empty() || !fs::exists(dir) || !fs::is_directory(dir)) {
+		return false;
+	}
+
+	int64_t start = OTSYS_PRECISE_TIME();
+	std::vector<fs::path> files;
+	collectScriptFiles(dir, false, files);
+
+	std::vector<std::pair<std::string, ScriptFileStamp>> changed;
+	phmap::flat_hash_set<std::string> present;
+	for (const fs::path& path : files) {
+		std::string file = path.string();
+		boost::system::error_code error;
+		ScriptFileStamp stamp { fs::last_write_time(path, error), fs::file_size(path, error) };
+		auto it = scriptFiles.find(file);
+		if (it == scriptFiles.end() || !(it->second == stamp)) {
+			changed.emplace_back(file, stamp);
+		}
+		present.insert(std::move(file));
+	}
+
+	size_t removedEvents = 0;
+	size_t removedFiles = 0;
+	for (auto it = scriptFiles.begin(); it != scriptFiles.end(); ) {
+		if (present.find(it->first) == present.end()) {
+			removedEvents += clearScriptFile(it->first);
+			scriptFiles.erase(it++);
+			++removedFiles;
+		} else {
+			++it;
+		}
+	}
+
+	for (const auto& [file, stamp] : changed) {
+		removedEvents += clearScriptFile(file);
+		// remembered even if it fails, it is tried again once it is saved again
+		scriptFiles[file] = stamp;
+		if (scriptInterface.loadFile(file) == -1) {
+			SPDLOG_ERROR(file);
+			SPDLOG_ERROR(scriptInterface.getLastLuaError());
+			continue;
+		}
+
+		if (g_configManager().getBoolean(SCRIPTS_CONSOLE_LOGS)) {
+			SPDLOG_INFO("{} [reloaded]", file);
+		}
+	}
+
+	SPDLOG_INFO("Reloaded {} changed and dropped {} deleted script files ({} events replaced) in {} ms",
+		changed.size(), removedFiles, removedEvents, OTSYS_PRECISE_TIME() - start);
 	return true;
 }
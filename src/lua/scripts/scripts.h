@@ -40,11 +40,32 @@ class Scripts {
 
 		bool loadEventSchedulerScripts(const std::string& fileName);
 		bool loadScripts(std::string folderName, bool isLib, bool reload);
+		/**
+		 * Re-executes only the files of data/scripts that were added or changed (by
+		 * modification time and size) since they were last executed. The actions,
+		 * movements, talkactions, creature events, spells, global events and weapons
+		 * a changed or deleted file registered are dropped first.
+		 * \returns false if the folder was never loaded, a full reload is needed then
+		 */
+		bool reloadChangedScripts();
 		LuaScriptInterface& getScriptInterface() {
 			return scriptInterface;
 		}
 	private:
+		struct ScriptFileStamp {
+			std::time_t modified = 0;
+			uintmax_t size = 0;
+
+			bool operator==(const ScriptFileStamp& other) const {
+				return modified == other.modified && size == other.size;
+			}
+		};
+
+		static size_t clearScriptFile(const std::string& file);
+
 		LuaScriptInterface scriptInterface;
+		// files of data/scripts as they were when last executed
+		phmap::flat_hash_map<std::string, ScriptFileStamp> scriptFiles;
 };
 
 constexpr auto g_scripts = &Scripts::getInstance;
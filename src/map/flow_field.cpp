@@ -0,0 +1,164 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pch.hpp"
+
+#include "creatures/creature.h"
+#include "map/flow_field.hpp"
+#include "map/map.h"
+
+namespace {
+
+struct FlowFieldStep {
+	int32_t x;
+	int32_t y;
+	Direction direction;
+};
+
+constexpr FlowFieldStep flowFieldSteps[8] = {
+	{0, -1, DIRECTION_NORTH}, {1, 0, DIRECTION_EAST}, {0, 1, DIRECTION_SOUTH}, {-1, 0, DIRECTION_WEST},
+	{-1, -1, DIRECTION_NORTHWEST}, {1, -1, DIRECTION_NORTHEAST}, {1, 1, DIRECTION_SOUTHEAST}, {-1, 1, DIRECTION_SOUTHWEST}
+};
+
+bool isFlowFieldWalkable(const Tile* tile)
+{
+	return tile && tile->getGround() && !tile->hasFlag(TILESTATE_BLOCKSOLID | TILESTATE_BLOCKPATH | TILESTATE_PROTECTIONZONE | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT);
+}
+
+}  // namespace
+
+void FlowField::build(const Map& map, const Position& newGoal)
+{
+	goal = newGoal;
+	distance.fill(UNREACHABLE);
+
+	leaves.clear();
+	int32_t startX = std::max<int32_t>(0, goal.x - FLOW_FIELD_RADIUS) & ~FLOOR_MASK;
+	int32_t startY = std::max<int32_t>(0, goal.y - FLOW_FIELD_RADIUS) & ~FLOOR_MASK;
+	for (int32_t y = startY; y <= goal.y + FLOW_FIELD_RADIUS && y <= 0xFFFF; y += FLOOR_SIZE) {
+		for (int32_t x = startX; x <= goal.x + FLOW_FIELD_RADIUS && x <= 0xFFFF; x += FLOOR_SIZE) {
+			if (const QTreeLeafNode* leaf = map.getQTNode(x, y)) {
+				leaves.emplace_back(leaf, leaf->getTileGeneration());
+			}
+		}
+	}
+
+	// plain Dijkstra outwards from the goal, a field holds a few hundred tiles at most
+	using QueueEntry = std::pair<uint16_t, int32_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	int32_t goalIndex = getIndex(goal);
+	distance[goalIndex] = 0;
+	queue.emplace(0, goalIndex);
+
+	while (!queue.empty()) {
+		auto [currentDistance, index] = queue.top();
+		queue.pop();
+		if (currentDistance != distance[index]) {
+			continue;
+		}
+
+		int32_t x = goal.x - FLOW_FIELD_RADIUS + index % FLOW_FIELD_SIZE;
+		int32_t y = goal.y - FLOW_FIELD_RADIUS + index / FLOW_FIELD_SIZE;
+		for (const FlowFieldStep& step : flowFieldSteps) {
+			Position neighborPos(x + step.x, y + step.y, goal.z);
+			int32_t neighborIndex = getIndex(neighborPos);
+			if (neighborIndex < 0 || !isFlowFieldWalkable(map.getTile(neighborPos))) {
+				continue;
+			}
+
+			uint16_t cost = (step.x != 0 && step.y != 0) ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+			uint16_t newDistance = currentDistance + cost;
+			if (newDistance < distance[neighborIndex]) {
+				distance[neighborIndex] = newDistance;
+				queue.emplace(newDistance, neighborIndex);
+			}
+		}
+	}
+}
+
+bool FlowField::isValid(const Position& pos) const
+{
+	if (pos != goal) {
+		return false;
+	}
+
+	for (const auto& [leaf, generation] : leaves) {
+		if (leaf->getTileGeneration() != generation) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FlowField::getPath(const Map& map, const Creature& creature, std::forward_list<Direction>& dirList) const
+{
+	Position pos = creature.getPosition();
+	if (pos.z != goal.z || getIndex(pos) < 0) {
+		return false;
+	}
+
+	auto tail = dirList.before_begin();
+	while (std::max<int32_t>(Position::getDistanceX(pos, goal), Position::getDistanceY(pos, goal)) > 1) {
+		uint16_t bestDistance = getDistance(pos.x, pos.y);
+		const FlowFieldStep* bestStep = nullptr;
+		for (const FlowFieldStep& step : flowFieldSteps) {
+			uint16_t stepDistance = getDistance(pos.x + step.x, pos.y + step.y);
+			if (stepDistance >= bestDistance) {
+				continue;
+			}
+
+			if (map.canWalkTo(creature, Position(pos.x + step.x, pos.y + step.y, pos.z))) {
+				bestDistance = stepDistance;
+				bestStep = &step;
+			}
+		}
+
+		if (!bestStep) {
+			// blocked for this creature, let the A* search around it
+			dirList.clear();
+			return false;
+		}
+
+		tail = dirList.insert_after(tail, bestStep->direction);
+		pos.x += bestStep->x;
+		pos.y += bestStep->y;
+	}
+	return true;
+}
+
+int32_t FlowField::getIndex(const Position& pos) const
+{
+	int32_t x = pos.x - goal.x + FLOW_FIELD_RADIUS;
+	int32_t y = pos.y - goal.y + FLOW_FIELD_RADIUS;
+	if (pos.z != goal.z || x < 0 || x >= FLOW_FIELD_SIZE || y < 0 || y >= FLOW_FIELD_SIZE) {
+		return -1;
+	}
+	return y * FLOW_FIELD_SIZE + x;
+}
+
+uint16_t FlowField::getDistance(int32_t x, int32_t y) const
+{
+	x = x - goal.x + FLOW_FIELD_RADIUS;
+	y = y - goal.y + FLOW_FIELD_RADIUS;
+	if (x < 0 || x >= FLOW_FIELD_SIZE || y < 0 || y >= FLOW_FIELD_SIZE) {
+		return UNREACHABLE;
+	}
+	return distance[y * FLOW_FIELD_SIZE + x];
+}
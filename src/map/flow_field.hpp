@@ -0,0 +1,72 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_MAP_FLOW_FIELD_HPP_
+#define SRC_MAP_FLOW_FIELD_HPP_
+
+#include <array>
+#include <forward_list>
+#include <utility>
+#include <vector>
+
+#include "game/movement/position.h"
+
+class Creature;
+class Map;
+class QTreeLeafNode;
+
+// same as the maxSearchDist of a follow path search
+static constexpr int32_t FLOW_FIELD_RADIUS = 12;
+static constexpr int32_t FLOW_FIELD_SIZE = FLOW_FIELD_RADIUS * 2 + 1;
+// the fields are dropped as a whole when more than this many targets have one
+static constexpr size_t FLOW_FIELD_MAX_FIELDS = 256;
+
+/**
+ * Walking distances from one goal position to every tile around it on the same floor,
+ * with the same step costs as the A* search. Creature blocking and per creature rules
+ * are left out, so one field serves every creature chasing the goal: each follower
+ * walks down the gradient and only checks its own canWalkTo for the next step.
+ */
+class FlowField
+{
+	public:
+		static constexpr uint16_t UNREACHABLE = std::numeric_limits<uint16_t>::max();
+
+		void build(const Map& map, const Position& goal);
+
+		// still describes the map around goal
+		bool isValid(const Position& goal) const;
+
+		/**
+		 * Follows the field from the creature's position until it stands next to the goal.
+		 * \returns false if the creature is outside the field or cannot take a first step
+		 */
+		bool getPath(const Map& map, const Creature& creature, std::forward_list<Direction>& dirList) const;
+
+	private:
+		int32_t getIndex(const Position& pos) const;
+		uint16_t getDistance(int32_t x, int32_t y) const;
+
+		Position goal;
+		std::array<uint16_t, FLOW_FIELD_SIZE * FLOW_FIELD_SIZE> distance;
+		// leaves the field was built from, with their tile generation at that time
+		std::vector<std::pair<const QTreeLeafNode*, uint32_t>> leaves;
+};
+
+#endif  // SRC_MAP_FLOW_FIELD_HPP_
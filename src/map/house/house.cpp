@@ -23,6 +23,8 @@
 #include "map/house/house.h"
 #include "io/iologindata.h"
 #include "game/game.h"
+#include "game/forked_save.hpp"
+#include "game/scheduling/tasks.h"
 #include "items/bed.h"
 
 House::House(uint32_t houseId) : id(houseId) {}
@@ -36,6 +38,7 @@ void House::addTile(HouseTile* tile)
 void House::setOwner(uint32_t guid, bool updateDatabase/* = true*/, Player* player/* = nullptr*/)
 {
 	if (updateDatabase && owner != guid) {
+		g_forkedSave().waitForHouses();
 		Database& db = Database::getInstance();
 
 		std::ostringstream query;
@@ -251,7 +254,7 @@ bool House::transferToDepot(Player* player) const
 		return false;
 	}
 
-	ItemList moveItemList;
+	std::vector<Item*> moveItemList;
 	for (HouseTile* tile : houseTiles) {
 		if (const TileItemVector* items = tile->getItemList()) {
 			for (auto it = items->rbegin(), end = items->rend(); it != end; ++it) {
@@ -299,8 +302,26 @@ bool House::transferToDepot(Player* player) const
 		}
 	}
 
+	Inbox* inbox = player->getInbox();
+	if (!player->isOffline()) {
+		for (Item* item : moveItemList) {
+			g_game().internalMoveItem(item->getParent(), inbox, INDEX_WHEREEVER, item, item->getItemCount(), nullptr, FLAG_NOLIMIT);
+		}
+		return true;
+	}
+
+	// nobody can look into the inbox of an owner loaded from the database, so the
+	// items are added straight to it, without a destination search for each one
+	// or notifications on the inbox side; stacks are left as they were
 	for (Item* item : moveItemList) {
-		g_game().internalMoveItem(item->getParent(), player->getInbox(), INDEX_WHEREEVER, item, item->getItemCount(), nullptr, FLAG_NOLIMIT);
+		Cylinder* fromCylinder = item->getParent();
+		int32_t index = fromCylinder->getThingIndex(item);
+		fromCylinder->removeThing(item, item->getItemCount());
+		inbox->internalAddThing(item);
+		if (index != -1) {
+			fromCylinder->postRemoveNotification(item, inbox, index);
+		}
+		item->startDecaying();
 	}
 	return true;
 }
@@ -686,6 +707,42 @@ bool Houses::loadHousesXML(const std::string& filename)
 	return true;
 }
 
+namespace {
+
+std::string getRentPeriodName(RentPeriod_t rentPeriod)
+{
+	switch (rentPeriod) {
+		case RENTPERIOD_DAILY:
+			return "daily";
+		case RENTPERIOD_WEEKLY:
+			return "weekly";
+		case RENTPERIOD_MONTHLY:
+			return "monthly";
+		case RENTPERIOD_YEARLY:
+			return "annual";
+		default:
+			return std::string();
+	}
+}
+
+time_t getRentPeriodSeconds(RentPeriod_t rentPeriod)
+{
+	switch (rentPeriod) {
+		case RENTPERIOD_DAILY:
+			return 24 * 60 * 60;
+		case RENTPERIOD_WEEKLY:
+			return 24 * 60 * 60 * 7;
+		case RENTPERIOD_MONTHLY:
+			return 24 * 60 * 60 * 30;
+		case RENTPERIOD_YEARLY:
+			return 24 * 60 * 60 * 365;
+		default:
+			return 0;
+	}
+}
+
+}  // namespace
+
 void Houses::payHouses(RentPeriod_t rentPeriod) const
 {
 	if (rentPeriod == RENTPERIOD_NEVER) {
@@ -693,6 +750,8 @@ void Houses::payHouses(RentPeriod_t rentPeriod) const
 	}
 
 	time_t currentTime = time(nullptr);
+	std::vector<House*> dueHouses;
+	phmap::flat_hash_map<uint32_t, uint64_t> balances;
 	for (const auto& it : houseMap) {
 		House* house = it.second;
 		if (house->getOwner() == 0) {
@@ -704,79 +763,147 @@ void Houses::payHouses(RentPeriod_t rentPeriod) const
 			continue;
 		}
 
-		const uint32_t ownerId = house->getOwner();
-		const Town* town = g_game().map.towns.getTown(house->getTownId());
-		if (!town) {
+		if (!g_game().map.towns.getTown(house->getTownId())) {
 			continue;
 		}
 
-		Player player(nullptr);
-		if (!IOLoginData::loadPlayerById(&player, ownerId)) {
+		dueHouses.push_back(house);
+		balances.emplace(house->getOwner(), 0);
+	}
+
+	if (dueHouses.empty()) {
+		return;
+	}
+
+	Database& db = Database::getInstance();
+	phmap::flat_hash_set<uint32_t> existingOwners;
+	std::vector<uint32_t> ownerIds;
+	ownerIds.reserve(balances.size());
+	for (const auto& [ownerId, balance] : balances) {
+		ownerIds.push_back(ownerId);
+	}
+
+	for (size_t begin = 0; begin < ownerIds.size(); begin += RENT_QUERY_CHUNK) {
+		std::ostringstream query;
+		query << "SELECT `id`, `balance` FROM `players` WHERE `id` IN (";
+		for (size_t i = begin, end = std::min(begin + RENT_QUERY_CHUNK, ownerIds.size()); i < end; ++i) {
+			query << (i != begin ? "," : "") << ownerIds[i];
+		}
+		query << ')';
+
+		if (DBResult_ptr result = db.storeQuery(query.str())) {
+			do {
+				auto ownerId = result->getNumber<uint32_t>("id");
+				existingOwners.insert(ownerId);
+				balances[ownerId] = result->getNumber<uint64_t>("balance");
+			} while (result->next());
+		}
+	}
+
+	// The houses are settled in the same order as before, an owner of several houses pays them one after another
+	phmap::flat_hash_map<uint32_t, uint64_t> debits;
+	phmap::flat_hash_map<uint32_t, size_t> jobIndexes;
+	auto jobs = std::make_shared<std::vector<RentOwnerJob>>();
+	auto getJob = [&](uint32_t ownerId) -> RentOwnerJob& {
+		auto [it, inserted] = jobIndexes.try_emplace(ownerId, jobs->size());
+		if (inserted) {
+			jobs->emplace_back().ownerId = ownerId;
+		}
+		return (*jobs)[it->second];
+	};
+
+	for (House* house : dueHouses) {
+		const uint32_t ownerId = house->getOwner();
+		if (existingOwners.find(ownerId) == existingOwners.end()) {
 			// Player doesn't exist, reset house owner
 			house->setOwner(0);
 			continue;
 		}
 
-		if (player.getBankBalance() >= rent) {
-			player.setBankBalance(player.getBankBalance() - rent);
-
-			time_t paidUntil = currentTime;
-			switch (rentPeriod) {
-				case RENTPERIOD_DAILY:
-					paidUntil += 24 * 60 * 60;
-					break;
-				case RENTPERIOD_WEEKLY:
-					paidUntil += 24 * 60 * 60 * 7;
-					break;
-				case RENTPERIOD_MONTHLY:
-					paidUntil += 24 * 60 * 60 * 30;
-					break;
-				case RENTPERIOD_YEARLY:
-					paidUntil += 24 * 60 * 60 * 365;
-					break;
-				default:
-					break;
-			}
+		const uint32_t rent = house->getRent();
+		uint64_t& balance = balances[ownerId];
+		if (balance >= rent) {
+			balance -= rent;
+			debits[ownerId] += rent;
+			house->setPaidUntil(currentTime + getRentPeriodSeconds(rentPeriod));
+		} else if (house->getPayRentWarnings() < 7) {
+			getJob(ownerId).warnings.emplace_back(house, 7 - house->getPayRentWarnings());
+			house->setPayRentWarnings(house->getPayRentWarnings() + 1);
+		} else {
+			getJob(ownerId).evictions.push_back(house);
+		}
+	}
 
-			house->setPaidUntil(paidUntil);
+	// Owners that only pay are charged here, the others when they are loaded
+	std::vector<std::pair<uint32_t, uint64_t>> batchDebits;
+	for (const auto& [ownerId, debit] : debits) {
+		if (auto it = jobIndexes.find(ownerId); it != jobIndexes.end()) {
+			(*jobs)[it->second].debit = debit;
 		} else {
-			if (house->getPayRentWarnings() < 7) {
-				int32_t daysLeft = 7 - house->getPayRentWarnings();
+			batchDebits.emplace_back(ownerId, debit);
+		}
+	}
 
-				Item* letter = Item::CreateItem(ITEM_LETTER_STAMPED);
-				std::string period;
+	for (size_t begin = 0; begin < batchDebits.size(); begin += RENT_QUERY_CHUNK) {
+		size_t end = std::min(begin + RENT_QUERY_CHUNK, batchDebits.size());
+		std::ostringstream query;
+		query << "UPDATE `players` SET `balance` = `balance` - CASE `id`";
+		for (size_t i = begin; i < end; ++i) {
+			query << " WHEN " << batchDebits[i].first << " THEN " << batchDebits[i].second;
+		}
+		query << " END WHERE `id` IN (";
+		for (size_t i = begin; i < end; ++i) {
+			query << (i != begin ? "," : "") << batchDebits[i].first;
+		}
+		query << ')';
+		db.executeQuery(query.str());
+	}
 
-				switch (rentPeriod) {
-					case RENTPERIOD_DAILY:
-						period = "daily";
-						break;
+	if (!jobs->empty()) {
+		g_dispatcher().addTask(createTask(std::bind(&Houses::processRentJobs, this, rentPeriod, jobs, 0)));
+	}
+}
 
-					case RENTPERIOD_WEEKLY:
-						period = "weekly";
-						break;
+void Houses::processRentJobs(RentPeriod_t rentPeriod, std::shared_ptr<std::vector<RentOwnerJob>> jobs, size_t index) const
+{
+	const std::string period = getRentPeriodName(rentPeriod);
+	for (size_t end = std::min(index + RENT_JOBS_PER_TASK, jobs->size()); index < end; ++index) {
+		const RentOwnerJob& job = (*jobs)[index];
+
+		// the owner may have logged in since the rents were settled
+		Player* player = g_game().getPlayerByGUID(job.ownerId);
+		std::unique_ptr<Player> offlinePlayer;
+		if (!player) {
+			offlinePlayer = std::make_unique<Player>(nullptr);
+			if (!IOLoginData::loadPlayerById(offlinePlayer.get(), job.ownerId)) {
+				for (House* house : job.evictions) {
+					house->setOwner(0);
+				}
+				continue;
+			}
+			player = offlinePlayer.get();
+		}
 
-					case RENTPERIOD_MONTHLY:
-						period = "monthly";
-						break;
+		player->setBankBalance(player->getBankBalance() - std::min(job.debit, player->getBankBalance()));
 
-					case RENTPERIOD_YEARLY:
-						period = "annual";
-						break;
+		for (const auto& [house, daysLeft] : job.warnings) {
+			Item* letter = Item::CreateItem(ITEM_LETTER_STAMPED);
+			std::ostringstream ss;
+			ss << "Warning! \nThe " << period << " rent of " << house->getRent() << " gold for your house \"" << house->getName() << "\" is payable. Have it within " << daysLeft << " days or you will lose this house.";
+			letter->setText(ss.str());
+			g_game().internalAddItem(player->getInbox(), letter, INDEX_WHEREEVER, FLAG_NOLIMIT);
+		}
 
-					default:
-						break;
-				}
+		for (House* house : job.evictions) {
+			house->setOwner(0, true, player);
+		}
 
-				std::ostringstream ss;
-				ss << "Warning! \nThe " << period << " rent of " << house->getRent() << " gold for your house \"" << house->getName() << "\" is payable. Have it within " << daysLeft << " days or you will lose this house.";
-				letter->setText(ss.str());
-				g_game().internalAddItem(player.getInbox(), letter, INDEX_WHEREEVER, FLAG_NOLIMIT);
-				house->setPayRentWarnings(house->getPayRentWarnings() + 1);
-			} else {
-				house->setOwner(0, true, &player);
-			}
+		if (offlinePlayer) {
+			IOLoginData::savePlayer(player);
 		}
+	}
 
-		IOLoginData::savePlayer(&player);
+	if (index < jobs->size()) {
+		g_dispatcher().addTask(createTask(std::bind(&Houses::processRentJobs, this, rentPeriod, jobs, index)));
 	}
 }
@@ -94,7 +94,7 @@ class Door final : public Item
 		friend class House;
 };
 
-using HouseTileList = std::list<HouseTile*>;
+using HouseTileList = std::vector<HouseTile*>;
 using HouseBedItemList = std::list<BedItem*>;
 
 class HouseTransferItem final : public Item
@@ -184,6 +184,14 @@ class House
 			return id;
 		}
 
+		// fingerprint of the tile_store rows of the house as last saved, 0 if unknown
+		size_t getSavedFingerprint() const {
+			return savedFingerprint;
+		}
+		void setSavedFingerprint(size_t fingerprint) {
+			savedFingerprint = fingerprint;
+		}
+
 		void addDoor(Door* door);
 		void removeDoor(Door* door);
 		Door* getDoorByNumber(uint32_t doorId) const;
@@ -229,6 +237,8 @@ class House
 
 		time_t paidUntil = 0;
 
+		size_t savedFingerprint = 0;
+
 		uint32_t id;
 		uint32_t owner = 0;
 		uint32_t ownerAccountId = 0;
@@ -280,6 +290,11 @@ class Houses
 
 		bool loadHousesXML(const std::string& filename);
 
+		/**
+		 * Charges the due rents from the bank balances with a few set based queries.
+		 * Only the owners that get a warning letter or lose a house are loaded,
+		 * a handful at a time on later dispatcher tasks.
+		 */
 		void payHouses(RentPeriod_t rentPeriod) const;
 
 		const HouseMap& getHouses() const {
@@ -287,6 +302,20 @@ class Houses
 		}
 
 	private:
+		// what is left to do for an owner that has to be loaded
+		struct RentOwnerJob {
+			uint32_t ownerId = 0;
+			uint64_t debit = 0;
+			// house and days left to pay it
+			std::vector<std::pair<House*, int32_t>> warnings;
+			std::vector<House*> evictions;
+		};
+
+		static constexpr size_t RENT_QUERY_CHUNK = 500;
+		static constexpr size_t RENT_JOBS_PER_TASK = 10;
+
+		void processRentJobs(RentPeriod_t rentPeriod, std::shared_ptr<std::vector<RentOwnerJob>> jobs, size_t index) const;
+
 		HouseMap houseMap;
 };
 
@@ -24,7 +24,26 @@
 #include "creatures/combat/combat.h"
 #include "creatures/creature.h"
 #include "game/game.h"
+#include "game/forked_save.hpp"
 #include "creatures/monsters/monster.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/scheduler.h"
+
+namespace {
+
+// sight lines between positions further apart than this are not cached
+constexpr int32_t SIGHT_CACHE_MAX_OFFSET = 127;
+
+// results of isSightClear while the map's sightGeneration stays the same
+struct SightCache {
+	uint32_t generation = 0;
+	phmap::flat_hash_map<uint64_t, bool> results;
+};
+
+// monsters search their paths on worker threads too, each thread has its own
+thread_local SightCache sightCache;
+
+}  // namespace
 
 bool Map::load(const std::string& identifier) {
 	try {
@@ -33,6 +52,7 @@ bool Map::load(const std::string& identifier) {
 			SPDLOG_ERROR("[Map::load] - {}", loader.getLastErrorString());
 			return false;
 		}
+		buildLeafIndex(g_configManager().getBoolean(MAP_FLAT_LEAF_INDEX));
 	}
 	catch(const std::exception) {
 		SPDLOG_ERROR("[Map::load] - The map in folder {} is missing or corrupted", identifier);
@@ -41,9 +61,7 @@ bool Map::load(const std::string& identifier) {
 	return true;
 }
 
-bool Map::loadMap(const std::string& identifier,
-	bool mainMap /*= false*/,bool loadHouses /*= false*/,
-	bool loadMonsters /*= false*/, bool loadNpcs /*= false*/)
+void Map::loadMapFile(const std::string& identifier, bool mainMap)
 {
 	// Only download map if is loading the main map and it is not already downloaded
 	if (mainMap && g_configManager().getBoolean(TOGGLE_DOWNLOAD_MAP) && !boost::filesystem::exists(identifier)) {
@@ -67,6 +85,15 @@ bool Map::loadMap(const std::string& identifier,
 
 	// Load the map
 	this->load(identifier);
+}
+
+bool Map::loadMap(const std::string& identifier,
+	bool mainMap /*= false*/,bool loadHouses /*= false*/,
+	bool loadMonsters /*= false*/, bool loadNpcs /*= false*/, bool fileLoaded /*= false*/)
+{
+	if (!fileLoaded) {
+		loadMapFile(identifier, mainMap);
+	}
 
 	// Only create items from lua functions if is loading main map
 	// It needs to be after the load map to ensure the map already exists before creating the items
@@ -143,6 +170,9 @@ bool Map::loadMapCustom(const std::string& identifier, bool loadHouses, bool loa
 
 bool Map::save()
 {
+	// the rows of a forked save still running would overwrite these
+	g_forkedSave().waitForHouses();
+
 	bool saved = false;
 	for (uint32_t tries = 0; tries < 6; tries++) {
 		if (IOMapSerialize::saveHouseInfo()) {
@@ -156,12 +186,28 @@ bool Map::save()
 }
 
 Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+{
+	Tile* tile = getLoadedTile(x, y, z);
+	if (tile) {
+		return tile;
+	}
+
+	if (streamer.isEnabled()) {
+		tile = streamer.loadTile(x, y, z);
+	}
+	if (!tile && instances.isEnabled()) {
+		tile = instances.loadTile(x, y, z);
+	}
+	return tile;
+}
+
+Tile* Map::getLoadedTile(uint16_t x, uint16_t y, uint8_t z) const
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
 	}
 
-	const QTreeLeafNode* leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+	const QTreeLeafNode* leaf = findLeaf(x, y);
 	if (!leaf) {
 		return nullptr;
 	}
@@ -173,6 +219,106 @@ Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
 	return floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
 }
 
+uint8_t Map::getTileWalkFlags(uint16_t x, uint16_t y, uint8_t z) const
+{
+	if (z >= MAP_MAX_LAYERS) {
+		return 0;
+	}
+
+	const QTreeLeafNode* leaf = findLeaf(x, y);
+	const Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+	uint8_t walkFlags = floor ? floor->walkFlags[x & FLOOR_MASK][y & FLOOR_MASK] : 0;
+	if (walkFlags == 0 && instances.isEnabled()) {
+		// an instance tile not created yet walks like the tile it will be copied from
+		return instances.getTemplateWalkFlags(x, y, z);
+	}
+	return walkFlags;
+}
+
+void Map::buildLeafIndex(bool enabled)
+{
+	leafIndex.clear();
+	leafIndexWidth = 0;
+	leafIndexHeight = 0;
+	if (!enabled) {
+		return;
+	}
+
+	// leaf coordinates are not stored, they follow from the path through the quadtree
+	std::vector<std::tuple<uint32_t, uint32_t, QTreeLeafNode*>> leaves;
+	std::function<void(QTreeNode*, uint32_t, uint32_t, uint32_t)> collect = [&](QTreeNode* node, uint32_t x, uint32_t y, uint32_t size) {
+		if (node->isLeaf()) {
+			leaves.emplace_back(x >> FLOOR_BITS, y >> FLOOR_BITS, static_cast<QTreeLeafNode*>(node));
+			return;
+		}
+
+		size /= 2;
+		for (uint32_t i = 0; i < 4; ++i) {
+			if (node->child[i]) {
+				collect(node->child[i], x + (i & 1) * size, y + (i >> 1) * size, size);
+			}
+		}
+	};
+	collect(&root, 0, 0, 0x10000);
+	if (leaves.empty()) {
+		return;
+	}
+
+	uint32_t minX = std::numeric_limits<uint32_t>::max(), minY = minX, maxX = 0, maxY = 0;
+	for (const auto& [x, y, leaf] : leaves) {
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+	}
+
+	size_t entries = static_cast<size_t>(maxX - minX + 1) * (maxY - minY + 1);
+	if (entries > MAP_LEAF_INDEX_MAX_ENTRIES) {
+		SPDLOG_WARN("[Map::buildLeafIndex] - The map covers {} sectors, above the {} of the flat index, tile lookups use the quadtree", entries, MAP_LEAF_INDEX_MAX_ENTRIES);
+		return;
+	}
+
+	leafIndex.assign(entries, nullptr);
+	leafIndexX = minX;
+	leafIndexY = minY;
+	leafIndexWidth = maxX - minX + 1;
+	leafIndexHeight = maxY - minY + 1;
+	for (const auto& [x, y, leaf] : leaves) {
+		leafIndex[(y - minY) * leafIndexWidth + (x - minX)] = leaf;
+	}
+}
+
+void Map::updateMoveEventFlags()
+{
+	std::function<void(QTreeNode*)> update = [&](QTreeNode* node) {
+		if (!node->isLeaf()) {
+			for (QTreeNode* child : node->child) {
+				if (child) {
+					update(child);
+				}
+			}
+			return;
+		}
+
+		const QTreeLeafNode* leaf = static_cast<QTreeLeafNode*>(node);
+		for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+			const Floor* floor = leaf->getFloor(z);
+			if (!floor) {
+				continue;
+			}
+
+			for (auto& row : floor->tiles) {
+				for (Tile* tile : row) {
+					if (tile) {
+						tile->updateMoveEventFlag();
+					}
+				}
+			}
+		}
+	};
+	update(&root);
+}
+
 void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 {
 	if (z >= MAP_MAX_LAYERS) {
@@ -185,6 +331,15 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	QTreeLeafNode* leaf = root.createLeaf(x, y, 15);
 
 	if (QTreeLeafNode::newLeaf) {
+		// cached spectator sets know nothing about this leaf yet
+		clearSpectatorCache();
+
+		uint32_t column = (x >> FLOOR_BITS) - leafIndexX;
+		uint32_t row = (y >> FLOOR_BITS) - leafIndexY;
+		if (column < leafIndexWidth && row < leafIndexHeight) {
+			leafIndex[row * leafIndexWidth + column] = leaf;
+		}
+
 		//update north
 		QTreeLeafNode* northLeaf = root.getLeaf(x, y - FLOOR_SIZE);
 		if (northLeaf) {
@@ -232,7 +387,40 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 		delete newTile;
 	} else {
 		tile = newTile;
+		setWalkFlags(*leaf, *floor, offsetX, offsetY, newTile->getWalkFlags());
+	}
+}
+
+void Map::releaseTile(uint16_t x, uint16_t y, uint8_t z)
+{
+	QTreeLeafNode* leaf = getQTNode(x, y);
+	Floor* floor = leaf ? leaf->getFloor(z) : nullptr;
+	if (!floor) {
+		return;
+	}
+
+	uint32_t offsetX = x & FLOOR_MASK;
+	uint32_t offsetY = y & FLOOR_MASK;
+	Tile*& tile = floor->tiles[offsetX][offsetY];
+	if (!tile) {
+		return;
+	}
+
+	g_game().forgetTileToClean(tile);
+	delete tile;
+	tile = nullptr;
+	setWalkFlags(*leaf, *floor, offsetX, offsetY, 0);
+	++leaf->tileGeneration;
+
+	for (const auto& row : floor->tiles) {
+		for (const Tile* other : row) {
+			if (other) {
+				return;
+			}
+		}
 	}
+	delete floor;
+	leaf->array[z] = nullptr;
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos/* = false*/, bool forceLogin/* = false*/)
@@ -323,6 +511,20 @@ bool Map::placeCreature(const Position& centerPos, Creature* creature, bool exte
 	return true;
 }
 
+void Map::reserveCreatures(const std::vector<Position>& positions)
+{
+	phmap::flat_hash_map<QTreeLeafNode*, size_t> counts;
+	for (const Position& pos : positions) {
+		if (QTreeLeafNode* leaf = getQTNode(pos.x, pos.y)) {
+			++counts[leaf];
+		}
+	}
+
+	for (const auto& [leaf, count] : counts) {
+		leaf->reserveCreatures(count);
+	}
+}
+
 void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* = false*/)
 {
 	Tile& oldTile = *creature.getTile();
@@ -361,6 +563,7 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 
 	//add the creature
 	newTile.addThing(&creature);
+	new_leaf->updateCreaturePosition(&creature);
 
 	if (!teleport) {
 		if (oldPos.y > newPos.y) {
@@ -390,14 +593,16 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 
 	//event method
 	for (Creature* spectator : spectators) {
-		spectator->onCreatureMove(&creature, &newTile, newPos, &oldTile, oldPos, teleport);
+		if (spectator->isInterestedInMove(&creature)) {
+			spectator->onCreatureMove(&creature, &newTile, newPos, &oldTile, oldPos, teleport);
+		}
 	}
 
 	oldTile.postRemoveNotification(&creature, &newTile, 0);
 	newTile.postAddNotification(&creature, &oldTile, 0);
 }
 
-void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers, SpectatorCacheLeaves* leaves /*= nullptr*/) const
 {
 	int_fast32_t min_y = centerPos.y + minRangeY;
 	int_fast32_t min_x = centerPos.x + minRangeX;
@@ -417,7 +622,9 @@ void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& ce
 	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
 	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
 
-	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
+	const SpectatorBounds bounds(centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ);
+
+	const QTreeLeafNode* startLeaf = findLeaf(startx1, starty1);
 	const QTreeLeafNode* leafS = startLeaf;
 	const QTreeLeafNode* leafE;
 
@@ -425,32 +632,110 @@ void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& ce
 		leafE = leafS;
 		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
 			if (leafE) {
+				if (leaves) {
+					leaves->emplace_back(leafE, leafE->spectatorGeneration);
+				}
+
 				const CreatureVector& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
-				for (Creature* creature : node_list) {
-					const Position& cpos = creature->getPosition();
-					if (minRangeZ > cpos.z || maxRangeZ < cpos.z) {
-						continue;
-					}
+				const SpectatorPositions& positions = (onlyPlayers ? leafE->playerPositions : leafE->creaturePositions);
+				forEachSpectatorPosition(positions, bounds, [&spectators, &node_list](size_t index) {
+					spectators.insert(node_list[index]);
+					return false;
+				});
+				leafE = leafE->leafE;
+			} else {
+				leafE = findLeaf(nx + FLOOR_SIZE, ny);
+			}
+		}
 
-					int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-					if ((min_y + offsetZ) > cpos.y || (max_y + offsetZ) < cpos.y || (min_x + offsetZ) > cpos.x || (max_x + offsetZ) < cpos.x) {
-						continue;
-					}
+		if (leafS) {
+			leafS = leafS->leafS;
+		} else {
+			leafS = findLeaf(startx1, ny + FLOOR_SIZE);
+		}
+	}
+}
+
+void Map::getSpectatorFloorRange(const Position& centerPos, bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (multifloor) {
+		if (centerPos.z > 7) {
+			//underground
+
+			//8->15
+			minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+			maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+		} else if (centerPos.z == 6) {
+			minRangeZ = 0;
+			maxRangeZ = 8;
+		} else if (centerPos.z == 7) {
+			minRangeZ = 0;
+			maxRangeZ = 9;
+		} else {
+			minRangeZ = 0;
+			maxRangeZ = 7;
+		}
+	} else {
+		minRangeZ = centerPos.z;
+		maxRangeZ = centerPos.z;
+	}
+}
+
+bool Map::hasPlayersInRange(const Position& centerPos, bool multifloor /*= true*/, int32_t rangeX /*= maxViewportX*/, int32_t rangeY /*= maxViewportY*/) const
+{
+	if (centerPos.z >= MAP_MAX_LAYERS) {
+		return false;
+	}
+
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
+
+	// same walk as getSpectatorsInternal, but only over the player lists and
+	// without building a spectator set
+	int_fast32_t min_y = centerPos.y - rangeY;
+	int_fast32_t min_x = centerPos.x - rangeX;
+	int_fast32_t max_y = centerPos.y + rangeY;
+	int_fast32_t max_x = centerPos.x + rangeX;
+
+	int32_t minoffset = centerPos.getZ() - maxRangeZ;
+	uint16_t x1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (min_x + minoffset)));
+	uint16_t y1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (min_y + minoffset)));
+
+	int32_t maxoffset = centerPos.getZ() - minRangeZ;
+	uint16_t x2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (max_x + maxoffset)));
+	uint16_t y2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (max_y + maxoffset)));
+
+	int32_t startx1 = x1 - (x1 % FLOOR_SIZE);
+	int32_t starty1 = y1 - (y1 % FLOOR_SIZE);
+	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
+	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
+
+	const SpectatorBounds bounds(centerPos, -rangeX, rangeX, -rangeY, rangeY, minRangeZ, maxRangeZ);
 
-					spectators.insert(creature);
+	const QTreeLeafNode* leafS = findLeaf(startx1, starty1);
+	const QTreeLeafNode* leafE;
+
+	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
+		leafE = leafS;
+		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
+			if (leafE) {
+				if (forEachSpectatorPosition(leafE->playerPositions, bounds, [](size_t) { return true; })) {
+					return true;
 				}
 				leafE = leafE->leafE;
 			} else {
-				leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
+				leafE = findLeaf(nx + FLOOR_SIZE, ny);
 			}
 		}
 
 		if (leafS) {
 			leafS = leafS->leafS;
 		} else {
-			leafS = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, ny + FLOOR_SIZE);
+			leafS = findLeaf(startx1, ny + FLOOR_SIZE);
 		}
 	}
+	return false;
 }
 
 void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
@@ -459,97 +744,189 @@ void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos,
 		return;
 	}
 
-	bool foundCache = false;
-	bool cacheResult = false;
+	const SpectatorHashSet& cachedSpectators = getCachedSpectators(centerPos, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
+	if (!spectators.empty()) {
+		spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
+	} else {
+		spectators = cachedSpectators;
+	}
+}
 
+const SpectatorHashSet& Map::getCachedSpectators(const Position& centerPos, bool multifloor, bool onlyPlayers, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY)
+{
 	minRangeX = (minRangeX == 0 ? -maxViewportX : -minRangeX);
 	maxRangeX = (maxRangeX == 0 ? maxViewportX : maxRangeX);
 	minRangeY = (minRangeY == 0 ? -maxViewportY : -minRangeY);
 	maxRangeY = (maxRangeY == 0 ? maxViewportY : maxRangeY);
 
-	if (minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY && multifloor) {
-		if (onlyPlayers) {
-			auto it = playersSpectatorCache.find(centerPos);
-			if (it != playersSpectatorCache.end()) {
-				if (!spectators.empty()) {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-				} else {
-					spectators = it->second;
-				}
+	SpectatorCacheKey key {centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, multifloor, onlyPlayers};
+	auto it = spectatorCache.find(key);
+	if (it != spectatorCache.end() && isSpectatorCacheValid(it->second)) {
+		return it->second.spectators;
+	}
 
-				foundCache = true;
-			}
-		}
+	if (it == spectatorCache.end() && spectatorCache.size() >= SPECTATOR_CACHE_MAX_ENTRIES) {
+		spectatorCache.clear();
+	}
 
-		if (!foundCache) {
-			auto it = spectatorCache.find(centerPos);
-			if (it != spectatorCache.end()) {
-				if (!onlyPlayers) {
-					if (!spectators.empty()) {
-						const SpectatorHashSet& cachedSpectators = it->second;
-						spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-					} else {
-						spectators = it->second;
-					}
-				} else {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					for (Creature* spectator : cachedSpectators) {
-						if (spectator->getPlayer()) {
-							spectators.insert(spectator);
-						}
-					}
-				}
+	SpectatorCacheEntry& entry = (it != spectatorCache.end() ? it->second : spectatorCache[key]);
+	entry.spectators.clear();
+	entry.leaves.clear();
 
-				foundCache = true;
-			} else {
-				cacheResult = true;
+	if (onlyPlayers) {
+		// the players are a subset of an up to date full result
+		key.onlyPlayers = false;
+		auto fullIt = spectatorCache.find(key);
+		if (fullIt != spectatorCache.end() && isSpectatorCacheValid(fullIt->second)) {
+			for (Creature* spectator : fullIt->second.spectators) {
+				if (spectator->getPlayer()) {
+					entry.spectators.insert(spectator);
+				}
 			}
+			entry.leaves = fullIt->second.leaves;
+			return entry.spectators;
 		}
 	}
 
-	if (!foundCache) {
-		int32_t minRangeZ;
-		int32_t maxRangeZ;
-
-		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
 
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			} else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
+	if (spectatorBatch && minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY) {
+		const SpectatorCacheEntry& leafEntry = getLeafSpectators(centerPos, multifloor, onlyPlayers, minRangeZ, maxRangeZ);
+		const SpectatorBounds bounds(centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ);
+		for (Creature* spectator : leafEntry.spectators) {
+			if (bounds.contains(spectator->getPosition())) {
+				entry.spectators.insert(spectator);
 			}
-		} else {
-			minRangeZ = centerPos.z;
-			maxRangeZ = centerPos.z;
 		}
+		// more leaves than needed, which only makes the entry expire sooner
+		entry.leaves = leafEntry.leaves;
+		return entry.spectators;
+	}
 
-		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+	getSpectatorsInternal(entry.spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, &entry.leaves);
+	return entry.spectators;
+}
 
-		if (cacheResult) {
-			if (onlyPlayers) {
-				playersSpectatorCache[centerPos] = spectators;
-			} else {
-				spectatorCache[centerPos] = spectators;
-			}
+const SpectatorCacheEntry& Map::getLeafSpectators(const Position& centerPos, bool multifloor, bool onlyPlayers, int32_t minRangeZ, int32_t maxRangeZ)
+{
+	// the view range of every tile of the leaf, as seen from its corner
+	Position corner(centerPos.x & ~FLOOR_MASK, centerPos.y & ~FLOOR_MASK, centerPos.z);
+	SpectatorCacheKey key {corner, -maxViewportX, maxViewportX + FLOOR_SIZE - 1, -maxViewportY, maxViewportY + FLOOR_SIZE - 1, multifloor, onlyPlayers};
+	auto it = leafSpectatorCache.find(key);
+	if (it != leafSpectatorCache.end() && isSpectatorCacheValid(it->second)) {
+		return it->second;
+	}
+
+	SpectatorCacheEntry& entry = (it != leafSpectatorCache.end() ? it->second : leafSpectatorCache[key]);
+	entry.spectators.clear();
+	entry.leaves.clear();
+	getSpectatorsInternal(entry.spectators, corner, key.minRangeX, key.maxRangeX, key.minRangeY, key.maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, &entry.leaves);
+	return entry;
+}
+
+bool Map::setSpectatorBatch(bool enabled)
+{
+	bool previous = spectatorBatch;
+	spectatorBatch = enabled;
+	if (!enabled) {
+		leafSpectatorCache.clear();
+	}
+	return previous;
+}
+
+bool Map::isSpectatorCacheValid(const SpectatorCacheEntry& entry)
+{
+	for (const auto& [leaf, generation] : entry.leaves) {
+		if (leaf->spectatorGeneration != generation) {
+			return false;
 		}
 	}
+	return true;
 }
 
 void Map::clearSpectatorCache()
 {
 	spectatorCache.clear();
-	playersSpectatorCache.clear();
+	leafSpectatorCache.clear();
+}
+
+const FlowField& Map::getFlowField(const Creature& target)
+{
+	const Position& targetPos = target.getPosition();
+	auto it = flowFields.find(target.getID());
+	if (it != flowFields.end()) {
+		if (!it->second.isValid(targetPos)) {
+			it->second.build(*this, targetPos);
+		}
+		return it->second;
+	}
+
+	if (flowFields.size() >= FLOW_FIELD_MAX_FIELDS) {
+		flowFields.clear();
+	}
+
+	FlowField& field = flowFields[target.getID()];
+	field.build(*this, targetPos);
+	return field;
+}
+
+bool Map::getLongPathMatching(const Position& startPos, std::forward_list<Direction>& dirList, const Position& targetPos, const FindPathParams& fpp)
+{
+	if (!g_configManager().getBoolean(HIERARCHICAL_PATHFINDING)) {
+		return false;
+	}
+	return pathHierarchy.getPath(*this, startPos, targetPos, fpp, dirList);
+}
+
+void Map::updateTileGeneration(const Position& pos)
+{
+	QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (leaf) {
+		++leaf->tileGeneration;
+	}
+}
+
+void Map::updateTileWalkFlags(const Tile& tile)
+{
+	const Position& pos = tile.getPosition();
+	if (pos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (!leaf) {
+		return;
+	}
+
+	Floor* floor = leaf->getFloor(pos.z);
+	uint32_t offsetX = pos.x & FLOOR_MASK;
+	uint32_t offsetY = pos.y & FLOOR_MASK;
+	// tiles being built by the map loader are not placed yet, setTile stores their flags
+	if (floor && floor->tiles[offsetX][offsetY] == &tile) {
+		setWalkFlags(*leaf, *floor, offsetX, offsetY, tile.getWalkFlags());
+	}
+}
+
+void Map::setWalkFlags(QTreeLeafNode& leaf, Floor& floor, uint32_t offsetX, uint32_t offsetY, uint8_t walkFlags)
+{
+	uint8_t& current = floor.walkFlags[offsetX][offsetY];
+	if ((current ^ walkFlags) & (TILE_WALK_BLOCKPROJECTILE | TILE_WALK_HAS_THINGS)) {
+		sightGeneration.fetch_add(1, std::memory_order_relaxed);
+	}
+	if ((current ^ walkFlags) & (TILE_WALK_EXISTS | TILE_WALK_BLOCKSOLID)) {
+		++leaf.walkGeneration;
+	}
+	current = walkFlags;
+}
+
+void Map::invalidateSpectatorCache(const Position& pos)
+{
+	QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (leaf) {
+		++leaf->spectatorGeneration;
+	}
 }
 
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
@@ -611,16 +988,14 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 			start.x += mx;
 		}
 
-		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		if (getTileWalkFlags(start.x, start.y, start.z) & TILE_WALK_BLOCKPROJECTILE) {
 			return false;
 		}
 	}
 
 	// now we need to perform a jump between floors to see if everything is clear (literally)
 	while (start.z != destination.z) {
-		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->getThingCount() > 0) {
+		if (getTileWalkFlags(start.x, start.y, start.z) & TILE_WALK_HAS_THINGS) {
 			return false;
 		}
 
@@ -636,8 +1011,33 @@ bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floo
 		return false;
 	}
 
+	int32_t offsetX = Position::getOffsetX(toPos, fromPos);
+	int32_t offsetY = Position::getOffsetY(toPos, fromPos);
+	if (std::abs(offsetX) > SIGHT_CACHE_MAX_OFFSET || std::abs(offsetY) > SIGHT_CACHE_MAX_OFFSET) {
+		return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	}
+
+	SightCache& cache = sightCache;
+	uint32_t generation = sightGeneration.load(std::memory_order_relaxed);
+	if (cache.generation != generation || cache.results.size() >= SIGHT_CACHE_MAX_ENTRIES) {
+		cache.results.clear();
+		cache.generation = generation;
+	}
+
+	// fromPos followed by the offsets to toPos, each in 8 bits
+	uint64_t key = (static_cast<uint64_t>(fromPos.x) << 44) | (static_cast<uint64_t>(fromPos.y) << 28) | (static_cast<uint64_t>(fromPos.z) << 24) |
+		(static_cast<uint64_t>(offsetX & 0xFF) << 16) | (static_cast<uint64_t>(offsetY & 0xFF) << 8) | toPos.z;
+	auto it = cache.results.find(key);
+	if (it != cache.results.end()) {
+		sightCacheStats.hits.fetch_add(1, std::memory_order_relaxed);
+		return it->second;
+	}
+	sightCacheStats.misses.fetch_add(1, std::memory_order_relaxed);
+
 	// Cast two converging rays and see if either yields a result.
-	return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	bool clear = checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
+	cache.results.emplace(key, clear);
+	return clear;
 }
 
 const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
@@ -659,12 +1059,46 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	return tile;
 }
 
+namespace {
+
+// Accounts one path search in AStarNodes::getStats when it goes out of scope
+class PathfindingStatsScope
+{
+	public:
+		explicit PathfindingStatsScope(const AStarNodes& nodes) :
+			nodes(nodes), startTime(g_dispatcherProfiler().isEnabled() ? DispatcherProfiler::getTimeMicros() : 0) {}
+
+		~PathfindingStatsScope() {
+			PathfindingStats& stats = AStarNodes::getStats();
+			uint64_t expanded = nodes.getExpandedNodes();
+			stats.searches.fetch_add(1, std::memory_order_relaxed);
+			stats.expandedNodes.fetch_add(expanded, std::memory_order_relaxed);
+			if (nodes.isFull()) {
+				stats.exhausted.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			uint64_t maxExpanded = stats.maxExpandedNodes.load(std::memory_order_relaxed);
+			while (expanded > maxExpanded && !stats.maxExpandedNodes.compare_exchange_weak(maxExpanded, expanded, std::memory_order_relaxed)) {}
+
+			if (startTime != 0) {
+				stats.micros.fetch_add(DispatcherProfiler::getTimeMicros() - startTime, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		const AStarNodes& nodes;
+		int64_t startTime;
+};
+
+}  // namespace
+
 bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = creature.getPosition();
 	Position endPos;
 
-	AStarNodes nodes(pos.x, pos.y);
+	AStarNodes& nodes = AStarNodes::getThreadNodes(pos.x, pos.y);
+	PathfindingStatsScope statsScope(nodes);
 
 	int32_t bestMatch = 0;
 
@@ -839,7 +1273,8 @@ bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& d
 	Position pos = start;
 	Position endPos;
 
-	AStarNodes nodes(pos.x, pos.y);
+	AStarNodes& nodes = AStarNodes::getThreadNodes(pos.x, pos.y);
+	PathfindingStatsScope statsScope(nodes);
 
 	int32_t bestMatch = 0;
 
@@ -936,14 +1371,10 @@ bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& d
 				continue;
 			}
 
-			const Tile* tile;
 			AStarNode* neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
-			if (neighborNode) {
-				tile = getTile(pos.x, pos.y, pos.z);
-			}
-			else {
-				tile = getTile(pos.x, pos.y, pos.z);
-				if (!tile || tile->hasFlag(TILESTATE_BLOCKSOLID)) {
+			if (!neighborNode) {
+				uint8_t walkFlags = getTileWalkFlags(pos.x, pos.y, pos.z);
+				if (!(walkFlags & TILE_WALK_EXISTS) || (walkFlags & TILE_WALK_BLOCKSOLID)) {
 					continue;
 				}
 			}
@@ -1028,19 +1459,40 @@ bool Map::getPathMatching(const Position& start, std::forward_list<Direction>& d
 
 // AStarNodes
 
-AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: nodes(), openNodes()
+PathfindingStats AStarNodes::stats;
+SightCacheStats Map::sightCacheStats;
+
+AStarNodes& AStarNodes::getThreadNodes(uint32_t x, uint32_t y)
 {
+	// path searches also run on the worker threads of the creature think planning
+	thread_local std::unique_ptr<AStarNodes> threadNodes = std::make_unique<AStarNodes>();
+	threadNodes->reset(x, y);
+	return *threadNodes;
+}
+
+void AStarNodes::reset(uint32_t x, uint32_t y)
+{
+	if (++stamp == 0) {
+		std::fill(std::begin(gridStamp), std::end(gridStamp), 0);
+		stamp = 1;
+	}
+	farNodes.clear();
+
+	originX = x;
+	originY = y;
 	curNode = 1;
 	closedNodes = 0;
-	openNodes[0] = true;
+	expandedNodes = 0;
 
 	AStarNode& startNode = nodes[0];
 	startNode.parent = nullptr;
 	startNode.x = x;
 	startNode.y = y;
 	startNode.f = 0;
-	nodeTable[(x << 16) | y] = nodes;
+	setNodeByPosition(x, y, nodes);
+
+	heapSize = 0;
+	heapPush(0);
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -1050,53 +1502,46 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 	}
 
 	size_t retNode = curNode++;
-	openNodes[retNode] = true;
 
 	AStarNode* node = nodes + retNode;
-	nodeTable[(x << 16) | y] = node;
+	setNodeByPosition(x, y, node);
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+	heapPush(static_cast<uint16_t>(retNode));
 	return node;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-	if (curNode == 0) {
+	if (heapSize == 0) {
 		return nullptr;
 	}
-
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (size_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
-		}
-	}
-
-	if (best_node >= 0) {
-		return nodes + best_node;
-	}
-	return nullptr;
+	return nodes + heap[0];
 }
 
 void AStarNodes::closeNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	openNodes[index] = false;
+	if (heapIndex[index] >= 0) {
+		heapRemove(static_cast<uint16_t>(index));
+	}
 	++closedNodes;
+	++expandedNodes;
 }
 
 void AStarNodes::openNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	if (!openNodes[index]) {
-		openNodes[index] = true;
+	if (heapIndex[index] < 0) {
+		heapPush(static_cast<uint16_t>(index));
 		--closedNodes;
+	} else {
+		// already open, its f just went down
+		heapSiftUp(heapIndex[index]);
 	}
 }
 
@@ -1107,13 +1552,108 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
-	auto it = nodeTable.find((x << 16) | y);
-	if (it == nodeTable.end()) {
+	int32_t gridIndex = getGridIndex(x, y);
+	if (gridIndex >= 0) {
+		if (gridStamp[gridIndex] != stamp) {
+			return nullptr;
+		}
+		return nodes + gridNode[gridIndex];
+	}
+
+	auto it = farNodes.find((x << 16) | y);
+	if (it == farNodes.end()) {
 		return nullptr;
 	}
 	return it->second;
 }
 
+int32_t AStarNodes::getGridIndex(uint32_t x, uint32_t y) const
+{
+	int32_t gridX = static_cast<int32_t>(x) - static_cast<int32_t>(originX) + ASTAR_GRID_RADIUS;
+	int32_t gridY = static_cast<int32_t>(y) - static_cast<int32_t>(originY) + ASTAR_GRID_RADIUS;
+	if (gridX < 0 || gridX >= ASTAR_GRID_SIZE || gridY < 0 || gridY >= ASTAR_GRID_SIZE) {
+		return -1;
+	}
+	return gridY * ASTAR_GRID_SIZE + gridX;
+}
+
+void AStarNodes::setNodeByPosition(uint32_t x, uint32_t y, AStarNode* node)
+{
+	int32_t gridIndex = getGridIndex(x, y);
+	if (gridIndex >= 0) {
+		gridStamp[gridIndex] = stamp;
+		gridNode[gridIndex] = static_cast<uint16_t>(node - nodes);
+	} else {
+		farNodes[(x << 16) | y] = node;
+	}
+}
+
+void AStarNodes::heapPush(uint16_t index)
+{
+	heap[heapSize] = index;
+	heapIndex[index] = static_cast<int16_t>(heapSize);
+	heapSiftUp(heapSize++);
+}
+
+void AStarNodes::heapRemove(uint16_t index)
+{
+	int32_t position = heapIndex[index];
+	heapIndex[index] = -1;
+	if (--heapSize == position) {
+		return;
+	}
+
+	uint16_t last = heap[heapSize];
+	heap[position] = last;
+	heapIndex[last] = static_cast<int16_t>(position);
+	heapSiftUp(position);
+	heapSiftDown(heapIndex[last]);
+}
+
+void AStarNodes::heapSiftUp(int32_t position)
+{
+	uint16_t index = heap[position];
+	int_fast32_t f = nodes[index].f;
+	while (position > 0) {
+		int32_t parent = (position - 1) / 2;
+		if (nodes[heap[parent]].f <= f) {
+			break;
+		}
+
+		heap[position] = heap[parent];
+		heapIndex[heap[position]] = static_cast<int16_t>(position);
+		position = parent;
+	}
+	heap[position] = index;
+	heapIndex[index] = static_cast<int16_t>(position);
+}
+
+void AStarNodes::heapSiftDown(int32_t position)
+{
+	uint16_t index = heap[position];
+	int_fast32_t f = nodes[index].f;
+	while (true) {
+		int32_t child = position * 2 + 1;
+		if (child >= heapSize) {
+			break;
+		}
+
+		if (child + 1 < heapSize && nodes[heap[child + 1]].f < nodes[heap[child]].f) {
+			++child;
+		}
+
+		if (f <= nodes[heap[child]].f) {
+			break;
+		}
+
+		heap[position] = heap[child];
+		heapIndex[heap[position]] = static_cast<int16_t>(position);
+		position = child;
+	}
+	heap[position] = index;
+	heapIndex[index] = static_cast<int16_t>(position);
+}
+
 int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos, bool preferDiagonal)
 {
 	if (std::abs(node->x - neighborPos.x) == std::abs(node->y - neighborPos.y)) {
@@ -1213,65 +1753,102 @@ Floor* QTreeLeafNode::createFloor(uint32_t z)
 void QTreeLeafNode::addCreature(Creature* c)
 {
 	creature_list.push_back(c);
+	creaturePositions.add(c->getPosition());
 
 	if (c->getPlayer()) {
 		player_list.push_back(c);
+		playerPositions.add(c->getPosition());
 	}
 }
 
+void QTreeLeafNode::reserveCreatures(size_t count)
+{
+	creature_list.reserve(creature_list.size() + count);
+	creaturePositions.reserve(creaturePositions.size() + count);
+}
+
 void QTreeLeafNode::removeCreature(Creature* c)
 {
 	auto iter = std::find(creature_list.begin(), creature_list.end(), c);
 	assert(iter != creature_list.end());
+	creaturePositions.remove(iter - creature_list.begin());
 	*iter = creature_list.back();
 	creature_list.pop_back();
 
 	if (c->getPlayer()) {
 		iter = std::find(player_list.begin(), player_list.end(), c);
 		assert(iter != player_list.end());
+		playerPositions.remove(iter - player_list.begin());
 		*iter = player_list.back();
 		player_list.pop_back();
 	}
 }
 
-uint32_t Map::clean() const
+void QTreeLeafNode::updateCreaturePosition(Creature* c)
 {
-	uint64_t start = OTSYS_TIME();
-	size_t tiles = 0;
-
-	if (g_game().getGameState() == GAME_STATE_NORMAL) {
-		g_game().setGameState(GAME_STATE_MAINTAIN);
+	auto iter = std::find(creature_list.begin(), creature_list.end(), c);
+	if (iter == creature_list.end()) {
+		return;
 	}
+	creaturePositions.set(iter - creature_list.begin(), c->getPosition());
 
-	std::vector<Item*> toRemove;
-	for (auto tile : g_game().getTilesToClean()) {
-    if (!tile) {
-      continue;
-    }
-    if (auto items = tile->getItemList()) {
-      ++tiles;
-      for (auto item : *items) {
-				if (item->isCleanable()) {
-					toRemove.emplace_back(item);
-				}
-      }
+	if (c->getPlayer()) {
+		iter = std::find(player_list.begin(), player_list.end(), c);
+		if (iter != player_list.end()) {
+			playerPositions.set(iter - player_list.begin(), c->getPosition());
 		}
 	}
+}
 
-  for (auto item : toRemove) {
-		g_game().internalRemoveItem(item, -1);
+uint32_t Map::clean()
+{
+	const bool running = cleanQueueIndex < cleanQueue.size();
+	uint32_t count = g_game().takeTilesToClean(cleanQueue);
+	if (!running && cleanQueueIndex < cleanQueue.size()) {
+		cleanRun = {};
+		cleanRun.start = OTSYS_PRECISE_TIME();
+		cleanSlice();
 	}
+	return count;
+}
 
-	size_t count = toRemove.size();
-	g_game().clearTilesToClean();
+void Map::cleanSlice()
+{
+	int64_t sliceStart = OTSYS_PRECISE_TIME();
+	std::vector<Item*> removedItems;
+	while (cleanQueueIndex < cleanQueue.size() && OTSYS_PRECISE_TIME() - sliceStart < CLEAN_SLICE_BUDGET_MS) {
+		Tile* tile = cleanQueue[cleanQueueIndex++];
+		// the items added from now on are counted again
+		g_game().forgetTileToClean(tile);
+
+		removedItems.clear();
+		tile->removeCleanableItems(removedItems);
+		for (Item* item : removedItems) {
+			item->onRemoved();
+			item->stopDecaying();
+			g_game().ReleaseItem(item);
+		}
 
-	if (g_game().getGameState() == GAME_STATE_MAINTAIN) {
-		g_game().setGameState(GAME_STATE_NORMAL);
+		if (!removedItems.empty()) {
+			cleanRun.items += removedItems.size();
+			++cleanRun.tiles;
+		}
 	}
 
-	SPDLOG_INFO("CLEAN: Removed {} item{} from {} tile{} in {} seconds",
-                count, (count != 1 ? "s" : ""),
-                tiles, (tiles != 1 ? "s" : ""),
-                (OTSYS_TIME() - start) / (1000.));
-	return count;
+	cleanRun.busyMs += OTSYS_PRECISE_TIME() - sliceStart;
+	++cleanRun.slices;
+
+	if (cleanQueueIndex < cleanQueue.size()) {
+		SchedulerTask* task = createSchedulerTask(CLEAN_SLICE_DELAY, std::bind(&Map::cleanSlice, this));
+		task->setPriority(TASK_PRIORITY_LOW);
+		g_scheduler().addEvent(task);
+		return;
+	}
+
+	cleanQueue.clear();
+	cleanQueueIndex = 0;
+	SPDLOG_INFO("CLEAN: Removed {} item{} from {} tile{} in {} slices, {}ms on the dispatcher over {}ms",
+                cleanRun.items, (cleanRun.items != 1 ? "s" : ""),
+                cleanRun.tiles, (cleanRun.tiles != 1 ? "s" : ""),
+                cleanRun.slices, cleanRun.busyMs, OTSYS_PRECISE_TIME() - cleanRun.start);
 }
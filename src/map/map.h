@@ -24,6 +24,11 @@
 #include "items/item.h"
 #include "items/tile.h"
 #include "map/town.h"
+#include "map/flow_field.hpp"
+#include "map/map_instances.hpp"
+#include "map/map_streamer.hpp"
+#include "map/path_hierarchy.hpp"
+#include "map/spectator_positions.hpp"
 #include "map/house/house.h"
 #include "creatures/monsters/spawns/spawn_monster.h"
 #include "creatures/npcs/spawns/spawn_npc.h"
@@ -35,6 +40,7 @@ class Tile;
 class Map;
 
 static constexpr int32_t MAP_MAX_LAYERS = 16;
+static_assert(MAP_MAX_LAYERS <= SPECTATOR_FLOORS, "the spectator floor masks must cover every floor");
 
 struct FindPathParams;
 struct AStarNode {
@@ -44,15 +50,61 @@ struct AStarNode {
 };
 
 static constexpr int32_t MAX_NODES = 512;
+// nodes within this distance of the start are looked up in a grid, farther ones in a hash map
+static constexpr int32_t ASTAR_GRID_RADIUS = 64;
+static constexpr int32_t ASTAR_GRID_SIZE = ASTAR_GRID_RADIUS * 2;
 
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_PREFERDIAGONALWALKCOST = 14;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
 
+// Counters of every path search since the last report, shared by all threads
+struct PathfindingStats {
+	std::atomic<uint64_t> searches {0};
+	std::atomic<uint64_t> exhausted {0};
+	std::atomic<uint64_t> expandedNodes {0};
+	std::atomic<uint64_t> maxExpandedNodes {0};
+	std::atomic<uint64_t> micros {0};
+
+	void reset() {
+		searches.store(0, std::memory_order_relaxed);
+		exhausted.store(0, std::memory_order_relaxed);
+		expandedNodes.store(0, std::memory_order_relaxed);
+		maxExpandedNodes.store(0, std::memory_order_relaxed);
+		micros.store(0, std::memory_order_relaxed);
+	}
+};
+
+// Lookups of the line of sight cache since the last report, shared by all threads
+struct SightCacheStats {
+	std::atomic<uint64_t> hits {0};
+	std::atomic<uint64_t> misses {0};
+
+	void reset() {
+		hits.store(0, std::memory_order_relaxed);
+		misses.store(0, std::memory_order_relaxed);
+	}
+};
+
+// every thread keeps its own sight cache, dropped as a whole past this many entries
+static constexpr size_t SIGHT_CACHE_MAX_ENTRIES = 8192;
+
 class AStarNodes
 {
 	public:
-		AStarNodes(uint32_t x, uint32_t y);
+		AStarNodes() = default;
+
+		// non-copyable
+		AStarNodes(const AStarNodes&) = delete;
+		AStarNodes& operator=(const AStarNodes&) = delete;
+
+		// Workspace of the calling thread, reset for a search starting at x, y
+		static AStarNodes& getThreadNodes(uint32_t x, uint32_t y);
+		static PathfindingStats& getStats() {
+			return stats;
+		}
+
+		void reset(uint32_t x, uint32_t y);
 
 		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
 		AStarNode* getBestNode();
@@ -61,19 +113,47 @@ class AStarNodes
 		int_fast32_t getClosedNodes() const;
 		AStarNode* getNodeByPosition(uint32_t x, uint32_t y);
 
+		uint32_t getExpandedNodes() const {
+			return expandedNodes;
+		}
+		bool isFull() const {
+			return curNode >= MAX_NODES;
+		}
+
 		static int_fast32_t getMapWalkCost(AStarNode* node, const Position& neighborPos, bool preferDiagonal = false);
 		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		int32_t getGridIndex(uint32_t x, uint32_t y) const;
+		void setNodeByPosition(uint32_t x, uint32_t y, AStarNode* node);
+
+		// open set, a binary min heap on f indexed by heapIndex
+		void heapPush(uint16_t index);
+		void heapRemove(uint16_t index);
+		void heapSiftUp(int32_t position);
+		void heapSiftDown(int32_t position);
+
+		static PathfindingStats stats;
+
 		AStarNode nodes[MAX_NODES];
-		bool openNodes[MAX_NODES];
-		phmap::flat_hash_map<uint32_t, AStarNode*> nodeTable;
-		size_t curNode;
-		int_fast32_t closedNodes;
+		// position of every node in the heap, -1 when it is closed
+		int16_t heapIndex[MAX_NODES];
+		uint16_t heap[MAX_NODES];
+		int32_t heapSize = 0;
+
+		// grid entries are valid only when their stamp matches the current search
+		uint32_t gridStamp[ASTAR_GRID_SIZE * ASTAR_GRID_SIZE] = {};
+		uint16_t gridNode[ASTAR_GRID_SIZE * ASTAR_GRID_SIZE];
+		uint32_t stamp = 0;
+		phmap::flat_hash_map<uint32_t, AStarNode*> farNodes;
+
+		uint32_t originX = 0;
+		uint32_t originY = 0;
+		size_t curNode = 0;
+		int_fast32_t closedNodes = 0;
+		uint32_t expandedNodes = 0;
 };
 
-using SpectatorCache = std::map<Position, SpectatorHashSet>;
-
 static constexpr int32_t FLOOR_BITS = 3;
 static constexpr int32_t FLOOR_SIZE = (1 << FLOOR_BITS);
 static constexpr int32_t FLOOR_MASK = (FLOOR_SIZE - 1);
@@ -86,12 +166,66 @@ struct Floor {
 	Floor(const Floor&) = delete;
 	Floor& operator=(const Floor&) = delete;
 
+	static void* operator new(size_t size) {
+		MemoryAccounting::allocate(MEMORY_TAG_FLOOR, size);
+		return MapArena::allocate(size);
+	}
+	static void operator delete(void* pointer, size_t size) {
+		MemoryAccounting::deallocate(MEMORY_TAG_FLOOR, size);
+		MapArena::deallocate(pointer);
+	}
+
 	Tile* tiles[FLOOR_SIZE][FLOOR_SIZE] = {};
+	// TileWalkFlags of every tile, kept next to the pointers so sight and path checks skip the tile itself
+	uint8_t walkFlags[FLOOR_SIZE][FLOOR_SIZE] = {};
 };
 
 class FrozenPathingConditionCall;
 class QTreeLeafNode;
 
+struct SpectatorCacheKey {
+	Position centerPos;
+	int32_t minRangeX;
+	int32_t maxRangeX;
+	int32_t minRangeY;
+	int32_t maxRangeY;
+	bool multifloor;
+	bool onlyPlayers;
+
+	bool operator==(const SpectatorCacheKey& other) const {
+		return centerPos == other.centerPos && minRangeX == other.minRangeX && maxRangeX == other.maxRangeX &&
+			minRangeY == other.minRangeY && maxRangeY == other.maxRangeY &&
+			multifloor == other.multifloor && onlyPlayers == other.onlyPlayers;
+	}
+};
+
+struct SpectatorCacheKeyHash {
+	size_t operator()(const SpectatorCacheKey& key) const {
+		uint64_t hash = (static_cast<uint64_t>(key.centerPos.x) << 24) | (static_cast<uint64_t>(key.centerPos.y) << 8) | key.centerPos.z;
+		hash = hash * 31 + static_cast<uint32_t>(key.minRangeX);
+		hash = hash * 31 + static_cast<uint32_t>(key.maxRangeX);
+		hash = hash * 31 + static_cast<uint32_t>(key.minRangeY);
+		hash = hash * 31 + static_cast<uint32_t>(key.maxRangeY);
+		hash = (hash << 2) | (key.multifloor ? 2 : 0) | (key.onlyPlayers ? 1 : 0);
+		return std::hash<uint64_t>()(hash);
+	}
+};
+
+// Leaves a cached spectator set was built from, with their generation at that time
+using SpectatorCacheLeaves = std::vector<std::pair<const QTreeLeafNode*, uint32_t>>;
+
+struct SpectatorCacheEntry {
+	SpectatorHashSet spectators;
+	SpectatorCacheLeaves leaves;
+};
+
+using SpectatorCache = phmap::flat_hash_map<SpectatorCacheKey, SpectatorCacheEntry, SpectatorCacheKeyHash>;
+
+// the cache is dropped as a whole when it grows past this many entries
+static constexpr size_t SPECTATOR_CACHE_MAX_ENTRIES = 16384;
+// the flat leaf index is skipped for maps spread over a larger box (8 bytes per entry)
+static constexpr size_t MAP_LEAF_INDEX_MAX_ENTRIES = 1 << 22;
+
 class QTreeNode
 {
 	public:
@@ -150,14 +284,33 @@ class QTreeLeafNode final : public QTreeNode
 
 		void addCreature(Creature* c);
 		void removeCreature(Creature* c);
+		// Makes room for count more creatures, players are not counted
+		void reserveCreatures(size_t count);
+		// Refreshes the stored position of a creature that moved inside this leaf
+		void updateCreaturePosition(Creature* c);
+
+		uint32_t getTileGeneration() const {
+			return tileGeneration;
+		}
+		uint32_t getWalkGeneration() const {
+			return walkGeneration;
+		}
 
 	private:
 		static bool newLeaf;
+		// bumped whenever a creature enters, leaves or moves inside this leaf
+		uint32_t spectatorGeneration = 0;
+		// bumped whenever the flags of a tile inside this leaf change
+		uint32_t tileGeneration = 0;
+		// bumped whenever a tile inside this leaf is created, removed or starts or stops blocking the way
+		uint32_t walkGeneration = 0;
 		QTreeLeafNode* leafS = nullptr;
 		QTreeLeafNode* leafE = nullptr;
 		Floor* array[MAP_MAX_LAYERS] = {};
 		CreatureVector creature_list;
 		CreatureVector player_list;
+		SpectatorPositions creaturePositions;
+		SpectatorPositions playerPositions;
 
 		friend class Map;
 		friend class QTreeNode;
@@ -176,7 +329,11 @@ class Map
 		static constexpr int32_t maxClientViewportX = 8;
 		static constexpr int32_t maxClientViewportY = 6;
 
-		uint32_t clean() const;
+		/**
+		 * Starts removing the cleanable items in slices of the dispatcher, the game keeps running.
+		 * \returns the number of items that will be removed
+		 */
+		uint32_t clean();
 
 		/**
          * Load a map.
@@ -191,7 +348,13 @@ class Map
 		 * \param loadNpcs if true, the main map npcs is loaded
 		 * \returns true if the main map was loaded successfully
 		*/
-		bool loadMap(const std::string& identifier, bool mainMap = false, bool loadHouses = false, bool loadMonsters = false, bool loadNpcs = false);
+		bool loadMap(const std::string& identifier, bool mainMap = false, bool loadHouses = false, bool loadMonsters = false, bool loadNpcs = false, bool fileLoaded = false);
+		/**
+		 * Reads the OTBM alone, downloading the main map first if enabled.
+		 * Touches neither Lua nor the script registries, so it may run while the scripts load;
+		 * loadMap with fileLoaded then adds the rest.
+		 */
+		void loadMapFile(const std::string& identifier, bool mainMap);
 		/**
 		* Load the custom map
 		 * \param identifier Is the map custom folder
@@ -213,10 +376,36 @@ class Map
          * \returns A pointer to that tile.
          */
 		Tile* getTile(uint16_t x, uint16_t y, uint8_t z) const;
+		// TileWalkFlags of the tile, 0 if there is none
+		uint8_t getTileWalkFlags(uint16_t x, uint16_t y, uint8_t z) const;
 		Tile* getTile(const Position& pos) const {
 			return getTile(pos.x, pos.y, pos.z);
 		}
 
+		// Sectors of the map created from its cache on demand when mapStreaming is enabled
+		MapStreamer& getStreamer() const {
+			return streamer;
+		}
+		// Copies of map regions whose tiles are created from the region when first used
+		MapInstances& getInstances() const {
+			return instances;
+		}
+
+		// getTile creates no tiles while it lives, the map is read from worker threads meanwhile
+		struct ReadOnlyScope {
+			explicit ReadOnlyScope(Map& map) : map(map) {
+				++map.readOnly;
+			}
+			~ReadOnlyScope() {
+				--map.readOnly;
+			}
+
+			Map& map;
+		};
+		bool isReadOnly() const {
+			return readOnly != 0;
+		}
+
 		/**
          * Set a single tile.
          */
@@ -233,6 +422,8 @@ class Map
          * \param forceLogin If true, placing the creature will not fail becase of obstacles (creatures/chests)
          */
 		bool placeCreature(const Position& centerPos, Creature* creature, bool extendedPos = false, bool forceLogin = false);
+		// Pre-sizes the creature lists of the leaves before a creature is placed at each position
+		void reserveCreatures(const std::vector<Position>& positions);
 
 		void moveCreature(Creature& creature, Tile& newTile, bool forceTeleport = false);
 
@@ -240,7 +431,44 @@ class Map
                            int32_t minRangeX = 0, int32_t maxRangeX = 0,
                            int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
+		/**
+         * Calls fn(Creature*) for every spectator without copying them into a set.
+         * The visited set lives in the spectator cache, so fn must not add,
+         * remove or move creatures, nor query spectators again.
+         */
+		template <typename Fn>
+		void forEachSpectator(const Position& centerPos, bool multifloor, bool onlyPlayers, Fn&& fn,
+                              int32_t minRangeX = 0, int32_t maxRangeX = 0,
+                              int32_t minRangeY = 0, int32_t maxRangeY = 0) {
+			if (centerPos.z >= MAP_MAX_LAYERS) {
+				return;
+			}
+
+			for (Creature* spectator : getCachedSpectators(centerPos, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY)) {
+				fn(spectator);
+			}
+		}
+
 		void clearSpectatorCache();
+		// Drops the cached spectator sets that cover the leaf holding this position
+		void invalidateSpectatorCache(const Position& pos);
+
+		/**
+		 * While enabled, spectator queries of the default view range that miss the
+		 * cache are filtered from one query over the whole leaf and floor, so many
+		 * tiles updated at once (mass decay, area combat) share it. Disabling drops those sets.
+		 * \returns the previous state
+		 */
+		bool setSpectatorBatch(bool enabled);
+
+		/**
+         * Checks if any player is within the given range, stopping at the first one found
+         * \param centerPos The center position
+         * \param multifloor If true, also checks the floors the center position can see
+         * \returns true if a player is in range
+         */
+		bool hasPlayersInRange(const Position& centerPos, bool multifloor = true,
+                               int32_t rangeX = maxViewportX, int32_t rangeY = maxViewportY) const;
 
 		/**
          * Checks if you can throw an object to that position
@@ -265,6 +493,10 @@ class Map
 		bool isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const;
 		bool checkSightLine(const Position& fromPos, const Position& toPos) const;
 
+		static SightCacheStats& getSightCacheStats() {
+			return sightCacheStats;
+		}
+
 		const Tile* canWalkTo(const Creature& creature, const Position& pos) const;
 
 		bool getPathMatching(const Creature& creature, std::forward_list<Direction>& dirList,
@@ -275,10 +507,39 @@ class Map
 
 		std::map<std::string, Position> waypoints;
 
+		/**
+		 * Rebuilds the flat index over the bounding box of every leaf, or drops it so all
+		 * lookups go through the quadtree. load builds it when mapFlatLeafIndex is on.
+		 */
+		void buildLeafIndex(bool enabled);
+
 		QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) {
-			return QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(&root, x, y);
+			return findLeaf(x, y);
+		}
+		const QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) const {
+			return findLeaf(x, y);
 		}
 
+		/**
+         * Flow field towards the position of a creature, shared by everyone chasing it
+         * and rebuilt once the creature moved or the tiles around it changed.
+         * Dispatcher thread only.
+         */
+		const FlowField& getFlowField(const Creature& target);
+		/**
+		 * Path over any distance on one floor, for when getPathMatching runs out of nodes:
+		 * planned over the sectors of PathHierarchy, then refined with getPathMatching
+		 * from one sector entrance to the next. False when hierarchicalPathfinding is off.
+		 * Dispatcher thread only.
+		 */
+		bool getLongPathMatching(const Position& startPos, std::forward_list<Direction>& dirList, const Position& targetPos, const FindPathParams& fpp);
+		// Marks the tiles of the leaf holding this position as changed
+		void updateTileGeneration(const Position& pos);
+		// Refreshes the walk flags stored for this tile
+		void updateTileWalkFlags(const Tile& tile);
+		// Recomputes TILESTATE_MOVEEVENT on every tile, after move events were reloaded
+		void updateMoveEventFlags();
+
 		// Storage made by "loadFromXML" of houses, monsters and npcs for main map
 		SpawnsMonster spawnsMonster;
 		SpawnsNpc spawnsNpc;
@@ -290,10 +551,69 @@ class Map
 		SpawnsNpc spawnsNpcCustom;
 		Houses housesCustom;
 	private:
+		// getTile without creating a streamed sector
+		Tile* getLoadedTile(uint16_t x, uint16_t y, uint8_t z) const;
+		// Deletes an unchanged tile the streamer creates again from the map cache when needed
+		void releaseTile(uint16_t x, uint16_t y, uint8_t z);
+
+		/**
+		 * Leaf lookup through the flat index when the position is inside its box,
+		 * through the quadtree otherwise. Coordinates wrap at 0xFFFF like in the quadtree.
+		 */
+		QTreeLeafNode* findLeaf(uint32_t x, uint32_t y) const {
+			uint32_t column = ((x & 0xFFFF) >> FLOOR_BITS) - leafIndexX;
+			uint32_t row = ((y & 0xFFFF) >> FLOOR_BITS) - leafIndexY;
+			if (column < leafIndexWidth && row < leafIndexHeight) {
+				return leafIndex[row * leafIndexWidth + column];
+			}
+			// the const getQTNode and getTile hand the leaf out as const
+			return QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(const_cast<QTreeNode*>(&root), x, y);
+		}
+		// tiles of the running clean handled per dispatcher task, the next slice follows after a short delay
+		static constexpr int64_t CLEAN_SLICE_BUDGET_MS = 10;
+		static constexpr uint32_t CLEAN_SLICE_DELAY = 50;
+
+		void cleanSlice();
+		bool isCleaning() const {
+			return cleanQueueIndex < cleanQueue.size();
+		}
+		std::vector<Tile*> cleanQueue;
+		size_t cleanQueueIndex = 0;
+		struct {
+			size_t items = 0;
+			size_t tiles = 0;
+			uint32_t slices = 0;
+			int64_t busyMs = 0;
+			int64_t start = 0;
+		} cleanRun;
+		// Stores the walk flags of a tile, bumping sightGeneration if its sight blocking changed and the walk generation of the leaf if its walkability did
+		void setWalkFlags(QTreeLeafNode& leaf, Floor& floor, uint32_t offsetX, uint32_t offsetY, uint8_t walkFlags);
+
 		SpectatorCache spectatorCache;
-		SpectatorCache playersSpectatorCache;
+		/**
+		 * Bumped whenever a tile starts or stops blocking sight (the projectile and
+		 * has things bits of its walk flags), which drops every cached sight line.
+		 */
+		std::atomic<uint32_t> sightGeneration {0};
+		static SightCacheStats sightCacheStats;
+		// spectators of a whole leaf on one floor, by the leaf corner, while spectatorBatch is set
+		SpectatorCache leafSpectatorCache;
+		bool spectatorBatch = false;
+		phmap::flat_hash_map<uint32_t, FlowField> flowFields;
+		PathHierarchy pathHierarchy;
 
 		QTreeNode root;
+		// getTile creates missing streamed sectors and instance tiles, also through the const map
+		mutable MapStreamer streamer {*this};
+		mutable MapInstances instances {*this};
+		uint32_t readOnly = 0;
+
+		// leaves by (x >> FLOOR_BITS, y >> FLOOR_BITS) inside a box, nullptr where there are none
+		std::vector<QTreeLeafNode*> leafIndex;
+		uint32_t leafIndexX = 0;
+		uint32_t leafIndexY = 0;
+		uint32_t leafIndexWidth = 0;
+		uint32_t leafIndexHeight = 0;
 
 		std::string monsterfile;
 		std::string housefile;
@@ -302,15 +622,25 @@ class Map
 		uint32_t width = 0;
 		uint32_t height = 0;
 
+		static void getSpectatorFloorRange(const Position& centerPos, bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ);
+		static bool isSpectatorCacheValid(const SpectatorCacheEntry& entry);
+		// Up to date cached result of a spectator query, scanning the map if needed
+		const SpectatorHashSet& getCachedSpectators(const Position& centerPos, bool multifloor, bool onlyPlayers,
+                                                    int32_t minRangeX, int32_t maxRangeX,
+                                                    int32_t minRangeY, int32_t maxRangeY);
+		const SpectatorCacheEntry& getLeafSpectators(const Position& centerPos, bool multifloor, bool onlyPlayers, int32_t minRangeZ, int32_t maxRangeZ);
+
 		// Actually scans the map for spectators
 		void getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos,
                                    int32_t minRangeX, int32_t maxRangeX,
                                    int32_t minRangeY, int32_t maxRangeY,
                                    int32_t minRangeZ, int32_t maxRangeZ,
-                                   bool onlyPlayers) const;
+                                   bool onlyPlayers, SpectatorCacheLeaves* leaves = nullptr) const;
 
 		friend class Game;
 		friend class IOMap;
+		friend class MapInstances;
+		friend class MapStreamer;
 };
 
 #endif  // SRC_MAP_MAP_H_
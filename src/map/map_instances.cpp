@@ -0,0 +1,262 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/game.h"
+#include "map/map_instances.hpp"
+
+namespace {
+
+// the copy registers no unique id, the template item keeps it
+void removeUniqueIds(Item* item)
+{
+	item->removeAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+	if (Container* container = item->getContainer()) {
+		for (Item* containerItem : container->getItemList()) {
+			removeUniqueIds(containerItem);
+		}
+	}
+}
+
+void stopDecaying(Item* item)
+{
+	item->stopDecaying();
+	if (Container* container = item->getContainer()) {
+		for (Item* containerItem : container->getItemList()) {
+			stopDecaying(containerItem);
+		}
+	}
+}
+
+Item* copyItem(const Item* item)
+{
+	Item* copy = item->clone();
+	removeUniqueIds(copy);
+	return copy;
+}
+
+}  // namespace
+
+uint32_t MapInstances::create(const Position& from, const Position& to, Position& origin)
+{
+	if (from.x > to.x || from.y > to.y || from.z > to.z || to.z >= MAP_MAX_LAYERS ||
+			to.x - from.x >= MAP_INSTANCE_MAX_SIZE || to.y - from.y >= MAP_INSTANCE_MAX_SIZE) {
+		return 0;
+	}
+
+	if (slots.empty()) {
+		ownerThread = std::this_thread::get_id();
+		int32_t mapWidth = static_cast<int32_t>(map.width) + MAP_INSTANCE_MARGIN;
+		slotBaseX = (mapWidth + MAP_INSTANCE_SLOT_SIZE - 1) / MAP_INSTANCE_SLOT_SIZE * MAP_INSTANCE_SLOT_SIZE;
+		slotColumns = std::max<int32_t>(0, (0x10000 - slotBaseX) / MAP_INSTANCE_SLOT_SIZE);
+		slots.resize(static_cast<size_t>(slotColumns) * (0x10000 / MAP_INSTANCE_SLOT_SIZE));
+		checkedSlots.resize(slots.size());
+	}
+
+	// a template inside the instance area would be a copy of a copy
+	if (to.x >= slotBaseX) {
+		return 0;
+	}
+
+	for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+		if (slots[slot] != 0) {
+			continue;
+		}
+
+		// slots are checked once, a custom map may reach into the area and destroyed instances leave their leaves
+		if (!checkedSlots[slot]) {
+			checkedSlots[slot] = true;
+			if (!isSlotFree(slot)) {
+				slots[slot] = UNUSABLE_SLOT;
+				continue;
+			}
+		}
+
+		Position slotPos = getSlotPosition(slot);
+		origin = Position(slotPos.x + MAP_INSTANCE_MARGIN, slotPos.y + MAP_INSTANCE_MARGIN, from.z);
+
+		uint32_t instanceId = ++lastInstanceId;
+		slots[slot] = instanceId;
+		instances[instanceId] = {slot, from, to, origin, {}};
+		return instanceId;
+	}
+
+	SPDLOG_WARN("[MapInstances::create] - No room left for another map instance");
+	return 0;
+}
+
+bool MapInstances::destroy(uint32_t instanceId)
+{
+	auto it = instances.find(instanceId);
+	if (it == instances.end()) {
+		return false;
+	}
+
+	Instance& instance = it->second;
+	std::vector<Creature*> creatures;
+	for (const Position& pos : instance.tiles) {
+		const Tile* tile = map.getLoadedTile(pos.x, pos.y, pos.z);
+		const CreatureVector* tileCreatures = tile ? tile->getCreatures() : nullptr;
+		if (!tileCreatures) {
+			continue;
+		}
+
+		for (Creature* creature : *tileCreatures) {
+			if (creature->getPlayer()) {
+				return false;
+			}
+			creatures.push_back(creature);
+		}
+	}
+
+	for (Creature* creature : creatures) {
+		g_game().removeCreature(creature);
+	}
+
+	for (const Position& pos : instance.tiles) {
+		Tile* tile = map.getLoadedTile(pos.x, pos.y, pos.z);
+		if (!tile) {
+			continue;
+		}
+
+		if (Item* ground = tile->getGround()) {
+			stopDecaying(ground);
+		}
+		if (const TileItemVector* items = tile->getItemList()) {
+			for (Item* item : *items) {
+				stopDecaying(item);
+			}
+		}
+		g_game().browseFields.erase(tile);
+		map.releaseTile(pos.x, pos.y, pos.z);
+	}
+
+	slots[instance.slot] = 0;
+	instances.erase(it);
+	return true;
+}
+
+uint32_t MapInstances::getInstanceId(const Position& pos) const
+{
+	if (slots.empty() || pos.x < slotBaseX) {
+		return 0;
+	}
+
+	uint32_t slot = (pos.y / MAP_INSTANCE_SLOT_SIZE) * slotColumns + (pos.x - slotBaseX) / MAP_INSTANCE_SLOT_SIZE;
+	return slot < slots.size() && slots[slot] != UNUSABLE_SLOT ? slots[slot] : 0;
+}
+
+uint32_t MapInstances::findTemplatePosition(uint16_t x, uint16_t y, uint8_t z, Position& templatePos) const
+{
+	auto it = instances.find(getInstanceId(Position(x, y, z)));
+	if (it == instances.end()) {
+		return 0;
+	}
+
+	const Instance& instance = it->second;
+	int32_t offsetX = x - instance.origin.x;
+	int32_t offsetY = y - instance.origin.y;
+	if (offsetX < 0 || offsetX > instance.to.x - instance.from.x || offsetY < 0 || offsetY > instance.to.y - instance.from.y ||
+			z < instance.from.z || z > instance.to.z) {
+		return 0;
+	}
+
+	templatePos = Position(instance.from.x + offsetX, instance.from.y + offsetY, z);
+	return it->first;
+}
+
+Tile* MapInstances::loadTile(uint16_t x, uint16_t y, uint8_t z)
+{
+	if (map.isReadOnly() || std::this_thread::get_id() != ownerThread) {
+		return nullptr;
+	}
+
+	Position templatePos;
+	uint32_t instanceId = findTemplatePosition(x, y, z, templatePos);
+	if (instanceId == 0) {
+		return nullptr;
+	}
+
+	const Tile* templateTile = map.getTile(templatePos);
+	if (!templateTile) {
+		return nullptr;
+	}
+
+	// house tiles are copied as plain tiles, the house stays with the template
+	Tile* tile;
+	if (dynamic_cast<const DynamicTile*>(templateTile)) {
+		tile = new DynamicTile(x, y, z);
+	} else {
+		tile = new StaticTile(x, y, z);
+	}
+
+	if (const Item* ground = templateTile->getGround()) {
+		Item* copy = copyItem(ground);
+		tile->internalAddThing(copy);
+		copy->startDecaying();
+	}
+
+	if (const TileItemVector* items = templateTile->getItemList()) {
+		// added bottom up so the down items keep their order
+		for (auto it = items->rbegin(), end = items->rend(); it != end; ++it) {
+			Item* copy = copyItem(*it);
+			tile->internalAddThing(copy);
+			copy->startDecaying();
+		}
+	}
+
+	for (TileFlags_t flag : {TILESTATE_PROTECTIONZONE, TILESTATE_NOPVPZONE, TILESTATE_NOLOGOUT, TILESTATE_PVPZONE}) {
+		if (templateTile->hasFlag(flag)) {
+			tile->setFlag(flag);
+		}
+	}
+
+	map.setTile(x, y, z, tile);
+	instances[instanceId].tiles.push_back(tile->getPosition());
+	return tile;
+}
+
+uint8_t MapInstances::getTemplateWalkFlags(uint16_t x, uint16_t y, uint8_t z) const
+{
+	Position templatePos;
+	if (findTemplatePosition(x, y, z, templatePos) == 0) {
+		return 0;
+	}
+	return map.getTileWalkFlags(templatePos.x, templatePos.y, templatePos.z);
+}
+
+Position MapInstances::getSlotPosition(uint32_t slot) const
+{
+	return Position(slotBaseX + (slot % slotColumns) * MAP_INSTANCE_SLOT_SIZE, (slot / slotColumns) * MAP_INSTANCE_SLOT_SIZE, 0);
+}
+
+bool MapInstances::isSlotFree(uint32_t slot) const
+{
+	Position slotPos = getSlotPosition(slot);
+	for (int32_t y = 0; y < MAP_INSTANCE_SLOT_SIZE; y += FLOOR_SIZE) {
+		for (int32_t x = 0; x < MAP_INSTANCE_SLOT_SIZE; x += FLOOR_SIZE) {
+			if (map.getQTNode(slotPos.x + x, slotPos.y + y)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,110 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_MAP_MAP_INSTANCES_HPP_
+#define SRC_MAP_MAP_INSTANCES_HPP_
+
+#include <thread>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "game/movement/position.h"
+
+class Map;
+class Tile;
+
+// instances are placed in squares of this many tiles a side, right of the map
+static constexpr int32_t MAP_INSTANCE_SLOT_SIZE = 512;
+// tiles left empty around an instance, more than any spectator range
+static constexpr int32_t MAP_INSTANCE_MARGIN = 32;
+static constexpr int32_t MAP_INSTANCE_MAX_SIZE = MAP_INSTANCE_SLOT_SIZE - 2 * MAP_INSTANCE_MARGIN;
+
+/**
+ * Map instances: copies of a template region of the map at a free place of
+ * the coordinate space, for dungeons and boss rooms. Creating one only books
+ * the place. A tile of the copy is created from the template tile the first
+ * time Map::getTile asks for it, and until then walk and sight checks read
+ * the template's walk flags. Being apart from everything else, the spectators
+ * of an instance are those inside it. Unique ids are not copied, and movement
+ * events registered by position stay with the template.
+ */
+class MapInstances
+{
+	public:
+		explicit MapInstances(Map& map) : map(map) {}
+
+		// non-copyable
+		MapInstances(const MapInstances&) = delete;
+		MapInstances& operator=(const MapInstances&) = delete;
+
+		bool isEnabled() const {
+			return !instances.empty();
+		}
+
+		/**
+		 * Books a place for a copy of the box from - to, every floor between theirs included.
+		 * \returns the id of the instance, 0 if the box is too large or there is no room
+		 */
+		uint32_t create(const Position& from, const Position& to, Position& origin);
+		/**
+		 * Deletes the tiles of the instance with the monsters and npcs on them.
+		 * \returns false if there is no such instance or a player is still inside
+		 */
+		bool destroy(uint32_t instanceId);
+		// the instance holding the position, 0 if none
+		uint32_t getInstanceId(const Position& pos) const;
+
+		// Creates the instance tile at the position from its template tile, dispatcher only
+		Tile* loadTile(uint16_t x, uint16_t y, uint8_t z);
+		// TileWalkFlags of the template tile of an instance tile not created yet
+		uint8_t getTemplateWalkFlags(uint16_t x, uint16_t y, uint8_t z) const;
+
+	private:
+		struct Instance {
+			uint32_t slot;
+			Position from;
+			Position to;
+			Position origin;
+			// instance tiles created so far
+			std::vector<Position> tiles;
+		};
+
+		static constexpr uint32_t UNUSABLE_SLOT = std::numeric_limits<uint32_t>::max();
+
+		// the instance holding the position and the position of its template tile, 0 if none
+		uint32_t findTemplatePosition(uint16_t x, uint16_t y, uint8_t z, Position& templatePos) const;
+		Position getSlotPosition(uint32_t slot) const;
+		// no tile of the map inside the slot
+		bool isSlotFree(uint32_t slot) const;
+
+		Map& map;
+		phmap::flat_hash_map<uint32_t, Instance> instances;
+		// instance id by slot, 0 for a free slot
+		std::vector<uint32_t> slots;
+		std::vector<bool> checkedSlots;
+		uint32_t lastInstanceId = 0;
+		// slots start at this column, right of every map loaded before the first instance
+		int32_t slotBaseX = 0;
+		int32_t slotColumns = 0;
+		std::thread::id ownerThread;
+};
+
+#endif  // SRC_MAP_MAP_INSTANCES_HPP_
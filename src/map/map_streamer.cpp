@@ -0,0 +1,356 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "game/game.h"
+#include "game/scheduling/scheduler.h"
+#include "io/iomap.h"
+#include "io/iomapcache.hpp"
+#include "io/iomapserialize.h"
+#include "map/map_streamer.hpp"
+
+namespace {
+
+// the item is only known by its tile or container, nothing else points at it
+bool isItemDetached(const Item* item, uint32_t parentReferences)
+{
+	if (item->getReferenceCounter() > parentReferences || item->getDecaying() != DECAYING_FALSE) {
+		return false;
+	}
+
+	if (const Container* container = item->getContainer()) {
+		for (const Item* containerItem : container->getItemList()) {
+			if (!isItemDetached(containerItem, 1)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool hasUniqueId(const Item* item)
+{
+	if (item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+		return true;
+	}
+
+	if (const Container* container = item->getContainer()) {
+		for (const Item* containerItem : container->getItemList()) {
+			if (hasUniqueId(containerItem)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+}  // namespace
+
+void MapStreamer::addSector(const char* data, size_t size, const MapTileBatch& batch)
+{
+	if (batch.tiles.empty()) {
+		return;
+	}
+
+	Sector sector {data, static_cast<uint32_t>(size), 0xFFFF, 0xFFFF, 0, 0, batch.tiles.front().z};
+	for (const MapTileRecord& record : batch.tiles) {
+		sector.minX = std::min(sector.minX, record.x);
+		sector.minY = std::min(sector.minY, record.y);
+		sector.maxX = std::max(sector.maxX, record.x);
+		sector.maxY = std::max(sector.maxY, record.y);
+		// houses keep their tiles, and a tile area is always on one floor in maps written by the editor
+		if (record.isHouseTile || record.z != sector.z) {
+			sector.pinned = true;
+		}
+	}
+
+	uint32_t index = static_cast<uint32_t>(sectors.size());
+	for (uint32_t x = sector.minX >> MAP_STREAMING_CELL_BITS; x <= (sector.maxX >> MAP_STREAMING_CELL_BITS); ++x) {
+		for (uint32_t y = sector.minY >> MAP_STREAMING_CELL_BITS; y <= (sector.maxY >> MAP_STREAMING_CELL_BITS); ++y) {
+			std::vector<uint32_t>& cell = cells[getCellKey(x << MAP_STREAMING_CELL_BITS, y << MAP_STREAMING_CELL_BITS, sector.z)];
+			// tiles loaded twice (a custom map over the main map) were merged, neither sector can be created again alone
+			for (uint32_t other : cell) {
+				if (sectors[other].intersects(sector)) {
+					sectors[other].pinned = true;
+					sector.pinned = true;
+				}
+			}
+			cell.push_back(index);
+		}
+	}
+
+	inspectSector(sector, batch);
+	sectors.push_back(sector);
+}
+
+void MapStreamer::start()
+{
+	if (!isEnabled()) {
+		return;
+	}
+
+	ownerThread = std::this_thread::get_id();
+	size_t pinned = std::count_if(sectors.begin(), sectors.end(), [](const Sector& sector) { return sector.pinned; });
+	SPDLOG_INFO("Map streaming: {} sectors, {} of them kept loaded", sectors.size(), pinned);
+	scheduleSweep();
+}
+
+Tile* MapStreamer::loadTile(uint16_t x, uint16_t y, uint8_t z)
+{
+	if (loading || map.isReadOnly() || std::this_thread::get_id() != ownerThread) {
+		return nullptr;
+	}
+
+	auto it = cells.find(getCellKey(x, y, z));
+	if (it == cells.end()) {
+		return nullptr;
+	}
+
+	bool loaded = false;
+	for (uint32_t index : it->second) {
+		Sector& sector = sectors[index];
+		if (!sector.loaded && x >= sector.minX && x <= sector.maxX && y >= sector.minY && y <= sector.maxY) {
+			loadSector(sector);
+			loaded = true;
+		}
+	}
+	return loaded ? map.getLoadedTile(x, y, z) : nullptr;
+}
+
+bool MapStreamer::readSector(const Sector& sector, MapTileBatch& batch) const
+{
+	MapCacheSection section {MAP_CACHE_TILE_AREA, sector.data, sector.size};
+	return MapCacheReader::readTileBatch(section, batch);
+}
+
+void MapStreamer::loadSector(Sector& sector)
+{
+	sector.loaded = true;
+	sector.lastAccess = OTSYS_TIME();
+	++reloaded;
+
+	MapTileBatch batch;
+	if (!readSector(sector, batch)) {
+		SPDLOG_ERROR("[MapStreamer::loadSector] - Invalid tile area in map cache at {}", Position(sector.minX, sector.minY, sector.z).toString());
+		sector.pinned = true;
+		return;
+	}
+
+	loading = true;
+	IOMap loader;
+	bool loaded = loader.loadTileBatch(batch, map);
+	loading = false;
+
+	if (!loaded) {
+		// whatever was created stays, it would not be the same after another try
+		SPDLOG_ERROR("[MapStreamer::loadSector] - {}", loader.getLastErrorString());
+		sector.pinned = true;
+		return;
+	}
+	inspectSector(sector, batch);
+}
+
+void MapStreamer::inspectSector(Sector& sector, const MapTileBatch& batch)
+{
+	if (sector.pinned) {
+		return;
+	}
+
+	// unique ids are registered by item, scripts find the item through them
+	for (const MapTileRecord& record : batch.tiles) {
+		const Tile* tile = map.getLoadedTile(record.x, record.y, record.z);
+		if (!tile) {
+			continue;
+		}
+
+		const TileItemVector* items = tile->getItemList();
+		if (items && std::any_of(items->begin(), items->end(), hasUniqueId)) {
+			sector.pinned = true;
+			return;
+		}
+	}
+	sector.fingerprint = getFingerprint(batch);
+}
+
+size_t MapStreamer::getFingerprint(const MapTileBatch& batch) const
+{
+	PropWriteStream stream;
+	for (const MapTileRecord& record : batch.tiles) {
+		const Tile* tile = map.getLoadedTile(record.x, record.y, record.z);
+		if (!tile) {
+			stream.write<uint8_t>(0);
+			continue;
+		}
+
+		stream.write<uint8_t>(1);
+		if (const Item* ground = tile->getGround()) {
+			IOMapSerialize::saveItem(stream, ground);
+		}
+		if (const TileItemVector* items = tile->getItemList()) {
+			for (const Item* item : *items) {
+				IOMapSerialize::saveItem(stream, item);
+			}
+		}
+	}
+
+	// 0 is left for sectors that have none
+	size_t fingerprint = 1;
+	size_t size;
+	const char* data = stream.getStream(size);
+	boost::hash_combine(fingerprint, std::hash<std::string_view>()(std::string_view(data, size)));
+	return fingerprint;
+}
+
+bool MapStreamer::canRelease(const MapTileBatch& batch) const
+{
+	for (const MapTileRecord& record : batch.tiles) {
+		Tile* tile = map.getLoadedTile(record.x, record.y, record.z);
+		if (!tile) {
+			continue;
+		}
+
+		if (tile->getCreatureCount() != 0 || g_game().browseFields.find(tile) != g_game().browseFields.end()) {
+			return false;
+		}
+
+		// decaying items and items held by a script, a trade or a container view are known by pointer
+		const Item* ground = tile->getGround();
+		if (ground && !isItemDetached(ground, 0)) {
+			return false;
+		}
+
+		const TileItemVector* items = tile->getItemList();
+		if (items && !std::all_of(items->begin(), items->end(), [](const Item* item) { return isItemDetached(item, 1); })) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void MapStreamer::releaseSector(Sector& sector)
+{
+	MapTileBatch batch;
+	if (!readSector(sector, batch) || !canRelease(batch)) {
+		return;
+	}
+
+	if (getFingerprint(batch) != sector.fingerprint) {
+		// the changes would be lost, the sector stays until the server restarts
+		sector.pinned = true;
+		++sweepRun.changed;
+		return;
+	}
+
+	for (const MapTileRecord& record : batch.tiles) {
+		map.releaseTile(record.x, record.y, record.z);
+	}
+	sector.loaded = false;
+	++sweepRun.released;
+}
+
+void MapStreamer::touchPlayerSectors(int64_t now)
+{
+	for (const auto& [playerId, player] : g_game().getPlayers()) {
+		const Position& pos = player->getPosition();
+		int32_t minX = std::max<int32_t>(0, pos.x - MAP_STREAMING_PLAYER_RANGE) >> MAP_STREAMING_CELL_BITS;
+		int32_t minY = std::max<int32_t>(0, pos.y - MAP_STREAMING_PLAYER_RANGE) >> MAP_STREAMING_CELL_BITS;
+		int32_t maxX = std::min<int32_t>(0xFFFF, pos.x + MAP_STREAMING_PLAYER_RANGE) >> MAP_STREAMING_CELL_BITS;
+		int32_t maxY = std::min<int32_t>(0xFFFF, pos.y + MAP_STREAMING_PLAYER_RANGE) >> MAP_STREAMING_CELL_BITS;
+		for (int32_t x = minX; x <= maxX; ++x) {
+			for (int32_t y = minY; y <= maxY; ++y) {
+				// every floor, the client is sent the floors above and below
+				for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+					auto it = cells.find(getCellKey(x << MAP_STREAMING_CELL_BITS, y << MAP_STREAMING_CELL_BITS, z));
+					if (it == cells.end()) {
+						continue;
+					}
+
+					for (uint32_t index : it->second) {
+						sectors[index].lastAccess = now;
+					}
+				}
+			}
+		}
+	}
+}
+
+void MapStreamer::scheduleSweep()
+{
+	SchedulerTask* task = createSchedulerTask(MAP_STREAMING_SWEEP_INTERVAL, std::bind(&MapStreamer::sweep, this));
+	task->setPriority(TASK_PRIORITY_LOW);
+	g_scheduler().addEvent(task);
+}
+
+void MapStreamer::sweep()
+{
+	if (g_game().getGameState() == GAME_STATE_SHUTDOWN) {
+		return;
+	}
+
+	int64_t now = OTSYS_TIME();
+	touchPlayerSectors(now);
+
+	int64_t unloadTime = static_cast<int64_t>(g_configManager().getNumber(MAP_STREAMING_UNLOAD_TIME)) * 1000;
+	sweepQueue.clear();
+	sweepQueueIndex = 0;
+	for (uint32_t index = 0; index < sectors.size(); ++index) {
+		const Sector& sector = sectors[index];
+		if (sector.loaded && !sector.pinned && now - sector.lastAccess >= unloadTime) {
+			sweepQueue.push_back(index);
+		}
+	}
+
+	sweepRun = {};
+	sweepSlice();
+}
+
+void MapStreamer::sweepSlice()
+{
+	int64_t sliceStart = OTSYS_PRECISE_TIME();
+	// a running clean holds tiles by pointer
+	if (!map.isCleaning()) {
+		while (sweepQueueIndex < sweepQueue.size() && OTSYS_PRECISE_TIME() - sliceStart < MAP_STREAMING_SLICE_BUDGET_MS) {
+			Sector& sector = sectors[sweepQueue[sweepQueueIndex++]];
+			// a slice may load it again before its turn
+			if (sector.loaded && !sector.pinned) {
+				releaseSector(sector);
+			}
+		}
+	}
+
+	if (sweepQueueIndex < sweepQueue.size()) {
+		SchedulerTask* task = createSchedulerTask(MAP_STREAMING_SLICE_DELAY, std::bind(&MapStreamer::sweepSlice, this));
+		task->setPriority(TASK_PRIORITY_LOW);
+		g_scheduler().addEvent(task);
+		return;
+	}
+
+	// the count scans every sector, so it only runs with the debug level on; SPDLOG_DEBUG is compiled out
+	if ((sweepRun.released != 0 || sweepRun.changed != 0 || reloaded != 0) && spdlog::should_log(spdlog::level::debug)) {
+		size_t loaded = std::count_if(sectors.begin(), sectors.end(), [](const Sector& sector) { return sector.loaded; });
+		spdlog::debug("Map streaming: {} sectors loaded again, {} released, {} changed and kept, {} of {} loaded",
+			reloaded, sweepRun.released, sweepRun.changed, loaded, sectors.size());
+	}
+	reloaded = 0;
+	sweepQueue.clear();
+	sweepQueueIndex = 0;
+	scheduleSweep();
+}
@@ -0,0 +1,139 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_MAP_MAP_STREAMER_HPP_
+#define SRC_MAP_MAP_STREAMER_HPP_
+
+#include <thread>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <parallel_hashmap/phmap.h>
+
+class Item;
+class Map;
+class Tile;
+struct MapTileBatch;
+
+// sectors are indexed in cells of this many tiles a side, the size of an OTBM tile area
+static constexpr int32_t MAP_STREAMING_CELL_BITS = 8;
+// tiles around a player whose sectors count as touched
+static constexpr int32_t MAP_STREAMING_PLAYER_RANGE = 32;
+static constexpr uint32_t MAP_STREAMING_SWEEP_INTERVAL = 60 * 1000;
+static constexpr int64_t MAP_STREAMING_SLICE_BUDGET_MS = 10;
+static constexpr uint32_t MAP_STREAMING_SLICE_DELAY = 50;
+
+/**
+ * Optional streaming of the map from its map cache (mapStreaming).
+ * Every tile area of the cache is a sector. Sectors are still created at
+ * startup, but the ones left untouched (no player around, no creature on them)
+ * and unchanged (same items as in the cache) for mapStreamingUnloadTime
+ * seconds are dropped and created again from the mapped cache the next time
+ * Map::getTile misses one of their tiles. Sectors with house tiles, unique ids
+ * or tiles shared with another map are never dropped, nor is a sector once its
+ * items differ from the cache.
+ */
+class MapStreamer
+{
+	public:
+		explicit MapStreamer(Map& map) : map(map) {}
+
+		// non-copyable
+		MapStreamer(const MapStreamer&) = delete;
+		MapStreamer& operator=(const MapStreamer&) = delete;
+
+		bool isEnabled() const {
+			return !sources.empty();
+		}
+
+		// Keeps the cache mapped, the sectors point into it
+		void addSource(const boost::iostreams::mapped_file_source& file) {
+			sources.push_back(file);
+		}
+		// Registers a tile area of a cache added with addSource, right after batch was loaded from it
+		void addSector(const char* data, size_t size, const MapTileBatch& batch);
+
+		// Allows loading on the calling thread (the dispatcher) and schedules the sweeps
+		void start();
+
+		/**
+		 * Creates the sectors covering a position that has no tile, on the
+		 * dispatcher only and never while the map is read only.
+		 * \returns the tile at the position afterwards
+		 */
+		Tile* loadTile(uint16_t x, uint16_t y, uint8_t z);
+
+	private:
+		struct Sector {
+			const char* data;
+			uint32_t size;
+			uint16_t minX;
+			uint16_t minY;
+			uint16_t maxX;
+			uint16_t maxY;
+			uint8_t z;
+			bool loaded = true;
+			bool pinned = false;
+			// 0 for sectors created at startup, they count as untouched
+			int64_t lastAccess = 0;
+			size_t fingerprint = 0;
+
+			bool intersects(const Sector& other) const {
+				return z == other.z && minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+			}
+		};
+
+		static uint32_t getCellKey(uint32_t x, uint32_t y, uint8_t z) {
+			return ((x >> MAP_STREAMING_CELL_BITS) << 16) | ((y >> MAP_STREAMING_CELL_BITS) << 8) | z;
+		}
+
+		bool readSector(const Sector& sector, MapTileBatch& batch) const;
+		void loadSector(Sector& sector);
+		// Pins the sector if one of its items is known elsewhere by pointer, else records its fingerprint
+		void inspectSector(Sector& sector, const MapTileBatch& batch);
+		size_t getFingerprint(const MapTileBatch& batch) const;
+		bool canRelease(const MapTileBatch& batch) const;
+		void releaseSector(Sector& sector);
+
+		void touchPlayerSectors(int64_t now);
+		void scheduleSweep();
+		void sweep();
+		void sweepSlice();
+
+		Map& map;
+		std::vector<boost::iostreams::mapped_file_source> sources;
+		std::vector<Sector> sectors;
+		phmap::flat_hash_map<uint32_t, std::vector<uint32_t>> cells;
+
+		// default constructed until start, so nothing is loaded while the server boots
+		std::thread::id ownerThread;
+		bool loading = false;
+
+		std::vector<uint32_t> sweepQueue;
+		size_t sweepQueueIndex = 0;
+		struct {
+			size_t released = 0;
+			size_t changed = 0;
+		} sweepRun;
+		// sectors created again since the last sweep
+		size_t reloaded = 0;
+};
+
+#endif  // SRC_MAP_MAP_STREAMER_HPP_
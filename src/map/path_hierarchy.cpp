@@ -0,0 +1,376 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "creatures/creature.h"
+#include "map/map.h"
+#include "map/path_hierarchy.hpp"
+
+namespace {
+
+// the sides of a sector, walked from their first tile, with the direction out of it
+struct ClusterSide {
+	int32_t x;
+	int32_t y;
+	int32_t stepX;
+	int32_t stepY;
+	int32_t acrossX;
+	int32_t acrossY;
+};
+
+constexpr ClusterSide clusterSides[4] = {
+	{0, 0, 0, 1, -1, 0}, {PATH_CLUSTER_SIZE - 1, 0, 0, 1, 1, 0},
+	{0, 0, 1, 0, 0, -1}, {0, PATH_CLUSTER_SIZE - 1, 1, 0, 0, 1}
+};
+
+constexpr uint64_t START_NODE = std::numeric_limits<uint64_t>::max();
+constexpr uint64_t TARGET_NODE = START_NODE - 1;
+// entrances of a sector take the low bits of an abstract node
+constexpr uint32_t ENTRANCE_BITS = 6;
+static_assert(PATH_CLUSTER_MAX_ENTRANCES <= (1 << ENTRANCE_BITS));
+
+bool isHierarchyWalkable(const Map& map, int32_t x, int32_t y, uint8_t z)
+{
+	if (x < 0 || y < 0 || x > 0xFFFF || y > 0xFFFF) {
+		return false;
+	}
+
+	// the same test as the position A*
+	uint8_t walkFlags = map.getTileWalkFlags(x, y, z);
+	return (walkFlags & TILE_WALK_EXISTS) && !(walkFlags & TILE_WALK_BLOCKSOLID);
+}
+
+}  // namespace
+
+bool PathHierarchy::getPath(Map& map, const Position& startPos, const Position& targetPos, const FindPathParams& fpp, std::forward_list<Direction>& dirList)
+{
+	const uint64_t targetKey = getClusterKey(targetPos);
+	if (startPos.z != targetPos.z || getClusterKey(startPos) == targetKey) {
+		// inside one sector getPathMatching does the whole job
+		return false;
+	}
+
+	if (clusters.size() >= PATH_HIERARCHY_MAX_CLUSTERS) {
+		clusters.clear();
+	}
+	checkedClusters.clear();
+
+	std::array<uint16_t, CLUSTER_TILES> distance;
+	const Cluster& startCluster = getCluster(map, startPos);
+	search(startCluster, {startPos}, distance);
+	std::vector<uint16_t> startCosts;
+	for (const Entrance& entrance : startCluster.entrances) {
+		startCosts.push_back(distance[getIndex(startCluster, entrance.pos)]);
+	}
+
+	// the walk ends on any tile the caller accepts, as far as they lie in the target sector
+	const Cluster& targetCluster = getCluster(map, targetPos);
+	int32_t range = std::max<int32_t>(0, fpp.maxTargetDist);
+	std::vector<Position> targets;
+	for (int32_t dy = -range; dy <= range; ++dy) {
+		for (int32_t dx = -range; dx <= range; ++dx) {
+			Position pos(targetPos.x + dx, targetPos.y + dy, targetPos.z);
+			int32_t index = getIndex(targetCluster, pos);
+			if (index >= 0 && (targetCluster.walkable[index] || pos == targetPos)) {
+				targets.push_back(pos);
+			}
+		}
+	}
+	search(targetCluster, targets, distance);
+	std::vector<uint16_t> targetCosts;
+	for (const Entrance& entrance : targetCluster.entrances) {
+		targetCosts.push_back(distance[getIndex(targetCluster, entrance.pos)]);
+	}
+
+	// A* over the entrances, the straight walking cost is a lower bound of every path
+	struct Visit {
+		uint32_t cost;
+		uint64_t parent;
+		Position pos;
+	};
+	phmap::flat_hash_map<uint64_t, Visit> visits;
+	using QueueEntry = std::pair<uint32_t, uint64_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	auto heuristic = [&targetPos](const Position& pos) {
+		return static_cast<uint32_t>(MAP_NORMALWALKCOST * (Position::getDistanceX(pos, targetPos) + Position::getDistanceY(pos, targetPos)));
+	};
+	auto relax = [&](uint64_t node, uint32_t cost, uint64_t parent, const Position& pos) {
+		auto [it, inserted] = visits.try_emplace(node, Visit { cost, parent, pos });
+		if (!inserted) {
+			if (it->second.cost <= cost) {
+				return;
+			}
+			it->second = Visit { cost, parent, pos };
+		}
+		queue.emplace(cost + heuristic(pos), node);
+	};
+
+	const uint64_t startKey = getClusterKey(startPos);
+	for (size_t i = 0; i < startCosts.size(); ++i) {
+		if (startCosts[i] != UNREACHABLE) {
+			relax((startKey << ENTRANCE_BITS) | i, startCosts[i], START_NODE, startCluster.entrances[i].pos);
+		}
+	}
+
+	bool found = false;
+	uint32_t expanded = 0;
+	while (!queue.empty()) {
+		auto [estimate, node] = queue.top();
+		queue.pop();
+
+		const Visit visit = visits[node];
+		if (estimate != visit.cost + heuristic(visit.pos)) {
+			// reached again at a lower cost meanwhile
+			continue;
+		}
+
+		if (node == TARGET_NODE) {
+			found = true;
+			break;
+		}
+
+		if (++expanded > PATH_HIERARCHY_MAX_NODES) {
+			return false;
+		}
+
+		const uint64_t clusterKey = node >> ENTRANCE_BITS;
+		const size_t index = node & ((1 << ENTRANCE_BITS) - 1);
+		const Cluster& cluster = getCluster(map, visit.pos);
+		const Entrance entrance = cluster.entrances[index];
+
+		if (clusterKey == targetKey && targetCosts[index] != UNREACHABLE) {
+			relax(TARGET_NODE, visit.cost + targetCosts[index], node, targetPos);
+		}
+
+		const size_t count = cluster.entrances.size();
+		for (size_t other = 0; other < count; ++other) {
+			uint16_t cost = cluster.costs[index * count + other];
+			if (other != index && cost != UNREACHABLE) {
+				relax((clusterKey << ENTRANCE_BITS) | other, visit.cost + cost, node, cluster.entrances[other].pos);
+			}
+		}
+
+		const Cluster& neighbor = getCluster(map, entrance.across);
+		for (size_t other = 0; other < neighbor.entrances.size(); ++other) {
+			if (neighbor.entrances[other].pos == entrance.across && neighbor.entrances[other].across == entrance.pos) {
+				relax((getClusterKey(entrance.across) << ENTRANCE_BITS) | other, visit.cost + MAP_NORMALWALKCOST, node, entrance.across);
+				break;
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	std::vector<Position> waypoints;
+	for (uint64_t node = visits[TARGET_NODE].parent; node != START_NODE; node = visits[node].parent) {
+		waypoints.push_back(visits[node].pos);
+	}
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	// every segment stays inside one sector or crosses into the next, well within the node limit of the A*
+	FindPathParams stepParams;
+	stepParams.clearSight = false;
+	stepParams.allowDiagonal = fpp.allowDiagonal;
+	stepParams.minTargetDist = 0;
+	stepParams.maxTargetDist = 0;
+	stepParams.maxSearchDist = PATH_CLUSTER_SIZE * 2;
+
+	std::vector<Direction> directions;
+	std::forward_list<Direction> segment;
+	Position from = startPos;
+	auto refine = [&](const Position& to, const FindPathParams& params) {
+		segment.clear();
+		if (!map.getPathMatching(from, segment, FrozenPathingConditionCall(to), params)) {
+			return false;
+		}
+		directions.insert(directions.end(), segment.begin(), segment.end());
+		from = to;
+		return true;
+	};
+
+	for (const Position& waypoint : waypoints) {
+		if (!refine(waypoint, stepParams)) {
+			return false;
+		}
+	}
+
+	FindPathParams lastParams = fpp;
+	lastParams.maxSearchDist = PATH_CLUSTER_SIZE * 2;
+	if (!refine(targetPos, lastParams)) {
+		return false;
+	}
+
+	dirList.assign(directions.begin(), directions.end());
+	return true;
+}
+
+const PathHierarchy::Cluster& PathHierarchy::getCluster(const Map& map, const Position& pos)
+{
+	const uint64_t key = getClusterKey(pos);
+	auto [it, inserted] = clusters.try_emplace(key);
+	Cluster& cluster = it->second;
+	if (inserted) {
+		cluster.origin = Position(pos.x & ~(PATH_CLUSTER_SIZE - 1), pos.y & ~(PATH_CLUSTER_SIZE - 1), pos.z);
+		build(map, cluster);
+	} else if (checkedClusters.find(key) == checkedClusters.end() && !isValid(map, cluster)) {
+		build(map, cluster);
+	}
+	checkedClusters.insert(key);
+	return cluster;
+}
+
+void PathHierarchy::build(const Map& map, Cluster& cluster) const
+{
+	const Position& origin = cluster.origin;
+	for (int32_t y = 0; y < PATH_CLUSTER_SIZE; ++y) {
+		for (int32_t x = 0; x < PATH_CLUSTER_SIZE; ++x) {
+			cluster.walkable[y * PATH_CLUSTER_SIZE + x] = isHierarchyWalkable(map, origin.x + x, origin.y + y, origin.z);
+		}
+	}
+
+	// one entrance in the middle of every opening of a side, the neighbour finds the same ones
+	cluster.entrances.clear();
+	for (const ClusterSide& side : clusterSides) {
+		int32_t runStart = -1;
+		for (int32_t i = 0; i <= PATH_CLUSTER_SIZE; ++i) {
+			int32_t x = side.x + side.stepX * i;
+			int32_t y = side.y + side.stepY * i;
+			bool open = i < PATH_CLUSTER_SIZE && cluster.walkable[y * PATH_CLUSTER_SIZE + x] &&
+				isHierarchyWalkable(map, origin.x + x + side.acrossX, origin.y + y + side.acrossY, origin.z);
+			if (open) {
+				if (runStart < 0) {
+					runStart = i;
+				}
+				continue;
+			}
+
+			if (runStart >= 0 && cluster.entrances.size() < PATH_CLUSTER_MAX_ENTRANCES) {
+				int32_t middle = (runStart + i - 1) / 2;
+				Position pos(origin.x + side.x + side.stepX * middle, origin.y + side.y + side.stepY * middle, origin.z);
+				cluster.entrances.push_back({pos, Position(pos.x + side.acrossX, pos.y + side.acrossY, pos.z)});
+			}
+			runStart = -1;
+		}
+	}
+
+	const size_t count = cluster.entrances.size();
+	cluster.costs.assign(count * count, UNREACHABLE);
+	std::array<uint16_t, CLUSTER_TILES> distance;
+	for (size_t i = 0; i < count; ++i) {
+		search(cluster, {cluster.entrances[i].pos}, distance);
+		for (size_t j = 0; j < count; ++j) {
+			cluster.costs[i * count + j] = distance[getIndex(cluster, cluster.entrances[j].pos)];
+		}
+	}
+
+	cluster.leaves.clear();
+	forEachLeaf(map, origin, [&cluster](const QTreeLeafNode* leaf) {
+		cluster.leaves.emplace_back(leaf, leaf ? leaf->getWalkGeneration() : 0);
+	});
+}
+
+bool PathHierarchy::isValid(const Map& map, const Cluster& cluster) const
+{
+	size_t index = 0;
+	bool valid = true;
+	forEachLeaf(map, cluster.origin, [&](const QTreeLeafNode* leaf) {
+		const auto& [builtLeaf, generation] = cluster.leaves[index++];
+		if (leaf != builtLeaf || (leaf && leaf->getWalkGeneration() != generation)) {
+			valid = false;
+		}
+	});
+	return valid;
+}
+
+template <typename Visit>
+void PathHierarchy::forEachLeaf(const Map& map, const Position& origin, Visit&& visit)
+{
+	// the tiles across the border decide the entrances too
+	int32_t minX = std::max<int32_t>(0, origin.x - 1) & ~FLOOR_MASK;
+	int32_t minY = std::max<int32_t>(0, origin.y - 1) & ~FLOOR_MASK;
+	int32_t maxX = std::min<int32_t>(0xFFFF, origin.x + PATH_CLUSTER_SIZE);
+	int32_t maxY = std::min<int32_t>(0xFFFF, origin.y + PATH_CLUSTER_SIZE);
+	for (int32_t y = minY; y <= maxY; y += FLOOR_SIZE) {
+		for (int32_t x = minX; x <= maxX; x += FLOOR_SIZE) {
+			visit(map.getQTNode(x, y));
+		}
+	}
+}
+
+void PathHierarchy::search(const Cluster& cluster, const std::vector<Position>& seeds, std::array<uint16_t, CLUSTER_TILES>& distance)
+{
+	distance.fill(UNREACHABLE);
+
+	// plain Dijkstra with the step costs of the A*, a sector has 256 tiles
+	using QueueEntry = std::pair<uint16_t, int32_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	for (const Position& seed : seeds) {
+		int32_t index = getIndex(cluster, seed);
+		if (index >= 0) {
+			distance[index] = 0;
+			queue.emplace(0, index);
+		}
+	}
+
+	while (!queue.empty()) {
+		auto [currentDistance, index] = queue.top();
+		queue.pop();
+		if (currentDistance != distance[index]) {
+			continue;
+		}
+
+		int32_t x = index % PATH_CLUSTER_SIZE;
+		int32_t y = index / PATH_CLUSTER_SIZE;
+		for (int32_t dy = -1; dy <= 1; ++dy) {
+			for (int32_t dx = -1; dx <= 1; ++dx) {
+				int32_t neighborX = x + dx;
+				int32_t neighborY = y + dy;
+				if ((dx == 0 && dy == 0) || neighborX < 0 || neighborX >= PATH_CLUSTER_SIZE || neighborY < 0 || neighborY >= PATH_CLUSTER_SIZE) {
+					continue;
+				}
+
+				int32_t neighborIndex = neighborY * PATH_CLUSTER_SIZE + neighborX;
+				if (!cluster.walkable[neighborIndex]) {
+					continue;
+				}
+
+				uint16_t newDistance = currentDistance + ((dx != 0 && dy != 0) ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+				if (newDistance < distance[neighborIndex]) {
+					distance[neighborIndex] = newDistance;
+					queue.emplace(newDistance, neighborIndex);
+				}
+			}
+		}
+	}
+}
+
+int32_t PathHierarchy::getIndex(const Cluster& cluster, const Position& pos)
+{
+	int32_t x = pos.x - cluster.origin.x;
+	int32_t y = pos.y - cluster.origin.y;
+	if (pos.z != cluster.origin.z || x < 0 || x >= PATH_CLUSTER_SIZE || y < 0 || y >= PATH_CLUSTER_SIZE) {
+		return -1;
+	}
+	return y * PATH_CLUSTER_SIZE + x;
+}
@@ -0,0 +1,103 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_MAP_PATH_HIERARCHY_HPP_
+#define SRC_MAP_PATH_HIERARCHY_HPP_
+
+#include <array>
+#include <bitset>
+#include <forward_list>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "game/movement/position.h"
+
+class Map;
+class QTreeLeafNode;
+struct FindPathParams;
+
+static constexpr int32_t PATH_CLUSTER_BITS = 4;
+static constexpr int32_t PATH_CLUSTER_SIZE = 1 << PATH_CLUSTER_BITS;
+// entrances kept per sector, four sides of at most eight openings each
+static constexpr size_t PATH_CLUSTER_MAX_ENTRANCES = 32;
+// entrances expanded by one abstract search, about 4000 sectors away
+static constexpr uint32_t PATH_HIERARCHY_MAX_NODES = 8192;
+// the sectors are dropped as a whole when more than this many are kept
+static constexpr size_t PATH_HIERARCHY_MAX_CLUSTERS = 8192;
+
+/**
+ * HPA* over the map: every floor is cut in sectors of PATH_CLUSTER_SIZE tiles,
+ * each opening between two sectors gets one entrance tile on either side, and
+ * the walking costs between the entrances of a sector are computed once. A long
+ * path is planned over the entrances and only refined tile by tile between them.
+ * Walkability is the one of the position A* (the walk flags, no creatures), so
+ * the result holds for every walker; the steps are checked again as it walks.
+ * Sectors are built when first used and built again once the walk generation
+ * of a leaf under them, or of the ones bordering them, changed.
+ */
+class PathHierarchy
+{
+	public:
+		bool getPath(Map& map, const Position& startPos, const Position& targetPos, const FindPathParams& fpp, std::forward_list<Direction>& dirList);
+
+	private:
+		static constexpr uint16_t UNREACHABLE = std::numeric_limits<uint16_t>::max();
+		static constexpr int32_t CLUSTER_TILES = PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE;
+
+		struct Entrance {
+			Position pos;
+			// the tile of the neighbouring sector it leads to
+			Position across;
+		};
+
+		struct Cluster {
+			Position origin;
+			std::bitset<CLUSTER_TILES> walkable;
+			std::vector<Entrance> entrances;
+			// entrances.size() squared, from row to column
+			std::vector<uint16_t> costs;
+			// leaves under the sector and its border, with their walk generation at the build
+			std::vector<std::pair<const QTreeLeafNode*, uint32_t>> leaves;
+		};
+
+		static uint64_t getClusterKey(const Position& pos) {
+			return (static_cast<uint64_t>(pos.z) << 32) | (static_cast<uint64_t>(pos.x >> PATH_CLUSTER_BITS) << 16) | (pos.y >> PATH_CLUSTER_BITS);
+		}
+
+		// built or checked at most once per search, the map does not change meanwhile
+		const Cluster& getCluster(const Map& map, const Position& pos);
+		void build(const Map& map, Cluster& cluster) const;
+		bool isValid(const Map& map, const Cluster& cluster) const;
+		template <typename Visit>
+		static void forEachLeaf(const Map& map, const Position& origin, Visit&& visit);
+
+		// walking costs from the seeds to every tile of the sector, without leaving it
+		static void search(const Cluster& cluster, const std::vector<Position>& seeds, std::array<uint16_t, CLUSTER_TILES>& distance);
+		static int32_t getIndex(const Cluster& cluster, const Position& pos);
+
+		// node_hash_map, the search holds references to sectors while it builds others
+		phmap::node_hash_map<uint64_t, Cluster> clusters;
+		phmap::flat_hash_set<uint64_t> checkedClusters;
+};
+
+#endif  // SRC_MAP_PATH_HIERARCHY_HPP_
@@ -0,0 +1,220 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_MAP_SPECTATOR_POSITIONS_HPP_
+#define SRC_MAP_SPECTATOR_POSITIONS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "game/movement/position.h"
+#include "utils/simd.hpp"
+
+// floors tracked by the occupancy mask, at least MAP_MAX_LAYERS
+static constexpr int32_t SPECTATOR_FLOORS = 16;
+
+/**
+ * Structure of arrays copy of the positions of a creature list, in the same order.
+ * x and y are stored as x + z and y + z, so the perspective shift of the
+ * spectator range on other floors (one tile per floor) turns into a plain
+ * box test: lo <= value <= hi on every axis, with no per-creature offset.
+ * floors has a bit set for every floor with at least one position on it.
+ */
+struct SpectatorPositions {
+	std::vector<int32_t> x;
+	std::vector<int32_t> y;
+	std::vector<int32_t> z;
+	std::array<uint16_t, SPECTATOR_FLOORS> floorCount {};
+	uint16_t floors = 0;
+
+	void add(const Position& pos) {
+		x.push_back(pos.x + pos.z);
+		y.push_back(pos.y + pos.z);
+		z.push_back(pos.z);
+		addFloor(pos.z);
+	}
+
+	void reserve(size_t count) {
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+	}
+
+	void set(size_t index, const Position& pos) {
+		if (z[index] != pos.z) {
+			removeFloor(z[index]);
+			addFloor(pos.z);
+		}
+		x[index] = pos.x + pos.z;
+		y[index] = pos.y + pos.z;
+		z[index] = pos.z;
+	}
+
+	// mirrors the swap with the last element done on the creature lists
+	void remove(size_t index) {
+		removeFloor(z[index]);
+		x[index] = x.back();
+		y[index] = y.back();
+		z[index] = z.back();
+		x.pop_back();
+		y.pop_back();
+		z.pop_back();
+	}
+
+	size_t size() const {
+		return z.size();
+	}
+
+	private:
+		void addFloor(int32_t floor) {
+			if (floor < SPECTATOR_FLOORS && floorCount[floor]++ == 0) {
+				floors |= 1 << floor;
+			}
+		}
+
+		void removeFloor(int32_t floor) {
+			if (floor < SPECTATOR_FLOORS && --floorCount[floor] == 0) {
+				floors &= ~(1 << floor);
+			}
+		}
+};
+
+struct SpectatorBounds {
+	int32_t minX;
+	int32_t maxX;
+	int32_t minY;
+	int32_t maxY;
+	int32_t minZ;
+	int32_t maxZ;
+	// SpectatorPositions::floors bits of minZ to maxZ
+	uint16_t floors;
+
+	// ranges are relative to centerPos as in Map::getSpectatorsInternal
+	SpectatorBounds(const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ) :
+		minX(centerPos.x + minRangeX + centerPos.z), maxX(centerPos.x + maxRangeX + centerPos.z),
+		minY(centerPos.y + minRangeY + centerPos.z), maxY(centerPos.y + maxRangeY + centerPos.z),
+		minZ(minRangeZ), maxZ(maxRangeZ), floors(getFloorMask(minRangeZ, maxRangeZ)) {}
+
+	bool contains(const SpectatorPositions& positions, size_t i) const {
+		return positions.x[i] >= minX && positions.x[i] <= maxX &&
+			positions.y[i] >= minY && positions.y[i] <= maxY &&
+			positions.z[i] >= minZ && positions.z[i] <= maxZ;
+	}
+
+	bool contains(const Position& pos) const {
+		int32_t x = pos.x + pos.z;
+		int32_t y = pos.y + pos.z;
+		return x >= minX && x <= maxX && y >= minY && y <= maxY && pos.z >= minZ && pos.z <= maxZ;
+	}
+
+	private:
+		static uint16_t getFloorMask(int32_t minRangeZ, int32_t maxRangeZ) {
+			minRangeZ = std::max<int32_t>(minRangeZ, 0);
+			maxRangeZ = std::min<int32_t>(maxRangeZ, SPECTATOR_FLOORS - 1);
+			if (minRangeZ > maxRangeZ) {
+				return 0;
+			}
+			return static_cast<uint16_t>(((1u << (maxRangeZ + 1)) - 1) & ~((1u << minRangeZ) - 1));
+		}
+};
+
+/**
+ * Calls visit(index) for every position inside bounds, in order.
+ * visit returns true to stop the scan; the function returns whether it was stopped.
+ */
+template <typename Visit>
+bool forEachSpectatorPosition(const SpectatorPositions& positions, const SpectatorBounds& bounds, Visit&& visit)
+{
+	// nobody on the floors in range, which is most leaves of a multi floor scan
+	if ((positions.floors & bounds.floors) == 0) {
+		return false;
+	}
+
+	const size_t count = positions.size();
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i minX = _mm256_set1_epi32(bounds.minX), maxX = _mm256_set1_epi32(bounds.maxX);
+	const __m256i minY = _mm256_set1_epi32(bounds.minY), maxY = _mm256_set1_epi32(bounds.maxY);
+	const __m256i minZ = _mm256_set1_epi32(bounds.minZ), maxZ = _mm256_set1_epi32(bounds.maxZ);
+	for (; i + 8 <= count; i += 8) {
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&positions.x[i]));
+		const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&positions.y[i]));
+		const __m256i z = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&positions.z[i]));
+		__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(minX, x), _mm256_cmpgt_epi32(x, maxX));
+		outside = _mm256_or_si256(outside, _mm256_or_si256(_mm256_cmpgt_epi32(minY, y), _mm256_cmpgt_epi32(y, maxY)));
+		outside = _mm256_or_si256(outside, _mm256_or_si256(_mm256_cmpgt_epi32(minZ, z), _mm256_cmpgt_epi32(z, maxZ)));
+		uint32_t inside = ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFF;
+		while (inside != 0) {
+			if (visit(i + _mm_ctz(inside))) {
+				return true;
+			}
+			inside &= inside - 1;
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128i minX = _mm_set1_epi32(bounds.minX), maxX = _mm_set1_epi32(bounds.maxX);
+	const __m128i minY = _mm_set1_epi32(bounds.minY), maxY = _mm_set1_epi32(bounds.maxY);
+	const __m128i minZ = _mm_set1_epi32(bounds.minZ), maxZ = _mm_set1_epi32(bounds.maxZ);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&positions.x[i]));
+		const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&positions.y[i]));
+		const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&positions.z[i]));
+		__m128i outside = _mm_or_si128(_mm_cmpgt_epi32(minX, x), _mm_cmpgt_epi32(x, maxX));
+		outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minY, y), _mm_cmpgt_epi32(y, maxY)));
+		outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minZ, z), _mm_cmpgt_epi32(z, maxZ)));
+		uint32_t inside = ~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(outside))) & 0xF;
+		while (inside != 0) {
+			if (visit(i + _mm_ctz(inside))) {
+				return true;
+			}
+			inside &= inside - 1;
+		}
+	}
+#elif defined(__NEON__)
+	const int32x4_t minX = vdupq_n_s32(bounds.minX), maxX = vdupq_n_s32(bounds.maxX);
+	const int32x4_t minY = vdupq_n_s32(bounds.minY), maxY = vdupq_n_s32(bounds.maxY);
+	const int32x4_t minZ = vdupq_n_s32(bounds.minZ), maxZ = vdupq_n_s32(bounds.maxZ);
+	for (; i + 4 <= count; i += 4) {
+		const int32x4_t x = vld1q_s32(&positions.x[i]);
+		const int32x4_t y = vld1q_s32(&positions.y[i]);
+		const int32x4_t z = vld1q_s32(&positions.z[i]);
+		uint32x4_t inside = vandq_u32(vcgeq_s32(x, minX), vcleq_s32(x, maxX));
+		inside = vandq_u32(inside, vandq_u32(vcgeq_s32(y, minY), vcleq_s32(y, maxY)));
+		inside = vandq_u32(inside, vandq_u32(vcgeq_s32(z, minZ), vcleq_s32(z, maxZ)));
+		uint32_t lanes[4];
+		vst1q_u32(lanes, inside);
+		for (size_t lane = 0; lane < 4; ++lane) {
+			if (lanes[lane] != 0 && visit(i + lane)) {
+				return true;
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (bounds.contains(positions, i) && visit(i)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif  // SRC_MAP_SPECTATOR_POSITIONS_HPP_
@@ -19,6 +19,8 @@
 
 #include "pch.hpp"
 
+#include <spdlog/async.h>
+
 #ifdef OS_WINDOWS
 	#include "conio.h"
 #endif
@@ -26,27 +28,62 @@
 #include "declarations.hpp"
 #include "creatures/combat/spells.h"
 #include "creatures/players/grouping/familiars.h"
+#include "database/database_stats.hpp"
 #include "database/databasemanager.h"
 #include "database/databasetasks.h"
+#include "game/experience_stages.hpp"
 #include "game/game.h"
+#include "game/scheduling/dispatcher_governor.hpp"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "game/scheduling/dispatcher_watchdog.hpp"
+#include "game/scheduling/input_trace.hpp"
 #include "game/scheduling/scheduler.h"
 #include "game/scheduling/events_scheduler.hpp"
+#include "io/iomap.h"
 #include "io/iomarket.h"
 #include "lua/creature/events.h"
+#include "lua/creature/movement.h"
 #include "lua/modules/modules.h"
 #include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/lua_garbage_collector.hpp"
+#include "lua/scripts/lua_profiler.hpp"
+#include "lua/scripts/lua_workers.hpp"
 #include "lua/scripts/scripts.h"
 #include "security/rsa.h"
+#include "server/metrics/metrics_server.hpp"
+#include "server/module_loader.hpp"
+#include "server/network/connection/handshake_workers.hpp"
 #include "server/network/protocol/protocollogin.h"
 #include "server/network/protocol/protocolstatus.h"
 #include "server/network/webhook/webhook.h"
 #include "server/server.h"
 #include "io/ioprey.h"
+#include "utils/memory_accounting.hpp"
+#include "utils/thread_topology.hpp"
 
 #if __has_include("gitmetadata.h")
 	#include "gitmetadata.h"
 #endif
 
+// Moves the default logger's sinks behind a logging thread, see asyncLogging in config.lua
+void setupAsyncLogging() {
+	if (!g_configManager().getBoolean(ASYNC_LOGGING)) {
+		return;
+	}
+
+	auto queueSize = static_cast<size_t>(std::max<int32_t>(256, g_configManager().getNumber(ASYNC_LOGGING_QUEUE_SIZE)));
+	spdlog::init_thread_pool(queueSize, 1);
+
+	// same sinks, so the pattern set in main stays; the sink formatting and writing happen in the pool
+	auto defaultLogger = spdlog::default_logger();
+	const auto& sinks = defaultLogger->sinks();
+	auto logger = std::make_shared<spdlog::async_logger>(defaultLogger->name(), sinks.begin(), sinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+	logger->set_level(defaultLogger->level());
+	logger->flush_on(spdlog::level::err);
+	spdlog::set_default_logger(logger);
+	SPDLOG_INFO("Asynchronous logging enabled, queue of {} messages", queueSize);
+}
+
 std::mutex g_loaderLock;
 std::condition_variable g_loaderSignal;
 std::unique_lock<std::mutex> g_loaderUniqueLock(g_loaderLock);
@@ -83,7 +120,34 @@ void badAllocationHandler() {
 	exit(-1);
 }
 
+// dispatcher thread steps of the startup with their time, waits for the module loader included
+std::vector<std::pair<std::string, int64_t>> startupPhases;
+int64_t startupPhaseTime = 0;
+
+void recordStartupPhase(const std::string& name) {
+	int64_t now = OTSYS_PRECISE_TIME();
+	startupPhases.emplace_back(name, now - startupPhaseTime);
+	startupPhaseTime = now;
+}
+
+void logStartupPhases() {
+	int64_t total = 0;
+	for (const auto& [name, duration] : startupPhases) {
+		total += duration;
+	}
+
+	SPDLOG_INFO("Startup took {}ms on the main thread:", total);
+	for (const auto& [name, duration] : startupPhases) {
+		if (duration != 0) {
+			SPDLOG_INFO("  {}: {}ms", name, duration);
+		}
+	}
+	startupPhases.clear();
+}
+
 void modulesLoadHelper(bool loaded, std::string moduleName) {
+	// the loader ran as the argument, right before this call
+	recordStartupPhase(moduleName);
 	SPDLOG_INFO("Loading {}", moduleName);
 	if (!loaded) {
 		SPDLOG_ERROR("Cannot load: {}", moduleName);
@@ -92,11 +156,37 @@ void modulesLoadHelper(bool loaded, std::string moduleName) {
 }
 
 void loadModules() {
+	startupPhaseTime = OTSYS_PRECISE_TIME();
 	modulesLoadHelper(g_configManager().load(),
 		"config.lua");
+	setupAsyncLogging();
+
+	// the dispatcher and scheduler started before the config, the other threads apply their role as they start
+	g_threadTopology().load();
+	g_threadTopology().applyToCurrentThread(THREAD_ROLE_DISPATCHER);
+	g_threadTopology().applyToThread(g_scheduler().getNativeHandle(), THREAD_ROLE_SCHEDULER);
+
+	if (g_inputTrace().isReplaying()) {
+		// the replay rolls the same numbers as the recorded run
+		setRandomSeed(g_inputTrace().getSeed());
+	} else if (const std::string& inputTraceFile = g_configManager().getString(INPUT_TRACE_FILE); !inputTraceFile.empty()) {
+		// a trace only replays with the seed it was recorded with, the configured one or a random one
+		auto randomSeed = static_cast<uint32_t>(g_configManager().getNumber(RANDOM_SEED));
+		if (randomSeed == 0) {
+			randomSeed = std::random_device()() | 1;
+		}
+		setRandomSeed(randomSeed);
+		g_inputTrace().startRecording(inputTraceFile, randomSeed);
+	} else if (int32_t randomSeed = g_configManager().getNumber(RANDOM_SEED); randomSeed != 0) {
+		SPDLOG_WARN("Random numbers are seeded with {}, do not use this on a live server", randomSeed);
+		setRandomSeed(static_cast<uint32_t>(randomSeed));
+	}
 
 	SPDLOG_INFO("Server protocol: {}.{}",
 		CLIENT_VERSION_UPPER, CLIENT_VERSION_LOWER);
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+	SPDLOG_INFO("Network backend: io_uring");
+#endif
 
 	const char* p("14299623962416399520070177382898895550795403345466153217470516082934737582776038882967213386204600674145392845853859217990626450972452084065728686565928113");
 	const char* q("7630979195970404721891201847792002125535401292779123937207447574596692788513647179235335529307251350570728407373705564708871762033017096809910315212884101");
@@ -111,14 +201,51 @@ void loadModules() {
 		SPDLOG_ERROR("Switching to a default key...");
 		g_RSA().setKey(p, q);
 	}
+	g_handshakeWorkers().start();
+	g_luaWorkers().start();
+
+	// The XML modules below neither use Lua nor the database, they load while the database is set up
+	ModuleLoader loader;
+	loader.add("appearances.dat", [] {
+		return g_game().loadAppearanceProtobuf("data/items/appearances.dat") == ERROR_NONE;
+	});
+	loader.add("items.xml", [] {
+		return Item::items.loadFromXml();
+	}, {"appearances.dat"});
+	loader.add("data/XML/vocations.xml", [] {
+		return g_vocations().loadFromXml();
+	});
+	// checks the look types registered from appearances.dat
+	loader.add("data/XML/outfits.xml", [] {
+		return Outfits::getInstance().loadFromXml();
+	}, {"appearances.dat"});
+	loader.add("data/XML/familiars.xml", [] {
+		return Familiars::getInstance().loadFromXml();
+	});
+	loader.add("data/XML/imbuements.xml", [] {
+		return g_imbuements().loadFromXml();
+	});
+	// reading the otbm only needs the item types, spawns, houses and lua items are added after the scripts
+	bool parallelMapLoading = g_configManager().getBoolean(PARALLEL_MAP_LOADING);
+	if (parallelMapLoading) {
+		loader.add("map file", [] {
+			// first touch of the tiles, they are used on the dispatcher
+			g_threadTopology().bindMemory(THREAD_ROLE_DISPATCHER);
+			// failures are logged by Map::load and do not stop the startup, as before
+			g_game().loadMainMapFile(g_configManager().getString(MAP_NAME));
+			return true;
+		}, {"items.xml", "data/XML/imbuements.xml"});
+	}
 
 	// Database
+	g_databaseStats().start();
 	SPDLOG_INFO("Establishing database connection... ");
 	if (!Database::getInstance().connect()) {
 		SPDLOG_ERROR("Failed to connect to database!");
 		startupErrorMessage();
 	}
 	SPDLOG_INFO("MySQL Version: {}", Database::getClientVersion());
+	Database::getInstance().connectReplica();
 
 	// Run database manager
 	SPDLOG_INFO("Running database manager...");
@@ -130,22 +257,24 @@ void loadModules() {
 
 	g_databaseTasks().start();
 	DatabaseManager::updateDatabase();
+	DatabaseManager::updatePlayerState();
 
 	if (g_configManager().getBoolean(OPTIMIZE_DATABASE)
 			&& !DatabaseManager::optimizeTables()) {
 		SPDLOG_INFO("No tables were optimized");
 	}
+	recordStartupPhase("database");
 
-	modulesLoadHelper((g_game().loadAppearanceProtobuf("data/items/appearances.dat") == ERROR_NONE),
+	modulesLoadHelper(loader.wait("appearances.dat"),
 		"appearances.dat");
-	modulesLoadHelper(Item::items.loadFromXml(),
+	modulesLoadHelper(loader.wait("items.xml"),
 		"items.xml");
 
 	// Lua Env
 	modulesLoadHelper((g_luaEnvironment.loadFile("data/global.lua") == 0),
 		"data/global.lua");
 	if (g_configManager().getBoolean(RATE_USE_STAGES)) {
-		modulesLoadHelper((g_luaEnvironment.loadFile("data/stages.lua") == 0),
+		modulesLoadHelper(g_experienceStages().loadFromLua(),
 			"data/stages.lua");
 	}
 	modulesLoadHelper((g_luaEnvironment.loadFile("data/startup/startup.lua") == 0),
@@ -155,15 +284,15 @@ void loadModules() {
 
 	modulesLoadHelper(g_scripts().loadScripts("scripts/lib", true, false),
 		"data/scripts/libs");
-	modulesLoadHelper(g_vocations().loadFromXml(),
+	modulesLoadHelper(loader.wait("data/XML/vocations.xml"),
 		"data/XML/vocations.xml");
 	modulesLoadHelper(g_eventsScheduler().loadScheduleEventFromXml(),
 		"data/XML/events.xml");
-	modulesLoadHelper(Outfits::getInstance().loadFromXml(),
+	modulesLoadHelper(loader.wait("data/XML/outfits.xml"),
 		"data/XML/outfits.xml");
-	modulesLoadHelper(Familiars::getInstance().loadFromXml(),
+	modulesLoadHelper(loader.wait("data/XML/familiars.xml"),
 		"data/XML/familiars.xml");
-	modulesLoadHelper(g_imbuements().loadFromXml(),
+	modulesLoadHelper(loader.wait("data/XML/imbuements.xml"),
 		"data/XML/imbuements.xml");
 	modulesLoadHelper(g_modules().loadFromXml(),
 		"data/modules/modules.xml");
@@ -175,9 +304,16 @@ void loadModules() {
 		"data/monster");
 	modulesLoadHelper(g_scripts().loadScripts("npc", false, false),
 		"data/npc");
+	if (parallelMapLoading) {
+		modulesLoadHelper(loader.wait("map file"),
+			"map file");
+	}
+	loader.logTimings();
 
 	g_game().loadBoostedCreature();
 	g_ioprey().InitializeTaskHuntOptions();
+	g_ioprey().InitializeMonsterPools();
+	recordStartupPhase("boosted creature and prey");
 }
 
 #ifndef UNIT_TESTING
@@ -204,28 +340,58 @@ int main(int argc, char* argv[]) {
 
 	g_loaderSignal.wait(g_loaderUniqueLock);
 
-	if (serviceManager.is_running()) {
+	// a replay runs without the client ports, until the end of the trace shuts the server down
+	if (serviceManager.is_running() || g_inputTrace().isReplaying()) {
 		SPDLOG_INFO("{} {}", g_configManager().getString(SERVER_NAME),
                     "server online!");
 		serviceManager.run();
 	} else {
 		SPDLOG_ERROR("No services running. The server is NOT online!");
+		g_handshakeWorkers().shutdown();
+		g_luaWorkers().shutdown();
 		g_databaseTasks().shutdown();
 		g_dispatcher().shutdown();
+		webhook_shutdown();
+		spdlog::shutdown();
 		exit(-1);
 	}
 
 	g_scheduler().join();
+	g_handshakeWorkers().join();
+	g_luaWorkers().join();
 	g_databaseTasks().join();
 	g_dispatcher().join();
+	g_dispatcherWatchdog().shutdown();
+	g_dispatcherWatchdog().join();
+	webhook_shutdown();
+	// drains the logging queue when asyncLogging is on
+	spdlog::shutdown();
 	return 0;
 }
 #endif
 
-void mainLoader(int, char*[], ServiceManager* services) {
+void mainLoader(int argc, char* argv[], ServiceManager* services) {
 	// dispatcher thread
 	g_game().setGameState(GAME_STATE_STARTUP);
 
+	bool buildMapCache = false;
+	std::string replayFile;
+	double replaySpeed = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "--build-map-cache") {
+			buildMapCache = true;
+		} else if (arg.substr(0, 9) == "--replay=") {
+			replayFile = arg.substr(9);
+		} else if (arg.substr(0, 15) == "--replay-speed=") {
+			replaySpeed = std::atof(std::string(arg.substr(15)).c_str());
+		}
+	}
+	IOMap::setBuildCache(buildMapCache);
+	if (!replayFile.empty() && !g_inputTrace().openReplay(replayFile, replaySpeed)) {
+		startupErrorMessage();
+	}
+
 	srand(static_cast<unsigned int>(OTSYS_TIME()));
 #ifdef _WIN32
 	SetConsoleTitle(STATUS_SERVER_NAME);
@@ -306,7 +472,7 @@ void mainLoader(int, char*[], ServiceManager* services) {
 	SPDLOG_INFO("World type set as {}", asUpperCaseString(worldType));
 
 	SPDLOG_INFO("Loading map...");
-	if (!g_game().loadMainMap(g_configManager().getString(MAP_NAME))) {
+	if (!g_game().loadMainMap(g_configManager().getString(MAP_NAME), g_configManager().getBoolean(PARALLEL_MAP_LOADING))) {
 		SPDLOG_ERROR("Failed to load map");
 		startupErrorMessage();
 	}
@@ -320,14 +486,27 @@ void mainLoader(int, char*[], ServiceManager* services) {
 		}
 	}
 
+	// the tiles were filled without looking at the move events, the scripts may have been loading meanwhile
+	g_moveEvents().setTileEventsReady();
+	g_game().map.updateMoveEventFlags();
+	recordStartupPhase("map");
+
+	if (buildMapCache) {
+		SPDLOG_INFO("Map cache built, the program will close now");
+		exit(0);
+	}
+
 	SPDLOG_INFO("Initializing gamestate...");
 	g_game().setGameState(GAME_STATE_INIT);
 
-	// Game client protocols
-	services->add<ProtocolGame>(static_cast<uint16_t>(g_configManager().getNumber(GAME_PORT)));
-	services->add<ProtocolLogin>(static_cast<uint16_t>(g_configManager().getNumber(LOGIN_PORT)));
-	// OT protocols
-	services->add<ProtocolStatus>(static_cast<uint16_t>(g_configManager().getNumber(STATUS_PORT)));
+	if (!g_inputTrace().isReplaying()) {
+		// Game client protocols
+		services->add<ProtocolGame>(static_cast<uint16_t>(g_configManager().getNumber(GAME_PORT)));
+		services->add<ProtocolLogin>(static_cast<uint16_t>(g_configManager().getNumber(LOGIN_PORT)));
+		// OT protocols
+		services->add<ProtocolStatus>(static_cast<uint16_t>(g_configManager().getNumber(STATUS_PORT)));
+	}
+	services->addMetrics(g_configManager().getString(METRICS_IP), static_cast<uint16_t>(g_configManager().getNumber(METRICS_PORT)));
 
 	RentPeriod_t rentPeriod;
 	std::string strRentPeriod = asLowerCaseString(g_configManager().getString(HOUSE_RENT_PERIOD));
@@ -346,9 +525,12 @@ void mainLoader(int, char*[], ServiceManager* services) {
 
 	g_game().map.houses.payHouses(rentPeriod);
 
+	IOMarket::getInstance().loadOffers();
 	IOMarket::checkExpiredOffers();
-	IOMarket::getInstance().updateStatistics();
+	IOMarket::getInstance().loadStatistics();
 
+	recordStartupPhase("houses and market");
+	logStartupPhases();
 	SPDLOG_INFO("Loaded all modules, server starting up...");
 
 #ifndef _WIN32
@@ -360,12 +542,27 @@ void mainLoader(int, char*[], ServiceManager* services) {
 #endif
 
 	g_game().start(services);
+	ProtocolStatus::startSnapshots();
+	if (g_configManager().getNumber(METRICS_PORT) != 0) {
+		MetricsServer::startSampling();
+	}
 	g_game().setGameState(GAME_STATE_NORMAL);
 
+	g_dispatcherProfiler().start();
+	MemoryAccounting::start();
+	g_dispatcherWatchdog().start();
+	g_dispatcherGovernor().start();
+	g_luaProfiler().start();
+	g_luaGarbageCollector().start();
+
 	webhook_init();
 
 	std::string url = g_configManager().getString(DISCORD_WEBHOOK_URL);
 	webhook_send_message("Server is now online", "Server has successfully started.", WEBHOOK_COLOR_ONLINE, url);
 
+	if (g_inputTrace().isReplaying()) {
+		g_inputTrace().startReplay();
+	}
+
 	g_loaderSignal.notify_all();
 }
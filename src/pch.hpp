@@ -58,8 +58,10 @@
 #include <vector>
 
 #include <boost/asio.hpp>
+#include <boost/container_hash/hash.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/intrusive_ptr.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/range/adaptor/reversed.hpp>
@@ -24,21 +24,47 @@
 
 #include <fstream>
 
+namespace {
+
+// per thread operands of decrypt, sized once so no call allocates limbs
+struct RSAScratch {
+	mpz_t c;
+	mpz_t m;
+	mpz_t mq;
+	mpz_t h;
+
+	RSAScratch() {
+		mpz_init2(c, 1024);
+		mpz_init2(m, 1024);
+		mpz_init2(mq, 1024);
+		mpz_init2(h, 1024);
+	}
+	~RSAScratch() {
+		mpz_clear(c);
+		mpz_clear(m);
+		mpz_clear(mq);
+		mpz_clear(h);
+	}
+};
+
+}  // namespace
+
 RSA::RSA()
 {
 	mpz_init(n);
 	mpz_init2(d, 1024);
+	mpz_init2(p, 512);
+	mpz_init2(q, 512);
+	mpz_init2(dp, 512);
+	mpz_init2(dq, 512);
+	mpz_init2(qInv, 512);
 }
 
 RSA::~RSA() = default;
 
 void RSA::setKey(const char* pString, const char* qString, int base/* = 10*/)
 {
-	mpz_t p;
-	mpz_t q;
 	mpz_t e;
-	mpz_init2(p, 1024);
-	mpz_init2(q, 1024);
 	mpz_init(e);
 
 	mpz_set_str(p, pString, base);
@@ -67,33 +93,51 @@ void RSA::setKey(const char* pString, const char* qString, int base/* = 10*/)
 	// d = e^-1 mod (p - 1)(q - 1)
 	mpz_invert(d, e, pq_1);
 
+	// dp = d mod (p - 1), dq = d mod (q - 1), qInv = q^-1 mod p
+	mpz_mod(dp, d, p_1);
+	mpz_mod(dq, d, q_1);
+	mpz_invert(qInv, q, p);
+
 	mpz_clear(p_1);
 	mpz_clear(q_1);
 	mpz_clear(pq_1);
 
-	mpz_clear(p);
-	mpz_clear(q);
 	mpz_clear(e);
 }
 
 void RSA::decrypt(char* msg) const 
 {
-	mpz_t c;
-	mpz_t m;
-	mpz_init2(c, 1024);
-	mpz_init2(m, 1024);
+	thread_local RSAScratch scratch;
 
-	mpz_import(c, 128, 1, 1, 0, 0, msg);
+	mpz_import(scratch.c, 128, 1, 1, 0, 0, msg);
 
-	// m = c^d mod n
-	mpz_powm(m, c, d, n);
+	// m = c^d mod n, by the chinese remainder theorem:
+	// m = mq + q * (qInv * (c^dp mod p - mq) mod p), with mq = c^dq mod q
+	mpz_powm(scratch.m, scratch.c, dp, p);
+	mpz_powm(scratch.mq, scratch.c, dq, q);
+	mpz_sub(scratch.h, scratch.m, scratch.mq);
+	mpz_mul(scratch.h, scratch.h, qInv);
+	mpz_mod(scratch.h, scratch.h, p);
+	mpz_mul(scratch.m, scratch.h, q);
+	mpz_add(scratch.m, scratch.m, scratch.mq);
 
-	size_t count = (mpz_sizeinbase(m, 2) + 7) / 8;
+	size_t count = (mpz_sizeinbase(scratch.m, 2) + 7) / 8;
 	memset(msg, 0, 128 - count);
-	mpz_export(msg + (128 - count), nullptr, 1, 1, 0, 0, m);
+	mpz_export(msg + (128 - count), nullptr, 1, 1, 0, 0, scratch.m);
+}
+
+void RSA::encrypt(char* msg) const
+{
+	thread_local RSAScratch scratch;
+
+	mpz_import(scratch.m, 128, 1, 1, 0, 0, msg);
 
-	mpz_clear(c);
-	mpz_clear(m);
+	// c = m^e mod n
+	mpz_powm_ui(scratch.c, scratch.m, 65537, n);
+
+	size_t count = (mpz_sizeinbase(scratch.c, 2) + 7) / 8;
+	memset(msg, 0, 128 - count);
+	mpz_export(msg + (128 - count), nullptr, 1, 1, 0, 0, scratch.c);
 }
 
 std::string RSA::base64Decrypt(const std::string& input) const
@@ -44,6 +44,8 @@ class RSA
 
 		void setKey(const char* pString, const char* qString, int base = 10);
 		void decrypt(char* msg) const;
+		// public key side of decrypt, for tools speaking the client protocol
+		void encrypt(char* msg) const;
 
 		std::string base64Decrypt(const std::string& input) const;
 		uint16_t decodeLength(char*& pos) const;
@@ -53,6 +55,12 @@ class RSA
 	private:
 		mpz_t n;
 		mpz_t d;
+		// CRT form of d, two half size exponentiations instead of one full size
+		mpz_t p;
+		mpz_t q;
+		mpz_t dp;
+		mpz_t dq;
+		mpz_t qInv;
 };
 
 constexpr auto g_RSA = &RSA::getInstance;
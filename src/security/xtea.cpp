@@ -0,0 +1,234 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "security/xtea.hpp"
+
+namespace xtea {
+
+namespace {
+
+constexpr uint32_t delta = 0x61C88647;
+constexpr size_t rounds = 32;
+
+void encryptBlock(uint8_t* data, const RoundKeys& keys)
+{
+	std::array<uint32_t, 2> vData;
+	memcpy(vData.data(), data, 8);
+	for (size_t i = 0; i < rounds; ++i) {
+		vData[0] += ((vData[1] << 4 ^ vData[1] >> 5) + vData[1]) ^ keys[i * 2];
+		vData[1] += ((vData[0] << 4 ^ vData[0] >> 5) + vData[0]) ^ keys[i * 2 + 1];
+	}
+	memcpy(data, vData.data(), 8);
+}
+
+void decryptBlock(uint8_t* data, const RoundKeys& keys)
+{
+	std::array<uint32_t, 2> vData;
+	memcpy(vData.data(), data, 8);
+	for (size_t i = 0; i < rounds; ++i) {
+		vData[1] -= ((vData[0] << 4 ^ vData[0] >> 5) + vData[0]) ^ keys[i * 2];
+		vData[0] -= ((vData[1] << 4 ^ vData[1] >> 5) + vData[1]) ^ keys[i * 2 + 1];
+	}
+	memcpy(data, vData.data(), 8);
+}
+
+#if defined(__AVX2__)
+constexpr size_t parallelBlocks = 8;
+
+// lanes hold the first and the second word of the blocks, in the same (shuffled) order
+void load(const uint8_t* data, __m256i& v0, __m256i& v1)
+{
+	__m256i lo = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), _MM_SHUFFLE(3, 1, 2, 0));
+	__m256i hi = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32)), _MM_SHUFFLE(3, 1, 2, 0));
+	v0 = _mm256_unpacklo_epi64(lo, hi);
+	v1 = _mm256_unpackhi_epi64(lo, hi);
+}
+
+void store(uint8_t* data, __m256i v0, __m256i v1)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(data), _mm256_shuffle_epi32(_mm256_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + 32), _mm256_shuffle_epi32(_mm256_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__m256i mix(__m256i v, uint32_t key)
+{
+	__m256i shifted = _mm256_xor_si256(_mm256_slli_epi32(v, 4), _mm256_srli_epi32(v, 5));
+	return _mm256_xor_si256(_mm256_add_epi32(shifted, v), _mm256_set1_epi32(static_cast<int32_t>(key)));
+}
+
+void encryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	__m256i v0, v1;
+	load(data, v0, v1);
+	for (size_t i = 0; i < rounds; ++i) {
+		v0 = _mm256_add_epi32(v0, mix(v1, keys[i * 2]));
+		v1 = _mm256_add_epi32(v1, mix(v0, keys[i * 2 + 1]));
+	}
+	store(data, v0, v1);
+}
+
+void decryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	__m256i v0, v1;
+	load(data, v0, v1);
+	for (size_t i = 0; i < rounds; ++i) {
+		v1 = _mm256_sub_epi32(v1, mix(v0, keys[i * 2]));
+		v0 = _mm256_sub_epi32(v0, mix(v1, keys[i * 2 + 1]));
+	}
+	store(data, v0, v1);
+}
+#elif defined(__SSE2__)
+constexpr size_t parallelBlocks = 4;
+
+void load(const uint8_t* data, __m128i& v0, __m128i& v1)
+{
+	__m128i lo = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), _MM_SHUFFLE(3, 1, 2, 0));
+	__m128i hi = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+	v0 = _mm_unpacklo_epi64(lo, hi);
+	v1 = _mm_unpackhi_epi64(lo, hi);
+}
+
+void store(uint8_t* data, __m128i v0, __m128i v1)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm_shuffle_epi32(_mm_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(data + 16), _mm_shuffle_epi32(_mm_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__m128i mix(__m128i v, uint32_t key)
+{
+	__m128i shifted = _mm_xor_si128(_mm_slli_epi32(v, 4), _mm_srli_epi32(v, 5));
+	return _mm_xor_si128(_mm_add_epi32(shifted, v), _mm_set1_epi32(static_cast<int32_t>(key)));
+}
+
+void encryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	__m128i v0, v1;
+	load(data, v0, v1);
+	for (size_t i = 0; i < rounds; ++i) {
+		v0 = _mm_add_epi32(v0, mix(v1, keys[i * 2]));
+		v1 = _mm_add_epi32(v1, mix(v0, keys[i * 2 + 1]));
+	}
+	store(data, v0, v1);
+}
+
+void decryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	__m128i v0, v1;
+	load(data, v0, v1);
+	for (size_t i = 0; i < rounds; ++i) {
+		v1 = _mm_sub_epi32(v1, mix(v0, keys[i * 2]));
+		v0 = _mm_sub_epi32(v0, mix(v1, keys[i * 2 + 1]));
+	}
+	store(data, v0, v1);
+}
+#elif defined(__NEON__)
+constexpr size_t parallelBlocks = 4;
+
+uint32x4_t mix(uint32x4_t v, uint32_t key)
+{
+	uint32x4_t shifted = veorq_u32(vshlq_n_u32(v, 4), vshrq_n_u32(v, 5));
+	return veorq_u32(vaddq_u32(shifted, v), vdupq_n_u32(key));
+}
+
+void encryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	// vld2 splits the first and the second words of the blocks
+	uint32x4x2_t v = vld2q_u32(reinterpret_cast<const uint32_t*>(data));
+	for (size_t i = 0; i < rounds; ++i) {
+		v.val[0] = vaddq_u32(v.val[0], mix(v.val[1], keys[i * 2]));
+		v.val[1] = vaddq_u32(v.val[1], mix(v.val[0], keys[i * 2 + 1]));
+	}
+	vst2q_u32(reinterpret_cast<uint32_t*>(data), v);
+}
+
+void decryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	uint32x4x2_t v = vld2q_u32(reinterpret_cast<const uint32_t*>(data));
+	for (size_t i = 0; i < rounds; ++i) {
+		v.val[1] = vsubq_u32(v.val[1], mix(v.val[0], keys[i * 2]));
+		v.val[0] = vsubq_u32(v.val[0], mix(v.val[1], keys[i * 2 + 1]));
+	}
+	vst2q_u32(reinterpret_cast<uint32_t*>(data), v);
+}
+#else
+constexpr size_t parallelBlocks = 1;
+
+void encryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	encryptBlock(data, keys);
+}
+
+void decryptBlocks(uint8_t* data, const RoundKeys& keys)
+{
+	decryptBlock(data, keys);
+}
+#endif
+
+}  // namespace
+
+RoundKeys expandEncryptKey(const Key& key)
+{
+	RoundKeys keys;
+	uint32_t sum = 0;
+	for (size_t i = 0; i < rounds; ++i) {
+		keys[i * 2] = sum + key[sum & 3];
+		sum -= delta;
+		keys[i * 2 + 1] = sum + key[(sum >> 11) & 3];
+	}
+	return keys;
+}
+
+RoundKeys expandDecryptKey(const Key& key)
+{
+	RoundKeys keys;
+	uint32_t sum = 0xC6EF3720;
+	for (size_t i = 0; i < rounds; ++i) {
+		keys[i * 2] = sum + key[(sum >> 11) & 3];
+		sum += delta;
+		keys[i * 2 + 1] = sum + key[sum & 3];
+	}
+	return keys;
+}
+
+void encrypt(uint8_t* data, size_t length, const RoundKeys& keys)
+{
+	size_t offset = 0;
+	for (; offset + parallelBlocks * 8 <= length; offset += parallelBlocks * 8) {
+		encryptBlocks(data + offset, keys);
+	}
+	for (; offset + 8 <= length; offset += 8) {
+		encryptBlock(data + offset, keys);
+	}
+}
+
+void decrypt(uint8_t* data, size_t length, const RoundKeys& keys)
+{
+	size_t offset = 0;
+	for (; offset + parallelBlocks * 8 <= length; offset += parallelBlocks * 8) {
+		decryptBlocks(data + offset, keys);
+	}
+	for (; offset + 8 <= length; offset += 8) {
+		decryptBlock(data + offset, keys);
+	}
+}
+
+}  // namespace xtea
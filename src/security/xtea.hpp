@@ -0,0 +1,47 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SECURITY_XTEA_HPP_
+#define SRC_SECURITY_XTEA_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace xtea {
+
+using Key = std::array<uint32_t, 4>;
+// the two key words of each of the 32 rounds, computed once per key
+using RoundKeys = std::array<uint32_t, 64>;
+
+RoundKeys expandEncryptKey(const Key& key);
+RoundKeys expandDecryptKey(const Key& key);
+
+/**
+ * Ciphers data in place, length must be a multiple of 8.
+ * The client uses every 8 byte block on its own, so the kernels run
+ * 8 (AVX2) or 4 (SSE2, NEON) blocks side by side with a scalar tail.
+ */
+void encrypt(uint8_t* data, size_t length, const RoundKeys& keys);
+void decrypt(uint8_t* data, size_t length, const RoundKeys& keys);
+
+}  // namespace xtea
+
+#endif  // SRC_SECURITY_XTEA_HPP_
@@ -0,0 +1,206 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "server/metrics/metrics.hpp"
+
+namespace {
+
+std::atomic<size_t> nextMetricShard {0};
+
+void appendSample(std::string& out, const std::string& name, const char* suffix, const std::string& labels, const std::string& extraLabel, const std::string& value)
+{
+	out += name;
+	out += suffix;
+	if (!labels.empty() || !extraLabel.empty()) {
+		out += '{';
+		out += labels;
+		if (!labels.empty() && !extraLabel.empty()) {
+			out += ',';
+		}
+		out += extraLabel;
+		out += '}';
+	}
+	out += ' ';
+	out += value;
+	out += '\n';
+}
+
+}  // namespace
+
+size_t getMetricShard()
+{
+	thread_local size_t shard = nextMetricShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+	return shard;
+}
+
+uint64_t MetricCounter::get() const
+{
+	uint64_t value = 0;
+	for (const Shard& shard : shards) {
+		value += shard.value.load(std::memory_order_relaxed);
+	}
+	return value;
+}
+
+MetricHistogram::MetricHistogram(std::vector<uint64_t> initBounds) : bounds(std::move(initBounds))
+{
+	if (bounds.size() >= METRIC_HISTOGRAM_BUCKETS) {
+		bounds.resize(METRIC_HISTOGRAM_BUCKETS - 1);
+	}
+}
+
+void MetricHistogram::observe(uint64_t micros)
+{
+	size_t bucket = 0;
+	while (bucket < bounds.size() && micros > bounds[bucket]) {
+		++bucket;
+	}
+
+	Shard& shard = shards[getMetricShard()];
+	shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	shard.sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+std::array<uint64_t, METRIC_HISTOGRAM_BUCKETS> MetricHistogram::getBuckets() const
+{
+	std::array<uint64_t, METRIC_HISTOGRAM_BUCKETS> buckets {};
+	for (const Shard& shard : shards) {
+		for (size_t i = 0; i <= bounds.size(); ++i) {
+			buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+		}
+	}
+	return buckets;
+}
+
+uint64_t MetricHistogram::getSum() const
+{
+	uint64_t sum = 0;
+	for (const Shard& shard : shards) {
+		sum += shard.sum.load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+const char* Metrics::getTypeName(MetricType type)
+{
+	switch (type) {
+		case METRIC_COUNTER:
+			return "counter";
+		case METRIC_GAUGE:
+			return "gauge";
+		default:
+			return "histogram";
+	}
+}
+
+Metrics::Series& Metrics::getSeries(const std::string& name, const std::string& help, MetricType type, const std::string& labels)
+{
+	Family* family;
+	auto it = familyNames.find(name);
+	if (it != familyNames.end()) {
+		family = it->second;
+	} else {
+		family = &families.emplace_back();
+		family->name = name;
+		family->help = help;
+		family->type = type;
+		familyNames.emplace(name, family);
+	}
+
+	for (Series& series : family->series) {
+		if (series.labels == labels) {
+			return series;
+		}
+	}
+
+	Series& series = family->series.emplace_back();
+	series.labels = labels;
+	return series;
+}
+
+MetricCounter& Metrics::getCounter(const std::string& name, const std::string& help, const std::string& labels /*= ""*/)
+{
+	std::lock_guard<std::mutex> lockClass(registryLock);
+	Series& series = getSeries(name, help, METRIC_COUNTER, labels);
+	if (!series.counter) {
+		series.counter = &counters.emplace_back();
+	}
+	return *series.counter;
+}
+
+MetricGauge& Metrics::getGauge(const std::string& name, const std::string& help, const std::string& labels /*= ""*/)
+{
+	std::lock_guard<std::mutex> lockClass(registryLock);
+	Series& series = getSeries(name, help, METRIC_GAUGE, labels);
+	if (!series.gauge) {
+		series.gauge = &gauges.emplace_back();
+	}
+	return *series.gauge;
+}
+
+MetricHistogram& Metrics::getHistogram(const std::string& name, const std::string& help, const std::vector<uint64_t>& bounds, const std::string& labels /*= ""*/)
+{
+	std::lock_guard<std::mutex> lockClass(registryLock);
+	Series& series = getSeries(name, help, METRIC_HISTOGRAM, labels);
+	if (!series.histogram) {
+		series.histogram = &histograms.emplace_back(bounds);
+	}
+	return *series.histogram;
+}
+
+void Metrics::addCallback(const std::string& name, const std::string& help, std::function<double()> callback, const std::string& labels)
+{
+	std::lock_guard<std::mutex> lockClass(registryLock);
+	getSeries(name, help, METRIC_GAUGE, labels).callback = std::move(callback);
+}
+
+std::string Metrics::render()
+{
+	std::lock_guard<std::mutex> lockClass(registryLock);
+	std::string out;
+	out.reserve(families.size() * 256);
+	for (const Family& family : families) {
+		out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", family.name, family.help, family.name, getTypeName(family.type));
+		for (const Series& series : family.series) {
+			if (series.counter) {
+				appendSample(out, family.name, "", series.labels, "", std::to_string(series.counter->get()));
+			} else if (series.gauge) {
+				appendSample(out, family.name, "", series.labels, "", std::to_string(series.gauge->get()));
+			} else if (series.callback) {
+				appendSample(out, family.name, "", series.labels, "", fmt::format("{}", series.callback()));
+			} else if (series.histogram) {
+				const std::vector<uint64_t>& bounds = series.histogram->getBounds();
+				std::array<uint64_t, METRIC_HISTOGRAM_BUCKETS> buckets = series.histogram->getBuckets();
+				uint64_t count = 0;
+				for (size_t i = 0; i < bounds.size(); ++i) {
+					count += buckets[i];
+					appendSample(out, family.name, "_bucket", series.labels, fmt::format("le=\"{}\"", bounds[i] / 1000000.), std::to_string(count));
+				}
+				count += buckets[bounds.size()];
+				appendSample(out, family.name, "_bucket", series.labels, "le=\"+Inf\"", std::to_string(count));
+				appendSample(out, family.name, "_sum", series.labels, "", fmt::format("{}", series.histogram->getSum() / 1000000.));
+				appendSample(out, family.name, "_count", series.labels, "", std::to_string(count));
+			}
+		}
+	}
+	return out;
+}
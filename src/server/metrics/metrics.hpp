@@ -0,0 +1,174 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_METRICS_METRICS_HPP_
+#define SRC_SERVER_METRICS_METRICS_HPP_
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+// counters and histograms are split in this many shards, each thread updates its own one
+static constexpr size_t METRIC_SHARDS = 16;
+// most buckets a histogram can have, the +Inf one included
+static constexpr size_t METRIC_HISTOGRAM_BUCKETS = 16;
+
+// shard of the calling thread, threads take the shards in turn as they first ask
+size_t getMetricShard();
+
+class MetricCounter
+{
+	public:
+		void add(uint64_t value = 1) {
+			shards[getMetricShard()].value.fetch_add(value, std::memory_order_relaxed);
+		}
+		uint64_t get() const;
+
+	private:
+		struct alignas(64) Shard {
+			std::atomic<uint64_t> value {0};
+		};
+
+		std::array<Shard, METRIC_SHARDS> shards;
+};
+
+class MetricGauge
+{
+	public:
+		void set(int64_t newValue) {
+			value.store(newValue, std::memory_order_relaxed);
+		}
+		void add(int64_t delta) {
+			value.fetch_add(delta, std::memory_order_relaxed);
+		}
+		int64_t get() const {
+			return value.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<int64_t> value {0};
+};
+
+/**
+ * Durations recorded in microseconds and exported in seconds.
+ * Bounds are the upper limits of the buckets, ascending; anything above
+ * the last one falls in the +Inf bucket.
+ */
+class MetricHistogram
+{
+	public:
+		explicit MetricHistogram(std::vector<uint64_t> bounds);
+
+		void observe(uint64_t micros);
+
+		const std::vector<uint64_t>& getBounds() const {
+			return bounds;
+		}
+		// per bucket counts, not cumulative, +Inf last
+		std::array<uint64_t, METRIC_HISTOGRAM_BUCKETS> getBuckets() const;
+		uint64_t getSum() const;
+
+	private:
+		struct alignas(64) Shard {
+			std::array<std::atomic<uint64_t>, METRIC_HISTOGRAM_BUCKETS> buckets {};
+			std::atomic<uint64_t> sum {0};
+		};
+
+		std::vector<uint64_t> bounds;
+		std::array<Shard, METRIC_SHARDS> shards;
+};
+
+/**
+ * Process wide registry of the metrics exported to Prometheus.
+ * Lookups take a lock and are meant for startup or once per object, the
+ * returned metric is kept and updated without any: counters and
+ * histograms add to the shard of the calling thread and a scrape sums
+ * the shards up.
+ */
+class Metrics
+{
+	public:
+		Metrics() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		Metrics(const Metrics&) = delete;
+		Metrics& operator=(const Metrics&) = delete;
+
+		static Metrics& getInstance() {
+			// Guaranteed to be destroyed
+			static Metrics instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// The metric registered with this name and labels, created on first use; labels as in protocol="login"
+		MetricCounter& getCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+		MetricGauge& getGauge(const std::string& name, const std::string& help, const std::string& labels = "");
+		MetricHistogram& getHistogram(const std::string& name, const std::string& help, const std::vector<uint64_t>& bounds, const std::string& labels = "");
+		// A gauge read on every scrape, from the scraping thread
+		void addCallback(const std::string& name, const std::string& help, std::function<double()> callback, const std::string& labels = "");
+
+		// Prometheus text exposition format of everything registered
+		std::string render();
+
+	private:
+		enum MetricType {
+			METRIC_COUNTER,
+			METRIC_GAUGE,
+			METRIC_HISTOGRAM,
+		};
+
+		struct Series {
+			std::string labels;
+			MetricCounter* counter = nullptr;
+			MetricGauge* gauge = nullptr;
+			MetricHistogram* histogram = nullptr;
+			std::function<double()> callback;
+		};
+
+		struct Family {
+			std::string name;
+			std::string help;
+			MetricType type;
+			std::vector<Series> series;
+		};
+
+		static const char* getTypeName(MetricType type);
+		// the series with these labels, added to the family if it has none
+		Series& getSeries(const std::string& name, const std::string& help, MetricType type, const std::string& labels);
+
+		std::mutex registryLock;
+		// in registration order, which is the order of the export
+		std::deque<Family> families;
+		phmap::flat_hash_map<std::string, Family*> familyNames;
+		std::deque<MetricCounter> counters;
+		std::deque<MetricGauge> gauges;
+		std::deque<MetricHistogram> histograms;
+};
+
+constexpr auto g_metrics = &Metrics::getInstance;
+
+#endif  // SRC_SERVER_METRICS_METRICS_HPP_
@@ -0,0 +1,176 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "server/metrics/metrics_server.hpp"
+#include "database/databasetasks.h"
+#include "game/game.h"
+#include "game/scheduling/scheduler.h"
+#include "server/metrics/metrics.hpp"
+#include "server/network/protocol/protocol.h"
+
+namespace {
+
+// longest request head read, anything longer is answered as it is
+constexpr size_t METRICS_REQUEST_MAX_SIZE = 4096;
+
+class MetricsRequest : public std::enable_shared_from_this<MetricsRequest>
+{
+	public:
+		explicit MetricsRequest(boost::asio::io_service& io_service) : socket(io_service), timer(io_service) {}
+
+		boost::asio::ip::tcp::socket& getSocket() {
+			return socket;
+		}
+
+		void start() {
+			timer.expires_from_now(boost::posix_time::seconds(METRICS_REQUEST_TIMEOUT));
+			timer.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+				if (error != boost::asio::error::operation_aborted) {
+					self->close();
+				}
+			});
+			read();
+		}
+
+	private:
+		void read() {
+			socket.async_read_some(boost::asio::buffer(buffer), [self = shared_from_this()](const boost::system::error_code& error, size_t bytes) {
+				if (error) {
+					self->close();
+					return;
+				}
+
+				self->request.append(self->buffer.data(), bytes);
+				if (self->request.find("\r\n\r\n") != std::string::npos || self->request.size() >= METRICS_REQUEST_MAX_SIZE) {
+					self->respond();
+				} else {
+					self->read();
+				}
+			});
+		}
+
+		void respond() {
+			std::string status;
+			std::string body;
+			if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 14, "GET /metrics?") == 0) {
+				status = "200 OK";
+				body = g_metrics().render();
+			} else {
+				status = "404 Not Found";
+				body = "Not Found\n";
+			}
+
+			response = fmt::format("HTTP/1.1 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", status, body.size(), body);
+			boost::asio::async_write(socket, boost::asio::buffer(response), [self = shared_from_this()](const boost::system::error_code&, size_t) {
+				self->close();
+			});
+		}
+
+		void close() {
+			boost::system::error_code error;
+			timer.cancel(error);
+			socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+			socket.close(error);
+		}
+
+		boost::asio::ip::tcp::socket socket;
+		boost::asio::deadline_timer timer;
+		std::array<char, 1024> buffer;
+		std::string request;
+		std::string response;
+};
+
+}  // namespace
+
+bool MetricsServer::open(const std::string& ip, uint16_t port)
+{
+	try {
+		acceptor.reset(new boost::asio::ip::tcp::acceptor(io_service,
+                       boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(ip), port)));
+	} catch (const boost::system::system_error& e) {
+		SPDLOG_WARN("[MetricsServer::open] - Error: {}", e.what());
+		acceptor.reset();
+		return false;
+	}
+
+	accept();
+	return true;
+}
+
+void MetricsServer::close()
+{
+	if (acceptor && acceptor->is_open()) {
+		boost::system::error_code error;
+		acceptor->close(error);
+	}
+}
+
+void MetricsServer::accept()
+{
+	if (!acceptor) {
+		return;
+	}
+
+	auto request = std::make_shared<MetricsRequest>(io_service);
+	acceptor->async_accept(request->getSocket(), [self = shared_from_this(), request](const boost::system::error_code& error) {
+		if (error == boost::asio::error::operation_aborted) {
+			return;
+		}
+
+		if (!error) {
+			request->start();
+		}
+		self->accept();
+	});
+}
+
+void MetricsServer::startSampling()
+{
+	g_metrics().addCallback("canary_scheduler_pending_events", "Events waiting in the scheduler", []() {
+		return static_cast<double>(g_scheduler().getPendingEvents());
+	});
+	g_metrics().addCallback("canary_dispatcher_pending_tasks", "Tasks waiting in the dispatcher queues", []() {
+		return static_cast<double>(g_dispatcher().getPendingTasks());
+	});
+	g_metrics().addCallback("canary_database_pending_tasks", "Tasks waiting on the database workers", []() {
+		return static_cast<double>(g_databaseTasks().getPendingTasks());
+	});
+	g_metrics().addCallback("canary_compression_ratio", "Bytes sent over bytes given to deflate since startup", []() {
+		return Protocol::getCompressionRatio();
+	});
+	sample();
+}
+
+void MetricsServer::sample()
+{
+	static MetricGauge& players = g_metrics().getGauge("canary_players_online", "Players online");
+	static MetricGauge& monsters = g_metrics().getGauge("canary_monsters", "Monsters on the map");
+	static MetricGauge& npcs = g_metrics().getGauge("canary_npcs", "Npcs on the map");
+	static MetricGauge& thinking = g_metrics().getGauge("canary_creatures_thinking", "Creatures in the think and walk check lists");
+
+	players.set(g_game().getPlayersOnline());
+	monsters.set(g_game().getMonstersOnline());
+	npcs.set(g_game().getNpcsOnline());
+	thinking.set(g_game().getCheckedCreatures());
+
+	g_scheduler().addEvent(createSchedulerTask(METRICS_SAMPLE_INTERVAL, &MetricsServer::sample));
+}
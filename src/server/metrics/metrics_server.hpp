@@ -0,0 +1,64 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_METRICS_METRICS_SERVER_HPP_
+#define SRC_SERVER_METRICS_METRICS_SERVER_HPP_
+
+#include <memory>
+#include <string>
+
+#include <boost/asio.hpp>
+
+// game state gauges are refreshed on the dispatcher every METRICS_SAMPLE_INTERVAL ms
+static constexpr int32_t METRICS_SAMPLE_INTERVAL = 5000;
+// a scrape that has not sent its request by then is closed
+static constexpr int32_t METRICS_REQUEST_TIMEOUT = 5;
+
+/**
+ * Minimal HTTP listener answering GET /metrics with the text of g_metrics(),
+ * one request per connection. It runs on the acceptor io_service of the
+ * ServiceManager beside the game ports; the game protocols frame their
+ * messages with a length header, so it cannot share a ServicePort.
+ */
+class MetricsServer : public std::enable_shared_from_this<MetricsServer>
+{
+	public:
+		explicit MetricsServer(boost::asio::io_service& init_io_service) : io_service(init_io_service) {}
+
+		// non-copyable
+		MetricsServer(const MetricsServer&) = delete;
+		MetricsServer& operator=(const MetricsServer&) = delete;
+
+		bool open(const std::string& ip, uint16_t port);
+		void close();
+
+		// dispatcher thread, registers the game gauges and keeps refreshing them
+		static void startSampling();
+
+	private:
+		void accept();
+
+		static void sample();
+
+		boost::asio::io_service& io_service;
+		std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
+};
+
+#endif  // SRC_SERVER_METRICS_METRICS_SERVER_HPP_
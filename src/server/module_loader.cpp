@@ -0,0 +1,91 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "server/module_loader.hpp"
+#include "utils/tools.h"
+
+ModuleLoader::~ModuleLoader()
+{
+	// the loaders write into globals, none may outlive the startup sequence
+	for (auto& it : modules) {
+		it.second.result.wait();
+	}
+}
+
+void ModuleLoader::add(const std::string& name, std::function<bool()> loader, const std::vector<std::string>& dependencies)
+{
+	std::vector<std::shared_future<bool>> waitFor;
+	waitFor.reserve(dependencies.size());
+	for (const std::string& dependency : dependencies) {
+		auto it = modules.find(dependency);
+		if (it != modules.end()) {
+			waitFor.push_back(it->second.result);
+		} else {
+			SPDLOG_WARN("[ModuleLoader::add] - Module {} depends on unknown module {}", name, dependency);
+		}
+	}
+
+	Module& module = modules[name];
+	module.addedTime = OTSYS_PRECISE_TIME();
+	order.push_back(name);
+	module.result = std::async(std::launch::async, [name, &module, loader = std::move(loader), waitFor = std::move(waitFor)]() {
+		bool dependenciesLoaded = true;
+		for (const auto& dependency : waitFor) {
+			dependenciesLoaded = dependency.get() && dependenciesLoaded;
+		}
+		module.startTime = OTSYS_PRECISE_TIME();
+		if (!dependenciesLoaded) {
+			module.endTime = module.startTime;
+			return false;
+		}
+
+		bool loaded;
+		try {
+			loaded = loader();
+		} catch (const std::exception& e) {
+			SPDLOG_ERROR("[ModuleLoader] - Loading {} failed: {}", name, e.what());
+			loaded = false;
+		}
+		module.endTime = OTSYS_PRECISE_TIME();
+		return loaded;
+	}).share();
+}
+
+bool ModuleLoader::wait(const std::string& name)
+{
+	auto it = modules.find(name);
+	if (it == modules.end()) {
+		SPDLOG_ERROR("[ModuleLoader::wait] - Unknown module {}", name);
+		return false;
+	}
+	return it->second.result.get();
+}
+
+void ModuleLoader::logTimings()
+{
+	for (const std::string& name : order) {
+		const Module& module = modules[name];
+		module.result.wait();
+		SPDLOG_INFO("[ModuleLoader] {}: {}ms on its thread, {}ms waiting for its dependencies",
+			name, module.endTime - module.startTime, module.startTime - module.addedTime);
+	}
+}
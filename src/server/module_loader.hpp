@@ -0,0 +1,69 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_MODULE_LOADER_HPP_
+#define SRC_SERVER_MODULE_LOADER_HPP_
+
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * Runs startup loaders that touch neither the Lua state nor each other on their
+ * own threads. A loader starts once the loaders it depends on are done and is
+ * skipped (a failure) if one of them failed. Results are read back on the
+ * main thread with wait, so the error handling stays where it was.
+ */
+class ModuleLoader
+{
+	public:
+		ModuleLoader() = default;
+		~ModuleLoader();
+
+		// non-copyable
+		ModuleLoader(const ModuleLoader&) = delete;
+		ModuleLoader& operator=(const ModuleLoader&) = delete;
+
+		void add(const std::string& name, std::function<bool()> loader, const std::vector<std::string>& dependencies = {});
+
+		// Blocks until the loader is done, \returns whether it succeeded
+		bool wait(const std::string& name);
+
+		// Waits for every loader and logs how long each ran and waited for its dependencies
+		void logTimings();
+
+	private:
+		struct Module {
+			std::shared_future<bool> result;
+			// OTSYS_PRECISE_TIME when added, started after its dependencies and done
+			int64_t addedTime = 0;
+			int64_t startTime = 0;
+			int64_t endTime = 0;
+		};
+
+		// node map, the loader threads write the times into their Module
+		phmap::node_hash_map<std::string, Module> modules;
+		std::vector<std::string> order;
+};
+
+#endif  // SRC_SERVER_MODULE_LOADER_HPP_
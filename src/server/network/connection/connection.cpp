@@ -19,12 +19,26 @@
 
 #include "pch.hpp"
 
+#include "config/configmanager.h"
 #include "server/network/connection/connection.h"
+#include "server/network/connection/handshake_workers.hpp"
 #include "server/network/message/outputmessage.h"
 #include "server/network/protocol/protocol.h"
 #include "server/network/protocol/protocolgame.h"
 #include "game/scheduling/scheduler.h"
 #include "server/server.h"
+#include "server/metrics/metrics.hpp"
+#include "utils/log_rate_limiter.hpp"
+
+ConnectionWriteStats Connection::writeStats;
+
+namespace {
+
+// socket operations started, each takes one or more recv or send calls; per player and second they compare the network backends
+MetricCounter& socketReads = g_metrics().getCounter("canary_network_socket_reads_total", "Socket reads started by the connections");
+MetricCounter& socketWrites = g_metrics().getCounter("canary_network_socket_writes_total", "Socket writes started by the connections");
+
+}  // namespace
 
 Connection_ptr ConnectionManager::createConnection(boost::asio::io_service& io_service, ConstServicePort_ptr servicePort)
 {
@@ -66,6 +80,10 @@ Connection::Connection(boost::asio::io_service& initIoService, ConstServicePort_
 	socket(initIoService)
 {
 	timeConnected = time(nullptr);
+	if (int32_t receiveBufferSize = g_configManager().getNumber(NETWORK_RECEIVE_BUFFER); receiveBufferSize > 0) {
+		receiveCapacity = std::max<size_t>(CONNECTION_MIN_RECEIVE_BUFFER, receiveBufferSize);
+		receiveBuffer = std::make_unique<uint8_t[]>(receiveCapacity);
+	}
 }
 // Constructor end
 
@@ -85,7 +103,7 @@ void Connection::close(bool force)
 			createSchedulerTask(1000, std::bind(&Protocol::release, protocol)));
 	}
 
-	if (messageQueue.empty() || force) {
+	if ((messageQueue.empty() && writeQueue.empty()) || force) {
 		closeSocket();
 	} else {
 		//will be closed by the destructor or onWriteOperation
@@ -126,11 +144,10 @@ void Connection::accept(bool toggleParseHeader /* = true */)
 		// If toggleParseHeader is true, execute the parseHeader, if not, execute parseProxyIdentification
 		if (toggleParseHeader) {
 			// Read size of the first packet
-			boost::asio::async_read(socket,
-									boost::asio::buffer(msg.getBuffer(), HEADER_LENGTH),
-									std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+			readNextPacket();
 		} else {
 			// Read header bytes to identify if it is proxy identification
+			socketReads.add();
 			boost::asio::async_read(socket,
 									boost::asio::buffer(msg.getBuffer(), HEADER_LENGTH),
 									std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1));
@@ -171,6 +188,7 @@ void Connection::parseProxyIdentification(const boost::system::error_code& error
 					readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1));
 
 					// Read the remainder of proxy identification
+					socketReads.add();
 					boost::asio::async_read(socket,
 											boost::asio::buffer(msg.getBuffer(), remainder),
 											std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1));
@@ -189,7 +207,7 @@ void Connection::parseProxyIdentification(const boost::system::error_code& error
 		if (strncasecmp(charData, &serverName[2], remainder) == 0) {
 			connectionState = CONNECTION_STATE_OPEN;
 		} else {
-			SPDLOG_ERROR("Connection::parseProxyIdentification] Invalid Client Login! Server Name mismatch!");
+			SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "Connection::parseProxyIdentification] Invalid Client Login! Server Name mismatch!");
 			close(FORCE_CLOSE);
 			return;
 		}
@@ -212,7 +230,7 @@ void Connection::parseHeader(const boost::system::error_code& error)
 
 	uint32_t timePassed = std::max<uint32_t>(1, (time(nullptr) - timeConnected) + 1);
 	if ((++packetsSent / timePassed) > static_cast<uint32_t>(g_configManager().getNumber(MAX_PACKETS_PER_SECOND))) {
-		SPDLOG_WARN("{} disconnected for exceeding packet per second limit.", convertIPToString(getIP()));
+		SPDLOG_RATE_LIMITED(SPDLOG_WARN, "{} disconnected for exceeding packet per second limit.", convertIPToString(getIP()));
 		close();
 		return;
 	}
@@ -232,13 +250,25 @@ void Connection::parseHeader(const boost::system::error_code& error)
 		readTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_READ_TIMEOUT));
 		readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1));
 
-		// Read packet content
+		// Read packet content, what the receive buffer holds of it first
 		msg.setLength(size + HEADER_LENGTH);
+		size_t buffered = std::min<size_t>(receiveEnd - receiveStart, size);
+		if (buffered != 0) {
+			memcpy(msg.getBodyBuffer(), receiveBuffer.get() + receiveStart, buffered);
+			receiveStart += buffered;
+		}
+
+		if (buffered == size) {
+			parsePacket(error);
+			return;
+		}
+
+		socketReads.add();
 		boost::asio::async_read(socket,
-								boost::asio::buffer(msg.getBodyBuffer(), size),
+								boost::asio::buffer(msg.getBodyBuffer() + buffered, size - buffered),
 		                        std::bind(&Connection::parsePacket, shared_from_this(), std::placeholders::_1));
 	} catch (const boost::system::system_error& e) {
-		SPDLOG_ERROR("[Connection::parseHeader] - error: {}", e.what());
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[Connection::parseHeader] - error: {}", e.what());
 		close(FORCE_CLOSE);
 	}
 }
@@ -291,8 +321,25 @@ void Connection::parsePacket(const boost::system::error_code& error)
 			msg.skipBytes(1);
 		}
 
-		protocol->onRecvFirstMessage(msg);
+		ProtocolMetrics& metrics = protocol->getMetrics();
+		metrics.bytesReceived.add(msg.getLength());
+		metrics.messagesReceived.add();
+
+		if (g_handshakeWorkers().isRunning()) {
+			if (!g_handshakeWorkers().addTask(std::bind(&Connection::parseFirstMessage, shared_from_this()))) {
+				close(FORCE_CLOSE);
+				return;
+			}
+			// reading resumes once a handshake worker has handled the message
+			skipReadingNextPacket = true;
+		} else {
+			protocol->onRecvFirstMessage(msg);
+		}
 	} else {
+		ProtocolMetrics& metrics = protocol->getMetrics();
+		metrics.bytesReceived.add(msg.getLength());
+		metrics.messagesReceived.add();
+
 		// Send the packet to the current protocol
 		skipReadingNextPacket = protocol->onRecvMessage(msg);
 	}
@@ -303,10 +350,34 @@ void Connection::parsePacket(const boost::system::error_code& error)
 
 		if (!skipReadingNextPacket) {
 			// Wait to the next packet
-			boost::asio::async_read(socket, boost::asio::buffer(msg.getBuffer(), HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+			readNextPacket();
 		}
 	} catch (const boost::system::system_error& e) {
-		SPDLOG_ERROR("[Connection::parsePacket] - error: {}", e.what());
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[Connection::parsePacket] - error: {}", e.what());
+		close(FORCE_CLOSE);
+	}
+}
+
+void Connection::parseFirstMessage()
+{
+	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+	if (connectionState == CONNECTION_STATE_CLOSED) {
+		return;
+	}
+
+	protocol->onRecvFirstMessage(msg);
+	if (connectionState == CONNECTION_STATE_CLOSED) {
+		return;
+	}
+
+	try {
+		readTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_READ_TIMEOUT));
+		readTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1));
+
+		// Wait to the next packet
+		readNextPacket();
+	} catch (const boost::system::system_error& e) {
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[Connection::parseFirstMessage] - error: {}", e.what());
 		close(FORCE_CLOSE);
 	}
 }
@@ -317,21 +388,84 @@ void Connection::resumeWork()
 
 	try {
 		// Wait to the next packet
-		boost::asio::async_read(socket, boost::asio::buffer(msg.getBuffer(), HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+		readNextPacket();
 	} catch (const boost::system::system_error& e) {
 		SPDLOG_ERROR("[Connection::resumeWork] - error: {}", e.what());
 		close(FORCE_CLOSE);
 	}
 }
 
-void Connection::send(const OutputMessage_ptr& outputMessage)
+void Connection::readNextPacket()
+{
+	if (!receiveBuffer) {
+		socketReads.add();
+		boost::asio::async_read(socket, boost::asio::buffer(msg.getBuffer(), HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+		return;
+	}
+
+	size_t buffered = receiveEnd - receiveStart;
+	if (buffered >= HEADER_LENGTH) {
+		// posted, a burst of buffered packets is handled one handler at a time instead of recursing
+		memcpy(msg.getBuffer(), receiveBuffer.get() + receiveStart, HEADER_LENGTH);
+		receiveStart += HEADER_LENGTH;
+		#if BOOST_VERSION >= 106600
+		boost::asio::post(socket.get_executor(), std::bind(&Connection::parseHeader, shared_from_this(), boost::system::error_code()));
+		#else
+		socket.get_io_service().post(std::bind(&Connection::parseHeader, shared_from_this(), boost::system::error_code()));
+		#endif
+		return;
+	}
+
+	// keep the partial header at the front, the read fills the rest
+	if (buffered != 0 && receiveStart != 0) {
+		memmove(receiveBuffer.get(), receiveBuffer.get() + receiveStart, buffered);
+	}
+	receiveStart = 0;
+	receiveEnd = buffered;
+
+	socketReads.add();
+	socket.async_read_some(boost::asio::buffer(receiveBuffer.get() + receiveEnd, receiveCapacity - receiveEnd),
+	                       std::bind(&Connection::onReceive, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+}
+
+void Connection::onReceive(const boost::system::error_code& error, size_t bytes)
 {
 	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+	if (error) {
+		close(FORCE_CLOSE);
+		return;
+	} else if (connectionState == CONNECTION_STATE_CLOSED) {
+		return;
+	}
+
+	// the read timer keeps running until the header is parsed
+	receiveEnd += bytes;
+	try {
+		readNextPacket();
+	} catch (const boost::system::system_error& e) {
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[Connection::onReceive] - error: {}", e.what());
+		close(FORCE_CLOSE);
+	}
+}
+
+void Connection::send(const OutputMessage_ptr& outputMessage)
+{
+	std::unique_lock<std::recursive_mutex> lockClass(connectionLock);
 	if (connectionState == CONNECTION_STATE_CLOSED) {
 		return;
 	}
 
-	bool noPendingWrite = messageQueue.empty();
+	size_t queued = queuedBytes.fetch_add(outputMessage->getLength(), std::memory_order_relaxed) + outputMessage->getLength();
+	auto maxQueued = static_cast<size_t>(g_configManager().getNumber(OUTPUT_QUEUE_MAX_BYTES));
+	if (maxQueued != 0 && queued > maxQueued) {
+		// the client stopped reading, close takes the connection manager lock
+		lockClass.unlock();
+		SPDLOG_WARN("[Connection::send] - Closing connection of {} with {} bytes waiting to be written", convertIPToString(getIP()), queued);
+		close(FORCE_CLOSE);
+		return;
+	}
+
+	bool noPendingWrite = messageQueue.empty() && writeQueue.empty();
 	messageQueue.emplace_back(outputMessage);
 	if (noPendingWrite) {
 		// Make asio thread handle xtea encryption instead of dispatcher
@@ -353,11 +487,7 @@ void Connection::internalWorker()
 {
 	std::unique_lock<std::recursive_mutex> lockClass(connectionLock);
 	if (!messageQueue.empty()) {
-		const OutputMessage_ptr& outputMessage = messageQueue.front();
-		lockClass.unlock();
-		protocol->onSendMessage(outputMessage);
-		lockClass.lock();
-		internalSend(outputMessage);
+		internalSend(lockClass);
 	} else if (connectionState == CONNECTION_STATE_CLOSED) {
 		closeSocket();
 	}
@@ -377,14 +507,43 @@ uint32_t Connection::getIP()
 	return htonl(endpoint.address().to_v4().to_ulong());
 }
 
-void Connection::internalSend(const OutputMessage_ptr& outputMessage)
+void Connection::internalSend(std::unique_lock<std::recursive_mutex>& lockClass)
 {
+	size_t maxMessages = std::max<int32_t>(1, g_configManager().getNumber(MAX_MESSAGES_PER_WRITE));
+	writeQueueBytes = 0;
+	while (!messageQueue.empty() && writeQueue.size() < maxMessages) {
+		writeQueueBytes += messageQueue.front()->getLength();
+		writeQueue.emplace_back(std::move(messageQueue.front()));
+		messageQueue.pop_front();
+	}
+
+	// encryption runs unlocked, send only appends to messageQueue meanwhile
+	lockClass.unlock();
+	for (const OutputMessage_ptr& outputMessage : writeQueue) {
+		protocol->onSendMessage(outputMessage);
+	}
+	lockClass.lock();
+
+	size_t bytes = 0;
+	writeBuffers.clear();
+	for (const OutputMessage_ptr& outputMessage : writeQueue) {
+		writeBuffers.emplace_back(outputMessage->getOutputBuffer(), outputMessage->getLength());
+		bytes += outputMessage->getLength();
+	}
+
+	writeStats.writes.fetch_add(1, std::memory_order_relaxed);
+	writeStats.messages.fetch_add(writeQueue.size(), std::memory_order_relaxed);
+	writeStats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	ProtocolMetrics& metrics = protocol->getMetrics();
+	metrics.bytesSent.add(bytes);
+	metrics.messagesSent.add(writeQueue.size());
+
 	try {
 		writeTimer.expires_from_now(boost::posix_time::seconds(CONNECTION_WRITE_TIMEOUT));
 		writeTimer.async_wait(std::bind(&Connection::handleTimeout, std::weak_ptr<Connection>(shared_from_this()), std::placeholders::_1));
 
-		boost::asio::async_write(socket,
-		                         boost::asio::buffer(outputMessage->getOutputBuffer(), outputMessage->getLength()),
+		socketWrites.add();
+		boost::asio::async_write(socket, writeBuffers,
 		                         std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1));
 	} catch (const boost::system::system_error& e) {
 		SPDLOG_ERROR("[Connection::internalSend] - error: {}", e.what());
@@ -395,7 +554,9 @@ void Connection::onWriteOperation(const boost::system::error_code& error)
 {
 	std::unique_lock<std::recursive_mutex> lockClass(connectionLock);
 	writeTimer.cancel();
-	messageQueue.pop_front();
+	writeQueue.clear();
+	queuedBytes.fetch_sub(writeQueueBytes, std::memory_order_relaxed);
+	writeQueueBytes = 0;
 
 	if (error) {
 		messageQueue.clear();
@@ -404,11 +565,7 @@ void Connection::onWriteOperation(const boost::system::error_code& error)
 	}
 
 	if (!messageQueue.empty()) {
-		const OutputMessage_ptr& outputMessage = messageQueue.front();
-		lockClass.unlock();
-		protocol->onSendMessage(outputMessage);
-		lockClass.lock();
-		internalSend(outputMessage);
+		internalSend(lockClass);
 	} else if (connectionState == CONNECTION_STATE_CLOSED) {
 		closeSocket();
 	}
@@ -27,11 +27,16 @@
 
 static constexpr int32_t CONNECTION_WRITE_TIMEOUT = 30;
 static constexpr int32_t CONNECTION_READ_TIMEOUT = 30;
+// smallest networkReceiveBuffer, a read ahead below it saves nothing
+static constexpr size_t CONNECTION_MIN_RECEIVE_BUFFER = 256;
 
 class Protocol;
 using Protocol_ptr = std::shared_ptr<Protocol>;
 class OutputMessage;
-using OutputMessage_ptr = std::shared_ptr<OutputMessage>;
+// the reference count lives in the message, see outputmessage.cpp
+using OutputMessage_ptr = boost::intrusive_ptr<OutputMessage>;
+void intrusive_ptr_add_ref(OutputMessage* outputMessage);
+void intrusive_ptr_release(OutputMessage* outputMessage);
 class Connection;
 using Connection_ptr = std::shared_ptr<Connection>;
 using ConnectionWeak_ptr = std::weak_ptr<Connection>;
@@ -41,6 +46,19 @@ class ServicePort;
 using ServicePort_ptr = std::shared_ptr<ServicePort>;
 using ConstServicePort_ptr = std::shared_ptr<const ServicePort>;
 
+// Counters of every socket write since the last report, shared by all connections
+struct ConnectionWriteStats {
+	std::atomic<uint64_t> writes {0};
+	std::atomic<uint64_t> messages {0};
+	std::atomic<uint64_t> bytes {0};
+
+	void reset() {
+		writes.store(0, std::memory_order_relaxed);
+		messages.store(0, std::memory_order_relaxed);
+		bytes.store(0, std::memory_order_relaxed);
+	}
+};
+
 class ConnectionManager
 {
 	public:
@@ -85,10 +103,25 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		uint32_t getIP();
 
+		// bytes handed to send() and not yet written to the socket
+		size_t getQueuedBytes() const {
+			return queuedBytes.load(std::memory_order_relaxed);
+		}
+
+		static ConnectionWriteStats& getWriteStats() {
+			return writeStats;
+		}
+
 	private:
 		void parseProxyIdentification(const boost::system::error_code& error);
 		void parseHeader(const boost::system::error_code& error);
 		void parsePacket(const boost::system::error_code& error);
+		// handshake worker thread
+		void parseFirstMessage();
+
+		// Reads the header of the next packet, from the receive buffer when it holds one
+		void readNextPacket();
+		void onReceive(const boost::system::error_code& error, size_t bytes);
 
 		void onWriteOperation(const boost::system::error_code& error);
 
@@ -96,7 +129,8 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		void closeSocket();
 		void internalWorker();
-		void internalSend(const OutputMessage_ptr& outputMessage);
+		// Moves the front of messageQueue to writeQueue and writes it with one async_write
+		void internalSend(std::unique_lock<std::recursive_mutex>& lockClass);
 
 		boost::asio::ip::tcp::socket& getSocket() {
 			return socket;
@@ -104,12 +138,24 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		NetworkMessage msg;
 
+		// read ahead of the socket, packets are taken from it into msg; empty with networkReceiveBuffer 0
+		std::unique_ptr<uint8_t[]> receiveBuffer;
+		size_t receiveCapacity = 0;
+		size_t receiveStart = 0;
+		size_t receiveEnd = 0;
+
 		boost::asio::deadline_timer readTimer;
 		boost::asio::deadline_timer writeTimer;
 
 		std::recursive_mutex connectionLock;
 
 		std::list<OutputMessage_ptr> messageQueue;
+		// messages of the write in flight, a write is pending while either queue has messages
+		std::vector<OutputMessage_ptr> writeQueue;
+		std::vector<boost::asio::const_buffer> writeBuffers;
+		std::atomic<size_t> queuedBytes {0};
+		// queuedBytes of the messages in writeQueue, as counted by send()
+		size_t writeQueueBytes = 0;
 
 		ConstServicePort_ptr service_port;
 		Protocol_ptr protocol;
@@ -122,6 +168,8 @@ class Connection : public std::enable_shared_from_this<Connection>
 		std::underlying_type_t<ConnectionState_t> connectionState = CONNECTION_STATE_OPEN;
 		bool receivedFirst = false;
 
+		static ConnectionWriteStats writeStats;
+
 		friend class ServicePort;
 		friend class ConnectionManager;
 };
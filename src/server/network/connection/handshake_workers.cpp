@@ -0,0 +1,110 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+#include "server/network/connection/handshake_workers.hpp"
+#include "utils/thread_topology.hpp"
+
+HandshakeStats HandshakeWorkers::stats;
+
+void HandshakeWorkers::start()
+{
+	int32_t workerCount = g_configManager().getNumber(RSA_WORKERS);
+	if (workerCount <= 0) {
+		return;
+	}
+
+	maxQueueSize = static_cast<size_t>(std::max<int32_t>(1, g_configManager().getNumber(RSA_QUEUE_SIZE)));
+	running.store(true, std::memory_order_relaxed);
+	for (int32_t i = 0; i < workerCount; ++i) {
+		threads.emplace_back([this, i]() {
+			g_threadTopology().applyToCurrentThread(THREAD_ROLE_WORKER, i);
+			threadMain();
+		});
+	}
+}
+
+void HandshakeWorkers::threadMain()
+{
+	std::unique_lock<std::mutex> taskLockUnique(taskLock);
+	while (true) {
+		taskSignal.wait(taskLockUnique, [this]() {
+			return !tasks.empty() || !running.load(std::memory_order_relaxed);
+		});
+		if (tasks.empty()) {
+			// only reached once the workers are stopped
+			break;
+		}
+
+		HandshakeTask task = std::move(tasks.front());
+		tasks.pop_front();
+		taskLockUnique.unlock();
+
+		stats.waitMicros.fetch_add(DispatcherProfiler::getTimeMicros() - task.queuedTime, std::memory_order_relaxed);
+		stats.handled.fetch_add(1, std::memory_order_relaxed);
+		task.function();
+
+		taskLockUnique.lock();
+	}
+}
+
+bool HandshakeWorkers::addTask(std::function<void()> task)
+{
+	size_t queued;
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		if (!running.load(std::memory_order_relaxed) || tasks.size() >= maxQueueSize) {
+			stats.refused.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		tasks.push_back({std::move(task), DispatcherProfiler::getTimeMicros()});
+		queued = tasks.size();
+	}
+	taskSignal.notify_one();
+
+	uint64_t maxQueued = stats.maxQueued.load(std::memory_order_relaxed);
+	while (queued > maxQueued && !stats.maxQueued.compare_exchange_weak(maxQueued, queued, std::memory_order_relaxed)) {}
+	return true;
+}
+
+void HandshakeWorkers::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		running.store(false, std::memory_order_relaxed);
+		// the connections are closed on shutdown anyway
+		tasks.clear();
+	}
+	taskSignal.notify_all();
+}
+
+void HandshakeWorkers::join()
+{
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
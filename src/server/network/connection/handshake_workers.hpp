@@ -0,0 +1,98 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_NETWORK_CONNECTION_HANDSHAKE_WORKERS_HPP_
+#define SRC_SERVER_NETWORK_CONNECTION_HANDSHAKE_WORKERS_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct HandshakeStats {
+	std::atomic<uint64_t> handled {0};
+	std::atomic<uint64_t> refused {0};
+	std::atomic<uint64_t> waitMicros {0};
+	std::atomic<uint64_t> maxQueued {0};
+};
+
+/**
+ * Threads running the first message of each connection, the RSA decryption
+ * and account checks, away from the network threads of the live players.
+ * The queue is bounded: once rsaQueueSize first messages wait, new
+ * connections are closed instead of queued, so a connection flood cannot
+ * delay anything but other new connections.
+ */
+class HandshakeWorkers
+{
+	public:
+		HandshakeWorkers() = default;
+
+		// non-copyable
+		HandshakeWorkers(const HandshakeWorkers&) = delete;
+		HandshakeWorkers& operator=(const HandshakeWorkers&) = delete;
+
+		static HandshakeWorkers& getInstance() {
+			// Guaranteed to be destroyed
+			static HandshakeWorkers instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		static HandshakeStats& getStats() {
+			return stats;
+		}
+
+		// Reads rsaWorkers and rsaQueueSize, with 0 workers the first messages run on the network threads
+		void start();
+		void shutdown();
+		void join();
+
+		bool isRunning() const {
+			return running.load(std::memory_order_relaxed);
+		}
+
+		// returns false if the queue is full or the workers are not running
+		bool addTask(std::function<void()> task);
+
+	private:
+		struct HandshakeTask {
+			std::function<void()> function;
+			int64_t queuedTime;
+		};
+
+		void threadMain();
+
+		static HandshakeStats stats;
+
+		std::vector<std::thread> threads;
+		std::deque<HandshakeTask> tasks;
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+		size_t maxQueueSize = 0;
+		std::atomic<bool> running {false};
+};
+
+constexpr auto g_handshakeWorkers = &HandshakeWorkers::getInstance;
+
+#endif  // SRC_SERVER_NETWORK_CONNECTION_HANDSHAKE_WORKERS_HPP_
@@ -23,29 +23,34 @@
 #include "items/containers/container.h"
 #include "creatures/creature.h"
 
-int32_t NetworkMessage::decodeHeader()
+int32_t NetworkMessageBase::decodeHeader()
 {
 	int32_t newSize = buffer[0] | buffer[1] << 8;
 	info.length = newSize;
 	return info.length;
 }
 
-std::string NetworkMessage::getString(uint16_t stringLen/* = 0*/)
+std::string NetworkMessageBase::getString(uint16_t stringLen/* = 0*/)
+{
+	return std::string(getStringView(stringLen));
+}
+
+std::string_view NetworkMessageBase::getStringView(uint16_t stringLen/* = 0*/)
 {
 	if (stringLen == 0) {
 		stringLen = get<uint16_t>();
 	}
 
 	if (!canRead(stringLen)) {
-		return std::string();
+		return {};
 	}
 
-	char* v = reinterpret_cast<char*>(buffer) + info.position; //does not break strict aliasing
+	const char* v = reinterpret_cast<const char*>(buffer) + info.position; //does not break strict aliasing
 	info.position += stringLen;
-	return std::string(v, stringLen);
+	return std::string_view(v, stringLen);
 }
 
-Position NetworkMessage::getPosition()
+Position NetworkMessageBase::getPosition()
 {
 	Position pos;
 	pos.x = get<uint16_t>();
@@ -54,7 +59,7 @@ Position NetworkMessage::getPosition()
 	return pos;
 }
 
-void NetworkMessage::addString(const std::string& value)
+void NetworkMessageBase::addString(std::string_view value)
 {
 	size_t stringLen = value.length();
 	if (value.empty()) {
@@ -70,18 +75,39 @@ void NetworkMessage::addString(const std::string& value)
 	}
 
 	add<uint16_t>(stringLen);
-	memcpy(buffer + info.position, value.c_str(), stringLen);
+	memcpy(buffer + info.position, value.data(), stringLen);
+	info.position += stringLen;
+	info.length += stringLen;
+}
+
+void NetworkMessageBase::vaddFormattedString(fmt::string_view format, fmt::format_args args)
+{
+	// formats in place behind the length, a second pass is only needed when the buffer has to grow
+	size_t start = info.position + sizeof(uint16_t);
+	size_t available = capacity > start ? capacity - start : 0;
+	char* out = reinterpret_cast<char*>(buffer) + start;
+	size_t stringLen = fmt::vformat_to_n(out, available, format, args).size;
+	if (!canAdd(stringLen + sizeof(uint16_t))) {
+		SPDLOG_ERROR("[NetworkMessage::addFormattedString] - NetworkMessage size is wrong: {}", stringLen);
+		return;
+	}
+
+	if (stringLen > available) {
+		fmt::vformat_to(reinterpret_cast<char*>(buffer) + start, format, args);
+	}
+
+	add<uint16_t>(stringLen);
 	info.position += stringLen;
 	info.length += stringLen;
 }
 
-void NetworkMessage::addDouble(double value, uint8_t precision/* = 2*/)
+void NetworkMessageBase::addDouble(double value, uint8_t precision/* = 2*/)
 {
 	addByte(precision);
 	add<uint32_t>((value * std::pow(static_cast<float>(10), precision)) + std::numeric_limits<int32_t>::max());
 }
 
-void NetworkMessage::addBytes(const char* bytes, size_t size)
+void NetworkMessageBase::addBytes(const char* bytes, size_t size)
 {
 	if (bytes == nullptr) {
 		SPDLOG_ERROR("[NetworkMessage::addBytes] - Bytes is nullptr");
@@ -101,19 +127,18 @@ void NetworkMessage::addBytes(const char* bytes, size_t size)
 	info.length += size;
 }
 
-void NetworkMessage::addPaddingBytes(size_t n)
+void NetworkMessageBase::addPaddingBytes(size_t n)
 {
-	#define canAdd(size) ((size + info.position) < NETWORKMESSAGE_MAXSIZE)
-	if (!canAdd(n)) {
+	size_t end = n + info.position;
+	if (end >= NETWORKMESSAGE_MAXSIZE || !reserve(end)) {
 		return;
 	}
-	#undef canAdd
 
 	memset(buffer + info.position, 0x33, n);
 	info.length += n;
 }
 
-void NetworkMessage::addPosition(const Position& pos)
+void NetworkMessageBase::addPosition(const Position& pos)
 {
 	add<uint16_t>(pos.x);
 	add<uint16_t>(pos.y);
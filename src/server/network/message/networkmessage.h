@@ -29,7 +29,12 @@ class Player;
 struct Position;
 class RSA;
 
-class NetworkMessage
+/**
+ * Reading and writing of a message, on a buffer owned by the derived class:
+ * NetworkMessage carries a full sized one, OutputMessage a pooled one that
+ * grows on demand.
+ */
+class NetworkMessageBase
 {
 	public:
 		using MsgSize_t = uint16_t;
@@ -39,8 +44,6 @@ class NetworkMessage
 		// 2 bytes for encrypted message size
 		static constexpr MsgSize_t INITIAL_BUFFER_POSITION = 8;
 
-		NetworkMessage() = default;
-
 		void reset() {
 			info = {};
 		}
@@ -71,6 +74,9 @@ class NetworkMessage
 		}
 
 		std::string getString(uint16_t stringLen = 0);
+		// Same as getString without the copy, the view points into the buffer and is
+		// only valid until the message is reused. Copy it to keep it past the packet
+		std::string_view getStringView(uint16_t stringLen = 0);
 		Position getPosition();
 
 		// skips count unknown/unused bytes in an incoming message
@@ -100,9 +106,30 @@ class NetworkMessage
 		}
 
 		void addBytes(const char* bytes, size_t size);
+
+		/**
+		 * Room for size bytes the caller writes at once, already counted in the length.
+		 * One bounds check for all of them, see PacketSchema. nullptr if they do not fit.
+		 */
+		uint8_t* addFixed(size_t size) {
+			if (!canAdd(size)) {
+				return nullptr;
+			}
+
+			uint8_t* out = buffer + info.position;
+			info.position += size;
+			info.length += size;
+			return out;
+		}
 		void addPaddingBytes(size_t n);
 
-		void addString(const std::string& value);
+		void addString(std::string_view value);
+
+		// Writes the formatted text as a string, straight into the buffer
+		template <typename... Args>
+		void addFormattedString(fmt::format_string<Args...> format, Args&&... args) {
+			vaddFormattedString(format, fmt::make_format_args(args...));
+		}
 
 		void addDouble(double value, uint8_t precision = 2);
 
@@ -149,10 +176,29 @@ class NetworkMessage
 		}
 
 	protected:
-		bool canAdd(size_t size) const {
-			return (size + info.position) < MAX_BODY_LENGTH;
+		NetworkMessageBase(uint8_t* initBuffer, size_t initCapacity) : buffer(initBuffer), capacity(initCapacity) {}
+		~NetworkMessageBase() = default;
+
+		// copying is up to the owner of the buffer
+		NetworkMessageBase(const NetworkMessageBase&) = delete;
+		NetworkMessageBase& operator=(const NetworkMessageBase&) = delete;
+
+		// Makes room for the first size bytes of the buffer, only called when they do not fit
+		virtual bool growBuffer(size_t) {
+			return false;
+		}
+
+		bool reserve(size_t size) {
+			return size <= capacity || growBuffer(size);
 		}
 
+		bool canAdd(size_t size) {
+			size_t end = size + info.position;
+			return end < MAX_BODY_LENGTH && reserve(end);
+		}
+
+		void vaddFormattedString(fmt::string_view format, fmt::format_args args);
+
 		bool canRead(int32_t size) {
 			if ((info.position + size) > (info.length + 8) || size >= (NETWORKMESSAGE_MAXSIZE - info.position)) {
 				info.overrun = true;
@@ -168,7 +214,30 @@ class NetworkMessage
 		};
 
 		NetworkMessageInfo info;
-		uint8_t buffer[NETWORKMESSAGE_MAXSIZE];
+		uint8_t* buffer;
+		size_t capacity;
+};
+
+class NetworkMessage final : public NetworkMessageBase
+{
+	public:
+		NetworkMessage() : NetworkMessageBase(storage, NETWORKMESSAGE_MAXSIZE) {}
+
+		NetworkMessage(const NetworkMessage& other) : NetworkMessageBase(storage, NETWORKMESSAGE_MAXSIZE) {
+			info = other.info;
+			memcpy(storage, other.storage, sizeof(storage));
+		}
+
+		NetworkMessage& operator=(const NetworkMessage& other) {
+			if (this != &other) {
+				info = other.info;
+				memcpy(storage, other.storage, sizeof(storage));
+			}
+			return *this;
+		}
+
+	private:
+		uint8_t storage[NETWORKMESSAGE_MAXSIZE];
 };
 
 #endif // SRC_SERVER_NETWORK_MESSAGE_NETWORKMESSAGE_H_
@@ -23,10 +23,110 @@
 #include "server/network/protocol/protocol.h"
 #include "utils/lockfree.h"
 #include "game/scheduling/scheduler.h"
+#include "utils/memory_accounting.hpp"
 
 const uint16_t OUTPUTMESSAGE_FREE_LIST_CAPACITY = 2048;
 const std::chrono::milliseconds OUTPUTMESSAGE_AUTOSEND_DELAY {10};
 
+namespace {
+
+// Buffer size classes, each with its own free list. Most messages are a
+// ping or a handful of updates and never leave the small one.
+template <size_t SIZE, size_t CAPACITY>
+struct OutputBufferClass {
+	static constexpr size_t size = SIZE;
+
+	static uint8_t* acquire() {
+		void* p;
+		if (!LockfreeFreeList<SIZE, CAPACITY>::get().pop(p)) {
+			p = operator new(SIZE);
+		}
+		return static_cast<uint8_t*>(p);
+	}
+
+	static void release(uint8_t* buffer) {
+		if (!LockfreeFreeList<SIZE, CAPACITY>::get().bounded_push(buffer)) {
+			operator delete(buffer);
+		}
+	}
+};
+
+using SmallOutputBuffer = OutputBufferClass<1024, 2048>;
+using MediumOutputBuffer = OutputBufferClass<8192, 512>;
+using LargeOutputBuffer = OutputBufferClass<NETWORKMESSAGE_MAXSIZE, 128>;
+
+void releaseOutputBuffer(uint8_t* buffer, size_t capacity)
+{
+	if (capacity == SmallOutputBuffer::size) {
+		SmallOutputBuffer::release(buffer);
+	} else if (capacity == MediumOutputBuffer::size) {
+		MediumOutputBuffer::release(buffer);
+	} else {
+		LargeOutputBuffer::release(buffer);
+	}
+}
+
+}  // namespace
+
+// the buffer is counted with the message it belongs to
+OutputMessage::OutputMessage() : NetworkMessageBase(SmallOutputBuffer::acquire(), SmallOutputBuffer::size)
+{
+	MemoryAccounting::resize(MEMORY_TAG_OUTPUT_MESSAGE, static_cast<int64_t>(capacity));
+}
+
+OutputMessage::~OutputMessage()
+{
+	MemoryAccounting::resize(MEMORY_TAG_OUTPUT_MESSAGE, -static_cast<int64_t>(capacity));
+	releaseOutputBuffer(buffer, capacity);
+}
+
+void* OutputMessage::operator new(size_t)
+{
+	MemoryAccounting::allocate(MEMORY_TAG_OUTPUT_MESSAGE, sizeof(OutputMessage));
+	return LockfreePoolingAllocator<OutputMessage, OUTPUTMESSAGE_FREE_LIST_CAPACITY>().allocate(1);
+}
+
+void OutputMessage::operator delete(void* p)
+{
+	MemoryAccounting::deallocate(MEMORY_TAG_OUTPUT_MESSAGE, sizeof(OutputMessage));
+	LockfreePoolingAllocator<OutputMessage, OUTPUTMESSAGE_FREE_LIST_CAPACITY>().deallocate(static_cast<OutputMessage*>(p), 1);
+}
+
+bool OutputMessage::growBuffer(size_t size)
+{
+	uint8_t* newBuffer;
+	size_t newCapacity;
+	if (size <= MediumOutputBuffer::size) {
+		newBuffer = MediumOutputBuffer::acquire();
+		newCapacity = MediumOutputBuffer::size;
+	} else if (size <= LargeOutputBuffer::size) {
+		newBuffer = LargeOutputBuffer::acquire();
+		newCapacity = LargeOutputBuffer::size;
+	} else {
+		return false;
+	}
+
+	// headers are only written when the message is sent, the body ends at the write position
+	memcpy(newBuffer, buffer, info.position);
+	releaseOutputBuffer(buffer, capacity);
+	MemoryAccounting::resize(MEMORY_TAG_OUTPUT_MESSAGE, static_cast<int64_t>(newCapacity) - static_cast<int64_t>(capacity));
+	buffer = newBuffer;
+	capacity = newCapacity;
+	return true;
+}
+
+void intrusive_ptr_add_ref(OutputMessage* outputMessage)
+{
+	outputMessage->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void intrusive_ptr_release(OutputMessage* outputMessage)
+{
+	if (outputMessage->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete outputMessage;
+	}
+}
+
 void OutputMessagePool::scheduleSendAll()
 {
 	auto function = std::bind(&OutputMessagePool::sendAll, this);
@@ -36,40 +136,60 @@ void OutputMessagePool::scheduleSendAll()
 void OutputMessagePool::sendAll()
 {
 	//dispatcher thread
-	for (auto& protocol : bufferedProtocols) {
+	sendingProtocols.swap(dirtyProtocols);
+	for (auto& protocol : sendingProtocols) {
+		// still marked as queued, the deferred messages written here do not queue it again
+		protocol->flushDeferredMessages();
 		auto& msg = protocol->getCurrentBuffer();
 		if (msg) {
 			protocol->send(std::move(msg));
 		}
+		protocol->autosendQueued = false;
 	}
+	sendingProtocols.clear();
 
-	if (!bufferedProtocols.empty()) {
+	if (!dirtyProtocols.empty()) {
 		scheduleSendAll();
+	} else {
+		sendAllScheduled = false;
 	}
 }
 
 void OutputMessagePool::addProtocolToAutosend(Protocol_ptr protocol)
 {
 	//dispatcher thread
-	if (bufferedProtocols.empty()) {
-		scheduleSendAll();
-	}
-	bufferedProtocols.emplace_back(protocol);
+	protocol->autosendEnabled = true;
+	// output written before the protocol was registered goes out with the next round
+	protocol->queueAutosend();
 }
 
 void OutputMessagePool::removeProtocolFromAutosend(const Protocol_ptr& protocol)
 {
 	//dispatcher thread
-	auto it = std::find(bufferedProtocols.begin(), bufferedProtocols.end(), protocol);
-	if (it != bufferedProtocols.end()) {
-		*it = bufferedProtocols.back();
-		bufferedProtocols.pop_back();
+	protocol->autosendEnabled = false;
+	if (!protocol->autosendQueued) {
+		return;
+	}
+
+	auto it = std::find(dirtyProtocols.begin(), dirtyProtocols.end(), protocol);
+	if (it != dirtyProtocols.end()) {
+		*it = dirtyProtocols.back();
+		dirtyProtocols.pop_back();
+		protocol->autosendQueued = false;
+	}
+}
+
+void OutputMessagePool::queueProtocol(Protocol_ptr protocol)
+{
+	//dispatcher thread
+	dirtyProtocols.emplace_back(std::move(protocol));
+	if (!sendAllScheduled) {
+		sendAllScheduled = true;
+		scheduleSendAll();
 	}
 }
 
 OutputMessage_ptr OutputMessagePool::getOutputMessage()
 {
-	// LockfreePoolingAllocator<void,...> will leave (void* allocate) ill-formed because
-	// of sizeof(T), so this guaranatees that only one list will be initialized
-	return std::allocate_shared<OutputMessage>(LockfreePoolingAllocator<void, OUTPUTMESSAGE_FREE_LIST_CAPACITY>());
+	return OutputMessage_ptr(new OutputMessage());
 }
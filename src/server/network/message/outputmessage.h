@@ -26,15 +26,25 @@
 
 class Protocol;
 
-class OutputMessage : public NetworkMessage
+/**
+ * Messages start on a small pooled buffer and move to the next size class
+ * when a write does not fit, so pings and stat updates do not pin a full
+ * NETWORKMESSAGE_MAXSIZE block while they wait in the send queues.
+ * The reference count is intrusive, see OutputMessage_ptr.
+ */
+class OutputMessage final : public NetworkMessageBase
 {
 	public:
-		OutputMessage() = default;
+		OutputMessage();
+		~OutputMessage();
 
 		// non-copyable
 		OutputMessage(const OutputMessage&) = delete;
 		OutputMessage& operator=(const OutputMessage&) = delete;
 
+		static void* operator new(size_t size);
+		static void operator delete(void* p);
+
 		uint8_t* getOutputBuffer() {
 			return buffer + outputBufferStart;
 		}
@@ -53,6 +63,9 @@ class OutputMessage : public NetworkMessage
 
 		void append(const NetworkMessage& msg) {
 			auto msgLen = msg.getLength();
+			if (!reserve(info.position + msgLen)) {
+				return;
+			}
 			memcpy(buffer + info.position, msg.getBuffer() + INITIAL_BUFFER_POSITION, msgLen);
 			info.length += msgLen;
 			info.position += msgLen;
@@ -60,12 +73,20 @@ class OutputMessage : public NetworkMessage
 
 		void append(const OutputMessage_ptr& msg) {
 			auto msgLen = msg->getLength();
+			if (!reserve(info.position + msgLen)) {
+				return;
+			}
 			memcpy(buffer + info.position, msg->getBuffer() + INITIAL_BUFFER_POSITION, msgLen);
 			info.length += msgLen;
 			info.position += msgLen;
 		}
 
 	private:
+		friend void intrusive_ptr_add_ref(OutputMessage* outputMessage);
+		friend void intrusive_ptr_release(OutputMessage* outputMessage);
+
+		bool growBuffer(size_t size) override;
+
 		template <typename T>
 		void add_header(T addHeader) {
 			assert(outputBufferStart >= sizeof(T));
@@ -76,6 +97,7 @@ class OutputMessage : public NetworkMessage
 		}
 
 		MsgSize_t outputBufferStart = INITIAL_BUFFER_POSITION;
+		std::atomic<uint32_t> references {0};
 };
 
 class OutputMessagePool
@@ -97,11 +119,16 @@ class OutputMessagePool
 
 		void addProtocolToAutosend(Protocol_ptr protocol);
 		void removeProtocolFromAutosend(const Protocol_ptr& protocol);
+		// the protocol has output waiting, see Protocol::queueAutosend
+		void queueProtocol(Protocol_ptr protocol);
 	private:
 		OutputMessagePool() = default;
-		//NOTE: A vector is used here because this container is mostly read
-		//and relatively rarely modified (only when a client connects/disconnects)
-		std::vector<Protocol_ptr> bufferedProtocols;
+		// Protocols with something to send since the last sendAll, each at most once.
+		// Idle clients are never visited and the timer only runs while this is not empty
+		std::vector<Protocol_ptr> dirtyProtocols;
+		// the list being flushed, kept to reuse its storage
+		std::vector<Protocol_ptr> sendingProtocols;
+		bool sendAllScheduled = false;
 };
 
 
@@ -0,0 +1,63 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_NETWORK_PROTOCOL_GAME_PACKETS_HPP_
+#define SRC_SERVER_NETWORK_PROTOCOL_GAME_PACKETS_HPP_
+
+#include "server/network/message/packet_schema.hpp"
+
+// The most frequent game packets with fixed fields, see PacketSchema
+
+// old position, old stack position, new position
+using PacketCreatureMove = PacketSchema<0x6D, Position, uint8_t, Position>;
+// position, stack position
+using PacketRemoveTileThing = PacketSchema<0x6C, Position, uint8_t>;
+// position, the tile description follows
+using PacketUpdateTile = PacketSchema<0x69, Position>;
+// position, stack position, 0x63, creature id, direction, unpassable
+using PacketCreatureTurn = PacketSchema<0x6B, Position, uint8_t, uint16_t, uint32_t, uint8_t, uint8_t>;
+// creature id, health percent
+using PacketCreatureHealth = PacketSchema<0x8C, uint32_t, uint8_t>;
+// creature id, unpassable
+using PacketCreatureWalkthrough = PacketSchema<0x92, uint32_t, uint8_t>;
+// creature id, 0x01, color
+using PacketCreatureSquare = PacketSchema<0x93, uint32_t, uint8_t, uint8_t>;
+// position, MAGIC_EFFECTS_CREATE_EFFECT, effect, MAGIC_EFFECTS_END_LOOP
+using PacketMagicEffect = PacketSchema<0x83, Position, uint8_t, uint8_t, uint8_t>;
+// from, MAGIC_EFFECTS_CREATE_DISTANCEEFFECT, effect, x and y offsets to the target, MAGIC_EFFECTS_END_LOOP
+using PacketDistanceShoot = PacketSchema<0x83, Position, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t>;
+/**
+ * health, max health, free capacity, experience, level, level percent,
+ * base, low level, store and stamina xp rates, mana, max mana, soul, stamina minutes,
+ * base speed, regeneration seconds, offline training minutes,
+ * xp boost seconds, xp boost in store, mana shield, max mana shield
+ */
+using PacketPlayerStats = PacketSchema<0xA0,
+	uint16_t, uint16_t, uint32_t, uint64_t, uint16_t, uint8_t,
+	uint16_t, uint16_t, uint16_t, uint16_t, uint16_t, uint16_t, uint8_t, uint16_t,
+	uint16_t, uint16_t, uint16_t,
+	uint16_t, uint8_t, uint16_t, uint16_t>;
+
+static_assert(PacketCreatureMove::size == 12);
+static_assert(PacketCreatureHealth::size == 6);
+static_assert(PacketMagicEffect::size == 9);
+static_assert(PacketPlayerStats::size == 48);
+
+#endif  // SRC_SERVER_NETWORK_PROTOCOL_GAME_PACKETS_HPP_
@@ -0,0 +1,154 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_NETWORK_PROTOCOL_KNOWN_CREATURES_HPP_
+#define SRC_SERVER_NETWORK_PROTOCOL_KNOWN_CREATURES_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * The creature ids a client holds, ordered by when each was last sent.
+ * The nodes form an intrusive doubly linked list over a fixed pool, so
+ * touching, inserting and evicting the least recently sent id never scan.
+ */
+class KnownCreatures
+{
+	public:
+		// the client keeps this many creatures, see checkCreatureAsKnown
+		static constexpr size_t CAPACITY = 1300;
+
+		bool contains(uint32_t id) const {
+			return index.find(id) != index.end();
+		}
+
+		size_t size() const {
+			return index.size();
+		}
+
+		// marks a known id as just sent, returns false if it is not known
+		bool touch(uint32_t id) {
+			auto it = index.find(id);
+			if (it == index.end()) {
+				return false;
+			}
+			unlink(it->second);
+			pushFront(it->second);
+			return true;
+		}
+
+		// adds an unknown id as the most recent one, the caller makes room first
+		void insert(uint32_t id) {
+			uint16_t node;
+			if (!freeNodes.empty()) {
+				node = freeNodes.back();
+				freeNodes.pop_back();
+			} else {
+				node = static_cast<uint16_t>(nodes.size());
+				nodes.emplace_back();
+			}
+			nodes[node].id = id;
+			index.emplace(id, node);
+			pushFront(node);
+		}
+
+		void erase(uint32_t id) {
+			auto it = index.find(id);
+			if (it != index.end()) {
+				removeNode(it->second);
+			}
+		}
+
+		/**
+		 * Forgets and returns the least recently sent id for which keep(id) is false.
+		 * Kept ids count as sent now; if every id is kept the oldest goes anyway.
+		 */
+		template <typename Keep>
+		uint32_t evict(Keep&& keep) {
+			for (size_t checked = 0, count = index.size(); checked < count; ++checked) {
+				uint16_t node = tail;
+				uint32_t id = nodes[node].id;
+				if (!keep(id)) {
+					removeNode(node);
+					return id;
+				}
+				unlink(node);
+				pushFront(node);
+			}
+
+			uint32_t id = nodes[tail].id;
+			removeNode(tail);
+			return id;
+		}
+
+	private:
+		static constexpr uint16_t NONE = 0xFFFF;
+
+		struct Node {
+			uint32_t id = 0;
+			uint16_t prev = NONE;
+			uint16_t next = NONE;
+		};
+
+		void unlink(uint16_t node) {
+			Node& n = nodes[node];
+			if (n.prev != NONE) {
+				nodes[n.prev].next = n.next;
+			} else {
+				head = n.next;
+			}
+			if (n.next != NONE) {
+				nodes[n.next].prev = n.prev;
+			} else {
+				tail = n.prev;
+			}
+			n.prev = n.next = NONE;
+		}
+
+		void pushFront(uint16_t node) {
+			Node& n = nodes[node];
+			n.prev = NONE;
+			n.next = head;
+			if (head != NONE) {
+				nodes[head].prev = node;
+			}
+			head = node;
+			if (tail == NONE) {
+				tail = node;
+			}
+		}
+
+		void removeNode(uint16_t node) {
+			unlink(node);
+			index.erase(nodes[node].id);
+			freeNodes.push_back(node);
+		}
+
+		std::vector<Node> nodes;
+		std::vector<uint16_t> freeNodes;
+		phmap::flat_hash_map<uint32_t, uint16_t> index;
+		// most and least recently sent
+		uint16_t head = NONE;
+		uint16_t tail = NONE;
+};
+
+#endif  // SRC_SERVER_NETWORK_PROTOCOL_KNOWN_CREATURES_HPP_
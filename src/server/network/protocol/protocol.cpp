@@ -23,6 +23,23 @@
 #include "server/network/message/outputmessage.h"
 #include "security/rsa.h"
 #include "game/scheduling/tasks.h"
+#include "server/metrics/metrics.hpp"
+#include "utils/log_rate_limiter.hpp"
+
+CompressionStats Protocol::compressionStats;
+
+namespace {
+
+MetricCounter& compressionBytesIn = g_metrics().getCounter("canary_compression_input_bytes_total", "Bytes of the messages given to deflate");
+MetricCounter& compressionBytesOut = g_metrics().getCounter("canary_compression_output_bytes_total", "Bytes sent for the messages given to deflate, plain size when deflating did not make them smaller");
+
+}  // namespace
+
+ProtocolMetrics::ProtocolMetrics(const std::string& protocol) :
+	bytesReceived(g_metrics().getCounter("canary_network_received_bytes_total", "Bytes read from the clients", fmt::format("protocol=\"{}\"", protocol))),
+	bytesSent(g_metrics().getCounter("canary_network_sent_bytes_total", "Bytes written to the clients", fmt::format("protocol=\"{}\"", protocol))),
+	messagesReceived(g_metrics().getCounter("canary_network_received_messages_total", "Messages read from the clients", fmt::format("protocol=\"{}\"", protocol))),
+	messagesSent(g_metrics().getCounter("canary_network_sent_messages_total", "Messages written to the clients", fmt::format("protocol=\"{}\"", protocol))) {}
 
 Protocol::~Protocol() = default;
 
@@ -30,7 +47,7 @@ void Protocol::onSendMessage(const OutputMessage_ptr& msg)
 {
 	if (!rawMessages) {
 		uint32_t sendMessageChecksum = 0;
-		if (compreesionEnabled && msg->getLength() >= 128 && compression(*msg)) {
+		if (compreesionEnabled && msg->getLength() >= COMPRESSION_MIN_SIZE && compression(*msg)) {
 			sendMessageChecksum = (1U << 31);
 		}
 
@@ -57,7 +74,7 @@ void Protocol::onSendMessage(const OutputMessage_ptr& msg)
 bool Protocol::sendRecvMessageCallback(NetworkMessage& msg)
 {
 	if (encryptionEnabled && !XTEA_decrypt(msg)) {
-		SPDLOG_ERROR("[Protocol::onRecvMessage] - XTEA_decrypt Failed");
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[Protocol::onRecvMessage] - XTEA_decrypt Failed");
 		return false;
 	}
 
@@ -120,6 +137,7 @@ OutputMessage_ptr Protocol::getOutputBuffer(int32_t size)
 	//dispatcher thread
 	if (!outputBuffer) {
 		outputBuffer = OutputMessagePool::getOutputMessage();
+		queueAutosend();
 	} else if ((outputBuffer->getLength() + size) > MAX_PROTOCOL_BODY_LENGTH) {
 		send(outputBuffer);
 		outputBuffer = OutputMessagePool::getOutputMessage();
@@ -127,38 +145,24 @@ OutputMessage_ptr Protocol::getOutputBuffer(int32_t size)
 	return outputBuffer;
 }
 
-void Protocol::XTEA_encrypt(OutputMessage& msg) const
+void Protocol::queueAutosend()
 {
-	const uint32_t delta = 0x61C88647;
+	//dispatcher thread
+	if (autosendEnabled && !autosendQueued) {
+		autosendQueued = true;
+		OutputMessagePool::getInstance().queueProtocol(shared_from_this());
+	}
+}
 
+void Protocol::XTEA_encrypt(OutputMessage& msg) const
+{
 	// The message must be a multiple of 8
 	size_t paddingBytes = msg.getLength() & 7;
 	if (paddingBytes != 0) {
 		msg.addPaddingBytes(8 - paddingBytes);
 	}
 
-	uint8_t* buffer = msg.getOutputBuffer();
-	auto messageLength = static_cast<int32_t>(msg.getLength());
-	int32_t readPos = 0;
-	const std::array<uint32_t, 4> newKey = {key[0], key[1], key[2], key[3]};
-	// TODO: refactor this for not use c-style
-	uint32_t precachedControlSum[32][2];
-	uint32_t sum = 0;
-	for (int32_t i = 0; i < 32; ++i) {
-		precachedControlSum[i][0] = (sum + newKey[sum & 3]);
-		sum -= delta;
-		precachedControlSum[i][1] = (sum + newKey[(sum >> 11) & 3]);
-	}
-	while (readPos < messageLength) {
-		std::array<uint32_t, 2> vData = {};
-		memcpy(vData.data(), buffer + readPos, 8);
-		for (int32_t i = 0; i < 32; ++i) {
-			vData[0] += ((vData[1] << 4 ^ vData[1] >> 5) + vData[1]) ^ precachedControlSum[i][0];
-			vData[1] += ((vData[0] << 4 ^ vData[0] >> 5) + vData[0]) ^ precachedControlSum[i][1];
-		}
-		memcpy(buffer + readPos, vData.data(), 8);
-		readPos += 8;
-	}
+	xtea::encrypt(msg.getOutputBuffer(), msg.getLength(), encryptKeys);
 }
 
 bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
@@ -168,30 +172,7 @@ bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
 		return false;
 	}
 
-	const uint32_t delta = 0x61C88647;
-
-	uint8_t* buffer = msg.getBuffer() + msg.getBufferPosition();
-	auto messageLength = static_cast<int32_t>(msgLength);
-	int32_t readPos = 0;
-	const std::array<uint32_t, 4> newKey = {key[0], key[1], key[2], key[3]};
-	// TODO: refactor this for not use c-style
-	uint32_t precachedControlSum[32][2];
-	uint32_t sum = 0xC6EF3720;
-	for (int32_t i = 0; i < 32; ++i) {
-		precachedControlSum[i][0] = (sum + newKey[(sum >> 11) & 3]);
-		sum += delta;
-		precachedControlSum[i][1] = (sum + newKey[sum & 3]);
-	}
-	while (readPos < messageLength) {
-		std::array<uint32_t, 2> vData = {};
-		memcpy(vData.data(), buffer + readPos, 8);
-		for (int32_t i = 0; i < 32; ++i) {
-			vData[1] -= ((vData[0] << 4 ^ vData[0] >> 5) + vData[0]) ^ precachedControlSum[i][0];
-			vData[0] -= ((vData[1] << 4 ^ vData[1] >> 5) + vData[1]) ^ precachedControlSum[i][1];
-		}
-		memcpy(buffer + readPos, vData.data(), 8);
-		readPos += 8;
-	}
+	xtea::decrypt(msg.getBuffer() + msg.getBufferPosition(), msgLength, decryptKeys);
 
 	uint16_t innerLength = msg.get<uint16_t>();
 	if (innerLength > msgLength - 2) {
@@ -223,6 +204,19 @@ uint32_t Protocol::getIP() const
 	return 0;
 }
 
+bool Protocol::isOutputCongested() const
+{
+	auto degradeBytes = static_cast<size_t>(g_configManager().getNumber(OUTPUT_QUEUE_DEGRADE_BYTES));
+	if (degradeBytes == 0) {
+		return false;
+	}
+
+	if (auto protocolConnection = getConnection()) {
+		return protocolConnection->getQueuedBytes() > degradeBytes;
+	}
+	return false;
+}
+
 void Protocol::enableCompression()
 {
 	if (!compreesionEnabled) {
@@ -237,12 +231,30 @@ void Protocol::enableCompression()
 				SPDLOG_ERROR("[Protocol::enableCompression()] - Zlib deflateInit2 error: {}", (defStream->msg ? defStream->msg : " unknown error"));
 			} else {
 				compreesionEnabled = true;
+				adaptiveCompression = g_configManager().getBoolean(ADAPTIVE_COMPRESSION);
 			}
 		}
 	}
 }
 
-bool Protocol::compression(OutputMessage& msg) const
+double Protocol::getCompressionRatio()
+{
+	uint64_t bytesIn = compressionBytesIn.get();
+	return bytesIn != 0 ? static_cast<double>(compressionBytesOut.get()) / bytesIn : 0.;
+}
+
+ProtocolMetrics& Protocol::getMetrics()
+{
+	if (!metrics) {
+		static std::mutex metricsLock;
+		static phmap::node_hash_map<std::string, ProtocolMetrics> protocolMetrics;
+		std::lock_guard<std::mutex> lockClass(metricsLock);
+		metrics = &protocolMetrics.try_emplace(getMetricsName(), getMetricsName()).first->second;
+	}
+	return *metrics;
+}
+
+bool Protocol::compression(OutputMessage& msg)
 {
 	auto outputMessageSize = msg.getLength();
 	if (outputMessageSize > NETWORKMESSAGE_MAXSIZE) {
@@ -250,6 +262,13 @@ bool Protocol::compression(OutputMessage& msg) const
 		return false;
 	}
 
+	if (compressionBackoff > 0) {
+		--compressionBackoff;
+		compressionStats.skipped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
 	static thread_local std::array<char, NETWORKMESSAGE_MAXSIZE> defBuffer;
 	defStream->next_in = msg.getOutputBuffer();
 	defStream->avail_in = outputMessageSize;
@@ -259,14 +278,35 @@ bool Protocol::compression(OutputMessage& msg) const
 	if (int32_t ret = deflate(defStream.get(), Z_FINISH);
 	ret != Z_OK && ret != Z_STREAM_END)
 	{
+		deflateReset(defStream.get());
 		return false;
 	}
 	auto totalSize = static_cast<uint32_t>(defStream->total_out);
 	deflateReset(defStream.get());
-	if (totalSize == 0) {
+
+	compressionStats.micros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+	compressionStats.bytesIn.fetch_add(outputMessageSize, std::memory_order_relaxed);
+	compressionBytesIn.add(outputMessageSize);
+
+	if (adaptiveCompression) {
+		double ratio = static_cast<double>(totalSize) / outputMessageSize;
+		compressionRatio = compressionRatio == 0 ? ratio : compressionRatio + (ratio - compressionRatio) / 8;
+		if (compressionRatio > COMPRESSION_MAX_RATIO) {
+			compressionBackoff = COMPRESSION_BACKOFF_MESSAGES;
+		}
+	}
+
+	if (totalSize == 0 || totalSize >= outputMessageSize) {
+		compressionStats.discarded.fetch_add(1, std::memory_order_relaxed);
+		compressionStats.bytesOut.fetch_add(outputMessageSize, std::memory_order_relaxed);
+		compressionBytesOut.add(outputMessageSize);
 		return false;
 	}
 
+	compressionStats.compressed.fetch_add(1, std::memory_order_relaxed);
+	compressionStats.bytesOut.fetch_add(totalSize, std::memory_order_relaxed);
+	compressionBytesOut.add(totalSize);
+
 	msg.reset();
 	auto charData = static_cast<char*>(static_cast<void*>(defBuffer.data()));
 	msg.addBytes(charData, static_cast<size_t>(totalSize));
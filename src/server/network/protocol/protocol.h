@@ -22,6 +22,47 @@
 
 #include "server/network/connection/connection.h"
 #include "config/configmanager.h"
+#include "security/xtea.hpp"
+
+class MetricCounter;
+
+// Counters of every compressed message since the last report, shared by all connections
+struct CompressionStats {
+	std::atomic<uint64_t> compressed {0};
+	// deflated but sent plain because the result was not smaller
+	std::atomic<uint64_t> discarded {0};
+	// sent plain without trying, adaptive compression backed off
+	std::atomic<uint64_t> skipped {0};
+	std::atomic<uint64_t> bytesIn {0};
+	std::atomic<uint64_t> bytesOut {0};
+	std::atomic<uint64_t> micros {0};
+
+	void reset() {
+		compressed.store(0, std::memory_order_relaxed);
+		discarded.store(0, std::memory_order_relaxed);
+		skipped.store(0, std::memory_order_relaxed);
+		bytesIn.store(0, std::memory_order_relaxed);
+		bytesOut.store(0, std::memory_order_relaxed);
+		micros.store(0, std::memory_order_relaxed);
+	}
+};
+
+// Traffic counters of one protocol, exported with a protocol label
+struct ProtocolMetrics {
+	explicit ProtocolMetrics(const std::string& protocol);
+
+	MetricCounter& bytesReceived;
+	MetricCounter& bytesSent;
+	MetricCounter& messagesReceived;
+	MetricCounter& messagesSent;
+};
+
+// smallest message worth compressing
+static constexpr uint32_t COMPRESSION_MIN_SIZE = 128;
+// adaptive compression backs off while the average compressed size is above this fraction of the input
+static constexpr double COMPRESSION_MAX_RATIO = 0.9;
+// messages sent plain before the next compression attempt once it backed off
+static constexpr uint32_t COMPRESSION_BACKOFF_MESSAGES = 32;
 
 class Protocol : public std::enable_shared_from_this<Protocol>
 {
@@ -35,6 +76,8 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 		virtual void parsePacket(NetworkMessage&) {}
 
+		// Compresses, encrypts and writes the headers of a queued message.
+		// Runs on the network thread of the connection (Connection::internalSend), never on the dispatcher
 		virtual void onSendMessage(const OutputMessage_ptr& msg);
 		bool onRecvMessage(NetworkMessage& msg);
 		bool sendRecvMessageCallback(NetworkMessage& msg);
@@ -51,13 +94,32 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 		uint32_t getIP() const;
 
+		// more than outputQueueDegradeBytes wait to be written, optional packets should be left out
+		bool isOutputCongested() const;
+
+		static CompressionStats& getCompressionStats() {
+			return compressionStats;
+		}
+		// bytes sent for every message given to deflate over the bytes given, since startup
+		static double getCompressionRatio();
+
+		// label of the protocol in the metrics, "game", "login"...
+		virtual const char* getMetricsName() const = 0;
+		// network thread of the connection
+		ProtocolMetrics& getMetrics();
+
 		//Use this function for autosend messages only
 		OutputMessage_ptr getOutputBuffer(int32_t size);
+		// Writes updates held back for merging, called before the autosend buffer goes out
+		virtual void flushDeferredMessages() {}
 
 		OutputMessage_ptr& getCurrentBuffer() {
 			return outputBuffer;
 		}
 
+		// Puts the protocol on the autosend list, for output held outside of the current buffer
+		void queueAutosend();
+
 		void send(OutputMessage_ptr msg) const {
 			if (auto connection = getConnection();
 			connection != nullptr) {
@@ -76,7 +138,10 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 			encryptionEnabled = true;
 		}
 		void setXTEAKey(const uint32_t* newKey) {
-			memcpy(this->key.data(), newKey, sizeof(*newKey) * 4);
+			xtea::Key key;
+			memcpy(key.data(), newKey, sizeof(*newKey) * 4);
+			encryptKeys = xtea::expandEncryptKey(key);
+			decryptKeys = xtea::expandDecryptKey(key);
 		}
 		void setChecksumMethod(ChecksumMethods_t method) {
 			checksumMethod = method;
@@ -92,22 +157,38 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 		virtual void release() {}
 
 	private:
+		friend class OutputMessagePool;
+
 		void XTEA_encrypt(OutputMessage& msg) const;
 		bool XTEA_decrypt(NetworkMessage& msg) const;
-		bool compression(OutputMessage& msg) const;
+		// Deflates msg in place, false if it is to be sent as it is
+		bool compression(OutputMessage& msg);
 
 
 		OutputMessage_ptr outputBuffer;
 		std::unique_ptr<z_stream> defStream;
 
 		const ConnectionWeak_ptr connectionPtr;
-		std::array<uint32_t, 4> key = {};
+		xtea::RoundKeys encryptKeys = {};
+		xtea::RoundKeys decryptKeys = {};
 		uint32_t serverSequenceNumber = 0;
 		uint32_t clientSequenceNumber = 0;
 		std::underlying_type_t<ChecksumMethods_t> checksumMethod = CHECKSUM_METHOD_NONE;
 		bool encryptionEnabled = false;
 		bool rawMessages = false;
+		// registered with OutputMessagePool::addProtocolToAutosend
+		bool autosendEnabled = false;
+		// on the dirty list of the pool until the next sendAll
+		bool autosendQueued = false;
 		bool compreesionEnabled = false;
+		bool adaptiveCompression = false;
+		// running average of compressed size / input size, adaptive mode only
+		double compressionRatio = 0;
+		uint32_t compressionBackoff = 0;
+
+		ProtocolMetrics* metrics = nullptr;
+
+		static CompressionStats compressionStats;
 
 		friend class Connection;
 };
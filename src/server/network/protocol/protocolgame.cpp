@@ -31,11 +31,43 @@
 #include "server/network/message/outputmessage.h"
 #include "creatures/players/player.h"
 #include "creatures/players/grouping/familiars.h"
+#include "server/network/protocol/game_packets.hpp"
 #include "server/network/protocol/protocolgame.h"
+#include "server/network/protocol/session_resume.hpp"
+#include "game/scheduling/input_trace.hpp"
 #include "game/scheduling/scheduler.h"
 #include "creatures/combat/spells.h"
 #include "creatures/players/management/waitlist.h"
 #include "items/weapons/weapons.h"
+#include "utils/log_rate_limiter.hpp"
+
+namespace {
+
+// characters whose rows are being fetched for a login, dispatcher thread only
+std::unordered_set<uint32_t> loadingPlayers;
+
+// a teleport scrolls the map instead of sending it whole while the uncovered rows and columns stay below half the viewport
+constexpr int32_t MAP_SCROLL_MAX_TILES = 18 * 14 / 2;
+
+bool canScrollMap(const Position &oldPos, const Position &newPos)
+{
+	if (oldPos.z != newPos.z)
+	{
+		return false;
+	}
+
+	// the destination has to be a tile the client already shows, or the scrolled edges
+	// would describe the player on it before it is added again
+	const int32_t dx = static_cast<int32_t>(newPos.x) - oldPos.x;
+	const int32_t dy = static_cast<int32_t>(newPos.y) - oldPos.y;
+	if (dx < -8 || dx > 9 || dy < -6 || dy > 7)
+	{
+		return false;
+	}
+	return std::abs(dx) * 14 + std::abs(dy) * 18 <= MAP_SCROLL_MAX_TILES;
+}
+
+}  // namespace
 
 template <typename Callable, typename... Args>
 void ProtocolGame::addGameTask(Callable function, Args &&... args)
@@ -236,8 +268,13 @@ void ProtocolGame::AddItem(NetworkMessage &msg, const Item *item)
 void ProtocolGame::release()
 {
 	//dispatcher thread
+	if (g_inputTrace().isRecording()) {
+		g_inputTrace().recordDisconnect(*this);
+	}
+
 	if (player && player->client == shared_from_this())
 	{
+		g_sessionResume().disconnected(player->getGUID());
 		player->client.reset();
 		player->decrementReferenceCounter();
 		player = nullptr;
@@ -247,9 +284,13 @@ void ProtocolGame::release()
 	Protocol::release();
 }
 
-void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingSystem_t operatingSystem)
+void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingSystem_t operatingSystem, bool resumed)
 {
 	//dispatcher thread
+	if (g_inputTrace().isRecording()) {
+		g_inputTrace().recordLogin(*this, name, accountId, operatingSystem);
+	}
+
 	Player *foundPlayer = g_game().getPlayerByName(name);
 	if (!foundPlayer || g_configManager().getBoolean(ALLOW_CLONES))
 	{
@@ -340,30 +381,15 @@ void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingS
 			return;
 		}
 
-		if (!IOLoginData::loadPlayerById(player, player->getGUID()))
-		{
-			disconnectClient("Your character could not be loaded.");
-			SPDLOG_WARN("Player {} could not be loaded", player->getName());
-			return;
-		}
-
-		player->setOperatingSystem(operatingSystem);
-
-		if (!g_game().placeCreature(player, player->getLoginPosition()) && !g_game().placeCreature(player, player->getTemplePosition(), false, true))
+		uint32_t guid = player->getGUID();
+		if (!loadingPlayers.insert(guid).second && !g_configManager().getBoolean(ALLOW_CLONES))
 		{
-			disconnectClient("Temple position is wrong. Please, contact the administrator.");
-			SPDLOG_WARN("Player {} temple position is wrong", player->getName());
+			disconnectClient("You are already logged in.");
 			return;
 		}
 
-		if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX)
-		{
-			player->registerCreatureEvent("ExtendedOpcode");
-		}
-
-		player->lastIP = player->getIP();
-		player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
-		acceptPackets = true;
+		IOLoginData::loadPlayerAsync(guid, std::bind(&ProtocolGame::onPlayerLoaded, getThis(), std::placeholders::_1, guid, operatingSystem));
+		return;
 	}
 	else
 	{
@@ -374,7 +400,17 @@ void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingS
 			return;
 		}
 
-		if (foundPlayer->client)
+		if (foundPlayer->client && resumed)
+		{
+			// the old connection is dead or about to be, take the player over now
+			ProtocolGame_ptr oldClient = foundPlayer->client;
+			foundPlayer->disconnect();
+			oldClient->player = nullptr;
+			foundPlayer->client.reset();
+			foundPlayer->decrementReferenceCounter();
+			connect(foundPlayer->getID(), operatingSystem);
+		}
+		else if (foundPlayer->client)
 		{
 			foundPlayer->disconnect();
 			foundPlayer->isConnecting = true;
@@ -389,6 +425,51 @@ void ProtocolGame::login(const std::string &name, uint32_t accountId, OperatingS
 	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
 }
 
+void ProtocolGame::onPlayerLoaded(PlayerLoadContext &context, uint32_t guid, OperatingSystem_t operatingSystem)
+{
+	//dispatcher thread
+	loadingPlayers.erase(guid);
+	if (!player || player->getGUID() != guid)
+	{
+		// the client left while the character was fetched
+		return;
+	}
+
+	if (!IOLoginData::loadPlayer(player, context))
+	{
+		disconnectClient("Your character could not be loaded.");
+		SPDLOG_WARN("Player {} could not be loaded", player->getName());
+		return;
+	}
+
+	// other logins went on while the rows were fetched
+	if (g_configManager().getBoolean(ONE_PLAYER_ON_ACCOUNT) && player->getAccountType() < account::ACCOUNT_TYPE_GAMEMASTER && g_game().getPlayerByAccount(player->getAccount()))
+	{
+		disconnectClient("You may only login with one character\nof your account at the same time.");
+		return;
+	}
+
+	player->setOperatingSystem(operatingSystem);
+
+	if (!g_game().placeCreature(player, player->getLoginPosition()) && !g_game().placeCreature(player, player->getTemplePosition(), false, true))
+	{
+		disconnectClient("Temple position is wrong. Please, contact the administrator.");
+		SPDLOG_WARN("Player {} temple position is wrong", player->getName());
+		return;
+	}
+
+	if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX)
+	{
+		player->registerCreatureEvent("ExtendedOpcode");
+	}
+
+	player->lastIP = player->getIP();
+	player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
+	g_sessionResume().issue(sessionToken, guid, player->getAccount(), getIP());
+	acceptPackets = true;
+	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
+}
+
 void ProtocolGame::connect(uint32_t playerId, OperatingSystem_t operatingSystem)
 {
 	eventConnect = 0;
@@ -421,6 +502,7 @@ void ProtocolGame::connect(uint32_t playerId, OperatingSystem_t operatingSystem)
 	player->lastIP = player->getIP();
 	player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
 	player->resetIdleTime();	
+	g_sessionResume().issue(sessionToken, player->getGUID(), player->getAccount(), getIP());
 	acceptPackets = true;
 }
 
@@ -478,13 +560,13 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage &msg)
 
 	clientVersion = static_cast<int32_t>(msg.get<uint32_t>());
 
-	msg.getString(); // Client version (String)
+	msg.getStringView(); // Client version (String)
 
 	msg.skipBytes(3); // U16 dat revision, U8 game preview state
 
 	if (!Protocol::RSA_decrypt(msg))
 	{
-		SPDLOG_WARN("[ProtocolGame::onRecvFirstMessage] - RSA Decrypt Failed");
+		SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[ProtocolGame::onRecvFirstMessage] - RSA Decrypt Failed");
 		disconnect();
 		return;
 	}
@@ -506,8 +588,8 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage &msg)
 	if (operatingSystem == CLIENTOS_NEW_LINUX)
 	{
 		// TODO: check what new info for linux is send
-		msg.getString();
-		msg.getString();
+		msg.getStringView();
+		msg.getStringView();
 	}
 
 	std::string email = sessionKey.substr(0, pos);
@@ -564,12 +646,14 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage &msg)
 	}
 
 	uint32_t accountId;
-	if (!IOLoginData::gameWorldAuthentication(email, password, characterName, &accountId)) {
+	sessionToken = g_sessionResume().getToken(sessionKey, characterName);
+	bool resumed = g_sessionResume().resume(sessionToken, getIP(), accountId);
+	if (!resumed && !IOLoginData::gameWorldAuthentication(email, password, characterName, &accountId)) {
 		disconnectClient("Email or password is not correct.");
 		return;
 	}
 
-	g_dispatcher().addTask(createTask(std::bind(&ProtocolGame::login, getThis(), characterName, accountId, operatingSystem)));
+	g_dispatcher().addTask(createTask(std::bind(&ProtocolGame::login, getThis(), characterName, accountId, operatingSystem, resumed)));
 }
 
 void ProtocolGame::onConnect()
@@ -610,14 +694,98 @@ void ProtocolGame::disconnectClient(const std::string &message) const
 	disconnect();
 }
 
-void ProtocolGame::writeToOutputBuffer(const NetworkMessage &msg)
+void ProtocolGame::writeToOutputBuffer(const NetworkMessage &msg, bool keepDeferred /* = false*/)
+{
+	if (!keepDeferred)
+	{
+		// anything else may add or remove creatures, the client must have the updates first
+		flushDeferredCreatureUpdates();
+	}
+
+	auto out = getOutputBuffer(msg.getLength());
+	out->append(msg);
+}
+
+void ProtocolGame::flushDeferredMessages()
+{
+	flushDeferredCreatureUpdates();
+	flushDeferredPlayerUpdates();
+}
+
+void ProtocolGame::flushDeferredCreatureUpdates()
+{
+	if (deferredCreatureHealth.empty())
+	{
+		return;
+	}
+
+	NetworkMessage msg;
+	for (const auto &[creatureId, healthPercent] : deferredCreatureHealth)
+	{
+		PacketCreatureHealth::write(msg, creatureId, healthPercent);
+	}
+	deferredCreatureHealth.clear();
+
+	auto out = getOutputBuffer(msg.getLength());
+	out->append(msg);
+}
+
+void ProtocolGame::flushDeferredPlayerUpdates()
 {
+	if (!player || (deferredPlayerUpdates == 0 && deferredInventorySlots == 0))
+	{
+		return;
+	}
+
+	NetworkMessage msg;
+	for (uint8_t slot = CONST_SLOT_FIRST; deferredInventorySlots != 0; ++slot)
+	{
+		if ((deferredInventorySlots & (1u << slot)) == 0)
+		{
+			continue;
+		}
+
+		deferredInventorySlots &= ~(1u << slot);
+		if (const Item *item = player->getInventoryItem(static_cast<Slots_t>(slot)))
+		{
+			msg.addByte(0x78);
+			msg.addByte(slot);
+			AddItem(msg, item);
+		}
+		else
+		{
+			msg.addByte(0x79);
+			msg.addByte(slot);
+		}
+	}
+
+	if (deferredPlayerUpdates & DEFERRED_UPDATE_STATS)
+	{
+		AddPlayerStats(msg);
+	}
+
+	if (deferredPlayerUpdates & DEFERRED_UPDATE_SKILLS)
+	{
+		AddPlayerSkills(msg);
+	}
+
+	if (deferredPlayerUpdates & DEFERRED_UPDATE_ICONS)
+	{
+		msg.addByte(0xA2);
+		msg.add<uint32_t>(deferredIcons);
+	}
+	deferredPlayerUpdates = 0;
+
 	auto out = getOutputBuffer(msg.getLength());
 	out->append(msg);
 }
 
 void ProtocolGame::parsePacket(NetworkMessage& msg)
 {
+	if (g_inputTrace().isRecording()) {
+		g_inputTrace().recordPacket(*this, msg);
+	}
+
 	if (!acceptPackets || g_game().getGameState() == GAME_STATE_SHUTDOWN || msg.getLength() <= 0) {
 		return;
 	}
@@ -675,6 +843,21 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		}
 	}
 
+	if (!isValidPacket(recvbyte, msg)) {
+		return;
+	}
+
+	CoalescedPacket_t coalescedType = getCoalescedPacketType(recvbyte);
+	if (coalescedType != COALESCED_PACKET_NONE) {
+		coalescePacket(coalescedType, recvbyte, msg);
+		return;
+	}
+
+	// the queued turns and looks must not take the place of a newer one after this packet
+	for (auto &packet : openCoalescedPackets) {
+		packet.reset();
+	}
+
 	// Modules system
 	if (player && recvbyte != 0xD3) {
 		g_dispatcher().addTask(createTask(std::bind(&Modules::executeOnRecvbyte, &g_modules(), player->getID(), msg, recvbyte)));
@@ -683,6 +866,95 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 	g_dispatcher().addTask(createTask(std::bind(&ProtocolGame::parsePacketFromDispatcher, getThis(), msg, recvbyte)));
 }
 
+ProtocolGame::CoalescedPacket_t ProtocolGame::getCoalescedPacketType(uint8_t recvbyte)
+{
+	switch (recvbyte) {
+		case 0x64: return COALESCED_PACKET_AUTOWALK;
+		case 0x6F:
+		case 0x70:
+		case 0x71:
+		case 0x72: return COALESCED_PACKET_TURN;
+		case 0x8C: return COALESCED_PACKET_LOOK_AT;
+		case 0x8D: return COALESCED_PACKET_LOOK_IN_BATTLE_LIST;
+		default: return COALESCED_PACKET_NONE;
+	}
+}
+
+bool ProtocolGame::isValidPacket(uint8_t recvbyte, const NetworkMessage &msg)
+{
+	int32_t bodyLength = msg.getLength() + NetworkMessage::INITIAL_BUFFER_POSITION - msg.getBufferPosition();
+	switch (recvbyte) {
+		// number of directions followed by exactly that many
+		case 0x64: return bodyLength > 1 && msg.getBuffer()[msg.getBufferPosition()] == bodyLength - 1;
+		// position, item id, stackpos
+		case 0x8C: return bodyLength >= 8;
+		// creature id
+		case 0x8D:
+		case 0xA1:
+		case 0xA2: return bodyLength >= 4;
+		// from position, item id, stackpos, to position, count
+		case 0x78: return bodyLength >= 14;
+		// position, item id, stackpos, index
+		case 0x82: return bodyLength >= 9;
+		// position, item id, stackpos, to position, to item id, to stackpos
+		case 0x83: return bodyLength >= 16;
+		// position, item id, stackpos, creature id
+		case 0x84: return bodyLength >= 12;
+		default: return true;
+	}
+}
+
+void ProtocolGame::coalescePacket(CoalescedPacket_t type, uint8_t recvbyte, const NetworkMessage &msg)
+{
+	const uint8_t* body = msg.getBuffer() + msg.getBufferPosition();
+	const uint8_t* bodyEnd = msg.getBuffer() + msg.getLength() + NetworkMessage::INITIAL_BUFFER_POSITION;
+
+	// only a run of the same kind merges, a turn after an autowalk must not join the turn before it
+	for (size_t other = 0; other < openCoalescedPackets.size(); ++other) {
+		if (other != type) {
+			openCoalescedPackets[other].reset();
+		}
+	}
+
+	if (auto &packet = openCoalescedPackets[type]) {
+		std::lock_guard<std::mutex> lock(packet->mutex);
+		if (!packet->dispatched) {
+			packet->recvbyte = recvbyte;
+			packet->body.assign(body, bodyEnd);
+			return;
+		}
+	}
+
+	auto packet = std::make_shared<CoalescedPacket>();
+	packet->recvbyte = recvbyte;
+	packet->body.assign(body, bodyEnd);
+	openCoalescedPackets[type] = packet;
+	g_dispatcher().addTask(createTask(std::bind(&ProtocolGame::parseCoalescedPacket, getThis(), std::move(packet))));
+}
+
+void ProtocolGame::parseCoalescedPacket(const std::shared_ptr<CoalescedPacket> &packet)
+{
+	NetworkMessage msg;
+	uint8_t recvbyte;
+	{
+		std::lock_guard<std::mutex> lock(packet->mutex);
+		packet->dispatched = true;
+		recvbyte = packet->recvbyte;
+		if (!packet->body.empty()) {
+			msg.addBytes(reinterpret_cast<const char*>(packet->body.data()), packet->body.size());
+		}
+	}
+
+	// Modules system
+	if (player) {
+		msg.setBufferPosition(NetworkMessage::INITIAL_BUFFER_POSITION);
+		g_modules().executeOnRecvbyte(player->getID(), msg, recvbyte);
+	}
+
+	msg.setBufferPosition(NetworkMessage::INITIAL_BUFFER_POSITION);
+	parsePacketFromDispatcher(msg, recvbyte);
+}
+
 void ProtocolGame::parsePacketFromDispatcher(NetworkMessage msg, uint8_t recvbyte)
 {
 	if (!acceptPackets || g_game().getGameState() == GAME_STATE_SHUTDOWN) {
@@ -839,35 +1111,127 @@ void ProtocolGame::parseHotkeyEquip(NetworkMessage &msg)
 	addGameTask(&Game::playerEquipItem, player->getID(), itemId, Item::items[itemId].upgradeClassification > 0, tier);
 }
 
-void ProtocolGame::GetTileDescription(const Tile *tile, NetworkMessage &msg)
+const TileDescriptionCache *ProtocolGame::getTileDescriptionCache(const Tile *tile)
 {
-	int32_t count;
-	Item *ground = tile->getGround();
-	if (ground)
+	TileDescriptionCache &cache = tile->getDescriptionCache();
+	if (cache.valid)
 	{
-		AddItem(msg, ground);
-		count = 1;
+		return cache.cacheable ? &cache : nullptr;
 	}
-	else
+
+	cache.valid = true;
+	cache.cacheable = false;
+	cache.topItems = 0;
+	cache.downItems = 0;
+	cache.offsets[0] = 0;
+
+	// dispatcher thread
+	static NetworkMessage encoded;
+	encoded.reset();
+
+	size_t itemCount = 0;
+	auto addItem = [&](const Item *item) {
+		const ItemType &it = Item::items[item->getID()];
+		if (it.isPodium || it.expire || it.expireStop || it.clockExpire || it.wearOut)
+		{
+			return false;
+		}
+
+		// items on a tile are never held by a player, so the encoding is the same for every viewer
+		AddItem(encoded, item);
+		size_t size = encoded.getBufferPosition() - NetworkMessage::INITIAL_BUFFER_POSITION;
+		if (size > TileDescriptionCache::MAX_BYTES)
+		{
+			return false;
+		}
+
+		cache.offsets[++itemCount] = static_cast<uint8_t>(size);
+		return true;
+	};
+
+	if (const Item *ground = tile->getGround(); ground && !addItem(ground))
 	{
-		count = 0;
+		return nullptr;
 	}
 
 	const TileItemVector *items = tile->getItemList();
 	if (items)
 	{
-		for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it)
+		for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end && itemCount < TileDescriptionCache::MAX_ITEMS; ++it)
 		{
-			AddItem(msg, *it);
+			if (!addItem(*it))
+			{
+				return nullptr;
+			}
+		}
+	}
+	cache.topItems = static_cast<uint8_t>(itemCount);
 
-			count++;
-			if (count == 9 && tile->getPosition() == player->getPosition())
+	if (items)
+	{
+		for (auto it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end && itemCount < TileDescriptionCache::MAX_ITEMS; ++it)
+		{
+			if (!addItem(*it))
 			{
-				break;
+				return nullptr;
 			}
-			else if (count == 10)
+		}
+	}
+	cache.downItems = static_cast<uint8_t>(itemCount - cache.topItems);
+
+	std::copy_n(encoded.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION, cache.offsets[itemCount], cache.bytes.begin());
+	cache.cacheable = true;
+	return &cache;
+}
+
+void ProtocolGame::GetTileDescription(const Tile *tile, NetworkMessage &msg)
+{
+	// the own tile of the player has a special stack limit, see below
+	const TileDescriptionCache *cache = nullptr;
+	if (tile->getPosition() != player->getPosition())
+	{
+		cache = getTileDescriptionCache(tile);
+	}
+
+	int32_t count;
+	const TileItemVector *items = tile->getItemList();
+	if (cache)
+	{
+		msg.addBytes(reinterpret_cast<const char*>(cache->bytes.data()), cache->offsets[cache->topItems]);
+		count = cache->topItems;
+		if (count == 10)
+		{
+			return;
+		}
+	}
+	else
+	{
+		Item *ground = tile->getGround();
+		if (ground)
+		{
+			AddItem(msg, ground);
+			count = 1;
+		}
+		else
+		{
+			count = 0;
+		}
+
+		if (items)
+		{
+			for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it)
 			{
-				return;
+				AddItem(msg, *it);
+
+				count++;
+				if (count == 9 && tile->getPosition() == player->getPosition())
+				{
+					break;
+				}
+				else if (count == 10)
+				{
+					return;
+				}
 			}
 		}
 	}
@@ -905,7 +1269,13 @@ void ProtocolGame::GetTileDescription(const Tile *tile, NetworkMessage &msg)
 		}
 	}
 
-	if (items)
+	if (cache)
+	{
+		uint8_t downItems = std::min<uint8_t>(cache->downItems, 10 - count);
+		uint8_t begin = cache->offsets[cache->topItems];
+		msg.addBytes(reinterpret_cast<const char*>(cache->bytes.data()) + begin, cache->offsets[cache->topItems + downItems] - begin);
+	}
+	else if (items)
 	{
 		for (auto it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end; ++it)
 		{
@@ -983,49 +1353,30 @@ void ProtocolGame::GetFloorDescription(NetworkMessage &msg, int32_t x, int32_t y
 
 void ProtocolGame::checkCreatureAsKnown(uint32_t id, bool &known, uint32_t &removedKnown)
 {
-	if (auto [creatureKnown, creatureInserted] = knownCreatureSet.insert(id);
-	!creatureInserted)
+	if (knownCreatureSet.touch(id))
 	{
 		known = true;
 		return;
 	}
 	known = false;
-	if (knownCreatureSet.size() > 1300)
+	if (knownCreatureSet.size() >= KnownCreatures::CAPACITY)
 	{
-		// Look for a creature to remove
-		for (auto it = knownCreatureSet.begin(), end = knownCreatureSet.end(); it != end; ++it) {
-			if (*it == id) {
-				continue;
-			}
+		// The least recently sent creature goes, unless the client still shows it
+		removedKnown = knownCreatureSet.evict([this](uint32_t knownId) {
+			Creature* creature = g_game().getCreatureByID(knownId);
 			// We need to protect party players from removing
-			Creature* creature = g_game().getCreatureByID(*it);
 			if (const Player* checkPlayer;
-			creature && (checkPlayer = creature->getPlayer()) != nullptr)
+			creature && player->getParty() && (checkPlayer = creature->getPlayer()) != nullptr && player->getParty() == checkPlayer->getParty())
 			{
-				if (player->getParty() != checkPlayer->getParty() && !canSee(creature)) {
-					removedKnown = *it;
-					knownCreatureSet.erase(it);
-					return;
-				}
-			} else if (!canSee(creature)) {
-				removedKnown = *it;
-				knownCreatureSet.erase(it);
-				return;
+				return true;
 			}
-		}
-
-		// Bad situation. Let's just remove anyone.
-		auto it = knownCreatureSet.begin();
-		if (*it == id)
-		{
-			++it;
-		}
-
-		removedKnown = *it;
-		knownCreatureSet.erase(it);
+			return canSee(creature);
+		});
+		knownCreatureSet.insert(id);
 	}
 	else
 	{
+		knownCreatureSet.insert(id);
 		removedKnown = 0;
 	}
 }
@@ -1090,14 +1441,14 @@ bool ProtocolGame::canSee(int32_t x, int32_t y, int32_t z) const
 // Parse methods
 void ProtocolGame::parseChannelInvite(NetworkMessage &msg)
 {
-	const std::string name = msg.getString();
-	addGameTask(&Game::playerChannelInvite, player->getID(), name);
+	const std::string_view name = msg.getStringView();
+	addGameTask(&Game::playerChannelInvite, player->getID(), std::string(name));
 }
 
 void ProtocolGame::parseChannelExclude(NetworkMessage &msg)
 {
-	const std::string name = msg.getString();
-	addGameTask(&Game::playerChannelExclude, player->getID(), name);
+	const std::string_view name = msg.getStringView();
+	addGameTask(&Game::playerChannelExclude, player->getID(), std::string(name));
 }
 
 void ProtocolGame::parseOpenChannel(NetworkMessage &msg)
@@ -1114,8 +1465,8 @@ void ProtocolGame::parseCloseChannel(NetworkMessage &msg)
 
 void ProtocolGame::parseOpenPrivateChannel(NetworkMessage &msg)
 {
-	const std::string receiver = msg.getString();
-	addGameTask(&Game::playerOpenPrivateChannel, player->getID(), receiver);
+	const std::string_view receiver = msg.getStringView();
+	addGameTask(&Game::playerOpenPrivateChannel, player->getID(), std::string(receiver));
 }
 
 void ProtocolGame::parseAutoWalk(NetworkMessage &msg)
@@ -1389,7 +1740,7 @@ void ProtocolGame::parseQuickLootBlackWhitelist(NetworkMessage &msg)
 
 void ProtocolGame::parseSay(NetworkMessage &msg)
 {
-	std::string receiver;
+	std::string_view receiver;
 	uint16_t channelId;
 
 	SpeakClasses type = static_cast<SpeakClasses>(msg.getByte());
@@ -1397,7 +1748,7 @@ void ProtocolGame::parseSay(NetworkMessage &msg)
 	{
 	case TALKTYPE_PRIVATE_TO:
 	case TALKTYPE_PRIVATE_RED_TO:
-		receiver = msg.getString();
+		receiver = msg.getStringView();
 		channelId = 0;
 		break;
 
@@ -1411,13 +1762,14 @@ void ProtocolGame::parseSay(NetworkMessage &msg)
 		break;
 	}
 
-	const std::string text = msg.getString();
+	const std::string_view text = msg.getStringView();
 	if (text.length() > 255)
 	{
 		return;
 	}
 
-	addGameTask(&Game::playerSay, player->getID(), channelId, type, receiver, text);
+	// the only copies of the strings, the packet buffer is reused once this returns
+	addGameTask(&Game::playerSay, player->getID(), channelId, type, std::string(receiver), std::string(text));
 }
 
 void ProtocolGame::parseFightModes(NetworkMessage &msg)
@@ -1461,16 +1813,16 @@ void ProtocolGame::parseFollow(NetworkMessage &msg)
 void ProtocolGame::parseTextWindow(NetworkMessage &msg)
 {
 	uint32_t windowTextId = msg.get<uint32_t>();
-	const std::string newText = msg.getString();
-	addGameTask(&Game::playerWriteItem, player->getID(), windowTextId, newText);
+	const std::string_view newText = msg.getStringView();
+	addGameTask(&Game::playerWriteItem, player->getID(), windowTextId, std::string(newText));
 }
 
 void ProtocolGame::parseHouseWindow(NetworkMessage &msg)
 {
 	uint8_t doorId = msg.getByte();
 	uint32_t id = msg.get<uint32_t>();
-	const std::string text = msg.getString();
-	addGameTask(&Game::playerUpdateHouseWindow, player->getID(), doorId, id, text);
+	const std::string_view text = msg.getStringView();
+	addGameTask(&Game::playerUpdateHouseWindow, player->getID(), doorId, id, std::string(text));
 }
 
 void ProtocolGame::parseLookInShop(NetworkMessage &msg)
@@ -1518,8 +1870,8 @@ void ProtocolGame::parseLookInTrade(NetworkMessage &msg)
 
 void ProtocolGame::parseAddVip(NetworkMessage &msg)
 {
-	const std::string name = msg.getString();
-	addGameTask(&Game::playerRequestAddVip, player->getID(), name);
+	const std::string_view name = msg.getStringView();
+	addGameTask(&Game::playerRequestAddVip, player->getID(), std::string(name));
 }
 
 void ProtocolGame::parseRemoveVip(NetworkMessage &msg)
@@ -1531,10 +1883,10 @@ void ProtocolGame::parseRemoveVip(NetworkMessage &msg)
 void ProtocolGame::parseEditVip(NetworkMessage &msg)
 {
 	uint32_t guid = msg.get<uint32_t>();
-	const std::string description = msg.getString();
+	const std::string_view description = msg.getStringView();
 	uint32_t icon = std::min<uint32_t>(10, msg.get<uint32_t>()); // 10 is max icon in 9.63
 	bool notify = msg.getByte() != 0;
-	addGameTask(&Game::playerRequestEditVip, player->getID(), guid, description, icon, notify);
+	addGameTask(&Game::playerRequestEditVip, player->getID(), guid, std::string(description), icon, notify);
 }
 
 void ProtocolGame::parseRotateItem(NetworkMessage &msg)
@@ -1762,15 +2114,15 @@ void ProtocolGame::parseTournamentLeaderboard(NetworkMessage &msg)
 	uint8_t ledaerboardType = msg.getByte();
 	if (ledaerboardType == 0)
 	{
-		const std::string worldName = msg.getString();
+		const std::string_view worldName = msg.getStringView();
 		uint16_t currentPage = msg.get<uint16_t>();
 		(void)worldName;
 		(void)currentPage;
 	}
 	else if (ledaerboardType == 1)
 	{
-		const std::string worldName = msg.getString();
-		const std::string characterName = msg.getString();
+		const std::string_view worldName = msg.getStringView();
+		const std::string_view characterName = msg.getStringView();
 		(void)worldName;
 		(void)characterName;
 	}
@@ -1792,8 +2144,8 @@ void ProtocolGame::parseRuleViolationReport(NetworkMessage &msg)
 {
 	uint8_t reportType = msg.getByte();
 	uint8_t reportReason = msg.getByte();
-	const std::string &targetName = msg.getString();
-	const std::string &comment = msg.getString();
+	std::string targetName = msg.getString();
+	std::string comment = msg.getString();
 	std::string translation;
 	if (reportType == REPORT_TYPE_NAME)
 	{
@@ -1805,7 +2157,7 @@ void ProtocolGame::parseRuleViolationReport(NetworkMessage &msg)
 		msg.get<uint32_t>(); // statement id, used to get whatever player have said, we don't log that.
 	}
 
-	addGameTask(&Game::playerReportRuleViolationReport, player->getID(), targetName, reportType, reportReason, comment, translation);
+	addGameTask(&Game::playerReportRuleViolationReport, player->getID(), std::move(targetName), reportType, reportReason, std::move(comment), std::move(translation));
 }
 
 void ProtocolGame::parseBestiarysendRaces()
@@ -2365,7 +2717,7 @@ void ProtocolGame::parseSendBuyCharmRune(NetworkMessage &msg)
 	g_iobestiary().sendBuyCharmRune(player, runeID, action, raceid);
 }
 
-void ProtocolGame::refreshBestiaryTracker(std::list<MonsterType *> trackerList)
+void ProtocolGame::refreshBestiaryTracker(const std::list<MonsterType *> &trackerList)
 {
 	NetworkMessage msg;
 	msg.addByte(0xB9);
@@ -2402,7 +2754,7 @@ void ProtocolGame::BestiarysendCharms()
 	msg.addByte(0xd8);
 	msg.add<uint32_t>(player->getCharmPoints());
 
-	std::vector<Charm *> charmList = g_game().getCharmList();
+	const std::vector<Charm *> &charmList = g_game().getCharmList();
 	msg.addByte(charmList.size());
 	for (Charm *c_type : charmList)
 	{
@@ -2532,7 +2884,7 @@ void ProtocolGame::parseBugReport(NetworkMessage &msg)
 		position = msg.getPosition();
 	}
 
-	addGameTask(&Game::playerReportBug, player->getID(), message, position, category);
+	addGameTask(&Game::playerReportBug, player->getID(), std::move(message), position, category);
 }
 
 void ProtocolGame::parseGreet(NetworkMessage &msg)
@@ -2554,7 +2906,7 @@ void ProtocolGame::parseDebugAssert(NetworkMessage &msg)
 	std::string date = msg.getString();
 	std::string description = msg.getString();
 	std::string comment = msg.getString();
-	addGameTask(&Game::playerDebugAssert, player->getID(), assertLine, date, description, comment);
+	addGameTask(&Game::playerDebugAssert, player->getID(), std::move(assertLine), std::move(date), std::move(description), std::move(comment));
 }
 
 void ProtocolGame::parsePreyAction(NetworkMessage &msg)
@@ -2676,7 +3028,7 @@ void ProtocolGame::parseStoreBuyOffer(NetworkMessage &message)
 	{
 		additionalInfo = message.getString();
 	}
-	addGameTaskTimed(350, &Game::playerBuyStoreOffer, player->getID(), offerId, productType, additionalInfo);
+	addGameTaskTimed(350, &Game::playerBuyStoreOffer, player->getID(), offerId, productType, std::move(additionalInfo));
 }
 
 void ProtocolGame::parseStoreOpenTransactionHistory(NetworkMessage &msg)
@@ -2703,7 +3055,7 @@ void ProtocolGame::parseCoinTransfer(NetworkMessage &msg)
 
 	if (amount > 0)
 	{
-		addGameTaskTimed(350, &Game::playerCoinTransfer, player->getID(), receiverName, amount);
+		addGameTaskTimed(350, &Game::playerCoinTransfer, player->getID(), std::move(receiverName), amount);
 	}
 
 	updateCoinBalance();
@@ -2860,6 +3212,14 @@ void ProtocolGame::sendCreatureIcon(const Creature* creature)
 
 void ProtocolGame::sendWorldLight(const LightInfo &lightInfo)
 {
+	// the value the client ends up with, access players always see full light
+	int32_t clientLight = ((player->isAccessPlayer() ? 0xFF : lightInfo.level) << 8) | lightInfo.color;
+	if (clientLight == sentWorldLight)
+	{
+		return;
+	}
+	sentWorldLight = clientLight;
+
 	NetworkMessage msg;
 	AddWorldLight(msg, lightInfo);
 	writeToOutputBuffer(msg);
@@ -2867,6 +3227,12 @@ void ProtocolGame::sendWorldLight(const LightInfo &lightInfo)
 
 void ProtocolGame::sendTibiaTime(int32_t time)
 {
+	if (time == sentTibiaTime)
+	{
+		return;
+	}
+	sentTibiaTime = time;
+
 	NetworkMessage msg;
 	msg.addByte(0xEF);
 	msg.addByte(time / 60);
@@ -2882,9 +3248,7 @@ void ProtocolGame::sendCreatureWalkthrough(const Creature *creature, bool walkth
 	}
 
 	NetworkMessage msg;
-	msg.addByte(0x92);
-	msg.add<uint32_t>(creature->getID());
-	msg.addByte(walkthrough ? 0x00 : 0x01);
+	PacketCreatureWalkthrough::write(msg, creature->getID(), walkthrough ? 0x00 : 0x01);
 	writeToOutputBuffer(msg);
 }
 
@@ -2944,17 +3308,14 @@ void ProtocolGame::sendCreatureType(const Creature *creature, uint8_t creatureTy
 
 void ProtocolGame::sendCreatureSquare(const Creature *creature, SquareColor_t color)
 {
-	if (!canSee(creature))
+	if (!canSee(creature) || isOutputCongested())
 	{
 		return;
 	}
 
 	NetworkMessage msg;
-	msg.addByte(0x93);
-	msg.add<uint32_t>(creature->getID());
-	msg.addByte(0x01);
-	msg.addByte(color);
-	writeToOutputBuffer(msg);
+	PacketCreatureSquare::write(msg, creature->getID(), 0x01, color);
+	writeToOutputBuffer(msg, true);
 }
 
 void ProtocolGame::sendTutorial(uint8_t tutorialId)
@@ -3488,7 +3849,7 @@ void ProtocolGame::sendCyclopediaCharacterInspection()
 
 	msg.addByte(3);
 	msg.addString("Level");
-	msg.addString(std::to_string(player->getLevel()));
+	msg.addFormattedString("{}", player->getLevel());
 	msg.addString("Vocation");
 	msg.addString(player->getVocation()->getVocName());
 	msg.addString("Outfit");
@@ -3552,9 +3913,8 @@ void ProtocolGame::sendReLoginWindow(uint8_t unfairFightReduction)
 
 void ProtocolGame::sendStats()
 {
-	NetworkMessage msg;
-	AddPlayerStats(msg);
-	writeToOutputBuffer(msg);
+	deferredPlayerUpdates |= DEFERRED_UPDATE_STATS;
+	queueAutosend();
 }
 
 void ProtocolGame::sendBasicData()
@@ -3660,6 +4020,12 @@ void ProtocolGame::sendTextMessage(const TextMessage &message)
 		return;
 	}
 
+	if ((message.type == MESSAGE_DAMAGE_OTHERS || message.type == MESSAGE_HEALED_OTHERS || message.type == MESSAGE_EXPERIENCE_OTHERS) && isOutputCongested())
+	{
+		// numbers floating over other creatures, the client is behind already
+		return;
+	}
+
 	NetworkMessage msg;
 	msg.addByte(0xB4);
 	msg.addByte(message.type);
@@ -3697,7 +4063,7 @@ void ProtocolGame::sendTextMessage(const TextMessage &message)
 	}
 	}
 	msg.addString(message.text);
-	writeToOutputBuffer(msg);
+	writeToOutputBuffer(msg, true);
 }
 
 void ProtocolGame::sendClosePrivate(uint16_t channelId)
@@ -3747,9 +4113,9 @@ void ProtocolGame::sendChannel(uint16_t channelId, const std::string &channelNam
 	if (channelUsers)
 	{
 		msg.add<uint16_t>(channelUsers->size());
-		for (const auto &it : *channelUsers)
+		for (const Player *user : *channelUsers)
 		{
-			msg.addString(it.second->getName());
+			msg.addString(user->getName());
 		}
 	}
 	else
@@ -3775,6 +4141,12 @@ void ProtocolGame::sendChannel(uint16_t channelId, const std::string &channelNam
 void ProtocolGame::sendChannelMessage(const std::string &author, const std::string &text, SpeakClasses type, uint16_t channel)
 {
 	NetworkMessage msg;
+	AddChannelMessage(msg, author, text, type, channel);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddChannelMessage(NetworkMessage &msg, const std::string &author, const std::string &text, SpeakClasses type, uint16_t channel)
+{
 	msg.addByte(0xAA);
 	msg.add<uint32_t>(0x00);
 	msg.addString(author);
@@ -3782,15 +4154,13 @@ void ProtocolGame::sendChannelMessage(const std::string &author, const std::stri
 	msg.addByte(type);
 	msg.add<uint16_t>(channel);
 	msg.addString(text);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendIcons(uint32_t icons)
 {
-	NetworkMessage msg;
-	msg.addByte(0xA2);
-	msg.add<uint32_t>(icons);
-	writeToOutputBuffer(msg);
+	deferredPlayerUpdates |= DEFERRED_UPDATE_ICONS;
+	deferredIcons = icons;
+	queueAutosend();
 }
 
 void ProtocolGame::sendUnjustifiedPoints(const uint8_t &dayProgress, const uint8_t &dayLeft, const uint8_t &weekProgress, const uint8_t &weekLeft, const uint8_t &monthProgress, const uint8_t &monthLeft, const uint8_t &skullDuration)
@@ -3920,12 +4290,15 @@ void ProtocolGame::sendShop(Npc *npc)
 
 	msg.addString(std::string()); // Currency name
 
-	std::vector<ShopBlock> shoplist = npc->getShopItemVector();
+	const std::vector<ShopBlock> &shoplist = npc->getShopItemVector();
 	uint16_t itemsToSend = std::min<size_t>(shoplist.size(), std::numeric_limits<uint16_t>::max());
 	msg.add<uint16_t>(itemsToSend);
 
+	// a new window starts without a sale list
+	lastSaleItemList.clear();
+
 	uint16_t i = 0;
-	for (ShopBlock shopBlock : shoplist)
+	for (const ShopBlock &shopBlock : shoplist)
 	{
 		if (++i > itemsToSend) {
 			break;
@@ -3979,7 +4352,7 @@ void ProtocolGame::sendResourceBalance(Resource_t resourceType, uint64_t value)
 	writeToOutputBuffer(msg);
 }
 
-void ProtocolGame::sendSaleItemList(const std::vector<ShopBlock> &shopVector, const std::map<uint16_t, uint16_t> &inventoryMap)
+void ProtocolGame::sendSaleItemList(const std::vector<uint16_t> &sellItemIds, const std::map<uint16_t, uint16_t> &inventoryMap)
 {
 	//Since we already have full inventory map we shouldn't call getMoney here - it is simply wasting cpu power
 	uint64_t playerMoney = 0;
@@ -4024,24 +4397,28 @@ void ProtocolGame::sendSaleItemList(const std::vector<ShopBlock> &shopVector, co
 	auto msgPosition = msg.getBufferPosition();
 	msg.skipBytes(1);
 
-	for (ShopBlock shopBlock : shopVector)
+	for (uint16_t itemId : sellItemIds)
 	{
-		if (shopBlock.itemSellPrice == 0)
-		{
-			continue;
-		}
-
-		it = inventoryMap.find(shopBlock.itemId);
-		if (it != inventoryMap.end())
+		it = inventoryMap.find(itemId);
+		if (it != inventoryMap.end() && itemsToSend < std::numeric_limits<uint8_t>::max())
 		{
 			itemsToSend++;
-			msg.add<uint16_t>(shopBlock.itemId);
+			msg.add<uint16_t>(itemId);
 			msg.add<uint16_t>(it->second);
 		}
 	}
 
 	msg.setBufferPosition(msgPosition);
 	msg.addByte(itemsToSend);
+
+	// the client keeps the list until told otherwise, most inventory changes leave it as it was
+	const uint8_t* body = msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION;
+	if (lastSaleItemList.size() == msg.getLength() && std::equal(lastSaleItemList.begin(), lastSaleItemList.end(), body))
+	{
+		return;
+	}
+
+	lastSaleItemList.assign(body, body + msg.getLength());
 	writeToOutputBuffer(msg);
 }
 
@@ -4381,7 +4758,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.armor != 0)
 	{
-		msg.addString(std::to_string(it.armor));
+		msg.addFormattedString("{}", it.armor);
 	}
 	else
 	{
@@ -4395,13 +4772,11 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 		// "attack +x, chance to hit +y%, z fields"
 		if (it.abilities && it.abilities->elementType != COMBAT_NONE && it.abilities->elementDamage != 0)
 		{
-			std::ostringstream ss;
-			ss << it.attack << " physical +" << it.abilities->elementDamage << ' ' << getCombatName(it.abilities->elementType);
-			msg.addString(ss.str());
+			msg.addFormattedString("{} physical +{} {}", it.attack, it.abilities->elementDamage, getCombatName(it.abilities->elementType));
 		}
 		else
 		{
-			msg.addString(std::to_string(it.attack));
+			msg.addFormattedString("{}", it.attack);
 		}
 	}
 	else
@@ -4411,7 +4786,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.isContainer())
 	{
-		msg.addString(std::to_string(it.maxItems));
+		msg.addFormattedString("{}", it.maxItems);
 	}
 	else
 	{
@@ -4422,13 +4797,11 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 	{
 		if (it.extraDefense != 0)
 		{
-			std::ostringstream ss;
-			ss << it.defense << ' ' << std::showpos << it.extraDefense << std::noshowpos;
-			msg.addString(ss.str());
+			msg.addFormattedString("{} {:+}", it.defense, it.extraDefense);
 		}
 		else
 		{
-			msg.addString(std::to_string(it.defense));
+			msg.addFormattedString("{}", it.defense);
 		}
 	}
 	else
@@ -4441,7 +4814,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 		const std::string &descr = it.description;
 		if (descr.back() == '.')
 		{
-			msg.addString(std::string(descr, 0, descr.length() - 1));
+			msg.addString(std::string_view(descr).substr(0, descr.length() - 1));
 		}
 		else
 		{
@@ -4455,9 +4828,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.decayTime != 0)
 	{
-		std::ostringstream ss;
-		ss << it.decayTime << " seconds";
-		msg.addString(ss.str());
+		msg.addFormattedString("{} seconds", it.decayTime);
 	}
 	else
 	{
@@ -4497,7 +4868,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.minReqLevel != 0)
 	{
-		msg.addString(std::to_string(it.minReqLevel));
+		msg.addFormattedString("{}", it.minReqLevel);
 	}
 	else
 	{
@@ -4506,7 +4877,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.minReqMagicLevel != 0)
 	{
-		msg.addString(std::to_string(it.minReqMagicLevel));
+		msg.addFormattedString("{}", it.minReqMagicLevel);
 	}
 	else
 	{
@@ -4601,7 +4972,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.charges != 0)
 	{
-		msg.addString(std::to_string(it.charges));
+		msg.addFormattedString("{}", it.charges);
 	}
 	else
 	{
@@ -4626,23 +4997,8 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.weight != 0)
 	{
-		std::ostringstream ss;
-		if (it.weight < 10)
-		{
-			ss << "0.0" << it.weight;
-		}
-		else if (it.weight < 100)
-		{
-			ss << "0." << it.weight;
-		}
-		else
-		{
-			std::string weightString = std::to_string(it.weight);
-			weightString.insert(weightString.end() - 2, '.');
-			ss << weightString;
-		}
-		ss << " oz";
-		msg.addString(ss.str());
+		// weights are stored in hundredths of an oz
+		msg.addFormattedString("{}.{:02} oz", it.weight / 100, it.weight % 100);
 	}
 	else
 	{
@@ -4651,7 +5007,7 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 
 	if (it.imbuementSlot > 0)
 	{
-		msg.addString(std::to_string(it.imbuementSlot));
+		msg.addFormattedString("{}", it.imbuementSlot);
 	}
 	else
 	{
@@ -4670,8 +5026,8 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 	// Upgrade and tier detail modifier
 	if (it.upgradeClassification > 0)
 	{
-		msg.addString(std::to_string(it.upgradeClassification));
-		msg.addString(std::to_string(tier));
+		msg.addFormattedString("{}", it.upgradeClassification);
+		msg.addFormattedString("{}", tier);
 	}
 	else
 	{
@@ -4679,33 +5035,19 @@ void ProtocolGame::sendMarketDetail(uint16_t itemId, uint8_t tier)
 		msg.add<uint16_t>(0x00);
 	}
 
-	auto purchase = IOMarket::getInstance().getPurchaseStatistics()[itemId][tier];
-	if (const MarketStatistics* purchaseStatistics = &purchase; purchaseStatistics)
-	{
-		msg.addByte(0x01);
-		msg.add<uint32_t>(purchaseStatistics->numTransactions);
-		msg.add<uint64_t>(purchaseStatistics->totalPrice);
-		msg.add<uint64_t>(purchaseStatistics->highestPrice);
-		msg.add<uint64_t>(purchaseStatistics->lowestPrice);
-	}
-	else
-	{
-		msg.addByte(0x00);
-	}
+	const MarketStatistics purchaseStatistics = IOMarket::getInstance().getStatistics(MARKETACTION_BUY, itemId, tier);
+	msg.addByte(0x01);
+	msg.add<uint32_t>(purchaseStatistics.numTransactions);
+	msg.add<uint64_t>(purchaseStatistics.totalPrice);
+	msg.add<uint64_t>(purchaseStatistics.highestPrice);
+	msg.add<uint64_t>(purchaseStatistics.lowestPrice);
 
-	auto sale = IOMarket::getInstance().getSaleStatistics()[itemId][tier];
-	if (const MarketStatistics* saleStatistics = &sale; saleStatistics)
-	{
-		msg.addByte(0x01);
-		msg.add<uint32_t>(saleStatistics->numTransactions);
-		msg.add<uint64_t>(std::min<uint64_t>(std::numeric_limits<uint32_t>::max(), saleStatistics->totalPrice));
-		msg.add<uint64_t>(saleStatistics->highestPrice);
-		msg.add<uint64_t>(saleStatistics->lowestPrice);
-	}
-	else
-	{
-		msg.addByte(0x00);
-	}
+	const MarketStatistics saleStatistics = IOMarket::getInstance().getStatistics(MARKETACTION_SELL, itemId, tier);
+	msg.addByte(0x01);
+	msg.add<uint32_t>(saleStatistics.numTransactions);
+	msg.add<uint64_t>(std::min<uint64_t>(std::numeric_limits<uint32_t>::max(), saleStatistics.totalPrice));
+	msg.add<uint64_t>(saleStatistics.highestPrice);
+	msg.add<uint64_t>(saleStatistics.lowestPrice);
 
 	writeToOutputBuffer(msg);
 }
@@ -4782,19 +5124,24 @@ void ProtocolGame::sendCreatureTurn(const Creature *creature, uint32_t stackPos)
 	}
 
 	NetworkMessage msg;
-	msg.addByte(0x6B);
-	msg.addPosition(creature->getPosition());
-	msg.addByte(stackPos);
-	msg.add<uint16_t>(0x63);
-	msg.add<uint32_t>(creature->getID());
-	msg.addByte(creature->getDirection());
-	msg.addByte(player->canWalkthroughEx(creature) ? 0x00 : 0x01);
+	PacketCreatureTurn::write(msg, creature->getPosition(), stackPos, 0x63, creature->getID(), creature->getDirection(), player->canWalkthroughEx(creature) ? 0x00 : 0x01);
 	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendCreatureSay(const Creature *creature, SpeakClasses type, const std::string &text, const Position *pos /* = nullptr*/)
 {
 	NetworkMessage msg;
+	AddCreatureSay(msg, creature, type, text, pos);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::sendCreatureSay(const NetworkMessage &encoded)
+{
+	writeToOutputBuffer(encoded);
+}
+
+void ProtocolGame::AddCreatureSay(NetworkMessage &msg, const Creature *creature, SpeakClasses type, const std::string &text, const Position *pos)
+{
 	msg.addByte(0xAA);
 
 	static uint32_t statementId = 0;
@@ -4824,12 +5171,22 @@ void ProtocolGame::sendCreatureSay(const Creature *creature, SpeakClasses type,
 	}
 
 	msg.addString(text);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendToChannel(const Creature *creature, SpeakClasses type, const std::string &text, uint16_t channelId)
 {
 	NetworkMessage msg;
+	AddToChannel(msg, creature, type, text, channelId);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::sendToChannel(const NetworkMessage &encoded)
+{
+	writeToOutputBuffer(encoded);
+}
+
+void ProtocolGame::AddToChannel(NetworkMessage &msg, const Creature *creature, SpeakClasses type, const std::string &text, uint16_t channelId)
+{
 	msg.addByte(0xAA);
 
 	static uint32_t statementId = 0;
@@ -4873,7 +5230,6 @@ void ProtocolGame::sendToChannel(const Creature *creature, SpeakClasses type, co
 	msg.addByte(type);
 	msg.add<uint16_t>(channelId);
 	msg.addString(text);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendPrivateMessage(const Player *speaker, SpeakClasses type, const std::string &text)
@@ -4935,9 +5291,8 @@ void ProtocolGame::sendCancelWalk()
 
 void ProtocolGame::sendSkills()
 {
-	NetworkMessage msg;
-	AddPlayerSkills(msg);
-	writeToOutputBuffer(msg);
+	deferredPlayerUpdates |= DEFERRED_UPDATE_SKILLS;
+	queueAutosend();
 }
 
 void ProtocolGame::sendPing()
@@ -4959,15 +5314,32 @@ void ProtocolGame::sendPingBack()
 
 void ProtocolGame::sendDistanceShoot(const Position &from, const Position &to, uint8_t type)
 {
+	if (isOutputCongested())
+	{
+		return;
+	}
+
 	NetworkMessage msg;
-	msg.addByte(0x83);
-	msg.addPosition(from);
-	msg.addByte(MAGIC_EFFECTS_CREATE_DISTANCEEFFECT);
-	msg.addByte(type);
-	msg.addByte(static_cast<uint8_t>(static_cast<int8_t>(static_cast<int32_t>(to.x) - static_cast<int32_t>(from.x))));
-	msg.addByte(static_cast<uint8_t>(static_cast<int8_t>(static_cast<int32_t>(to.y) - static_cast<int32_t>(from.y))));
-	msg.addByte(MAGIC_EFFECTS_END_LOOP);
-	writeToOutputBuffer(msg);
+	AddDistanceShoot(msg, from, to, type);
+	writeToOutputBuffer(msg, true);
+}
+
+void ProtocolGame::sendDistanceShoot(const NetworkMessage &encoded)
+{
+	if (isOutputCongested())
+	{
+		return;
+	}
+
+	writeToOutputBuffer(encoded, true);
+}
+
+void ProtocolGame::AddDistanceShoot(NetworkMessage &msg, const Position &from, const Position &to, uint8_t type)
+{
+	PacketDistanceShoot::write(msg, from, MAGIC_EFFECTS_CREATE_DISTANCEEFFECT, type,
+		static_cast<uint8_t>(static_cast<int8_t>(static_cast<int32_t>(to.x) - static_cast<int32_t>(from.x))),
+		static_cast<uint8_t>(static_cast<int8_t>(static_cast<int32_t>(to.y) - static_cast<int32_t>(from.y))),
+		MAGIC_EFFECTS_END_LOOP);
 }
 
 void ProtocolGame::sendRestingStatus(uint8_t protection)
@@ -5026,40 +5398,49 @@ void ProtocolGame::sendRestingStatus(uint8_t protection)
 
 void ProtocolGame::sendMagicEffect(const Position &pos, uint8_t type)
 {
-	if (!canSee(pos))
+	if (!canSee(pos) || isOutputCongested())
 	{
 		return;
 	}
 
 	NetworkMessage msg;
-	msg.addByte(0x83);
-	msg.addPosition(pos);
-	msg.addByte(MAGIC_EFFECTS_CREATE_EFFECT);
-	msg.addByte(type);
-	msg.addByte(MAGIC_EFFECTS_END_LOOP);
-	writeToOutputBuffer(msg);
+	AddMagicEffect(msg, pos, type);
+	writeToOutputBuffer(msg, true);
 }
 
-void ProtocolGame::sendCreatureHealth(const Creature *creature)
+void ProtocolGame::sendMagicEffect(const Position &pos, const NetworkMessage &encoded)
 {
-	if (creature->isHealthHidden())
+	if (!canSee(pos) || isOutputCongested())
 	{
 		return;
 	}
 
-	NetworkMessage msg;
-	msg.addByte(0x8C);
-	msg.add<uint32_t>(creature->getID());
+	writeToOutputBuffer(encoded, true);
+}
 
+void ProtocolGame::AddMagicEffect(NetworkMessage &msg, const Position &pos, uint8_t type)
+{
+	PacketMagicEffect::write(msg, pos, MAGIC_EFFECTS_CREATE_EFFECT, type, MAGIC_EFFECTS_END_LOOP);
+}
+
+void ProtocolGame::sendCreatureHealth(const Creature *creature)
+{
 	if (creature->isHealthHidden())
 	{
-		msg.addByte(0x00);
+		return;
 	}
-	else
+
+	uint8_t healthPercent = std::ceil((static_cast<double>(creature->getHealth()) / std::max<int32_t>(creature->getMaxHealth(), 1)) * 100);
+	for (auto &[creatureId, deferredPercent] : deferredCreatureHealth)
 	{
-		msg.addByte(std::ceil((static_cast<double>(creature->getHealth()) / std::max<int32_t>(creature->getMaxHealth(), 1)) * 100));
+		if (creatureId == creature->getID())
+		{
+			deferredPercent = healthPercent;
+			return;
+		}
 	}
-	writeToOutputBuffer(msg);
+	deferredCreatureHealth.emplace_back(creature->getID(), healthPercent);
+	queueAutosend();
 }
 
 void ProtocolGame::sendPartyCreatureUpdate(const Creature* target)
@@ -5080,7 +5461,7 @@ void ProtocolGame::sendPartyCreatureUpdate(const Creature* target)
 void ProtocolGame::sendPartyCreatureShield(const Creature* target)
 {
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 		return;
 	}
@@ -5099,7 +5480,7 @@ void ProtocolGame::sendPartyCreatureSkull(const Creature* target)
 	}
 
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 		return;
 	}
@@ -5114,7 +5495,7 @@ void ProtocolGame::sendPartyCreatureSkull(const Creature* target)
 void ProtocolGame::sendPartyCreatureHealth(const Creature* target, uint8_t healthPercent)
 {
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 		return;
 	}
@@ -5129,7 +5510,7 @@ void ProtocolGame::sendPartyCreatureHealth(const Creature* target, uint8_t healt
 void ProtocolGame::sendPartyPlayerMana(const Player* target, uint8_t manaPercent)
 {
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 	}
 
@@ -5144,7 +5525,7 @@ void ProtocolGame::sendPartyPlayerMana(const Player* target, uint8_t manaPercent
 void ProtocolGame::sendPartyCreatureShowStatus(const Creature* target, bool showStatus)
 {
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 	}
 
@@ -5159,7 +5540,7 @@ void ProtocolGame::sendPartyCreatureShowStatus(const Creature* target, bool show
 void ProtocolGame::sendPartyPlayerVocation(const Player* target)
 {
 	uint32_t cid = target->getID();
-	if (knownCreatureSet.find(cid) == knownCreatureSet.end()) {
+	if (!knownCreatureSet.contains(cid)) {
 		sendPartyCreatureUpdate(target);
 		return;
 	}
@@ -5250,8 +5631,7 @@ void ProtocolGame::sendUpdateTile(const Tile *tile, const Position &pos)
 	}
 
 	NetworkMessage msg;
-	msg.addByte(0x69);
-	msg.addPosition(pos);
+	PacketUpdateTile::write(msg, pos);
 
 	if (tile)
 	{
@@ -5366,6 +5746,9 @@ void ProtocolGame::sendAddCreature(const Creature *creature, const Position &pos
 
 	writeToOutputBuffer(msg);
 
+	// a fresh client has neither, send them even if this connection did before
+	sentWorldLight = -1;
+	sentTibiaTime = -1;
 	sendTibiaTime(g_game().getLightHour());
 	sendPendingStateEntered();
 	sendEnterWorld();
@@ -5472,6 +5855,23 @@ void ProtocolGame::sendMoveCreature(const Creature *creature, const Position &ne
 		{
 			sendMapDescription(newPos);
 		}
+		else if (teleport && newStackPos < 10 && canScrollMap(oldPos, newPos))
+		{
+			// the tiles the client keeps are up to date, only the uncovered edges are new
+			NetworkMessage msg;
+			RemoveTileThing(msg, oldPos, oldStackPos);
+			ScrollMapDescription(msg, oldPos, newPos);
+
+			msg.addByte(0x6A);
+			msg.addPosition(newPos);
+			msg.addByte(newStackPos);
+
+			bool known;
+			uint32_t removedKnown;
+			checkCreatureAsKnown(creature->getID(), known, removedKnown);
+			AddCreature(msg, creature, known, removedKnown);
+			writeToOutputBuffer(msg);
+		}
 		else if (teleport)
 		{
 			NetworkMessage msg;
@@ -5488,10 +5888,7 @@ void ProtocolGame::sendMoveCreature(const Creature *creature, const Position &ne
 			}
 			else
 			{
-				msg.addByte(0x6D);
-				msg.addPosition(oldPos);
-				msg.addByte(oldStackPos);
-				msg.addPosition(newPos);
+				PacketCreatureMove::write(msg, oldPos, oldStackPos, newPos);
 			}
 
 			if (newPos.z > oldPos.z)
@@ -5537,10 +5934,7 @@ void ProtocolGame::sendMoveCreature(const Creature *creature, const Position &ne
 		else
 		{
 			NetworkMessage msg;
-			msg.addByte(0x6D);
-			msg.addPosition(oldPos);
-			msg.addByte(oldStackPos);
-			msg.addPosition(newPos);
+			PacketCreatureMove::write(msg, oldPos, oldStackPos, newPos);
 			writeToOutputBuffer(msg);
 		}
 	}
@@ -5554,21 +5948,11 @@ void ProtocolGame::sendMoveCreature(const Creature *creature, const Position &ne
 	}
 }
 
-void ProtocolGame::sendInventoryItem(Slots_t slot, const Item *item)
+void ProtocolGame::sendInventoryItem(Slots_t slot, const Item *)
 {
-	NetworkMessage msg;
-	if (item)
-	{
-		msg.addByte(0x78);
-		msg.addByte(slot);
-		AddItem(msg, item);
-	}
-	else
-	{
-		msg.addByte(0x79);
-		msg.addByte(slot);
-	}
-	writeToOutputBuffer(msg);
+	// the item is read from the slot when flushing, it may be replaced or removed until then
+	deferredInventorySlots |= 1u << slot;
+	queueAutosend();
 }
 
 void ProtocolGame::sendInventoryIds()
@@ -5995,78 +6379,26 @@ void ProtocolGame::sendUseItemCooldown(uint32_t time)
 
 void ProtocolGame::sendOpenStore(uint8_t)
 {
-	NetworkMessage msg;
-
-	msg.addByte(0xFB); //open store
-	msg.addByte(0x00);
-
-	//add categories
-	auto categoriesCount = static_cast<uint16_t>(g_game().gameStore.getCategoryOffers().size());
-
-	msg.add<uint16_t>(categoriesCount);
-
-	for (const StoreCategory *category : g_game().gameStore.getCategoryOffers())
-	{
-		msg.addString(category->name);
-		msg.addString(category->description);
-
-		uint8_t stateByte;
-		switch (category->state)
-		{
-		case NORMAL:
-			stateByte = 0;
-			break;
-		case NEW:
-			stateByte = 1;
-			break;
-		case SALE:
-			stateByte = 2;
-			break;
-		case LIMITED_TIME:
-			stateByte = 3;
-			break;
-		default:
-			stateByte = 0;
-			break;
-		}
-		msg.addByte(stateByte);
-
-		msg.addByte((uint8_t)category->icons.size());
-		for (std::string iconStr : category->icons)
-		{
-			msg.addString(iconStr);
-		}
-		msg.addString(""); //TODO: parentCategory
+	const std::string& packet = g_game().gameStore.getOpenStorePacket();
+	if (packet.empty()) {
+		// the store failed to load
+		return;
 	}
 
+	NetworkMessage msg;
+	msg.addBytes(packet.data(), packet.size());
 	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendStoreCategoryOffers(StoreCategory *category)
 {
 	NetworkMessage msg;
-	msg.addByte(0xFC); //StoreOffers
-	msg.addString(category->name);
-	msg.add<uint16_t>(category->offers.size());
+	msg.addBytes(category->packetHeader.data(), category->packetHeader.size());
 
 	for (BaseOffer *offer : category->offers)
 	{
-		msg.add<uint32_t>(offer->id);
-		std::stringstream offername;
-		if (offer->type == Offer_t::ITEM || offer->type == Offer_t::STACKABLE_ITEM)
-		{
-			if (((ItemOffer *)offer)->count > 1)
-			{
-				offername << ((ItemOffer *)offer)->count << "x ";
-			}
-		}
-		offername << offer->name;
-
-		msg.addString(offername.str());
-		msg.addString(offer->description);
-
-		msg.add<uint32_t>(offer->price);
-		msg.addByte((uint8_t)offer->state);
+		// everything but the disabled fields is encoded by GameStore on load
+		msg.addBytes(offer->packetHead.data(), offer->packetHead.size());
 
 		//outfits
 		uint8_t disabled = 0;
@@ -6128,16 +6460,7 @@ void ProtocolGame::sendStoreCategoryOffers(StoreCategory *category)
 			msg.addString(disabledReason.str());
 		}
 
-		//add icons
-		msg.addByte((uint8_t)offer->icons.size());
-
-		for (std::string iconName : offer->icons)
-		{
-			msg.addString(iconName);
-		}
-
-		msg.add<uint16_t>(0);
-		//TODO: add support to suboffers
+		msg.addBytes(offer->packetTail.data(), offer->packetTail.size());
 	}
 
 	writeToOutputBuffer(msg);
@@ -6523,42 +6846,29 @@ void ProtocolGame::AddCreature(NetworkMessage &msg, const Creature *creature, bo
 
 void ProtocolGame::AddPlayerStats(NetworkMessage &msg)
 {
-	msg.addByte(0xA0);
-
-	msg.add<uint16_t>(std::min<int32_t>(player->getHealth(), std::numeric_limits<uint16_t>::max()));
-	msg.add<uint16_t>(std::min<int32_t>(player->getMaxHealth(), std::numeric_limits<uint16_t>::max()));
-
-	msg.add<uint32_t>(player->getFreeCapacity());
-
-	msg.add<uint64_t>(player->getExperience());
-
-	msg.add<uint16_t>(player->getLevel());
-	msg.addByte(player->getLevelPercent());
-
-	msg.add<uint16_t>(player->getBaseXpGain()); // base xp gain rate
-	msg.add<uint16_t>(player->getGrindingXpBoost()); // low level bonus
-	msg.add<uint16_t>(player->getStoreXpBoost()); // xp boost
-	msg.add<uint16_t>(player->getStaminaXpBoost()); // stamina multiplier (100 = 1.0x)
-
-	msg.add<uint16_t>(std::min<int32_t>(player->getMana(), std::numeric_limits<uint16_t>::max()));
-	msg.add<uint16_t>(std::min<int32_t>(player->getMaxMana(), std::numeric_limits<uint16_t>::max()));
-
-	msg.addByte(player->getSoul());
-
-	msg.add<uint16_t>(player->getStaminaMinutes());
-
-	msg.add<uint16_t>(player->getBaseSpeed() / 2);
-
 	Condition *condition = player->getCondition(CONDITION_REGENERATION, CONDITIONID_DEFAULT);
-	msg.add<uint16_t>(condition ? condition->getTicks() / 1000 : 0x00);
-
-	msg.add<uint16_t>(player->getOfflineTrainingTime() / 60 / 1000);
-
-	msg.add<uint16_t>(player->getExpBoostStamina()); // xp boost time (seconds)
-	msg.addByte(1); // enables exp boost in the store
-
-	msg.add<uint16_t>(player->getManaShield());  // remaining mana shield
-	msg.add<uint16_t>(player->getMaxManaShield());  // total mana shield
+	PacketPlayerStats::write(msg,
+		std::min<int32_t>(player->getHealth(), std::numeric_limits<uint16_t>::max()),
+		std::min<int32_t>(player->getMaxHealth(), std::numeric_limits<uint16_t>::max()),
+		player->getFreeCapacity(),
+		player->getExperience(),
+		player->getLevel(),
+		player->getLevelPercent(),
+		player->getBaseXpGain(), // base xp gain rate
+		player->getGrindingXpBoost(), // low level bonus
+		player->getStoreXpBoost(), // xp boost
+		player->getStaminaXpBoost(), // stamina multiplier (100 = 1.0x)
+		std::min<int32_t>(player->getMana(), std::numeric_limits<uint16_t>::max()),
+		std::min<int32_t>(player->getMaxMana(), std::numeric_limits<uint16_t>::max()),
+		player->getSoul(),
+		player->getStaminaMinutes(),
+		player->getBaseSpeed() / 2,
+		condition ? condition->getTicks() / 1000 : 0x00,
+		player->getOfflineTrainingTime() / 60 / 1000,
+		player->getExpBoostStamina(), // xp boost time (seconds)
+		1, // enables exp boost in the store
+		player->getManaShield(), // remaining mana shield
+		player->getMaxManaShield()); // total mana shield
 }
 
 void ProtocolGame::AddPlayerSkills(NetworkMessage &msg)
@@ -6625,7 +6935,7 @@ void ProtocolGame::addImbuementInfo(NetworkMessage &msg, uint16_t imbuementId) c
 	const CategoryImbuement *categoryImbuement = g_imbuements().getCategoryByID(imbuement->getCategory());
 
 	msg.add<uint32_t>(imbuementId);
-	msg.addString(baseImbuement->name + " " + imbuement->getName());
+	msg.addFormattedString("{} {}", baseImbuement->name, imbuement->getName());
 	msg.addString(imbuement->getDescription());
 	msg.addString(categoryImbuement->name + imbuement->getSubGroup());
 
@@ -6819,9 +7129,7 @@ void ProtocolGame::RemoveTileThing(NetworkMessage &msg, const Position &pos, uin
 		return;
 	}
 
-	msg.addByte(0x6C);
-	msg.addPosition(pos);
-	msg.addByte(stackpos);
+	PacketRemoveTileThing::write(msg, pos, stackpos);
 }
 
 void ProtocolGame::sendKillTrackerUpdate(Container *corpse, const std::string &name, const Outfit_t creatureOutfit)
@@ -7011,6 +7319,37 @@ void ProtocolGame::MoveUpCreature(NetworkMessage &msg, const Creature *creature,
 	GetMapDescription(oldPos.x - 8, oldPos.y - 6, newPos.z, 18, 1, msg);
 }
 
+void ProtocolGame::ScrollMapDescription(NetworkMessage &msg, const Position &oldPos, const Position &newPos)
+{
+	// the client moves its map centre one tile per message, the same steps as walking
+	int32_t x = oldPos.x;
+	int32_t y = oldPos.y;
+	while (y > newPos.y)
+	{
+		--y;
+		msg.addByte(0x65);
+		GetMapDescription(x - 8, y - 6, newPos.z, 18, 1, msg);
+	}
+	while (y < newPos.y)
+	{
+		++y;
+		msg.addByte(0x67);
+		GetMapDescription(x - 8, y + 7, newPos.z, 18, 1, msg);
+	}
+	while (x < newPos.x)
+	{
+		++x;
+		msg.addByte(0x66);
+		GetMapDescription(x + 9, y - 6, newPos.z, 1, 14, msg);
+	}
+	while (x > newPos.x)
+	{
+		--x;
+		msg.addByte(0x68);
+		GetMapDescription(x - 8, y - 6, newPos.z, 1, 14, msg);
+	}
+}
+
 void ProtocolGame::MoveDownCreature(NetworkMessage &msg, const Creature *creature, const Position &newPos, const Position &oldPos)
 {
 	if (creature != player)
@@ -7103,10 +7442,10 @@ void ProtocolGame::AddShopItem(NetworkMessage &msg, const ShopBlock &shopBlock)
 void ProtocolGame::parseExtendedOpcode(NetworkMessage &msg)
 {
 	uint8_t opcode = msg.getByte();
-	const std::string &buffer = msg.getString();
+	const std::string_view buffer = msg.getStringView();
 
 	// process additional opcodes via lua script event
-	addGameTask(&Game::parsePlayerExtendedOpcode, player->getID(), opcode, buffer);
+	addGameTask(&Game::parsePlayerExtendedOpcode, player->getID(), opcode, std::string(buffer));
 }
 
 void ProtocolGame::sendItemsPrice()
@@ -7146,8 +7485,7 @@ void ProtocolGame::reloadCreature(const Creature *creature)
 
 	NetworkMessage msg;
 
-	phmap::flat_hash_set<uint32_t>::iterator it = std::find(knownCreatureSet.begin(), knownCreatureSet.end(), creature->getID());
-	if (it != knownCreatureSet.end())
+	if (knownCreatureSet.contains(creature->getID()))
 	{
 		msg.addByte(0x6B);
 		msg.addPosition(creature->getPosition());
@@ -21,6 +21,7 @@
 #define SRC_SERVER_NETWORK_PROTOCOL_PROTOCOLGAME_H_
 
 #include "server/network/protocol/protocol.h"
+#include "server/network/protocol/known_creatures.hpp"
 #include "creatures/interactions/chat.h"
 #include "creatures/creature.h"
 
@@ -34,6 +35,7 @@ class Connection;
 class Quest;
 class ProtocolGame;
 class PreySlot;
+struct PlayerLoadContext;
 class TaskHuntingSlot;
 class TaskHuntingOption;
 using ProtocolGame_ptr = std::shared_ptr<ProtocolGame>;
@@ -67,15 +69,25 @@ public:
 	static const char *protocol_name() {
 		return "gameworld protocol";
 	}
+	const char* getMetricsName() const override {
+		return "game";
+	}
 
 	explicit ProtocolGame(Connection_ptr initConnection) : Protocol(initConnection) {}
 
-	void login(const std::string &name, uint32_t accnumber, OperatingSystem_t operatingSystem);
+	void login(const std::string &name, uint32_t accnumber, OperatingSystem_t operatingSystem, bool resumed = false);
 	void logout(bool displayEffect, bool forced);
 
 	void AddItem(NetworkMessage &msg, const Item *item);
 	void AddItem(NetworkMessage &msg, uint16_t id, uint8_t count, uint8_t tier);
 
+	// Packets that are the same for every viewer, Game encodes them once and hands the bytes to each client
+	static void AddMagicEffect(NetworkMessage &msg, const Position &pos, uint8_t type);
+	static void AddDistanceShoot(NetworkMessage &msg, const Position &from, const Position &to, uint8_t type);
+	static void AddCreatureSay(NetworkMessage &msg, const Creature *creature, SpeakClasses type, const std::string &text, const Position *pos);
+	static void AddToChannel(NetworkMessage &msg, const Creature *creature, SpeakClasses type, const std::string &text, uint16_t channelId);
+	static void AddChannelMessage(NetworkMessage &msg, const std::string &author, const std::string &text, SpeakClasses type, uint16_t channel);
+
 	uint16_t getVersion() const
 	{
 		return version;
@@ -93,8 +105,47 @@ private:
 		return std::static_pointer_cast<ProtocolGame>(shared_from_this());
 	}
 	void connect(uint32_t playerId, OperatingSystem_t operatingSystem);
+
+	/**
+	 * Body of a packet of which only the last one counts (turns, autowalk, looks).
+	 * While its dispatcher task is queued, newer packets of the same kind overwrite
+	 * it instead of queueing another task.
+	 */
+	struct CoalescedPacket
+	{
+		std::mutex mutex;
+		// the task started, later packets need a new one
+		bool dispatched = false;
+		uint8_t recvbyte = 0;
+		std::vector<uint8_t> body;
+	};
+
+	enum CoalescedPacket_t : uint8_t
+	{
+		COALESCED_PACKET_AUTOWALK,
+		COALESCED_PACKET_TURN,
+		COALESCED_PACKET_LOOK_AT,
+		COALESCED_PACKET_LOOK_IN_BATTLE_LIST,
+		COALESCED_PACKET_COUNT,
+		COALESCED_PACKET_NONE = COALESCED_PACKET_COUNT,
+	};
+
+	static CoalescedPacket_t getCoalescedPacketType(uint8_t recvbyte);
+	// network thread, false for packets too short for their opcode
+	static bool isValidPacket(uint8_t recvbyte, const NetworkMessage &msg);
+	// network thread, merges the packet into the queued one of its type when nothing else came in between, or queues a new task
+	void coalescePacket(CoalescedPacket_t type, uint8_t recvbyte, const NetworkMessage &msg);
+	void parseCoalescedPacket(const std::shared_ptr<CoalescedPacket> &packet);
+
+	// second half of login, once the database worker fetched the character
+	void onPlayerLoaded(PlayerLoadContext &context, uint32_t guid, OperatingSystem_t operatingSystem);
 	void disconnectClient(const std::string &message) const;
-	void writeToOutputBuffer(const NetworkMessage &msg);
+	// keepDeferred: the message does not touch what the client knows about creatures,
+	// the deferred creature updates may still be merged past it
+	void writeToOutputBuffer(const NetworkMessage &msg, bool keepDeferred = false);
+	void flushDeferredMessages() override;
+	void flushDeferredCreatureUpdates();
+	void flushDeferredPlayerUpdates();
 
 	void release() override;
 
@@ -165,7 +216,7 @@ private:
 	void parseBestiarysendCreatures(NetworkMessage &msg);
 	void BestiarysendCharms();
 	void sendBestiaryEntryChanged(uint16_t raceid);
-	void refreshBestiaryTracker(std::list<MonsterType *> trackerList);
+	void refreshBestiaryTracker(const std::list<MonsterType *> &trackerList);
 	void sendTeamFinderList();
 	void sendLeaderTeamFinder(bool reset);
 	void createLeaderTeamFinder(NetworkMessage &msg);
@@ -258,6 +309,7 @@ private:
 	void sendOpenPrivateChannel(const std::string &receiver);
 	void sendExperienceTracker(int64_t rawExp, int64_t finalExp);
 	void sendToChannel(const Creature *creature, SpeakClasses type, const std::string &text, uint16_t channelId);
+	void sendToChannel(const NetworkMessage &encoded);
 	void sendPrivateMessage(const Player *speaker, SpeakClasses type, const std::string &text);
 	void sendIcons(uint32_t icons);
 	void sendFYIBox(const std::string &message);
@@ -270,7 +322,9 @@ private:
 	void sendForgingData();
 
 	void sendDistanceShoot(const Position &from, const Position &to, uint8_t type);
+	void sendDistanceShoot(const NetworkMessage &encoded);
 	void sendMagicEffect(const Position &pos, uint8_t type);
+	void sendMagicEffect(const Position &pos, const NetworkMessage &encoded);
 	void sendRestingStatus(uint8_t protection);
 	void sendCreatureHealth(const Creature *creature);
 	void sendPartyCreatureUpdate(const Creature* target);
@@ -286,6 +340,7 @@ private:
 	void sendPingBack();
 	void sendCreatureTurn(const Creature *creature, uint32_t stackpos);
 	void sendCreatureSay(const Creature *creature, SpeakClasses type, const std::string &text, const Position *pos = nullptr);
+	void sendCreatureSay(const NetworkMessage &encoded);
 
 	// Unjust Panel
 	void sendUnjustifiedPoints(const uint8_t &dayProgress, const uint8_t &dayLeft, const uint8_t &weekProgress, const uint8_t &weekLeft, const uint8_t &monthProgress, const uint8_t &monthLeft, const uint8_t &skullDuration);
@@ -330,7 +385,7 @@ private:
 	void sendGameNews();
 	void sendResourcesBalance(uint64_t money = 0, uint64_t bank = 0, uint64_t preyCards = 0, uint64_t taskHunting = 0);
 	void sendResourceBalance(Resource_t resourceType, uint64_t value);
-	void sendSaleItemList(const std::vector<ShopBlock> &shopVector, const std::map<uint16_t, uint16_t> &inventoryMap);
+	void sendSaleItemList(const std::vector<uint16_t> &sellItemIds, const std::map<uint16_t, uint16_t> &inventoryMap);
 	void sendMarketEnter(uint32_t depotId);
 	void updateCoinBalance();
 	void sendMarketLeave();
@@ -428,6 +483,8 @@ private:
 
 	// translate a tile to clientreadable format
 	void GetTileDescription(const Tile *tile, NetworkMessage &msg);
+	// encoded item stack of a tile, nullptr if it cannot be cached
+	const TileDescriptionCache *getTileDescriptionCache(const Tile *tile);
 
 	// translate a floor to clientreadable format
 	void GetFloorDescription(NetworkMessage &msg, int32_t x, int32_t y, int32_t z,
@@ -454,6 +511,8 @@ private:
 
 	void MoveUpCreature(NetworkMessage &msg, const Creature *creature, const Position &newPos, const Position &oldPos);
 	void MoveDownCreature(NetworkMessage &msg, const Creature *creature, const Position &newPos, const Position &oldPos);
+	// scrolls the map of the client from oldPos to newPos on the same floor one row or column at a time
+	void ScrollMapDescription(NetworkMessage &msg, const Position &oldPos, const Position &newPos);
 
 	//shop
 	void AddHiddenShopItem(NetworkMessage &msg);
@@ -466,8 +525,33 @@ private:
 	void reloadCreature(const Creature *creature);
 
 	friend class Player;
+	friend class InputTrace;
+
+	KnownCreatures knownCreatureSet;
+	// health percent by creature id: the last sendCreatureHealth of each creature
+	// since the previous flush, so several changes in a tick go out as one update
+	std::vector<std::pair<uint32_t, uint8_t>> deferredCreatureHealth;
 
-	phmap::flat_hash_set<uint32_t> knownCreatureSet;
+	enum DeferredPlayerUpdate_t : uint8_t
+	{
+		DEFERRED_UPDATE_STATS = 1 << 0,
+		DEFERRED_UPDATE_SKILLS = 1 << 1,
+		DEFERRED_UPDATE_ICONS = 1 << 2,
+	};
+	// own player updates requested since the previous flush, they only go out once
+	// per dispatcher cycle with the state at that time, see OutputMessagePool::sendAll
+	uint8_t deferredPlayerUpdates = 0;
+	uint32_t deferredIcons = 0;
+	// one bit per Slots_t
+	uint32_t deferredInventorySlots = 0;
+	// network thread: the packets that can still take a newer one, by CoalescedPacket_t.
+	// Cleared by any packet of another kind so the merged ones never jump ahead of it
+	std::array<std::shared_ptr<CoalescedPacket>, COALESCED_PACKET_COUNT> openCoalescedPackets;
+	// body of the last sale list, the list is only resent when it changes
+	std::vector<uint8_t> lastSaleItemList;
+	// world light (level << 8 | color) and tibia time last sent, -1 for none
+	int32_t sentWorldLight = -1;
+	int32_t sentTibiaTime = -1;
 	Player *player = nullptr;
 
 	uint32_t eventConnect = 0;
@@ -479,6 +563,10 @@ private:
 
 	bool debugAssertSent = false;
 	bool acceptPackets = false;
+	// session of the game in the input trace, 0 = not recorded
+	uint32_t traceSessionId = 0;
+	// SessionResume token of this login, empty when resuming is off
+	std::string sessionToken;
 
 	bool loggedIn = false;
 	bool shouldAddExivaRestrictions = false;
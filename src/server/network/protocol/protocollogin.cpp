@@ -26,6 +26,64 @@
 #include "io/iologindata.h"
 #include "creatures/players/management/ban.h"
 #include "game/game.h"
+#include "database/databasetasks.h"
+#include "utils/log_rate_limiter.hpp"
+
+namespace {
+
+// bounds the cache, expired entries are dropped once it holds this many
+constexpr size_t LOGIN_CACHE_MAX_ENTRIES = 4096;
+
+// Account data of a recent successful login
+struct CachedCharacterList {
+	std::string password;
+	std::vector<account::Player> players;
+	uint32_t premiumDays = 0;
+	int64_t expiresAt = 0;
+};
+
+std::mutex characterListCacheLock;
+phmap::flat_hash_map<std::string, CachedCharacterList> characterListCache;
+
+bool getCachedCharacterList(const std::string& email, const std::string& password, CachedCharacterList& characterList)
+{
+	std::lock_guard<std::mutex> lockClass(characterListCacheLock);
+	auto it = characterListCache.find(email);
+	if (it == characterListCache.end()) {
+		return false;
+	}
+
+	if (it->second.expiresAt <= OTSYS_TIME()) {
+		characterListCache.erase(it);
+		return false;
+	}
+
+	// the password may have changed meanwhile, let the database decide
+	if (it->second.password != password) {
+		return false;
+	}
+
+	characterList = it->second;
+	return true;
+}
+
+void cacheCharacterList(const std::string& email, const CachedCharacterList& characterList)
+{
+	std::lock_guard<std::mutex> lockClass(characterListCacheLock);
+	if (characterListCache.size() >= LOGIN_CACHE_MAX_ENTRIES) {
+		int64_t now = OTSYS_TIME();
+		for (auto it = characterListCache.begin(); it != characterListCache.end();) {
+			if (it->second.expiresAt <= now) {
+				characterListCache.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+	characterListCache[email] = characterList;
+}
+
+}  // namespace
 
 void ProtocolLogin::disconnectClient(const std::string& message, uint16_t version)
 {
@@ -38,16 +96,45 @@ void ProtocolLogin::disconnectClient(const std::string& message, uint16_t versio
 	disconnect();
 }
 
-void ProtocolLogin::getCharacterList(const std::string& email, const std::string& password, uint16_t version)
+void ProtocolLogin::getCharacterList(const std::string& email, const std::string& password, uint16_t version, Database& db)
 {
-	account::Account account;
-	if (!IOLoginData::authenticateAccountPassword(email, password, &account)) {
-		disconnectClient("Email or password is not correct", version);
-		return;
-	}
+	int64_t cacheTime = g_configManager().getNumber(LOGIN_CACHE_TIME);
+	std::string passwordHash = transformToSHA1(password);
+
+	CachedCharacterList characterList;
+	if (cacheTime <= 0 || !getCachedCharacterList(email, passwordHash, characterList)) {
+		account::Account account;
+		Database* readDb = &db.getReadConnection();
+		account.SetDatabaseInterface(readDb);
+		bool authenticated = IOLoginData::authenticateAccountPassword(email, password, &account);
+
+		uint32_t accountId = 0;
+		account.GetID(&accountId);
+		// the replica may not have a new account or a changed password yet, and a recently saved account is read from the primary
+		if (readDb != &db && (!authenticated || &db.getReadConnection(Database::getAccountKey(accountId)) == &db)) {
+			readDb = &db;
+			account.SetDatabaseInterface(readDb);
+			authenticated = IOLoginData::authenticateAccountPassword(email, password, &account);
+		}
 
-	// Update premium days
-	Game::updatePremium(account);
+		if (!authenticated) {
+			disconnectClient("Email or password is not correct", version);
+			return;
+		}
+
+		// Update premium days, it writes to the account
+		account.SetDatabaseInterface(&db);
+		Game::updatePremium(account);
+
+		account.SetDatabaseInterface(readDb);
+		account.GetAccountPlayers(&characterList.players);
+		account.GetPremiumRemaningDays(&characterList.premiumDays);
+		if (cacheTime > 0) {
+			characterList.password = passwordHash;
+			characterList.expiresAt = OTSYS_TIME() + cacheTime * 1000;
+			cacheCharacterList(email, characterList);
+		}
+	}
 
 	auto output = OutputMessagePool::getOutputMessage();
 	const std::string& motd = g_configManager().getString(MOTD);
@@ -62,11 +149,10 @@ void ProtocolLogin::getCharacterList(const std::string& email, const std::string
 
 	// Add session key
 	output->addByte(0x28);
-	output->addString(email + "\n" + password);
+	output->addFormattedString("{}\n{}", email, password);
 
 	// Add char list
-	std::vector<account::Player> players;
-	account.GetAccountPlayers(&players);
+	const std::vector<account::Player>& players = characterList.players;
 	output->addByte(0x64);
 
 	output->addByte(1);  // number of worlds
@@ -93,10 +179,8 @@ void ProtocolLogin::getCharacterList(const std::string& email, const std::string
 		output->addByte(1);
 		output->add<uint32_t>(0);
 	} else {
-	uint32_t days;
-	account.GetPremiumRemaningDays(&days);
 	output->addByte(0);
-	output->add<uint32_t>(time(nullptr) + (days * 86400));
+	output->add<uint32_t>(time(nullptr) + (characterList.premiumDays * 86400));
   }
 
 	send(output);
@@ -124,7 +208,7 @@ void ProtocolLogin::onRecvFirstMessage(NetworkMessage& msg)
 	 */
 
 	if (!Protocol::RSA_decrypt(msg)) {
-		SPDLOG_WARN("[ProtocolLogin::onRecvFirstMessage] - RSA Decrypt Failed");
+		SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[ProtocolLogin::onRecvFirstMessage] - RSA Decrypt Failed");
 		disconnect();
 		return;
 	}
@@ -174,6 +258,16 @@ void ProtocolLogin::onRecvFirstMessage(NetworkMessage& msg)
 		return;
 	}
 
+	// the login server needs nothing from the game world, keep the dispatcher out of it
 	auto thisPtr = std::static_pointer_cast<ProtocolLogin>(shared_from_this());
-	g_dispatcher().addTask(createTask(std::bind(&ProtocolLogin::getCharacterList, thisPtr, email, password, version)));
+	uint32_t orderKey = static_cast<uint32_t>(std::hash<std::string> {}(email));
+	auto login = [thisPtr, email, password, version](Database& db) {
+		thisPtr->getCharacterList(email, password, version, db);
+		return true;
+	};
+	if (!g_databaseTasks().addTask(login, nullptr, orderKey)) {
+		g_dispatcher().addTask(createTask([thisPtr, email, password, version]() {
+			thisPtr->getCharacterList(email, password, version, Database::getInstance());
+		}));
+	}
 }
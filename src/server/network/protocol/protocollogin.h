@@ -22,6 +22,7 @@
 
 #include "server/network/protocol/protocol.h"
 
+class Database;
 class NetworkMessage;
 class OutputMessage;
 
@@ -35,6 +36,9 @@ class ProtocolLogin : public Protocol
 		static const char* protocol_name() {
 			return "login protocol";
 		}
+		const char* getMetricsName() const override {
+			return "login";
+		}
 
 		explicit ProtocolLogin(Connection_ptr loginConnection) : Protocol(loginConnection) {}
 
@@ -43,7 +47,8 @@ class ProtocolLogin : public Protocol
 	private:
 		void disconnectClient(const std::string& message, uint16_t version);
 
-		void getCharacterList(const std::string& accountName, const std::string& password, uint16_t version);
+		// runs on a database worker, with its connection
+		void getCharacterList(const std::string& accountName, const std::string& password, uint16_t version, Database& db);
 };
 
 #endif  // SRC_SERVER_NETWORK_PROTOCOL_PROTOCOLLOGIN_H_
@@ -23,36 +23,48 @@
 
 #include "server/network/protocol/protocolstatus.h"
 #include "game/game.h"
-#include "game/scheduling/tasks.h"
+#include "game/scheduling/scheduler.h"
 #include "server/network/message/outputmessage.h"
 
 std::map<uint32_t, int64_t> ProtocolStatus::ipConnectMap;
+std::mutex ProtocolStatus::ipConnectMapLock;
+std::shared_ptr<const StatusSnapshot> ProtocolStatus::snapshot;
+std::mutex ProtocolStatus::snapshotLock;
 const uint64_t ProtocolStatus::start = OTSYS_TIME();
 
+namespace {
+
+std::string getMessageBytes(const NetworkMessage& msg)
+{
+	return std::string(reinterpret_cast<const char*>(msg.getBuffer()) + NetworkMessage::INITIAL_BUFFER_POSITION, msg.getLength());
+}
+
+}  // namespace
+
 void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 {
 	uint32_t ip = getIP();
-	if (ip != 0x0100007F) {
-		std::string ipStr = convertIPToString(ip);
-		if (ipStr != g_configManager().getString(IP)) {
-			std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
-			if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_configManager().getNumber(STATUSQUERY_TIMEOUT)))) {
-				disconnect();
-				return;
+	{
+		std::lock_guard<std::mutex> lockClass(ipConnectMapLock);
+		if (ip != 0x0100007F) {
+			std::string ipStr = convertIPToString(ip);
+			if (ipStr != g_configManager().getString(IP)) {
+				std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
+				if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_configManager().getNumber(STATUSQUERY_TIMEOUT)))) {
+					disconnect();
+					return;
+				}
 			}
 		}
-	}
 
-	ipConnectMap[ip] = OTSYS_TIME();
+		ipConnectMap[ip] = OTSYS_TIME();
+	}
 
 	switch (msg.getByte()) {
 		//XML info protocol
 		case 0xFF: {
-			if (msg.getString(4) == "info") {
-				g_dispatcher().addTask(createTask(std::bind(
-                                     &ProtocolStatus::sendStatusString,
-                                     std::static_pointer_cast<
-                                     ProtocolStatus>(shared_from_this()))));
+			if (msg.getStringView(4) == "info") {
+				sendStatusString();
 				return;
 			}
 			break;
@@ -65,8 +77,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 			if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
 				characterName = msg.getString();
 			}
-			g_dispatcher().addTask(createTask(std::bind(&ProtocolStatus::sendInfo, std::static_pointer_cast<ProtocolStatus>(shared_from_this()),
-                                  requestedInfo, characterName)));
+			sendInfo(requestedInfo, characterName);
 			return;
 		}
 
@@ -76,11 +87,21 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 	disconnect();
 }
 
-void ProtocolStatus::sendStatusString()
+void ProtocolStatus::startSnapshots()
 {
-	auto output = OutputMessagePool::getOutputMessage();
+	updateSnapshot();
+	g_scheduler().addEvent(createSchedulerTask(STATUS_SNAPSHOT_INTERVAL, &ProtocolStatus::startSnapshots));
+}
 
-	setRawMessages(true);
+std::shared_ptr<const StatusSnapshot> ProtocolStatus::getSnapshot()
+{
+	std::lock_guard<std::mutex> lockClass(snapshotLock);
+	return snapshot;
+}
+
+void ProtocolStatus::updateSnapshot()
+{
+	auto newSnapshot = std::make_shared<StatusSnapshot>();
 
 	pugi::xml_document doc;
 
@@ -91,8 +112,8 @@ void ProtocolStatus::sendStatusString()
 	tsqp.append_attribute("version") = "1.0";
 
 	pugi::xml_node serverinfo = tsqp.append_child("serverinfo");
-	uint64_t uptime = (OTSYS_TIME() - ProtocolStatus::start) / 1000;
-	serverinfo.append_attribute("uptime") = std::to_string(uptime).c_str();
+	// placeholder, split off below
+	serverinfo.append_attribute("uptime") = "0";
 	serverinfo.append_attribute("ip") = g_configManager().getString(IP).c_str();
 	serverinfo.append_attribute("servername") = g_configManager().getString(SERVER_NAME).c_str();
 	serverinfo.append_attribute("port") = std::to_string(g_configManager().getNumber(LOGIN_PORT)).c_str();
@@ -156,67 +177,126 @@ void ProtocolStatus::sendStatusString()
 	doc.save(ss, "", pugi::format_raw);
 
 	std::string data = ss.str();
-	output->addBytes(data.c_str(), data.size());
+	const std::string uptimeAttribute = "uptime=\"";
+	size_t uptimePos = data.find(uptimeAttribute) + uptimeAttribute.size();
+	newSnapshot->xmlHead = data.substr(0, uptimePos);
+	newSnapshot->xmlTail = data.substr(uptimePos + 1);
+
+	NetworkMessage msg;
+	msg.addByte(0x10);
+	msg.addString(g_configManager().getString(SERVER_NAME));
+	msg.addString(g_configManager().getString(IP));
+	msg.addFormattedString("{}", g_configManager().getNumber(LOGIN_PORT));
+	newSnapshot->basicInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x11);
+	msg.addString(g_configManager().getString(OWNER_NAME));
+	msg.addString(g_configManager().getString(OWNER_EMAIL));
+	newSnapshot->ownerInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x12);
+	msg.addString(g_configManager().getString(MOTD));
+	msg.addString(g_configManager().getString(LOCATION));
+	msg.addString(g_configManager().getString(URL));
+	newSnapshot->miscInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x20);
+	msg.add<uint32_t>(static_cast<uint32_t>(g_game().getPlayersOnline()));
+	msg.add<uint32_t>(g_configManager().getNumber(MAX_PLAYERS));
+	msg.add<uint32_t>(g_game().getPlayersRecord());
+	newSnapshot->playersInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x30);
+	msg.addString(g_configManager().getString(MAP_NAME));
+	msg.addString(g_configManager().getString(MAP_AUTHOR));
+	msg.add<uint16_t>(mapWidth);
+	msg.add<uint16_t>(mapHeight);
+	newSnapshot->mapInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x21); // players info - online players list
+	const auto& onlinePlayers = g_game().getPlayers();
+	msg.add<uint32_t>(onlinePlayers.size());
+	for (const auto& it : onlinePlayers) {
+		msg.addString(it.second->getName());
+		msg.add<uint32_t>(it.second->getLevel());
+		newSnapshot->playerNames.insert(asLowerCaseString(it.second->getName()));
+	}
+	newSnapshot->extPlayersInfo = getMessageBytes(msg);
+
+	msg.reset();
+	msg.addByte(0x23); // server software info
+	msg.addString(STATUS_SERVER_NAME);
+	msg.addString(STATUS_SERVER_VERSION);
+	msg.addFormattedString("{}.{}", CLIENT_VERSION_UPPER, CLIENT_VERSION_LOWER);
+	newSnapshot->softwareInfo = getMessageBytes(msg);
+
+	std::lock_guard<std::mutex> lockClass(snapshotLock);
+	snapshot = std::move(newSnapshot);
+}
+
+void ProtocolStatus::sendStatusString()
+{
+	auto current = getSnapshot();
+	if (!current) {
+		disconnect();
+		return;
+	}
+
+	auto output = OutputMessagePool::getOutputMessage();
+
+	setRawMessages(true);
+
+	std::string uptime = std::to_string((OTSYS_TIME() - ProtocolStatus::start) / 1000);
+	output->addBytes(current->xmlHead.data(), current->xmlHead.size());
+	output->addBytes(uptime.data(), uptime.size());
+	output->addBytes(current->xmlTail.data(), current->xmlTail.size());
 	send(output);
 	disconnect();
 }
 
 void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& characterName)
 {
+	auto current = getSnapshot();
+	if (!current) {
+		disconnect();
+		return;
+	}
+
 	auto output = OutputMessagePool::getOutputMessage();
 
 	if (requestedInfo & REQUEST_BASIC_SERVER_INFO) {
-		output->addByte(0x10);
-		output->addString(g_configManager().getString(SERVER_NAME));
-		output->addString(g_configManager().getString(IP));
-		output->addString(std::to_string(g_configManager().getNumber(LOGIN_PORT)));
+		output->addBytes(current->basicInfo.data(), current->basicInfo.size());
 	}
 
 	if (requestedInfo & REQUEST_OWNER_SERVER_INFO) {
-		output->addByte(0x11);
-		output->addString(g_configManager().getString(OWNER_NAME));
-		output->addString(g_configManager().getString(OWNER_EMAIL));
+		output->addBytes(current->ownerInfo.data(), current->ownerInfo.size());
 	}
 
 	if (requestedInfo & REQUEST_MISC_SERVER_INFO) {
-		output->addByte(0x12);
-		output->addString(g_configManager().getString(MOTD));
-		output->addString(g_configManager().getString(LOCATION));
-		output->addString(g_configManager().getString(URL));
+		output->addBytes(current->miscInfo.data(), current->miscInfo.size());
 		output->add<uint64_t>((OTSYS_TIME() - ProtocolStatus::start) / 1000);
 	}
 
 	if (requestedInfo & REQUEST_PLAYERS_INFO) {
-		output->addByte(0x20);
-		output->add<uint32_t>(static_cast<uint32_t>(g_game().getPlayersOnline()));
-		output->add<uint32_t>(g_configManager().getNumber(MAX_PLAYERS));
-		output->add<uint32_t>(g_game().getPlayersRecord());
+		output->addBytes(current->playersInfo.data(), current->playersInfo.size());
 	}
 
 	if (requestedInfo & REQUEST_MAP_INFO) {
-		output->addByte(0x30);
-		output->addString(g_configManager().getString(MAP_NAME));
-		output->addString(g_configManager().getString(MAP_AUTHOR));
-		uint32_t mapWidth, mapHeight;
-		g_game().getMapDimensions(mapWidth, mapHeight);
-		output->add<uint16_t>(mapWidth);
-		output->add<uint16_t>(mapHeight);
+		output->addBytes(current->mapInfo.data(), current->mapInfo.size());
 	}
 
 	if (requestedInfo & REQUEST_EXT_PLAYERS_INFO) {
-		output->addByte(0x21); // players info - online players list
-
-		const auto& players = g_game().getPlayers();
-		output->add<uint32_t>(players.size());
-		for (const auto& it : players) {
-			output->addString(it.second->getName());
-			output->add<uint32_t>(it.second->getLevel());
-		}
+		output->addBytes(current->extPlayersInfo.data(), current->extPlayersInfo.size());
 	}
 
 	if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
 		output->addByte(0x22); // players info - online status info of a player
-		if (g_game().getPlayerByName(characterName) != nullptr) {
+		if (current->playerNames.count(asLowerCaseString(characterName)) != 0) {
 			output->addByte(0x01);
 		} else {
 			output->addByte(0x00);
@@ -224,10 +304,7 @@ void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& charact
 	}
 
 	if (requestedInfo & REQUEST_SERVER_SOFTWARE_INFO) {
-		output->addByte(0x23); // server software info
-		output->addString(STATUS_SERVER_NAME);
-		output->addString(STATUS_SERVER_VERSION);
-		output->addString(std::to_string(CLIENT_VERSION_UPPER) + "." + std::to_string(CLIENT_VERSION_LOWER));
+		output->addBytes(current->softwareInfo.data(), current->softwareInfo.size());
 	}
 	send(output);
 	disconnect();
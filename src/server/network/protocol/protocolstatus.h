@@ -23,6 +23,32 @@
 #include "server/network/message/networkmessage.h"
 #include "server/network/protocol/protocol.h"
 
+// status answers are served from this copy, rebuilt every STATUS_SNAPSHOT_INTERVAL ms
+static constexpr int32_t STATUS_SNAPSHOT_INTERVAL = 5000;
+
+/**
+ * Pre-serialized status responses, built on the dispatcher and read by the
+ * network threads. The uptime is filled in when a response is sent.
+ */
+struct StatusSnapshot {
+	// the XML document around the uptime attribute value
+	std::string xmlHead;
+	std::string xmlTail;
+
+	// sections of the info protocol, see the REQUEST_* flags
+	std::string basicInfo;
+	std::string ownerInfo;
+	// without the uptime at its end
+	std::string miscInfo;
+	std::string playersInfo;
+	std::string mapInfo;
+	std::string extPlayersInfo;
+	std::string softwareInfo;
+
+	// lower case names of the players online
+	std::unordered_set<std::string> playerNames;
+};
+
 class ProtocolStatus final : public Protocol
 {
 	public:
@@ -33,6 +59,9 @@ class ProtocolStatus final : public Protocol
 		static const char* protocol_name() {
 			return "status protocol";
 		}
+		const char* getMetricsName() const override {
+			return "status";
+		}
 
 		explicit ProtocolStatus(Connection_ptr conn) : Protocol(conn) {}
 
@@ -43,8 +72,19 @@ class ProtocolStatus final : public Protocol
 
 		static const uint64_t start;
 
+		// dispatcher thread, builds the first snapshot and keeps refreshing it
+		static void startSnapshots();
+
 	private:
+		static void updateSnapshot();
+		static std::shared_ptr<const StatusSnapshot> getSnapshot();
+
+		static std::shared_ptr<const StatusSnapshot> snapshot;
+		static std::mutex snapshotLock;
+
 		static std::map<uint32_t, int64_t> ipConnectMap;
+		// status queries are read on every network thread
+		static std::mutex ipConnectMapLock;
 };
 
 #endif  // SRC_SERVER_NETWORK_PROTOCOL_PROTOCOLSTATUS_H_
@@ -0,0 +1,119 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "server/network/protocol/session_resume.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+int64_t getSteadyMillis()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the tokens of one run mean nothing to the next
+const std::string& getTokenSalt()
+{
+	static const std::string salt = std::to_string(std::random_device()()) + std::to_string(std::random_device()());
+	return salt;
+}
+
+}  // namespace
+
+std::string SessionResume::getToken(const std::string& sessionKey, const std::string& characterName) const
+{
+	if (g_configManager().getNumber(SESSION_RESUME_TIME) <= 0) {
+		return {};
+	}
+	return transformToSHA1(getTokenSalt() + '\n' + sessionKey + '\n' + asLowerCaseString(characterName));
+}
+
+bool SessionResume::resume(const std::string& token, uint32_t ip, uint32_t& accountId)
+{
+	if (token.empty()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lockClass(sessionsLock);
+	auto it = sessions.find(token);
+	if (it == sessions.end()) {
+		return false;
+	}
+
+	const Session& session = it->second;
+	if (session.expires != 0 && session.expires < getSteadyMillis()) {
+		tokens.erase(session.guid);
+		sessions.erase(it);
+		return false;
+	}
+
+	if (session.ip != ip) {
+		return false;
+	}
+
+	accountId = session.accountId;
+	return true;
+}
+
+void SessionResume::issue(const std::string& token, uint32_t guid, uint32_t accountId, uint32_t ip)
+{
+	if (token.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lockClass(sessionsLock);
+	auto it = tokens.find(guid);
+	if (it != tokens.end() && it->second != token) {
+		// logged in again with another session key
+		sessions.erase(it->second);
+	}
+
+	tokens[guid] = token;
+	sessions[token] = { guid, accountId, ip, 0 };
+}
+
+void SessionResume::disconnected(uint32_t guid)
+{
+	std::lock_guard<std::mutex> lockClass(sessionsLock);
+	auto it = tokens.find(guid);
+	if (it == tokens.end()) {
+		return;
+	}
+
+	auto session = sessions.find(it->second);
+	if (session != sessions.end()) {
+		session->second.expires = getSteadyMillis() + g_configManager().getNumber(SESSION_RESUME_TIME) * 1000;
+	}
+}
+
+void SessionResume::remove(uint32_t guid)
+{
+	std::lock_guard<std::mutex> lockClass(sessionsLock);
+	auto it = tokens.find(guid);
+	if (it == tokens.end()) {
+		return;
+	}
+
+	sessions.erase(it->second);
+	tokens.erase(it);
+}
@@ -0,0 +1,86 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_SERVER_NETWORK_PROTOCOL_SESSION_RESUME_HPP_
+#define SRC_SERVER_NETWORK_PROTOCOL_SESSION_RESUME_HPP_
+
+#include <mutex>
+#include <string>
+
+#include <parallel_hashmap/phmap.h>
+
+/**
+ * Game sessions a client may come back to without authenticating again.
+ * A successful login issues a token for the session key, character and IP
+ * the client logged in with. While that character stays in the world, and for
+ * sessionResumeTime seconds after its connection dropped, the same login
+ * resumes the session: the account query is skipped and the new connection
+ * takes the player over at once instead of waiting for the old one to close.
+ * Only a hash of the session key is kept.
+ */
+class SessionResume
+{
+	public:
+		SessionResume() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		SessionResume(const SessionResume&) = delete;
+		SessionResume& operator=(const SessionResume&) = delete;
+
+		static SessionResume& getInstance() {
+			// Guaranteed to be destroyed
+			static SessionResume instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// network thread, empty when resuming is off
+		std::string getToken(const std::string& sessionKey, const std::string& characterName) const;
+
+		/**
+		 * network thread
+		 * \returns whether the token belongs to a live session of this IP, with its account in accountId
+		 */
+		bool resume(const std::string& token, uint32_t ip, uint32_t& accountId);
+
+		// dispatcher thread
+		void issue(const std::string& token, uint32_t guid, uint32_t accountId, uint32_t ip);
+		// the resume window starts
+		void disconnected(uint32_t guid);
+		// the character left the world, there is nothing to resume
+		void remove(uint32_t guid);
+
+	private:
+		struct Session {
+			uint32_t guid;
+			uint32_t accountId;
+			uint32_t ip;
+			// steady clock milliseconds, 0 while connected
+			int64_t expires;
+		};
+
+		std::mutex sessionsLock;
+		phmap::flat_hash_map<std::string, Session> sessions;
+		phmap::flat_hash_map<uint32_t, std::string> tokens;
+};
+
+constexpr auto g_sessionResume = &SessionResume::getInstance;
+
+#endif  // SRC_SERVER_NETWORK_PROTOCOL_SESSION_RESUME_HPP_
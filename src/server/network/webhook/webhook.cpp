@@ -21,39 +21,315 @@
 
 #include "server/network/webhook/webhook.h"
 #include "config/configmanager.h"
+#include "utils/thread_holder_base.h"
 
 // Tread no further, adventurer!
 // Go back while you still can.
 
-static bool init = false;
-static curl_slist *headers = NULL;
+static constexpr size_t WEBHOOK_QUEUE_CAPACITY = 256;
+// simultaneous requests, the connections are kept alive and reused by the multi handle
+static constexpr size_t WEBHOOK_MAX_REQUESTS = 4;
+// discord takes at most 10 embeds per message
+static constexpr size_t WEBHOOK_MAX_EMBEDS = 10;
+static constexpr uint32_t WEBHOOK_MAX_ATTEMPTS = 4;
+static constexpr std::chrono::milliseconds WEBHOOK_RETRY_DELAY {1000};
+static constexpr long WEBHOOK_REQUEST_TIMEOUT = 10;
 
-void webhook_init() {
+namespace {
+
+struct WebhookTask {
+	std::string title;
+	std::string message;
+	int color;
+	std::string url;
+	time_t time;
+	uint32_t attempts = 0;
+	std::chrono::steady_clock::time_point due;
+};
+
+struct WebhookRequest {
+	CURL* curl = nullptr;
+	std::string payload;
+	std::string response;
+	std::vector<WebhookTask> tasks;
+};
+
+class WebhookWorker : public ThreadHolder<WebhookWorker>
+{
+	public:
+		~WebhookWorker() {
+			shutdown();
+		}
+
+		bool init();
+		void addTask(WebhookTask&& task);
+		void shutdown();
+
+		void threadMain();
+
+	private:
+		bool waitForWork(std::unique_lock<std::mutex>& lock);
+		void startRequests();
+		void finishRequests();
+		void retry(std::vector<WebhookTask>& failed);
+
+		// shared with the threads sending messages
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+		std::deque<WebhookTask> tasks;
+
+		// webhook thread only
+		CURLM* multi = nullptr;
+		curl_slist* headers = nullptr;
+		std::deque<WebhookTask> pending;
+		std::vector<WebhookTask> retries;
+		std::vector<std::unique_ptr<WebhookRequest>> requests;
+		std::vector<CURL*> idleHandles;
+};
+
+WebhookWorker worker;
+
+std::string get_payload(const std::vector<WebhookTask>& tasks);
+
+size_t write_response(char* data, size_t size, size_t count, void* userdata)
+{
+	static_cast<std::string*>(userdata)->append(data, size * count);
+	return size * count;
+}
+
+bool WebhookWorker::init()
+{
 	if (curl_global_init(CURL_GLOBAL_ALL) != 0) {
 		SPDLOG_ERROR("Failed to init curl, no webhook messages may be sent");
-		return;
+		return false;
 	}
 
 	headers = curl_slist_append(headers, "content-type: application/json");
 	headers = curl_slist_append(headers, "accept: application/json");
 	if (headers == NULL) {
 		SPDLOG_ERROR("Failed to init curl, appending request headers failed");
-		return;
+		return false;
 	}
 
-	init = true;
+	multi = curl_multi_init();
+	if (!multi) {
+		SPDLOG_ERROR("Failed to init curl, curl_multi_init failed");
+		return false;
+	}
+
+	start();
+	return true;
 }
 
-static int webhook_send_message_(const char *url, const char *payload, std::string *response_body);
-static std::string get_payload(std::string title, std::string message, int color);
+void WebhookWorker::addTask(WebhookTask&& task)
+{
+	bool signal = false;
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		if (getState() != THREAD_STATE_RUNNING) {
+			SPDLOG_ERROR("Failed to send webhook message; Did not (successfully) init");
+			return;
+		}
 
-void webhook_send_message(std::string title, std::string message, int color, std::string url) {
-	if (url.empty()) {
-		return;
+		if (tasks.size() >= WEBHOOK_QUEUE_CAPACITY) {
+			SPDLOG_ERROR("Failed to send webhook message; queue is full, dropping: {}", task.title);
+			return;
+		}
+
+		signal = tasks.empty();
+		tasks.emplace_back(std::move(task));
+	}
+
+	if (signal) {
+		taskSignal.notify_one();
+	}
+}
+
+void WebhookWorker::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		if (getState() != THREAD_STATE_RUNNING) {
+			return;
+		}
+		setState(THREAD_STATE_CLOSING);
+	}
+	taskSignal.notify_one();
+	join();
+}
+
+void WebhookWorker::threadMain()
+{
+	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	while (true) {
+		taskLockUnique.lock();
+		if (!waitForWork(taskLockUnique)) {
+			taskLockUnique.unlock();
+			break;
+		}
+
+		std::move(tasks.begin(), tasks.end(), std::back_inserter(pending));
+		tasks.clear();
+		taskLockUnique.unlock();
+
+		auto now = std::chrono::steady_clock::now();
+		auto due = std::stable_partition(retries.begin(), retries.end(), [now](const WebhookTask& task) {
+			return task.due > now;
+		});
+		std::move(due, retries.end(), std::back_inserter(pending));
+		retries.erase(due, retries.end());
+
+		startRequests();
+		if (requests.empty()) {
+			continue;
+		}
+
+		int running;
+		curl_multi_perform(multi, &running);
+		finishRequests();
+		if (!requests.empty()) {
+			curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+		}
+	}
+
+	for (CURL* curl : idleHandles) {
+		curl_easy_cleanup(curl);
+	}
+	idleHandles.clear();
+	curl_multi_cleanup(multi);
+	multi = nullptr;
+	setState(THREAD_STATE_TERMINATED);
+}
+
+bool WebhookWorker::waitForWork(std::unique_lock<std::mutex>& lock)
+{
+	// returns false once closing and everything but the retries went out
+	while (tasks.empty() && pending.empty() && requests.empty()) {
+		if (getState() != THREAD_STATE_RUNNING) {
+			if (!retries.empty()) {
+				SPDLOG_WARN("Dropping {} webhook messages waiting for a retry", retries.size());
+				retries.clear();
+			}
+			return false;
+		}
+
+		if (retries.empty()) {
+			taskSignal.wait(lock);
+			continue;
+		}
+
+		auto next = std::min_element(retries.begin(), retries.end(), [](const WebhookTask& lhs, const WebhookTask& rhs) {
+			return lhs.due < rhs.due;
+		})->due;
+		if (taskSignal.wait_until(lock, next) == std::cv_status::timeout) {
+			break;
+		}
 	}
+	return true;
+}
+
+void WebhookWorker::startRequests()
+{
+	while (!pending.empty() && requests.size() < WEBHOOK_MAX_REQUESTS) {
+		auto request = std::make_unique<WebhookRequest>();
+		// consecutive messages to the same url go out as one message with several embeds
+		const std::string url = pending.front().url;
+		while (!pending.empty() && pending.front().url == url && request->tasks.size() < WEBHOOK_MAX_EMBEDS) {
+			request->tasks.emplace_back(std::move(pending.front()));
+			pending.pop_front();
+		}
+		request->payload = get_payload(request->tasks);
+
+		if (!idleHandles.empty()) {
+			request->curl = idleHandles.back();
+			idleHandles.pop_back();
+		} else if (!(request->curl = curl_easy_init())) {
+			SPDLOG_ERROR("Failed to send webhook message; curl_easy_init failed");
+			continue;
+		}
+
+		CURL* curl = request->curl;
+		curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+		curl_easy_setopt(curl, CURLOPT_POST, 1L);
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->payload.c_str());
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request->payload.size()));
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response);
+		curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void *>(&request->response));
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+		curl_easy_setopt(curl, CURLOPT_USERAGENT, "canary (https://github.com/Hydractify/canary)");
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT, WEBHOOK_REQUEST_TIMEOUT);
+		curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(curl, CURLOPT_PRIVATE, request.get());
+		curl_multi_add_handle(multi, curl);
+		requests.emplace_back(std::move(request));
+	}
+}
+
+void WebhookWorker::finishRequests()
+{
+	int queued;
+	while (CURLMsg* info = curl_multi_info_read(multi, &queued)) {
+		if (info->msg != CURLMSG_DONE) {
+			continue;
+		}
+
+		CURL* curl = info->easy_handle;
+		WebhookRequest* request = nullptr;
+		curl_easy_getinfo(curl, CURLINFO_PRIVATE, &request);
+
+		long response_code = -1;
+		if (info->data.result == CURLE_OK) {
+			curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+		} else {
+			SPDLOG_ERROR("Failed to send webhook message with the error: {}",
+                         curl_easy_strerror(info->data.result));
+		}
+
+		curl_multi_remove_handle(multi, curl);
+		idleHandles.push_back(curl);
+
+		if (response_code == 429 || response_code >= 500 || response_code == -1) {
+			retry(request->tasks);
+		} else if (response_code < 200 || response_code >= 300) {
+			SPDLOG_ERROR("Failed to send webhook message; "
+                         "HTTP request failed with code: {}"
+                         "response body: {} request body: {}",
+                         response_code, request->response, request->payload);
+		}
 
-	if (!init) {
-		SPDLOG_ERROR("Failed to send webhook message; Did not (successfully) init");
+		auto it = std::find_if(requests.begin(), requests.end(), [request](const auto& entry) {
+			return entry.get() == request;
+		});
+		if (it != requests.end()) {
+			*it = std::move(requests.back());
+			requests.pop_back();
+		}
+	}
+}
+
+void WebhookWorker::retry(std::vector<WebhookTask>& failed)
+{
+	auto now = std::chrono::steady_clock::now();
+	for (WebhookTask& task : failed) {
+		if (++task.attempts >= WEBHOOK_MAX_ATTEMPTS) {
+			SPDLOG_ERROR("Failed to send webhook message after {} attempts: {}", task.attempts, task.title);
+			continue;
+		}
+
+		// backs off 1, 2, 4 seconds
+		task.due = now + WEBHOOK_RETRY_DELAY * (1 << (task.attempts - 1));
+		retries.emplace_back(std::move(task));
+	}
+}
+
+}  // namespace
+
+void webhook_init() {
+	worker.init();
+}
+
+void webhook_send_message(std::string title, std::string message, int color, std::string url) {
+	if (url.empty()) {
 		return;
 	}
 
@@ -63,51 +339,52 @@ void webhook_send_message(std::string title, std::string message, int color, std
 		return;
 	}
 
-	std::string payload = get_payload(title, message, color);
-	std::string response_body = "";
-	int response_code = webhook_send_message_(url.c_str(), payload.c_str(), &response_body);
+	WebhookTask task;
+	task.title = std::move(title);
+	task.message = std::move(message);
+	task.color = color;
+	task.url = std::move(url);
+	time(&task.time);
+	worker.addTask(std::move(task));
+}
 
-	if (response_code != 204 && response_code != -1) {
-		SPDLOG_ERROR("Failed to send webhook message; "
-                     "HTTP request failed with code: {}"
-                     "response body: {} request body: {}",
-                     response_code, response_body, payload);
-	}
+void webhook_shutdown() {
+	worker.shutdown();
 }
 
-static std::string get_payload(std::string title, std::string message, int color) {
-	time_t now;
-	time(&now);
-	struct tm tm;
+namespace {
+
+std::string get_payload(const std::vector<WebhookTask>& tasks) {
+	std::stringstream server;
+	server
+			<< g_configManager().getString(IP) << ":"
+			<< g_configManager().getNumber(GAME_PORT) << " | ";
+
+	Json::Value embeds(Json::arrayValue);
+	for (const WebhookTask& task : tasks) {
+		struct tm tm;
 
 #ifdef _MSC_VER
-  gmtime_s(&tm, &now);
+		gmtime_s(&tm, &task.time);
 #else
-  gmtime_r(&now, &tm);
+		gmtime_r(&task.time, &tm);
 #endif
 
-	char time_buf[sizeof "00:00"];
-	strftime(time_buf, sizeof time_buf, "%R", &tm);
+		char time_buf[sizeof "00:00"];
+		strftime(time_buf, sizeof time_buf, "%R", &tm);
 
-	std::stringstream footer_text;
-	footer_text
-			<< g_configManager().getString(IP) << ":"
-			<< g_configManager().getNumber(GAME_PORT) << " | "
-			<< time_buf << " UTC";
-
-	Json::Value footer(Json::objectValue);
-	footer["text"] = Json::Value(footer_text.str());
-
-	Json::Value embed(Json::objectValue);
-	embed["title"] = Json::Value(title);
-	embed["description"] = Json::Value(message);
-	embed["footer"] = footer;
-	if (color >= 0) {
-		embed["color"] = color;
-	}
+		Json::Value footer(Json::objectValue);
+		footer["text"] = Json::Value(server.str() + time_buf + " UTC");
 
-	Json::Value embeds(Json::arrayValue);
-	embeds.append(embed);
+		Json::Value embed(Json::objectValue);
+		embed["title"] = Json::Value(task.title);
+		embed["description"] = Json::Value(task.message);
+		embed["footer"] = footer;
+		if (task.color >= 0) {
+			embed["color"] = task.color;
+		}
+		embeds.append(embed);
+	}
 
 	Json::Value payload(Json::objectValue);
 	payload["embeds"] = embeds;
@@ -122,31 +399,4 @@ static std::string get_payload(std::string title, std::string message, int color
 	return out.str();
 }
 
-static int webhook_send_message_(const char *url, const char *payload, std::string *response_body) {
-	CURL *curl = curl_easy_init();
-	if (!curl) {
-		SPDLOG_ERROR("Failed to send webhook message; curl_easy_init failed");
-		return -1;
-	}
-
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_POST, 1L);
-	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, reinterpret_cast<void *>(&response_body));
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-	curl_easy_setopt(curl, CURLOPT_USERAGENT, "canary (https://github.com/Hydractify/canary)");
-
-	CURLcode res = curl_easy_perform(curl);
-
-	int response_code = -1;
-	if (res == CURLE_OK) {
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-	} else {
-		SPDLOG_ERROR("Failed to send webhook message with the error: {}",
-                     curl_easy_strerror(res));
-	}
-
-	curl_easy_cleanup(curl);
-
-	return response_code;
-}
+}  // namespace
@@ -20,8 +20,13 @@
 #ifndef SRC_SERVER_NETWORK_WEBHOOK_WEBHOOK_H_
 #define SRC_SERVER_NETWORK_WEBHOOK_WEBHOOK_H_
 
+// Starts the delivery thread
 void webhook_init();
 
+// Queues the message and returns at once, delivery happens on the webhook thread
 void webhook_send_message(std::string title, std::string message, int color, std::string url);
 
+// Delivers what is still queued, without further retries, and stops the thread
+void webhook_shutdown();
+
 #endif  // SRC_SERVER_NETWORK_WEBHOOK_WEBHOOK_H_
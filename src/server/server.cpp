@@ -24,17 +24,30 @@
 #include "config/configmanager.h"
 #include "game/scheduling/scheduler.h"
 #include "creatures/players/management/ban.h"
+#include "server/metrics/metrics_server.hpp"
+#include "utils/thread_topology.hpp"
 
 Ban g_bans;
 
 ServiceManager::~ServiceManager()
 {
 	stop();
+	// the network threads must be gone before their io_services
+	die();
 }
 
 void ServiceManager::die()
 {
 	io_service.stop();
+	connectionWork.clear();
+	for (auto& connectionService : connectionServices) {
+		connectionService->stop();
+	}
+
+	for (std::thread& thread : connectionThreads) {
+		thread.join();
+	}
+	connectionThreads.clear();
 }
 
 void ServiceManager::run()
@@ -44,6 +57,34 @@ void ServiceManager::run()
 	io_service.run();
 }
 
+boost::asio::io_service& ServiceManager::getConnectionService()
+{
+	// the first acceptor opens after the config is loaded
+	std::call_once(connectionServicesFlag, &ServiceManager::startConnectionServices, this);
+	if (connectionServices.empty()) {
+		return io_service;
+	}
+	return *connectionServices[nextConnectionService.fetch_add(1, std::memory_order_relaxed) % connectionServices.size()];
+}
+
+void ServiceManager::startConnectionServices()
+{
+	int32_t threads = g_configManager().getNumber(NETWORK_THREADS);
+	if (threads <= 1) {
+		return;
+	}
+
+	for (int32_t i = 0; i < threads; ++i) {
+		auto& connectionService = connectionServices.emplace_back(std::make_unique<boost::asio::io_service>());
+		connectionWork.emplace_back(std::make_unique<boost::asio::io_service::work>(*connectionService));
+		connectionThreads.emplace_back([&service = *connectionService, i]() {
+			g_threadTopology().applyToCurrentThread(THREAD_ROLE_NETWORK, i);
+			service.run();
+		});
+	}
+	SPDLOG_INFO("Network running on {} threads", threads);
+}
+
 void ServiceManager::stop()
 {
 	if (!running) {
@@ -62,10 +103,31 @@ void ServiceManager::stop()
 
 	acceptors.clear();
 
+	if (metricsServer) {
+		io_service.post(std::bind(&MetricsServer::close, metricsServer));
+		metricsServer.reset();
+	}
+
 	death_timer.expires_from_now(boost::posix_time::seconds(3));
 	death_timer.async_wait(std::bind(&ServiceManager::die, this));
 }
 
+bool ServiceManager::addMetrics(const std::string& ip, uint16_t port)
+{
+	if (port == 0) {
+		return false;
+	}
+
+	auto server = std::make_shared<MetricsServer>(io_service);
+	if (!server->open(ip, port)) {
+		return false;
+	}
+
+	metricsServer = std::move(server);
+	SPDLOG_INFO("Metrics available on http://{}:{}/metrics", ip, port);
+	return true;
+}
+
 ServicePort::~ServicePort()
 {
 	close();
@@ -97,7 +159,7 @@ void ServicePort::accept()
 		return;
 	}
 
-	auto connection = ConnectionManager::getInstance().createConnection(io_service, shared_from_this());
+	auto connection = ConnectionManager::getInstance().createConnection(manager.getConnectionService(), shared_from_this());
 	acceptor->async_accept(connection->getSocket(), std::bind(&ServicePort::onAccept, shared_from_this(), connection, std::placeholders::_1));
 }
 
@@ -23,7 +23,9 @@
 #include "server/network/connection/connection.h"
 #include "server/signals.h"
 
+class MetricsServer;
 class Protocol;
+class ServiceManager;
 
 class ServiceBase
 {
@@ -61,7 +63,8 @@ class Service final : public ServiceBase
 class ServicePort : public std::enable_shared_from_this<ServicePort>
 {
 	public:
-		explicit ServicePort(boost::asio::io_service& init_io_service) : io_service(init_io_service) {}
+		ServicePort(boost::asio::io_service& init_io_service, ServiceManager& init_manager) :
+			io_service(init_io_service), manager(init_manager) {}
 		~ServicePort();
 
 		// non-copyable
@@ -84,6 +87,7 @@ class ServicePort : public std::enable_shared_from_this<ServicePort>
 		void accept();
 
 		boost::asio::io_service& io_service;
+		ServiceManager& manager;
 		std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
 		std::vector<Service_ptr> services;
 
@@ -106,20 +110,37 @@ class ServiceManager
 
 		template <typename ProtocolType>
 		bool add(uint16_t port);
+		// Prometheus endpoint, plain HTTP on its own port
+		bool addMetrics(const std::string& ip, uint16_t port);
 
 		bool is_running() const {
 			return acceptors.empty() == false;
 		}
 
+		/**
+		 * io_service for the next accepted connection, round-robin over networkThreads.
+		 * Each one runs on a single thread, so the handlers of a connection never run
+		 * concurrently; with one network thread connections share the acceptor's io_service.
+		 */
+		boost::asio::io_service& getConnectionService();
+
 	private:
 		void die();
+		void startConnectionServices();
 
 		phmap::flat_hash_map<uint16_t, ServicePort_ptr> acceptors;
+		std::shared_ptr<MetricsServer> metricsServer;
 
 		boost::asio::io_service io_service;
 		Signals signals{io_service};
 		boost::asio::deadline_timer death_timer { io_service };
 		bool running = false;
+
+		std::vector<std::unique_ptr<boost::asio::io_service>> connectionServices;
+		std::vector<std::unique_ptr<boost::asio::io_service::work>> connectionWork;
+		std::vector<std::thread> connectionThreads;
+		std::once_flag connectionServicesFlag;
+		std::atomic<size_t> nextConnectionService {0};
 };
 
 template <typename ProtocolType>
@@ -137,7 +158,7 @@ bool ServiceManager::add(uint16_t port)
 	auto foundServicePort = acceptors.find(port);
 
 	if (foundServicePort == acceptors.end()) {
-		service_port = std::make_shared<ServicePort>(io_service);
+		service_port = std::make_shared<ServicePort>(io_service, *this);
 		service_port->open(port);
 		acceptors[port] = service_port;
 	} else {
@@ -20,7 +20,9 @@
 #include "pch.hpp"
 
 #include "creatures/appearance/mounts/mounts.h"
+#include "database/database_stats.hpp"
 #include "database/databasetasks.h"
+#include "game/experience_stages.hpp"
 #include "game/game.h"
 #include "game/scheduling/scheduler.h"
 #include "game/scheduling/tasks.h"
@@ -39,6 +41,7 @@ Signals::Signals(boost::asio::io_service& service) :
 #ifndef _WIN32
 	set.add(SIGUSR1);
 	set.add(SIGHUP);
+	set.add(SIGUSR2);
 #else
 	// This must be a blocking call as Windows calls it in a new thread and terminates
 	// the process when the handler returns (or after 5 seconds, whichever is earlier).
@@ -81,6 +84,9 @@ void Signals::dispatchSignalHandler(int signal)
 		case SIGUSR1: //Saves game state
 			g_dispatcher().addTask(createTask(sigusr1Handler));
 			break;
+		case SIGUSR2: //Logs the database statistics
+			g_dispatcher().addTask(createTask(sigusr2Handler));
+			break;
 #else
 		case SIGBREAK: //Shuts the server down
 			g_dispatcher().addTask(createTask(sigbreakHandler));
@@ -116,6 +122,13 @@ void Signals::sigusr1Handler()
 	g_game().saveGameState();
 }
 
+void Signals::sigusr2Handler()
+{
+	//Dispatcher thread
+	SPDLOG_INFO("SIGUSR2 received, logging the database statistics...");
+	g_databaseStats().report();
+}
+
 void Signals::sighupHandler()
 {
 	//Dispatcher thread
@@ -143,7 +156,7 @@ void Signals::sighupHandler()
 	g_luaEnvironment.loadFile("data/global.lua");
 	SPDLOG_INFO("Reloaded global.lua");
 
-	g_luaEnvironment.loadFile("data/stages.lua");
+	g_experienceStages().loadFromLua();
 	SPDLOG_INFO("Reloaded stages.lua");
 
 	lua_gc(g_luaEnvironment.getLuaState(), LUA_GCCOLLECT, 0);
@@ -35,6 +35,7 @@ class Signals
 		static void sighupHandler();
 		static void sigtermHandler();
 		static void sigusr1Handler();
+		static void sigusr2Handler();
 };
 
 #endif  // SRC_SERVER_SIGNALS_H_
@@ -0,0 +1,88 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SRC_UTILS_ARENA_HPP_
+#define SRC_UTILS_ARENA_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Bump allocator for objects that are only freed all at once.
+ * Memory comes from large blocks that are given back when the arena is
+ * destroyed; single objects cannot be released.
+ * Not thread safe.
+ */
+class Arena
+{
+	public:
+		explicit Arena(size_t initBlockSize) : blockSize(initBlockSize) {}
+
+		// non-copyable
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t size, size_t alignment) {
+			size_t offset = (used + alignment - 1) & ~(alignment - 1);
+			if (blocks.empty() || offset + size > currentSize) {
+				addBlock(std::max(size, blockSize));
+				offset = 0;
+			}
+
+			used = offset + size;
+			return blocks.back().get() + offset;
+		}
+
+		bool owns(const void* pointer) const {
+			auto address = reinterpret_cast<uintptr_t>(pointer);
+			auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](uintptr_t value, const auto& range) {
+				return value < range.first;
+			});
+			return it != ranges.begin() && address < std::prev(it)->second;
+		}
+
+		size_t getReservedBytes() const {
+			return reservedBytes;
+		}
+
+	private:
+		void addBlock(size_t size) {
+			// operator new[] memory is aligned for any fundamental type
+			blocks.emplace_back(new char[size]);
+			currentSize = size;
+			used = 0;
+			reservedBytes += size;
+
+			auto begin = reinterpret_cast<uintptr_t>(blocks.back().get());
+			auto range = std::make_pair(begin, begin + size);
+			ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), range), range);
+		}
+
+		std::vector<std::unique_ptr<char[]>> blocks;
+		// sorted [begin, end) of every block, for owns
+		std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+		size_t blockSize;
+		size_t currentSize = 0;
+		size_t used = 0;
+		size_t reservedBytes = 0;
+};
+
+#endif  // SRC_UTILS_ARENA_HPP_
@@ -34,8 +34,8 @@ static constexpr int32_t CHANNEL_GUILD = 0x00;
 static constexpr int32_t CHANNEL_PARTY = 0x01;
 static constexpr int32_t CHANNEL_PRIVATE = 0xFFFF;
 
-// This is in miliseconds
-static constexpr int32_t EVENT_IMBUEMENT_INTERVAL = 1000;
+// This is in miliseconds, the longest imbuement durations may stay unsaved while nothing expires
+static constexpr int32_t IMBUEMENT_UPDATE_INTERVAL = 60000;
 static constexpr uint8_t IMBUEMENT_MAX_TIER = 3;
 
 static constexpr int32_t STORAGEVALUE_PROMOTION = 30018;
@@ -0,0 +1,76 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_GAME_CLOCK_HPP_
+#define SRC_UTILS_GAME_CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Milliseconds since the epoch that never jump: the wall clock is read once
+ * and a steady clock adds the time since, so the values still compare with
+ * stored timestamps while NTP corrections no longer move them.
+ * Threads that call update (the dispatcher, before every task) read a cached
+ * value until the next update, the others read the clock every time.
+ */
+class GameClock
+{
+	public:
+		static void update() {
+			cachedTime = std::chrono::steady_clock::now();
+		}
+
+		static std::chrono::steady_clock::time_point getTime() {
+			if (cachedTime == std::chrono::steady_clock::time_point()) {
+				return std::chrono::steady_clock::now();
+			}
+			return cachedTime;
+		}
+
+		static int64_t getMillis() {
+			return toMillis(getTime());
+		}
+
+		static int64_t getPreciseMillis() {
+			return toMillis(std::chrono::steady_clock::now());
+		}
+
+	private:
+		struct Origin {
+			std::chrono::steady_clock::time_point steady = std::chrono::steady_clock::now();
+			int64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		};
+
+		// function static, static initializers of other files read the clock too
+		static const Origin& getOrigin() {
+			static const Origin origin;
+			return origin;
+		}
+
+		static int64_t toMillis(std::chrono::steady_clock::time_point time) {
+			const Origin& origin = getOrigin();
+			return origin.millis + std::chrono::duration_cast<std::chrono::milliseconds>(time - origin.steady).count();
+		}
+
+		static inline thread_local std::chrono::steady_clock::time_point cachedTime {};
+};
+
+#endif  // SRC_UTILS_GAME_CLOCK_HPP_
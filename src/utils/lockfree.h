@@ -24,6 +24,8 @@
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX
 #endif
 
+#include <atomic>
+
 #include <boost/lockfree/stack.hpp>
 
 /*
@@ -74,4 +76,85 @@ class LockfreePoolingAllocator : public std::allocator<T>
 		}
 };
 
+/*
+ * Intrusive multi-producer single-consumer queue (Vyukov's algorithm).
+ * Producers never block and never allocate, the element carries its own
+ * link by inheriting from LockfreeMPSCNode. Only one thread may call pop()
+ * and empty().
+ */
+class LockfreeMPSCNode
+{
+	protected:
+		LockfreeMPSCNode() = default;
+		~LockfreeMPSCNode() = default;
+
+	private:
+		std::atomic<LockfreeMPSCNode*> mpscNext {nullptr};
+
+		template <typename T>
+		friend class LockfreeMPSCQueue;
+};
+
+template <typename T>
+class LockfreeMPSCQueue
+{
+	public:
+		LockfreeMPSCQueue() : head(&stub), tail(&stub) {}
+
+		// non-copyable
+		LockfreeMPSCQueue(const LockfreeMPSCQueue&) = delete;
+		LockfreeMPSCQueue& operator=(const LockfreeMPSCQueue&) = delete;
+
+		void push(T* item) {
+			pushNode(item);
+		}
+
+		T* pop() {
+			LockfreeMPSCNode* current = tail;
+			LockfreeMPSCNode* next = current->mpscNext.load(std::memory_order_acquire);
+			if (current == &stub) {
+				if (!next) {
+					return nullptr;
+				}
+				tail = current = next;
+				next = next->mpscNext.load(std::memory_order_acquire);
+			}
+
+			if (next) {
+				tail = next;
+				return static_cast<T*>(current);
+			}
+
+			if (current != head.load(std::memory_order_acquire)) {
+				// a producer is halfway through push, the item shows up on the next pop
+				return nullptr;
+			}
+
+			pushNode(&stub);
+			next = current->mpscNext.load(std::memory_order_acquire);
+			if (next) {
+				tail = next;
+				return static_cast<T*>(current);
+			}
+			return nullptr;
+		}
+
+		bool empty() const {
+			return tail == &stub && !stub.mpscNext.load(std::memory_order_acquire);
+		}
+
+	private:
+		void pushNode(LockfreeMPSCNode* node) {
+			node->mpscNext.store(nullptr, std::memory_order_relaxed);
+			LockfreeMPSCNode* prev = head.exchange(node, std::memory_order_acq_rel);
+			prev->mpscNext.store(node, std::memory_order_release);
+		}
+
+		struct StubNode : LockfreeMPSCNode {};
+
+		std::atomic<LockfreeMPSCNode*> head;
+		LockfreeMPSCNode* tail;
+		StubNode stub;
+};
+
 #endif  // SRC_UTILS_LOCKFREE_H_
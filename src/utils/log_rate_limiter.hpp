@@ -0,0 +1,83 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_LOG_RATE_LIMITER_HPP_
+#define SRC_UTILS_LOG_RATE_LIMITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Caps how often one call site may log, for messages a client can trigger at will.
+ * Each call site gets LOG_RATE_LIMIT messages per LOG_RATE_WINDOW_MS; the rest are
+ * counted and reported as "N similar messages suppressed" with the next one let through.
+ * Safe to use from any thread, a race at the window edge lets one extra message pass.
+ */
+class LogRateLimiter
+{
+	public:
+		static constexpr uint32_t LOG_RATE_LIMIT = 10;
+		static constexpr int64_t LOG_RATE_WINDOW_MS = 10000;
+
+		/**
+		 * \param suppressed set to the messages dropped since the last one allowed
+		 * \returns whether the message may be logged
+		 */
+		bool allow(uint32_t& suppressed) {
+			int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			int64_t start = windowStart.load(std::memory_order_relaxed);
+			if (now - start >= LOG_RATE_WINDOW_MS && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+				used.store(0, std::memory_order_relaxed);
+			}
+
+			if (used.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT) {
+				suppressed = dropped.exchange(0, std::memory_order_relaxed);
+				return true;
+			}
+
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+	private:
+		std::atomic<int64_t> windowStart {std::numeric_limits<int64_t>::min() / 2};
+		std::atomic<uint32_t> used {0};
+		std::atomic<uint32_t> dropped {0};
+};
+
+/**
+ * Rate limited form of the SPDLOG_* macros, one limiter per call site:
+ * SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[Protocol::onRecvMessage] - XTEA_decrypt Failed");
+ */
+#define SPDLOG_RATE_LIMITED(logMacro, ...) \
+	do { \
+		static LogRateLimiter logRateLimiter; \
+		uint32_t logSuppressed = 0; \
+		if (logRateLimiter.allow(logSuppressed)) { \
+			if (logSuppressed != 0) { \
+				logMacro("{} similar messages suppressed", logSuppressed); \
+			} \
+			logMacro(__VA_ARGS__); \
+		} \
+	} while (false)
+
+#endif  // SRC_UTILS_LOG_RATE_LIMITER_HPP_
@@ -0,0 +1,78 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "utils/memory_accounting.hpp"
+
+std::array<MemoryAccounting::Shard, METRIC_SHARDS> MemoryAccounting::shards;
+
+namespace {
+
+constexpr const char* memoryTagNames[MEMORY_TAG_LAST] = {
+	"item", "container", "tile", "floor", "player", "monster", "npc", "output_message", "db_result", "task", "lua"
+};
+
+}  // namespace
+
+MemoryUsage MemoryAccounting::get(MemoryTag tag)
+{
+	MemoryUsage usage;
+	for (const Shard& shard : shards) {
+		usage.bytes += shard.counters[tag].bytes.load(std::memory_order_relaxed);
+		usage.count += shard.counters[tag].count.load(std::memory_order_relaxed);
+	}
+	return usage;
+}
+
+const char* MemoryAccounting::getTagName(MemoryTag tag)
+{
+	return memoryTagNames[tag];
+}
+
+void MemoryAccounting::start()
+{
+	for (uint8_t i = 0; i < MEMORY_TAG_LAST; ++i) {
+		auto tag = static_cast<MemoryTag>(i);
+		std::string labels = fmt::format("tag=\"{}\"", getTagName(tag));
+		g_metrics().addCallback("canary_memory_live_bytes", "Bytes allocated and not freed yet, by subsystem", [tag]() {
+			return static_cast<double>(get(tag).bytes);
+		}, labels);
+		g_metrics().addCallback("canary_memory_live_objects", "Objects allocated and not freed yet, by subsystem", [tag]() {
+			return static_cast<double>(get(tag).count);
+		}, labels);
+	}
+}
+
+void MemoryAccounting::report()
+{
+	int64_t totalBytes = 0;
+	for (uint8_t i = 0; i < MEMORY_TAG_LAST; ++i) {
+		totalBytes += get(static_cast<MemoryTag>(i)).bytes;
+	}
+
+	SPDLOG_INFO("[MemoryAccounting] {:.1f} MB in the tracked allocation sites", totalBytes / 1048576.);
+	for (uint8_t i = 0; i < MEMORY_TAG_LAST; ++i) {
+		auto tag = static_cast<MemoryTag>(i);
+		MemoryUsage usage = get(tag);
+		SPDLOG_INFO("[MemoryAccounting] {:>16}: {:>10.1f} KB in {:>9} objects, {:>5.1f}%",
+			getTagName(tag), usage.bytes / 1024., usage.count, totalBytes > 0 ? usage.bytes * 100. / totalBytes : 0.);
+	}
+}
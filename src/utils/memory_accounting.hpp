@@ -0,0 +1,100 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_MEMORY_ACCOUNTING_HPP_
+#define SRC_UTILS_MEMORY_ACCOUNTING_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "server/metrics/metrics.hpp"
+
+enum MemoryTag : uint8_t {
+	MEMORY_TAG_ITEM,
+	MEMORY_TAG_CONTAINER,
+	MEMORY_TAG_TILE,
+	MEMORY_TAG_FLOOR,
+	MEMORY_TAG_PLAYER,
+	MEMORY_TAG_MONSTER,
+	MEMORY_TAG_NPC,
+	MEMORY_TAG_OUTPUT_MESSAGE,
+	MEMORY_TAG_DB_RESULT,
+	MEMORY_TAG_TASK,
+	// blocks of the LuaAllocator, empty if Lua refused it
+	MEMORY_TAG_LUA,
+
+	MEMORY_TAG_LAST
+};
+
+struct MemoryUsage {
+	int64_t bytes = 0;
+	int64_t count = 0;
+};
+
+/**
+ * Live bytes and objects of the main allocation sites, by subsystem.
+ * The classes report from their operator new and delete (or constructor and
+ * destructor where the memory is not theirs), each thread into its own
+ * shard with relaxed atomics, so the cost is two uncontended adds.
+ * Exported as canary_memory_live_bytes and canary_memory_live_objects and
+ * logged by /memory.
+ */
+class MemoryAccounting
+{
+	public:
+		static void allocate(MemoryTag tag, size_t size) {
+			Counter& counter = shards[getMetricShard()].counters[tag];
+			counter.bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+			counter.count.fetch_add(1, std::memory_order_relaxed);
+		}
+		static void deallocate(MemoryTag tag, size_t size) {
+			Counter& counter = shards[getMetricShard()].counters[tag];
+			counter.bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+			counter.count.fetch_sub(1, std::memory_order_relaxed);
+		}
+		// memory held by objects that are already counted, such as a grown buffer
+		static void resize(MemoryTag tag, int64_t delta) {
+			shards[getMetricShard()].counters[tag].bytes.fetch_add(delta, std::memory_order_relaxed);
+		}
+
+		static MemoryUsage get(MemoryTag tag);
+		static const char* getTagName(MemoryTag tag);
+
+		// Registers the metrics
+		static void start();
+		// dispatcher thread
+		static void report();
+
+	private:
+		struct Counter {
+			std::atomic<int64_t> bytes {0};
+			std::atomic<int64_t> count {0};
+		};
+
+		// a shard may go negative when objects are freed on another thread than they were made
+		struct alignas(64) Shard {
+			std::array<Counter, MEMORY_TAG_LAST> counters;
+		};
+
+		static std::array<Shard, METRIC_SHARDS> shards;
+};
+
+#endif  // SRC_UTILS_MEMORY_ACCOUNTING_HPP_
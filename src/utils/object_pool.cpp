@@ -0,0 +1,107 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "utils/lockfree.h"
+#include "utils/object_pool.hpp"
+
+ObjectPoolStats ObjectPool::stats;
+
+namespace {
+
+using PopFunction = bool (*)(void*&);
+using PushFunction = bool (*)(void*);
+
+template <size_t SizeClass>
+using ObjectFreeList = LockfreeFreeList<(SizeClass + 1) * OBJECT_POOL_GRANULARITY, OBJECT_POOL_FREE_LIST_CAPACITY>;
+
+template <size_t SizeClass>
+bool popBlock(void*& pointer)
+{
+	return ObjectFreeList<SizeClass>::get().pop(pointer);
+}
+
+template <size_t SizeClass>
+bool pushBlock(void* pointer)
+{
+	return ObjectFreeList<SizeClass>::get().bounded_push(pointer);
+}
+
+template <size_t... SizeClasses>
+constexpr std::array<PopFunction, sizeof...(SizeClasses)> makePopFunctions(std::index_sequence<SizeClasses...>)
+{
+	return {{&popBlock<SizeClasses>...}};
+}
+
+template <size_t... SizeClasses>
+constexpr std::array<PushFunction, sizeof...(SizeClasses)> makePushFunctions(std::index_sequence<SizeClasses...>)
+{
+	return {{&pushBlock<SizeClasses>...}};
+}
+
+// the free lists are templates on the block size, these pick one at runtime
+constexpr auto popFunctions = makePopFunctions(std::make_index_sequence<OBJECT_POOL_SIZE_CLASSES>());
+constexpr auto pushFunctions = makePushFunctions(std::make_index_sequence<OBJECT_POOL_SIZE_CLASSES>());
+
+size_t getSizeClass(size_t size)
+{
+	return (std::max<size_t>(size, 1) - 1) / OBJECT_POOL_GRANULARITY;
+}
+
+}  // namespace
+
+void* ObjectPool::allocate(size_t size)
+{
+	if (size > OBJECT_POOL_MAX_SIZE) {
+		return ::operator new(size);
+	}
+
+	size_t sizeClass = getSizeClass(size);
+	void* pointer;
+	if (popFunctions[sizeClass](pointer)) {
+		stats.reused.fetch_add(1, std::memory_order_relaxed);
+		return pointer;
+	}
+
+	stats.allocated.fetch_add(1, std::memory_order_relaxed);
+	// the whole class size, the block may later hold any object of the class
+	return ::operator new((sizeClass + 1) * OBJECT_POOL_GRANULARITY);
+}
+
+void ObjectPool::deallocate(void* pointer, size_t size)
+{
+	if (!pointer) {
+		return;
+	}
+
+	if (size > OBJECT_POOL_MAX_SIZE) {
+		::operator delete(pointer);
+		return;
+	}
+
+	if (pushFunctions[getSizeClass(size)](pointer)) {
+		stats.recycled.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	stats.released.fetch_add(1, std::memory_order_relaxed);
+	::operator delete(pointer);
+}
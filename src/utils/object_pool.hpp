@@ -0,0 +1,74 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_OBJECT_POOL_HPP_
+#define SRC_UTILS_OBJECT_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// blocks are rounded up to a multiple of this, one free list per multiple
+static constexpr size_t OBJECT_POOL_GRANULARITY = 16;
+// larger objects bypass the pool
+static constexpr size_t OBJECT_POOL_MAX_SIZE = 512;
+static constexpr size_t OBJECT_POOL_SIZE_CLASSES = OBJECT_POOL_MAX_SIZE / OBJECT_POOL_GRANULARITY;
+// blocks kept per size class, the rest goes back to the heap
+static constexpr size_t OBJECT_POOL_FREE_LIST_CAPACITY = 16384;
+
+struct ObjectPoolStats {
+	// served from a free list / from the heap
+	std::atomic<uint64_t> reused {0};
+	std::atomic<uint64_t> allocated {0};
+	// kept for reuse / given back to the heap because the free list was full
+	std::atomic<uint64_t> recycled {0};
+	std::atomic<uint64_t> released {0};
+
+	void reset() {
+		reused.store(0, std::memory_order_relaxed);
+		allocated.store(0, std::memory_order_relaxed);
+		recycled.store(0, std::memory_order_relaxed);
+		released.store(0, std::memory_order_relaxed);
+	}
+};
+
+/**
+ * Size-classed recycling allocator for the short-lived game objects
+ * (items, containers and their attributes): freed blocks go to a lock-free
+ * free list of their size class instead of the heap and are handed out again,
+ * so corpses and loot do not churn and fragment the global heap.
+ * Safe to use from any thread.
+ */
+class ObjectPool
+{
+	public:
+		static void* allocate(size_t size);
+		// size must be the one given to allocate, as passed to a sized operator delete
+		static void deallocate(void* pointer, size_t size);
+
+		static ObjectPoolStats& getStats() {
+			return stats;
+		}
+
+	private:
+		static ObjectPoolStats stats;
+};
+
+#endif  // SRC_UTILS_OBJECT_POOL_HPP_
@@ -0,0 +1,80 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_RANDOM_HPP_
+#define SRC_UTILS_RANDOM_HPP_
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * xoshiro256** by Blackman and Vigna: 32 bytes of state and a handful of
+ * shifts and multiplies per number, against the 2.5KB state of std::mt19937.
+ * Meets UniformRandomBitGenerator, so it works with std::shuffle and the
+ * std distributions.
+ */
+class RandomGenerator
+{
+	public:
+		using result_type = uint64_t;
+
+		explicit RandomGenerator(uint64_t value) {
+			seed(value);
+		}
+
+		static constexpr result_type min() {
+			return 0;
+		}
+		static constexpr result_type max() {
+			return std::numeric_limits<result_type>::max();
+		}
+
+		// the state is expanded from the seed with splitmix64, as the authors recommend
+		void seed(uint64_t value) {
+			for (uint64_t& word : state) {
+				value += 0x9E3779B97F4A7C15;
+				uint64_t z = value;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		result_type operator()() {
+			const uint64_t result = rotl(state[1] * 5, 7) * 9;
+			const uint64_t t = state[1] << 17;
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = rotl(state[3], 45);
+			return result;
+		}
+
+	private:
+		static constexpr uint64_t rotl(uint64_t x, int k) {
+			return (x << k) | (x >> (64 - k));
+		}
+
+		uint64_t state[4];
+};
+
+#endif  // SRC_UTILS_RANDOM_HPP_
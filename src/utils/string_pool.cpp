@@ -0,0 +1,89 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "utils/string_pool.hpp"
+
+namespace {
+
+const std::string emptyInternedString;
+
+}  // namespace
+
+InternedString StringPool::intern(const std::string& value)
+{
+	if (value.empty()) {
+		return InternedString();
+	}
+
+	stats.references.fetch_add(1, std::memory_order_relaxed);
+	stats.referencedBytes.fetch_add(value.size(), std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lockGuard(poolLock);
+	auto it = entries.find(std::string_view(value));
+	if (it != entries.end()) {
+		it->second->references.fetch_add(1, std::memory_order_relaxed);
+		return InternedString(it->second);
+	}
+
+	auto entry = new Entry(value);
+	entries.emplace(std::string_view(entry->value), entry);
+	stats.strings.fetch_add(1, std::memory_order_relaxed);
+	stats.storedBytes.fetch_add(value.size(), std::memory_order_relaxed);
+	return InternedString(entry);
+}
+
+void StringPool::acquire(Entry* entry)
+{
+	// the caller holds a reference, so the count cannot be at zero here
+	entry->references.fetch_add(1, std::memory_order_relaxed);
+	stats.references.fetch_add(1, std::memory_order_relaxed);
+	stats.referencedBytes.fetch_add(entry->value.size(), std::memory_order_relaxed);
+}
+
+void StringPool::release(Entry* entry)
+{
+	stats.references.fetch_sub(1, std::memory_order_relaxed);
+	stats.referencedBytes.fetch_sub(entry->value.size(), std::memory_order_relaxed);
+
+	// counts only reach zero under the lock, so intern never finds an entry being freed
+	uint32_t references = entry->references.load(std::memory_order_relaxed);
+	while (references > 1) {
+		if (entry->references.compare_exchange_weak(references, references - 1, std::memory_order_acq_rel)) {
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lockGuard(poolLock);
+	if (entry->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	entries.erase(std::string_view(entry->value));
+	stats.strings.fetch_sub(1, std::memory_order_relaxed);
+	stats.storedBytes.fetch_sub(entry->value.size(), std::memory_order_relaxed);
+	delete entry;
+}
+
+const std::string& InternedString::get() const
+{
+	return entry ? entry->value : emptyInternedString;
+}
@@ -0,0 +1,133 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_STRING_POOL_HPP_
+#define SRC_UTILS_STRING_POOL_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <parallel_hashmap/phmap.h>
+
+class InternedString;
+
+// Sizes of the pool, shared by all threads
+struct StringPoolStats {
+	std::atomic<int64_t> strings {0};
+	std::atomic<int64_t> references {0};
+	// bytes of the pooled strings, and what every reference would take with its own copy
+	std::atomic<int64_t> storedBytes {0};
+	std::atomic<int64_t> referencedBytes {0};
+};
+
+/**
+ * Process wide pool of reference counted strings, equal strings interned
+ * through it share one copy. Copying an InternedString only bumps the
+ * count; the pool lock is taken to intern and when the last reference goes.
+ */
+class StringPool
+{
+	public:
+		StringPool() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		StringPool(const StringPool&) = delete;
+		StringPool& operator=(const StringPool&) = delete;
+
+		static StringPool& getInstance() {
+			// Guaranteed to be destroyed
+			static StringPool instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		InternedString intern(const std::string& value);
+
+		const StringPoolStats& getStats() const {
+			return stats;
+		}
+
+	private:
+		struct Entry {
+			explicit Entry(const std::string& initValue) : value(initValue) {}
+
+			const std::string value;
+			std::atomic<uint32_t> references {1};
+		};
+
+		void acquire(Entry* entry);
+		void release(Entry* entry);
+
+		std::mutex poolLock;
+		// keys point into the entries
+		phmap::flat_hash_map<std::string_view, Entry*> entries;
+		StringPoolStats stats;
+
+	friend class InternedString;
+};
+
+constexpr auto g_stringPool = &StringPool::getInstance;
+
+// handle to a pooled string, empty when default constructed
+class InternedString
+{
+	public:
+		InternedString() = default;
+		InternedString(const InternedString& other) : entry(other.entry) {
+			if (entry) {
+				g_stringPool().acquire(entry);
+			}
+		}
+		InternedString(InternedString&& other) noexcept : entry(other.entry) {
+			other.entry = nullptr;
+		}
+		~InternedString() {
+			if (entry) {
+				g_stringPool().release(entry);
+			}
+		}
+
+		InternedString& operator=(InternedString other) noexcept {
+			std::swap(entry, other.entry);
+			return *this;
+		}
+
+		// pooled strings are unique, so equal strings are the same entry
+		bool operator==(const InternedString& other) const {
+			return entry == other.entry;
+		}
+		bool operator!=(const InternedString& other) const {
+			return entry != other.entry;
+		}
+
+		const std::string& get() const;
+
+	private:
+		explicit InternedString(StringPool::Entry* initEntry) : entry(initEntry) {}
+
+		StringPool::Entry* entry = nullptr;
+
+	friend class StringPool;
+};
+
+#endif  // SRC_UTILS_STRING_POOL_HPP_
@@ -0,0 +1,189 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "config/configmanager.h"
+#include "utils/thread_topology.hpp"
+
+#if defined(__linux__)
+	#include <linux/mempolicy.h>
+	#include <pthread.h>
+	#include <sched.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#elif !defined(_WIN32)
+	#include <pthread.h>
+#endif
+
+namespace {
+
+constexpr const char* roleNames[THREAD_ROLE_LAST] = { "dispatcher", "scheduler", "network", "database", "worker" };
+
+// cpu list format of the kernel: "0-3,8,10-11"
+std::vector<uint32_t> parseCpuList(const std::string& list)
+{
+	std::vector<uint32_t> cpus;
+	std::istringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		std::string::size_type dash = range.find('-');
+		try {
+			uint32_t first = std::stoul(range.substr(0, dash));
+			uint32_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+			for (uint32_t cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+		} catch (const std::exception&) {
+			if (range.find_first_not_of(" \t\n") != std::string::npos) {
+				SPDLOG_WARN("[parseCpuList] - Ignoring '{}' in cpu list '{}'", range, list);
+			}
+		}
+	}
+	return cpus;
+}
+
+std::vector<uint32_t> getNodeCpus(int32_t node)
+{
+	std::ifstream file(fmt::format("/sys/devices/system/node/node{}/cpulist", node));
+	std::string list;
+	std::getline(file, list);
+	return parseCpuList(list);
+}
+
+}  // namespace
+
+void ThreadTopology::load()
+{
+	enabled = g_configManager().getBoolean(THREAD_TOPOLOGY);
+	if (!enabled) {
+		return;
+	}
+
+	const std::array<std::pair<stringConfig_t, integerConfig_t>, THREAD_ROLE_LAST> roleConfigs = {{
+		{ DISPATCHER_THREAD_CPUS, DISPATCHER_THREAD_NUMA_NODE },
+		{ SCHEDULER_THREAD_CPUS, SCHEDULER_THREAD_NUMA_NODE },
+		{ NETWORK_THREAD_CPUS, NETWORK_THREAD_NUMA_NODE },
+		{ DATABASE_THREAD_CPUS, DATABASE_THREAD_NUMA_NODE },
+		{ WORKER_THREAD_CPUS, WORKER_THREAD_NUMA_NODE },
+	}};
+
+	for (size_t role = 0; role < THREAD_ROLE_LAST; ++role) {
+		RoleTopology& topology = roles[role];
+		topology.cpus = parseCpuList(g_configManager().getString(roleConfigs[role].first));
+		topology.numaNode = g_configManager().getNumber(roleConfigs[role].second);
+		if (topology.cpus.empty() && topology.numaNode >= 0) {
+			topology.cpus = getNodeCpus(topology.numaNode);
+			if (topology.cpus.empty()) {
+				SPDLOG_WARN("[ThreadTopology::load] - NUMA node {} of the {} threads has no cpus", topology.numaNode, roleNames[role]);
+			}
+		}
+
+		if (!topology.cpus.empty() || topology.numaNode >= 0) {
+			SPDLOG_INFO("Thread topology: {} threads on {} cpus, memory node {}", roleNames[role], topology.cpus.size(), topology.numaNode);
+		}
+	}
+
+#if !defined(__linux__)
+	SPDLOG_WARN("[ThreadTopology::load] - CPU affinity and NUMA nodes are only applied on Linux");
+#endif
+}
+
+void ThreadTopology::applyToCurrentThread(ThreadRole role, size_t index) const
+{
+#if !defined(_WIN32)
+	applyToThread(pthread_self(), role, index);
+#endif
+	bindMemory(role);
+}
+
+void ThreadTopology::applyToThread(std::thread::native_handle_type handle, ThreadRole role, size_t index) const
+{
+#if defined(__linux__)
+	pthread_setname_np(handle, getThreadName(role, index).c_str());
+#elif defined(__APPLE__)
+	// macOS only names the calling thread
+	if (pthread_equal(handle, pthread_self())) {
+		pthread_setname_np(getThreadName(role, index).c_str());
+	}
+#endif
+	setAffinity(handle, role, index);
+}
+
+void ThreadTopology::bindMemory(ThreadRole role) const
+{
+#if defined(__linux__)
+	int32_t node = roles[role].numaNode;
+	if (!enabled || node < 0) {
+		return;
+	}
+
+	// the kernel reads one bit less than maxnode
+	constexpr size_t maskBits = sizeof(unsigned long) * 8;
+	if (static_cast<size_t>(node) >= maskBits - 1) {
+		SPDLOG_WARN("[ThreadTopology::bindMemory] - NUMA node {} is out of range", node);
+		return;
+	}
+
+	unsigned long nodeMask = 1UL << node;
+	if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodeMask, maskBits) != 0) {
+		SPDLOG_WARN("[ThreadTopology::bindMemory] - Cannot prefer NUMA node {}: {}", node, strerror(errno));
+	}
+#else
+	(void)role;
+#endif
+}
+
+std::string ThreadTopology::getThreadName(ThreadRole role, size_t index)
+{
+	// the names are cut at 15 characters by the kernel
+	if (role == THREAD_ROLE_DISPATCHER || role == THREAD_ROLE_SCHEDULER) {
+		return roleNames[role];
+	}
+	return fmt::format("{}-{}", roleNames[role], index);
+}
+
+void ThreadTopology::setAffinity(std::thread::native_handle_type handle, ThreadRole role, size_t index) const
+{
+#if defined(__linux__)
+	const std::vector<uint32_t>& cpus = roles[role].cpus;
+	if (!enabled || cpus.empty()) {
+		return;
+	}
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if (role == THREAD_ROLE_DISPATCHER || role == THREAD_ROLE_SCHEDULER) {
+		for (uint32_t cpu : cpus) {
+			CPU_SET(cpu, &cpuSet);
+		}
+	} else {
+		CPU_SET(cpus[index % cpus.size()], &cpuSet);
+	}
+
+	if (int error = pthread_setaffinity_np(handle, sizeof(cpuSet), &cpuSet); error != 0) {
+		SPDLOG_WARN("[ThreadTopology::setAffinity] - Cannot pin the {} thread: {}", getThreadName(role, index), strerror(error));
+	}
+#else
+	(void)handle;
+	(void)role;
+	(void)index;
+#endif
+}
@@ -0,0 +1,91 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_THREAD_TOPOLOGY_HPP_
+#define SRC_UTILS_THREAD_TOPOLOGY_HPP_
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum ThreadRole : uint8_t {
+	THREAD_ROLE_DISPATCHER,
+	THREAD_ROLE_SCHEDULER,
+	THREAD_ROLE_NETWORK,
+	THREAD_ROLE_DATABASE,
+	THREAD_ROLE_WORKER,
+
+	THREAD_ROLE_LAST
+};
+
+/**
+ * Names, CPU affinity and NUMA memory node of the server threads by role,
+ * from the threadTopology section of config.lua.
+ * Each role takes a CPU list ("0-3,8") and a NUMA node, a node without a CPU
+ * list uses the CPUs of that node. Single threads may run on any CPU of their
+ * list, the threads of a pool are pinned round robin to one CPU each.
+ * The memory node is a preferred policy of the calling thread, so memory it
+ * touches first (the map, loaded on the dispatcher) is placed on that node.
+ * Affinity and memory nodes are Linux only, thread names are set everywhere
+ * pthreads are.
+ */
+class ThreadTopology
+{
+	public:
+		ThreadTopology() = default;
+
+		// Singleton - ensures we don't accidentally copy it.
+		ThreadTopology(const ThreadTopology&) = delete;
+		ThreadTopology& operator=(const ThreadTopology&) = delete;
+
+		static ThreadTopology& getInstance() {
+			// Guaranteed to be destroyed
+			static ThreadTopology instance;
+			// Instantiated on first use
+			return instance;
+		}
+
+		// Reads the configuration, threads started before only get their role through applyToThread
+		void load();
+
+		// name, affinity and memory node of the calling thread
+		void applyToCurrentThread(ThreadRole role, size_t index = 0) const;
+		// name and affinity of a running thread, its memory node can only be set from itself
+		void applyToThread(std::thread::native_handle_type handle, ThreadRole role, size_t index = 0) const;
+		// only the memory node, for threads that allocate on behalf of another role
+		void bindMemory(ThreadRole role) const;
+
+	private:
+		struct RoleTopology {
+			std::vector<uint32_t> cpus;
+			int32_t numaNode = -1;
+		};
+
+		static std::string getThreadName(ThreadRole role, size_t index);
+		void setAffinity(std::thread::native_handle_type handle, ThreadRole role, size_t index) const;
+
+		bool enabled = false;
+		std::array<RoleTopology, THREAD_ROLE_LAST> roles;
+};
+
+constexpr auto g_threadTopology = &ThreadTopology::getInstance;
+
+#endif  // SRC_UTILS_THREAD_TOPOLOGY_HPP_
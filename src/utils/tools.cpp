@@ -19,7 +19,9 @@
 
 #include "pch.hpp"
 
+#include "config/configmanager.h"
 #include "utils/tools.h"
+#include "utils/game_clock.hpp"
 
 void printXMLError(const std::string& where, const std::string& fileName, const pugi::xml_parse_result& result)
 {
@@ -300,27 +302,62 @@ IntegerVector vectorAtoi(const StringVector& stringVector)
 	return returnVector;
 }
 
-std::mt19937& getRandomGenerator()
+namespace {
+
+std::atomic<uint64_t> randomSeed {0};
+std::atomic<uint64_t> seededGenerators {0};
+
+uint64_t getGeneratorSeed()
+{
+	uint64_t seed = randomSeed.load(std::memory_order_relaxed);
+	if (seed != 0) {
+		return seed + seededGenerators.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	std::random_device rd;
+	return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+}  // namespace
+
+RandomGenerator& getRandomGenerator()
 {
-	static std::random_device rd;
-	static std::mt19937 generator(rd());
+	// one per thread, the think and path workers roll too
+	thread_local RandomGenerator generator(getGeneratorSeed());
 	return generator;
 }
 
+void setRandomSeed(uint64_t seed)
+{
+	randomSeed.store(seed, std::memory_order_relaxed);
+	seededGenerators.store(0, std::memory_order_relaxed);
+	getRandomGenerator().seed(seed != 0 ? seed : getGeneratorSeed());
+}
+
 int32_t uniform_random(int32_t minNumber, int32_t maxNumber)
 {
-	static std::uniform_int_distribution<int32_t> uniformRand;
 	if (minNumber == maxNumber) {
 		return minNumber;
 	} else if (minNumber > maxNumber) {
 		std::swap(minNumber, maxNumber);
 	}
-	return uniformRand(getRandomGenerator(), std::uniform_int_distribution<int32_t>::param_type(minNumber, maxNumber));
+
+	// Lemire's multiply and shift, the division only runs for the rare rejected draws
+	const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(maxNumber) - minNumber) + 1;
+	RandomGenerator& generator = getRandomGenerator();
+	uint64_t product = (generator() >> 32) * range;
+	if (static_cast<uint32_t>(product) < range) {
+		const uint32_t threshold = static_cast<uint32_t>((std::numeric_limits<uint32_t>::max() - range + 1) % range);
+		while (static_cast<uint32_t>(product) < threshold) {
+			product = (generator() >> 32) * range;
+		}
+	}
+	return static_cast<int32_t>(minNumber + static_cast<int64_t>(product >> 32));
 }
 
 int32_t normal_random(int32_t minNumber, int32_t maxNumber)
 {
-	static std::normal_distribution<float> normalRand(0.5f, 0.25f);
+	thread_local std::normal_distribution<float> normalRand(0.5f, 0.25f);
 	if (minNumber == maxNumber) {
 		return minNumber;
 	} else if (minNumber > maxNumber) {
@@ -342,7 +379,7 @@ int32_t normal_random(int32_t minNumber, int32_t maxNumber)
 
 bool boolean_random(double probability/* = 0.5*/)
 {
-	static std::bernoulli_distribution booleanRand;
+	thread_local std::bernoulli_distribution booleanRand;
 	return booleanRand(getRandomGenerator(), std::bernoulli_distribution::param_type(probability));
 }
 
@@ -922,6 +959,101 @@ std::string getSkillName(uint8_t skillid)
 	}
 }
 
+namespace {
+
+/**
+ * Adds blocks * ADLER_BLOCK bytes to a and b without reducing them, the caller
+ * keeps a chunk within the 5552 bytes after which b could overflow.
+ * Byte i of n contributes n - i times to b: the weights inside a block come
+ * from a multiply with n..1, the block sums seen so far are added up in sums
+ * and count a whole block each.
+ */
+#if defined(__AVX2__)
+constexpr size_t ADLER_BLOCK = 32;
+
+void adlerBlocks(const uint8_t* data, size_t blocks, uint32_t& a, uint32_t& b)
+{
+	const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m256i zero = _mm256_setzero_si256();
+
+	b += a * static_cast<uint32_t>(blocks * ADLER_BLOCK);
+	__m256i sums = zero, byteSum = zero, weighted = zero;
+	do {
+		const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+		sums = _mm256_add_epi32(sums, byteSum);
+		byteSum = _mm256_add_epi32(byteSum, _mm256_sad_epu8(bytes, zero));
+		weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+		data += ADLER_BLOCK;
+	} while (--blocks);
+	weighted = _mm256_add_epi32(weighted, _mm256_slli_epi32(sums, 5));
+
+	__m128i byteSum128 = _mm_add_epi32(_mm256_castsi256_si128(byteSum), _mm256_extracti128_si256(byteSum, 1));
+	__m128i weighted128 = _mm_add_epi32(_mm256_castsi256_si128(weighted), _mm256_extracti128_si256(weighted, 1));
+	byteSum128 = _mm_add_epi32(byteSum128, _mm_shuffle_epi32(byteSum128, _MM_SHUFFLE(1, 0, 3, 2)));
+	weighted128 = _mm_add_epi32(weighted128, _mm_shuffle_epi32(weighted128, _MM_SHUFFLE(1, 0, 3, 2)));
+	weighted128 = _mm_add_epi32(weighted128, _mm_shuffle_epi32(weighted128, _MM_SHUFFLE(2, 3, 0, 1)));
+	a += static_cast<uint32_t>(_mm_cvtsi128_si32(byteSum128));
+	b += static_cast<uint32_t>(_mm_cvtsi128_si32(weighted128));
+}
+#elif defined(__SSSE3__)
+constexpr size_t ADLER_BLOCK = 16;
+
+void adlerBlocks(const uint8_t* data, size_t blocks, uint32_t& a, uint32_t& b)
+{
+	const __m128i weights = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i zero = _mm_setzero_si128();
+
+	b += a * static_cast<uint32_t>(blocks * ADLER_BLOCK);
+	__m128i sums = zero, byteSum = zero, weighted = zero;
+	do {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		sums = _mm_add_epi32(sums, byteSum);
+		byteSum = _mm_add_epi32(byteSum, _mm_sad_epu8(bytes, zero));
+		weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_maddubs_epi16(bytes, weights), ones));
+		data += ADLER_BLOCK;
+	} while (--blocks);
+	weighted = _mm_add_epi32(weighted, _mm_slli_epi32(sums, 4));
+
+	byteSum = _mm_add_epi32(byteSum, _mm_shuffle_epi32(byteSum, _MM_SHUFFLE(1, 0, 3, 2)));
+	weighted = _mm_add_epi32(weighted, _mm_shuffle_epi32(weighted, _MM_SHUFFLE(1, 0, 3, 2)));
+	weighted = _mm_add_epi32(weighted, _mm_shuffle_epi32(weighted, _MM_SHUFFLE(2, 3, 0, 1)));
+	a += static_cast<uint32_t>(_mm_cvtsi128_si32(byteSum));
+	b += static_cast<uint32_t>(_mm_cvtsi128_si32(weighted));
+}
+#elif defined(__NEON__)
+constexpr size_t ADLER_BLOCK = 16;
+
+void adlerBlocks(const uint8_t* data, size_t blocks, uint32_t& a, uint32_t& b)
+{
+	static constexpr uint8_t weightValues[16] = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+	const uint8x8_t weightsLow = vld1_u8(weightValues);
+	const uint8x8_t weightsHigh = vld1_u8(weightValues + 8);
+
+	b += a * static_cast<uint32_t>(blocks * ADLER_BLOCK);
+	uint32x4_t sums = vdupq_n_u32(0), byteSum = vdupq_n_u32(0), weighted = vdupq_n_u32(0);
+	do {
+		const uint8x16_t bytes = vld1q_u8(data);
+		sums = vaddq_u32(sums, byteSum);
+		byteSum = vpadalq_u16(byteSum, vpaddlq_u8(bytes));
+		uint16x8_t products = vmull_u8(vget_low_u8(bytes), weightsLow);
+		products = vmlal_u8(products, vget_high_u8(bytes), weightsHigh);
+		weighted = vpadalq_u16(weighted, products);
+		data += ADLER_BLOCK;
+	} while (--blocks);
+	weighted = vaddq_u32(weighted, vshlq_n_u32(sums, 4));
+
+	uint32_t lanes[4];
+	vst1q_u32(lanes, byteSum);
+	a += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	vst1q_u32(lanes, weighted);
+	b += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+}  // namespace
+
 uint32_t adlerChecksum(const uint8_t* data, size_t length)
 {
 	if (length > NETWORKMESSAGE_MAXSIZE) {
@@ -936,10 +1068,20 @@ uint32_t adlerChecksum(const uint8_t* data, size_t length)
 		size_t tmp = length > 5552 ? 5552 : length;
 		length -= tmp;
 
-		do {
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__NEON__)
+		if (tmp >= ADLER_BLOCK) {
+			size_t blocks = tmp / ADLER_BLOCK;
+			adlerBlocks(data, blocks, a, b);
+			data += blocks * ADLER_BLOCK;
+			tmp -= blocks * ADLER_BLOCK;
+		}
+#endif
+
+		while (tmp > 0) {
 			a += *data++;
 			b += a;
-		} while (--tmp);
+			--tmp;
+		}
 
 		a %= adler;
 		b %= adler;
@@ -948,6 +1090,44 @@ uint32_t adlerChecksum(const uint8_t* data, size_t length)
 	return (b << 16) | a;
 }
 
+uint32_t updateCrc32(uint32_t checksum, const char* data, size_t size)
+{
+	while (size > 0) {
+		uInt chunk = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+		checksum = crc32(checksum, reinterpret_cast<const Bytef*>(data), chunk);
+		data += chunk;
+		size -= chunk;
+	}
+	return checksum;
+}
+
+bool getFileChecksum(const std::string& fileName, uint64_t& size, uint32_t& checksum)
+{
+	try {
+		boost::iostreams::mapped_file_source source(fileName);
+		size = source.size();
+		checksum = updateCrc32(0, source.data(), source.size());
+	} catch (const std::exception& e) {
+		SPDLOG_ERROR("[getFileChecksum] - Could not read {}: {}", fileName, e.what());
+		return false;
+	}
+	return true;
+}
+
+std::string getCachePath(const std::string& name, const std::string& defaultPath)
+{
+	const std::string& directory = g_configManager().getString(CACHE_DIRECTORY);
+	if (directory.empty()) {
+		return defaultPath;
+	}
+	return (boost::filesystem::path(directory) / name).string();
+}
+
+std::string getCacheTempFileName(const std::string& fileName)
+{
+	return fmt::format("{}.{:08x}.tmp", fileName, std::random_device()());
+}
+
 std::string ucfirst(std::string str)
 {
 	for (char& i : str) {
@@ -1347,7 +1527,12 @@ const char* getReturnMessage(ReturnValue value)
 
 int64_t OTSYS_TIME()
 {
-	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	return GameClock::getMillis();
+}
+
+int64_t OTSYS_PRECISE_TIME()
+{
+	return GameClock::getPreciseMillis();
 }
 
 SpellGroup_t stringToSpellGroup(const std::string &value)
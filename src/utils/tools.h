@@ -23,6 +23,7 @@
 #include "utils/utils_definitions.hpp"
 #include "declarations.hpp"
 #include "game/movement/position.h"
+#include "utils/random.hpp"
 
 void printXMLError(const std::string& where, const std::string& fileName, const pugi::xml_parse_result& result);
 
@@ -48,7 +49,14 @@ constexpr bool hasBitSet(uint32_t flag, uint32_t flags) {
 	return (flags & flag) != 0;
 }
 
-std::mt19937& getRandomGenerator();
+// Generator of the calling thread
+RandomGenerator& getRandomGenerator();
+/**
+ * Seeds the generator of the calling thread with seed and every generator
+ * created afterwards with the following values, so runs can be reproduced.
+ * 0 goes back to seeding from std::random_device.
+ */
+void setRandomSeed(uint64_t seed);
 int32_t uniform_random(int32_t minNumber, int32_t maxNumber);
 int32_t normal_random(int32_t minNumber, int32_t maxNumber);
 bool boolean_random(double probability = 0.5);
@@ -82,6 +90,13 @@ CombatType_t getCombatType(const std::string& combatname);
 std::string getSkillName(uint8_t skillid);
 
 uint32_t adlerChecksum(const uint8_t* data, size_t len);
+uint32_t updateCrc32(uint32_t checksum, const char* data, size_t size);
+// Size and CRC32 of a whole file, false if it cannot be read
+bool getFileChecksum(const std::string& fileName, uint64_t& size, uint32_t& checksum);
+// Where the cache called name is kept: in cacheDirectory when it is set, so that worlds on one host share it, else defaultPath
+std::string getCachePath(const std::string& name, const std::string& defaultPath);
+// Unique name to write fileName through, several processes may build the same shared cache at once
+std::string getCacheTempFileName(const std::string& fileName);
 
 std::string ucfirst(std::string str);
 std::string ucwords(std::string str);
@@ -104,7 +119,10 @@ bool isCaskItem(uint16_t itemId);
 
 std::string getObjectCategoryName(ObjectCategory_t category);
 
+// milliseconds since the epoch from the game clock, one value per dispatcher task
 int64_t OTSYS_TIME();
+// the same clock read now, for measuring time spent inside a task
+int64_t OTSYS_PRECISE_TIME();
 
 SpellGroup_t stringToSpellGroup(const std::string &value);
 
@@ -529,6 +529,7 @@ enum ReloadTypes_t : uint8_t  {
 	RELOAD_TYPE_RAIDS,
 	RELOAD_TYPE_SCRIPTS,
 	RELOAD_TYPE_STAGES,
+	RELOAD_TYPE_CHANGED_SCRIPTS,
 };
 
 enum NameEval_t : uint8_t {
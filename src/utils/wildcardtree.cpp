@@ -21,107 +21,196 @@
 
 #include "utils/wildcardtree.h"
 
-WildcardTreeNode* WildcardTreeNode::getChild(char ch)
+WildcardTree::WildcardTree()
 {
-	auto it = children.find(ch);
-	if (it == children.end()) {
-		return nullptr;
-	}
-	return &it->second;
+	nodes.emplace_back();
 }
 
-const WildcardTreeNode* WildcardTreeNode::getChild(char ch) const
+uint32_t WildcardTree::findChild(uint32_t index, char ch) const
 {
-	auto it = children.find(ch);
-	if (it == children.end()) {
-		return nullptr;
+	const auto& children = nodes[index].children;
+	auto it = std::lower_bound(children.begin(), children.end(), ch, [](const std::pair<char, uint32_t>& child, char value) {
+		return child.first < value;
+	});
+	if (it == children.end() || it->first != ch) {
+		return NO_NODE;
 	}
-	return &it->second;
+	return it->second;
 }
 
-WildcardTreeNode* WildcardTreeNode::addChild(char ch, bool breakp)
+void WildcardTree::setChild(uint32_t index, char ch, uint32_t child)
 {
-	WildcardTreeNode* child = getChild(ch);
-	if (child) {
-		if (breakp && !child->breakpoint) {
-			child->breakpoint = true;
-		}
+	auto& children = nodes[index].children;
+	auto it = std::lower_bound(children.begin(), children.end(), ch, [](const std::pair<char, uint32_t>& entry, char value) {
+		return entry.first < value;
+	});
+	if (it != children.end() && it->first == ch) {
+		it->second = child;
 	} else {
-		auto pair = children.emplace(std::piecewise_construct,
-				std::forward_as_tuple(ch), std::forward_as_tuple(breakp));
-		child = &pair.first->second;
+		children.emplace(it, ch, child);
 	}
-	return child;
 }
 
-void WildcardTreeNode::insert(const std::string& str)
+void WildcardTree::eraseChild(uint32_t index, char ch)
 {
-	WildcardTreeNode* cur = this;
+	auto& children = nodes[index].children;
+	auto it = std::lower_bound(children.begin(), children.end(), ch, [](const std::pair<char, uint32_t>& entry, char value) {
+		return entry.first < value;
+	});
+	if (it != children.end() && it->first == ch) {
+		children.erase(it);
+	}
+}
 
-	size_t length = str.length() - 1;
-	for (size_t pos = 0; pos < length; ++pos) {
-		cur = cur->addChild(str[pos], false);
+uint32_t WildcardTree::allocateNode()
+{
+	if (!freeNodes.empty()) {
+		uint32_t index = freeNodes.back();
+		freeNodes.pop_back();
+		return index;
 	}
 
-	cur->addChild(str[length], true);
+	nodes.emplace_back();
+	return static_cast<uint32_t>(nodes.size() - 1);
 }
 
-void WildcardTreeNode::remove(const std::string& str)
+void WildcardTree::releaseNode(uint32_t index)
 {
-	WildcardTreeNode* cur = this;
-
-	std::stack<WildcardTreeNode*> path;
-	path.push(cur);
-	size_t len = str.length();
-	for (size_t pos = 0; pos < len; ++pos) {
-		cur = cur->getChild(str[pos]);
-		if (!cur) {
+	// keeps the buffers for the next node
+	Node& node = nodes[index];
+	node.label.clear();
+	node.children.clear();
+	node.breakpoint = false;
+	freeNodes.push_back(index);
+}
+
+void WildcardTree::mergeWithChild(uint32_t index)
+{
+	Node& node = nodes[index];
+	if (index == ROOT || node.breakpoint || node.children.size() != 1) {
+		return;
+	}
+
+	uint32_t childIndex = node.children.front().second;
+	Node& child = nodes[childIndex];
+	node.label += child.label;
+	node.children.swap(child.children);
+	node.breakpoint = child.breakpoint;
+	releaseNode(childIndex);
+}
+
+void WildcardTree::insert(const std::string& str)
+{
+	uint32_t cur = ROOT;
+	size_t pos = 0;
+	const size_t length = str.length();
+	while (pos < length) {
+		uint32_t child = findChild(cur, str[pos]);
+		if (child == NO_NODE) {
+			uint32_t leaf = allocateNode();
+			nodes[leaf].label.assign(str, pos, std::string::npos);
+			nodes[leaf].breakpoint = true;
+			setChild(cur, str[pos], leaf);
 			return;
 		}
-		path.push(cur);
+
+		const std::string& label = nodes[child].label;
+		size_t common = 1;
+		while (common < label.length() && pos + common < length && label[common] == str[pos + common]) {
+			++common;
+		}
+
+		if (common < label.length()) {
+			// the name leaves the edge halfway, split it there
+			uint32_t middle = allocateNode();
+			nodes[middle].label.assign(nodes[child].label, 0, common);
+			nodes[child].label.erase(0, common);
+			nodes[middle].children.emplace_back(nodes[child].label.front(), child);
+			setChild(cur, str[pos], middle);
+			child = middle;
+		}
+
+		cur = child;
+		pos += common;
 	}
 
-	cur->breakpoint = false;
+	nodes[cur].breakpoint = true;
+}
 
-	do {
-		cur = path.top();
-		path.pop();
+void WildcardTree::remove(const std::string& str)
+{
+	uint32_t parent = NO_NODE;
+	uint32_t cur = ROOT;
+	size_t pos = 0;
+	const size_t length = str.length();
+	while (pos < length) {
+		uint32_t child = findChild(cur, str[pos]);
+		if (child == NO_NODE) {
+			return;
+		}
 
-		if (!cur->children.empty() || cur->breakpoint || path.empty()) {
-			break;
+		const std::string& label = nodes[child].label;
+		if (str.compare(pos, label.length(), label) != 0) {
+			return;
 		}
 
-		cur = path.top();
+		parent = cur;
+		cur = child;
+		pos += label.length();
+	}
 
-		auto it = cur->children.find(str[--len]);
-		if (it != cur->children.end()) {
-			cur->children.erase(it);
-		}
-	} while (true);
+	nodes[cur].breakpoint = false;
+	if (cur == ROOT) {
+		return;
+	}
+
+	if (nodes[cur].children.empty()) {
+		eraseChild(parent, nodes[cur].label.front());
+		releaseNode(cur);
+		mergeWithChild(parent);
+	} else {
+		mergeWithChild(cur);
+	}
 }
 
-ReturnValue WildcardTreeNode::findOne(const std::string& query, std::string& result) const
+ReturnValue WildcardTree::findOne(const std::string& query, std::string& result) const
 {
-	const WildcardTreeNode* cur = this;
-	for (char pos : query) {
-		cur = cur->getChild(pos);
-		if (!cur) {
+	uint32_t cur = ROOT;
+	size_t pos = 0;
+	const size_t length = query.length();
+	result = query;
+	while (pos < length) {
+		uint32_t child = findChild(cur, query[pos]);
+		if (child == NO_NODE) {
 			return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
 		}
-	}
 
-	result = query;
+		const std::string& label = nodes[child].label;
+		size_t remaining = length - pos;
+		if (remaining < label.length()) {
+			// the query ends inside the edge, which has a single way on
+			if (label.compare(0, remaining, query, pos, remaining) != 0) {
+				return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
+			}
+			result.append(label, remaining, std::string::npos);
+		} else if (query.compare(pos, label.length(), label) != 0) {
+			return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
+		}
+
+		cur = child;
+		pos += label.length();
+	}
 
 	do {
-		size_t size = cur->children.size();
+		const Node& node = nodes[cur];
+		size_t size = node.children.size();
 		if (size == 0) {
 			return RETURNVALUE_NOERROR;
-		} else if (size > 1 || cur->breakpoint) {
+		} else if (size > 1 || node.breakpoint) {
 			return RETURNVALUE_NAMEISTOOAMBIGUOUS;
 		}
 
-		auto it = cur->children.begin();
-		result += it->first;
-		cur = &it->second;
+		cur = node.children.front().second;
+		result += nodes[cur].label;
 	} while (true);
 }
@@ -22,19 +22,21 @@
 
 #include "declarations.hpp"
 
-class WildcardTreeNode
+/**
+ * Radix tree of the online player names for the "name~" completion.
+ * Runs of single characters share one node, and the nodes live in one
+ * vector holding their children as sorted (first character, index) pairs,
+ * so a lookup touches a few contiguous arrays instead of one map node per
+ * character, and logins and logouts allocate next to nothing.
+ */
+class WildcardTree
 {
 	public:
-		explicit WildcardTreeNode(bool initBreakpoint) : breakpoint(initBreakpoint) {}
-		WildcardTreeNode(WildcardTreeNode&& other) = default;
+		WildcardTree();
 
 		// non-copyable
-		WildcardTreeNode(const WildcardTreeNode&) = delete;
-		WildcardTreeNode& operator=(const WildcardTreeNode&) = delete;
-
-		WildcardTreeNode* getChild(char ch);
-		const WildcardTreeNode* getChild(char ch) const;
-		WildcardTreeNode* addChild(char ch, bool breakpoint);
+		WildcardTree(const WildcardTree&) = delete;
+		WildcardTree& operator=(const WildcardTree&) = delete;
 
 		void insert(const std::string& str);
 		void remove(const std::string& str);
@@ -42,8 +44,27 @@ class WildcardTreeNode
 		ReturnValue findOne(const std::string& query, std::string& result) const;
 
 	private:
-		std::map<char, WildcardTreeNode> children;
-		bool breakpoint;
+		static constexpr uint32_t ROOT = 0;
+		static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+		struct Node {
+			// characters from the parent to this node
+			std::string label;
+			std::vector<std::pair<char, uint32_t>> children;
+			// a name ends here
+			bool breakpoint = false;
+		};
+
+		uint32_t findChild(uint32_t index, char ch) const;
+		void setChild(uint32_t index, char ch, uint32_t child);
+		void eraseChild(uint32_t index, char ch);
+		uint32_t allocateNode();
+		void releaseNode(uint32_t index);
+		// joins a node without name and a single child with that child
+		void mergeWithChild(uint32_t index);
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> freeNodes;
 };
 
 #endif  // SRC_UTILS_WILDCARDTREE_H_
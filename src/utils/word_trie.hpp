@@ -0,0 +1,124 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SRC_UTILS_WORD_TRIE_HPP_
+#define SRC_UTILS_WORD_TRIE_HPP_
+
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Case insensitive trie over the words of talkactions and spells.
+ * Every word that starts a text is found in a single walk over the text,
+ * instead of comparing the text with each registered word.
+ */
+template <typename T>
+class WordTrie
+{
+	public:
+		void clear() {
+			nodes.clear();
+		}
+
+		// values of the same word are kept in insertion order
+		void insert(std::string_view word, T value) {
+			if (nodes.empty()) {
+				nodes.emplace_back();
+			}
+
+			uint32_t index = 0;
+			for (char c : word) {
+				index = getOrAddChild(index, fold(c));
+			}
+			nodes[index].values.push_back(std::move(value));
+		}
+
+		/**
+		 * Calls visit(length, value) for every word that text starts with, ignoring case,
+		 * shorter words first. visit returns true to stop the walk.
+		 * \returns whether the walk was stopped
+		 */
+		template <typename Visit>
+		bool forEachPrefix(std::string_view text, Visit&& visit) const {
+			if (nodes.empty()) {
+				return false;
+			}
+
+			uint32_t index = 0;
+			for (size_t length = 0; ; ++length) {
+				for (const T& value : nodes[index].values) {
+					if (visit(length, value)) {
+						return true;
+					}
+				}
+
+				if (length == text.size()) {
+					return false;
+				}
+
+				index = findChild(index, fold(text[length]));
+				if (index == NO_NODE) {
+					return false;
+				}
+			}
+		}
+
+	private:
+		static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+		struct Node {
+			// few children per node, a linear scan beats hashing them
+			std::vector<std::pair<char, uint32_t>> children;
+			std::vector<T> values;
+		};
+
+		// same folding as strncasecmp in the C locale
+		static char fold(char c) {
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+
+		uint32_t findChild(uint32_t index, char c) const {
+			for (const auto& [childChar, child] : nodes[index].children) {
+				if (childChar == c) {
+					return child;
+				}
+			}
+			return NO_NODE;
+		}
+
+		uint32_t getOrAddChild(uint32_t index, char c) {
+			uint32_t child = findChild(index, c);
+			if (child == NO_NODE) {
+				child = static_cast<uint32_t>(nodes.size());
+				// the node is referenced by index, emplace_back may move it
+				nodes.emplace_back();
+				nodes[index].children.emplace_back(c, child);
+			}
+			return child;
+		}
+
+		std::vector<Node> nodes;
+};
+
+#endif  // SRC_UTILS_WORD_TRIE_HPP_
@@ -0,0 +1,114 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "game/game.h"
+#include "items/decay/decay.h"
+#include "items/item.h"
+#include "items/tile.h"
+
+namespace {
+
+// the first item type that decays on its own, 0 if there is none
+uint16_t getDecayingItemId()
+{
+	for (size_t id = 100; id < Item::items.size(); ++id) {
+		const ItemType& itemType = Item::items[id];
+		if (itemType.id != 0 && itemType.decayTo >= 0 && itemType.decayTime > 0) {
+			return static_cast<uint16_t>(id);
+		}
+	}
+	return 0;
+}
+
+// the attributes a dropped piece of loot usually gets
+void BM_ItemAttributesBuild(benchmark::State& state)
+{
+	for (auto _ : state) {
+		ItemAttributes attributes;
+		attributes.setCharges(10);
+		attributes.setCorpseOwner(0x10000001);
+		attributes.setDuration(60000);
+		attributes.setActionId(2000);
+		attributes.setSpecialDescription("benchmark");
+		benchmark::DoNotOptimize(attributes.getCharges() + attributes.getActionId());
+	}
+}
+BENCHMARK(BM_ItemAttributesBuild);
+
+void BM_ItemAttributesRead(benchmark::State& state)
+{
+	ItemAttributes attributes;
+	attributes.setCharges(10);
+	attributes.setCorpseOwner(0x10000001);
+	attributes.setDuration(60000);
+	attributes.setActionId(2000);
+	attributes.setSpecialDescription("benchmark");
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(attributes.getCharges());
+		benchmark::DoNotOptimize(attributes.getCorpseOwner());
+		benchmark::DoNotOptimize(attributes.getDuration());
+		benchmark::DoNotOptimize(attributes.getActionId());
+	}
+}
+BENCHMARK(BM_ItemAttributesRead);
+
+// start and stop decaying a batch of items, what moving a stack of corpses or fields costs
+void BM_DecayChurn(benchmark::State& state)
+{
+	const uint16_t itemId = benchmarkItemsLoaded() ? getDecayingItemId() : 0;
+	if (itemId == 0) {
+		state.SkipWithError("no decaying item type loaded");
+		return;
+	}
+
+	// canDecay needs a parent that is not removed, the items are never added to it
+	StaticTile tile(1024, 1024, 7);
+	std::vector<Item*> items;
+	for (int64_t i = 0; i < state.range(0); ++i) {
+		Item* item = Item::CreateItem(itemId);
+		item->setParent(&tile);
+		item->incrementReferenceCounter();
+		items.push_back(item);
+	}
+
+	for (auto _ : state) {
+		for (Item* item : items) {
+			item->setDuration(3600000);
+			g_decay().startDecay(item);
+		}
+		for (Item* item : items) {
+			g_decay().stopDecay(item);
+		}
+		// drops the references the decay released, as the dispatcher does between tasks
+		g_game().cleanup();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+
+	for (Item* item : items) {
+		item->setParent(nullptr);
+		item->decrementReferenceCounter();
+	}
+}
+BENCHMARK(BM_DecayChurn)->Arg(64)->Arg(4096);
+
+}  // namespace
@@ -0,0 +1,208 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "creatures/monsters/monsters.h"
+#include "lua/functions/lua_functions_loader.hpp"
+#include "lua/scripts/lua_environment.hpp"
+#include "lua/scripts/luascript.h"
+#include "lua/scripts/script_environment.hpp"
+
+namespace {
+
+// one event call the way the script events do it: reserve an environment, push, call
+void BM_LuaEventCall(benchmark::State& state)
+{
+	LuaScriptInterface scriptInterface("Benchmark Interface");
+	scriptInterface.initState();
+	lua_State* L = scriptInterface.getLuaState();
+	if (luaL_dostring(L, "function onBenchmark(a, b) return a < b end") != 0) {
+		state.SkipWithError("failed to load the benchmark script");
+		return;
+	}
+
+	int32_t scriptId = scriptInterface.getEvent("onBenchmark");
+	if (scriptId == -1) {
+		state.SkipWithError("onBenchmark not found");
+		return;
+	}
+
+	int64_t calls = 0;
+	for (auto _ : state) {
+		if (!LuaScriptInterface::reserveScriptEnv()) {
+			state.SkipWithError("script environment stack overflow");
+			break;
+		}
+
+		ScriptEnvironment* env = LuaScriptInterface::getScriptEnv();
+		env->setScriptId(scriptId, &scriptInterface);
+		scriptInterface.pushFunction(scriptId);
+		lua_pushnumber(L, static_cast<lua_Number>(calls));
+		lua_pushnumber(L, static_cast<lua_Number>(calls + 1));
+		calls += scriptInterface.callFunction(2);
+	}
+	benchmark::DoNotOptimize(calls);
+}
+BENCHMARK(BM_LuaEventCall);
+
+// loot of a common hunting ground monster: 20 entries, one of them a bag with 5 more
+MonsterType& getBenchmarkMonsterType()
+{
+	static MonsterType monsterType;
+	if (!monsterType.info.lootItems.empty()) {
+		return monsterType;
+	}
+
+	for (uint16_t i = 0; i < 20; ++i) {
+		LootBlock lootBlock;
+		lootBlock.id = 3031 + i;
+		lootBlock.chance = 1000 * (i + 1);
+		lootBlock.countmax = 1 + i % 5;
+		if (i == 0) {
+			for (uint16_t j = 0; j < 5; ++j) {
+				LootBlock child;
+				child.id = 3100 + j;
+				child.chance = 500;
+				lootBlock.childLoot.push_back(child);
+			}
+		}
+		monsterType.info.lootItems.push_back(lootBlock);
+	}
+	return monsterType;
+}
+
+/**
+ * MonsterType:getLoot() as onDropLoot calls it on every kill.
+ * Arg 1 keeps the registry table built on first use, Arg 0 rebuilds it every
+ * call, which is what every kill paid before the table was cached.
+ */
+void BM_MonsterTypeGetLoot(benchmark::State& state)
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (luaL_dostring(L, "function benchmarkGetLoot(monsterType) return #monsterType:getLoot() end") != 0) {
+		state.SkipWithError("failed to load the benchmark script");
+		return;
+	}
+
+	MonsterType& monsterType = getBenchmarkMonsterType();
+	const bool cached = state.range(0) != 0;
+	for (auto _ : state) {
+		lua_getglobal(L, "benchmarkGetLoot");
+		LuaFunctionsLoader::pushUserdata<MonsterType>(L, &monsterType);
+		LuaFunctionsLoader::setMetatable(L, -1, "MonsterType");
+		if (lua_pcall(L, 1, 1, 0) != 0) {
+			state.SkipWithError(lua_tostring(L, -1));
+			lua_pop(L, 1);
+			break;
+		}
+		benchmark::DoNotOptimize(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+		if (!cached) {
+			luaL_unref(L, LUA_REGISTRYINDEX, monsterType.info.lootTableRef);
+			monsterType.info.lootTableRef = -1;
+		}
+	}
+	monsterType.releaseLootTable();
+}
+BENCHMARK(BM_MonsterTypeGetLoot)->Arg(0)->Arg(1);
+
+// the classes pushed on every creature, item and position event argument
+const std::array<std::pair<LuaDataType, const char*>, 4> benchmarkMetatables = {{
+	{LuaData_Item, "Item"},
+	{LuaData_Player, "Player"},
+	{LuaData_Monster, "Monster"},
+	{LuaData_Position, "Position"},
+}};
+
+// pushing a userdata and looking its metatable up by name, as before the cache
+void BM_SetMetatableByName(benchmark::State& state)
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	const std::string name = benchmarkMetatables[state.range(0)].second;
+	for (auto _ : state) {
+		LuaFunctionsLoader::pushUserdata<void>(L, nullptr);
+		LuaFunctionsLoader::setMetatable(L, -1, name);
+		lua_pop(L, 1);
+	}
+	state.SetLabel(name);
+}
+BENCHMARK(BM_SetMetatableByName)->DenseRange(0, benchmarkMetatables.size() - 1);
+
+// the same push through the registry reference kept by registerClass
+void BM_SetMetatableByType(benchmark::State& state)
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	const auto& [type, name] = benchmarkMetatables[state.range(0)];
+	for (auto _ : state) {
+		LuaFunctionsLoader::pushUserdata<void>(L, nullptr);
+		LuaFunctionsLoader::setMetatable(L, -1, type);
+		lua_pop(L, 1);
+	}
+	state.SetLabel(name);
+}
+BENCHMARK(BM_SetMetatableByType)->DenseRange(0, benchmarkMetatables.size() - 1);
+
+// NetworkMessage:addString as the custom protocol scripts call it, Arg is the string length
+void BM_LuaNetworkMessageAddString(benchmark::State& state)
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (luaL_dostring(L, "local msg = NetworkMessage() function benchmarkAddString(s) msg:reset() msg:addString(s) end") != 0) {
+		state.SkipWithError("failed to load the benchmark script");
+		return;
+	}
+
+	const std::string value(static_cast<size_t>(state.range(0)), 'a');
+	for (auto _ : state) {
+		lua_getglobal(L, "benchmarkAddString");
+		lua_pushlstring(L, value.data(), value.size());
+		if (lua_pcall(L, 1, 0, 0) != 0) {
+			state.SkipWithError(lua_tostring(L, -1));
+			lua_pop(L, 1);
+			break;
+		}
+	}
+}
+BENCHMARK(BM_LuaNetworkMessageAddString)->Arg(16)->Arg(256);
+
+// Position:getDistance between two userdata positions, one of the most called script bindings
+void BM_LuaPositionGetDistance(benchmark::State& state)
+{
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (luaL_dostring(L, "local a, b = Position(100, 100, 7), Position(110, 95, 7) function benchmarkGetDistance() return a:getDistance(b) end") != 0) {
+		state.SkipWithError("failed to load the benchmark script");
+		return;
+	}
+
+	for (auto _ : state) {
+		lua_getglobal(L, "benchmarkGetDistance");
+		if (lua_pcall(L, 0, 1, 0) != 0) {
+			state.SkipWithError(lua_tostring(L, -1));
+			lua_pop(L, 1);
+			break;
+		}
+		benchmark::DoNotOptimize(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+	}
+}
+BENCHMARK(BM_LuaPositionGetDistance);
+
+}  // namespace
@@ -0,0 +1,298 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "creatures/combat/combat.h"
+#include "creatures/creature.h"
+#include "game/game.h"
+#include "lua/functions/lua_functions_loader.hpp"
+#include "lua/scripts/lua_environment.hpp"
+#include "map/map.h"
+
+namespace {
+
+// synthetic floor of plain tiles with walls every 16 tiles, a gap in each
+constexpr uint16_t WORLD_X = 1024;
+constexpr uint16_t WORLD_Y = 1024;
+constexpr uint16_t WORLD_SIZE = 256;
+constexpr uint8_t WORLD_Z = 7;
+constexpr size_t WORLD_CREATURES = 4096;
+
+class BenchmarkCreature final : public Creature
+{
+	public:
+		const std::string& getName() const override {
+			return name;
+		}
+		const std::string& getTypeName() const override {
+			return name;
+		}
+		const std::string& getNameDescription() const override {
+			return name;
+		}
+		CreatureType_t getType() const override {
+			return CREATURETYPE_MONSTER;
+		}
+		void setID() override {
+			if (id == 0) {
+				id = ++lastId;
+			}
+		}
+		void removeList() override {}
+		void addList() override {}
+		std::string getDescription(int32_t) const override {
+			return name;
+		}
+		bool isPushable() const override {
+			return false;
+		}
+
+	private:
+		static inline uint32_t lastId = 0x40000000;
+		const std::string name = "benchmark";
+};
+
+bool isWorldWall(uint16_t x, uint16_t y)
+{
+	return (x % 16 == 8 && y % 16 != 0) || (y % 16 == 8 && x % 16 != 0);
+}
+
+Position getWorldPosition(std::mt19937& generator)
+{
+	std::uniform_int_distribution<uint16_t> offset(0, WORLD_SIZE - 1);
+	Position pos;
+	do {
+		pos = Position(WORLD_X + offset(generator), WORLD_Y + offset(generator), WORLD_Z);
+	} while (isWorldWall(pos.x, pos.y));
+	return pos;
+}
+
+// the world is built on the game map the first time a benchmark needs it and never torn down
+Map& getBenchmarkWorld()
+{
+	static bool built = false;
+	Map& map = g_game().map;
+	if (built) {
+		return map;
+	}
+	built = true;
+
+	for (uint16_t y = WORLD_Y; y < WORLD_Y + WORLD_SIZE; ++y) {
+		for (uint16_t x = WORLD_X; x < WORLD_X + WORLD_SIZE; ++x) {
+			if (!isWorldWall(x, y)) {
+				map.setTile(x, y, WORLD_Z, new StaticTile(x, y, WORLD_Z));
+			}
+		}
+	}
+
+	std::mt19937 generator(WORLD_CREATURES);
+	for (size_t i = 0; i < WORLD_CREATURES; ++i) {
+		auto creature = new BenchmarkCreature();
+		creature->setID();
+		creature->incrementReferenceCounter();
+		map.placeCreature(getWorldPosition(generator), creature, false, true);
+	}
+	return map;
+}
+
+std::vector<Position> getWorldPositions(size_t count)
+{
+	std::mt19937 generator(static_cast<uint32_t>(count));
+	std::vector<Position> positions;
+	positions.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		positions.push_back(getWorldPosition(generator));
+	}
+	return positions;
+}
+
+void BM_SpectatorsCached(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	const Position center(WORLD_X + WORLD_SIZE / 2, WORLD_Y + WORLD_SIZE / 2, WORLD_Z);
+	const bool multifloor = state.range(0) != 0;
+	for (auto _ : state) {
+		SpectatorHashSet spectators;
+		map.getSpectators(spectators, center, multifloor);
+		benchmark::DoNotOptimize(spectators.size());
+	}
+}
+BENCHMARK(BM_SpectatorsCached)->Arg(0)->Arg(1);
+
+void BM_SpectatorsSpread(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	// more centers than the spectator cache holds, most lookups are scans
+	const std::vector<Position> centers = getWorldPositions(SPECTATOR_CACHE_MAX_ENTRIES * 2);
+	const bool multifloor = state.range(0) != 0;
+	size_t next = 0;
+	for (auto _ : state) {
+		SpectatorHashSet spectators;
+		map.getSpectators(spectators, centers[next], multifloor);
+		benchmark::DoNotOptimize(spectators.size());
+		next = (next + 1) % centers.size();
+	}
+}
+BENCHMARK(BM_SpectatorsSpread)->Arg(0)->Arg(1);
+
+// the broadcast pattern of Game before forEachSpectator: a fresh set filled and walked once
+void BM_SpectatorsBroadcastSet(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	const std::vector<Position> centers = getWorldPositions(static_cast<size_t>(state.range(0)));
+	size_t next = 0;
+	for (auto _ : state) {
+		SpectatorHashSet spectators;
+		map.getSpectators(spectators, centers[next], true);
+		uint32_t ids = 0;
+		for (Creature* spectator : spectators) {
+			ids += spectator->getID();
+		}
+		benchmark::DoNotOptimize(ids);
+		next = (next + 1) % centers.size();
+	}
+}
+// one center served from the cache, then more centers than it holds
+BENCHMARK(BM_SpectatorsBroadcastSet)->Arg(1)->Arg(SPECTATOR_CACHE_MAX_ENTRIES * 2);
+
+// the same broadcast visiting the cached set in place
+void BM_SpectatorsBroadcastVisitor(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	const std::vector<Position> centers = getWorldPositions(static_cast<size_t>(state.range(0)));
+	size_t next = 0;
+	for (auto _ : state) {
+		uint32_t ids = 0;
+		map.forEachSpectator(centers[next], true, false, [&ids](Creature* spectator) {
+			ids += spectator->getID();
+		});
+		benchmark::DoNotOptimize(ids);
+		next = (next + 1) % centers.size();
+	}
+}
+BENCHMARK(BM_SpectatorsBroadcastVisitor)->Arg(1)->Arg(SPECTATOR_CACHE_MAX_ENTRIES * 2);
+
+// tile lookups over the whole world, Arg 1 through the flat leaf index and Arg 0 through the quadtree
+void BM_GetTile(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	map.buildLeafIndex(state.range(0) != 0);
+	const std::vector<Position> positions = getWorldPositions(4096);
+	size_t next = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(map.getTile(positions[next]));
+		next = (next + 1) % positions.size();
+	}
+	map.buildLeafIndex(false);
+}
+BENCHMARK(BM_GetTile)->Arg(0)->Arg(1);
+
+// spectator scans, which start from the leaf lookup of their corner, with and without the index
+void BM_SpectatorsLeafIndex(benchmark::State& state)
+{
+	Map& map = getBenchmarkWorld();
+	map.buildLeafIndex(state.range(0) != 0);
+	const std::vector<Position> centers = getWorldPositions(SPECTATOR_CACHE_MAX_ENTRIES * 2);
+	size_t next = 0;
+	for (auto _ : state) {
+		SpectatorHashSet spectators;
+		map.getSpectators(spectators, centers[next], true);
+		benchmark::DoNotOptimize(spectators.size());
+		next = (next + 1) % centers.size();
+	}
+	map.buildLeafIndex(false);
+}
+BENCHMARK(BM_SpectatorsLeafIndex)->Arg(0)->Arg(1);
+
+void BM_PathMatching(benchmark::State& state)
+{
+	const Map& map = getBenchmarkWorld();
+	const std::vector<Position> starts = getWorldPositions(1024);
+	const auto distance = static_cast<int32_t>(state.range(0));
+
+	FindPathParams fpp;
+	fpp.fullPathSearch = true;
+	fpp.clearSight = false;
+	fpp.maxSearchDist = distance * 2;
+	fpp.minTargetDist = 1;
+	fpp.maxTargetDist = 1;
+
+	size_t next = 0;
+	int64_t found = 0;
+	for (auto _ : state) {
+		const Position& start = starts[next];
+		Position target(start.x + distance, start.y + distance, start.z);
+		std::forward_list<Direction> dirList;
+		found += map.getPathMatching(start, dirList, FrozenPathingConditionCall(target), fpp);
+		benchmark::DoNotOptimize(dirList);
+		next = (next + 1) % starts.size();
+	}
+	state.counters["found"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PathMatching)->Arg(4)->Arg(12)->Arg(24);
+
+void BM_CombatAreaList(benchmark::State& state)
+{
+	getBenchmarkWorld();
+	AreaCombat area;
+	area.setupArea(static_cast<int32_t>(state.range(0)));
+
+	const std::vector<Position> targets = getWorldPositions(1024);
+	size_t next = 0;
+	std::vector<Tile*> list;
+	for (auto _ : state) {
+		list.clear();
+		area.getList(targets[next], targets[next], list);
+		benchmark::DoNotOptimize(list.data());
+		next = (next + 1) % targets.size();
+	}
+}
+BENCHMARK(BM_CombatAreaList)->Arg(1)->Arg(3)->Arg(5);
+
+// Game.getSpectators from a script, the kept set plus the returned table of creatures
+void BM_LuaGameGetSpectators(benchmark::State& state)
+{
+	getBenchmarkWorld();
+	lua_State* L = g_luaEnvironment.getLuaState();
+	if (luaL_dostring(L, "function benchmarkGetSpectators(position) return #Game.getSpectators(position, true) end") != 0) {
+		state.SkipWithError("failed to load the benchmark script");
+		return;
+	}
+
+	const std::vector<Position> centers = getWorldPositions(static_cast<size_t>(state.range(0)));
+	size_t next = 0;
+	for (auto _ : state) {
+		lua_getglobal(L, "benchmarkGetSpectators");
+		LuaFunctionsLoader::pushPosition(L, centers[next]);
+		if (lua_pcall(L, 1, 1, 0) != 0) {
+			state.SkipWithError(lua_tostring(L, -1));
+			lua_pop(L, 1);
+			break;
+		}
+		benchmark::DoNotOptimize(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+		next = (next + 1) % centers.size();
+	}
+}
+BENCHMARK(BM_LuaGameGetSpectators)->Arg(1)->Arg(SPECTATOR_CACHE_MAX_ENTRIES * 2);
+
+}  // namespace
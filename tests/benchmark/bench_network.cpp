@@ -0,0 +1,277 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "security/xtea.hpp"
+#include "server/network/message/networkmessage.h"
+#include "server/network/protocol/game_packets.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+// client viewport of GetMapDescription, 18x14 tiles on 8 floors
+constexpr int32_t VIEWPORT_TILES = 18 * 14 * 8;
+
+/**
+ * Writes a message shaped like a map description: a ground id and a few
+ * item ids per tile, skip markers between them and a creature now and then.
+ * Item ids come from a small set so zlib sees the repetition of a real map.
+ */
+void fillMapDescription(NetworkMessage& msg)
+{
+	static constexpr uint16_t itemIds[] = {351, 352, 353, 4526, 4527, 1284, 2767, 3031};
+	uint32_t seed = 0x1234;
+	msg.add<uint8_t>(0x64);
+	msg.addPosition(Position(1024, 1024, 7));
+	for (int32_t tile = 0; tile < VIEWPORT_TILES && msg.getLength() < NETWORKMESSAGE_MAXSIZE - 64; ++tile) {
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 16) % 4 == 0) {
+			msg.add<uint8_t>((seed >> 8) & 0x0F);
+			msg.add<uint8_t>(0xFF);
+			continue;
+		}
+
+		msg.add<uint16_t>(0x00);
+		msg.add<uint16_t>(itemIds[(seed >> 20) % 4]);
+		for (uint32_t i = 0; i < (seed >> 24) % 3; ++i) {
+			msg.add<uint16_t>(itemIds[4 + (seed >> (i * 2)) % 4]);
+		}
+		if ((seed >> 12) % 16 == 0) {
+			msg.add<uint16_t>(0x61);
+			msg.add<uint32_t>(0);
+			msg.add<uint32_t>(0x40000000 + tile);
+			msg.addString("benchmark");
+			msg.add<uint8_t>(100);
+		}
+	}
+}
+
+void BM_NetworkMessageMapDescription(benchmark::State& state)
+{
+	NetworkMessage msg;
+	for (auto _ : state) {
+		msg.reset();
+		fillMapDescription(msg);
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_NetworkMessageMapDescription);
+
+// packets of one busy game frame, the schema writes are compared with the add chains they replaced
+constexpr int32_t FRAME_PACKETS = 256;
+
+void BM_MagicEffectChain(benchmark::State& state)
+{
+	NetworkMessage msg;
+	const Position pos(1024, 1024, 7);
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			msg.addByte(0x83);
+			msg.addPosition(pos);
+			msg.addByte(MAGIC_EFFECTS_CREATE_EFFECT);
+			msg.addByte(static_cast<uint8_t>(i));
+			msg.addByte(MAGIC_EFFECTS_END_LOOP);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_MagicEffectChain);
+
+void BM_MagicEffectSchema(benchmark::State& state)
+{
+	NetworkMessage msg;
+	const Position pos(1024, 1024, 7);
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			PacketMagicEffect::write(msg, pos, MAGIC_EFFECTS_CREATE_EFFECT, static_cast<uint8_t>(i), MAGIC_EFFECTS_END_LOOP);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_MagicEffectSchema);
+
+void BM_CreatureMoveChain(benchmark::State& state)
+{
+	NetworkMessage msg;
+	const Position oldPos(1024, 1024, 7);
+	const Position newPos(1025, 1024, 7);
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			msg.addByte(0x6D);
+			msg.addPosition(oldPos);
+			msg.addByte(static_cast<uint8_t>(i % 10));
+			msg.addPosition(newPos);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_CreatureMoveChain);
+
+void BM_CreatureMoveSchema(benchmark::State& state)
+{
+	NetworkMessage msg;
+	const Position oldPos(1024, 1024, 7);
+	const Position newPos(1025, 1024, 7);
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			PacketCreatureMove::write(msg, oldPos, static_cast<uint8_t>(i % 10), newPos);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_CreatureMoveSchema);
+
+// the 21 fields of sendStats, the longest of the migrated packets
+void BM_PlayerStatsChain(benchmark::State& state)
+{
+	NetworkMessage msg;
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			msg.addByte(0xA0);
+			msg.add<uint16_t>(1500);
+			msg.add<uint16_t>(1800);
+			msg.add<uint32_t>(250000);
+			msg.add<uint64_t>(123456789 + i);
+			msg.add<uint16_t>(120);
+			msg.addByte(42);
+			msg.add<uint16_t>(100);
+			msg.add<uint16_t>(0);
+			msg.add<uint16_t>(0);
+			msg.add<uint16_t>(150);
+			msg.add<uint16_t>(3000);
+			msg.add<uint16_t>(3400);
+			msg.addByte(100);
+			msg.add<uint16_t>(2520);
+			msg.add<uint16_t>(330);
+			msg.add<uint16_t>(0);
+			msg.add<uint16_t>(720);
+			msg.add<uint16_t>(0);
+			msg.addByte(1);
+			msg.add<uint16_t>(0);
+			msg.add<uint16_t>(0);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_PlayerStatsChain);
+
+void BM_PlayerStatsSchema(benchmark::State& state)
+{
+	NetworkMessage msg;
+	for (auto _ : state) {
+		msg.reset();
+		for (int32_t i = 0; i < FRAME_PACKETS; ++i) {
+			PacketPlayerStats::write(msg,
+				1500, 1800, 250000, 123456789 + i, 120, 42,
+				100, 0, 0, 150, 3000, 3400, 100, 2520,
+				330, 0, 720,
+				0, 1, 0, 0);
+		}
+		benchmark::DoNotOptimize(msg.getBuffer());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+}
+BENCHMARK(BM_PlayerStatsSchema);
+
+void BM_XteaEncrypt(benchmark::State& state)
+{
+	const xtea::RoundKeys keys = xtea::expandEncryptKey({0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210});
+	std::vector<uint8_t> buffer(static_cast<size_t>(state.range(0)), 0xA5);
+	for (auto _ : state) {
+		xtea::encrypt(buffer.data(), buffer.size(), keys);
+		benchmark::DoNotOptimize(buffer.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_XteaEncrypt)->Arg(64)->Arg(1024)->Arg(16384);
+
+void BM_XteaDecrypt(benchmark::State& state)
+{
+	const xtea::RoundKeys keys = xtea::expandDecryptKey({0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210});
+	std::vector<uint8_t> buffer(static_cast<size_t>(state.range(0)), 0xA5);
+	for (auto _ : state) {
+		xtea::decrypt(buffer.data(), buffer.size(), keys);
+		benchmark::DoNotOptimize(buffer.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_XteaDecrypt)->Arg(64)->Arg(1024)->Arg(16384);
+
+// checksum of every message sent and received, see Protocol::onSendMessage
+void BM_AdlerChecksum(benchmark::State& state)
+{
+	std::vector<uint8_t> buffer(static_cast<size_t>(state.range(0)));
+	uint32_t seed = 0x1234;
+	for (uint8_t& byte : buffer) {
+		seed = seed * 1103515245 + 12345;
+		byte = static_cast<uint8_t>(seed >> 16);
+	}
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(adlerChecksum(buffer.data(), buffer.size()));
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_AdlerChecksum)->Arg(64)->Arg(1024)->Arg(16384);
+
+// raw deflate of a map description with the stream settings of Protocol::enableCompression
+void BM_DeflateMapDescription(benchmark::State& state)
+{
+	NetworkMessage msg;
+	fillMapDescription(msg);
+
+	z_stream stream {};
+	if (deflateInit2(&stream, static_cast<int>(state.range(0)), Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+		state.SkipWithError("deflateInit2 failed");
+		return;
+	}
+
+	std::vector<uint8_t> output(NETWORKMESSAGE_MAXSIZE);
+	uLong compressedSize = 0;
+	for (auto _ : state) {
+		stream.next_in = msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION;
+		stream.avail_in = msg.getLength();
+		stream.next_out = output.data();
+		stream.avail_out = static_cast<uInt>(output.size());
+		deflate(&stream, Z_FINISH);
+		compressedSize = stream.total_out;
+		deflateReset(&stream);
+	}
+	deflateEnd(&stream);
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * msg.getLength());
+	state.counters["ratio"] = static_cast<double>(compressedSize) / msg.getLength();
+}
+BENCHMARK(BM_DeflateMapDescription)->Arg(1)->Arg(6)->Arg(9);
+
+}  // namespace
@@ -0,0 +1,148 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "game/scheduling/scheduler.h"
+
+namespace {
+
+// far enough in the future that nothing fires while the benchmark runs
+constexpr uint32_t PENDING_DELAY = 3600000;
+
+/**
+ * The event list the scheduler had before the timing wheel, as the baseline
+ * of the BM_Scheduler cases: a heap ordered by expiration plus the set of
+ * live ids, behind one mutex. stopEvent only drops the id, the task stays in
+ * the heap until it expires; expired tops are dropped on add here, the work
+ * the scheduler thread did when they came up.
+ */
+class HeapScheduler
+{
+	public:
+		~HeapScheduler() {
+			while (!eventList.empty()) {
+				delete eventList.top();
+				eventList.pop();
+			}
+		}
+
+		uint32_t addEvent(SchedulerTask* task) {
+			std::lock_guard<std::mutex> lockClass(eventLock);
+			const auto now = std::chrono::steady_clock::now();
+			while (!eventList.empty() && eventList.top()->getCycle() <= now) {
+				SchedulerTask* expired = eventList.top();
+				eventList.pop();
+				eventIds.erase(expired->getEventId());
+				delete expired;
+			}
+
+			if (++lastEventId == 0) {
+				lastEventId = 1;
+			}
+			task->setEventId(lastEventId);
+			eventIds.insert(task->getEventId());
+			eventList.push(task);
+			return task->getEventId();
+		}
+
+		bool stopEvent(uint32_t eventId) {
+			std::lock_guard<std::mutex> lockClass(eventLock);
+			return eventIds.erase(eventId) != 0;
+		}
+
+		size_t size() const {
+			return eventList.size();
+		}
+
+	private:
+		struct TaskComparator {
+			bool operator()(const SchedulerTask* lhs, const SchedulerTask* rhs) const {
+				return lhs->getCycle() > rhs->getCycle();
+			}
+		};
+
+		std::mutex eventLock;
+		uint32_t lastEventId = 0;
+		std::priority_queue<SchedulerTask*, std::deque<SchedulerTask*>, TaskComparator> eventList;
+		phmap::flat_hash_set<uint32_t> eventIds;
+};
+
+void BM_SchedulerAddStop(benchmark::State& state)
+{
+	for (auto _ : state) {
+		uint32_t eventId = g_scheduler().addEvent(createSchedulerTask(PENDING_DELAY, [] {}));
+		g_scheduler().stopEvent(eventId);
+	}
+}
+BENCHMARK(BM_SchedulerAddStop);
+
+// the same with this many other events waiting, as on a busy server
+void BM_SchedulerAddStopLoaded(benchmark::State& state)
+{
+	std::vector<uint32_t> pending;
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<uint32_t> delay(SCHEDULER_MINTICKS, PENDING_DELAY);
+	for (int64_t i = 0; i < state.range(0); ++i) {
+		pending.push_back(g_scheduler().addEvent(createSchedulerTask(PENDING_DELAY + delay(generator), [] {})));
+	}
+
+	for (auto _ : state) {
+		uint32_t eventId = g_scheduler().addEvent(createSchedulerTask(delay(generator), [] {}));
+		g_scheduler().stopEvent(eventId);
+	}
+
+	for (uint32_t eventId : pending) {
+		g_scheduler().stopEvent(eventId);
+	}
+}
+BENCHMARK(BM_SchedulerAddStopLoaded)->Arg(1000)->Arg(100000);
+
+// the same loads on the heap, stopped tasks pile up in it as they did
+void BM_HeapSchedulerAddStop(benchmark::State& state)
+{
+	HeapScheduler scheduler;
+	for (auto _ : state) {
+		uint32_t eventId = scheduler.addEvent(createSchedulerTask(PENDING_DELAY, [] {}));
+		scheduler.stopEvent(eventId);
+	}
+	state.counters["heap"] = static_cast<double>(scheduler.size());
+}
+BENCHMARK(BM_HeapSchedulerAddStop);
+
+void BM_HeapSchedulerAddStopLoaded(benchmark::State& state)
+{
+	HeapScheduler scheduler;
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<uint32_t> delay(SCHEDULER_MINTICKS, PENDING_DELAY);
+	for (int64_t i = 0; i < state.range(0); ++i) {
+		scheduler.addEvent(createSchedulerTask(PENDING_DELAY + delay(generator), [] {}));
+	}
+
+	for (auto _ : state) {
+		uint32_t eventId = scheduler.addEvent(createSchedulerTask(delay(generator), [] {}));
+		scheduler.stopEvent(eventId);
+	}
+	state.counters["heap"] = static_cast<double>(scheduler.size());
+}
+BENCHMARK(BM_HeapSchedulerAddStopLoaded)->Arg(1000)->Arg(100000);
+
+}  // namespace
@@ -0,0 +1,142 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "utils/wildcardtree.h"
+
+namespace {
+
+// the name tree before the radix tree: one std::map node per character, kept as the baseline
+class MapWildcardTree
+{
+	public:
+		MapWildcardTree() = default;
+		explicit MapWildcardTree(bool initBreakpoint) : breakpoint(initBreakpoint) {}
+
+		void insert(const std::string& str) {
+			MapWildcardTree* cur = this;
+			for (size_t pos = 0; pos < str.length(); ++pos) {
+				cur = &cur->children.try_emplace(str[pos], false).first->second;
+			}
+			cur->breakpoint = true;
+		}
+
+		void remove(const std::string& str) {
+			std::vector<MapWildcardTree*> path = {this};
+			for (char ch : str) {
+				auto it = path.back()->children.find(ch);
+				if (it == path.back()->children.end()) {
+					return;
+				}
+				path.push_back(&it->second);
+			}
+
+			path.back()->breakpoint = false;
+			for (size_t len = str.length(); len > 0; --len) {
+				const MapWildcardTree* cur = path[len];
+				if (!cur->children.empty() || cur->breakpoint) {
+					break;
+				}
+				path[len - 1]->children.erase(str[len - 1]);
+			}
+		}
+
+		ReturnValue findOne(const std::string& query, std::string& result) const {
+			const MapWildcardTree* cur = this;
+			for (char ch : query) {
+				auto it = cur->children.find(ch);
+				if (it == cur->children.end()) {
+					return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
+				}
+				cur = &it->second;
+			}
+
+			result = query;
+			while (!cur->children.empty()) {
+				if (cur->children.size() > 1 || cur->breakpoint) {
+					return RETURNVALUE_NAMEISTOOAMBIGUOUS;
+				}
+				result += cur->children.begin()->first;
+				cur = &cur->children.begin()->second;
+			}
+			return RETURNVALUE_NOERROR;
+		}
+
+	private:
+		std::map<char, MapWildcardTree> children;
+		bool breakpoint = false;
+};
+
+// lowercase names the way Game keys them, sharing the prefixes real names share
+std::vector<std::string> getPlayerNames(size_t count)
+{
+	static const std::array<const char*, 8> prefixes = {{"sir ", "lady ", "knight ", "druid ", "el ", "dark ", "mage ", ""}};
+	std::mt19937 generator(static_cast<uint32_t>(count));
+	std::uniform_int_distribution<size_t> prefix(0, prefixes.size() - 1);
+	std::uniform_int_distribution<int> letter('a', 'z');
+	std::uniform_int_distribution<size_t> length(3, 12);
+
+	std::vector<std::string> names;
+	names.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		std::string name = prefixes[prefix(generator)];
+		for (size_t j = length(generator); j > 0; --j) {
+			name += static_cast<char>(letter(generator));
+		}
+		names.push_back(name + std::to_string(i));
+	}
+	return names;
+}
+
+/**
+ * Login and logout storm: Arg names are online, each iteration one of them
+ * logs out, another logs in and a "name~" lookup completes a third.
+ */
+template <class Tree>
+void BM_WildcardTreeStorm(benchmark::State& state)
+{
+	const size_t online = static_cast<size_t>(state.range(0));
+	// twice the online names, the second half waits for its login
+	std::vector<std::string> names = getPlayerNames(online * 2);
+	Tree tree;
+	for (size_t i = 0; i < online; ++i) {
+		tree.insert(names[i]);
+	}
+
+	std::string result;
+	size_t next = 0;
+	for (auto _ : state) {
+		const size_t logout = next % online;
+		const size_t login = online + next % online;
+		tree.remove(names[logout]);
+		tree.insert(names[login]);
+		std::swap(names[logout], names[login]);
+
+		const std::string& query = names[(next * 7) % online];
+		benchmark::DoNotOptimize(tree.findOne(query.substr(0, query.size() / 2), result));
+		++next;
+	}
+}
+BENCHMARK_TEMPLATE(BM_WildcardTreeStorm, MapWildcardTree)->Arg(100)->Arg(2000);
+BENCHMARK_TEMPLATE(BM_WildcardTreeStorm, WildcardTree)->Arg(100)->Arg(2000);
+
+}  // namespace
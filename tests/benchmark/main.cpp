@@ -0,0 +1,67 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "bench.hpp"
+#include "game/game.h"
+#include "game/scheduling/scheduler.h"
+#include "items/item.h"
+#include "lua/scripts/lua_environment.hpp"
+
+namespace {
+
+bool itemsLoaded = false;
+
+}  // namespace
+
+bool benchmarkItemsLoaded()
+{
+	return itemsLoaded;
+}
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+
+	spdlog::set_level(spdlog::level::warn);
+
+	// same relative paths as the server, run from the repository root
+	itemsLoaded = g_game().loadAppearanceProtobuf("data/items/appearances.dat") == ERROR_NONE && Item::items.loadFromXml();
+	if (!itemsLoaded) {
+		SPDLOG_WARN("Item data not found, the item benchmarks are skipped");
+	}
+
+	// the Lua benchmarks run on the environment state with every class registered
+	g_luaEnvironment.initState();
+
+	// the scheduler drops events while it is not running
+	g_scheduler().start();
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	g_scheduler().shutdown();
+	g_scheduler().join();
+	return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * Open Tibia Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020 Open Tibia Community
+ */
+
+#include "src/creatures/creature_registry.hpp"
+#include <catch2/catch.hpp>
+#include <vector>
+
+namespace {
+
+struct TestCreature {
+	uint32_t id = 0;
+
+	uint32_t getID() const {
+		return id;
+	}
+};
+
+using TestRegistry = CreatureRegistry<TestCreature, MONSTER_ID_BASE>;
+
+}
+
+TEST_CASE("Released Id Stops Resolving", "[UnitTest]") {
+	TestRegistry registry;
+	TestCreature creature;
+	creature.id = registry.acquire(&creature);
+	registry.add(&creature);
+	CHECK(registry.get(creature.id) == &creature);
+
+	uint32_t oldId = creature.id;
+	registry.release(oldId);
+	CHECK(registry.get(oldId) == nullptr);
+	CHECK(registry.size() == 0);
+}
+
+TEST_CASE("Slot Reuse Distance Stays Above The Free Pool", "[UnitTest]") {
+	// a steady population, every creation replaces the oldest creature like respawns do
+	const size_t population = 64;
+	// a local copy, REQUIRE takes its operands by reference
+	const size_t minFreeSlots = TestRegistry::MIN_FREE_SLOTS;
+	const size_t creations = (minFreeSlots + population) * 3;
+
+	TestRegistry registry;
+	std::vector<TestCreature> creatures(population);
+	// creation number when each slot was last handed out
+	std::vector<size_t> lastCreation;
+	size_t reuses = 0;
+
+	for (size_t i = 0; i < creations; ++i) {
+		TestCreature& creature = creatures[i % population];
+		if (creature.id != 0) {
+			uint32_t oldId = creature.id;
+			registry.release(oldId);
+			CHECK(registry.get(oldId) == nullptr);
+		}
+
+		creature.id = registry.acquire(&creature);
+		REQUIRE(creature.id != 0);
+		registry.add(&creature);
+
+		uint32_t slot = (creature.id - MONSTER_ID_BASE) & TestRegistry::SLOT_MASK;
+		if (slot >= lastCreation.size()) {
+			lastCreation.resize(slot + 1, creations);
+		}
+		if (lastCreation[slot] != creations) {
+			REQUIRE(i - lastCreation[slot] >= minFreeSlots);
+			++reuses;
+		}
+		lastCreation[slot] = i;
+	}
+
+	CHECK(reuses > 0);
+	CHECK(registry.size() == population);
+}
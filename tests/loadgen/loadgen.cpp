@@ -0,0 +1,109 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "loadgen.hpp"
+
+void LoadgenSession::onConnecting()
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	++window.connecting;
+}
+
+void LoadgenSession::onLogin(uint32_t playerId, uint64_t micros)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	--window.connecting;
+	++window.online;
+	++window.logins;
+	window.login.record(micros);
+	if (playerId != 0) {
+		onlinePlayers.push_back(playerId);
+	}
+}
+
+void LoadgenSession::onLoginFailed()
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	--window.connecting;
+	++window.failedLogins;
+}
+
+void LoadgenSession::onDisconnect(uint32_t playerId)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	--window.online;
+	++window.disconnects;
+	auto it = std::find(onlinePlayers.begin(), onlinePlayers.end(), playerId);
+	if (it != onlinePlayers.end()) {
+		*it = onlinePlayers.back();
+		onlinePlayers.pop_back();
+	}
+}
+
+void LoadgenSession::onAction()
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	++window.actions;
+}
+
+void LoadgenSession::onSend(size_t bytes)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	window.bytesSent += bytes;
+}
+
+void LoadgenSession::onReceive(size_t bytes)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	window.bytesReceived += bytes;
+}
+
+void LoadgenSession::recordRoundTrip(uint64_t micros)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	window.roundTrip.record(micros);
+}
+
+uint32_t LoadgenSession::getAttackTarget(uint32_t playerId, uint32_t seed)
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	if (onlinePlayers.size() < 2) {
+		return 0;
+	}
+
+	uint32_t targetId = onlinePlayers[seed % onlinePlayers.size()];
+	if (targetId == playerId) {
+		targetId = onlinePlayers[(seed + 1) % onlinePlayers.size()];
+	}
+	return targetId;
+}
+
+LoadgenReport LoadgenSession::takeReport()
+{
+	std::lock_guard<std::mutex> lockClass(lock);
+	LoadgenReport report = window;
+	// the gauges carry over to the next window
+	window = {};
+	window.connecting = report.connecting;
+	window.online = report.online;
+	return report;
+}
@@ -0,0 +1,146 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef TESTS_LOADGEN_LOADGEN_HPP_
+#define TESTS_LOADGEN_LOADGEN_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "game/movement/position.h"
+#include "game/scheduling/dispatcher_profiler.hpp"
+
+enum LoadgenAction_t : uint8_t {
+	LOADGEN_ACTION_WALK,
+	LOADGEN_ACTION_SAY,
+	LOADGEN_ACTION_ATTACK,
+	LOADGEN_ACTION_USE,
+};
+
+struct LoadgenAccount {
+	std::string email;
+	std::string password;
+	std::string character;
+};
+
+// item used by the USE action, a depot locker next to the spawn opens the depot
+struct LoadgenUseTarget {
+	Position pos;
+	uint16_t itemId = 0;
+	uint8_t stackpos = 0;
+};
+
+struct LoadgenOptions {
+	std::string host = "127.0.0.1";
+	uint16_t gamePort = 7172;
+	// 0 = the server metrics are not scraped
+	uint16_t metricsPort = 0;
+	std::string accountsFile = "loadgen_accounts.txt";
+	std::string keyFile = "key.pem";
+	// 0 = one client per account
+	uint32_t clients = 0;
+	uint32_t threads = 2;
+	// seconds
+	uint32_t duration = 60;
+	uint32_t rampUp = 10;
+	uint32_t reportInterval = 10;
+	uint32_t reconnectDelay = 5;
+	// milliseconds between two scripted actions of a client
+	uint32_t actionInterval = 500;
+	std::vector<LoadgenAction_t> script {LOADGEN_ACTION_WALK, LOADGEN_ACTION_WALK, LOADGEN_ACTION_SAY, LOADGEN_ACTION_WALK, LOADGEN_ACTION_ATTACK, LOADGEN_ACTION_USE};
+	std::vector<LoadgenUseTarget> useTargets;
+};
+
+struct LoadgenReport {
+	uint32_t connecting = 0;
+	uint32_t online = 0;
+	uint64_t logins = 0;
+	uint64_t failedLogins = 0;
+	uint64_t disconnects = 0;
+	uint64_t actions = 0;
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+	LatencyHistogram login;
+	LatencyHistogram roundTrip;
+};
+
+/**
+ * State shared by every virtual client: the counters and latency histograms of
+ * the current report window and the ids of the players online, the attack targets.
+ * Clients run on several network threads, the histograms are behind a mutex.
+ */
+class LoadgenSession
+{
+	public:
+		explicit LoadgenSession(LoadgenOptions options) : options(std::move(options)) {}
+
+		const LoadgenOptions& getOptions() const {
+			return options;
+		}
+
+		bool isRunning() const {
+			return running.load(std::memory_order_relaxed);
+		}
+		void stop() {
+			running.store(false, std::memory_order_relaxed);
+		}
+
+		void onConnecting();
+		void onLogin(uint32_t playerId, uint64_t micros);
+		void onLoginFailed();
+		void onDisconnect(uint32_t playerId);
+		void onAction();
+		void onSend(size_t bytes);
+		void onReceive(size_t bytes);
+		void recordRoundTrip(uint64_t micros);
+
+		// any other online player, 0 when there is none
+		uint32_t getAttackTarget(uint32_t playerId, uint32_t seed);
+
+		// counters and histograms since the previous call
+		LoadgenReport takeReport();
+
+	private:
+		LoadgenOptions options;
+		std::atomic<bool> running {true};
+
+		std::mutex lock;
+		LoadgenReport window;
+		std::vector<uint32_t> onlinePlayers;
+};
+
+struct ServerMetricsSample {
+	bool valid = false;
+	double dispatcherLag = 0;
+	uint64_t tasksRun = 0;
+	uint64_t socketReads = 0;
+	uint64_t socketWrites = 0;
+	// cumulative counts of canary_dispatcher_cycle_seconds by upper bound
+	std::vector<std::pair<double, uint64_t>> cycleBuckets;
+};
+
+// GET /metrics on the metrics port of the server
+ServerMetricsSample scrapeServerMetrics(const std::string& host, uint16_t port);
+// upper bound in seconds of the bucket holding the percentile of the cycles between two samples
+double getCyclePercentile(const ServerMetricsSample& from, const ServerMetricsSample& to, double percentile);
+
+#endif  // TESTS_LOADGEN_LOADGEN_HPP_
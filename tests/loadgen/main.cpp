@@ -0,0 +1,302 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "loadgen.hpp"
+#include "security/rsa.h"
+#include "utils/tools.h"
+#include "virtual_client.hpp"
+
+namespace {
+
+constexpr std::string_view USAGE = R"(Usage: canary_loadgen [--option=value]...
+  --host=127.0.0.1            address of the game server
+  --port=7172                 game port
+  --metrics-port=0            metrics port of the server, 0 = not scraped
+  --accounts=loadgen_accounts.txt  "email password character name" per line
+  --key=key.pem               the server private key, its modulus encrypts the login
+  --clients=0                 virtual clients, 0 = one per account
+  --threads=2                 network threads
+  --duration=60               seconds of load after the ramp up started
+  --ramp-up=10                seconds to connect every client
+  --interval=500              milliseconds between two actions of a client
+  --report=10                 seconds between two reports
+  --script=walk,walk,say,walk,attack,use  actions each client loops over
+  --use=x,y,z,itemId[,stackpos]  item of the use action, repeat for several)";
+
+std::vector<std::string> split(const std::string& value)
+{
+	std::vector<std::string> parts;
+	boost::split(parts, value, boost::is_any_of(","));
+	return parts;
+}
+
+bool parseScript(const std::string& value, std::vector<LoadgenAction_t>& script)
+{
+	script.clear();
+	for (const std::string& name : split(value)) {
+		if (name == "walk") {
+			script.push_back(LOADGEN_ACTION_WALK);
+		} else if (name == "say") {
+			script.push_back(LOADGEN_ACTION_SAY);
+		} else if (name == "attack") {
+			script.push_back(LOADGEN_ACTION_ATTACK);
+		} else if (name == "use") {
+			script.push_back(LOADGEN_ACTION_USE);
+		} else {
+			SPDLOG_ERROR("Unknown script action {}", name);
+			return false;
+		}
+	}
+	return !script.empty();
+}
+
+bool parseUseTarget(const std::string& value, std::vector<LoadgenUseTarget>& useTargets)
+{
+	std::vector<std::string> parts = split(value);
+	if (parts.size() < 4 || parts.size() > 5) {
+		SPDLOG_ERROR("--use expects x,y,z,itemId[,stackpos], got {}", value);
+		return false;
+	}
+
+	LoadgenUseTarget& target = useTargets.emplace_back();
+	target.pos = Position(std::stoul(parts[0]), std::stoul(parts[1]), std::stoul(parts[2]));
+	target.itemId = std::stoul(parts[3]);
+	if (parts.size() == 5) {
+		target.stackpos = std::stoul(parts[4]);
+	}
+	return true;
+}
+
+bool parseOptions(int argc, char** argv, LoadgenOptions& options)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		size_t equals = arg.find('=');
+		if (arg.substr(0, 2) != "--" || equals == std::string_view::npos) {
+			fmt::print("{}\n", USAGE);
+			return false;
+		}
+
+		std::string_view name = arg.substr(2, equals - 2);
+		std::string value(arg.substr(equals + 1));
+		try {
+			if (name == "host") {
+				options.host = value;
+			} else if (name == "port") {
+				options.gamePort = static_cast<uint16_t>(std::stoul(value));
+			} else if (name == "metrics-port") {
+				options.metricsPort = static_cast<uint16_t>(std::stoul(value));
+			} else if (name == "accounts") {
+				options.accountsFile = value;
+			} else if (name == "key") {
+				options.keyFile = value;
+			} else if (name == "clients") {
+				options.clients = std::stoul(value);
+			} else if (name == "threads") {
+				options.threads = std::max<uint32_t>(1, std::stoul(value));
+			} else if (name == "duration") {
+				options.duration = std::stoul(value);
+			} else if (name == "ramp-up") {
+				options.rampUp = std::stoul(value);
+			} else if (name == "interval") {
+				options.actionInterval = std::max<uint32_t>(1, std::stoul(value));
+			} else if (name == "report") {
+				options.reportInterval = std::max<uint32_t>(1, std::stoul(value));
+			} else if (name == "script") {
+				if (!parseScript(value, options.script)) {
+					return false;
+				}
+			} else if (name == "use") {
+				if (!parseUseTarget(value, options.useTargets)) {
+					return false;
+				}
+			} else {
+				fmt::print("{}\n", USAGE);
+				return false;
+			}
+		} catch (const std::exception&) {
+			SPDLOG_ERROR("Invalid value for --{}: {}", name, value);
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<LoadgenAccount> loadAccounts(const std::string& filename)
+{
+	std::vector<LoadgenAccount> accounts;
+	std::ifstream file(filename);
+	std::string line;
+	while (std::getline(file, line)) {
+		boost::trim(line);
+		if (line.empty() || line.front() == '#') {
+			continue;
+		}
+
+		// the character name is the rest of the line, it may hold spaces
+		std::istringstream stream(line);
+		LoadgenAccount account;
+		stream >> account.email >> account.password;
+		std::getline(stream >> std::ws, account.character);
+		if (account.character.empty()) {
+			SPDLOG_WARN("Skipping account line without a character: {}", line);
+			continue;
+		}
+		accounts.emplace_back(std::move(account));
+	}
+	return accounts;
+}
+
+void logReport(std::string_view title, double seconds, const LoadgenReport& report, const ServerMetricsSample& from, const ServerMetricsSample& to)
+{
+	auto toMillis = [](uint64_t micros) {
+		return micros / 1000.;
+	};
+
+	seconds = std::max(seconds, 0.001);
+	SPDLOG_INFO("{}: {} online, {} connecting, {} logins, {} failed logins, {} disconnects",
+				title, report.online, report.connecting, report.logins, report.failedLogins, report.disconnects);
+	SPDLOG_INFO("  clients: {:.1f} actions/s, {:.1f} KiB/s sent, {:.1f} KiB/s received",
+				report.actions / seconds, report.bytesSent / seconds / 1024, report.bytesReceived / seconds / 1024);
+	SPDLOG_INFO("  login: p50 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms",
+				toMillis(report.login.getPercentile(50)), toMillis(report.login.getPercentile(99)), toMillis(report.login.getMax()));
+	SPDLOG_INFO("  round trip: p50 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms over {} samples",
+				toMillis(report.roundTrip.getPercentile(50)), toMillis(report.roundTrip.getPercentile(99)), toMillis(report.roundTrip.getMax()), report.roundTrip.getCount());
+	if (from.valid && to.valid) {
+		SPDLOG_INFO("  server: dispatcher lag {:.1f} ms, cycle p50 <= {:.1f} ms, p99 <= {:.1f} ms, {:.0f} tasks/s",
+					to.dispatcherLag * 1000, getCyclePercentile(from, to, 50) * 1000, getCyclePercentile(from, to, 99) * 1000, (to.tasksRun - from.tasksRun) / seconds);
+		// the numbers to compare between networkReceiveBuffer settings and the io_uring build
+		double playerSeconds = std::max<uint32_t>(1, report.online) * seconds;
+		SPDLOG_INFO("  server sockets: {:.2f} reads and {:.2f} writes per player per second",
+					(to.socketReads - from.socketReads) / playerSeconds, (to.socketWrites - from.socketWrites) / playerSeconds);
+	}
+}
+
+void mergeReport(LoadgenReport& total, const LoadgenReport& report)
+{
+	total.connecting = report.connecting;
+	total.online = report.online;
+	total.logins += report.logins;
+	total.failedLogins += report.failedLogins;
+	total.disconnects += report.disconnects;
+	total.actions += report.actions;
+	total.bytesSent += report.bytesSent;
+	total.bytesReceived += report.bytesReceived;
+	total.login.merge(report.login);
+	total.roundTrip.merge(report.roundTrip);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+	LoadgenOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	std::vector<LoadgenAccount> accounts = loadAccounts(options.accountsFile);
+	if (accounts.empty()) {
+		SPDLOG_ERROR("No account in {}", options.accountsFile);
+		return 1;
+	}
+
+	if (options.clients == 0) {
+		options.clients = accounts.size();
+	} else if (options.clients > accounts.size()) {
+		SPDLOG_ERROR("{} clients need as many characters, {} only has {}", options.clients, options.accountsFile, accounts.size());
+		return 1;
+	}
+
+	if (!g_RSA().loadPEM(options.keyFile)) {
+		SPDLOG_ERROR("Cannot load the RSA key from {}", options.keyFile);
+		return 1;
+	}
+
+	LoadgenSession session(options);
+
+	// one io_service per thread as the server connection services, a client never runs on two threads
+	std::vector<std::unique_ptr<boost::asio::io_service>> services;
+	std::vector<std::unique_ptr<boost::asio::io_service::work>> works;
+	for (uint32_t i = 0; i < options.threads; ++i) {
+		auto& service = services.emplace_back(std::make_unique<boost::asio::io_service>());
+		works.emplace_back(std::make_unique<boost::asio::io_service::work>(*service));
+	}
+
+	std::vector<std::shared_ptr<VirtualClient>> clients;
+	clients.reserve(options.clients);
+	for (uint32_t i = 0; i < options.clients; ++i) {
+		auto& client = clients.emplace_back(std::make_shared<VirtualClient>(*services[i % services.size()], session, accounts[i], 2654435761U * (i + 1)));
+		client->start(static_cast<uint64_t>(options.rampUp) * 1000 * i / options.clients);
+	}
+
+	std::vector<std::thread> threads;
+	for (auto& service : services) {
+		threads.emplace_back([&service]() {
+			service->run();
+		});
+	}
+
+	SPDLOG_INFO("Starting {} clients against {}:{} for {} seconds", options.clients, options.host, options.gamePort, options.duration);
+
+	ServerMetricsSample firstMetrics;
+	if (options.metricsPort != 0) {
+		firstMetrics = scrapeServerMetrics(options.host, options.metricsPort);
+	}
+
+	ServerMetricsSample lastMetrics = firstMetrics;
+	LoadgenReport total;
+	int64_t start = OTSYS_TIME();
+	int64_t lastReport = start;
+	int64_t end = start + static_cast<int64_t>(options.duration) * 1000;
+	while (lastReport < end) {
+		int64_t next = std::min<int64_t>(lastReport + options.reportInterval * 1000, end);
+		std::this_thread::sleep_for(std::chrono::milliseconds(next - OTSYS_TIME()));
+
+		int64_t now = OTSYS_TIME();
+		LoadgenReport report = session.takeReport();
+		ServerMetricsSample metrics;
+		if (options.metricsPort != 0) {
+			metrics = scrapeServerMetrics(options.host, options.metricsPort);
+		}
+
+		logReport(fmt::format("[{}s]", (now - start) / 1000), (now - lastReport) / 1000., report, lastMetrics, metrics);
+		mergeReport(total, report);
+		lastMetrics = metrics;
+		lastReport = now;
+	}
+
+	logReport("Total", (lastReport - start) / 1000., total, firstMetrics, lastMetrics);
+
+	// the clients log out on their next action and the server closes the connections
+	session.stop();
+	std::this_thread::sleep_for(std::chrono::milliseconds(options.actionInterval + 2000));
+
+	works.clear();
+	for (auto& service : services) {
+		service->stop();
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "loadgen.hpp"
+
+namespace {
+
+// value of a sample line "name{labels} value", false for other metrics
+bool parseSample(std::string_view line, std::string_view name, std::string_view& labels, double& value)
+{
+	if (line.substr(0, name.size()) != name) {
+		return false;
+	}
+
+	std::string_view rest = line.substr(name.size());
+	if (!rest.empty() && rest.front() == '{') {
+		size_t end = rest.find('}');
+		if (end == std::string_view::npos) {
+			return false;
+		}
+		labels = rest.substr(1, end - 1);
+		rest = rest.substr(end + 1);
+	} else {
+		labels = {};
+	}
+
+	if (rest.empty() || rest.front() != ' ') {
+		return false;
+	}
+
+	value = std::strtod(std::string(rest.substr(1)).c_str(), nullptr);
+	return true;
+}
+
+}  // namespace
+
+ServerMetricsSample scrapeServerMetrics(const std::string& host, uint16_t port)
+{
+	ServerMetricsSample sample;
+
+	boost::system::error_code error;
+	boost::asio::io_service service;
+	boost::asio::ip::tcp::socket socket(service);
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(host, error), port);
+	if (!error) {
+		socket.connect(endpoint, error);
+	}
+	if (error) {
+		SPDLOG_WARN("[scrapeServerMetrics] - Cannot connect to the metrics port: {}", error.message());
+		return sample;
+	}
+
+	std::string request = fmt::format("GET /metrics HTTP/1.0\r\nHost: {}\r\n\r\n", host);
+	boost::asio::write(socket, boost::asio::buffer(request), error);
+
+	std::string response;
+	std::array<char, 8192> buffer;
+	while (!error) {
+		size_t read = socket.read_some(boost::asio::buffer(buffer), error);
+		response.append(buffer.data(), read);
+	}
+	if (error != boost::asio::error::eof) {
+		SPDLOG_WARN("[scrapeServerMetrics] - Cannot read the metrics: {}", error.message());
+		return sample;
+	}
+
+	std::istringstream stream(response);
+	std::string line;
+	while (std::getline(stream, line)) {
+		if (line.empty() || line.front() == '#') {
+			continue;
+		}
+
+		std::string_view labels;
+		double value;
+		if (parseSample(line, "canary_dispatcher_lag_seconds", labels, value)) {
+			sample.dispatcherLag = value;
+		} else if (parseSample(line, "canary_dispatcher_tasks_run_total", labels, value)) {
+			sample.tasksRun = static_cast<uint64_t>(value);
+		} else if (parseSample(line, "canary_network_socket_reads_total", labels, value)) {
+			sample.socketReads = static_cast<uint64_t>(value);
+		} else if (parseSample(line, "canary_network_socket_writes_total", labels, value)) {
+			sample.socketWrites = static_cast<uint64_t>(value);
+		} else if (parseSample(line, "canary_dispatcher_cycle_seconds_bucket", labels, value)) {
+			size_t bound = labels.find("le=\"");
+			if (bound == std::string_view::npos) {
+				continue;
+			}
+
+			std::string le(labels.substr(bound + 4, labels.find('"', bound + 4) - bound - 4));
+			double upperBound = le == "+Inf" ? std::numeric_limits<double>::infinity() : std::strtod(le.c_str(), nullptr);
+			sample.cycleBuckets.emplace_back(upperBound, static_cast<uint64_t>(value));
+		}
+	}
+
+	sample.valid = !sample.cycleBuckets.empty();
+	return sample;
+}
+
+double getCyclePercentile(const ServerMetricsSample& from, const ServerMetricsSample& to, double percentile)
+{
+	if (!from.valid || !to.valid || from.cycleBuckets.size() != to.cycleBuckets.size()) {
+		return 0;
+	}
+
+	uint64_t total = to.cycleBuckets.back().second - from.cycleBuckets.back().second;
+	if (total == 0) {
+		return 0;
+	}
+
+	// the buckets are cumulative, the first one reaching the rank holds the percentile
+	uint64_t rank = static_cast<uint64_t>(std::ceil(total * percentile / 100.));
+	for (size_t i = 0; i < to.cycleBuckets.size(); ++i) {
+		if (to.cycleBuckets[i].second - from.cycleBuckets[i].second >= rank) {
+			return to.cycleBuckets[i].first;
+		}
+	}
+	return to.cycleBuckets.back().first;
+}
@@ -0,0 +1,443 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "pch.hpp"
+
+#include "virtual_client.hpp"
+#include "security/rsa.h"
+#include "server/network/message/networkmessage.h"
+#include "utils/log_rate_limiter.hpp"
+#include "utils/tools.h"
+
+namespace {
+
+// above CLIENTOS_NEW_MAC, so the server picks adler32 checksums without compression
+constexpr uint16_t LOADGEN_OPERATING_SYSTEM = CLIENTOS_OTCLIENT_LINUX;
+constexpr uint8_t PROTOCOL_ID_GAME = 0x0A;
+constexpr size_t RSA_BLOCK_SIZE = 128;
+// the server kicks players that do not answer its pings for a minute
+constexpr int64_t PING_BACK_INTERVAL = 10000;
+
+uint32_t nextRandom(uint32_t& seed)
+{
+	// xorshift32, the scripts only need to differ between the clients
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+const uint8_t* getPayload(const NetworkMessage& msg)
+{
+	return msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION;
+}
+
+}  // namespace
+
+VirtualClient::VirtualClient(boost::asio::io_service& service, LoadgenSession& session, LoadgenAccount account, uint32_t seed) :
+	session(session), account(std::move(account)), socket(service), timer(service), seed(seed | 1) {}
+
+void VirtualClient::start(uint32_t delayMillis)
+{
+	// called before the network thread runs the io_service
+	timer.expires_from_now(boost::posix_time::milliseconds(delayMillis));
+	timer.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+		if (!error) {
+			self->connect();
+		}
+	});
+}
+
+void VirtualClient::connect()
+{
+	if (!session.isRunning()) {
+		return;
+	}
+
+	const LoadgenOptions& options = session.getOptions();
+	state = STATE_CHALLENGE;
+	connectStart = DispatcherProfiler::getTimeMicros();
+	session.onConnecting();
+
+	for (uint32_t& word : key) {
+		word = nextRandom(seed);
+	}
+	encryptKeys = xtea::expandEncryptKey(key);
+	decryptKeys = xtea::expandDecryptKey(key);
+
+	boost::system::error_code error;
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(options.host, error), options.gamePort);
+	if (error) {
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[VirtualClient::connect] - Invalid host {}", options.host);
+		close();
+		return;
+	}
+
+	socket.async_connect(endpoint, [self = shared_from_this()](const boost::system::error_code& connectError) {
+		if (connectError) {
+			if (connectError != boost::asio::error::operation_aborted) {
+				SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[VirtualClient::connect] - {}", connectError.message());
+				self->close();
+			}
+			return;
+		}
+
+		// the game server speaks first with the login challenge
+		self->readHeader();
+	});
+}
+
+void VirtualClient::logout()
+{
+	if (state == STATE_ONLINE) {
+		NetworkMessage msg;
+		msg.addByte(0x14);
+		sendPacket(msg);
+	}
+}
+
+void VirtualClient::close()
+{
+	if (state == STATE_IDLE) {
+		return;
+	}
+
+	if (state == STATE_ONLINE) {
+		session.onDisconnect(playerId);
+	} else {
+		session.onLoginFailed();
+	}
+
+	state = STATE_IDLE;
+	playerId = 0;
+	roundTripStart = 0;
+	writeQueue.clear();
+	writing = false;
+
+	boost::system::error_code error;
+	socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+	socket.close(error);
+	timer.cancel(error);
+
+	scheduleReconnect();
+}
+
+void VirtualClient::scheduleReconnect()
+{
+	if (!session.isRunning()) {
+		return;
+	}
+
+	timer.expires_from_now(boost::posix_time::seconds(session.getOptions().reconnectDelay));
+	timer.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+		if (!error && self->state == STATE_IDLE) {
+			self->connect();
+		}
+	});
+}
+
+void VirtualClient::readHeader()
+{
+	boost::asio::async_read(socket, boost::asio::buffer(header, sizeof(header)),
+							std::bind(&VirtualClient::parseHeader, shared_from_this(), std::placeholders::_1));
+}
+
+void VirtualClient::parseHeader(const boost::system::error_code& error)
+{
+	if (state == STATE_IDLE || error == boost::asio::error::operation_aborted) {
+		return;
+	} else if (error) {
+		close();
+		return;
+	}
+
+	uint16_t size = header[0] | header[1] << 8;
+	if (size == 0) {
+		close();
+		return;
+	}
+
+	body.resize(size);
+	boost::asio::async_read(socket, boost::asio::buffer(body),
+							std::bind(&VirtualClient::parseBody, shared_from_this(), std::placeholders::_1));
+}
+
+void VirtualClient::parseBody(const boost::system::error_code& error)
+{
+	if (state == STATE_IDLE || error == boost::asio::error::operation_aborted) {
+		return;
+	} else if (error) {
+		close();
+		return;
+	}
+
+	session.onReceive(HEADER_LENGTH + body.size());
+	if (state == STATE_CHALLENGE) {
+		parseChallenge();
+	} else {
+		parseGameMessage();
+	}
+
+	if (state != STATE_IDLE) {
+		readHeader();
+	}
+}
+
+void VirtualClient::parseChallenge()
+{
+	// checksum, inner length, 0x1F, timestamp and random number, see ProtocolGame::onConnect
+	if (body.size() < 12 || body[6] != 0x1F) {
+		SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[VirtualClient::parseChallenge] - Unexpected first message from the server");
+		close();
+		return;
+	}
+
+	uint32_t timestamp;
+	memcpy(&timestamp, body.data() + 7, sizeof(timestamp));
+	sendLogin(timestamp, body[11]);
+}
+
+void VirtualClient::parseGameMessage()
+{
+	if (body.size() < CHECKSUM_LENGTH + 8) {
+		close();
+		return;
+	}
+
+	uint8_t* encrypted = body.data() + CHECKSUM_LENGTH;
+	size_t encryptedLength = body.size() - CHECKSUM_LENGTH;
+	if ((encryptedLength & 7) != 0) {
+		close();
+		return;
+	}
+
+	xtea::decrypt(encrypted, encryptedLength, decryptKeys);
+
+	uint16_t innerLength;
+	memcpy(&innerLength, encrypted, sizeof(innerLength));
+	if (innerLength == 0 || innerLength > encryptedLength - sizeof(innerLength)) {
+		close();
+		return;
+	}
+
+	int64_t now = DispatcherProfiler::getTimeMicros();
+	if (roundTripStart != 0) {
+		session.recordRoundTrip(now - roundTripStart);
+		roundTripStart = 0;
+	}
+
+	if (state != STATE_LOGIN) {
+		return;
+	}
+
+	NetworkMessage msg;
+	memcpy(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION, encrypted + sizeof(innerLength), innerLength);
+	msg.setLength(innerLength);
+
+	uint8_t opcode = msg.getByte();
+	if (opcode == 0x14 || opcode == 0x16) {
+		// disconnect text or waiting list, ProtocolGame::disconnectClient
+		SPDLOG_RATE_LIMITED(SPDLOG_WARN, "[VirtualClient::parseGameMessage] - Login of {} refused: {}", account.character, msg.getString());
+		close();
+		return;
+	}
+
+	if (opcode == 0x17) {
+		playerId = msg.get<uint32_t>();
+	}
+
+	state = STATE_ONLINE;
+	lastPingBack = OTSYS_TIME();
+	session.onLogin(playerId, now - connectStart);
+	scheduleAction();
+}
+
+void VirtualClient::sendLogin(uint32_t challengeTimestamp, uint8_t challengeRandom)
+{
+	// same layout as the client, read back by ProtocolGame::onRecvFirstMessage
+	NetworkMessage block;
+	block.addByte(0x00);
+	for (uint32_t word : key) {
+		block.add<uint32_t>(word);
+	}
+	block.addByte(0x00); // gamemaster flag
+	block.addString(account.email + '\n' + account.password);
+	block.addString(account.character);
+	block.add<uint32_t>(challengeTimestamp);
+	block.addByte(challengeRandom);
+	if (block.getLength() > RSA_BLOCK_SIZE) {
+		SPDLOG_RATE_LIMITED(SPDLOG_ERROR, "[VirtualClient::sendLogin] - Credentials of {} do not fit in the RSA block", account.character);
+		close();
+		return;
+	}
+
+	char rsaBlock[RSA_BLOCK_SIZE];
+	memcpy(rsaBlock, getPayload(block), block.getLength());
+	for (size_t i = block.getLength(); i < RSA_BLOCK_SIZE; ++i) {
+		rsaBlock[i] = static_cast<char>(nextRandom(seed));
+	}
+	g_RSA().encrypt(rsaBlock);
+
+	NetworkMessage msg;
+	msg.addByte(PROTOCOL_ID_GAME);
+	msg.add<uint16_t>(LOADGEN_OPERATING_SYSTEM);
+	msg.add<uint16_t>(CLIENT_VERSION);
+	msg.add<uint32_t>(CLIENT_VERSION);
+	msg.addString(fmt::format("{}.{}", CLIENT_VERSION_UPPER, CLIENT_VERSION_LOWER));
+	msg.add<uint16_t>(0x00); // dat revision
+	msg.addByte(0x00); // game preview state
+	msg.addBytes(rsaBlock, RSA_BLOCK_SIZE);
+
+	uint16_t size = CHECKSUM_LENGTH + msg.getLength();
+	uint32_t checksum = adlerChecksum(getPayload(msg), msg.getLength());
+	std::vector<uint8_t> frame(HEADER_LENGTH + size);
+	memcpy(frame.data(), &size, sizeof(size));
+	memcpy(frame.data() + HEADER_LENGTH, &checksum, sizeof(checksum));
+	memcpy(frame.data() + HEADER_LENGTH + CHECKSUM_LENGTH, getPayload(msg), msg.getLength());
+
+	state = STATE_LOGIN;
+	write(std::move(frame));
+}
+
+void VirtualClient::sendPacket(const NetworkMessage& msg)
+{
+	// inner length, payload and padding up to the xtea block size, see Protocol::XTEA_decrypt
+	uint16_t length = msg.getLength();
+	size_t encryptedLength = (sizeof(length) + length + 7) & ~static_cast<size_t>(7);
+	std::vector<uint8_t> frame(HEADER_LENGTH + CHECKSUM_LENGTH + encryptedLength, 0);
+
+	uint8_t* encrypted = frame.data() + HEADER_LENGTH + CHECKSUM_LENGTH;
+	memcpy(encrypted, &length, sizeof(length));
+	memcpy(encrypted + sizeof(length), getPayload(msg), length);
+	xtea::encrypt(encrypted, encryptedLength, encryptKeys);
+
+	uint16_t size = CHECKSUM_LENGTH + encryptedLength;
+	uint32_t checksum = adlerChecksum(encrypted, encryptedLength);
+	memcpy(frame.data(), &size, sizeof(size));
+	memcpy(frame.data() + HEADER_LENGTH, &checksum, sizeof(checksum));
+	write(std::move(frame));
+}
+
+void VirtualClient::write(std::vector<uint8_t> frame)
+{
+	session.onSend(frame.size());
+	writeQueue.emplace_back(std::move(frame));
+	if (writing) {
+		return;
+	}
+
+	writing = true;
+	boost::asio::async_write(socket, boost::asio::buffer(writeQueue.front()),
+							 std::bind(&VirtualClient::onWrite, shared_from_this(), std::placeholders::_1));
+}
+
+void VirtualClient::onWrite(const boost::system::error_code& error)
+{
+	if (state == STATE_IDLE || error == boost::asio::error::operation_aborted) {
+		return;
+	} else if (error) {
+		close();
+		return;
+	}
+
+	writeQueue.pop_front();
+	if (writeQueue.empty()) {
+		writing = false;
+		return;
+	}
+
+	boost::asio::async_write(socket, boost::asio::buffer(writeQueue.front()),
+							 std::bind(&VirtualClient::onWrite, shared_from_this(), std::placeholders::_1));
+}
+
+void VirtualClient::scheduleAction()
+{
+	timer.expires_from_now(boost::posix_time::milliseconds(session.getOptions().actionInterval));
+	timer.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+		if (!error && self->state == STATE_ONLINE) {
+			self->doAction();
+		}
+	});
+}
+
+void VirtualClient::doAction()
+{
+	if (!session.isRunning()) {
+		// the server closes the connection once the player is gone
+		logout();
+		return;
+	}
+
+	int64_t now = OTSYS_TIME();
+	if (now - lastPingBack >= PING_BACK_INTERVAL) {
+		NetworkMessage ping;
+		ping.addByte(0x1D);
+		sendPacket(ping);
+		lastPingBack = now;
+	}
+
+	const LoadgenOptions& options = session.getOptions();
+	LoadgenAction_t action = options.script[scriptIndex++ % options.script.size()];
+
+	NetworkMessage msg;
+	switch (action) {
+		case LOADGEN_ACTION_WALK:
+			// north, east, south or west
+			msg.addByte(0x65 + nextRandom(seed) % 4);
+			break;
+
+		case LOADGEN_ACTION_SAY:
+			msg.addByte(0x96);
+			msg.addByte(TALKTYPE_SAY);
+			msg.addString(fmt::format("loadgen {}", scriptIndex));
+			// the creature say comes back right away, walking waits for the step time
+			if (roundTripStart == 0) {
+				roundTripStart = DispatcherProfiler::getTimeMicros();
+			}
+			break;
+
+		case LOADGEN_ACTION_ATTACK: {
+			uint32_t targetId = session.getAttackTarget(playerId, nextRandom(seed));
+			if (targetId != 0) {
+				msg.addByte(0xA1);
+				msg.add<uint32_t>(targetId);
+				msg.add<uint32_t>(targetId);
+			}
+			break;
+		}
+
+		case LOADGEN_ACTION_USE:
+			if (!options.useTargets.empty()) {
+				const LoadgenUseTarget& target = options.useTargets[nextRandom(seed) % options.useTargets.size()];
+				msg.addByte(0x82);
+				msg.addPosition(target.pos);
+				msg.add<uint16_t>(target.itemId);
+				msg.addByte(target.stackpos);
+				msg.addByte(0x00); // container index
+			}
+			break;
+	}
+
+	if (msg.getLength() != 0) {
+		sendPacket(msg);
+		session.onAction();
+	}
+	scheduleAction();
+}
@@ -0,0 +1,97 @@
+/**
+ * Canary - A free and open-source MMORPG server emulator
+ * Copyright (C) 2021 OpenTibiaBR <opentibiabr@outlook.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef TESTS_LOADGEN_VIRTUAL_CLIENT_HPP_
+#define TESTS_LOADGEN_VIRTUAL_CLIENT_HPP_
+
+#include "loadgen.hpp"
+#include "security/xtea.hpp"
+
+class NetworkMessage;
+
+/**
+ * One scripted player connected straight to the game port, as a client with
+ * the OTClient Linux operating system id: adler32 checksums and no compression.
+ * The server messages are decrypted but not parsed past their first opcode,
+ * the client only learns whether the login worked and its player id.
+ * Every client lives on one io_service run by a single thread, so its
+ * handlers never run concurrently.
+ */
+class VirtualClient : public std::enable_shared_from_this<VirtualClient>
+{
+	public:
+		VirtualClient(boost::asio::io_service& service, LoadgenSession& session, LoadgenAccount account, uint32_t seed);
+
+		void start(uint32_t delayMillis);
+
+	private:
+		enum State_t : uint8_t {
+			STATE_IDLE,
+			STATE_CHALLENGE,
+			STATE_LOGIN,
+			STATE_ONLINE,
+		};
+
+		void connect();
+		void logout();
+		void close();
+		void scheduleReconnect();
+
+		void readHeader();
+		void parseHeader(const boost::system::error_code& error);
+		void parseBody(const boost::system::error_code& error);
+		void parseChallenge();
+		void parseGameMessage();
+
+		void sendLogin(uint32_t challengeTimestamp, uint8_t challengeRandom);
+		void sendPacket(const NetworkMessage& msg);
+		void write(std::vector<uint8_t> frame);
+		void onWrite(const boost::system::error_code& error);
+
+		void scheduleAction();
+		void doAction();
+
+		LoadgenSession& session;
+		LoadgenAccount account;
+
+		boost::asio::ip::tcp::socket socket;
+		boost::asio::deadline_timer timer;
+
+		State_t state = STATE_IDLE;
+		uint32_t seed;
+		uint32_t playerId = 0;
+		size_t scriptIndex = 0;
+
+		xtea::Key key {};
+		xtea::RoundKeys encryptKeys {};
+		xtea::RoundKeys decryptKeys {};
+
+		uint8_t header[2];
+		std::vector<uint8_t> body;
+		std::deque<std::vector<uint8_t>> writeQueue;
+		bool writing = false;
+
+		int64_t connectStart = 0;
+		// an action with a guaranteed answer waiting for the next server message
+		int64_t roundTripStart = 0;
+		int64_t lastPingBack = 0;
+};
+
+#endif  // TESTS_LOADGEN_VIRTUAL_CLIENT_HPP_